@@ -28,11 +28,13 @@ let package = Package(
                     "src/stack.c",
                     "src/node.c",
                     "src/lexer.c",
+                    "src/line_index.c",
                     "src/parser.c",
                     "src/language.c",
                     "src/alloc.c",
                     "src/subtree.c",
                     "src/tree.c",
+                    "src/tree_diff.c",
                     "src/query.c"
                 ],
                 sources: ["src/lib.c"]),
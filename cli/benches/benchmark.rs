@@ -1,14 +1,28 @@
 use anyhow::Context;
 use lazy_static::lazy_static;
-use std::collections::BTreeMap;
+use serde::{Deserialize, Serialize};
+use std::collections::{BTreeMap, HashMap};
+use std::os::raw::c_void;
 use std::path::{Path, PathBuf};
+use std::sync::atomic::{AtomicUsize, Ordering};
 use std::time::Instant;
-use std::{env, fs, str, usize};
-use tree_sitter::{Language, Parser, Query};
+use std::{env, fs, process, str, usize};
+use tree_sitter::{InputEdit, Language, Parser, Point, Query, QueryCursor, Tree};
+use tree_sitter_cli::generate;
+use tree_sitter_highlight::{HighlightConfiguration, Highlighter};
 use tree_sitter_loader::{CompileConfig, Loader};
+use tree_sitter_tags::{TagsConfiguration, TagsContext};
 
 include!("../src/tests/helpers/dirs.rs");
 
+// The number of bytes removed from the middle of each example when benchmarking
+// incremental reparsing.
+const EDIT_SIZES: [usize; 3] = [1, 64, 4096];
+
+// The number of times that the languages alternate in the generated document that is
+// used to benchmark highlighting with many injections.
+const INTERLEAVED_INJECTION_COUNT: usize = 500;
+
 lazy_static! {
     static ref LANGUAGE_FILTER: Option<String> =
         env::var("TREE_SITTER_BENCHMARK_LANGUAGE_FILTER").ok();
@@ -17,7 +31,17 @@ lazy_static! {
     static ref REPETITION_COUNT: usize = env::var("TREE_SITTER_BENCHMARK_REPETITION_COUNT")
         .map(|s| s.parse::<usize>().unwrap())
         .unwrap_or(5);
+    static ref JSON_OUTPUT_PATH: Option<PathBuf> =
+        env::var_os("TREE_SITTER_BENCHMARK_JSON_OUTPUT").map(PathBuf::from);
+    static ref BASELINE_PATH: Option<PathBuf> =
+        env::var_os("TREE_SITTER_BENCHMARK_BASELINE").map(PathBuf::from);
+    static ref REGRESSION_THRESHOLD: f64 = env::var("TREE_SITTER_BENCHMARK_REGRESSION_THRESHOLD")
+        .map(|s| s.parse::<f64>().unwrap())
+        .unwrap_or(10.0);
+    static ref TABLE_LEXER: bool = env::var("TREE_SITTER_BENCHMARK_TABLE_LEXER").is_ok();
     static ref TEST_LOADER: Loader = Loader::with_parser_lib_path(SCRATCH_DIR.clone());
+    static ref TABLE_LEXER_LOADER: Loader =
+        Loader::with_parser_lib_path(SCRATCH_DIR.join("table-lexer"));
     static ref EXAMPLE_AND_QUERY_PATHS_BY_LANGUAGE_DIR: BTreeMap<PathBuf, (Vec<PathBuf>, Vec<PathBuf>)> = {
         fn process_dir(result: &mut BTreeMap<PathBuf, (Vec<PathBuf>, Vec<PathBuf>)>, dir: &Path) {
             if dir.join("grammar.js").exists() {
@@ -62,7 +86,55 @@ lazy_static! {
     };
 }
 
+// Allocations made by the library are prefixed with a header that stores their size, so
+// that the allocated byte count can be tracked when they are freed.
+const ALLOCATION_HEADER_SIZE: usize = 16;
+
+static ALLOCATED_BYTES: AtomicUsize = AtomicUsize::new(0);
+static PEAK_ALLOCATED_BYTES: AtomicUsize = AtomicUsize::new(0);
+
+extern "C" {
+    fn malloc(size: usize) -> *mut c_void;
+    fn calloc(count: usize, size: usize) -> *mut c_void;
+    fn realloc(ptr: *mut c_void, size: usize) -> *mut c_void;
+    fn free(ptr: *mut c_void);
+}
+
+#[derive(Serialize, Deserialize)]
+struct BenchmarkReport {
+    repetition_count: usize,
+    results: Vec<BenchmarkResult>,
+}
+
+#[derive(Serialize, Deserialize)]
+struct BenchmarkResult {
+    language: String,
+    benchmark: String,
+    example: String,
+    bytes: usize,
+    min_ns: u64,
+    p50_ns: u64,
+    p90_ns: u64,
+    p99_ns: u64,
+    max_ns: u64,
+    peak_allocated_bytes: usize,
+}
+
+struct BenchmarkSuite {
+    max_path_length: usize,
+    results: Vec<BenchmarkResult>,
+}
+
 fn main() {
+    unsafe {
+        tree_sitter::set_allocator(
+            Some(counting_malloc),
+            Some(counting_calloc),
+            Some(counting_realloc),
+            Some(counting_free),
+        );
+    }
+
     let max_path_length = EXAMPLE_AND_QUERY_PATHS_BY_LANGUAGE_DIR
         .values()
         .flat_map(|(e, q)| {
@@ -74,7 +146,14 @@ fn main() {
         .unwrap_or(0);
 
     eprintln!("Benchmarking with {} repetitions", *REPETITION_COUNT);
+    if *TABLE_LEXER {
+        eprintln!("Using table-driven lexers");
+    }
 
+    let mut suite = BenchmarkSuite {
+        max_path_length,
+        results: Vec::new(),
+    };
     let mut parser = Parser::new();
     let mut all_normal_speeds = Vec::new();
     let mut all_error_speeds = Vec::new();
@@ -94,15 +173,12 @@ fn main() {
         let language = get_language(language_path);
         parser.set_language(&language).unwrap();
 
-        eprintln!("  Constructing Queries");
-        for path in query_paths {
-            if let Some(filter) = EXAMPLE_FILTER.as_ref() {
-                if !path.to_str().unwrap().contains(filter.as_str()) {
-                    continue;
-                }
-            }
+        let examples = read_files(example_paths);
+        let queries = read_files(query_paths);
 
-            parse(path, max_path_length, |source| {
+        eprintln!("  Constructing Queries");
+        for (path, source) in &queries {
+            suite.run(language_name, "query_construction", path, source, || {
                 Query::new(&language, str::from_utf8(source).unwrap())
                     .with_context(|| format!("Query file path: {path:?}"))
                     .expect("Failed to parse query");
@@ -111,16 +187,108 @@ fn main() {
 
         eprintln!("  Parsing Valid Code:");
         let mut normal_speeds = Vec::new();
-        for example_path in example_paths {
-            if let Some(filter) = EXAMPLE_FILTER.as_ref() {
-                if !example_path.to_str().unwrap().contains(filter.as_str()) {
-                    continue;
+        for (path, source) in &examples {
+            normal_speeds.push(suite.run(language_name, "parse", path, source, || {
+                parser.parse(source, None).expect("Failed to parse");
+            }));
+        }
+
+        let trees = examples
+            .iter()
+            .map(|(_, source)| parser.parse(source, None).expect("Failed to parse"))
+            .collect::<Vec<_>>();
+
+        for edit_size in EDIT_SIZES {
+            eprintln!("  Reparsing After Removing {edit_size} Bytes:");
+            let benchmark = format!("reparse_{edit_size}");
+            for ((path, source), tree) in examples.iter().zip(&trees) {
+                let (edited_source, edit) = remove_middle_bytes(source, edit_size);
+                suite.run(language_name, &benchmark, path, source, || {
+                    let mut tree = tree.clone();
+                    tree.edit(&edit);
+                    parser
+                        .parse(&edited_source, Some(&tree))
+                        .expect("Failed to parse");
+                });
+            }
+        }
+
+        eprintln!("  Traversing Trees:");
+        for ((path, source), tree) in examples.iter().zip(&trees) {
+            suite.run(language_name, "traverse", path, source, || {
+                walk_tree(tree);
+            });
+        }
+
+        let mut query_cursor = QueryCursor::new();
+        for (query_path, query_source) in &queries {
+            let query_name = query_path.file_name().unwrap().to_str().unwrap();
+            eprintln!("  Running Query {query_name}:");
+            let query = Query::new(&language, str::from_utf8(query_source).unwrap()).unwrap();
+            let benchmark = format!("query:{query_name}");
+            for ((path, source), tree) in examples.iter().zip(&trees) {
+                suite.run(language_name, &benchmark, path, source, || {
+                    query_cursor
+                        .matches(&query, tree.root_node(), source.as_slice())
+                        .count();
+                });
+            }
+        }
+
+        if let Some(highlights_query) = find_query(&queries, "highlights.scm") {
+            let config = HighlightConfiguration::new(
+                language.clone(),
+                language_name,
+                highlights_query,
+                find_query(&queries, "injections.scm").unwrap_or(""),
+                find_query(&queries, "locals.scm").unwrap_or(""),
+            );
+            match config {
+                Ok(mut config) => {
+                    let names = config
+                        .names()
+                        .iter()
+                        .map(ToString::to_string)
+                        .collect::<Vec<_>>();
+                    config.configure(&names);
+
+                    eprintln!("  Highlighting:");
+                    let mut highlighter = Highlighter::new();
+                    for (path, source) in &examples {
+                        suite.run(language_name, "highlight", path, source, || {
+                            highlighter
+                                .highlight(&config, source, None, |_| None)
+                                .expect("Failed to highlight")
+                                .count();
+                        });
+                    }
                 }
+                Err(error) => eprintln!("  Skipping Highlighting: {error}"),
             }
+        }
 
-            normal_speeds.push(parse(example_path, max_path_length, |code| {
-                parser.parse(code, None).expect("Failed to parse");
-            }));
+        if let Some(tags_query) = find_query(&queries, "tags.scm") {
+            let config = TagsConfiguration::new(
+                language.clone(),
+                tags_query,
+                find_query(&queries, "locals.scm").unwrap_or(""),
+            );
+            match config {
+                Ok(config) => {
+                    eprintln!("  Tagging:");
+                    let mut context = TagsContext::new();
+                    for (path, source) in &examples {
+                        suite.run(language_name, "tags", path, source, || {
+                            context
+                                .generate_tags(&config, source, None)
+                                .expect("Failed to generate tags")
+                                .0
+                                .count();
+                        });
+                    }
+                }
+                Err(error) => eprintln!("  Skipping Tagging: {error}"),
+            }
         }
 
         eprintln!("  Parsing Invalid Code (mismatched languages):");
@@ -129,16 +297,16 @@ fn main() {
             EXAMPLE_AND_QUERY_PATHS_BY_LANGUAGE_DIR.iter()
         {
             if other_language_path != language_path {
-                for example_path in example_paths {
-                    if let Some(filter) = EXAMPLE_FILTER.as_ref() {
-                        if !example_path.to_str().unwrap().contains(filter.as_str()) {
-                            continue;
-                        }
-                    }
-
-                    error_speeds.push(parse(example_path, max_path_length, |code| {
-                        parser.parse(code, None).expect("Failed to parse");
-                    }));
+                for (path, source) in read_files(example_paths) {
+                    error_speeds.push(suite.run(
+                        language_name,
+                        "parse_errors",
+                        &path,
+                        &source,
+                        || {
+                            parser.parse(&source, None).expect("Failed to parse");
+                        },
+                    ));
                 }
             }
         }
@@ -157,6 +325,13 @@ fn main() {
         all_error_speeds.extend(error_speeds);
     }
 
+    if LANGUAGE_FILTER
+        .as_ref()
+        .map_or(true, |filter| filter == "html")
+    {
+        run_interleaved_injection_benchmark(&mut suite);
+    }
+
     eprintln!("\n  Overall");
     if let Some((average_normal, worst_normal)) = aggregate(&all_normal_speeds) {
         eprintln!("  Average Speed (normal): {average_normal} bytes/ms");
@@ -168,6 +343,196 @@ fn main() {
         eprintln!("  Worst Speed (errors):   {worst_error} bytes/ms");
     }
     eprintln!();
+
+    let report = BenchmarkReport {
+        repetition_count: *REPETITION_COUNT,
+        results: suite.results,
+    };
+
+    if let Some(path) = JSON_OUTPUT_PATH.as_ref() {
+        fs::write(path, serde_json::to_string_pretty(&report).unwrap())
+            .with_context(|| format!("Failed to write {path:?}"))
+            .unwrap();
+        eprintln!("Wrote results to {path:?}");
+    }
+
+    if let Some(path) = BASELINE_PATH.as_ref() {
+        if compare_with_baseline(&report, path) {
+            process::exit(1);
+        }
+    }
+}
+
+// Highlight an HTML document in which the HTML alternates with many small scripts that
+// contain JSDoc comments, so that the highlighter constantly switches between injected
+// languages.
+fn run_interleaved_injection_benchmark(suite: &mut BenchmarkSuite) {
+    let configs = ["html", "javascript", "jsdoc"]
+        .iter()
+        .map(|name| highlight_config(name).map(|config| (*name, config)))
+        .collect::<Option<Vec<_>>>();
+    let Some(configs) = configs else {
+        eprintln!("\nSkipping Interleaved Injections: missing grammars or queries");
+        return;
+    };
+
+    let mut source = String::new();
+    for i in 0..INTERLEAVED_INJECTION_COUNT {
+        source += &format!(
+            "<p class=\"item\">Item {i}</p>\n\
+             <script>\n\
+             /** @param {{number}} n The item's index. */\n\
+             function showItem{i}(n) {{ document.title = `Item ${{n}}`; }}\n\
+             </script>\n"
+        );
+    }
+
+    eprintln!("\nHighlighting Interleaved Injections:");
+    let mut highlighter = Highlighter::new();
+    suite.run(
+        "html",
+        "highlight_interleaved_injections",
+        Path::new("interleaved.html"),
+        source.as_bytes(),
+        || {
+            highlighter
+                .highlight(&configs[0].1, source.as_bytes(), None, |name| {
+                    configs
+                        .iter()
+                        .find(|(config_name, _)| *config_name == name)
+                        .map(|(_, config)| config)
+                })
+                .expect("Failed to highlight")
+                .count();
+        },
+    );
+}
+
+// Load a highlighting configuration for one of the benchmark grammars, using all of
+// the highlight names that its queries contain.
+fn highlight_config(language_name: &str) -> Option<HighlightConfiguration> {
+    let (language_path, (_, query_paths)) = EXAMPLE_AND_QUERY_PATHS_BY_LANGUAGE_DIR
+        .iter()
+        .find(|(path, _)| path.file_name().unwrap() == language_name)?;
+    let queries = query_paths
+        .iter()
+        .map(|path| (path.clone(), fs::read(path).unwrap()))
+        .collect::<Vec<_>>();
+    let mut config = HighlightConfiguration::new(
+        get_language(language_path),
+        language_name,
+        find_query(&queries, "highlights.scm")?,
+        find_query(&queries, "injections.scm").unwrap_or(""),
+        find_query(&queries, "locals.scm").unwrap_or(""),
+    )
+    .ok()?;
+    let names = config
+        .names()
+        .iter()
+        .map(ToString::to_string)
+        .collect::<Vec<_>>();
+    config.configure(&names);
+    Some(config)
+}
+
+impl BenchmarkSuite {
+    // Run an action once to measure its peak memory usage, and then `REPETITION_COUNT`
+    // more times to measure its duration. Returns the median speed in bytes/ms.
+    fn run(
+        &mut self,
+        language: &str,
+        benchmark: &str,
+        path: &Path,
+        source: &[u8],
+        mut action: impl FnMut(),
+    ) -> usize {
+        eprint!(
+            "    {:width$}\t",
+            path.file_name().unwrap().to_str().unwrap(),
+            width = self.max_path_length
+        );
+
+        let baseline_bytes = ALLOCATED_BYTES.load(Ordering::SeqCst);
+        PEAK_ALLOCATED_BYTES.store(baseline_bytes, Ordering::SeqCst);
+        action();
+        let peak_allocated_bytes = PEAK_ALLOCATED_BYTES
+            .load(Ordering::SeqCst)
+            .saturating_sub(baseline_bytes);
+
+        let mut durations = (0..(*REPETITION_COUNT).max(1))
+            .map(|_| {
+                let time = Instant::now();
+                action();
+                time.elapsed().as_nanos() as u64
+            })
+            .collect::<Vec<_>>();
+        durations.sort_unstable();
+
+        let p50_ns = percentile(&durations, 50);
+        let speed = ((source.len() as u128) * 1_000_000 / u128::from(p50_ns.max(1))) as usize;
+        eprintln!(
+            "time {:>7.2} ms\t\tspeed {speed:>6} bytes/ms\t\tpeak memory {:>6} KiB",
+            (p50_ns as f64) / 1e6,
+            peak_allocated_bytes / 1024,
+        );
+
+        self.results.push(BenchmarkResult {
+            language: language.to_string(),
+            benchmark: benchmark.to_string(),
+            example: path.file_name().unwrap().to_str().unwrap().to_string(),
+            bytes: source.len(),
+            min_ns: durations[0],
+            p50_ns,
+            p90_ns: percentile(&durations, 90),
+            p99_ns: percentile(&durations, 99),
+            max_ns: durations[durations.len() - 1],
+            peak_allocated_bytes,
+        });
+        speed
+    }
+}
+
+// Report every benchmark whose median duration has increased by more than
+// `REGRESSION_THRESHOLD` percent. Returns true if there were any regressions.
+fn compare_with_baseline(report: &BenchmarkReport, path: &Path) -> bool {
+    let baseline = fs::read_to_string(path)
+        .with_context(|| format!("Failed to read {path:?}"))
+        .unwrap();
+    let baseline: BenchmarkReport = serde_json::from_str(&baseline)
+        .with_context(|| format!("Failed to parse {path:?}"))
+        .unwrap();
+    let baseline_durations = baseline
+        .results
+        .iter()
+        .map(|r| ((&r.language, &r.benchmark, &r.example), r.p50_ns))
+        .collect::<HashMap<_, _>>();
+
+    let mut regression_count = 0;
+    for result in &report.results {
+        let key = (&result.language, &result.benchmark, &result.example);
+        if let Some(&baseline_ns) = baseline_durations.get(&key) {
+            let change = (result.p50_ns as f64 / baseline_ns.max(1) as f64 - 1.0) * 100.0;
+            if change > *REGRESSION_THRESHOLD {
+                if regression_count == 0 {
+                    eprintln!("Regressions compared to {path:?}:");
+                }
+                regression_count += 1;
+                eprintln!(
+                    "  {} {} {}: {:.3} ms -> {:.3} ms (+{change:.1}%)",
+                    result.language,
+                    result.benchmark,
+                    result.example,
+                    (baseline_ns as f64) / 1e6,
+                    (result.p50_ns as f64) / 1e6,
+                );
+            }
+        }
+    }
+
+    if regression_count == 0 {
+        eprintln!("No regressions compared to {path:?}");
+    }
+    regression_count > 0
 }
 
 fn aggregate(speeds: &[usize]) -> Option<(usize, usize)> {
@@ -185,34 +550,202 @@ fn aggregate(speeds: &[usize]) -> Option<(usize, usize)> {
     Some((total / speeds.len(), max))
 }
 
-fn parse(path: &Path, max_path_length: usize, mut action: impl FnMut(&[u8])) -> usize {
-    eprint!(
-        "    {:width$}\t",
-        path.file_name().unwrap().to_str().unwrap(),
-        width = max_path_length
-    );
+// Compute a nearest-rank percentile of some sorted durations.
+fn percentile(sorted_durations: &[u64], percent: usize) -> u64 {
+    let rank = (sorted_durations.len() * percent).div_ceil(100);
+    sorted_durations[rank.saturating_sub(1)]
+}
 
-    let source_code = fs::read(path)
-        .with_context(|| format!("Failed to read {path:?}"))
-        .unwrap();
-    let time = Instant::now();
-    for _ in 0..*REPETITION_COUNT {
-        action(&source_code);
-    }
-    let duration = time.elapsed() / (*REPETITION_COUNT as u32);
-    let duration_ns = duration.as_nanos();
-    let speed = ((source_code.len() as u128) * 1_000_000) / duration_ns;
-    eprintln!(
-        "time {:>7.2} ms\t\tspeed {speed:>6} bytes/ms",
-        (duration_ns as f64) / 1e6,
-    );
-    speed as usize
+fn read_files(paths: &[PathBuf]) -> Vec<(PathBuf, Vec<u8>)> {
+    paths
+        .iter()
+        .filter(|path| {
+            EXAMPLE_FILTER.as_ref().map_or(true, |filter| {
+                path.to_str().unwrap().contains(filter.as_str())
+            })
+        })
+        .map(|path| {
+            let source = fs::read(path)
+                .with_context(|| format!("Failed to read {path:?}"))
+                .unwrap();
+            (path.clone(), source)
+        })
+        .collect()
+}
+
+fn find_query<'a>(queries: &'a [(PathBuf, Vec<u8>)], name: &str) -> Option<&'a str> {
+    queries
+        .iter()
+        .find(|(path, _)| path.file_name().unwrap() == name)
+        .map(|(_, source)| str::from_utf8(source).unwrap())
+}
+
+// Remove up to `count` bytes from the middle of the source, returning the new source
+// and the corresponding edit.
+fn remove_middle_bytes(source: &[u8], count: usize) -> (Vec<u8>, InputEdit) {
+    let is_char_boundary = |i: usize| i >= source.len() || (source[i] & 0xC0) != 0x80;
+    let mut start = source.len() / 2;
+    while !is_char_boundary(start) {
+        start += 1;
+    }
+    let mut end = (start + count).min(source.len());
+    while !is_char_boundary(end) {
+        end += 1;
+    }
+
+    let mut edited_source = source[..start].to_vec();
+    edited_source.extend_from_slice(&source[end..]);
+    let start_position = point_at(source, start);
+    let edit = InputEdit {
+        start_byte: start,
+        old_end_byte: end,
+        new_end_byte: start,
+        start_position,
+        old_end_position: point_at(source, end),
+        new_end_position: start_position,
+    };
+    (edited_source, edit)
+}
+
+fn point_at(source: &[u8], offset: usize) -> Point {
+    let preceding = &source[..offset];
+    let row = preceding.iter().filter(|&&c| c == b'\n').count();
+    let column = preceding
+        .iter()
+        .rposition(|&c| c == b'\n')
+        .map_or(offset, |i| offset - i - 1);
+    Point::new(row, column)
+}
+
+// Visit every node in the tree, returning the number of nodes.
+fn walk_tree(tree: &Tree) -> usize {
+    let mut cursor = tree.walk();
+    let mut count = 1;
+    loop {
+        if cursor.goto_first_child() || cursor.goto_next_sibling() {
+            count += 1;
+            continue;
+        }
+        loop {
+            if !cursor.goto_parent() {
+                return count;
+            }
+            if cursor.goto_next_sibling() {
+                count += 1;
+                break;
+            }
+        }
+    }
+}
+
+fn record_allocation(size: usize) {
+    let total = ALLOCATED_BYTES.fetch_add(size, Ordering::Relaxed) + size;
+    PEAK_ALLOCATED_BYTES.fetch_max(total, Ordering::Relaxed);
+}
+
+unsafe extern "C" fn counting_malloc(size: usize) -> *mut c_void {
+    let ptr = malloc(size + ALLOCATION_HEADER_SIZE).cast::<usize>();
+    if ptr.is_null() {
+        return ptr.cast();
+    }
+    *ptr = size;
+    record_allocation(size);
+    ptr.cast::<u8>().add(ALLOCATION_HEADER_SIZE).cast()
+}
+
+unsafe extern "C" fn counting_calloc(count: usize, size: usize) -> *mut c_void {
+    let size = count * size;
+    let ptr = calloc(1, size + ALLOCATION_HEADER_SIZE).cast::<usize>();
+    if ptr.is_null() {
+        return ptr.cast();
+    }
+    *ptr = size;
+    record_allocation(size);
+    ptr.cast::<u8>().add(ALLOCATION_HEADER_SIZE).cast()
+}
+
+unsafe extern "C" fn counting_realloc(ptr: *mut c_void, size: usize) -> *mut c_void {
+    if ptr.is_null() {
+        return counting_malloc(size);
+    }
+    let header = ptr.cast::<u8>().sub(ALLOCATION_HEADER_SIZE).cast::<usize>();
+    let old_size = *header;
+    let header = realloc(header.cast(), size + ALLOCATION_HEADER_SIZE).cast::<usize>();
+    if header.is_null() {
+        return header.cast();
+    }
+    *header = size;
+    ALLOCATED_BYTES.fetch_sub(old_size, Ordering::Relaxed);
+    record_allocation(size);
+    header.cast::<u8>().add(ALLOCATION_HEADER_SIZE).cast()
+}
+
+unsafe extern "C" fn counting_free(ptr: *mut c_void) {
+    if ptr.is_null() {
+        return;
+    }
+    let header = ptr.cast::<u8>().sub(ALLOCATION_HEADER_SIZE).cast::<usize>();
+    ALLOCATED_BYTES.fetch_sub(*header, Ordering::Relaxed);
+    free(header.cast());
 }
 
 fn get_language(path: &Path) -> Language {
     let src_path = GRAMMARS_DIR.join(path).join("src");
+    if *TABLE_LEXER {
+        return get_table_lexer_language(path, &src_path);
+    }
     TEST_LOADER
         .load_language_at_path(CompileConfig::new(&src_path, None, None))
         .with_context(|| format!("Failed to load language at path {src_path:?}"))
         .unwrap()
 }
+
+// Regenerate a grammar's parser with a table-driven lexer, in a scratch directory
+// that shadows the grammar's own `src` directory, so that its external scanner
+// can still find its headers.
+fn get_table_lexer_language(path: &Path, src_path: &Path) -> Language {
+    let grammar_json = fs::read_to_string(src_path.join("grammar.json"))
+        .with_context(|| format!("Failed to read the grammar in {src_path:?}"))
+        .unwrap();
+    let (_, parser_code) = generate::generate_parser_for_grammar_with_table_lexer(&grammar_json)
+        .with_context(|| format!("Failed to generate the grammar in {src_path:?}"))
+        .unwrap();
+
+    let table_src_path = SCRATCH_DIR.join("table-lexer").join(path).join("src");
+    let header_path = table_src_path.join("tree_sitter");
+    fs::create_dir_all(&header_path).unwrap();
+    let mut files = vec![
+        (table_src_path.join("grammar.json"), grammar_json),
+        (table_src_path.join("parser.c"), parser_code),
+        (
+            header_path.join("alloc.h"),
+            generate::ALLOC_HEADER.to_string(),
+        ),
+        (
+            header_path.join("array.h"),
+            tree_sitter::ARRAY_HEADER.to_string(),
+        ),
+        (
+            header_path.join("parser.h"),
+            tree_sitter::PARSER_HEADER.to_string(),
+        ),
+    ];
+    if let Some(scanner_path) = TABLE_LEXER_LOADER.get_scanner_path(src_path) {
+        files.push((
+            table_src_path.join(scanner_path.file_name().unwrap()),
+            fs::read_to_string(&scanner_path).unwrap(),
+        ));
+    }
+    for (file_path, contents) in files {
+        if fs::read_to_string(&file_path).map_or(true, |existing| existing != contents) {
+            fs::write(&file_path, contents).unwrap();
+        }
+    }
+
+    let mut config = CompileConfig::new(&table_src_path, None, None);
+    config.header_paths.push(src_path);
+    TABLE_LEXER_LOADER
+        .load_language_at_path(config)
+        .with_context(|| format!("Failed to load language at path {table_src_path:?}"))
+        .unwrap()
+}
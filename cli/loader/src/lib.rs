@@ -1,20 +1,22 @@
 #![doc = include_str!("../README.md")]
 
+use std::collections::hash_map::DefaultHasher;
 use std::collections::HashMap;
 use std::ffi::{OsStr, OsString};
+use std::hash::{Hash, Hasher};
 use std::io::{BufRead, BufReader};
 use std::ops::Range;
 use std::path::{Path, PathBuf};
 use std::process::Command;
+use std::sync::atomic::{AtomicUsize, Ordering};
 use std::sync::Mutex;
-use std::time::SystemTime;
-use std::{env, fs, mem};
+use std::{env, fs, mem, thread};
 
 use anyhow::{anyhow, Context, Error, Result};
 use fs4::FileExt;
 use indoc::indoc;
 use libloading::{Library, Symbol};
-use once_cell::unsync::OnceCell;
+use once_cell::sync::OnceCell;
 use regex::{Regex, RegexBuilder};
 use serde::{Deserialize, Deserializer, Serialize};
 use tree_sitter::{Language, QueryError, QueryErrorKind};
@@ -277,14 +279,10 @@ impl Loader {
             })
     }
 
-    pub fn language_configuration_for_file_name(
-        &self,
-        path: &Path,
-    ) -> Result<Option<(Language, &LanguageConfiguration)>> {
-        // Find all the language configurations that match this file name
-        // or a suffix of the file name.
-        let configuration_ids = path
-            .file_name()
+    // Find all the language configurations that match this file name
+    // or a suffix of the file name.
+    fn language_configuration_ids_for_file_name(&self, path: &Path) -> Option<&Vec<usize>> {
+        path.file_name()
             .and_then(|n| n.to_str())
             .and_then(|file_name| self.language_configuration_ids_by_file_type.get(file_name))
             .or_else(|| {
@@ -293,9 +291,53 @@ impl Loader {
                     .and_then(|extension| {
                         self.language_configuration_ids_by_file_type.get(extension)
                     })
-            });
+            })
+    }
+
+    /// Load the languages for all of the given files ahead of time. Languages that
+    /// need to be compiled are compiled in parallel, with one thread for each
+    /// available core. Files whose language can't be determined from their name
+    /// are skipped. If several languages match a file name, all of them are loaded.
+    pub fn preload_languages_for_paths(&self, paths: &[impl AsRef<Path>]) -> Result<()> {
+        let mut language_ids = paths
+            .iter()
+            .filter_map(|path| self.language_configuration_ids_for_file_name(path.as_ref()))
+            .flatten()
+            .map(|id| self.language_configurations[*id].language_id)
+            .filter(|id| self.languages_by_id[*id].1.get().is_none())
+            .collect::<Vec<_>>();
+        language_ids.sort_unstable();
+        language_ids.dedup();
+
+        let thread_count = thread::available_parallelism()
+            .map_or(1, usize::from)
+            .min(language_ids.len());
+        let next_index = AtomicUsize::new(0);
+        thread::scope(|scope| {
+            let handles = (0..thread_count)
+                .map(|_| {
+                    scope.spawn(|| -> Result<()> {
+                        loop {
+                            let index = next_index.fetch_add(1, Ordering::Relaxed);
+                            let Some(id) = language_ids.get(index) else {
+                                return Ok(());
+                            };
+                            self.language_for_id(*id)?;
+                        }
+                    })
+                })
+                .collect::<Vec<_>>();
+            handles
+                .into_iter()
+                .try_for_each(|handle| handle.join().unwrap())
+        })
+    }
 
-        if let Some(configuration_ids) = configuration_ids {
+    pub fn language_configuration_for_file_name(
+        &self,
+        path: &Path,
+    ) -> Result<Option<(Language, &LanguageConfiguration)>> {
+        if let Some(configuration_ids) = self.language_configuration_ids_for_file_name(path) {
             if !configuration_ids.is_empty() {
                 let configuration = if configuration_ids.len() == 1 {
                     &self.language_configurations[configuration_ids[0]]
@@ -416,31 +458,10 @@ impl Loader {
     }
 
     pub fn load_language_at_path_with_name(&self, mut config: CompileConfig) -> Result<Language> {
-        let mut lib_name = config.name.to_string();
         let language_fn_name = format!(
             "tree_sitter_{}",
             replace_dashes_with_underscores(&config.name)
         );
-        if self.debug_build {
-            lib_name.push_str(".debug._");
-        }
-
-        if config.output_path.is_none() {
-            fs::create_dir_all(&self.parser_lib_path)?;
-        }
-
-        let mut recompile = config.output_path.is_some(); // if specified, always recompile
-
-        let output_path = config.output_path.unwrap_or_else(|| {
-            let mut path = self.parser_lib_path.join(lib_name);
-            path.set_extension(env::consts::DLL_EXTENSION);
-            #[cfg(feature = "wasm")]
-            if self.wasm_store.lock().unwrap().is_some() {
-                path.set_extension("wasm");
-            }
-            path
-        });
-        config.output_path = Some(output_path.clone());
 
         let parser_path = config.src_path.join("parser.c");
         config.scanner_path = self.get_scanner_path(config.src_path);
@@ -459,10 +480,32 @@ impl Loader {
                 .map(|p| config.src_path.join(p)),
         );
 
-        if !recompile {
-            recompile = needs_recompile(&output_path, &paths_to_check)
-                .with_context(|| "Failed to compare source and binary timestamps")?;
-        }
+        // Unless an output path is specified, libraries are cached in the parser
+        // library directory under a name that includes a hash of everything that
+        // they are built from. A cached library never needs to be rebuilt, so the
+        // directory can be shared between checkouts and machines.
+        let recompile;
+        let output_path = if let Some(output_path) = config.output_path.take() {
+            recompile = true;
+            output_path
+        } else {
+            fs::create_dir_all(&self.parser_lib_path)?;
+            let cache_key = self
+                .library_cache_key(&config, &paths_to_check)
+                .with_context(|| "Failed to read the parser's source files")?;
+            let mut lib_name = format!("{}-{cache_key:016x}", config.name);
+            if self.debug_build {
+                lib_name.push_str(".debug._");
+            }
+            let mut path = self.parser_lib_path.join(lib_name);
+            path.set_extension(env::consts::DLL_EXTENSION);
+            #[cfg(feature = "wasm")]
+            if self.wasm_store.lock().unwrap().is_some() {
+                path.set_extension("wasm");
+            }
+            recompile = !path.exists();
+            path
+        };
 
         #[cfg(feature = "wasm")]
         if let Some(wasm_store) = self.wasm_store.lock().unwrap().as_mut() {
@@ -483,25 +526,49 @@ impl Loader {
             return Ok(wasm_store.load_language(&config.name, &wasm_bytes)?);
         }
 
-        let lock_path = if env::var("CROSS_RUNNER").is_ok() {
-            PathBuf::from("/tmp")
-                .join("tree-sitter")
-                .join("lock")
-                .join(format!("{}.lock", config.name))
+        if recompile {
+            self.compile_parser_to_dylib_with_lock(&mut config, &output_path)?;
+        }
+
+        let library = unsafe { Library::new(&output_path) }
+            .with_context(|| format!("Error opening dynamic library {output_path:?}"))?;
+        let language = unsafe {
+            let language_fn = library
+                .get::<Symbol<unsafe extern "C" fn() -> Language>>(language_fn_name.as_bytes())
+                .with_context(|| format!("Failed to load symbol {language_fn_name}"))?;
+            language_fn()
+        };
+        mem::forget(library);
+        Ok(language)
+    }
+
+    // Compile the parser to the given path, unless another thread or process is
+    // already doing so, in which case wait for it to finish. The library is
+    // compiled to a temporary path and then moved into place, so that a library
+    // that is still being written is never loaded.
+    fn compile_parser_to_dylib_with_lock(
+        &self,
+        config: &mut CompileConfig,
+        output_path: &Path,
+    ) -> Result<()> {
+        let lock_dir = if env::var("CROSS_RUNNER").is_ok() {
+            PathBuf::from("/tmp").join("tree-sitter").join("lock")
         } else {
             dirs::cache_dir()
                 .ok_or_else(|| anyhow!("Cannot determine cache directory"))?
                 .join("tree-sitter")
                 .join("lock")
-                .join(format!("{}.lock", config.name))
         };
+        let mut lock_name = output_path.file_name().unwrap().to_os_string();
+        lock_name.push(".lock");
+        let lock_path = lock_dir.join(lock_name);
 
+        let mut recompile = true;
         if let Ok(lock_file) = fs::OpenOptions::new().write(true).open(&lock_path) {
             recompile = false;
             if lock_file.try_lock_exclusive().is_err() {
                 // if we can't acquire the lock, another process is compiling the parser, wait for it and don't recompile
                 lock_file.lock_exclusive()?;
-                recompile = false;
             } else {
                 // if we can acquire the lock, check if the lock file is older than 30 seconds, a
                 // run that was interrupted and left the lock file behind should not block
@@ -515,12 +582,8 @@ impl Loader {
         }
 
         if recompile {
-            fs::create_dir_all(lock_path.parent().unwrap()).with_context(|| {
-                format!(
-                    "Failed to create directory {:?}",
-                    lock_path.parent().unwrap()
-                )
-            })?;
+            fs::create_dir_all(&lock_dir)
+                .with_context(|| format!("Failed to create directory {lock_dir:?}"))?;
             let lock_file = fs::OpenOptions::new()
                 .create(true)
                 .truncate(true)
@@ -528,31 +591,37 @@ impl Loader {
                 .open(&lock_path)?;
             lock_file.lock_exclusive()?;
 
-            self.compile_parser_to_dylib(&config, &lock_file, &lock_path)?;
+            let mut temp_name = output_path.file_name().unwrap().to_os_string();
+            temp_name.push(format!(".{}.tmp", std::process::id()));
+            let temp_path = output_path.with_file_name(temp_name);
+            config.output_path = Some(temp_path.clone());
 
-            if config.scanner_path.is_some() {
-                self.check_external_scanner(&config.name, &output_path)?;
+            let result = self
+                .compile_parser_to_dylib(config)
+                .and_then(|()| {
+                    if config.scanner_path.is_some() {
+                        self.check_external_scanner(&config.name, &temp_path)?;
+                    }
+                    Ok(())
+                })
+                .and_then(|()| {
+                    fs::rename(&temp_path, output_path).with_context(|| {
+                        format!("Failed to move the compiled parser to {output_path:?}")
+                    })
+                });
+            if result.is_err() {
+                fs::remove_file(&temp_path).ok();
             }
+
+            lock_file.unlock()?;
+            fs::remove_file(&lock_path)?;
+            result?;
         }
 
-        let library = unsafe { Library::new(&output_path) }
-            .with_context(|| format!("Error opening dynamic library {output_path:?}"))?;
-        let language = unsafe {
-            let language_fn = library
-                .get::<Symbol<unsafe extern "C" fn() -> Language>>(language_fn_name.as_bytes())
-                .with_context(|| format!("Failed to load symbol {language_fn_name}"))?;
-            language_fn()
-        };
-        mem::forget(library);
-        Ok(language)
+        Ok(())
     }
 
-    fn compile_parser_to_dylib(
-        &self,
-        config: &CompileConfig,
-        lock_file: &fs::File,
-        lock_path: &Path,
-    ) -> Result<(), Error> {
+    fn c_compiler() -> cc::Tool {
         let mut cc = cc::Build::new();
         cc.cpp(true)
             .opt_level(2)
@@ -561,7 +630,52 @@ impl Loader {
             .target(BUILD_TARGET)
             .host(BUILD_TARGET)
             .flag_if_supported("-Werror=implicit-function-declaration");
-        let compiler = cc.get_compiler();
+        cc.get_compiler()
+    }
+
+    // Compute a hash of everything that a parser library is built from: the
+    // contents of its source files and headers, the compiler and its options,
+    // and the version of the loader.
+    fn library_cache_key(&self, config: &CompileConfig, source_paths: &[PathBuf]) -> Result<u64> {
+        let mut hasher = DefaultHasher::new();
+        env!("CARGO_PKG_VERSION").hash(&mut hasher);
+        BUILD_TARGET.hash(&mut hasher);
+        self.debug_build.hash(&mut hasher);
+        config.flags.hash(&mut hasher);
+
+        let mut header_paths = Vec::new();
+        for dir in config
+            .header_paths
+            .iter()
+            .copied()
+            .chain([config.src_path.join("tree_sitter").as_path()])
+        {
+            if let Ok(entries) = fs::read_dir(dir) {
+                let start = header_paths.len();
+                header_paths.extend(
+                    entries
+                        .filter_map(|entry| Some(entry.ok()?.path()))
+                        .filter(|path| path.extension() == Some("h".as_ref())),
+                );
+                header_paths[start..].sort_unstable();
+            }
+        }
+        for path in source_paths.iter().chain(&header_paths) {
+            path.file_name().hash(&mut hasher);
+            fs::read(path)
+                .with_context(|| format!("Failed to read {path:?}"))?
+                .hash(&mut hasher);
+        }
+
+        let compiler = Self::c_compiler();
+        compiler.path().hash(&mut hasher);
+        compiler.args().hash(&mut hasher);
+        compiler.env().hash(&mut hasher);
+        Ok(hasher.finish())
+    }
+
+    fn compile_parser_to_dylib(&self, config: &CompileConfig) -> Result<(), Error> {
+        let compiler = Self::c_compiler();
         let mut command = Command::new(compiler.path());
         for (key, value) in compiler.env() {
             command.env(key, value);
@@ -639,9 +753,6 @@ impl Loader {
             format!("Failed to execute the C compiler with the following command:\n{command:?}")
         })?;
 
-        lock_file.unlock()?;
-        fs::remove_file(lock_path)?;
-
         if !output.status.success() {
             return Err(anyhow!(
                 "Parser compilation failed.\nStdout: {}\nStderr: {}",
@@ -1367,24 +1478,6 @@ impl<'a> LanguageConfiguration<'a> {
     }
 }
 
-fn needs_recompile(lib_path: &Path, paths_to_check: &[PathBuf]) -> Result<bool> {
-    if !lib_path.exists() {
-        return Ok(true);
-    }
-    let lib_mtime =
-        mtime(lib_path).with_context(|| format!("Failed to read mtime of {lib_path:?}"))?;
-    for path in paths_to_check {
-        if mtime(path)? > lib_mtime {
-            return Ok(true);
-        }
-    }
-    Ok(false)
-}
-
-fn mtime(path: &Path) -> Result<SystemTime> {
-    Ok(fs::metadata(path)?.modified()?)
-}
-
 fn replace_dashes_with_underscores(name: &str) -> String {
     let mut result = String::with_capacity(name.len());
     for c in name.chars() {
@@ -5,6 +5,7 @@ use crate::generate::grammars::{
     InlinedProductionMap, LexicalGrammar, SyntaxGrammar, VariableType,
 };
 use crate::generate::node_types::VariableInfo;
+use crate::generate::parallel;
 use crate::generate::rules::{Associativity, Precedence, Symbol, SymbolType, TokenSet};
 use crate::generate::tables::{
     FieldLocation, GotoAction, ParseAction, ParseState, ParseStateId, ParseTable, ParseTableEntry,
@@ -25,6 +26,11 @@ use rustc_hash::FxHasher;
 type SymbolSequence = Vec<Symbol>;
 
 type AuxiliarySymbolSequence = Vec<AuxiliarySymbolInfo>;
+
+// The maximum number of queued parse states whose item set closures are
+// computed at the same time. This bounds the memory used for closures that
+// are waiting for their actions to be added.
+const MAX_CLOSURE_BATCH_LEN: usize = 1024;
 pub type ParseStateInfo<'a> = (SymbolSequence, ParseItemSet<'a>);
 
 #[derive(Clone)]
@@ -115,17 +121,30 @@ impl<'a> ParseTableBuilder<'a> {
             self.add_parse_state(&Vec::new(), &Vec::new(), item_set);
         }
 
-        while let Some(entry) = self.parse_state_queue.pop_front() {
-            let item_set = self
-                .item_set_builder
-                .transitive_closure(&self.parse_state_info_by_id[entry.state_id].1);
-
-            self.add_actions(
-                self.parse_state_info_by_id[entry.state_id].0.clone(),
-                entry.preceding_auxiliary_symbols,
-                entry.state_id,
-                &item_set,
-            )?;
+        // Computing the transitive closure of each state's item set is the most
+        // expensive part of this process, and it doesn't depend on any other state,
+        // so the closures for a batch of queued states are computed in parallel.
+        // The states' actions are still added sequentially and in queue order, so
+        // the resulting table doesn't depend on the number of threads.
+        while !self.parse_state_queue.is_empty() {
+            let batch_len = self.parse_state_queue.len().min(MAX_CLOSURE_BATCH_LEN);
+            let entries = self
+                .parse_state_queue
+                .drain(..batch_len)
+                .collect::<Vec<_>>();
+            let item_sets = parallel::map(&entries, 4, |entry| {
+                self.item_set_builder
+                    .transitive_closure(&self.parse_state_info_by_id[entry.state_id].1)
+            });
+
+            for (entry, item_set) in entries.into_iter().zip(item_sets) {
+                self.add_actions(
+                    self.parse_state_info_by_id[entry.state_id].0.clone(),
+                    entry.preceding_auxiliary_symbols,
+                    entry.state_id,
+                    &item_set,
+                )?;
+            }
         }
 
         if !self.actual_conflicts.is_empty() {
@@ -1,5 +1,6 @@
 use super::item::{ParseItem, ParseItemDisplay, ParseItemSet, TokenSetDisplay};
 use crate::generate::grammars::{InlinedProductionMap, LexicalGrammar, SyntaxGrammar};
+use crate::generate::parallel;
 use crate::generate::rules::{Symbol, SymbolType, TokenSet};
 use std::collections::{HashMap, HashSet};
 use std::fmt;
@@ -138,101 +139,19 @@ impl<'a> ParseItemSetBuilder<'a> {
         //
         // Again, rather than computing these additions recursively, we use an explicit
         // stack called `entries_to_process`.
-        for i in 0..syntax_grammar.variables.len() {
-            let empty_lookaheads = TokenSet::new();
-            let mut entries_to_process = vec![(i, &empty_lookaheads, true)];
-
-            // First, build up a map whose keys are all of the non-terminals that can
-            // appear at the beginning of non-terminal `i`, and whose values store
-            // information about the tokens that can follow each non-terminal.
-            let mut follow_set_info_by_non_terminal = HashMap::new();
-            while let Some(entry) = entries_to_process.pop() {
-                let (variable_index, lookaheads, propagates_lookaheads) = entry;
-                let existing_info = follow_set_info_by_non_terminal
-                    .entry(variable_index)
-                    .or_insert_with(|| FollowSetInfo {
-                        lookaheads: TokenSet::new(),
-                        propagates_lookaheads: false,
-                    });
-
-                let did_add_follow_set_info;
-                if propagates_lookaheads {
-                    did_add_follow_set_info = !existing_info.propagates_lookaheads;
-                    existing_info.propagates_lookaheads = true;
-                } else {
-                    did_add_follow_set_info = existing_info.lookaheads.insert_all(lookaheads);
-                }
-
-                if did_add_follow_set_info {
-                    for production in &syntax_grammar.variables[variable_index].productions {
-                        if let Some(symbol) = production.first_symbol() {
-                            if symbol.is_non_terminal() {
-                                if production.steps.len() == 1 {
-                                    entries_to_process.push((
-                                        symbol.index,
-                                        lookaheads,
-                                        propagates_lookaheads,
-                                    ));
-                                } else {
-                                    entries_to_process.push((
-                                        symbol.index,
-                                        &result.first_sets[&production.steps[1].symbol],
-                                        false,
-                                    ));
-                                }
-                            }
-                        }
-                    }
-                }
-            }
-
-            // Store all of those non-terminals' productions, along with their associated
-            // lookahead info, as *additions* associated with non-terminal `i`.
-            let additions_for_non_terminal = &mut result.transitive_closure_additions[i];
-            for (variable_index, follow_set_info) in follow_set_info_by_non_terminal {
-                let variable = &syntax_grammar.variables[variable_index];
-                let non_terminal = Symbol::non_terminal(variable_index);
-                let variable_index = variable_index as u32;
-                if syntax_grammar.variables_to_inline.contains(&non_terminal) {
-                    continue;
-                }
-                for production in &variable.productions {
-                    let item = ParseItem {
-                        variable_index,
-                        production,
-                        step_index: 0,
-                        has_preceding_inherited_fields: false,
-                    };
-
-                    if let Some(inlined_productions) =
-                        inlines.inlined_productions(item.production, item.step_index)
-                    {
-                        for production in inlined_productions {
-                            find_or_push(
-                                additions_for_non_terminal,
-                                TransitiveClosureAddition {
-                                    item: item.substitute_production(production),
-                                    info: follow_set_info.clone(),
-                                },
-                            );
-                        }
-                    } else {
-                        find_or_push(
-                            additions_for_non_terminal,
-                            TransitiveClosureAddition {
-                                item,
-                                info: follow_set_info.clone(),
-                            },
-                        );
-                    }
-                }
-            }
-        }
+        //
+        // The additions for each non-terminal are independent of each other, so they
+        // are computed in parallel.
+        let variable_indices = (0..syntax_grammar.variables.len()).collect::<Vec<_>>();
+        let transitive_closure_additions = parallel::map(&variable_indices, 16, |i| {
+            result.compute_transitive_closure_additions(*i)
+        });
+        result.transitive_closure_additions = transitive_closure_additions;
 
         result
     }
 
-    pub fn transitive_closure(&mut self, item_set: &ParseItemSet<'a>) -> ParseItemSet<'a> {
+    pub fn transitive_closure(&self, item_set: &ParseItemSet<'a>) -> ParseItemSet<'a> {
         let mut result = ParseItemSet::default();
         for (item, lookaheads) in &item_set.entries {
             if let Some(productions) = self
@@ -253,6 +172,103 @@ impl<'a> ParseItemSetBuilder<'a> {
         result
     }
 
+    fn compute_transitive_closure_additions(&self, i: usize) -> Vec<TransitiveClosureAddition<'a>> {
+        let empty_lookaheads = TokenSet::new();
+        let mut entries_to_process = vec![(i, &empty_lookaheads, true)];
+
+        // First, build up a map whose keys are all of the non-terminals that can
+        // appear at the beginning of non-terminal `i`, and whose values store
+        // information about the tokens that can follow each non-terminal.
+        let mut follow_set_info_by_non_terminal = HashMap::new();
+        while let Some(entry) = entries_to_process.pop() {
+            let (variable_index, lookaheads, propagates_lookaheads) = entry;
+            let existing_info = follow_set_info_by_non_terminal
+                .entry(variable_index)
+                .or_insert_with(|| FollowSetInfo {
+                    lookaheads: TokenSet::new(),
+                    propagates_lookaheads: false,
+                });
+
+            let did_add_follow_set_info;
+            if propagates_lookaheads {
+                did_add_follow_set_info = !existing_info.propagates_lookaheads;
+                existing_info.propagates_lookaheads = true;
+            } else {
+                did_add_follow_set_info = existing_info.lookaheads.insert_all(lookaheads);
+            }
+
+            if did_add_follow_set_info {
+                for production in &self.syntax_grammar.variables[variable_index].productions {
+                    if let Some(symbol) = production.first_symbol() {
+                        if symbol.is_non_terminal() {
+                            if production.steps.len() == 1 {
+                                entries_to_process.push((
+                                    symbol.index,
+                                    lookaheads,
+                                    propagates_lookaheads,
+                                ));
+                            } else {
+                                entries_to_process.push((
+                                    symbol.index,
+                                    &self.first_sets[&production.steps[1].symbol],
+                                    false,
+                                ));
+                            }
+                        }
+                    }
+                }
+            }
+        }
+
+        // Store all of those non-terminals' productions, along with their associated
+        // lookahead info, as *additions* associated with non-terminal `i`.
+        let mut additions_for_non_terminal = Vec::new();
+        for (variable_index, follow_set_info) in follow_set_info_by_non_terminal {
+            let variable = &self.syntax_grammar.variables[variable_index];
+            let non_terminal = Symbol::non_terminal(variable_index);
+            let variable_index = variable_index as u32;
+            if self
+                .syntax_grammar
+                .variables_to_inline
+                .contains(&non_terminal)
+            {
+                continue;
+            }
+            for production in &variable.productions {
+                let item = ParseItem {
+                    variable_index,
+                    production,
+                    step_index: 0,
+                    has_preceding_inherited_fields: false,
+                };
+
+                if let Some(inlined_productions) = self
+                    .inlines
+                    .inlined_productions(item.production, item.step_index)
+                {
+                    for production in inlined_productions {
+                        find_or_push(
+                            &mut additions_for_non_terminal,
+                            TransitiveClosureAddition {
+                                item: item.substitute_production(production),
+                                info: follow_set_info.clone(),
+                            },
+                        );
+                    }
+                } else {
+                    find_or_push(
+                        &mut additions_for_non_terminal,
+                        TransitiveClosureAddition {
+                            item,
+                            info: follow_set_info.clone(),
+                        },
+                    );
+                }
+            }
+        }
+        additions_for_non_terminal
+    }
+
     pub fn first_set(&self, symbol: &Symbol) -> &TokenSet {
         &self.first_sets[symbol]
     }
@@ -11,6 +11,7 @@ use self::build_parse_table::{build_parse_table, ParseStateInfo};
 use self::coincident_tokens::CoincidentTokenIndex;
 use self::minimize_parse_table::minimize_parse_table;
 use self::token_conflicts::TokenConflictMap;
+use crate::generate::cache::TokenConflictCache;
 use crate::generate::grammars::{InlinedProductionMap, LexicalGrammar, SyntaxGrammar};
 use crate::generate::nfa::NfaCursor;
 use crate::generate::node_types::VariableInfo;
@@ -27,10 +28,16 @@ pub fn build_tables(
     variable_info: &[VariableInfo],
     inlines: &InlinedProductionMap,
     report_symbol_name: Option<&str>,
+    token_conflict_cache: &mut Option<TokenConflictCache>,
 ) -> Result<(ParseTable, LexTable, LexTable, Option<Symbol>)> {
     let (mut parse_table, following_tokens, parse_state_info) =
         build_parse_table(syntax_grammar, lexical_grammar, inlines, variable_info)?;
-    let token_conflict_map = TokenConflictMap::new(lexical_grammar, following_tokens);
+    let token_conflict_map = TokenConflictMap::with_cache(
+        lexical_grammar,
+        following_tokens,
+        token_conflict_cache.as_ref(),
+    );
+    *token_conflict_cache = Some(token_conflict_map.to_cache());
     let coincident_token_index = CoincidentTokenIndex::new(&parse_table, lexical_grammar);
     let keywords = identify_keywords(
         lexical_grammar,
@@ -1,6 +1,8 @@
 use crate::generate::build_tables::item::TokenSetDisplay;
+use crate::generate::cache::{self, TokenConflictCache};
 use crate::generate::grammars::{LexicalGrammar, SyntaxGrammar};
 use crate::generate::nfa::{CharacterSet, NfaCursor, NfaTransition};
+use crate::generate::parallel;
 use crate::generate::rules::TokenSet;
 use std::cmp::Ordering;
 use std::collections::HashSet;
@@ -16,6 +18,28 @@ struct TokenConflictStatus {
     matches_different_string: bool,
 }
 
+impl TokenConflictStatus {
+    fn to_bits(&self) -> u8 {
+        u8::from(self.matches_prefix)
+            | (u8::from(self.does_match_continuation) << 1)
+            | (u8::from(self.does_match_valid_continuation) << 2)
+            | (u8::from(self.does_match_separators) << 3)
+            | (u8::from(self.matches_same_string) << 4)
+            | (u8::from(self.matches_different_string) << 5)
+    }
+
+    const fn from_bits(bits: u8) -> Self {
+        Self {
+            matches_prefix: bits & 1 != 0,
+            does_match_continuation: bits & (1 << 1) != 0,
+            does_match_valid_continuation: bits & (1 << 2) != 0,
+            does_match_separators: bits & (1 << 3) != 0,
+            matches_same_string: bits & (1 << 4) != 0,
+            matches_different_string: bits & (1 << 5) != 0,
+        }
+    }
+}
+
 pub struct TokenConflictMap<'a> {
     n: usize,
     status_matrix: Vec<TokenConflictStatus>,
@@ -33,15 +57,59 @@ impl<'a> TokenConflictMap<'a> {
     /// This analyzes the possible kinds of overlap between each pair of tokens and stores
     /// them in a matrix.
     pub fn new(grammar: &'a LexicalGrammar, following_tokens: Vec<TokenSet>) -> Self {
+        Self::with_cache(grammar, following_tokens, None)
+    }
+
+    /// Like `new`, but reuse the results from a previous analysis of the same lexical
+    /// grammar for every pair of tokens whose following characters haven't changed.
+    pub fn with_cache(
+        grammar: &'a LexicalGrammar,
+        following_tokens: Vec<TokenSet>,
+        cache: Option<&TokenConflictCache>,
+    ) -> Self {
         let mut cursor = NfaCursor::new(&grammar.nfa, Vec::new());
         let starting_chars = get_starting_chars(&mut cursor, grammar);
         let following_chars = get_following_chars(&starting_chars, &following_tokens);
 
         let n = grammar.variables.len();
+        let following_chars_hashes = following_chars.iter().map(cache::hash).collect::<Vec<_>>();
+        let cache = cache.filter(|cache| {
+            cache.status_matrix.len() == n * n
+                && cache.following_chars_hashes.len() == n
+                && cache.lexical_grammar_hash == cache::hash(grammar)
+        });
+        let cached_status = |i: usize, j: usize| {
+            let cache = cache?;
+            if cache.following_chars_hashes[i] != following_chars_hashes[i]
+                || cache.following_chars_hashes[j] != following_chars_hashes[j]
+            {
+                return None;
+            }
+            Some((
+                TokenConflictStatus::from_bits(cache.status_matrix[matrix_index(n, i, j)]),
+                TokenConflictStatus::from_bits(cache.status_matrix[matrix_index(n, j, i)]),
+            ))
+        };
+
+        // Each pair of tokens is analyzed independently, so the rows of the matrix
+        // are computed in parallel, each thread using its own NFA cursor.
+        let rows = parallel::map_with_state(
+            &(0..n).collect::<Vec<_>>(),
+            4,
+            || NfaCursor::new(&grammar.nfa, Vec::new()),
+            |cursor, &i| {
+                (0..i)
+                    .map(|j| {
+                        cached_status(i, j).unwrap_or_else(|| {
+                            compute_conflict_status(cursor, grammar, &following_chars, i, j)
+                        })
+                    })
+                    .collect::<Vec<_>>()
+            },
+        );
         let mut status_matrix = vec![TokenConflictStatus::default(); n * n];
-        for i in 0..grammar.variables.len() {
-            for j in 0..i {
-                let status = compute_conflict_status(&mut cursor, grammar, &following_chars, i, j);
+        for (i, row) in rows.into_iter().enumerate() {
+            for (j, status) in row.into_iter().enumerate() {
                 status_matrix[matrix_index(n, i, j)] = status.0;
                 status_matrix[matrix_index(n, j, i)] = status.1;
             }
@@ -57,6 +125,23 @@ impl<'a> TokenConflictMap<'a> {
         }
     }
 
+    /// Save the results of this analysis, so that they can be reused by `with_cache`.
+    pub fn to_cache(&self) -> TokenConflictCache {
+        TokenConflictCache {
+            lexical_grammar_hash: cache::hash(self.grammar),
+            following_chars_hashes: self
+                .following_chars_by_index
+                .iter()
+                .map(cache::hash)
+                .collect(),
+            status_matrix: self
+                .status_matrix
+                .iter()
+                .map(TokenConflictStatus::to_bits)
+                .collect(),
+        }
+    }
+
     /// Does token `i` match any strings that token `j` also matches, such that token `i`
     /// is preferred over token `j`?
     pub fn has_same_conflict_status(&self, a: usize, b: usize, other: usize) -> bool {
@@ -462,6 +547,97 @@ mod tests {
         assert!(token_map.does_conflict(var("instanceof"), var("in")));
     }
 
+    #[test]
+    fn test_token_conflicts_with_cache() {
+        let grammar = expand_tokens(ExtractedLexicalGrammar {
+            separators: Vec::new(),
+            variables: vec![
+                Variable {
+                    name: "in".to_string(),
+                    kind: VariableType::Named,
+                    rule: Rule::string("in"),
+                },
+                Variable {
+                    name: "identifier".to_string(),
+                    kind: VariableType::Named,
+                    rule: Rule::pattern("\\w+", ""),
+                },
+                Variable {
+                    name: "instanceof".to_string(),
+                    kind: VariableType::Named,
+                    rule: Rule::string("instanceof"),
+                },
+            ],
+        })
+        .unwrap();
+
+        let var = |name| index_of_var(&grammar, name);
+        let token_set = |name| std::iter::once(Symbol::terminal(var(name))).collect::<TokenSet>();
+
+        let old_following_tokens = vec![token_set("identifier"), token_set("in"), TokenSet::new()];
+        let new_following_tokens = vec![
+            token_set("identifier"),
+            token_set("in"),
+            token_set("identifier"),
+        ];
+
+        let mut cache = TokenConflictMap::new(&grammar, old_following_tokens).to_cache();
+        let expected = TokenConflictMap::new(&grammar, new_following_tokens.clone());
+
+        // Only the pairs of tokens whose following characters are unchanged are reused.
+        let n = grammar.variables.len();
+        let reused_index = matrix_index(n, var("in"), var("identifier"));
+        let recomputed_index = matrix_index(n, var("instanceof"), var("identifier"));
+        cache.status_matrix[reused_index] = 0xff;
+        cache.status_matrix[recomputed_index] = 0xff;
+        let token_map =
+            TokenConflictMap::with_cache(&grammar, new_following_tokens.clone(), Some(&cache));
+        assert_eq!(
+            token_map.status_matrix[reused_index],
+            TokenConflictStatus::from_bits(0xff)
+        );
+        assert_eq!(
+            token_map.status_matrix[recomputed_index],
+            expected.status_matrix[recomputed_index]
+        );
+
+        // A cache for a different lexical grammar is ignored.
+        cache.lexical_grammar_hash ^= 1;
+        let token_map =
+            TokenConflictMap::with_cache(&grammar, new_following_tokens.clone(), Some(&cache));
+        assert_eq!(token_map.status_matrix, expected.status_matrix);
+
+        // Changing a token invalidates the cache, even if the number of tokens
+        // and the characters that can follow each token stay the same.
+        let following_tokens = vec![token_set("in"); 3];
+        let new_grammar = expand_tokens(ExtractedLexicalGrammar {
+            separators: Vec::new(),
+            variables: vec![
+                Variable {
+                    name: "in".to_string(),
+                    kind: VariableType::Named,
+                    rule: Rule::string("in"),
+                },
+                Variable {
+                    name: "identifier".to_string(),
+                    kind: VariableType::Named,
+                    rule: Rule::pattern("[0-9]+", ""),
+                },
+                Variable {
+                    name: "instanceof".to_string(),
+                    kind: VariableType::Named,
+                    rule: Rule::string("instanceof"),
+                },
+            ],
+        })
+        .unwrap();
+        let cache = TokenConflictMap::new(&grammar, following_tokens.clone()).to_cache();
+        let expected = TokenConflictMap::new(&new_grammar, following_tokens.clone());
+        assert_ne!(expected.to_cache().status_matrix, cache.status_matrix);
+        let token_map = TokenConflictMap::with_cache(&new_grammar, following_tokens, Some(&cache));
+        assert_eq!(token_map.status_matrix, expected.status_matrix);
+    }
+
     #[test]
     fn test_token_conflicts_with_separators() {
         let grammar = expand_tokens(ExtractedLexicalGrammar {
@@ -0,0 +1,355 @@
+use std::env;
+use std::fs;
+use std::hash::{Hash, Hasher};
+use std::path::{Path, PathBuf};
+
+use log::info;
+use serde::{Deserialize, Serialize};
+
+use super::grammars::{LexicalGrammar, SyntaxGrammar};
+use super::rules::AliasMap;
+
+/// Information saved from the previous run of `tree-sitter generate` for a
+/// given grammar, which allows unchanged work to be skipped.
+///
+/// The cache is stored outside of the grammar's repository, in the user's
+/// cache directory. It can be disabled by setting the
+/// `TREE_SITTER_GENERATE_CACHE` environment variable to `0`.
+#[derive(Default, Serialize, Deserialize)]
+pub struct GenerationCache {
+    /// The fingerprint of the prepared grammar that the generated files
+    /// were produced from.
+    output_fingerprint: u64,
+    parser_hash: u64,
+    node_types_hash: u64,
+    pub token_conflicts: Option<TokenConflictCache>,
+}
+
+/// The results of the token conflict analysis for a lexical grammar. The
+/// conflict status of each pair of tokens only depends on the lexical grammar
+/// and on the characters that can follow each of the two tokens, so it can
+/// be reused when only the syntax rules of a grammar have changed.
+#[derive(Serialize, Deserialize)]
+pub struct TokenConflictCache {
+    pub lexical_grammar_hash: u64,
+    pub following_chars_hashes: Vec<u64>,
+    pub status_matrix: Vec<u8>,
+}
+
+/// A 64-bit FNV-1a hasher. The hashes in the cache are saved to disk, so unlike
+/// `DefaultHasher`, whose algorithm can change between Rust releases, its output
+/// must be stable.
+struct StableHasher(u64);
+
+impl Default for StableHasher {
+    fn default() -> Self {
+        Self(0xcbf2_9ce4_8422_2325)
+    }
+}
+
+impl Hasher for StableHasher {
+    fn finish(&self) -> u64 {
+        self.0
+    }
+
+    fn write(&mut self, bytes: &[u8]) {
+        for byte in bytes {
+            self.0 = (self.0 ^ u64::from(*byte)).wrapping_mul(0x0000_0100_0000_01b3);
+        }
+    }
+}
+
+pub fn hash<T: Hash + ?Sized>(value: &T) -> u64 {
+    let mut hasher = StableHasher::default();
+    value.hash(&mut hasher);
+    hasher.finish()
+}
+
+/// Compute a fingerprint of everything that the generated files depend on:
+/// the prepared grammar, the requested output options, and the generator itself.
+pub fn output_fingerprint(
+    name: &str,
+    syntax_grammar: &SyntaxGrammar,
+    lexical_grammar: &LexicalGrammar,
+    simple_aliases: &AliasMap,
+    abi_version: usize,
+    compress_tables: bool,
+    table_lexer: bool,
+) -> u64 {
+    let mut simple_aliases = simple_aliases.iter().collect::<Vec<_>>();
+    simple_aliases.sort_unstable();
+
+    let mut hasher = StableHasher::default();
+    generator_fingerprint().hash(&mut hasher);
+    name.hash(&mut hasher);
+    syntax_grammar.hash(&mut hasher);
+    lexical_grammar.hash(&mut hasher);
+    simple_aliases.hash(&mut hasher);
+    abi_version.hash(&mut hasher);
+    compress_tables.hash(&mut hasher);
+    table_lexer.hash(&mut hasher);
+    hasher.finish()
+}
+
+// Development builds of the CLI can change the generator without changing its
+// version, so the fingerprint also includes the modification time of the
+// running executable.
+fn generator_fingerprint() -> (&'static str, Option<&'static str>, Option<u128>) {
+    let modified_time = env::current_exe()
+        .and_then(fs::metadata)
+        .and_then(|metadata| metadata.modified())
+        .ok()
+        .and_then(|time| time.duration_since(std::time::UNIX_EPOCH).ok())
+        .map(|duration| duration.as_nanos());
+    (
+        env!("CARGO_PKG_VERSION"),
+        option_env!("BUILD_SHA"),
+        modified_time,
+    )
+}
+
+impl GenerationCache {
+    /// Get the path of the cache file for the grammar in the given directory.
+    pub fn path(repo_path: &Path) -> Option<PathBuf> {
+        if env::var("TREE_SITTER_GENERATE_CACHE").is_ok_and(|value| value == "0") {
+            return None;
+        }
+        let repo_path = fs::canonicalize(repo_path).ok()?;
+        Some(
+            dirs::cache_dir()?
+                .join("tree-sitter")
+                .join("generate")
+                .join(format!("{:016x}.json", hash(&repo_path))),
+        )
+    }
+
+    /// Load the cache from the given path. A missing or unreadable cache is
+    /// treated as empty.
+    pub fn load(path: Option<&Path>) -> Self {
+        path.and_then(|path| fs::read(path).ok())
+            .and_then(|contents| serde_json::from_slice(&contents).ok())
+            .unwrap_or_default()
+    }
+
+    /// Save the cache to the given path. Failing to save the cache doesn't
+    /// prevent a parser from being generated, so errors are only logged.
+    pub fn save(&self, path: Option<&Path>) {
+        let Some(path) = path else { return };
+        let result = path
+            .parent()
+            .map_or(Ok(()), fs::create_dir_all)
+            .and_then(|()| fs::write(path, serde_json::to_vec(self).unwrap()));
+        if let Err(error) = result {
+            info!("Failed to save the generation cache to {path:?}: {error}");
+        }
+    }
+
+    /// Check whether the generated files in the given directory were produced
+    /// from a grammar with the given fingerprint, and haven't been modified since.
+    pub fn output_is_current(&self, fingerprint: u64, src_path: &Path) -> bool {
+        self.output_fingerprint == fingerprint
+            && file_hash(&src_path.join("parser.c")) == Some(self.parser_hash)
+            && file_hash(&src_path.join("node-types.json")) == Some(self.node_types_hash)
+    }
+
+    pub fn record_output(&mut self, fingerprint: u64, c_code: &str, node_types_json: &str) {
+        self.output_fingerprint = fingerprint;
+        self.parser_hash = hash(c_code.as_bytes());
+        self.node_types_hash = hash(node_types_json.as_bytes());
+    }
+}
+
+fn file_hash(path: &Path) -> Option<u64> {
+    fs::read(path)
+        .ok()
+        .map(|contents| hash(contents.as_slice()))
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::generate::generate_parser_files;
+    use tempfile::TempDir;
+
+    // A grammar whose keyword conflicts with its identifier token.
+    const GRAMMAR: &str = r#"{
+        "name": "cache_test",
+        "word": "identifier",
+        "rules": {
+            "program": {"type": "REPEAT", "content": {"type": "SYMBOL", "name": "statement"}},
+            "statement": {
+                "type": "CHOICE",
+                "members": [
+                    {
+                        "type": "SEQ",
+                        "members": [
+                            {"type": "SYMBOL", "name": "identifier"},
+                            {"type": "STRING", "value": ";"}
+                        ]
+                    },
+                    {
+                        "type": "SEQ",
+                        "members": [
+                            {"type": "STRING", "value": "if"},
+                            {"type": "SYMBOL", "name": "identifier"},
+                            {"type": "STRING", "value": ";"}
+                        ]
+                    }
+                ]
+            },
+            "identifier": {"type": "PATTERN", "value": "[a-z]+"}
+        }
+    }"#;
+
+    struct Generator {
+        dir: TempDir,
+    }
+
+    impl Generator {
+        fn new() -> Self {
+            let dir = tempfile::tempdir().unwrap();
+            fs::create_dir_all(dir.path().join("src")).unwrap();
+            Self { dir }
+        }
+
+        fn src_path(&self) -> PathBuf {
+            self.dir.path().join("src")
+        }
+
+        fn cache_path(&self) -> PathBuf {
+            self.dir.path().join("cache.json")
+        }
+
+        // Generate the parser using the cache, and return whether the files
+        // were regenerated.
+        fn generate(&self, grammar_json: &str) -> bool {
+            let cache_path = self.cache_path();
+            generate_parser_files(
+                &self.src_path(),
+                Some(&cache_path),
+                grammar_json,
+                tree_sitter::LANGUAGE_VERSION,
+                None,
+                false,
+                false,
+            )
+            .unwrap()
+            .1
+        }
+
+        fn output(&self) -> (String, String) {
+            (
+                fs::read_to_string(self.src_path().join("parser.c")).unwrap(),
+                fs::read_to_string(self.src_path().join("node-types.json")).unwrap(),
+            )
+        }
+
+        fn cache(&self) -> GenerationCache {
+            GenerationCache::load(Some(&self.cache_path()))
+        }
+    }
+
+    // Generate the parser without a cache.
+    fn uncached_output(grammar_json: &str) -> (String, String) {
+        let generator = Generator::new();
+        generate_parser_files(
+            &generator.src_path(),
+            None,
+            grammar_json,
+            tree_sitter::LANGUAGE_VERSION,
+            None,
+            false,
+            false,
+        )
+        .unwrap();
+        assert!(!generator.cache_path().exists());
+        generator.output()
+    }
+
+    #[test]
+    fn test_generation_cache_skips_unchanged_grammars() {
+        let generator = Generator::new();
+        assert!(generator.generate(GRAMMAR));
+        assert!(!generator.generate(GRAMMAR));
+        assert_eq!(generator.output(), uncached_output(GRAMMAR));
+    }
+
+    #[test]
+    fn test_generation_cache_after_syntax_change() {
+        let generator = Generator::new();
+        assert!(generator.generate(GRAMMAR));
+        let token_conflicts = generator.cache().token_conflicts.unwrap();
+
+        // Only the syntax rules change, so the token conflicts can be reused,
+        // but the output must be the same as without the cache.
+        let grammar = GRAMMAR.replace(
+            r#"{"type": "STRING", "value": "if"},
+                            {"type": "SYMBOL", "name": "identifier"},"#,
+            r#"{"type": "STRING", "value": "if"},
+                            {"type": "SYMBOL", "name": "identifier"},
+                            {"type": "SYMBOL", "name": "identifier"},"#,
+        );
+        assert_ne!(grammar, GRAMMAR);
+        assert!(generator.generate(&grammar));
+        assert_eq!(generator.output(), uncached_output(&grammar));
+        assert_eq!(
+            generator
+                .cache()
+                .token_conflicts
+                .unwrap()
+                .lexical_grammar_hash,
+            token_conflicts.lexical_grammar_hash
+        );
+        assert!(!generator.generate(&grammar));
+    }
+
+    #[test]
+    fn test_generation_cache_after_token_change() {
+        let generator = Generator::new();
+        assert!(generator.generate(GRAMMAR));
+        let token_conflicts = generator.cache().token_conflicts.unwrap();
+
+        // The identifier token no longer matches the keyword, so the cached
+        // conflicts between the two must not be reused.
+        let grammar = GRAMMAR.replace("[a-z]+", "[a-h]+");
+        assert_ne!(grammar, GRAMMAR);
+        assert!(generator.generate(&grammar));
+        assert_eq!(generator.output(), uncached_output(&grammar));
+        let new_token_conflicts = generator.cache().token_conflicts.unwrap();
+        assert_ne!(
+            new_token_conflicts.lexical_grammar_hash,
+            token_conflicts.lexical_grammar_hash
+        );
+        assert_ne!(
+            new_token_conflicts.status_matrix,
+            token_conflicts.status_matrix
+        );
+    }
+
+    #[test]
+    fn test_generation_cache_after_editing_the_output() {
+        let generator = Generator::new();
+        assert!(generator.generate(GRAMMAR));
+        let output = generator.output();
+
+        // Editing the generated parser by hand forces it to be regenerated.
+        let parser_path = generator.src_path().join("parser.c");
+        fs::write(&parser_path, output.0.replace("cache_test", "edited")).unwrap();
+        assert!(generator.generate(GRAMMAR));
+        assert_eq!(generator.output(), output);
+
+        fs::remove_file(&parser_path).unwrap();
+        assert!(generator.generate(GRAMMAR));
+        assert_eq!(generator.output(), output);
+        assert!(!generator.generate(GRAMMAR));
+    }
+
+    #[test]
+    fn test_stable_hasher() {
+        // These values must not change, because hashes are saved in the cache.
+        let mut hasher = StableHasher::default();
+        assert_eq!(hasher.finish(), 0xcbf2_9ce4_8422_2325);
+        hasher.write(b"a");
+        assert_eq!(hasher.finish(), 0xaf63_dc4c_8601_ec8c);
+    }
+}
@@ -1,9 +1,11 @@
-pub fn split_state_id_groups<S>(
+use crate::generate::parallel;
+
+pub fn split_state_id_groups<S: Sync>(
     states: &[S],
     state_ids_by_group_id: &mut Vec<Vec<usize>>,
     group_ids_by_state_id: &mut [usize],
     start_group_id: usize,
-    mut f: impl FnMut(&S, &S, &[usize]) -> bool,
+    f: impl Fn(&S, &S, &[usize]) -> bool + Sync,
 ) -> bool {
     let mut result = false;
 
@@ -23,21 +25,21 @@ pub fn split_state_id_groups<S>(
             let left_state = &states[left_state_id];
 
             // Identify all of the other states in the group that are incompatible with
-            // this state.
-            let mut j = i + 1;
-            while j < state_ids.len() {
-                let right_state_id = state_ids[j];
-                if split_state_ids.contains(&right_state_id) {
-                    j += 1;
-                    continue;
-                }
-                let right_state = &states[right_state_id];
-
-                if f(left_state, right_state, group_ids_by_state_id) {
+            // this state. These comparisons are independent of each other, so large
+            // groups are compared in parallel.
+            let right_state_ids = state_ids[i + 1..]
+                .iter()
+                .copied()
+                .filter(|id| !split_state_ids.contains(id))
+                .collect::<Vec<_>>();
+            let group_ids_by_state_id = &*group_ids_by_state_id;
+            let differences = parallel::map(&right_state_ids, 64, |right_state_id| {
+                f(left_state, &states[*right_state_id], group_ids_by_state_id)
+            });
+            for (right_state_id, differs) in right_state_ids.into_iter().zip(differences) {
+                if differs {
                     split_state_ids.push(right_state_id);
                 }
-
-                j += 1;
             }
 
             i += 1;
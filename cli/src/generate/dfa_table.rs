@@ -0,0 +1,420 @@
+use std::collections::{BTreeSet, HashMap};
+use std::ops::Range;
+
+use super::tables::{LexStateId, LexTable};
+
+/// The character class that is used for the end of the input.
+pub const EOF_CLASS: u16 = 0;
+
+/// The largest lex table that can be encoded. Each transition's action stores
+/// the next state's id along with a flag indicating whether the character is
+/// skipped, in 16 bits.
+pub const MAX_STATE_COUNT: usize = 1 << 15;
+
+const ASCII_LIMIT: u32 = 128;
+const CHAR_LIMIT: u32 = char::MAX as u32 + 1;
+
+/// A lex table encoded as a DFA transition table, which can be interpreted by
+/// a generic driver instead of being compiled into a `switch` statement.
+///
+/// Characters are first mapped to equivalence classes: two characters are in
+/// the same class if every lex state handles them in the same way. The rows
+/// of the resulting state-by-class table are then overlapped in a single
+/// array of entries, using row displacement. Each entry records the state
+/// that it belongs to, so a lookup that lands on another state's entry is
+/// treated as the absence of a transition.
+#[derive(Debug, PartialEq, Eq)]
+pub struct DfaTable {
+    /// The character class of each ASCII character.
+    pub ascii_classes: Vec<u16>,
+    /// The character classes of all non-ASCII characters, as a sorted list of
+    /// the characters at which the class changes.
+    pub class_ranges: Vec<(u32, u16)>,
+    /// The number of character classes, including the end-of-input class.
+    pub class_count: usize,
+    /// The position of each state's row within `entries`.
+    pub row_offsets: Vec<usize>,
+    /// The owning state and the action of each entry. An action is the next
+    /// state's id, shifted left by one, with the low bit set if the character
+    /// is skipped.
+    pub entries: Vec<Option<(LexStateId, u16)>>,
+}
+
+impl DfaTable {
+    /// Encode a lex table, given the characters that each of its transitions
+    /// is taken for. These are expressed in the same way as in the generated
+    /// `switch`-based lex function, so that the two behave identically: each
+    /// transition has a flag indicating whether the characters are included
+    /// or excluded, and a sorted list of inclusive ranges, which is treated as
+    /// matching every character if it is empty. Transitions are tried in order.
+    /// The NUL character is never matched by an excluded set.
+    pub fn new(lex_table: &LexTable, conditions: &[Vec<(bool, &[Range<char>])>]) -> Self {
+        assert!(lex_table.states.len() <= MAX_STATE_COUNT);
+
+        // Split the characters into intervals within which every transition
+        // condition is constant.
+        let mut boundaries = BTreeSet::new();
+        boundaries.extend([0, ASCII_LIMIT, CHAR_LIMIT]);
+        for (is_included, ranges) in conditions.iter().flatten() {
+            if !is_included {
+                boundaries.insert(1);
+            }
+            for range in *ranges {
+                boundaries.insert(range.start as u32);
+                boundaries.insert(range.end as u32 + 1);
+            }
+        }
+        let boundaries = boundaries.into_iter().collect::<Vec<_>>();
+        let interval_count = boundaries.len() - 1;
+
+        // Refine the partition of the intervals into classes one state at a time,
+        // so that intervals end up sharing a class only when all of the states
+        // have the same action for them.
+        let mut interval_actions = vec![None; interval_count];
+        let mut interval_classes = vec![0_usize; interval_count];
+        let mut refined_classes = HashMap::new();
+        for (state_id, state_conditions) in conditions.iter().enumerate() {
+            compute_interval_actions(
+                lex_table,
+                state_id,
+                state_conditions,
+                &boundaries,
+                &mut interval_actions,
+            );
+            refined_classes.clear();
+            for (class, action) in interval_classes.iter_mut().zip(&interval_actions) {
+                let class_count = refined_classes.len();
+                *class = *refined_classes
+                    .entry((*class, *action))
+                    .or_insert(class_count);
+            }
+        }
+
+        // Number the classes in order of their first character, after the
+        // end-of-input class.
+        let mut class_ids = HashMap::new();
+        for class in &interval_classes {
+            let class_count = class_ids.len();
+            class_ids
+                .entry(*class)
+                .or_insert(EOF_CLASS as usize + 1 + class_count);
+        }
+        let class_count = class_ids.len() + 1;
+        let interval_classes = interval_classes
+            .iter()
+            .map(|class| class_ids[class] as u16)
+            .collect::<Vec<_>>();
+
+        let mut ascii_classes = Vec::with_capacity(ASCII_LIMIT as usize);
+        let mut class_ranges = Vec::<(u32, u16)>::new();
+        for (i, class) in interval_classes.iter().enumerate() {
+            let (start, end) = (boundaries[i], boundaries[i + 1]);
+            if start < ASCII_LIMIT {
+                ascii_classes.resize(end as usize, *class);
+            } else if class_ranges.last().map_or(true, |(_, last)| last != class) {
+                class_ranges.push((start, *class));
+            }
+        }
+
+        // Build the row of each state, containing an action for each class in
+        // which the state has a transition.
+        let mut rows = Vec::with_capacity(lex_table.states.len());
+        for (state_id, state_conditions) in conditions.iter().enumerate() {
+            compute_interval_actions(
+                lex_table,
+                state_id,
+                state_conditions,
+                &boundaries,
+                &mut interval_actions,
+            );
+            let mut row = vec![None; class_count];
+            row[EOF_CLASS as usize] = eof_action(lex_table, state_id, state_conditions);
+            for (class, action) in interval_classes.iter().zip(&interval_actions) {
+                row[*class as usize] = *action;
+            }
+            rows.push(
+                row.into_iter()
+                    .enumerate()
+                    .filter_map(|(class, action)| Some((class, action?)))
+                    .collect::<Vec<_>>(),
+            );
+        }
+
+        // Place the rows, starting with the longest ones, at the first offset
+        // where all of their entries fit into unused slots.
+        let mut state_ids = (0..rows.len()).collect::<Vec<_>>();
+        state_ids.sort_by_key(|id| usize::MAX - rows[*id].len());
+        let mut row_offsets = vec![0; rows.len()];
+        let mut entries = Vec::<Option<(LexStateId, u16)>>::new();
+        let mut first_free_index = 0_usize;
+        for state_id in state_ids {
+            let row = &rows[state_id];
+            let Some((first_class, _)) = row.first() else {
+                continue;
+            };
+            let mut offset = first_free_index.saturating_sub(*first_class);
+            while !row.iter().all(|(class, _)| {
+                entries
+                    .get(offset + class)
+                    .map_or(true, |entry| entry.is_none())
+            }) {
+                offset += 1;
+            }
+            for (class, action) in row {
+                let index = offset + class;
+                if index >= entries.len() {
+                    entries.resize(index + 1, None);
+                }
+                entries[index] = Some((state_id, *action));
+            }
+            row_offsets[state_id] = offset;
+            while entries.get(first_free_index).map_or(false, Option::is_some) {
+                first_free_index += 1;
+            }
+        }
+
+        // Every lookup must stay within the entries, even for states with
+        // no transitions.
+        let max_offset = row_offsets.iter().copied().max().unwrap_or(0);
+        entries.resize(entries.len().max(max_offset + class_count), None);
+
+        Self {
+            ascii_classes,
+            class_ranges,
+            class_count,
+            row_offsets,
+            entries,
+        }
+    }
+}
+
+fn encode_action(state: LexStateId, skip: bool) -> u16 {
+    ((state as u16) << 1) | u16::from(skip)
+}
+
+// Compute the action of the given state for every interval of characters.
+fn compute_interval_actions(
+    lex_table: &LexTable,
+    state_id: usize,
+    conditions: &[(bool, &[Range<char>])],
+    boundaries: &[u32],
+    actions: &mut [Option<u16>],
+) {
+    // The state's conditions only change at a few of the boundaries, so first
+    // compute its actions for the coarser intervals between those boundaries.
+    let mut state_boundaries = BTreeSet::new();
+    state_boundaries.extend([0, 1, CHAR_LIMIT]);
+    for (_, ranges) in conditions {
+        for range in *ranges {
+            state_boundaries.insert(range.start as u32);
+            state_boundaries.insert(range.end as u32 + 1);
+        }
+    }
+    let advance_actions = &lex_table.states[state_id].advance_actions;
+    let state_actions = state_boundaries
+        .iter()
+        .map(|c| {
+            conditions
+                .iter()
+                .zip(advance_actions)
+                .find(|((is_included, ranges), _)| {
+                    if ranges.is_empty() {
+                        return true;
+                    }
+                    let index = ranges.partition_point(|range| range.start as u32 <= *c);
+                    let contains = index > 0 && *c <= ranges[index - 1].end as u32;
+                    if *is_included {
+                        contains
+                    } else {
+                        !contains && *c != 0
+                    }
+                })
+                .map(|(_, (_, action))| encode_action(action.state, !action.in_main_token))
+        })
+        .collect::<Vec<_>>();
+
+    let state_boundaries = state_boundaries.into_iter().collect::<Vec<_>>();
+    let mut j = 0;
+    for (i, action) in actions.iter_mut().enumerate() {
+        while state_boundaries[j + 1] <= boundaries[i] {
+            j += 1;
+        }
+        *action = state_actions[j];
+    }
+}
+
+// At the end of the input, only the state's EOF action and unconditional
+// transitions apply.
+fn eof_action(
+    lex_table: &LexTable,
+    state_id: usize,
+    conditions: &[(bool, &[Range<char>])],
+) -> Option<u16> {
+    let state = &lex_table.states[state_id];
+    state
+        .eof_action
+        .as_ref()
+        .map(|action| encode_action(action.state, false))
+        .or_else(|| {
+            conditions
+                .iter()
+                .zip(&state.advance_actions)
+                .find(|((is_included, ranges), _)| *is_included && ranges.is_empty())
+                .map(|(_, (_, action))| encode_action(action.state, !action.in_main_token))
+        })
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::generate::{
+        nfa::CharacterSet,
+        rules::Symbol,
+        tables::{AdvanceAction, LexState},
+    };
+
+    impl DfaTable {
+        // Look up a transition in the same way as the C driver.
+        fn transition(&self, state_id: usize, c: Option<u32>) -> Option<u16> {
+            let class = match c {
+                None => EOF_CLASS,
+                Some(c) if c < ASCII_LIMIT => self.ascii_classes[c as usize],
+                Some(c) => {
+                    let index = self.class_ranges.partition_point(|(start, _)| *start <= c);
+                    self.class_ranges[index - 1].1
+                }
+            };
+            let (owner, action) = self.entries[self.row_offsets[state_id] + class as usize]?;
+            (owner == state_id).then_some(action)
+        }
+    }
+
+    fn advance(state: LexStateId, in_main_token: bool) -> AdvanceAction {
+        AdvanceAction {
+            state,
+            in_main_token,
+        }
+    }
+
+    #[test]
+    fn test_dfa_table_matches_transition_conditions() {
+        let lower = vec!['a'..'z'];
+        let digits = vec!['0'..'9'];
+        let space = vec!['\n'..'\n', ' '..' '];
+        let not_quote = vec!['\0'..'\0', '"'..'"', '\\'..'\\'];
+        let greek = vec!['α'..'ω'];
+        let nul = vec!['\0'..'\0'];
+
+        let lex_table = LexTable {
+            states: vec![
+                LexState {
+                    accept_action: None,
+                    eof_action: Some(advance(3, true)),
+                    advance_actions: vec![
+                        (CharacterSet::empty(), advance(0, false)),
+                        (CharacterSet::empty(), advance(1, true)),
+                        (CharacterSet::empty(), advance(1, true)),
+                        (CharacterSet::empty(), advance(2, true)),
+                        (CharacterSet::empty(), advance(4, true)),
+                    ],
+                },
+                LexState {
+                    accept_action: Some(Symbol::terminal(1)),
+                    eof_action: None,
+                    advance_actions: vec![
+                        (CharacterSet::empty(), advance(1, true)),
+                        (CharacterSet::empty(), advance(1, true)),
+                    ],
+                },
+                LexState {
+                    accept_action: None,
+                    eof_action: None,
+                    advance_actions: vec![
+                        (CharacterSet::empty(), advance(5, true)),
+                        (CharacterSet::empty(), advance(2, true)),
+                    ],
+                },
+                LexState {
+                    accept_action: Some(Symbol::end()),
+                    eof_action: None,
+                    advance_actions: vec![],
+                },
+                LexState {
+                    accept_action: None,
+                    eof_action: None,
+                    advance_actions: vec![(CharacterSet::empty(), advance(4, true))],
+                },
+                LexState {
+                    accept_action: Some(Symbol::terminal(2)),
+                    eof_action: None,
+                    advance_actions: vec![],
+                },
+            ],
+        };
+        let quote = vec!['"'..'"'];
+        let conditions: Vec<Vec<(bool, &[Range<char>])>> = vec![
+            vec![
+                (true, &space),
+                (true, &lower),
+                (true, &greek),
+                (true, &quote),
+                (true, &nul),
+            ],
+            vec![(true, &lower), (true, &digits)],
+            vec![(true, &quote), (false, &not_quote)],
+            vec![],
+            vec![(true, &[])],
+            vec![],
+        ];
+
+        let table = DfaTable::new(&lex_table, &conditions);
+
+        let expected = |state_id: usize, c: Option<u32>| -> Option<u16> {
+            let Some(c) = c else {
+                return match state_id {
+                    0 => Some(encode_action(3, false)),
+                    4 => Some(encode_action(4, false)),
+                    _ => None,
+                };
+            };
+            let ch = char::from_u32(c);
+            let in_ranges = |ranges: &[Range<char>]| {
+                ch.map_or(false, |ch| {
+                    ranges.iter().any(|r| r.start <= ch && ch <= r.end)
+                })
+            };
+            match state_id {
+                0 if in_ranges(&space) => Some(encode_action(0, true)),
+                0 if in_ranges(&lower) || in_ranges(&greek) => Some(encode_action(1, false)),
+                0 if c == '"' as u32 => Some(encode_action(2, false)),
+                0 if c == 0 => Some(encode_action(4, false)),
+                1 if in_ranges(&lower) || in_ranges(&digits) => Some(encode_action(1, false)),
+                2 if c == '"' as u32 => Some(encode_action(5, false)),
+                2 if !in_ranges(&not_quote) && c != 0 => Some(encode_action(2, false)),
+                4 => Some(encode_action(4, false)),
+                _ => None,
+            }
+        };
+
+        let samples = (0..0x800)
+            .chain((0xd700..0xe100).step_by(7))
+            .chain([0xffff, 0x10000, 0x10ffff]);
+        for state_id in 0..lex_table.states.len() {
+            assert_eq!(table.transition(state_id, None), expected(state_id, None));
+            for c in samples.clone() {
+                assert_eq!(
+                    table.transition(state_id, Some(c)),
+                    expected(state_id, Some(c)),
+                    "state {state_id}, character {c:#x}"
+                );
+            }
+        }
+
+        // Characters that are handled the same way by every state share a class.
+        let class = |c: char| table.ascii_classes[c as usize];
+        assert_eq!(class('b'), class('y'));
+        assert_eq!(class('1'), class('5'));
+        assert_ne!(class('b'), class('1'));
+        assert!(table.class_count < 16);
+    }
+}
@@ -3,7 +3,7 @@ use super::rules::{Alias, Associativity, Precedence, Rule, Symbol};
 use std::collections::HashMap;
 use std::fmt;
 
-#[derive(Clone, Copy, Debug, PartialEq, Eq, PartialOrd, Ord)]
+#[derive(Clone, Copy, Debug, PartialEq, Eq, PartialOrd, Ord, Hash)]
 pub enum VariableType {
     Hidden,
     Auxiliary,
@@ -41,7 +41,7 @@ pub struct InputGrammar {
 
 // Extracted lexical grammar
 
-#[derive(Debug, PartialEq, Eq)]
+#[derive(Debug, PartialEq, Eq, Hash)]
 pub struct LexicalVariable {
     pub name: String,
     pub kind: VariableType,
@@ -49,7 +49,7 @@ pub struct LexicalVariable {
     pub start_state: u32,
 }
 
-#[derive(Debug, Default, PartialEq, Eq)]
+#[derive(Debug, Default, PartialEq, Eq, Hash)]
 pub struct LexicalGrammar {
     pub nfa: Nfa,
     pub variables: Vec<LexicalVariable>,
@@ -66,7 +66,7 @@ pub struct ProductionStep {
     pub field_name: Option<String>,
 }
 
-#[derive(Clone, Debug, Default, PartialEq, Eq)]
+#[derive(Clone, Debug, Default, PartialEq, Eq, Hash)]
 pub struct Production {
     pub steps: Vec<ProductionStep>,
     pub dynamic_precedence: i32,
@@ -78,21 +78,21 @@ pub struct InlinedProductionMap {
     pub production_map: HashMap<(*const Production, u32), Vec<usize>>,
 }
 
-#[derive(Clone, Debug, PartialEq, Eq)]
+#[derive(Clone, Debug, PartialEq, Eq, Hash)]
 pub struct SyntaxVariable {
     pub name: String,
     pub kind: VariableType,
     pub productions: Vec<Production>,
 }
 
-#[derive(Clone, Debug, PartialEq, Eq)]
+#[derive(Clone, Debug, PartialEq, Eq, Hash)]
 pub struct ExternalToken {
     pub name: String,
     pub kind: VariableType,
     pub corresponding_internal_token: Option<Symbol>,
 }
 
-#[derive(Debug, Default)]
+#[derive(Debug, Default, Hash)]
 pub struct SyntaxGrammar {
     pub variables: Vec<SyntaxVariable>,
     pub extra_symbols: Vec<Symbol>,
@@ -231,6 +231,10 @@ impl SyntaxVariable {
     }
 }
 
+// The production pointers in `production_map` are only used to identify
+// productions, and are never dereferenced.
+unsafe impl Sync for InlinedProductionMap {}
+
 impl InlinedProductionMap {
     pub fn inlined_productions<'a>(
         &'a self,
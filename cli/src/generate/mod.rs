@@ -5,10 +5,12 @@ use std::{env, fs};
 
 use anyhow::{anyhow, Context, Result};
 use lazy_static::lazy_static;
+use log::info;
 use regex::{Regex, RegexBuilder};
 use semver::Version;
 
 use build_tables::build_tables;
+use cache::{GenerationCache, TokenConflictCache};
 use grammar_files::path_in_ignore;
 use grammars::{InlinedProductionMap, LexicalGrammar, SyntaxGrammar};
 use parse_grammar::parse_grammar;
@@ -17,12 +19,15 @@ use render::render_c_code;
 use rules::AliasMap;
 
 mod build_tables;
+mod cache;
 mod char_tree;
 mod dedup;
+mod dfa_table;
 mod grammar_files;
 mod grammars;
 mod nfa;
 mod node_types;
+mod parallel;
 pub mod parse_grammar;
 mod prepare_grammar;
 mod render;
@@ -50,6 +55,8 @@ pub fn generate_parser_in_directory(
     generate_bindings: bool,
     report_symbol_name: Option<&str>,
     js_runtime: Option<&str>,
+    compress_tables: bool,
+    table_lexer: bool,
 ) -> Result<()> {
     let mut repo_path = repo_path.to_owned();
     let mut grammar_path = grammar_path;
@@ -102,12 +109,65 @@ pub fn generate_parser_in_directory(
             .with_context(|| format!("Failed to write grammar.json to {src_path:?}"))?;
     }
 
+    let (language_name, _) = generate_parser_files(
+        &src_path,
+        GenerationCache::path(&repo_path).as_deref(),
+        &grammar_json,
+        abi_version,
+        report_symbol_name,
+        compress_tables,
+        table_lexer,
+    )?;
+
+    write_file(&header_path.join("alloc.h"), ALLOC_HEADER)?;
+    write_file(&header_path.join("array.h"), tree_sitter::ARRAY_HEADER)?;
+    write_file(&header_path.join("parser.h"), tree_sitter::PARSER_HEADER)?;
+
+    if !path_in_ignore(&repo_path) {
+        grammar_files::generate_grammar_files(&repo_path, &language_name, generate_bindings)?;
+    }
+
+    Ok(())
+}
+
+/// Generate `parser.c` and `node-types.json` in the given `src` directory,
+/// unless the generation cache at `cache_path` shows that the existing files
+/// were produced from the same grammar and haven't been modified since. Returns
+/// the name of the language, and whether the files were generated.
+#[allow(clippy::too_many_arguments)]
+fn generate_parser_files(
+    src_path: &Path,
+    cache_path: Option<&Path>,
+    grammar_json: &str,
+    abi_version: usize,
+    report_symbol_name: Option<&str>,
+    compress_tables: bool,
+    table_lexer: bool,
+) -> Result<(String, bool)> {
     // Parse and preprocess the grammar.
-    let input_grammar = parse_grammar(&grammar_json)?;
+    let input_grammar = parse_grammar(grammar_json)?;
     let (syntax_grammar, lexical_grammar, inlines, simple_aliases) =
         prepare_grammar(&input_grammar)?;
     let language_name = input_grammar.name;
 
+    // If the prepared grammar is the same as it was the last time that the parser
+    // was generated, and the generated files haven't been changed since then,
+    // there is no need to build the tables again.
+    let mut cache = GenerationCache::load(cache_path);
+    let fingerprint = cache::output_fingerprint(
+        &language_name,
+        &syntax_grammar,
+        &lexical_grammar,
+        &simple_aliases,
+        abi_version,
+        compress_tables,
+        table_lexer,
+    );
+    if report_symbol_name.is_none() && cache.output_is_current(fingerprint, src_path) {
+        info!("The grammar is unchanged, so the generated parser is up to date");
+        return Ok((language_name, false));
+    }
+
     // Generate the parser and related files.
     let GeneratedParser {
         c_code,
@@ -120,22 +180,42 @@ pub fn generate_parser_in_directory(
         simple_aliases,
         abi_version,
         report_symbol_name,
+        compress_tables,
+        table_lexer,
+        &mut cache.token_conflicts,
     )?;
 
+    cache.record_output(fingerprint, &c_code, &node_types_json);
     write_file(&src_path.join("parser.c"), c_code)?;
     write_file(&src_path.join("node-types.json"), node_types_json)?;
-    write_file(&header_path.join("alloc.h"), ALLOC_HEADER)?;
-    write_file(&header_path.join("array.h"), tree_sitter::ARRAY_HEADER)?;
-    write_file(&header_path.join("parser.h"), tree_sitter::PARSER_HEADER)?;
-
-    if !path_in_ignore(&repo_path) {
-        grammar_files::generate_grammar_files(&repo_path, &language_name, generate_bindings)?;
-    }
+    cache.save(cache_path);
 
-    Ok(())
+    Ok((language_name, true))
 }
 
 pub fn generate_parser_for_grammar(grammar_json: &str) -> Result<(String, String)> {
+    generate_parser_for_grammar_json(grammar_json, false, false)
+}
+
+/// Like `generate_parser_for_grammar`, but store the parse tables in a compressed form.
+pub fn generate_parser_for_grammar_with_compressed_tables(
+    grammar_json: &str,
+) -> Result<(String, String)> {
+    generate_parser_for_grammar_json(grammar_json, true, false)
+}
+
+/// Like `generate_parser_for_grammar`, but generate table-driven lex functions.
+pub fn generate_parser_for_grammar_with_table_lexer(
+    grammar_json: &str,
+) -> Result<(String, String)> {
+    generate_parser_for_grammar_json(grammar_json, false, true)
+}
+
+fn generate_parser_for_grammar_json(
+    grammar_json: &str,
+    compress_tables: bool,
+    table_lexer: bool,
+) -> Result<(String, String)> {
     let grammar_json = JSON_COMMENT_REGEX.replace_all(grammar_json, "\n");
     let input_grammar = parse_grammar(&grammar_json)?;
     let (syntax_grammar, lexical_grammar, inlines, simple_aliases) =
@@ -148,10 +228,14 @@ pub fn generate_parser_for_grammar(grammar_json: &str) -> Result<(String, String
         simple_aliases,
         tree_sitter::LANGUAGE_VERSION,
         None,
+        compress_tables,
+        table_lexer,
+        &mut None,
     )?;
     Ok((input_grammar.name, parser.c_code))
 }
 
+#[allow(clippy::too_many_arguments)]
 fn generate_parser_for_grammar_with_opts(
     name: &str,
     syntax_grammar: SyntaxGrammar,
@@ -160,6 +244,9 @@ fn generate_parser_for_grammar_with_opts(
     simple_aliases: AliasMap,
     abi_version: usize,
     report_symbol_name: Option<&str>,
+    compress_tables: bool,
+    table_lexer: bool,
+    token_conflict_cache: &mut Option<TokenConflictCache>,
 ) -> Result<GeneratedParser> {
     let variable_info =
         node_types::get_variable_info(&syntax_grammar, &lexical_grammar, &simple_aliases)?;
@@ -176,6 +263,7 @@ fn generate_parser_for_grammar_with_opts(
         &variable_info,
         inlines,
         report_symbol_name,
+        token_conflict_cache,
     )?;
     let c_code = render_c_code(
         name,
@@ -187,6 +275,8 @@ fn generate_parser_for_grammar_with_opts(
         lexical_grammar,
         simple_aliases,
         abi_version,
+        compress_tables,
+        table_lexer,
     );
     Ok(GeneratedParser {
         c_code,
@@ -13,7 +13,7 @@ pub struct CharacterSet {
 }
 
 /// A state in an NFA representing a regular grammar.
-#[derive(Debug, PartialEq, Eq)]
+#[derive(Debug, PartialEq, Eq, Hash)]
 pub enum NfaState {
     Advance {
         chars: CharacterSet,
@@ -28,7 +28,7 @@ pub enum NfaState {
     },
 }
 
-#[derive(PartialEq, Eq, Default)]
+#[derive(PartialEq, Eq, Default, Hash)]
 pub struct Nfa {
     pub states: Vec<NfaState>,
 }
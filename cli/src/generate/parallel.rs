@@ -0,0 +1,94 @@
+use std::env;
+use std::num::NonZeroUsize;
+use std::panic;
+use std::sync::atomic::{AtomicUsize, Ordering};
+use std::thread;
+
+use lazy_static::lazy_static;
+
+lazy_static! {
+    static ref THREAD_COUNT: usize = env::var("TREE_SITTER_GENERATE_THREADS")
+        .ok()
+        .and_then(|count| count.parse().ok())
+        .filter(|count| *count > 0)
+        .unwrap_or_else(|| thread::available_parallelism().map_or(1, NonZeroUsize::get));
+}
+
+/// The number of threads used to build parse tables. This defaults to the
+/// available parallelism, and can be overridden with the
+/// `TREE_SITTER_GENERATE_THREADS` environment variable.
+pub fn thread_count() -> usize {
+    *THREAD_COUNT
+}
+
+/// Apply `f` to every element of `items`, returning the results in the same order.
+///
+/// The work is divided between threads, but only when there are at least
+/// `min_items_per_thread` items for each of them, so that cheap operations on
+/// small inputs don't pay for spawning threads.
+pub fn map<T, R>(items: &[T], min_items_per_thread: usize, f: impl Fn(&T) -> R + Sync) -> Vec<R>
+where
+    T: Sync,
+    R: Send,
+{
+    map_with_state(items, min_items_per_thread, || (), |(), item| f(item))
+}
+
+/// Like `map`, but gives each thread its own scratch state, created by `init`.
+pub fn map_with_state<T, S, R>(
+    items: &[T],
+    min_items_per_thread: usize,
+    init: impl Fn() -> S + Sync,
+    f: impl Fn(&mut S, &T) -> R + Sync,
+) -> Vec<R>
+where
+    T: Sync,
+    R: Send,
+{
+    let thread_count = thread_count().min(items.len() / min_items_per_thread.max(1));
+    if thread_count <= 1 {
+        let mut state = init();
+        return items.iter().map(|item| f(&mut state, item)).collect();
+    }
+
+    // The cost of each item can vary a lot, so rather than giving each thread a
+    // fixed range of items, the threads repeatedly claim small batches of items
+    // until none are left.
+    let batch_len = (items.len() / (thread_count * 8)).max(1);
+    let next_index = AtomicUsize::new(0);
+    let run = || {
+        let mut state = init();
+        let mut results = Vec::new();
+        loop {
+            let start = next_index.fetch_add(batch_len, Ordering::Relaxed);
+            if start >= items.len() {
+                break;
+            }
+            let end = (start + batch_len).min(items.len());
+            results.push((
+                start,
+                items[start..end]
+                    .iter()
+                    .map(|item| f(&mut state, item))
+                    .collect::<Vec<_>>(),
+            ));
+        }
+        results
+    };
+
+    let mut batches = thread::scope(|scope| {
+        let handles = (1..thread_count)
+            .map(|_| scope.spawn(run))
+            .collect::<Vec<_>>();
+        let mut batches = run();
+        for handle in handles {
+            batches.extend(handle.join().unwrap_or_else(|e| panic::resume_unwind(e)));
+        }
+        batches
+    });
+    batches.sort_unstable_by_key(|(start, _)| *start);
+    batches
+        .into_iter()
+        .flat_map(|(_, results)| results)
+        .collect()
+}
@@ -1,5 +1,6 @@
 use super::{
     char_tree::{CharacterTree, Comparator},
+    dfa_table::{self, DfaTable},
     grammars::{ExternalToken, LexicalGrammar, SyntaxGrammar, VariableType},
     rules::{Alias, AliasMap, Symbol, SymbolType},
     tables::{
@@ -20,6 +21,7 @@ const SMALL_STATE_THRESHOLD: usize = 64;
 const ABI_VERSION_MIN: usize = 13;
 const ABI_VERSION_MAX: usize = tree_sitter::LANGUAGE_VERSION;
 const ABI_VERSION_WITH_PRIMARY_STATES: usize = 14;
+const ABI_VERSION_WITH_SMALL_STATE_HASHES: usize = 15;
 
 macro_rules! add {
     ($this: tt, $($arg: tt)*) => {{
@@ -74,6 +76,9 @@ struct Generator {
     unique_aliases: Vec<Alias>,
     symbol_map: HashMap<Symbol, Symbol>,
     field_names: Vec<String>,
+    compress_tables: bool,
+    compressed_table_names: Vec<&'static str>,
+    table_lexer: bool,
 
     #[allow(unused)]
     abi_version: usize,
@@ -257,6 +262,12 @@ impl Generator {
     }
 
     fn add_includes(&mut self) {
+        if self.compress_tables {
+            add_line!(self, "#define TREE_SITTER_COMPRESSED_TABLES");
+        }
+        if self.table_lexer {
+            add_line!(self, "#define TREE_SITTER_TABLE_LEXER");
+        }
         add_line!(self, "#include \"tree_sitter/parser.h\"");
         add_line!(self, "");
     }
@@ -671,6 +682,8 @@ impl Generator {
     ) {
         let mut ruled_out_chars = HashSet::new();
         let mut large_character_sets = Vec::<LargeCharacterSetInfo>::new();
+        let use_table = self.table_lexer && lex_table.states.len() <= dfa_table::MAX_STATE_COUNT;
+        let extract_helper_functions = extract_helper_functions && !use_table;
 
         // For each lex state, compute a summary of the code that needs to be
         // generated.
@@ -733,6 +746,21 @@ impl Generator {
             })
             .collect::<Vec<Vec<_>>>();
 
+        if use_table {
+            let conditions = state_transition_summaries
+                .iter()
+                .map(|transitions| {
+                    transitions
+                        .iter()
+                        .map(|transition| (transition.is_included, transition.ranges.as_slice()))
+                        .collect()
+                })
+                .collect::<Vec<_>>();
+            let table = DfaTable::new(&lex_table, &conditions);
+            self.add_lex_table(name, &lex_table, &table);
+            return;
+        }
+
         // Generate a helper function for each large character set.
         let mut sorted_large_char_sets = large_character_sets.iter().collect::<Vec<_>>();
         sorted_large_char_sets.sort_unstable_by_key(|info| (info.symbol, info.index));
@@ -785,6 +813,95 @@ impl Generator {
         add_line!(self, "");
     }
 
+    fn add_lex_table(&mut self, name: &str, lex_table: &LexTable, table: &DfaTable) {
+        add_line!(self, "static const uint16_t {name}_ascii_classes[128] = {{");
+        indent!(self);
+        for chunk in table.ascii_classes.chunks(16) {
+            add_line!(self, "{}", join_values(chunk.iter()));
+        }
+        dedent!(self);
+        add_line!(self, "}};");
+        add_line!(self, "");
+
+        add_line!(
+            self,
+            "static const TSLexClassRange {name}_class_ranges[] = {{"
+        );
+        indent!(self);
+        for chunk in table.class_ranges.chunks(8) {
+            add_line!(
+                self,
+                "{}",
+                join_values(
+                    chunk
+                        .iter()
+                        .map(|(start, class)| format!("{{{start}, {class}}}"))
+                )
+            );
+        }
+        dedent!(self);
+        add_line!(self, "}};");
+        add_line!(self, "");
+
+        add_line!(self, "static const TSLexTableState {name}_states[] = {{");
+        indent!(self);
+        for (i, state) in lex_table.states.iter().enumerate() {
+            let row_offset = table.row_offsets[i];
+            if let Some(accept_action) = state.accept_action {
+                add_line!(
+                    self,
+                    "[{i}] = {{.row_offset = {row_offset}, .accept_symbol = {}, .accepts = true}},",
+                    self.symbol_ids[&accept_action]
+                );
+            } else {
+                add_line!(self, "[{i}] = {{.row_offset = {row_offset}}},");
+            }
+        }
+        dedent!(self);
+        add_line!(self, "}};");
+        add_line!(self, "");
+
+        add_line!(self, "static const TSLexTableEntry {name}_entries[] = {{");
+        indent!(self);
+        for chunk in table.entries.chunks(8) {
+            add_line!(
+                self,
+                "{}",
+                join_values(chunk.iter().map(|entry| match entry {
+                    Some((state, action)) => format!("{{{state}, {action}}}"),
+                    None => "{UINT16_MAX, 0}".to_string(),
+                }))
+            );
+        }
+        dedent!(self);
+        add_line!(self, "}};");
+        add_line!(self, "");
+
+        add_line!(self, "static const TSLexTable {name}_table = {{");
+        indent!(self);
+        add_line!(self, ".ascii_classes = {name}_ascii_classes,");
+        add_line!(self, ".class_ranges = {name}_class_ranges,");
+        add_line!(self, ".class_range_count = {},", table.class_ranges.len());
+        add_line!(self, ".states = {name}_states,");
+        add_line!(self, ".entries = {name}_entries,");
+        dedent!(self);
+        add_line!(self, "}};");
+        add_line!(self, "");
+
+        add_line!(
+            self,
+            "static bool {name}(TSLexer *lexer, TSStateId state) {{",
+        );
+        indent!(self);
+        add_line!(
+            self,
+            "return ts_lex_with_table(lexer, state, &{name}_table);"
+        );
+        dedent!(self);
+        add_line!(self, "}}");
+        add_line!(self, "");
+    }
+
     fn symbol_for_advance_action(
         &self,
         action: &AdvanceAction,
@@ -1103,11 +1220,20 @@ impl Generator {
             &mut next_parse_action_list_index,
         );
 
-        add_line!(
-            self,
-            "static const uint16_t ts_parse_table[LARGE_STATE_COUNT][SYMBOL_COUNT] = {{",
-        );
-        indent!(self);
+        // When the tables are compressed, their values are collected here instead
+        // of being rendered as C initializers.
+        let symbol_count = self.parse_table.symbols.len();
+        let mut compressed_values = self
+            .compress_tables
+            .then(|| vec![0; self.large_state_count * symbol_count]);
+
+        if compressed_values.is_none() {
+            add_line!(
+                self,
+                "static const uint16_t ts_parse_table[LARGE_STATE_COUNT][SYMBOL_COUNT] = {{",
+            );
+            indent!(self);
+        }
 
         let mut terminal_entries = Vec::new();
         let mut nonterminal_entries = Vec::new();
@@ -1119,8 +1245,10 @@ impl Generator {
             .enumerate()
             .take(self.large_state_count)
         {
-            add_line!(self, "[{}] = {{", i);
-            indent!(self);
+            if compressed_values.is_none() {
+                add_line!(self, "[{}] = {{", i);
+                indent!(self);
+            }
 
             // Ensure the entries are in a deterministic order, since they are
             // internally represented as a hash map.
@@ -1132,15 +1260,15 @@ impl Generator {
             nonterminal_entries.sort_unstable_by_key(|k| k.0);
 
             for (symbol, action) in &nonterminal_entries {
-                add_line!(
-                    self,
-                    "[{}] = STATE({}),",
-                    self.symbol_ids[symbol],
-                    match action {
-                        GotoAction::Goto(state) => *state,
-                        GotoAction::ShiftExtra => i,
-                    }
-                );
+                let state_id = match action {
+                    GotoAction::Goto(state) => *state,
+                    GotoAction::ShiftExtra => i,
+                };
+                if let Some(values) = &mut compressed_values {
+                    values[i * symbol_count + self.symbol_value(**symbol)] = state_id as u16;
+                } else {
+                    add_line!(self, "[{}] = STATE({state_id}),", self.symbol_ids[symbol]);
+                }
             }
 
             for (symbol, entry) in &terminal_entries {
@@ -1149,21 +1277,43 @@ impl Generator {
                     &mut parse_table_entries,
                     &mut next_parse_action_list_index,
                 );
-                add_line!(self, "[{}] = ACTIONS({entry_id}),", self.symbol_ids[symbol]);
+                if let Some(values) = &mut compressed_values {
+                    values[i * symbol_count + self.symbol_value(**symbol)] = entry_id as u16;
+                } else {
+                    add_line!(self, "[{}] = ACTIONS({entry_id}),", self.symbol_ids[symbol]);
+                }
+            }
+
+            if compressed_values.is_none() {
+                dedent!(self);
+                add_line!(self, "}},");
             }
+        }
+
+        if let Some(values) = compressed_values.take() {
+            self.add_compressed_table(
+                "ts_parse_table",
+                "[LARGE_STATE_COUNT][SYMBOL_COUNT]",
+                &values,
+            );
+        } else {
             dedent!(self);
-            add_line!(self, "}},");
+            add_line!(self, "}};");
+            add_line!(self, "");
         }
-        dedent!(self);
-        add_line!(self, "}};");
-        add_line!(self, "");
 
         if self.large_state_count < self.parse_table.states.len() {
-            add_line!(self, "static const uint16_t ts_small_parse_table[] = {{");
-            indent!(self);
+            if self.compress_tables {
+                compressed_values = Some(Vec::new());
+            } else {
+                add_line!(self, "static const uint16_t ts_small_parse_table[] = {{");
+                indent!(self);
+            }
 
+            let mut terminal_entries = Vec::new();
             let mut index = 0;
             let mut small_state_indices = Vec::new();
+            let mut small_state_entries = Vec::new();
             let mut symbols_by_value = HashMap::<(usize, SymbolType), Vec<Symbol>>::new();
             for state in self.parse_table.states.iter().skip(self.large_state_count) {
                 small_state_indices.push(index);
@@ -1205,25 +1355,50 @@ impl Generator {
                     (symbols.len(), *kind, *value, symbols[0])
                 });
 
-                add_line!(self, "[{index}] = {},", values_with_symbols.len());
-                indent!(self);
-
-                for ((value, kind), symbols) in &mut values_with_symbols {
-                    if *kind == SymbolType::NonTerminal {
-                        add_line!(self, "STATE({value}), {},", symbols.len());
-                    } else {
-                        add_line!(self, "ACTIONS({value}), {},", symbols.len());
+                if let Some(values) = &mut compressed_values {
+                    values.push(values_with_symbols.len() as u16);
+                    for ((value, _), symbols) in &mut values_with_symbols {
+                        symbols.sort_unstable();
+                        values.push(*value as u16);
+                        values.push(symbols.len() as u16);
+                        values.extend(
+                            symbols
+                                .iter()
+                                .map(|symbol| self.symbol_value(*symbol) as u16),
+                        );
                     }
-
-                    symbols.sort_unstable();
+                } else {
+                    add_line!(self, "[{index}] = {},", values_with_symbols.len());
                     indent!(self);
-                    for symbol in symbols {
-                        add_line!(self, "{},", self.symbol_ids[symbol]);
+
+                    for ((value, kind), symbols) in &mut values_with_symbols {
+                        if *kind == SymbolType::NonTerminal {
+                            add_line!(self, "STATE({value}), {},", symbols.len());
+                        } else {
+                            add_line!(self, "ACTIONS({value}), {},", symbols.len());
+                        }
+
+                        symbols.sort_unstable();
+                        indent!(self);
+                        for symbol in symbols {
+                            add_line!(self, "{},", self.symbol_ids[symbol]);
+                        }
+                        dedent!(self);
                     }
+
                     dedent!(self);
                 }
 
-                dedent!(self);
+                if self.abi_version >= ABI_VERSION_WITH_SMALL_STATE_HASHES {
+                    small_state_entries.push(
+                        values_with_symbols
+                            .iter()
+                            .flat_map(|((value, kind), symbols)| {
+                                symbols.iter().map(move |symbol| (*symbol, *value, *kind))
+                            })
+                            .collect::<Vec<_>>(),
+                    );
+                }
 
                 index += 1 + values_with_symbols
                     .iter()
@@ -1231,9 +1406,13 @@ impl Generator {
                     .sum::<usize>();
             }
 
-            dedent!(self);
-            add_line!(self, "}};");
-            add_line!(self, "");
+            if let Some(values) = compressed_values {
+                self.add_compressed_table("ts_small_parse_table", &format!("[{index}]"), &values);
+            } else {
+                dedent!(self);
+                add_line!(self, "}};");
+                add_line!(self, "");
+            }
 
             add_line!(
                 self,
@@ -1250,6 +1429,10 @@ impl Generator {
             dedent!(self);
             add_line!(self, "}};");
             add_line!(self, "");
+
+            if self.abi_version >= ABI_VERSION_WITH_SMALL_STATE_HASHES {
+                self.add_small_parse_table_hashes(small_state_entries);
+            }
         }
 
         let mut parse_table_entries = parse_table_entries
@@ -1260,6 +1443,121 @@ impl Generator {
         self.add_parse_action_list(parse_table_entries);
     }
 
+    // In addition to the grouped representation, emit an open-addressed hash table
+    // for each small parse state, so that the runtime can look up a symbol's value
+    // without scanning every group. Each table starts with the base-2 logarithm of
+    // its slot count, followed by (symbol, value) pairs, with empty slots marked by
+    // `UINT16_MAX`. The slot count is at least twice the number of symbols, which
+    // keeps the probe sequences short.
+    fn add_small_parse_table_hashes(
+        &mut self,
+        small_state_entries: Vec<Vec<(Symbol, usize, SymbolType)>>,
+    ) {
+        add_line!(
+            self,
+            "static const uint16_t ts_small_parse_table_hashes[] = {{"
+        );
+        indent!(self);
+
+        let mut index = 0;
+        let mut small_state_indices = Vec::new();
+        for entries in small_state_entries {
+            small_state_indices.push(index);
+
+            let mut bits = 1;
+            while (1 << bits) < 2 * entries.len() {
+                bits += 1;
+            }
+            let mask = (1 << bits) - 1;
+            let mut slots = vec![None; 1 << bits];
+            for (symbol, value, kind) in entries {
+                let symbol_id = self.symbol_value(symbol);
+                let mut slot =
+                    ((symbol_id as u32).wrapping_mul(0x9E37_79B9) >> (32 - bits)) as usize;
+                while let Some((existing_id, _, _, _)) = slots[slot] {
+                    if existing_id == symbol_id {
+                        break;
+                    }
+                    slot = (slot + 1) & mask;
+                }
+                if slots[slot].is_none() {
+                    slots[slot] = Some((symbol_id, symbol, value, kind));
+                }
+            }
+
+            add_line!(self, "[{index}] = {bits},");
+            indent!(self);
+            for slot in &slots {
+                match slot {
+                    Some((_, symbol, value, SymbolType::NonTerminal)) => {
+                        add_line!(self, "{}, STATE({value}),", self.symbol_ids[symbol]);
+                    }
+                    Some((_, symbol, value, _)) => {
+                        add_line!(self, "{}, ACTIONS({value}),", self.symbol_ids[symbol]);
+                    }
+                    None => add_line!(self, "UINT16_MAX, 0,"),
+                }
+            }
+            dedent!(self);
+
+            index += 1 + 2 * slots.len();
+        }
+
+        dedent!(self);
+        add_line!(self, "}};");
+        add_line!(self, "");
+
+        add_line!(
+            self,
+            "static const uint32_t ts_small_parse_table_hash_map[] = {{"
+        );
+        indent!(self);
+        for (i, index) in small_state_indices.iter().enumerate() {
+            add_line!(
+                self,
+                "[SMALL_STATE({})] = {index},",
+                self.large_state_count + i
+            );
+        }
+        dedent!(self);
+        add_line!(self, "}};");
+        add_line!(self, "");
+    }
+
+    // Emit a table of 16-bit values as a zero-initialized array, along with a compressed
+    // copy of its contents, which is inflated into the array the first time that the
+    // language is loaded. The compressed data is a sequence of LEB128-encoded values,
+    // where each zero value is followed by the length of a run of zeros. Because the
+    // array starts out zeroed, those runs don't need to be written when inflating.
+    fn add_compressed_table(&mut self, name: &'static str, dimensions: &str, values: &[u16]) {
+        let mut data = Vec::new();
+        let mut i = 0;
+        while i < values.len() {
+            if values[i] == 0 {
+                let run_length = values[i..].iter().take_while(|value| **value == 0).count();
+                write_varint(&mut data, 0);
+                write_varint(&mut data, run_length as u32);
+                i += run_length;
+            } else {
+                write_varint(&mut data, u32::from(values[i]));
+                i += 1;
+            }
+        }
+
+        add_line!(self, "static uint16_t {name}{dimensions};");
+        add_line!(self, "");
+        add_line!(self, "static const uint8_t {name}_data[] = {{");
+        indent!(self);
+        for chunk in data.chunks(24) {
+            add_line!(self, "{}", join_values(chunk.iter()));
+        }
+        dedent!(self);
+        add_line!(self, "}};");
+        add_line!(self, "");
+
+        self.compressed_table_names.push(name);
+    }
+
     fn add_parse_action_list(&mut self, parse_table_entries: Vec<(usize, ParseTableEntry)>) {
         add_line!(
             self,
@@ -1357,6 +1655,22 @@ impl Generator {
         add_line!(self, "#endif");
         add_line!(self, "");
 
+        if !self.compressed_table_names.is_empty() {
+            add_line!(self, "static volatile uint32_t ts_inflated_tables_state;");
+            add_line!(self, "");
+            add_line!(self, "static void ts_inflate_tables(void) {{");
+            indent!(self);
+            for name in self.compressed_table_names.clone() {
+                add_line!(
+                    self,
+                    "ts_inflate_table((uint16_t *){name}, {name}_data, sizeof({name}_data));"
+                );
+            }
+            dedent!(self);
+            add_line!(self, "}}");
+            add_line!(self, "");
+        }
+
         add_line!(
             self,
             "TS_PUBLIC const TSLanguage *{language_function_name}() {{",
@@ -1432,8 +1746,27 @@ impl Generator {
             add_line!(self, ".primary_state_ids = ts_primary_state_ids,");
         }
 
+        if self.abi_version >= ABI_VERSION_WITH_SMALL_STATE_HASHES
+            && self.large_state_count < self.parse_table.states.len()
+        {
+            add_line!(
+                self,
+                ".small_parse_table_hash_map = ts_small_parse_table_hash_map,"
+            );
+            add_line!(
+                self,
+                ".small_parse_table_hashes = ts_small_parse_table_hashes,"
+            );
+        }
+
         dedent!(self);
         add_line!(self, "}};");
+        if !self.compressed_table_names.is_empty() {
+            add_line!(
+                self,
+                "ts_inflate_tables_once(&ts_inflated_tables_state, ts_inflate_tables);"
+            );
+        }
         add_line!(self, "return &language;");
         dedent!(self);
         add_line!(self, "}}");
@@ -1442,6 +1775,14 @@ impl Generator {
         add_line!(self, "#endif");
     }
 
+    fn symbol_value(&self, symbol: Symbol) -> usize {
+        if symbol == Symbol::end_of_nonterminal_extra() {
+            0
+        } else {
+            self.symbol_order[&symbol]
+        }
+    }
+
     fn get_parse_action_list_id(
         &self,
         entry: &ParseTableEntry,
@@ -1689,6 +2030,10 @@ impl Generator {
 /// * `abi_version` - The language ABI version that should be generated. Usually
 ///    you want Tree-sitter's current version, but right after making an ABI
 ///    change, it may be useful to generate code with the previous ABI.
+/// * `compress_tables` - Whether to store the parse tables in a compressed form, which
+///    is inflated the first time that the language is loaded.
+/// * `table_lexer` - Whether to generate the lex functions as DFA transition tables,
+///    interpreted by a generic driver, instead of as `switch` statements.
 #[allow(clippy::too_many_arguments)]
 pub fn render_c_code(
     name: &str,
@@ -1700,6 +2045,8 @@ pub fn render_c_code(
     lexical_grammar: LexicalGrammar,
     default_aliases: AliasMap,
     abi_version: usize,
+    compress_tables: bool,
+    table_lexer: bool,
 ) -> String {
     assert!(
         (ABI_VERSION_MIN..=ABI_VERSION_MAX).contains(&abi_version),
@@ -1724,7 +2071,25 @@ pub fn render_c_code(
         symbol_map: HashMap::new(),
         unique_aliases: Vec::new(),
         field_names: Vec::new(),
+        compress_tables,
+        compressed_table_names: Vec::new(),
+        table_lexer,
         abi_version,
     }
     .generate()
 }
+
+fn join_values<T: std::fmt::Display>(values: impl Iterator<Item = T>) -> String {
+    values
+        .map(|value| format!("{value},"))
+        .collect::<Vec<_>>()
+        .join(" ")
+}
+
+fn write_varint(data: &mut Vec<u8>, mut value: u32) {
+    while value >= 0x80 {
+        data.push((value & 0x7f) as u8 | 0x80);
+        value >>= 7;
+    }
+    data.push(value as u8);
+}
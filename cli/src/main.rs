@@ -5,8 +5,9 @@ use glob::glob;
 use regex::Regex;
 use std::collections::HashSet;
 use std::path::{Path, PathBuf};
+use std::time::Instant;
 use std::{env, fs, u64};
-use tree_sitter::{ffi, Parser, Point};
+use tree_sitter::{ffi, Language, Parser, Point};
 use tree_sitter_cli::test::TestOptions;
 use tree_sitter_cli::{
     generate, highlight, logger,
@@ -62,6 +63,16 @@ struct Generate {
     pub abi_version: Option<String>,
     #[arg(long, help = "Don't generate language bindings")]
     pub no_bindings: bool,
+    #[arg(
+        long,
+        help = "Store the parse tables in a compressed form, which is inflated when the language is first loaded"
+    )]
+    pub compress_tables: bool,
+    #[arg(
+        long,
+        help = "Generate the lexer as a DFA transition table that is interpreted at runtime, instead of as C code"
+    )]
+    pub table_lexer: bool,
     #[arg(
         long,
         short = 'b',
@@ -155,6 +166,13 @@ struct Parse {
     pub output_xml: bool,
     #[arg(long, short, help = "Show parsing statistic")]
     pub stat: bool,
+    #[arg(
+        long,
+        short,
+        conflicts_with_all = ["debug_graph", "output_dot"],
+        help = "The number of files to parse in parallel, or 0 to use all available cores"
+    )]
+    pub jobs: Option<usize>,
     #[arg(long, help = "Interrupt the parsing process by timeout (µs)")]
     pub timeout: Option<u64>,
     #[arg(long, short, help = "Measure execution time")]
@@ -227,6 +245,13 @@ struct Test {
     pub open_log: bool,
     #[arg(long, help = "The path to an alternative config.json file")]
     pub config_path: Option<PathBuf>,
+    #[arg(
+        long,
+        short,
+        conflicts_with_all = ["debug", "debug_graph"],
+        help = "The number of corpus files to test in parallel, or 0 to use all available cores"
+    )]
+    pub jobs: Option<usize>,
 }
 
 #[derive(Args)]
@@ -261,6 +286,22 @@ struct Query {
     pub captures: bool,
     #[arg(long, help = "Whether to run query tests or not")]
     pub test: bool,
+    #[arg(
+        long,
+        help = "Report the patterns that were the most expensive to match"
+    )]
+    pub stats: bool,
+    #[arg(
+        long,
+        short,
+        help = "The number of files to process in parallel, or 0 to use all available cores"
+    )]
+    pub jobs: Option<usize>,
+    #[arg(
+        long,
+        help = "When processing files in parallel, print their results in the order of the paths"
+    )]
+    pub ordered: bool,
     #[arg(long, help = "The path to an alternative config.json file")]
     pub config_path: Option<PathBuf>,
 }
@@ -318,6 +359,17 @@ struct Tags {
     pub paths_file: Option<String>,
     #[arg(num_args = 1.., help = "The source file(s) to use")]
     pub paths: Option<Vec<String>>,
+    #[arg(
+        long,
+        short,
+        help = "The number of files to process in parallel, or 0 to use all available cores"
+    )]
+    pub jobs: Option<usize>,
+    #[arg(
+        long,
+        help = "When processing files in parallel, print their results in the order of the paths"
+    )]
+    pub ordered: bool,
     #[arg(long, help = "The path to an alternative config.json file")]
     pub config_path: Option<PathBuf>,
 }
@@ -430,6 +482,8 @@ fn run() -> Result<()> {
                 !generate_options.no_bindings,
                 generate_options.report_states_for_rule.as_deref(),
                 generate_options.js_runtime.as_deref(),
+                generate_options.compress_tables,
+                generate_options.table_lexer,
             )?;
             if generate_options.build {
                 if let Some(path) = generate_options.libdir {
@@ -522,8 +576,11 @@ fn run() -> Result<()> {
 
             let time = parse_options.time;
             let edits = parse_options.edits.unwrap_or_default();
+            let edits = edits
+                .iter()
+                .map(std::string::String::as_str)
+                .collect::<Vec<&str>>();
             let cancellation_flag = util::cancel_on_signal();
-            let mut parser = Parser::new();
 
             if parse_options.debug {
                 // For augmenting debug logging in external scanners
@@ -533,13 +590,11 @@ fn run() -> Result<()> {
             loader.use_debug_build(parse_options.debug_build);
 
             #[cfg(feature = "wasm")]
-            if parse_options.wasm {
+            let wasm_engine = parse_options.wasm.then(|| {
                 let engine = tree_sitter::wasmtime::Engine::default();
-                parser
-                    .set_wasm_store(tree_sitter::WasmStore::new(engine.clone()).unwrap())
-                    .unwrap();
-                loader.use_wasm(engine);
-            }
+                loader.use_wasm(engine.clone());
+                engine
+            });
 
             let timeout = parse_options.timeout.unwrap_or_default();
 
@@ -549,26 +604,37 @@ fn run() -> Result<()> {
             let mut has_error = false;
             let loader_config = config.get()?;
             loader.find_all_languages(&loader_config)?;
+            if parse_options.scope.is_none() {
+                loader.preload_languages_for_paths(&paths)?;
+            }
 
+            let jobs = job_count(parse_options.jobs);
             let should_track_stats = parse_options.stat;
             let mut stats = parse::Stats::default();
 
-            for path in paths {
-                let path = Path::new(&path);
-
-                let language =
-                    loader.select_language(path, &current_dir, parse_options.scope.as_deref())?;
+            let new_parser = || -> Result<Parser> {
+                #[allow(unused_mut)]
+                let mut parser = Parser::new();
+                #[cfg(feature = "wasm")]
+                if let Some(engine) = &wasm_engine {
+                    parser
+                        .set_wasm_store(tree_sitter::WasmStore::new(engine.clone()).unwrap())
+                        .unwrap();
+                }
+                Ok(parser)
+            };
+            let parse_file = |parser: &mut Parser,
+                              path: &Path,
+                              language: &Language|
+             -> Result<parse::ParseResult> {
                 parser
-                    .set_language(&language)
+                    .set_language(language)
                     .context("incompatible language")?;
 
                 let opts = ParseFileOptions {
                     language: language.clone(),
                     path,
-                    edits: &edits
-                        .iter()
-                        .map(std::string::String::as_str)
-                        .collect::<Vec<&str>>(),
+                    edits: &edits,
                     max_path_length,
                     output,
                     print_time: time,
@@ -580,20 +646,53 @@ fn run() -> Result<()> {
                     open_log: parse_options.open_log,
                 };
 
-                let parse_result = parse::parse_file_at_path(&mut parser, &opts)?;
+                parse::parse_file_at_path(parser, &opts)
+            };
 
-                if should_track_stats {
-                    stats.total_parses += 1;
-                    if parse_result.successful {
-                        stats.successful_parses += 1;
+            if jobs > 1 {
+                // Languages are loaded up front, because the loader can't be shared
+                // between threads.
+                let files = paths
+                    .into_iter()
+                    .map(|path| {
+                        let language = loader.select_language(
+                            Path::new(&path),
+                            &current_dir,
+                            parse_options.scope.as_deref(),
+                        )?;
+                        Ok((path, language))
+                    })
+                    .collect::<Result<Vec<_>>>()?;
+
+                let start = Instant::now();
+                let results = parse::parse_in_parallel(
+                    &files,
+                    jobs,
+                    new_parser,
+                    |parser, (path, language)| parse_file(parser, Path::new(path), language),
+                )?;
+                stats.elapsed = Some(start.elapsed());
+
+                for ((path, _), parse_result) in files.iter().zip(results) {
+                    if should_track_stats {
+                        stats.record(path, &parse_result);
                     }
-                    if let Some(duration) = parse_result.duration {
-                        stats.total_bytes += parse_result.bytes;
-                        stats.total_duration += duration;
+                    has_error |= !parse_result.successful;
+                }
+            } else {
+                let mut parser = new_parser()?;
+                for path in paths {
+                    let language = loader.select_language(
+                        Path::new(&path),
+                        &current_dir,
+                        parse_options.scope.as_deref(),
+                    )?;
+                    let parse_result = parse_file(&mut parser, Path::new(&path), &language)?;
+                    if should_track_stats {
+                        stats.record(&path, &parse_result);
                     }
+                    has_error |= !parse_result.successful;
                 }
-
-                has_error |= !parse_result.successful;
             }
 
             if should_track_stats {
@@ -614,16 +713,25 @@ fn run() -> Result<()> {
 
             loader.use_debug_build(test_options.debug_build);
 
-            let mut parser = Parser::new();
-
             #[cfg(feature = "wasm")]
-            if test_options.wasm {
+            let wasm_engine = test_options.wasm.then(|| {
                 let engine = tree_sitter::wasmtime::Engine::default();
-                parser
-                    .set_wasm_store(tree_sitter::WasmStore::new(engine.clone()).unwrap())
-                    .unwrap();
-                loader.use_wasm(engine);
-            }
+                loader.use_wasm(engine.clone());
+                engine
+            });
+
+            let new_parser = || -> Result<Parser> {
+                #[allow(unused_mut)]
+                let mut parser = Parser::new();
+                #[cfg(feature = "wasm")]
+                if let Some(engine) = &wasm_engine {
+                    parser
+                        .set_wasm_store(tree_sitter::WasmStore::new(engine.clone()).unwrap())
+                        .unwrap();
+                }
+                Ok(parser)
+            };
+            let mut parser = new_parser()?;
 
             let languages = loader.languages_at_path(&current_dir)?;
             let language = &languages
@@ -647,9 +755,10 @@ fn run() -> Result<()> {
                     update: test_options.update,
                     open_log: test_options.open_log,
                     languages: languages.iter().map(|(l, n)| (n.as_str(), l)).collect(),
+                    jobs: job_count(test_options.jobs),
                 };
 
-                test::run_tests_at_path(&mut parser, &mut opts)?;
+                test::run_tests_at_path(&mut parser, &mut opts, new_parser)?;
             }
 
             // Check that all of the queries are valid.
@@ -712,6 +821,9 @@ fn run() -> Result<()> {
                 query_options.test,
                 query_options.quiet,
                 query_options.time,
+                query_options.stats,
+                job_count(query_options.jobs),
+                query_options.ordered,
             )?;
         }
 
@@ -830,6 +942,9 @@ fn run() -> Result<()> {
             let loader_config = config.get()?;
             loader.find_all_languages(&loader_config)?;
             let paths = collect_paths(tags_options.paths_file.as_deref(), tags_options.paths)?;
+            if tags_options.scope.is_none() {
+                loader.preload_languages_for_paths(&paths)?;
+            }
             tags::generate_tags(
                 &loader,
                 &config.get()?,
@@ -837,6 +952,8 @@ fn run() -> Result<()> {
                 &paths,
                 tags_options.quiet,
                 tags_options.time,
+                job_count(tags_options.jobs),
+                tags_options.ordered,
             )?;
         }
 
@@ -909,6 +1026,16 @@ const fn get_styles() -> clap::builder::Styles {
         .placeholder(Style::new().fg_color(Some(Color::Ansi(AnsiColor::White))))
 }
 
+// The number of threads to use for a `--jobs` argument. Zero means one thread for
+// each available core.
+fn job_count(jobs: Option<usize>) -> usize {
+    match jobs {
+        Some(0) => std::thread::available_parallelism().map_or(1, usize::from),
+        Some(jobs) => jobs,
+        None => 1,
+    }
+}
+
 fn collect_paths(paths_file: Option<&str>, paths: Option<Vec<String>>) -> Result<Vec<String>> {
     if let Some(paths_file) = paths_file {
         return Ok(fs::read_to_string(paths_file)
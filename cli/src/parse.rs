@@ -2,9 +2,9 @@ use super::util;
 use anyhow::{anyhow, Context, Result};
 use std::io::{self, Write};
 use std::path::Path;
-use std::sync::atomic::AtomicUsize;
+use std::sync::atomic::{AtomicBool, AtomicUsize, Ordering};
 use std::time::{Duration, Instant};
-use std::{fmt, fs, usize};
+use std::{fmt, fs, thread, usize};
 use tree_sitter::{ffi, InputEdit, Language, LogType, Parser, Point, Tree};
 
 #[derive(Debug)]
@@ -20,11 +20,50 @@ pub struct Stats {
     pub total_parses: usize,
     pub total_bytes: usize,
     pub total_duration: Duration,
+    /// The time between the start of the first parse and the end of the last
+    /// one, if the files were parsed in parallel.
+    pub elapsed: Option<Duration>,
+    durations: Vec<Duration>,
+    slowest_file: Option<(String, Duration)>,
+}
+
+impl Stats {
+    pub fn record(&mut self, path: &str, result: &ParseResult) {
+        self.total_parses += 1;
+        if result.successful {
+            self.successful_parses += 1;
+        }
+        if let Some(duration) = result.duration {
+            self.total_bytes += result.bytes;
+            self.total_duration += duration;
+            self.durations.push(duration);
+            if self
+                .slowest_file
+                .as_ref()
+                .map_or(true, |(_, slowest)| duration > *slowest)
+            {
+                self.slowest_file = Some((path.to_string(), duration));
+            }
+        }
+    }
+
+    fn duration_percentile(sorted_durations: &[Duration], percentile: usize) -> Duration {
+        let index = (sorted_durations.len() * percentile).div_ceil(100).max(1) - 1;
+        sorted_durations[index.min(sorted_durations.len() - 1)]
+    }
+}
+
+fn bytes_per_ms(bytes: usize, duration: Duration) -> u128 {
+    let duration_us = duration.as_micros();
+    if duration_us != 0 {
+        ((bytes as u128) * 1_000) / duration_us
+    } else {
+        0
+    }
 }
 
 impl fmt::Display for Stats {
     fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
-        let duration_us = self.total_duration.as_micros();
         writeln!(
             f,
             "Total parses: {}; successful parses: {}; failed parses: {}; success percentage: {:.2}%; average speed: {} bytes/ms",
@@ -32,12 +71,30 @@ impl fmt::Display for Stats {
             self.successful_parses,
             self.total_parses - self.successful_parses,
             ((self.successful_parses as f64) / (self.total_parses as f64)) * 100.0,
-            if duration_us != 0 {
-                ((self.total_bytes as u128) * 1_000) / duration_us
-            } else {
-                0
-            }
-        )
+            bytes_per_ms(self.total_bytes, self.total_duration),
+        )?;
+        if let Some(elapsed) = self.elapsed {
+            writeln!(
+                f,
+                "Elapsed time: {:.2} ms; throughput: {} bytes/ms",
+                elapsed.as_micros() as f64 / 1e3,
+                bytes_per_ms(self.total_bytes, elapsed),
+            )?;
+        }
+        if let Some((path, slowest)) = &self.slowest_file {
+            let mut durations = self.durations.clone();
+            durations.sort_unstable();
+            let ms = |duration: Duration| duration.as_micros() as f64 / 1e3;
+            writeln!(
+                f,
+                "Parse times: p50 {:.2} ms; p90 {:.2} ms; p99 {:.2} ms; max {:.2} ms ({path})",
+                ms(Self::duration_percentile(&durations, 50)),
+                ms(Self::duration_percentile(&durations, 90)),
+                ms(Self::duration_percentile(&durations, 99)),
+                ms(*slowest),
+            )?;
+        }
+        Ok(())
     }
 }
 
@@ -376,6 +433,61 @@ pub fn parse_file_at_path(parser: &mut Parser, opts: &ParseFileOptions) -> Resul
     })
 }
 
+/// Parse each of the given items on a pool of `jobs` threads, each of which uses its
+/// own parser, created by `new_parser`. The results are returned in the same order as
+/// the items, but the parses finish, and print their output, in an arbitrary order.
+/// If any parse fails, no more parses are started, and the first error is returned.
+pub fn parse_in_parallel<T, F>(
+    items: &[T],
+    jobs: usize,
+    new_parser: impl Fn() -> Result<Parser> + Sync,
+    parse: F,
+) -> Result<Vec<ParseResult>>
+where
+    T: Sync,
+    F: Fn(&mut Parser, &T) -> Result<ParseResult> + Sync,
+{
+    let next_index = AtomicUsize::new(0);
+    let failed = AtomicBool::new(false);
+    let run = || -> Result<Vec<(usize, ParseResult)>> {
+        let mut parser = new_parser()?;
+        let mut results = Vec::new();
+        while !failed.load(Ordering::Relaxed) {
+            let index = next_index.fetch_add(1, Ordering::Relaxed);
+            let Some(item) = items.get(index) else { break };
+            match parse(&mut parser, item) {
+                Ok(result) => results.push((index, result)),
+                Err(error) => {
+                    failed.store(true, Ordering::Relaxed);
+                    return Err(error);
+                }
+            }
+        }
+        Ok(results)
+    };
+
+    let thread_results = thread::scope(|scope| {
+        let handles = (0..jobs.clamp(1, items.len().max(1)))
+            .map(|_| scope.spawn(run))
+            .collect::<Vec<_>>();
+        handles
+            .into_iter()
+            .map(|handle| {
+                handle
+                    .join()
+                    .unwrap_or_else(|e| std::panic::resume_unwind(e))
+            })
+            .collect::<Vec<_>>()
+    });
+
+    let mut results = Vec::with_capacity(items.len());
+    for thread_result in thread_results {
+        results.extend(thread_result?);
+    }
+    results.sort_unstable_by_key(|(index, _)| *index);
+    Ok(results.into_iter().map(|(_, result)| result).collect())
+}
+
 pub fn perform_edit(tree: &mut Tree, input: &mut Vec<u8>, edit: &Edit) -> Result<InputEdit> {
     let start_byte = edit.position;
     let old_end_byte = edit.position + edit.deleted_length;
@@ -1,4 +1,4 @@
-use crate::query_testing;
+use crate::{query_testing, util};
 use anyhow::{Context, Result};
 use std::{
     fs,
@@ -20,32 +20,40 @@ pub fn query_files_at_paths(
     should_test: bool,
     quiet: bool,
     print_time: bool,
+    print_stats: bool,
+    jobs: usize,
+    ordered_output: bool,
 ) -> Result<()> {
-    let stdout = io::stdout();
-    let mut stdout = stdout.lock();
-
     let query_source = fs::read_to_string(query_path)
         .with_context(|| format!("Error reading query file {query_path:?}"))?;
     let query = Query::new(language, &query_source).with_context(|| "Query compilation failed")?;
 
-    let mut query_cursor = QueryCursor::new();
-    if let Some(range) = byte_range {
-        query_cursor.set_byte_range(range);
-    }
-    if let Some(range) = point_range {
-        query_cursor.set_point_range(range);
-    }
+    // Each thread has its own parser and query cursor.
+    let init = || -> Result<(Parser, QueryCursor)> {
+        let mut query_cursor = QueryCursor::new();
+        query_cursor.set_pattern_stats_enabled(print_stats);
+        if let Some(range) = byte_range.clone() {
+            query_cursor.set_byte_range(range);
+        }
+        if let Some(range) = point_range.clone() {
+            query_cursor.set_point_range(range);
+        }
 
-    let mut parser = Parser::new();
-    parser.set_language(language)?;
+        let mut parser = Parser::new();
+        parser.set_language(language)?;
+        Ok((parser, query_cursor))
+    };
 
-    for path in paths {
+    let query_file = |(parser, query_cursor): &mut (Parser, QueryCursor),
+                      path: &String,
+                      mut stdout: &mut Vec<u8>|
+     -> Result<()> {
         let mut results = Vec::new();
 
         writeln!(&mut stdout, "{path}")?;
 
         let source_code =
-            fs::read(&path).with_context(|| format!("Error reading source file {path:?}"))?;
+            fs::read(path).with_context(|| format!("Error reading source file {path:?}"))?;
         let tree = parser.parse(&source_code, None).unwrap();
 
         let start = Instant::now();
@@ -111,12 +119,59 @@ pub fn query_files_at_paths(
             )?;
         }
         if should_test {
-            query_testing::assert_expected_captures(&results, path, &mut parser, language)?;
+            query_testing::assert_expected_captures(&results, path.clone(), parser, language)?;
         }
         if print_time {
             writeln!(&mut stdout, "{:?}", start.elapsed())?;
         }
-    }
+        if print_stats {
+            write_pattern_stats(&mut stdout, &query, &query_source, query_cursor)?;
+        }
+        Ok(())
+    };
+
+    util::process_in_parallel(
+        &paths,
+        jobs,
+        ordered_output,
+        &mut io::stdout().lock(),
+        init,
+        query_file,
+    )
+}
 
+// Print the patterns that did the most work while the query was executed, which are
+// usually the ones to rewrite when a query is slow.
+fn write_pattern_stats(
+    stdout: &mut impl Write,
+    query: &Query,
+    query_source: &str,
+    query_cursor: &QueryCursor,
+) -> Result<()> {
+    let mut stats = (0..query.pattern_count())
+        .map(|i| (i, query_cursor.pattern_stats(i)))
+        .filter(|(_, stats)| stats.started_state_count > 0)
+        .collect::<Vec<_>>();
+    stats.sort_by_key(|(i, stats)| {
+        (
+            std::cmp::Reverse(stats.started_state_count + stats.copied_state_count),
+            *i,
+        )
+    });
+
+    writeln!(stdout, "  pattern stats:")?;
+    for (i, stats) in stats {
+        let row = query_source[..query.start_byte_for_pattern(i)]
+            .matches('\n')
+            .count();
+        writeln!(
+            stdout,
+            "    pattern: {i:>2}, row: {row:>3}, started: {}, copied: {}, dropped: {}, capture lists: {}",
+            stats.started_state_count,
+            stats.copied_state_count,
+            stats.dropped_state_count,
+            stats.capture_list_count,
+        )?;
+    }
     Ok(())
 }
@@ -14,6 +14,8 @@ pub fn generate_tags(
     paths: &[String],
     quiet: bool,
     time: bool,
+    jobs: usize,
+    ordered_output: bool,
 ) -> Result<()> {
     let mut lang = None;
     if let Some(scope) = scope {
@@ -23,26 +25,28 @@ pub fn generate_tags(
         }
     }
 
-    let mut context = TagsContext::new();
     let cancellation_flag = util::cancel_on_signal();
-    let stdout = io::stdout();
-    let mut stdout = stdout.lock();
 
-    for path in paths {
-        let path = Path::new(&path);
-        let (language, language_config) = match lang.clone() {
-            Some(v) => v,
-            None => {
-                if let Some(v) = loader.language_configuration_for_file_name(path)? {
-                    v
-                } else {
-                    eprintln!("{}", util::lang_not_found_for_path(path, loader_config));
-                    continue;
+    let generate_tags_for_file =
+        |context: &mut TagsContext, path: &String, mut stdout: &mut Vec<u8>| -> Result<()> {
+            let path = Path::new(&path);
+            let (language, language_config) = match lang.clone() {
+                Some(v) => v,
+                None => {
+                    if let Some(v) = loader.language_configuration_for_file_name(path)? {
+                        v
+                    } else {
+                        eprintln!("{}", util::lang_not_found_for_path(path, loader_config));
+                        return Ok(());
+                    }
                 }
-            }
-        };
+            };
+
+            let Some(tags_config) = language_config.tags_config(language)? else {
+                eprintln!("No tags config found for path {path:?}");
+                return Ok(());
+            };
 
-        if let Some(tags_config) = language_config.tags_config(language)? {
             let indent = if paths.len() > 1 {
                 if !quiet {
                     writeln!(&mut stdout, "{}", path.to_string_lossy())?;
@@ -84,10 +88,17 @@ pub fn generate_tags(
             if time {
                 writeln!(&mut stdout, "{indent}time: {}ms", t0.elapsed().as_millis(),)?;
             }
-        } else {
-            eprintln!("No tags config found for path {path:?}");
-        }
-    }
+            Ok(())
+        };
 
-    Ok(())
+    // Languages and tags configurations are loaded the first time that any
+    // thread needs them, and are then shared by all of the threads.
+    util::process_in_parallel(
+        paths,
+        jobs,
+        ordered_output,
+        &mut io::stdout().lock(),
+        || Ok(TagsContext::new()),
+        generate_tags_for_file,
+    )
 }
@@ -8,11 +8,14 @@ use regex::bytes::{Regex as ByteRegex, RegexBuilder as ByteRegexBuilder};
 use regex::Regex;
 use std::collections::BTreeMap;
 use std::ffi::OsStr;
+use std::fmt;
 use std::fs;
 use std::io::{self, Write};
 use std::path::{Path, PathBuf};
 use std::str;
-use tree_sitter::{format_sexp, Language, LogType, Parser, Query};
+use std::sync::atomic::{AtomicUsize, Ordering};
+use std::sync::Mutex;
+use tree_sitter::{format_sexp, Language, LogType, Node, Parser, Query};
 use walkdir::WalkDir;
 
 lazy_static! {
@@ -98,9 +101,49 @@ pub struct TestOptions<'a> {
     pub update: bool,
     pub open_log: bool,
     pub languages: BTreeMap<&'a str, &'a Language>,
+    pub jobs: usize,
 }
 
-pub fn run_tests_at_path(parser: &mut Parser, opts: &mut TestOptions) -> Result<()> {
+/// A file of corpus tests, which is the unit of work when running tests in
+/// parallel, along with the headings of any directories that are entered
+/// before it.
+struct TestFile {
+    index: usize,
+    headings: String,
+    indent_level: i32,
+    entry: TestEntry,
+}
+
+/// The results of running the tests in one file.
+#[derive(Default)]
+struct TestFileResults {
+    failures: Vec<(String, String, String)>,
+    has_parse_errors: bool,
+}
+
+/// The error used to stop running tests in parallel once a `:fail-fast` test fails.
+#[derive(Debug)]
+struct FailFast;
+
+impl fmt::Display for FailFast {
+    fn fmt(&self, f: &mut fmt::Formatter) -> fmt::Result {
+        write!(f, "a fail-fast test failed")
+    }
+}
+
+impl std::error::Error for FailFast {}
+
+/// Run the corpus tests at the configured path.
+///
+/// When `opts.jobs` is greater than one, the test files are run in parallel,
+/// each thread using its own parser created by `new_parser`. The output is
+/// still reported in the order of the files. The debug options always run the
+/// tests serially with the given parser.
+pub fn run_tests_at_path(
+    parser: &mut Parser,
+    opts: &mut TestOptions,
+    new_parser: impl Fn() -> Result<Parser> + Sync,
+) -> Result<()> {
     let test_entry = parse_tests(&opts.path)?;
     let mut _log_session = None;
 
@@ -116,17 +159,26 @@ pub fn run_tests_at_path(parser: &mut Parser, opts: &mut TestOptions) -> Result<
     }
 
     let mut failures = Vec::new();
-    let mut corrected_entries = Vec::new();
     let mut has_parse_errors = false;
-    run_tests(
-        parser,
-        test_entry,
-        opts,
-        0,
-        &mut failures,
-        &mut corrected_entries,
-        &mut has_parse_errors,
-    )?;
+    if opts.jobs > 1 && !opts.debug && !opts.debug_graph {
+        let results = run_tests_in_parallel(parser.language(), test_entry, opts, new_parser)?;
+        for results in results {
+            failures.extend(results.failures);
+            has_parse_errors |= results.has_parse_errors;
+        }
+    } else {
+        let mut corrected_entries = Vec::new();
+        run_tests(
+            parser,
+            &test_entry,
+            opts,
+            0,
+            &mut failures,
+            &mut corrected_entries,
+            &mut has_parse_errors,
+            &mut io::stdout(),
+        )?;
+    }
 
     parser.stop_printing_dot_graphs();
 
@@ -177,6 +229,102 @@ pub fn run_tests_at_path(parser: &mut Parser, opts: &mut TestOptions) -> Result<
     }
 }
 
+fn run_tests_in_parallel(
+    language: Option<Language>,
+    test_entry: TestEntry,
+    opts: &TestOptions,
+    new_parser: impl Fn() -> Result<Parser> + Sync,
+) -> Result<Vec<TestFileResults>> {
+    let mut files = Vec::new();
+    let mut headings = String::new();
+    collect_test_files(test_entry, 0, &mut headings, &mut files);
+
+    let results = Mutex::new(Vec::new());
+    let fail_fast_index = AtomicUsize::new(usize::MAX);
+    let result = util::process_in_parallel(
+        &files,
+        opts.jobs,
+        true,
+        &mut io::stdout(),
+        &new_parser,
+        |parser, file, output| {
+            // Each file starts with the default language, so that the results
+            // don't depend on which files were run before it on the same thread.
+            if let Some(language) = &language {
+                parser.set_language(language)?;
+            }
+            let mut file_results = TestFileResults::default();
+            output.write_all(file.headings.as_bytes())?;
+            let should_continue = run_tests(
+                parser,
+                &file.entry,
+                opts,
+                file.indent_level,
+                &mut file_results.failures,
+                &mut Vec::new(),
+                &mut file_results.has_parse_errors,
+                output,
+            )?;
+            results.lock().unwrap().push((file.index, file_results));
+            if should_continue {
+                Ok(())
+            } else {
+                fail_fast_index.fetch_min(file.index, Ordering::Relaxed);
+                Err(FailFast.into())
+            }
+        },
+    );
+    if let Err(error) = result {
+        if !error.is::<FailFast>() {
+            return Err(error);
+        }
+    }
+    print!("{headings}");
+
+    // The files after a fail-fast test failed may have been run, but their
+    // output is not shown, so their failures are not reported either.
+    let fail_fast_index = fail_fast_index.into_inner();
+    let mut results = results.into_inner().unwrap();
+    results.retain(|(index, _)| *index <= fail_fast_index);
+    results.sort_unstable_by_key(|(index, _)| *index);
+    Ok(results.into_iter().map(|(_, results)| results).collect())
+}
+
+/// Split a tree of tests into the files that it contains. The headings of
+/// the directories are attached to the first file that follows them, and
+/// any headings after the last file are left in `headings`.
+fn collect_test_files(
+    test_entry: TestEntry,
+    indent_level: i32,
+    headings: &mut String,
+    files: &mut Vec<TestFile>,
+) {
+    match test_entry {
+        TestEntry::Group {
+            file_path: Some(_), ..
+        } => files.push(TestFile {
+            index: files.len(),
+            headings: std::mem::take(headings),
+            indent_level,
+            entry: test_entry,
+        }),
+        TestEntry::Group { name, children, .. } => {
+            if children.is_empty() {
+                return;
+            }
+            if indent_level > 0 {
+                headings.push_str(&"  ".repeat(indent_level as usize));
+                headings.push_str(&name);
+                headings.push_str(":\n");
+            }
+            for child in children {
+                collect_test_files(child, indent_level + 1, headings, files);
+            }
+        }
+        TestEntry::Example { .. } => {}
+    }
+}
+
 pub fn check_queries_at_path(language: &Language, path: &Path) -> Result<()> {
     if path.exists() {
         for entry in WalkDir::new(path)
@@ -224,14 +372,16 @@ pub fn print_diff(actual: &str, expected: &str) {
     println!();
 }
 
+#[allow(clippy::too_many_arguments)]
 fn run_tests(
     parser: &mut Parser,
-    test_entry: TestEntry,
-    opts: &mut TestOptions,
+    test_entry: &TestEntry,
+    opts: &TestOptions,
     mut indent_level: i32,
     failures: &mut Vec<(String, String, String)>,
     corrected_entries: &mut Vec<(String, String, String, usize, usize)>,
     has_parse_errors: &mut bool,
+    output_buffer: &mut impl Write,
 ) -> Result<bool> {
     match test_entry {
         TestEntry::Example {
@@ -243,15 +393,15 @@ fn run_tests(
             has_fields,
             attributes,
         } => {
-            print!("{}", "  ".repeat(indent_level as usize));
+            write!(output_buffer, "{}", "  ".repeat(indent_level as usize))?;
 
             if attributes.skip {
-                println!(" {}", Colour::Yellow.paint(&name));
+                writeln!(output_buffer, " {}", Colour::Yellow.paint(name))?;
                 return Ok(true);
             }
 
             if !attributes.platform {
-                println!(" {}", Colour::Purple.paint(&name));
+                writeln!(output_buffer, " {}", Colour::Purple.paint(name))?;
                 return Ok(true);
             }
 
@@ -263,80 +413,92 @@ fn run_tests(
                         .ok_or_else(|| anyhow!("Language not found: {language_name}"))?;
                     parser.set_language(language)?;
                 }
-                let tree = parser.parse(&input, None).unwrap();
+                let tree = parser.parse(input, None).unwrap();
 
                 if attributes.error {
                     if tree.root_node().has_error() {
-                        println!(" {}", Colour::Green.paint(&name));
+                        writeln!(output_buffer, " {}", Colour::Green.paint(name))?;
                     } else {
-                        println!(" {}", Colour::Red.paint(&name));
+                        writeln!(output_buffer, " {}", Colour::Red.paint(name))?;
                     }
 
                     if attributes.fail_fast {
                         return Ok(false);
                     }
                 } else {
-                    let mut actual = tree.root_node().to_sexp();
-                    if !has_fields {
-                        actual = strip_sexp_fields(&actual);
-                    }
-
-                    if actual == output {
-                        println!("✓ {}", Colour::Green.paint(&name));
-                        if opts.update {
-                            let input = String::from_utf8(input.clone()).unwrap();
-                            let output = format_sexp(&output, 0);
-                            corrected_entries.push((
-                                name.clone(),
-                                input,
-                                output,
-                                header_delim_len,
-                                divider_delim_len,
-                            ));
+                    // The tree is only rendered as a string when it doesn't match
+                    // the expected output, in order to show the difference.
+                    let root_node = tree.root_node();
+                    let actual = match sexp_matches(root_node, output, *has_fields) {
+                        Some(true) => None,
+                        _ => {
+                            let mut actual = root_node.to_sexp();
+                            if !has_fields {
+                                actual = strip_sexp_fields(&actual);
+                            }
+                            (actual != *output).then_some(actual)
                         }
-                    } else {
-                        if opts.update {
-                            let input = String::from_utf8(input.clone()).unwrap();
-                            let expected_output = format_sexp(&output, 0);
-                            let actual_output = format_sexp(&actual, 0);
-
-                            // Only bail early before updating if the actual is not the output, sometimes
-                            // users want to test cases that are intended to have errors, hence why this
-                            // check isn't shown above
-                            if actual.contains("ERROR") || actual.contains("MISSING") {
-                                *has_parse_errors = true;
-
-                                // keep the original `expected` output if the actual output has an error
-                                corrected_entries.push((
-                                    name.clone(),
-                                    input,
-                                    expected_output,
-                                    header_delim_len,
-                                    divider_delim_len,
-                                ));
-                            } else {
+                    };
+
+                    match actual {
+                        None => {
+                            writeln!(output_buffer, "✓ {}", Colour::Green.paint(name))?;
+                            if opts.update {
+                                let input = String::from_utf8(input.clone()).unwrap();
+                                let output = format_sexp(&output, 0);
                                 corrected_entries.push((
                                     name.clone(),
                                     input,
-                                    actual_output,
-                                    header_delim_len,
-                                    divider_delim_len,
+                                    output,
+                                    *header_delim_len,
+                                    *divider_delim_len,
                                 ));
-                                println!("✓ {}", Colour::Blue.paint(&name));
                             }
-                        } else {
-                            println!("✗ {}", Colour::Red.paint(&name));
                         }
-                        failures.push((name.clone(), actual, output.clone()));
+                        Some(actual) => {
+                            if opts.update {
+                                let input = String::from_utf8(input.clone()).unwrap();
+                                let expected_output = format_sexp(&output, 0);
+                                let actual_output = format_sexp(&actual, 0);
+
+                                // Only bail early before updating if the actual is not the output, sometimes
+                                // users want to test cases that are intended to have errors, hence why this
+                                // check isn't shown above
+                                if actual.contains("ERROR") || actual.contains("MISSING") {
+                                    *has_parse_errors = true;
+
+                                    // keep the original `expected` output if the actual output has an error
+                                    corrected_entries.push((
+                                        name.clone(),
+                                        input,
+                                        expected_output,
+                                        *header_delim_len,
+                                        *divider_delim_len,
+                                    ));
+                                } else {
+                                    corrected_entries.push((
+                                        name.clone(),
+                                        input,
+                                        actual_output,
+                                        *header_delim_len,
+                                        *divider_delim_len,
+                                    ));
+                                    writeln!(output_buffer, "✓ {}", Colour::Blue.paint(name))?;
+                                }
+                            } else {
+                                writeln!(output_buffer, "✗ {}", Colour::Red.paint(name))?;
+                            }
+                            failures.push((name.clone(), actual, output.clone()));
 
-                        if attributes.fail_fast {
-                            // return value of false means to fail fast
-                            return Ok(false);
-                        }
+                            if attributes.fail_fast {
+                                // return value of false means to fail fast
+                                return Ok(false);
+                            }
 
-                        if i == attributes.languages.len() - 1 {
-                            // reset back to first language
-                            parser.set_language(opts.languages.values().next().unwrap())?;
+                            if i == attributes.languages.len() - 1 {
+                                // reset back to first language
+                                parser.set_language(opts.languages.values().next().unwrap())?;
+                            }
                         }
                     }
                 }
@@ -344,10 +506,10 @@ fn run_tests(
         }
         TestEntry::Group {
             name,
-            mut children,
+            children,
             file_path,
         } => {
-            children.retain(|child| {
+            let children = children.iter().filter(|child| {
                 if let TestEntry::Example { name, .. } = child {
                     if let Some(filter) = opts.filter {
                         if !name.contains(filter) {
@@ -367,14 +529,15 @@ fn run_tests(
                 }
                 true
             });
+            let children = children.collect::<Vec<_>>();
 
             if children.is_empty() {
                 return Ok(true);
             }
 
             if indent_level > 0 {
-                print!("{}", "  ".repeat(indent_level as usize));
-                println!("{name}:");
+                write!(output_buffer, "{}", "  ".repeat(indent_level as usize))?;
+                writeln!(output_buffer, "{name}:")?;
             }
 
             let failure_count = failures.len();
@@ -389,6 +552,7 @@ fn run_tests(
                     failures,
                     corrected_entries,
                     has_parse_errors,
+                    output_buffer,
                 )? {
                     // fail fast
                     return Ok(false);
@@ -397,7 +561,7 @@ fn run_tests(
 
             if let Some(file_path) = file_path {
                 if opts.update && failures.len() - failure_count > 0 {
-                    write_tests(&file_path, corrected_entries)?;
+                    write_tests(file_path, corrected_entries)?;
                 }
                 corrected_entries.clear();
             }
@@ -476,6 +640,68 @@ pub fn strip_sexp_fields(sexp: &str) -> String {
     SEXP_FIELD_REGEX.replace_all(sexp, " (").to_string()
 }
 
+/// Check if the S-expression of a syntax tree, as rendered by `Node::to_sexp`
+/// and with its fields stripped unless `include_fields` is set, is equal to
+/// the given expected output.
+///
+/// The tree is walked with a cursor and compared with the expected output as
+/// it goes, without rendering it. Errors, missing nodes and anonymous nodes
+/// with children are not rendered as plain `(kind ...)` lists, so `None` is
+/// returned for trees that contain them.
+#[must_use]
+pub fn sexp_matches(node: Node, expected: &str, include_fields: bool) -> Option<bool> {
+    fn eat(rest: &mut &str, prefix: &str) -> bool {
+        rest.strip_prefix(prefix)
+            .map(|remainder| *rest = remainder)
+            .is_some()
+    }
+
+    let mut rest = expected;
+    let mut cursor = node.walk();
+    if !node.is_named() || node.is_error() || node.is_missing() {
+        return None;
+    }
+    if !eat(&mut rest, "(") || !eat(&mut rest, node.kind()) {
+        return Some(false);
+    }
+
+    loop {
+        if !cursor.goto_first_child() {
+            loop {
+                if cursor.node().is_named() && !eat(&mut rest, ")") {
+                    return Some(false);
+                }
+                if cursor.goto_next_sibling() {
+                    break;
+                }
+                if !cursor.goto_parent() {
+                    return Some(rest.is_empty());
+                }
+            }
+        }
+
+        let node = cursor.node();
+        if node.is_error() || node.is_missing() {
+            return None;
+        }
+        if node.is_named() {
+            if !eat(&mut rest, " ") {
+                return Some(false);
+            }
+            if let Some(field_name) = cursor.field_name().filter(|_| include_fields) {
+                if !eat(&mut rest, field_name) || !eat(&mut rest, ": ") {
+                    return Some(false);
+                }
+            }
+            if !eat(&mut rest, "(") || !eat(&mut rest, node.kind()) {
+                return Some(false);
+            }
+        } else if node.child_count() > 0 {
+            return None;
+        }
+    }
+}
+
 #[must_use]
 pub fn strip_points(sexp: &str) -> String {
     POINT_REGEX.replace_all(sexp, "").to_string()
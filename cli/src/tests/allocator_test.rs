@@ -0,0 +1,340 @@
+use super::helpers::{allocations, fixtures::get_language};
+use std::{
+    cell::Cell,
+    collections::HashSet,
+    ffi::{c_char, c_void},
+    ptr,
+    rc::Rc,
+    sync::{
+        atomic::{AtomicUsize, Ordering::SeqCst},
+        Mutex,
+    },
+};
+use tree_sitter::{ffi, InputEdit, Parser, Point, Query, QueryCursor};
+
+const JSON_CODE: &str = r#"{"a": [1, 2, {"b": null}], "c": "d", "e": [true, false]}"#;
+
+extern "C" {
+    fn malloc(size: usize) -> *mut c_void;
+    fn calloc(count: usize, size: usize) -> *mut c_void;
+    fn realloc(ptr: *mut c_void, size: usize) -> *mut c_void;
+    fn free(ptr: *mut c_void);
+}
+
+/// The payload of a `TSAllocator` that keeps track of the memory that was
+/// allocated through it.
+#[derive(Default)]
+struct AllocationCounter {
+    allocation_count: AtomicUsize,
+    foreign_free_count: AtomicUsize,
+    outstanding_allocations: Mutex<HashSet<usize>>,
+}
+
+impl AllocationCounter {
+    fn allocator(&self) -> ffi::TSAllocator {
+        ffi::TSAllocator {
+            payload: (self as *const Self).cast_mut().cast(),
+            malloc: Some(counting_malloc),
+            calloc: Some(counting_calloc),
+            realloc: Some(counting_realloc),
+            free: Some(counting_free),
+        }
+    }
+
+    fn allocation_count(&self) -> usize {
+        self.allocation_count.load(SeqCst)
+    }
+
+    fn outstanding_count(&self) -> usize {
+        self.outstanding_allocations.lock().unwrap().len()
+    }
+
+    fn record_alloc(&self, ptr: *mut c_void) {
+        self.allocation_count.fetch_add(1, SeqCst);
+        self.outstanding_allocations
+            .lock()
+            .unwrap()
+            .insert(ptr as usize);
+    }
+
+    fn record_dealloc(&self, ptr: *mut c_void) {
+        if !ptr.is_null()
+            && !self
+                .outstanding_allocations
+                .lock()
+                .unwrap()
+                .remove(&(ptr as usize))
+        {
+            self.foreign_free_count.fetch_add(1, SeqCst);
+        }
+    }
+
+    // All of the memory that was allocated through this counter has been freed
+    // through it, and nothing else has been freed through it.
+    fn assert_balanced(&self) {
+        assert_eq!(self.outstanding_count(), 0);
+        assert_eq!(self.foreign_free_count.load(SeqCst), 0);
+    }
+}
+
+unsafe extern "C" fn counting_malloc(payload: *mut c_void, size: usize) -> *mut c_void {
+    let result = malloc(size);
+    (*payload.cast::<AllocationCounter>()).record_alloc(result);
+    result
+}
+
+unsafe extern "C" fn counting_calloc(
+    payload: *mut c_void,
+    count: usize,
+    size: usize,
+) -> *mut c_void {
+    let result = calloc(count, size);
+    (*payload.cast::<AllocationCounter>()).record_alloc(result);
+    result
+}
+
+unsafe extern "C" fn counting_realloc(
+    payload: *mut c_void,
+    buffer: *mut c_void,
+    size: usize,
+) -> *mut c_void {
+    let counter = &*payload.cast::<AllocationCounter>();
+    counter.record_dealloc(buffer);
+    let result = realloc(buffer, size);
+    counter.record_alloc(result);
+    result
+}
+
+unsafe extern "C" fn counting_free(payload: *mut c_void, buffer: *mut c_void) {
+    (*payload.cast::<AllocationCounter>()).record_dealloc(buffer);
+    free(buffer);
+}
+
+fn parser_with_allocator(counter: &AllocationCounter) -> Parser {
+    let mut parser =
+        unsafe { Parser::from_raw(ffi::ts_parser_new_with_allocator(counter.allocator())) };
+    parser.set_language(&get_language("json")).unwrap();
+    parser
+}
+
+// Allocate and free some memory through the library, and check that it came
+// from the global allocation functions rather than from the given counter.
+fn allocates_globally(counter: &AllocationCounter) -> bool {
+    let counter_allocation_count = counter.allocation_count();
+    let global_allocation_count = allocations::allocation_count();
+    unsafe { ffi::ts_query_cursor_delete(ffi::ts_query_cursor_new()) };
+    counter.allocation_count() == counter_allocation_count
+        && allocations::allocation_count() > global_allocation_count
+}
+
+#[test]
+fn test_parsing_with_a_custom_allocator() {
+    let counter = AllocationCounter::default();
+    allocations::record(|| {
+        let mut parser = parser_with_allocator(&counter);
+        let global_allocation_count = allocations::allocation_count();
+
+        let mut tree = parser.parse(JSON_CODE, None).unwrap();
+        assert!(counter.allocation_count() > 0);
+
+        // Copies and edits of the tree allocate through the tree's allocator.
+        let tree_copy = tree.clone();
+        let start_byte = JSON_CODE.find("null").unwrap();
+        tree.edit(&InputEdit {
+            start_byte,
+            old_end_byte: start_byte + 4,
+            new_end_byte: start_byte + 5,
+            start_position: Point::new(0, start_byte),
+            old_end_position: Point::new(0, start_byte + 4),
+            new_end_position: Point::new(0, start_byte + 5),
+        });
+        let new_code = JSON_CODE.replace("null", "false");
+        let new_tree = parser.parse(&new_code, Some(&tree)).unwrap();
+        drop(tree);
+        drop(tree_copy);
+        assert_eq!(allocations::allocation_count(), global_allocation_count);
+
+        // The query cursor allocates through its own allocator.
+        let query = Query::new(&get_language("json"), "(pair key: (string) @key)").unwrap();
+        let query_allocation_count = allocations::allocation_count();
+        let cursor_counter = AllocationCounter::default();
+        let mut cursor = unsafe {
+            QueryCursor::from_raw(ffi::ts_query_cursor_new_with_allocator(
+                cursor_counter.allocator(),
+            ))
+        };
+        let match_count = cursor
+            .matches(&query, new_tree.root_node(), new_code.as_bytes())
+            .count();
+        assert_eq!(match_count, 4);
+        drop(cursor);
+        assert!(cursor_counter.allocation_count() > 0);
+        cursor_counter.assert_balanced();
+        assert_eq!(allocations::allocation_count(), query_allocation_count);
+        drop(query);
+
+        drop(new_tree);
+        drop(parser);
+    });
+    counter.assert_balanced();
+}
+
+#[test]
+fn test_callbacks_of_objects_with_a_custom_allocator_allocate_globally() {
+    let counter = AllocationCounter::default();
+    allocations::record(|| {
+        let mut parser = parser_with_allocator(&counter);
+
+        let logger_calls = Rc::new(Cell::new(0));
+        let misrouted_logger_calls = Rc::new(Cell::new(0));
+        parser.set_logger(Some(Box::new({
+            let counter: *const AllocationCounter = &counter;
+            let logger_calls = logger_calls.clone();
+            let misrouted_logger_calls = misrouted_logger_calls.clone();
+            move |_, _| {
+                logger_calls.set(logger_calls.get() + 1);
+                if !allocates_globally(unsafe { &*counter }) {
+                    misrouted_logger_calls.set(misrouted_logger_calls.get() + 1);
+                }
+            }
+        })));
+
+        let mut read_calls = 0;
+        let mut misrouted_read_calls = 0;
+        let tree = parser
+            .parse_with(
+                &mut |offset, _| {
+                    read_calls += 1;
+                    if !allocates_globally(&counter) {
+                        misrouted_read_calls += 1;
+                    }
+                    &JSON_CODE.as_bytes()[offset.min(JSON_CODE.len())..]
+                },
+                None,
+            )
+            .unwrap();
+        parser.set_logger(None);
+        assert!(read_calls > 0);
+        assert_eq!(misrouted_read_calls, 0);
+        assert!(logger_calls.get() > 0);
+        assert_eq!(misrouted_logger_calls.get(), 0);
+
+        // Regexes are compiled, matched and destroyed by the engine with the
+        // global allocation functions, even for cursors with their own allocator.
+        struct RegexProbe<'a> {
+            counter: &'a AllocationCounter,
+            call_count: usize,
+            misrouted_call_count: usize,
+        }
+
+        unsafe fn probe(payload: *mut c_void) {
+            let probe = &mut *payload.cast::<RegexProbe>();
+            probe.call_count += 1;
+            if !allocates_globally(probe.counter) {
+                probe.misrouted_call_count += 1;
+            }
+        }
+
+        unsafe extern "C" fn compile(
+            payload: *mut c_void,
+            _pattern: *const c_char,
+            _length: u32,
+        ) -> *mut c_void {
+            probe(payload);
+            Box::into_raw(Box::new(0_u8)).cast()
+        }
+
+        unsafe extern "C" fn is_match(
+            payload: *mut c_void,
+            _regex: *const c_void,
+            _text: *const c_char,
+            _length: u32,
+        ) -> bool {
+            probe(payload);
+            true
+        }
+
+        unsafe extern "C" fn destroy(payload: *mut c_void, regex: *mut c_void) {
+            probe(payload);
+            drop(Box::from_raw(regex.cast::<u8>()));
+        }
+
+        let cursor_counter = AllocationCounter::default();
+        let mut regex_probe = RegexProbe {
+            counter: &cursor_counter,
+            call_count: 0,
+            misrouted_call_count: 0,
+        };
+        let query = Query::new(
+            &get_language("json"),
+            r#"((string) @string (#match? @string "[a-z]"))"#,
+        )
+        .unwrap();
+        let mut cursor = unsafe {
+            let ptr = ffi::ts_query_cursor_new_with_allocator(cursor_counter.allocator());
+            ffi::ts_query_cursor_set_regex_engine(
+                ptr,
+                ffi::TSQueryRegexEngine {
+                    payload: ptr::addr_of_mut!(regex_probe).cast(),
+                    compile: Some(compile),
+                    is_match: Some(is_match),
+                    destroy: Some(destroy),
+                },
+            );
+            QueryCursor::from_raw(ptr)
+        };
+        let match_count = cursor
+            .matches(&query, tree.root_node(), JSON_CODE.as_bytes())
+            .count();
+        assert_eq!(match_count, 5);
+        drop(cursor);
+        assert!(regex_probe.call_count > match_count);
+        assert_eq!(regex_probe.misrouted_call_count, 0);
+        cursor_counter.assert_balanced();
+    });
+    counter.assert_balanced();
+}
+
+#[test]
+fn test_reusing_trees_created_with_a_different_allocator() {
+    let counter = AllocationCounter::default();
+    let other_counter = AllocationCounter::default();
+    allocations::record(|| {
+        let mut parser = parser_with_allocator(&counter);
+        let tree = parser.parse(JSON_CODE, None).unwrap();
+        let full_parse_allocation_count = counter.allocation_count();
+
+        // A parser with an equal allocator reuses the old tree's nodes.
+        let mut equal_parser = parser_with_allocator(&counter);
+        let reused_tree = equal_parser.parse(JSON_CODE, Some(&tree)).unwrap();
+        assert!(
+            counter.allocation_count() - full_parse_allocation_count < full_parse_allocation_count
+        );
+        assert_eq!(
+            reused_tree.root_node().to_sexp(),
+            tree.root_node().to_sexp()
+        );
+        drop(reused_tree);
+
+        // Parsers with other allocators ignore the old tree, so the new tree
+        // holds no memory from the old tree's allocator.
+        let allocation_count = counter.allocation_count();
+        let mut other_parser = parser_with_allocator(&other_counter);
+        let other_tree = other_parser.parse(JSON_CODE, Some(&tree)).unwrap();
+        let mut global_parser = Parser::new();
+        global_parser.set_language(&get_language("json")).unwrap();
+        let global_tree = global_parser.parse(JSON_CODE, Some(&tree)).unwrap();
+        assert_eq!(counter.allocation_count(), allocation_count);
+
+        drop(tree);
+        drop(parser);
+        drop(equal_parser);
+        counter.assert_balanced();
+        assert_eq!(
+            other_tree.root_node().to_sexp(),
+            global_tree.root_node().to_sexp()
+        );
+    });
+    counter.assert_balanced();
+    other_counter.assert_balanced();
+}
@@ -11,7 +11,7 @@ use super::helpers::{
 use crate::{
     generate,
     parse::perform_edit,
-    test::{parse_tests, print_diff, print_diff_key, strip_sexp_fields, TestEntry},
+    test::{parse_tests, print_diff, print_diff_key, sexp_matches, strip_sexp_fields, TestEntry},
     util,
 };
 use std::{collections::HashMap, env, fs};
@@ -387,6 +387,11 @@ fn test_feature_corpus_files() {
                     if !test.has_fields {
                         actual_output = strip_sexp_fields(&actual_output);
                     }
+                    if let Some(matches) =
+                        sexp_matches(tree.root_node(), &test.output, test.has_fields)
+                    {
+                        assert_eq!(matches, actual_output == test.output);
+                    }
                     if actual_output == test.output {
                         true
                     } else {
@@ -26,7 +26,9 @@ unsafe impl Sync for Allocation {}
 struct AllocationRecorder {
     enabled: AtomicBool,
     allocation_count: AtomicUsize,
-    outstanding_allocations: Mutex<HashMap<Allocation, usize>>,
+    outstanding_bytes: AtomicUsize,
+    peak_bytes: AtomicUsize,
+    outstanding_allocations: Mutex<HashMap<Allocation, (usize, usize)>>,
 }
 
 thread_local! {
@@ -41,76 +43,96 @@ extern "C" {
 }
 
 pub fn record<T>(f: impl FnOnce() -> T) -> T {
+    record_peak_bytes(f).0
+}
+
+/// Like [`record`], but also returns the largest number of bytes that the
+/// library had allocated at once while `f` was running.
+pub fn record_peak_bytes<T>(f: impl FnOnce() -> T) -> (T, usize) {
     RECORDER.with(|recorder| {
         recorder.enabled.store(true, SeqCst);
         recorder.allocation_count.store(0, SeqCst);
+        recorder.outstanding_bytes.store(0, SeqCst);
+        recorder.peak_bytes.store(0, SeqCst);
         recorder.outstanding_allocations.lock().unwrap().clear();
     });
 
     let value = f();
 
-    let outstanding_allocation_indices = RECORDER.with(|recorder| {
+    let (outstanding_allocation_indices, peak_bytes) = RECORDER.with(|recorder| {
         recorder.enabled.store(false, SeqCst);
         recorder.allocation_count.store(0, SeqCst);
-        recorder
+        let indices = recorder
             .outstanding_allocations
             .lock()
             .unwrap()
             .drain()
-            .map(|e| e.1)
-            .collect::<Vec<_>>()
+            .map(|e| e.1 .0)
+            .collect::<Vec<_>>();
+        (indices, recorder.peak_bytes.load(SeqCst))
     });
     assert!(
         outstanding_allocation_indices.is_empty(),
         "Leaked allocation indices: {outstanding_allocation_indices:?}"
     );
-    value
+    (value, peak_bytes)
+}
+
+/// The number of allocations that the library has made with the global
+/// allocation functions on this thread since [`record`] was called.
+pub fn allocation_count() -> usize {
+    RECORDER.with(|recorder| recorder.allocation_count.load(SeqCst))
 }
 
-fn record_alloc(ptr: *mut c_void) {
+fn record_alloc(ptr: *mut c_void, size: usize) {
     RECORDER.with(|recorder| {
         if recorder.enabled.load(SeqCst) {
             let count = recorder.allocation_count.fetch_add(1, SeqCst);
+            let bytes = recorder.outstanding_bytes.fetch_add(size, SeqCst) + size;
+            recorder.peak_bytes.fetch_max(bytes, SeqCst);
             recorder
                 .outstanding_allocations
                 .lock()
                 .unwrap()
-                .insert(Allocation(ptr), count);
+                .insert(Allocation(ptr), (count, size));
         }
     });
 }
 
-fn record_dealloc(ptr: *mut c_void) {
+fn record_dealloc(ptr: *mut c_void) -> bool {
     RECORDER.with(|recorder| {
         if recorder.enabled.load(SeqCst) {
-            recorder
+            let removed = recorder
                 .outstanding_allocations
                 .lock()
                 .unwrap()
                 .remove(&Allocation(ptr));
+            if let Some((_, size)) = removed {
+                recorder.outstanding_bytes.fetch_sub(size, SeqCst);
+                return true;
+            }
         }
-    });
+        false
+    })
 }
 
 unsafe extern "C" fn ts_record_malloc(size: usize) -> *mut c_void {
     let result = malloc(size);
-    record_alloc(result);
+    record_alloc(result, size);
     result
 }
 
 unsafe extern "C" fn ts_record_calloc(count: usize, size: usize) -> *mut c_void {
     let result = calloc(count, size);
-    record_alloc(result);
+    record_alloc(result, count * size);
     result
 }
 
 unsafe extern "C" fn ts_record_realloc(ptr: *mut c_void, size: usize) -> *mut c_void {
     let result = realloc(ptr, size);
-    if ptr.is_null() {
-        record_alloc(result);
-    } else if ptr != result {
-        record_dealloc(ptr);
-        record_alloc(result);
+    let was_recorded = !ptr.is_null() && record_dealloc(ptr);
+    if ptr.is_null() || ptr != result || was_recorded {
+        record_alloc(result, size);
     }
     result
 }
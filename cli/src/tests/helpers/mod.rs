@@ -14,6 +14,7 @@ lazy_static! {
     pub static ref LOG_GRAPH_ENABLED: bool = env::var("TREE_SITTER_LOG_GRAPHS").is_ok();
     pub static ref LANGUAGE_FILTER: Option<String> = env::var("TREE_SITTER_LANGUAGE").ok();
     pub static ref EXAMPLE_FILTER: Option<String> = env::var("TREE_SITTER_EXAMPLE").ok();
+    pub static ref TIME_BUDGETS_ENABLED: bool = env::var("TREE_SITTER_TIME_BUDGETS").is_ok();
 }
 
 lazy_static! {
@@ -482,6 +482,190 @@ fn test_highlighting_cancellation() {
     panic!("Expected an error while iterating highlighter");
 }
 
+#[test]
+fn test_highlighting_to_html_in_chunks() {
+    let mut source = "<script>\n".to_string();
+    for i in 0..100 {
+        source += &format!("function a{i}() {{ console.log('<hi>'); }}\n");
+    }
+    source += "</script>";
+    let source = source.as_bytes();
+    let attribute_callback = |highlight: Highlight| HTML_ATTRS[highlight.0].as_bytes();
+
+    let mut highlighter = Highlighter::new();
+    let mut renderer = HtmlRenderer::new();
+    let events = highlighter
+        .highlight(
+            &HTML_HIGHLIGHT,
+            source,
+            None,
+            &test_language_for_injection_string,
+        )
+        .unwrap();
+    renderer
+        .render(events, source, &attribute_callback)
+        .unwrap();
+    let expected = renderer.html.clone();
+
+    for chunk_size in [1, 50, 1024, usize::MAX] {
+        let mut output = Vec::new();
+        let mut chunk_count = 0;
+        let events = highlighter
+            .highlight(
+                &HTML_HIGHLIGHT,
+                source,
+                None,
+                &test_language_for_injection_string,
+            )
+            .unwrap();
+        renderer
+            .render_streaming(events, source, &attribute_callback, chunk_size, |chunk| {
+                assert!(chunk_size == usize::MAX || chunk.len() < chunk_size + 512);
+                chunk_count += 1;
+                output.extend_from_slice(chunk);
+                true
+            })
+            .unwrap();
+        assert_eq!(str::from_utf8(&output), str::from_utf8(&expected));
+        assert!(chunk_count > 1 || chunk_size == usize::MAX);
+        assert!(renderer.html.is_empty());
+    }
+
+    // Returning false from the sink stops the rendering.
+    let mut chunk_count = 0;
+    let events = highlighter
+        .highlight(
+            &HTML_HIGHLIGHT,
+            source,
+            None,
+            &test_language_for_injection_string,
+        )
+        .unwrap();
+    let result = renderer.render_streaming(events, source, &attribute_callback, 64, |_| {
+        chunk_count += 1;
+        chunk_count < 3
+    });
+    assert_eq!(result, Err(Error::Cancelled));
+    assert_eq!(chunk_count, 3);
+}
+
+#[test]
+fn test_highlighting_with_injection_cache() {
+    let script = "<script>\nconst a = b('c');\nc.d();\n</script>\n";
+    let source = script.repeat(5);
+    let shifted_source = format!("<div>\n  <b>hi</b></div>{source}");
+
+    let render = |highlighter: &mut Highlighter, source: &str| {
+        let mut renderer = HtmlRenderer::new();
+        let events = highlighter
+            .highlight(
+                &HTML_HIGHLIGHT,
+                source.as_bytes(),
+                None,
+                &test_language_for_injection_string,
+            )
+            .unwrap();
+        renderer
+            .render(events, source.as_bytes(), &|highlight| {
+                HTML_ATTRS[highlight.0].as_bytes()
+            })
+            .unwrap();
+        String::from_utf8(renderer.html).unwrap()
+    };
+
+    let mut highlighter = Highlighter::new();
+    let mut cached_highlighter = Highlighter::new();
+    cached_highlighter.set_injection_cache_capacity(2);
+    for source in [&source, &source, &shifted_source, &source] {
+        assert_eq!(
+            render(&mut cached_highlighter, source),
+            render(&mut highlighter, source)
+        );
+    }
+
+    cached_highlighter.set_injection_cache_capacity(0);
+    assert_eq!(
+        render(&mut cached_highlighter, &source),
+        render(&mut highlighter, &source)
+    );
+}
+
+#[test]
+fn test_highlighting_interleaved_injections_with_a_reused_highlighter() {
+    let mut source = String::new();
+    for i in 0..20 {
+        source += &format!(
+            "<p>{i}</p>\n<script>\n/** @returns {{number}} */\nfunction a{i}() {{ return {i}; }}\n</script>\n"
+        );
+    }
+    let other_source = source.replace("return", "throw");
+
+    let render = |highlighter: &mut Highlighter, source: &str| {
+        let mut renderer = HtmlRenderer::new();
+        let events = highlighter
+            .highlight(
+                &HTML_HIGHLIGHT,
+                source.as_bytes(),
+                None,
+                &test_language_for_injection_string,
+            )
+            .unwrap();
+        renderer
+            .render(events, source.as_bytes(), &|highlight| {
+                HTML_ATTRS[highlight.0].as_bytes()
+            })
+            .unwrap();
+        String::from_utf8(renderer.html).unwrap()
+    };
+
+    // The highlighter keeps a parser for each injected language, and reuses the
+    // buffers of its layers, across calls.
+    let mut highlighter = Highlighter::new();
+    for source in [&source, &other_source, &source] {
+        assert_eq!(
+            render(&mut highlighter, source),
+            render(&mut Highlighter::new(), source)
+        );
+    }
+
+    // Stop highlighting part of the way through a document.
+    let events = highlighter
+        .highlight(
+            &HTML_HIGHLIGHT,
+            source.as_bytes(),
+            None,
+            &test_language_for_injection_string,
+        )
+        .unwrap();
+    assert_eq!(events.take(10).count(), 10);
+
+    // Cancel the parsing of a large injected document. The parser for that
+    // language must not resume the cancelled parse the next time it's used.
+    let mut large_source = "<script>\n".to_string();
+    for _ in 0..500 {
+        large_source += "function a() { console.log('hi'); }\n";
+    }
+    large_source += "</script>\n";
+    let cancellation_flag = AtomicUsize::new(0);
+    let events = highlighter
+        .highlight(
+            &HTML_HIGHLIGHT,
+            large_source.as_bytes(),
+            Some(&cancellation_flag),
+            |name| {
+                cancellation_flag.store(1, Ordering::SeqCst);
+                test_language_for_injection_string(name)
+            },
+        )
+        .unwrap();
+    assert!(events.into_iter().any(|event| event.is_err()));
+
+    assert_eq!(
+        render(&mut highlighter, &other_source),
+        render(&mut Highlighter::new(), &other_source)
+    );
+}
+
 #[test]
 fn test_highlighting_via_c_api() {
     let highlights = [
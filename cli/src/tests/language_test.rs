@@ -1,5 +1,6 @@
 use super::helpers::fixtures::get_language;
-use tree_sitter::Parser;
+use std::{collections::BTreeSet, thread};
+use tree_sitter::{LookaheadTable, Parser, SymbolSet};
 
 #[test]
 fn test_lookahead_iterator() {
@@ -62,3 +63,61 @@ fn test_lookahead_iterator_modifiable_only_by_mut() {
     let mut names = lookahead.iter_names();
     let _ = names.next();
 }
+
+#[test]
+fn test_lookahead_table() {
+    let language = get_language("rust");
+    let table = LookaheadTable::new(&language);
+    assert_eq!(*table.language(), language);
+
+    let lookaheads =
+        |state: u16| -> BTreeSet<u16> { language.lookahead_iterator(state).unwrap().collect() };
+
+    // Each state's set contains the same symbols as a lookahead iterator.
+    let mut set = SymbolSet::new(&language);
+    let state_count = language.parse_state_count() as u16;
+    for state in (0..state_count).step_by(7) {
+        assert!(table.union(&[state], &mut set));
+        assert_eq!(set.iter().collect::<BTreeSet<_>>(), lookaheads(state));
+        assert_eq!(set.len(), lookaheads(state).len());
+    }
+
+    let states = [1, 2, 100, 250];
+    let mut expected_union = BTreeSet::new();
+    for state in states {
+        expected_union.extend(lookaheads(state));
+    }
+    let expected_intersection = states
+        .iter()
+        .map(|state| lookaheads(*state))
+        .reduce(|a, b| a.intersection(&b).copied().collect())
+        .unwrap();
+    assert!(table.union(&states, &mut set));
+    assert_eq!(set.iter().collect::<BTreeSet<_>>(), expected_union);
+    assert!(table.intersection(&states, &mut set));
+    assert_eq!(set.iter().collect::<BTreeSet<_>>(), expected_intersection);
+    assert!(expected_intersection
+        .iter()
+        .all(|symbol| set.contains(*symbol)));
+    assert!(table.intersection(&[], &mut set));
+    assert!(set.is_empty());
+
+    // Invalid states and sets from other languages are rejected.
+    assert!(!table.union(&[1, state_count], &mut set));
+    let mut other_set = SymbolSet::new(&get_language("json"));
+    assert!(!table.union(&[1], &mut other_set));
+
+    // The table can be shared between threads.
+    thread::scope(|scope| {
+        for offset in 0..4 {
+            let table = &table;
+            let language = &language;
+            scope.spawn(move || {
+                let mut set = SymbolSet::new(language);
+                for state in (offset..state_count).step_by(4) {
+                    assert!(table.union(&[state], &mut set));
+                }
+            });
+        }
+    });
+}
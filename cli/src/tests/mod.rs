@@ -1,3 +1,4 @@
+mod allocator_test;
 mod async_context_test;
 mod corpus_test;
 mod detect_language;
@@ -4,7 +4,7 @@ use super::helpers::random::Rand;
 use crate::generate::generate_parser_for_grammar;
 use crate::parse::perform_edit;
 use std::fs;
-use tree_sitter::{Node, Parser, Point, Tree};
+use tree_sitter::{Node, NodeStringFormat, Parser, Point, Tree, TreeCursor};
 
 const JSON_EXAMPLE: &str = r#"
 
@@ -591,6 +591,112 @@ fn test_node_edit() {
     }
 }
 
+#[test]
+fn test_node_parent_and_siblings_with_parent_index() {
+    fn describe(node: Option<Node>) -> Option<(&'static str, std::ops::Range<usize>)> {
+        node.map(|node| (node.kind(), node.byte_range()))
+    }
+
+    fn neighbors(tree: &Tree) -> Vec<[Option<(&'static str, std::ops::Range<usize>)>; 5]> {
+        get_all_nodes(tree)
+            .into_iter()
+            .map(|node| {
+                [
+                    describe(node.parent()),
+                    describe(node.next_sibling()),
+                    describe(node.prev_sibling()),
+                    describe(node.next_named_sibling()),
+                    describe(node.prev_named_sibling()),
+                ]
+            })
+            .collect()
+    }
+
+    let mut code = b"
+        const a = [1, 2, 3, [4, 5], {b: 6, c: [7]}];
+        function d(e, f) { return e ? f : g(/* h */ i, ...j); }
+        class K extends L { m() { return `n${o}p`; } }
+    "
+    .to_vec();
+    let mut parser = Parser::new();
+    parser.set_language(&get_language("javascript")).unwrap();
+    let mut tree = parser.parse(&code, None).unwrap();
+    let mut rand = Rand::new(0);
+
+    for _ in 0..5 {
+        let mut indexed_tree = tree.clone();
+        assert!(!indexed_tree.parent_index_enabled());
+        indexed_tree.set_parent_index_enabled(true);
+        assert!(indexed_tree.parent_index_enabled());
+        assert_eq!(neighbors(&indexed_tree), neighbors(&tree));
+
+        // The index is rebuilt after the tree is edited.
+        let edit = get_random_edit(&mut rand, &code);
+        let edit = perform_edit(&mut tree, &mut code, &edit).unwrap();
+        indexed_tree.edit(&edit);
+        assert!(indexed_tree.parent_index_enabled());
+        assert_eq!(neighbors(&indexed_tree), neighbors(&tree));
+
+        tree = parser.parse(&code, Some(&tree)).unwrap();
+    }
+}
+
+#[test]
+fn test_node_descendant_for_range_with_parent_index() {
+    fn describe(node: Option<Node>) -> Option<(&'static str, std::ops::Range<usize>, Point)> {
+        node.map(|node| (node.kind(), node.byte_range(), node.start_position()))
+    }
+
+    // The comments all become children of the array, making it wide enough
+    // for its children's offsets to be recorded in the parent index.
+    let mut code = "[\n".to_string();
+    for i in 0..100 {
+        code += &format!("  /* {i} */\n");
+    }
+    code += "  1, {\"b\": [2, 3]}\n]\n";
+
+    let mut parser = Parser::new();
+    parser.set_language(&get_language("json")).unwrap();
+    let tree = parser.parse(&code, None).unwrap();
+    let mut indexed_tree = tree.clone();
+    indexed_tree.set_parent_index_enabled(true);
+
+    let (root, indexed_root) = (tree.root_node(), indexed_tree.root_node());
+    let (mut cursor, mut indexed_cursor) = (root.walk(), indexed_root.walk());
+    let mut position = Point::new(0, 0);
+    for (offset, byte) in code.bytes().enumerate() {
+        assert_eq!(
+            describe(root.descendant_for_byte_range(offset, offset + 1)),
+            describe(indexed_root.descendant_for_byte_range(offset, offset + 1)),
+        );
+        assert_eq!(
+            describe(root.named_descendant_for_point_range(position, position)),
+            describe(indexed_root.named_descendant_for_point_range(position, position)),
+        );
+
+        cursor.reset(root);
+        indexed_cursor.reset(indexed_root);
+        loop {
+            let index = cursor.goto_first_child_for_byte(offset);
+            assert_eq!(index, indexed_cursor.goto_first_child_for_byte(offset));
+            assert_eq!(
+                describe(Some(cursor.node())),
+                describe(Some(indexed_cursor.node()))
+            );
+            assert_eq!(cursor.descendant_index(), indexed_cursor.descendant_index());
+            if index.is_none() {
+                break;
+            }
+        }
+
+        if byte == b'\n' {
+            position = Point::new(position.row + 1, 0);
+        } else {
+            position.column += 1;
+        }
+    }
+}
+
 #[test]
 fn test_root_node_with_offset() {
     let mut parser = Parser::new();
@@ -651,6 +757,62 @@ fn test_node_sexp() {
     assert_eq!(identifier_node.to_sexp(), "(identifier)");
 }
 
+#[test]
+fn test_node_write_string() {
+    let mut parser = Parser::new();
+    parser.set_language(&get_language("javascript")).unwrap();
+    let source = "function f(a, b) {\n  // add\n  return a + b;\n}\nif (a) b";
+    let tree = parser.parse(source, None).unwrap();
+
+    let mut cursor = tree.walk();
+    let mut nodes = vec![tree.root_node()];
+    while cursor.goto_first_child() {
+        nodes.push(cursor.node());
+    }
+    for node in nodes {
+        let mut sexp = Vec::new();
+        node.write_string(NodeStringFormat::SExpression, &mut sexp)
+            .unwrap();
+        assert_eq!(String::from_utf8(sexp).unwrap(), node.to_sexp());
+    }
+
+    fn check_json(value: &serde_json::Value, cursor: &mut TreeCursor) {
+        let node = cursor.node();
+        assert_eq!(value["type"], node.kind());
+        assert_eq!(value["named"], node.is_named());
+        assert_eq!(value["missing"], node.is_missing());
+        assert_eq!(value["extra"], node.is_extra());
+        assert_eq!(value["start_byte"], node.start_byte());
+        assert_eq!(value["end_byte"], node.end_byte());
+        assert_eq!(value["start_point"]["row"], node.start_position().row);
+        assert_eq!(value["start_point"]["column"], node.start_position().column);
+        assert_eq!(value["end_point"]["row"], node.end_position().row);
+        assert_eq!(value["end_point"]["column"], node.end_position().column);
+        if cursor.depth() > 0 {
+            assert_eq!(value["field"].as_str(), cursor.field_name());
+        }
+
+        let children = value["children"].as_array().map_or(&[][..], Vec::as_slice);
+        assert_eq!(children.len(), node.child_count());
+        if cursor.goto_first_child() {
+            for (i, child) in children.iter().enumerate() {
+                if i > 0 {
+                    assert!(cursor.goto_next_sibling());
+                }
+                check_json(child, cursor);
+            }
+            cursor.goto_parent();
+        }
+    }
+
+    let mut json = Vec::new();
+    tree.root_node()
+        .write_string(NodeStringFormat::Json, &mut json)
+        .unwrap();
+    let json = serde_json::from_slice::<serde_json::Value>(&json).unwrap();
+    check_json(&json, &mut tree.walk());
+}
+
 #[test]
 fn test_node_field_names() {
     let (parser_name, parser_code) = generate_parser_for_grammar(
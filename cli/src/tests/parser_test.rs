@@ -4,7 +4,10 @@ use super::helpers::{
     fixtures::{get_language, get_test_language},
 };
 use crate::{
-    generate::generate_parser_for_grammar,
+    generate::{
+        generate_parser_for_grammar, generate_parser_for_grammar_with_compressed_tables,
+        generate_parser_for_grammar_with_table_lexer, load_grammar_file,
+    },
     parse::{perform_edit, Edit},
     tests::helpers::fixtures::fixtures_dir,
 };
@@ -13,7 +16,10 @@ use std::{
     sync::atomic::{AtomicUsize, Ordering},
     thread, time,
 };
-use tree_sitter::{IncludedRangesError, InputEdit, LogType, Parser, Point, Range};
+use tree_sitter::{
+    IncludedRangesError, InputEdit, LogType, ParseJob, Parser, ParserPool, Point, Range, Tree,
+    VersionPolicy, VersionPruningStrategy,
+};
 use tree_sitter_proc_macro::retry;
 
 #[test]
@@ -83,6 +89,41 @@ fn test_parsing_with_logging() {
     assert!(row_starts_from_0);
 }
 
+#[test]
+fn test_parsing_with_stream_callback() {
+    let mut parser = Parser::new();
+    parser.set_language(&get_language("json")).unwrap();
+
+    let mut source_code = String::new();
+    for i in 0..100 {
+        source_code += &format!("{{\"id\": {i}, \"tags\": [\"a\", \"b\"]}}\n");
+    }
+
+    let tree = parser.parse(&source_code, None).unwrap();
+    let expected_nodes = tree
+        .root_node()
+        .children(&mut tree.walk())
+        .map(|node| (node.to_sexp(), node.byte_range()))
+        .collect::<Vec<_>>();
+    assert_eq!(expected_nodes.len(), 100);
+
+    let mut streamed_nodes = Vec::new();
+    parser.set_stream_callback(Some(Box::new(|node| {
+        streamed_nodes.push((node.to_sexp(), node.byte_range()));
+    })));
+    let streamed_tree = parser.parse(&source_code, None).unwrap();
+    parser.set_stream_callback(None);
+
+    // Only the nodes that were still on the stack at the end of the document
+    // remain in the tree.
+    assert!(streamed_tree.root_node().child_count() < 3);
+    assert_eq!(
+        streamed_tree.root_node().byte_range(),
+        tree.root_node().byte_range()
+    );
+    assert_eq!(streamed_nodes, expected_nodes);
+}
+
 #[test]
 #[cfg(unix)]
 fn test_parsing_with_debug_graph_enabled() {
@@ -413,6 +454,44 @@ fn test_parsing_after_editing_end_of_code() {
     assert_eq!(recorder.strings_read(), vec![" * ", "abc.d)",]);
 }
 
+#[test]
+fn test_parsing_after_editing_inside_a_long_repetition() {
+    let mut parser = Parser::new();
+    parser.set_language(&get_language("json")).unwrap();
+
+    let mut code = b"[".to_vec();
+    for i in 0..1000 {
+        code.extend(format!("{{\"id\": {i}, \"values\": [1, 2, 3]}},\n").bytes());
+    }
+    code.extend(b"null]");
+    let mut tree = parser.parse(&code, None).unwrap();
+
+    let position = code.len() / 2;
+    perform_edit(
+        &mut tree,
+        &mut code,
+        &Edit {
+            position,
+            deleted_length: 0,
+            inserted_text: b" ".to_vec(),
+        },
+    )
+    .unwrap();
+    let new_tree = parser.parse(&code, Some(&tree)).unwrap();
+    assert_eq!(
+        new_tree.root_node().to_sexp(),
+        parser.parse(&code, None).unwrap().root_node().to_sexp()
+    );
+
+    // The elements of the array on either side of the edit are reused in large
+    // chunks, rather than being shifted one at a time.
+    parser.parse(&code, Some(&tree)).unwrap();
+    let stats = parser.stats();
+    assert!(stats.lexed_byte_count < 100);
+    assert!(stats.shift_count < 100);
+    assert!(stats.reused_byte_count > code.len() as u64 * 9 / 10);
+}
+
 #[test]
 fn test_parsing_empty_file_with_reused_tree() {
     let mut parser = Parser::new();
@@ -425,6 +504,328 @@ fn test_parsing_empty_file_with_reused_tree() {
     parser.parse("\n  ", tree.as_ref());
 }
 
+#[test]
+fn test_parsing_a_file() {
+    let mut parser = Parser::new();
+    parser.set_language(&get_language("rust")).unwrap();
+
+    let dir = tempfile::tempdir().unwrap();
+    let path = dir.path().join("main.rs");
+    fs::write(&path, "fn main() {\n    let x = \"αβγ\";\n}\n").unwrap();
+    let tree = parser
+        .parse_file(&fs::File::open(&path).unwrap(), None)
+        .unwrap();
+    assert_eq!(
+        tree.root_node().to_sexp(),
+        "(source_file (function_item name: (identifier) parameters: (parameters) body: (block (let_declaration pattern: (identifier) value: (string_literal)))))"
+    );
+
+    // Reparse the file after editing it, reusing the old tree.
+    let mut tree = tree;
+    tree.edit(&InputEdit {
+        start_byte: 7,
+        old_end_byte: 7,
+        new_end_byte: 8,
+        start_position: Point::new(0, 7),
+        old_end_position: Point::new(0, 7),
+        new_end_position: Point::new(0, 8),
+    });
+    fs::write(&path, "fn main2() {\n    let x = \"αβγ\";\n}\n").unwrap();
+    let new_tree = parser
+        .parse_file(&fs::File::open(&path).unwrap(), Some(&tree))
+        .unwrap();
+    assert_eq!(new_tree.root_node().to_sexp(), tree.root_node().to_sexp());
+    assert_eq!(
+        new_tree
+            .root_node()
+            .child(0)
+            .unwrap()
+            .child_by_field_name("name")
+            .unwrap()
+            .byte_range(),
+        3..8
+    );
+
+    // Empty files produce an empty tree.
+    let path = dir.path().join("empty.rs");
+    fs::write(&path, "").unwrap();
+    let tree = parser
+        .parse_file(&fs::File::open(&path).unwrap(), None)
+        .unwrap();
+    assert_eq!(tree.root_node().to_sexp(), "(source_file)");
+
+    // Directories can't be mapped.
+    #[cfg(unix)]
+    assert!(parser
+        .parse_file(&fs::File::open(dir.path()).unwrap(), None)
+        .is_none());
+}
+
+#[test]
+fn test_parsing_with_arena_allocation() {
+    allocations::record(|| {
+        let mut parser = Parser::new();
+        parser.set_language(&get_language("javascript")).unwrap();
+        parser.set_arena_enabled(true);
+        assert!(parser.arena_enabled());
+
+        let mut reference_parser = Parser::new();
+        reference_parser
+            .set_language(&get_language("javascript"))
+            .unwrap();
+
+        let mut code =
+            b"const a = [1, 2, 3];\nfunction b() { return a.map((x) => x * 2); }".to_vec();
+        let mut tree = parser.parse(&code, None).unwrap();
+        let tree_copy = tree.clone();
+        assert_eq!(
+            tree.root_node().to_sexp(),
+            reference_parser
+                .parse(&code, None)
+                .unwrap()
+                .root_node()
+                .to_sexp()
+        );
+
+        // Reparsing an arena-allocated tree reuses nodes from the old tree's arena.
+        perform_edit(
+            &mut tree,
+            &mut code,
+            &Edit {
+                position: 11,
+                deleted_length: 0,
+                inserted_text: b"0, ".to_vec(),
+            },
+        )
+        .unwrap();
+        let new_tree = parser.parse(&code, Some(&tree)).unwrap();
+        drop(tree);
+        assert_eq!(
+            new_tree.root_node().to_sexp(),
+            reference_parser
+                .parse(&code, None)
+                .unwrap()
+                .root_node()
+                .to_sexp()
+        );
+
+        // Arena-allocated trees can also be reused by parsers that don't use arenas,
+        // and vice versa.
+        let mut tree = reference_parser.parse(&code, Some(&new_tree)).unwrap();
+        perform_edit(
+            &mut tree,
+            &mut code,
+            &Edit {
+                position: 0,
+                deleted_length: 0,
+                inserted_text: b"let c = `${a}`;\n".to_vec(),
+            },
+        )
+        .unwrap();
+        let tree = parser.parse(&code, Some(&tree)).unwrap();
+        assert_eq!(
+            tree.root_node().to_sexp(),
+            reference_parser
+                .parse(&code, None)
+                .unwrap()
+                .root_node()
+                .to_sexp()
+        );
+
+        drop(parser);
+        drop(new_tree);
+        assert_eq!(tree_copy.root_node().kind(), "program");
+    });
+}
+
+#[test]
+fn test_parsing_stats() {
+    let mut parser = Parser::new();
+    parser.set_language(&get_language("javascript")).unwrap();
+
+    let mut code = b"const a = `${b}`;\nfunction c(d) { return d + 1; }\n".to_vec();
+    let mut tree = parser.parse(&code, None).unwrap();
+    let stats = parser.stats();
+    assert!(stats.lex_count > 0);
+    assert!(stats.external_scan_count > 0);
+    assert!(stats.token_cache_miss_count > 0);
+    assert!(stats.token_cache_miss_count <= stats.lex_count);
+    assert!(stats.lexed_byte_count >= code.len() as u64);
+    assert!(stats.shift_count > 0);
+    assert!(stats.reduce_count > 0);
+    assert_eq!(stats.reused_node_count, 0);
+    assert_eq!(stats.reused_byte_count, 0);
+    assert_eq!(stats.error_recovery_micros, 0);
+
+    // When reparsing after an edit, most of the tree is reused, so the lexer
+    // only needs to run near the edit.
+    perform_edit(
+        &mut tree,
+        &mut code,
+        &Edit {
+            position: code.len() - 4,
+            deleted_length: 1,
+            inserted_text: b"2".to_vec(),
+        },
+    )
+    .unwrap();
+    parser.parse(&code, Some(&tree)).unwrap();
+    let reparse_stats = parser.stats();
+    assert!(reparse_stats.reused_node_count > 0);
+    assert!(reparse_stats.reused_byte_count > code.len() as u64 / 2);
+    assert!(reparse_stats.lex_count < stats.lex_count);
+
+    // The counters are reset at the start of each parse.
+    parser.parse("a b c d e", None).unwrap();
+    let error_stats = parser.stats();
+    assert!(error_stats.lex_count < stats.lex_count);
+    assert_eq!(error_stats.reused_node_count, 0);
+}
+
+#[test]
+fn test_checking_syntax() {
+    let mut parser = Parser::new();
+    parser.set_language(&get_language("json")).unwrap();
+
+    let valid = "[1, 2]\n{\"a\": true}\n".repeat(50);
+    let check = parser.check(&valid).unwrap();
+    assert!(!check.has_error());
+    assert_eq!(check.first_error, None);
+
+    // The check finds the same errors that a full parse contains.
+    for source in [
+        "[1, 2 3]\n{\"a\": [true}\n",
+        "{\"a\": 1,, \"b\": 2}\n[1]\n[",
+        "[1]\n[2]\n\"a\" : :\n[3]",
+    ] {
+        let tree = parser.parse(source, None).unwrap();
+        let mut errors = Vec::new();
+        let mut missing_count = 0;
+        let mut cursor = tree.walk();
+        loop {
+            let node = cursor.node();
+            if node.is_error() {
+                errors.push(node.range());
+            } else if node.is_missing() {
+                errors.push(node.range());
+                missing_count += 1;
+            }
+            if node.has_error() && cursor.goto_first_child() {
+                continue;
+            }
+            while !cursor.goto_next_sibling() {
+                if !cursor.goto_parent() {
+                    break;
+                }
+            }
+            if cursor.depth() == 0 {
+                break;
+            }
+        }
+
+        let check = parser.check(source).unwrap();
+        assert!(check.has_error(), "{source:?}");
+        assert_eq!(
+            check.error_count,
+            errors.len() - missing_count,
+            "{source:?}"
+        );
+        assert_eq!(check.missing_count, missing_count, "{source:?}");
+        assert_eq!(check.first_error, errors.first().copied(), "{source:?}");
+    }
+
+    // A halted check resumes where it left off.
+    parser.set_operation_limit(5);
+    let mut halted_count = 0;
+    let check = loop {
+        if let Some(check) = parser.check(&valid) {
+            break check;
+        }
+        halted_count += 1;
+    };
+    parser.set_operation_limit(0);
+    assert!(halted_count > 0);
+    assert!(!check.has_error());
+}
+
+#[test]
+fn test_parsing_with_version_policy() {
+    let mut parser = Parser::new();
+    parser.set_language(&get_language("json")).unwrap();
+
+    let default_policy = parser.version_policy();
+    assert_eq!(default_policy.max_version_count, 6);
+    assert_eq!(default_policy.strategy, VersionPruningStrategy::KeepBest);
+
+    let source = r#"[1, {"a": [2, 3 4 } 5, "b" : : [ 6, 7 ]] {}, [[[ 8 9 10 }, nul, tru]"#;
+    let tree = parser.parse(source, None).unwrap();
+    assert!(tree.root_node().has_error());
+    assert!(parser.stats().version_split_count > 0);
+    assert!(parser.stats().version_cost_prune_count > 0);
+    assert_eq!(parser.stats().version_limit_prune_count, 0);
+
+    // With a single version, every split has to be pruned right away, but the
+    // parse still produces a tree that covers the whole document.
+    parser.set_version_policy(VersionPolicy {
+        max_version_count: 1,
+        strategy: VersionPruningStrategy::DropNewest,
+        ..default_policy
+    });
+    let tree = parser.parse(source, None).unwrap();
+    assert_eq!(tree.root_node().end_byte(), source.len());
+    assert!(parser.stats().version_limit_prune_count > 0);
+
+    // The version count is clamped to at least one.
+    parser.set_version_policy(VersionPolicy {
+        max_version_count: 0,
+        ..default_policy
+    });
+    assert_eq!(parser.version_policy().max_version_count, 1);
+    parser.parse(source, None).unwrap();
+
+    parser.set_version_policy(default_policy);
+    assert_eq!(parser.version_policy(), default_policy);
+}
+
+#[test]
+fn test_parser_pool() {
+    allocations::record(|| {
+        let language = get_language("javascript");
+        let mut pool = ParserPool::new(&language, 2, 64 * 1024).unwrap();
+
+        let mut parser = pool.acquire();
+        assert_eq!(parser.language(), Some(language.clone()));
+        parser.set_logger(Some(Box::new(|_, _| {})));
+        parser.set_timeout_micros(1_000_000);
+        let source = "[".repeat(5000) + &"]".repeat(5000);
+        parser.parse(&source, None).unwrap();
+        parser.set_operation_limit(5);
+        pool.release(parser);
+
+        // The recycled parser has its settings restored to their defaults.
+        let mut parser = pool.acquire();
+        assert!(parser.logger().is_none());
+        assert_eq!(parser.timeout_micros(), 0);
+        assert_eq!(parser.operation_limit(), 0);
+        let tree = parser.parse("a + b;", None).unwrap();
+        assert_eq!(
+            tree.root_node().to_sexp(),
+            "(program (expression_statement (binary_expression left: (identifier) right: (identifier))))"
+        );
+
+        // A parser whose language was changed is given the pool's language again.
+        let mut other_parser = pool.acquire();
+        other_parser.set_language(&get_language("rust")).unwrap();
+        pool.release(other_parser);
+        pool.release(parser);
+        for _ in 0..3 {
+            let parser = pool.acquire();
+            assert_eq!(parser.language(), Some(language.clone()));
+            pool.release(parser);
+        }
+    });
+}
+
 #[test]
 fn test_parsing_after_editing_tree_that_depends_on_column_values() {
     let dir = fixtures_dir()
@@ -502,6 +903,55 @@ h + i
     );
 }
 
+#[test]
+fn test_parsing_after_editing_tree_with_external_scanner_states_of_various_lengths() {
+    let dir = fixtures_dir()
+        .join("test_grammars")
+        .join("external_scanner_unchanged_state");
+    let grammar_json = load_grammar_file(&dir.join("grammar.js"), None).unwrap();
+    let (grammar_name, parser_code) = generate_parser_for_grammar(&grammar_json).unwrap();
+    let language = get_test_language(&grammar_name, &parser_code, Some(&dir));
+
+    let mut parser = Parser::new();
+    parser.set_language(&language).unwrap();
+
+    // The scanner's state after a start tag is the tag's name followed by a
+    // `/`. States of up to 16 bytes are stored inline in the subtree, and
+    // longer ones are allocated separately.
+    for state_length in [16, 17, 24] {
+        let name = "a".repeat(state_length - 1);
+        let mut code = format!("<{name}> one two </{name}> three").into_bytes();
+        let tree = parser.parse(&code, None).unwrap();
+        let expected_sexp = concat!(
+            "(document ",
+            "(element (start_tag) (text) (text) (end_tag)) ",
+            "(text))"
+        );
+        assert_eq!(tree.root_node().to_sexp(), expected_sexp);
+
+        // The states are also written out when a tree is serialized.
+        let mut tree = Tree::deserialize(&tree.serialize(), &language).unwrap();
+        assert_eq!(tree.root_node().to_sexp(), expected_sexp);
+
+        // Relexing the end tag restores the state of the start tag, which
+        // must contain the whole name for the end tag to match it.
+        let end_tag = format!("</{name}>");
+        let end_tag_position = code.len() - end_tag.len() - " three".len();
+        perform_edit(
+            &mut tree,
+            &mut code,
+            &Edit {
+                position: end_tag_position,
+                deleted_length: end_tag.len(),
+                inserted_text: end_tag.into_bytes(),
+            },
+        )
+        .unwrap();
+        let tree = parser.parse(&code, Some(&tree)).unwrap();
+        assert_eq!(tree.root_node().to_sexp(), expected_sexp, "{state_length}");
+    }
+}
+
 #[test]
 fn test_parsing_after_detecting_error_in_the_middle_of_a_string_token() {
     let mut parser = Parser::new();
@@ -540,6 +990,122 @@ fn test_parsing_after_detecting_error_in_the_middle_of_a_string_token() {
     assert_eq!(tree3.root_node().to_sexp(), tree.root_node().to_sexp(),);
 }
 
+#[test]
+fn test_parsing_with_compressed_parse_tables() {
+    let grammar = |name: &str| {
+        r#"{
+            "name": "NAME",
+            "extras": [{"type": "PATTERN", "value": "\\s"}],
+            "rules": {
+                "program": {"type": "REPEAT", "content": {"type": "SYMBOL", "name": "_value"}},
+                "_value": {
+                    "type": "CHOICE",
+                    "members": [
+                        {"type": "SYMBOL", "name": "list"},
+                        {"type": "SYMBOL", "name": "sum"},
+                        {"type": "SYMBOL", "name": "number"}
+                    ]
+                },
+                "list": {
+                    "type": "SEQ",
+                    "members": [
+                        {"type": "STRING", "value": "["},
+                        {"type": "REPEAT", "content": {"type": "SYMBOL", "name": "_value"}},
+                        {"type": "STRING", "value": "]"}
+                    ]
+                },
+                "sum": {
+                    "type": "PREC_LEFT",
+                    "value": 1,
+                    "content": {
+                        "type": "SEQ",
+                        "members": [
+                            {"type": "SYMBOL", "name": "_value"},
+                            {"type": "STRING", "value": "+"},
+                            {"type": "SYMBOL", "name": "_value"}
+                        ]
+                    }
+                },
+                "number": {"type": "PATTERN", "value": "\\d+"}
+            }
+        }"#
+        .replace("NAME", name)
+    };
+
+    let (name, code) = generate_parser_for_grammar(&grammar("uncompressed_tables")).unwrap();
+    let language = get_test_language(&name, &code, None);
+    let (name, code) =
+        generate_parser_for_grammar_with_compressed_tables(&grammar("compressed_tables")).unwrap();
+    assert!(code.contains("#define TREE_SITTER_COMPRESSED_TABLES"));
+    let compressed_language = get_test_language(&name, &code, None);
+
+    let mut parser = Parser::new();
+    for source in ["1 + [2 3 + 4] [[5]]", "[1 + + 2", "] 3 [[4 +"] {
+        parser.set_language(&language).unwrap();
+        let tree = parser.parse(source, None).unwrap();
+        parser.set_language(&compressed_language).unwrap();
+        let compressed_tree = parser.parse(source, None).unwrap();
+        assert_eq!(
+            compressed_tree.root_node().to_sexp(),
+            tree.root_node().to_sexp()
+        );
+    }
+}
+
+#[test]
+fn test_parsing_with_table_lexer() {
+    let grammar = |name: &str| {
+        r##"{
+            "name": "NAME",
+            "word": "identifier",
+            "extras": [
+                {"type": "PATTERN", "value": "\\s"},
+                {"type": "SYMBOL", "name": "comment"}
+            ],
+            "rules": {
+                "program": {"type": "REPEAT", "content": {"type": "SYMBOL", "name": "_item"}},
+                "_item": {
+                    "type": "CHOICE",
+                    "members": [
+                        {"type": "SYMBOL", "name": "identifier"},
+                        {"type": "SYMBOL", "name": "string"},
+                        {"type": "STRING", "value": "if"},
+                        {"type": "STRING", "value": "import"},
+                        {"type": "STRING", "value": "=="},
+                        {"type": "STRING", "value": "="}
+                    ]
+                },
+                "identifier": {"type": "PATTERN", "value": "[\\p{L}_][\\p{L}\\d_]*"},
+                "string": {"type": "PATTERN", "value": "\"[^\"\\n]*\""},
+                "comment": {"type": "PATTERN", "value": "#[^\\n]*"}
+            }
+        }"##
+        .replace("NAME", name)
+    };
+
+    let (name, code) = generate_parser_for_grammar(&grammar("switch_lexer")).unwrap();
+    let language = get_test_language(&name, &code, None);
+    let (name, code) =
+        generate_parser_for_grammar_with_table_lexer(&grammar("table_lexer")).unwrap();
+    assert!(code.contains("ts_lex_with_table(lexer, state, &ts_lex_table)"));
+    assert!(code.contains("ts_lex_with_table(lexer, state, &ts_lex_keywords_table)"));
+    let table_language = get_test_language(&name, &code, None);
+
+    let mut parser = Parser::new();
+    for source in [
+        "if x == \"y\" # comment\nimport ifx = größe",
+        "\"unterminated\nimp = = ==",
+        "αβγ\u{3000}\"\u{0}\" # trailing",
+        "ok ? ==",
+    ] {
+        parser.set_language(&language).unwrap();
+        let tree = parser.parse(source, None).unwrap();
+        parser.set_language(&table_language).unwrap();
+        let table_tree = parser.parse(source, None).unwrap();
+        assert_eq!(table_tree.root_node().to_sexp(), tree.root_node().to_sexp());
+    }
+}
+
 // Thread safety
 
 #[test]
@@ -805,6 +1371,149 @@ fn test_parsing_with_timeout_and_no_completion() {
     });
 }
 
+#[test]
+fn test_parsing_with_an_operation_limit() {
+    allocations::record(|| {
+        let mut parser = Parser::new();
+        parser.set_language(&get_language("json")).unwrap();
+
+        let source_code = format!(
+            "[{}]",
+            (0..100)
+                .map(|i| i.to_string())
+                .collect::<Vec<_>>()
+                .join(", ")
+        );
+        let expected_sexp = parser
+            .parse(&source_code, None)
+            .unwrap()
+            .root_node()
+            .to_sexp();
+
+        // Parse the document in slices of a fixed number of operations,
+        // resuming each time that the parser halts.
+        parser.set_operation_limit(10);
+        assert_eq!(parser.operation_limit(), 10);
+        let mut slice_counts = Vec::new();
+        for _ in 0..2 {
+            let mut slice_count = 1;
+            let tree = loop {
+                if let Some(tree) = parser.parse(&source_code, None) {
+                    break tree;
+                }
+                slice_count += 1;
+            };
+            assert_eq!(tree.root_node().to_sexp(), expected_sexp);
+            slice_counts.push(slice_count);
+        }
+
+        // The limit doesn't depend on timing, so the parse is split up the
+        // same way every time.
+        assert!(slice_counts[0] > 10);
+        assert_eq!(slice_counts[0], slice_counts[1]);
+
+        // Without a limit, the parse finishes in one call.
+        parser.set_operation_limit(0);
+        assert!(parser.parse(&source_code, None).is_some());
+    });
+}
+
+// Pending input
+
+#[test]
+fn test_parsing_with_input_that_is_not_available_yet() {
+    allocations::record(|| {
+        let mut parser = Parser::new();
+        parser.set_language(&get_language("javascript")).unwrap();
+
+        let source_code =
+            "const x = {\n  a: [1, 2, 3],\n  b: \"fôür ✓\",\n};\nfunction f() { return x.a; }\n";
+        let expected_sexp = parser
+            .parse(source_code, None)
+            .unwrap()
+            .root_node()
+            .to_sexp();
+
+        // Make the text available a few bytes at a time, resuming the parse
+        // each time that it runs out. Some of the chunks end in the middle of
+        // a multi-byte character.
+        let mut available = 0;
+        let mut resume_count = 0;
+        let tree = loop {
+            let tree = parser.parse_with_pending(
+                &mut |offset, _| {
+                    if offset >= source_code.len() {
+                        Some(&[] as &[u8])
+                    } else if offset >= available {
+                        None
+                    } else {
+                        Some(&source_code.as_bytes()[offset..available])
+                    }
+                },
+                None,
+            );
+            if let Some(tree) = tree {
+                break tree;
+            }
+            assert!(parser.is_waiting_for_input());
+            available = (available + 3).min(source_code.len());
+            resume_count += 1;
+        };
+
+        assert!(resume_count > 10);
+        assert!(!parser.is_waiting_for_input());
+        assert_eq!(tree.root_node().to_sexp(), expected_sexp);
+    });
+}
+
+#[test]
+fn test_parsing_with_input_chunks_that_split_characters() {
+    let mut parser = Parser::new();
+    parser.set_language(&get_language("json")).unwrap();
+
+    // The input is returned in chunks that end at multiples of four bytes,
+    // so the chunk ending at byte 4 ends in the middle of the `ô`.
+    let source_code = "[\"fôür ✓ ✓\"]";
+    let mut offsets_read = Vec::new();
+    let tree = parser
+        .parse_with(
+            &mut |offset, _| {
+                offsets_read.push(offset);
+                let end = ((offset / 4 + 1) * 4).min(source_code.len());
+                &source_code.as_bytes()[offset.min(end)..end]
+            },
+            None,
+        )
+        .unwrap();
+    assert_eq!(
+        tree.root_node().to_sexp(),
+        "(document (array (string (string_content))))"
+    );
+
+    // The lexer reads the chunk that starts at the split character, and
+    // checks whether the rest of it is pending, before moving on.
+    assert_eq!(offsets_read, [0, 3, 4, 4, 8, 12, 16, 18]);
+}
+
+#[test]
+fn test_parsing_with_pending_input_and_a_reset() {
+    allocations::record(|| {
+        let mut parser = Parser::new();
+        parser.set_language(&get_language("json")).unwrap();
+
+        let tree =
+            parser.parse_with_pending(&mut |offset, _| (offset == 0).then_some(b"[1, 2, "), None);
+        assert!(tree.is_none());
+        assert!(parser.is_waiting_for_input());
+
+        // Resetting the parser discards the partial parse.
+        parser.reset();
+        assert!(!parser.is_waiting_for_input());
+        let tree = parser.parse("[null]", None).unwrap();
+        assert_eq!(tree.root_node().to_sexp(), "(document (array (null)))");
+    });
+}
+
 // Included Ranges
 
 #[test]
@@ -1250,6 +1959,134 @@ fn test_parsing_with_a_newly_included_range() {
     );
 }
 
+#[test]
+fn test_parsing_a_batch_of_included_ranges_concurrently() {
+    let source_code = r#"<script>a(1)</script><script type="application/json">{"b": [1]}</script><script>e</script>"#;
+    let javascript = get_language("javascript");
+    let json = get_language("json");
+
+    let script_ranges = ["a(1)", "e"]
+        .iter()
+        .map(|s| {
+            let start = source_code.find(s).unwrap();
+            simple_range(start, start + s.len())
+        })
+        .collect::<Vec<_>>();
+    let json_start = source_code.find('{').unwrap();
+    let json_ranges = [simple_range(json_start, json_start + r#"{"b": [1]}"#.len())];
+    let invalid_ranges = [simple_range(10, 20), simple_range(5, 8)];
+
+    let jobs = [
+        ParseJob {
+            language: &javascript,
+            ranges: &script_ranges,
+        },
+        ParseJob {
+            language: &json,
+            ranges: &json_ranges,
+        },
+        ParseJob {
+            language: &javascript,
+            ranges: &invalid_ranges,
+        },
+        ParseJob {
+            language: &javascript,
+            ranges: &script_ranges[1..],
+        },
+    ];
+
+    let mut expected = Vec::new();
+    let mut parser = Parser::new();
+    for job in &jobs {
+        parser.set_language(job.language).unwrap();
+        expected.push(parser.set_included_ranges(job.ranges).ok().map(|()| {
+            parser
+                .parse(source_code, None)
+                .unwrap()
+                .root_node()
+                .to_sexp()
+        }));
+    }
+    assert!(expected[2].is_none());
+
+    for parser_count in [1, 2, 8] {
+        let mut parsers = (0..parser_count).map(|_| Parser::new()).collect::<Vec<_>>();
+        let trees = Parser::parse_batch(&mut parsers, source_code.as_bytes(), &jobs);
+        assert_eq!(
+            trees
+                .iter()
+                .map(|tree| tree.as_ref().map(|tree| tree.root_node().to_sexp()))
+                .collect::<Vec<_>>(),
+            expected
+        );
+        assert_eq!(trees[0].as_ref().unwrap().included_ranges(), script_ranges);
+    }
+
+    assert!(Parser::parse_batch(&mut [], source_code.as_bytes(), &jobs)
+        .iter()
+        .all(Option::is_none));
+}
+
+#[test]
+fn test_parsing_in_parallel() {
+    let mut source_code = String::new();
+    for i in 0..50 {
+        source_code +=
+            &format!("function f{i}(a) {{\n  return `${{a}} {i}` + [a, {{b: {i}}}];\n}}\n");
+        source_code += &format!("let x{i} = f{i}(\"{i}\")\n\n");
+    }
+    let line_starts = source_code
+        .match_indices('\n')
+        .map(|(i, _)| i + 1)
+        .collect::<Vec<_>>();
+
+    let mut parser = Parser::new();
+    parser.set_language(&get_language("javascript")).unwrap();
+    let expected = parser
+        .parse(&source_code, None)
+        .unwrap()
+        .root_node()
+        .to_sexp();
+
+    let mut parsers = (0..3).map(|_| Parser::new()).collect::<Vec<_>>();
+    for split_points in [
+        // The starts of top-level statements
+        line_starts.iter().copied().step_by(20).collect::<Vec<_>>(),
+        // Arbitrary offsets, including ones within tokens and template strings
+        vec![
+            1,
+            2,
+            30,
+            31,
+            100,
+            source_code.len() / 2,
+            source_code.len() - 1,
+        ],
+        // Unsorted and out-of-range offsets
+        vec![source_code.len() * 2, 500, 0, 250, 500],
+        vec![],
+    ] {
+        let tree = parser
+            .parse_parallel(&mut parsers, &source_code, &split_points)
+            .unwrap();
+        assert_eq!(tree.root_node().to_sexp(), expected);
+        assert_eq!(tree.root_node().end_byte(), source_code.len());
+    }
+
+    // Splitting at statement boundaries allows most of the nodes to be reused.
+    let split_points = line_starts.iter().copied().step_by(20).collect::<Vec<_>>();
+    parser
+        .parse_parallel(&mut parsers, &source_code, &split_points)
+        .unwrap();
+    assert!(parser.stats().reused_byte_count > source_code.len() as u64 / 2);
+
+    // Without worker parsers, the document is parsed on the current thread.
+    let tree = parser
+        .parse_parallel(&mut [], &source_code, &split_points)
+        .unwrap();
+    assert_eq!(tree.root_node().to_sexp(), expected);
+}
+
 #[test]
 fn test_parsing_with_included_ranges_and_missing_tokens() {
     let (parser_name, parser_code) = generate_parser_for_grammar(
@@ -1,5 +1,6 @@
-use super::helpers::{allocations, fixtures::get_language};
-use tree_sitter::Parser;
+use super::helpers::{allocations, fixtures::get_language, TIME_BUDGETS_ENABLED};
+use std::time::{Duration, Instant};
+use tree_sitter::{Parser, Range};
 
 #[test]
 fn test_pathological_example_1() {
@@ -12,3 +13,285 @@ fn test_pathological_example_1() {
         parser.parse(source, None).unwrap();
     });
 }
+
+// The most that a parse of an adversarial input is allowed to cost.
+//
+// The peak allocation is measured by the recording allocator, and the version
+// count is the largest number of parse stack versions that were live at once,
+// as reported by the parser's stats. The version budgets are below the default
+// policy's ceiling of ten, so a parse that explores more versions than it used
+// to fails the test.
+//
+// Wall-clock times are too noisy to gate on in an unoptimized build that runs
+// alongside other tests, so the time budgets are only checked when the
+// `TREE_SITTER_TIME_BUDGETS` environment variable is set. They are generous
+// enough for unoptimized builds, so they only catch stalls, not small
+// slowdowns.
+struct Budget {
+    millis: u64,
+    peak_kilobytes: usize,
+    max_version_count: usize,
+}
+
+struct Measurement {
+    duration: Duration,
+    peak_bytes: usize,
+    max_version_count: usize,
+}
+
+fn measure_parse(language: &str, source: &str) -> Measurement {
+    let language = get_language(language);
+    let ((duration, max_version_count), peak_bytes) = allocations::record_peak_bytes(|| {
+        let start = Instant::now();
+        let mut parser = Parser::new();
+        parser.set_language(&language).unwrap();
+        let tree = parser.parse(source, None).unwrap();
+        let max_version_count = parser.stats().max_version_count;
+        drop(tree);
+        drop(parser);
+        (start.elapsed(), max_version_count)
+    });
+    Measurement {
+        duration,
+        peak_bytes,
+        max_version_count,
+    }
+}
+
+// Parse an HTML document, then parse the contents of all of its script tags
+// as a single JavaScript document, the way that injections are handled.
+fn measure_injections(source: &str) -> Measurement {
+    let html = get_language("html");
+    let javascript = get_language("javascript");
+    let ((duration, max_version_count), peak_bytes) = allocations::record_peak_bytes(|| {
+        let start = Instant::now();
+        let mut parser = Parser::new();
+        parser.set_language(&html).unwrap();
+        let html_tree = parser.parse(source, None).unwrap();
+        let mut max_version_count = parser.stats().max_version_count;
+
+        let mut ranges = Vec::<Range>::new();
+        let mut cursor = html_tree.walk();
+        for element in html_tree.root_node().children(&mut cursor) {
+            if element.kind() == "script_element" {
+                let mut element_cursor = element.walk();
+                ranges.extend(
+                    element
+                        .children(&mut element_cursor)
+                        .filter(|child| child.kind() == "raw_text")
+                        .map(|child| child.range()),
+                );
+            }
+        }
+        assert!(ranges.len() > 1000);
+
+        parser.set_language(&javascript).unwrap();
+        parser.set_included_ranges(&ranges).unwrap();
+        let javascript_tree = parser.parse(source, None).unwrap();
+        max_version_count = max_version_count.max(parser.stats().max_version_count);
+        drop(javascript_tree);
+        drop(cursor);
+        drop(html_tree);
+        drop(parser);
+        (start.elapsed(), max_version_count)
+    });
+    Measurement {
+        duration,
+        peak_bytes,
+        max_version_count,
+    }
+}
+
+fn check_budget(name: &str, measurement: &Measurement, budget: &Budget) -> Option<String> {
+    eprintln!(
+        "  {name}: {}ms, {}KB peak, {} versions",
+        measurement.duration.as_millis(),
+        measurement.peak_bytes / 1024,
+        measurement.max_version_count,
+    );
+    let mut failures = Vec::new();
+    if *TIME_BUDGETS_ENABLED && measurement.duration > Duration::from_millis(budget.millis) {
+        failures.push(format!(
+            "took {}ms (budget {}ms)",
+            measurement.duration.as_millis(),
+            budget.millis
+        ));
+    }
+    if measurement.peak_bytes > budget.peak_kilobytes * 1024 {
+        failures.push(format!(
+            "allocated {}KB at its peak (budget {}KB)",
+            measurement.peak_bytes / 1024,
+            budget.peak_kilobytes
+        ));
+    }
+    if measurement.max_version_count > budget.max_version_count {
+        failures.push(format!(
+            "had {} live stack versions (budget {})",
+            measurement.max_version_count, budget.max_version_count
+        ));
+    }
+    if failures.is_empty() {
+        None
+    } else {
+        Some(format!("{name} {}", failures.join(", ")))
+    }
+}
+
+#[test]
+fn test_pathological_inputs_stay_within_budgets() {
+    let parse_inputs = [
+        // Deep nesting
+        (
+            "json nested arrays",
+            "json",
+            "[".repeat(10_000) + &"]".repeat(10_000),
+            Budget {
+                millis: 2_000,
+                peak_kilobytes: 5_000,
+                max_version_count: 2,
+            },
+        ),
+        (
+            "json unclosed arrays",
+            "json",
+            "[".repeat(10_000),
+            Budget {
+                millis: 2_000,
+                peak_kilobytes: 5_000,
+                max_version_count: 3,
+            },
+        ),
+        (
+            "javascript nested parentheses",
+            "javascript",
+            "(".repeat(2_000) + &"a)".repeat(2_000),
+            Budget {
+                millis: 3_000,
+                peak_kilobytes: 8_000,
+                max_version_count: 4,
+            },
+        ),
+        (
+            "python nested lists",
+            "python",
+            format!("x = {}{}", "[".repeat(3_000), "]".repeat(3_000)),
+            Budget {
+                millis: 2_000,
+                peak_kilobytes: 6_000,
+                max_version_count: 3,
+            },
+        ),
+        // Huge single tokens
+        (
+            "json huge string",
+            "json",
+            format!("\"{}\"", "a".repeat(1 << 20)),
+            Budget {
+                millis: 1_000,
+                peak_kilobytes: 64,
+                max_version_count: 2,
+            },
+        ),
+        (
+            "rust huge raw string",
+            "rust",
+            format!("const S: &str = r#\"{}\"#;", "a\"".repeat(1 << 19)),
+            Budget {
+                millis: 1_000,
+                peak_kilobytes: 256,
+                max_version_count: 2,
+            },
+        ),
+        (
+            "c huge comment",
+            "c",
+            format!("/*{}*/ int x;", "*".repeat(1 << 20)),
+            Budget {
+                millis: 1_000,
+                peak_kilobytes: 256,
+                max_version_count: 2,
+            },
+        ),
+        // Long error streams
+        (
+            "json error stream",
+            "json",
+            "{:,]}".repeat(20_000),
+            Budget {
+                millis: 5_000,
+                peak_kilobytes: 32_000,
+                max_version_count: 3,
+            },
+        ),
+        (
+            "json unterminated strings",
+            "json",
+            "\"a\\".repeat(20_000),
+            Budget {
+                millis: 3_000,
+                peak_kilobytes: 8_000,
+                max_version_count: 3,
+            },
+        ),
+        (
+            "javascript error stream",
+            "javascript",
+            "}{)(:;=>".repeat(5_000),
+            Budget {
+                millis: 5_000,
+                peak_kilobytes: 40_000,
+                max_version_count: 6,
+            },
+        ),
+        // Ambiguous regions that the parser has to explore with several
+        // stack versions
+        (
+            "c ambiguous statements",
+            "c",
+            format!(
+                "void f() {{ {} }}",
+                "a * b; (a)(b); c * d = e;".repeat(2_000)
+            ),
+            Budget {
+                millis: 3_000,
+                peak_kilobytes: 40_000,
+                max_version_count: 4,
+            },
+        ),
+        (
+            "cpp ambiguous templates",
+            "cpp",
+            "int x = f(a < b, c > (d));".repeat(2_000),
+            Budget {
+                millis: 3_000,
+                peak_kilobytes: 40_000,
+                max_version_count: 4,
+            },
+        ),
+    ];
+
+    let mut failures = Vec::new();
+    for (name, language, source, budget) in &parse_inputs {
+        let measurement = measure_parse(language, source);
+        failures.extend(check_budget(name, &measurement, budget));
+    }
+
+    // Many injections
+    let measurement =
+        measure_injections(&"<script>let a = b(c);</script><p>text</p>\n".repeat(2_000));
+    failures.extend(check_budget(
+        "html many script injections",
+        &measurement,
+        &Budget {
+            millis: 3_000,
+            peak_kilobytes: 40_000,
+            max_version_count: 4,
+        },
+    ));
+
+    assert!(
+        failures.is_empty(),
+        "Pathological inputs exceeded their budgets:\n  {}",
+        failures.join("\n  ")
+    );
+}
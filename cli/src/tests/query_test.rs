@@ -6,15 +6,24 @@ use super::helpers::{
 };
 use crate::{
     generate::generate_parser_for_grammar,
+    parse::{perform_edit, Edit},
     tests::helpers::query_helpers::{collect_captures, collect_matches},
 };
 use indoc::indoc;
 use lazy_static::lazy_static;
 use rand::{prelude::StdRng, SeedableRng};
-use std::{env, fmt::Write};
+use std::{
+    env,
+    ffi::{c_char, c_void},
+    fmt::Write,
+    iter,
+    panic::{self, AssertUnwindSafe},
+    ptr, slice,
+};
 use tree_sitter::{
-    CaptureQuantifier, Language, Node, Parser, Point, Query, QueryCursor, QueryError,
-    QueryErrorKind, QueryPredicate, QueryPredicateArg, QueryProperty,
+    ffi, CaptureQuantifier, Language, Node, Parser, Point, Query, QueryCursor, QueryError,
+    QueryErrorKind, QueryPatternStats, QueryPredicate, QueryPredicateArg, QueryProperty,
+    QuerySession,
 };
 use unindent::Unindent;
 
@@ -1735,6 +1744,60 @@ fn test_query_matches_with_too_many_permutations_to_track() {
     });
 }
 
+#[test]
+fn test_query_pattern_stats() {
+    allocations::record(|| {
+        let language = get_language("javascript");
+        let query = Query::new(
+            &language,
+            "
+            (string) @string
+            (array (identifier) @pre (identifier) @post)
+            (comment) @comment
+        ",
+        )
+        .unwrap();
+
+        let mut source = "hello, ".repeat(50);
+        source.insert(0, '[');
+        source.push_str("'world'];");
+
+        let mut parser = Parser::new();
+        parser.set_language(&language).unwrap();
+        let tree = parser.parse(&source, None).unwrap();
+        let mut cursor = QueryCursor::new();
+        cursor.set_match_limit(32);
+
+        // Statistics are only collected when they are enabled.
+        cursor
+            .matches(&query, tree.root_node(), source.as_bytes())
+            .for_each(drop);
+        assert!(!cursor.pattern_stats_enabled());
+        assert_eq!(cursor.pattern_stats(1), QueryPatternStats::default());
+
+        cursor.set_pattern_stats_enabled(true);
+        cursor
+            .matches(&query, tree.root_node(), source.as_bytes())
+            .for_each(drop);
+        assert!(cursor.did_exceed_match_limit());
+
+        let string_stats = cursor.pattern_stats(0);
+        assert_eq!(string_stats.started_state_count, 1);
+        assert_eq!(string_stats.copied_state_count, 0);
+        assert_eq!(string_stats.dropped_state_count, 0);
+        assert_eq!(string_stats.capture_list_count, 1);
+
+        // The pathological pattern is the one that copies and drops states.
+        let array_stats = cursor.pattern_stats(1);
+        assert_eq!(array_stats.started_state_count, 1);
+        assert!(array_stats.copied_state_count > 32);
+        assert!(array_stats.dropped_state_count > 0);
+
+        assert_eq!(cursor.pattern_stats(2), QueryPatternStats::default());
+        assert_eq!(cursor.pattern_stats(3), QueryPatternStats::default());
+    });
+}
+
 #[test]
 fn test_query_sibling_patterns_dont_match_children_of_an_error() {
     allocations::record(|| {
@@ -2827,6 +2890,204 @@ fn test_query_matches_with_indefinite_step_containing_no_captures() {
     });
 }
 
+#[test]
+fn test_query_multi_matches_and_captures() {
+    allocations::record(|| {
+        let language = get_language("javascript");
+        let queries = [
+            Query::new(&language, "(identifier) @id").unwrap(),
+            Query::new(
+                &language,
+                r#"
+                ((identifier) @constant
+                 (#match? @constant "^[A-Z]"))
+                (number) @number
+                "#,
+            )
+            .unwrap(),
+            Query::new(
+                &language,
+                "(call_expression function: (identifier) @function arguments: (_) @args)",
+            )
+            .unwrap(),
+        ];
+        let query_refs = queries.iter().collect::<Vec<_>>();
+
+        let source = "const A = b(C, 1);\nd(e, 2);\n";
+        let mut parser = Parser::new();
+        parser.set_language(&language).unwrap();
+        let tree = parser.parse(source, None).unwrap();
+        let mut cursor = QueryCursor::new();
+
+        // Each query's matches are the same as when it runs by itself.
+        let mut matches_by_query = vec![Vec::new(); queries.len()];
+        for (query_index, m) in
+            cursor.multi_matches(&query_refs, tree.root_node(), source.as_bytes())
+        {
+            matches_by_query[query_index].push((
+                m.pattern_index,
+                m.captures
+                    .iter()
+                    .map(|c| {
+                        (
+                            queries[query_index].capture_names()[c.index as usize],
+                            c.node.utf8_text(source.as_bytes()).unwrap(),
+                        )
+                    })
+                    .collect::<Vec<_>>(),
+            ));
+        }
+        for (query, query_matches) in queries.iter().zip(&matches_by_query) {
+            let matches = cursor.matches(query, tree.root_node(), source.as_bytes());
+            assert_eq!(query_matches, &collect_matches(matches, query, source));
+        }
+        assert_eq!(
+            matches_by_query[1],
+            &[
+                (0, vec![("constant", "A")]),
+                (0, vec![("constant", "C")]),
+                (1, vec![("number", "1")]),
+                (1, vec![("number", "2")]),
+            ]
+        );
+
+        // Captures from all of the queries are returned in order.
+        let captures = cursor
+            .multi_captures(&query_refs, tree.root_node(), source.as_bytes())
+            .map(|(query_index, m, capture_index)| {
+                let capture = m.captures[capture_index];
+                (
+                    query_index,
+                    queries[query_index].capture_names()[capture.index as usize],
+                    capture.node.utf8_text(source.as_bytes()).unwrap(),
+                )
+            })
+            .collect::<Vec<_>>();
+        assert_eq!(
+            captures,
+            &[
+                (0, "id", "A"),
+                (1, "constant", "A"),
+                (0, "id", "b"),
+                (2, "function", "b"),
+                (2, "args", "(C, 1)"),
+                (0, "id", "C"),
+                (1, "constant", "C"),
+                (1, "number", "1"),
+                (0, "id", "d"),
+                (2, "function", "d"),
+                (2, "args", "(e, 2)"),
+                (0, "id", "e"),
+                (1, "number", "2"),
+            ]
+        );
+    });
+}
+
+#[test]
+fn test_query_serialization() {
+    allocations::record(|| {
+        let language = get_language("javascript");
+        let query = Query::new(
+            &language,
+            r#"
+            ((identifier) @constant
+             (#match? @constant "^[A-Z]")
+             (#set! kind "constant"))
+            (call_expression
+              function: (member_expression
+                object: (_) @object
+                !computed
+                property: (property_identifier) @method)+ @call)
+            [(number) (string)] @literal
+            "#,
+        )
+        .unwrap();
+
+        let data = query.serialize();
+        let loaded = Query::deserialize(&language, &data).unwrap();
+        assert_eq!(loaded.pattern_count(), query.pattern_count());
+        assert_eq!(loaded.capture_names(), query.capture_names());
+        assert_eq!(loaded.property_settings(0), query.property_settings(0));
+        assert_eq!(loaded.serialize(), data);
+
+        let source = "const A = a.b(B, 1).c('d');\n";
+        let mut parser = Parser::new();
+        parser.set_language(&language).unwrap();
+        let tree = parser.parse(source, None).unwrap();
+        let mut cursor = QueryCursor::new();
+        let expected = collect_matches(
+            cursor.matches(&query, tree.root_node(), source.as_bytes()),
+            &query,
+            source,
+        );
+        let matches = collect_matches(
+            cursor.matches(&loaded, tree.root_node(), source.as_bytes()),
+            &loaded,
+            source,
+        );
+        assert!(!matches.is_empty());
+        assert_eq!(matches, expected);
+
+        // Truncated data and data for another language are rejected.
+        for length in 0..data.len() {
+            assert!(Query::deserialize(&language, &data[..length]).is_none());
+        }
+        assert!(Query::deserialize(&get_language("python"), &data).is_none());
+    });
+}
+
+#[test]
+fn test_query_parallel_matches() {
+    allocations::record(|| {
+        let language = get_language("javascript");
+        let query = Query::new(
+            &language,
+            r#"
+            (identifier) @id
+            (program) @program
+            ((comment) @comment . (function_declaration) @function)
+            "#,
+        )
+        .unwrap();
+        assert!(query.is_pattern_non_local(2));
+
+        let mut source = String::new();
+        for i in 0..50 {
+            source += &format!("// f{i}\nfunction f{i}(a) {{ return g(a, {i}); }}\n");
+        }
+        let mut parser = Parser::new();
+        parser.set_language(&language).unwrap();
+        let tree = parser.parse(&source, None).unwrap();
+
+        let key = |pattern_index: usize, captures: &[QueryCapture]| {
+            (
+                captures.iter().map(|c| c.node.start_byte()).min(),
+                pattern_index,
+                captures
+                    .iter()
+                    .map(|c| (c.index, c.node.id()))
+                    .collect::<Vec<_>>(),
+            )
+        };
+        let mut cursor = QueryCursor::new();
+        let mut expected = cursor
+            .matches(&query, tree.root_node(), source.as_bytes())
+            .map(|m| key(m.pattern_index, m.captures))
+            .collect::<Vec<_>>();
+        expected.sort();
+
+        for thread_count in [1, 2, 7] {
+            let matches = query
+                .parallel_matches(tree.root_node(), source.as_bytes(), thread_count)
+                .iter()
+                .map(|m| key(m.pattern_index, &m.captures))
+                .collect::<Vec<_>>();
+            assert_eq!(matches, expected);
+        }
+    });
+}
+
 #[test]
 fn test_query_captures_basic() {
     allocations::record(|| {
@@ -3432,6 +3693,47 @@ fn test_query_captures_ordered_by_both_start_and_end_positions() {
     });
 }
 
+#[test]
+fn test_query_captures_ordered_behind_many_finished_matches() {
+    allocations::record(|| {
+        let language = get_language("json");
+        let query = Query::new(
+            &language,
+            r"
+            (object (pair) @pair (pair value: (null)))
+            (number) @number
+            ",
+        )
+        .unwrap();
+
+        // The matches for every number finish long before the ones for the
+        // pairs, which can't be returned until the last pair is reached, so
+        // all of the numbers' matches must be held back in order.
+        let numbers = (0..500).map(|i| i.to_string()).collect::<Vec<_>>();
+        let array = format!("[{}]", numbers.join(", "));
+        let source = format!(r#"{{"a": 1, "b": {array}, "c": null}}"#);
+
+        let mut parser = Parser::new();
+        parser.set_language(&language).unwrap();
+        let tree = parser.parse(&source, None).unwrap();
+        let mut cursor = QueryCursor::new();
+
+        let captures = cursor.captures(&query, tree.root_node(), source.as_bytes());
+        let b_pair = format!(r#""b": {array}"#);
+        assert_eq!(
+            collect_captures(captures, &query, &source),
+            [
+                ("pair", r#""a": 1"#),
+                ("number", "1"),
+                ("pair", b_pair.as_str())
+            ]
+            .into_iter()
+            .chain(numbers.iter().map(|number| ("number", number.as_str())))
+            .collect::<Vec<_>>(),
+        );
+    });
+}
+
 #[test]
 fn test_query_captures_with_matches_removed() {
     allocations::record(|| {
@@ -3561,6 +3863,328 @@ fn test_query_captures_and_matches_iterators_are_fused() {
     });
 }
 
+#[test]
+fn test_query_multi_matches_pattern_and_query_limits() {
+    allocations::record(|| {
+        let language = get_language("json");
+        let source = "[1]";
+        let mut parser = Parser::new();
+        parser.set_language(&language).unwrap();
+        let tree = parser.parse(source, None).unwrap();
+        let mut cursor = QueryCursor::new();
+
+        // Up to 65535 patterns can be run at once.
+        let query = Query::new(&language, &"(number) @number\n".repeat(1000)).unwrap();
+        let last_query = Query::new(&language, &"(number) @number\n".repeat(535)).unwrap();
+        let mut queries = vec![&query; 65];
+        queries.push(&last_query);
+        let matches = cursor
+            .multi_matches(&queries, tree.root_node(), source.as_bytes())
+            .map(|(query_index, m)| (query_index, m.pattern_index))
+            .collect::<Vec<_>>();
+        assert_eq!(matches.len(), 65535);
+        assert_eq!(matches.iter().filter(|m| m.0 == 65).count(), 535);
+        assert!(matches.contains(&(65, 534)));
+
+        // With more patterns, or more queries, there are no results.
+        let last_query = Query::new(&language, &"(number) @number\n".repeat(536)).unwrap();
+        queries[65] = &last_query;
+        assert_eq!(
+            cursor
+                .multi_matches(&queries, tree.root_node(), source.as_bytes())
+                .count(),
+            0
+        );
+        let empty_query = Query::new(&language, "").unwrap();
+        assert_eq!(empty_query.pattern_count(), 0);
+        assert_eq!(
+            cursor
+                .multi_matches(
+                    &vec![&empty_query; 65536],
+                    tree.root_node(),
+                    source.as_bytes()
+                )
+                .count(),
+            0
+        );
+    });
+}
+
+#[test]
+fn test_query_text_predicates_with_multiple_queries() {
+    allocations::record(|| {
+        let language = get_language("javascript");
+        let query1 = Query::new(
+            &language,
+            r#"
+            (assignment_expression
+              left: (identifier) @left
+              right: (identifier) @right
+              (#eq? @left @right))
+            "#,
+        )
+        .unwrap();
+        let query2 = Query::new(
+            &language,
+            r#"
+            ((identifier) @constant
+             (#match? @constant "^[A-Z_]+$")
+             (#not-any-of? @constant "NaN" "PI"))
+            "#,
+        )
+        .unwrap();
+
+        let source = "a = a; b = c; PI = PI; D_E = NaN;";
+
+        let mut parser = Parser::new();
+        parser.set_language(&language).unwrap();
+        let tree = parser.parse(source, None).unwrap();
+        let mut cursor = QueryCursor::new();
+
+        // Return every node's text one byte at a time, so that the text of
+        // each node must be assembled before the predicates see it.
+        let text = |node: Node| source[node.byte_range()].as_bytes().chunks(1);
+
+        let matches = cursor
+            .multi_matches(&[&query1, &query2], tree.root_node(), text)
+            .map(|(query_index, m)| {
+                (
+                    query_index,
+                    m.captures
+                        .iter()
+                        .map(|c| c.node.utf8_text(source.as_bytes()).unwrap())
+                        .collect::<Vec<_>>(),
+                )
+            })
+            .collect::<Vec<_>>();
+        assert_eq!(
+            matches,
+            &[(0, vec!["a", "a"]), (0, vec!["PI", "PI"]), (1, vec!["D_E"]),],
+        );
+
+        let captures = cursor
+            .multi_captures(&[&query1, &query2], tree.root_node(), text)
+            .map(|(query_index, m, capture_index)| {
+                (
+                    query_index,
+                    m.captures[capture_index]
+                        .node
+                        .utf8_text(source.as_bytes())
+                        .unwrap(),
+                )
+            })
+            .collect::<Vec<_>>();
+        assert_eq!(
+            captures,
+            &[(0, "a"), (0, "a"), (0, "PI"), (0, "PI"), (1, "D_E")],
+        );
+    });
+}
+
+#[test]
+fn test_query_text_predicates_with_regexes_that_fail_to_compile() {
+    allocations::record(|| {
+        let language = get_language("json");
+        let source = r#"["a", "b", "c"]"#;
+        let mut parser = Parser::new();
+        parser.set_language(&language).unwrap();
+        let tree = parser.parse(source, None).unwrap();
+
+        // A regex engine that can only compile the pattern `.`.
+        unsafe extern "C" fn compile(
+            payload: *mut c_void,
+            pattern: *const c_char,
+            length: u32,
+        ) -> *mut c_void {
+            *payload.cast::<usize>() += 1;
+            let pattern = slice::from_raw_parts(pattern.cast::<u8>(), length as usize);
+            if pattern == b"." {
+                Box::into_raw(Box::new(0_u8)).cast()
+            } else {
+                ptr::null_mut()
+            }
+        }
+        unsafe extern "C" fn is_match(
+            _payload: *mut c_void,
+            _regex: *const c_void,
+            _text: *const c_char,
+            _length: u32,
+        ) -> bool {
+            true
+        }
+        unsafe extern "C" fn destroy(_payload: *mut c_void, regex: *mut c_void) {
+            drop(Box::from_raw(regex.cast::<u8>()));
+        }
+
+        let mut compile_count = 0_usize;
+        let mut cursor = unsafe {
+            let ptr = QueryCursor::new().into_raw();
+            ffi::ts_query_cursor_set_regex_engine(
+                ptr,
+                ffi::TSQueryRegexEngine {
+                    payload: ptr::addr_of_mut!(compile_count).cast(),
+                    compile: Some(compile),
+                    is_match: Some(is_match),
+                    destroy: Some(destroy),
+                },
+            );
+            QueryCursor::from_raw(ptr)
+        };
+        let text = |node: Node| iter::once(&source.as_bytes()[node.byte_range()]);
+        let mut match_count = |predicate: &str| {
+            let query =
+                Query::new(&language, &format!("((string_content) @id {predicate})")).unwrap();
+            cursor.matches(&query, tree.root_node(), text).count()
+        };
+
+        // Neither the predicate nor its negation is satisfied by a regex that
+        // can't be compiled, and the failure is only reported once.
+        assert_eq!(match_count(r#"(#match? @id ".")"#), 3);
+        assert_eq!(match_count(r#"(#match? @id "[a-z]")"#), 0);
+        assert_eq!(match_count(r#"(#not-match? @id "[a-z]")"#), 0);
+        assert_eq!(match_count(r#"(#any-match? @id "[a-z]")"#), 0);
+        assert_eq!(match_count(r#"(#any-not-match? @id "[a-z]")"#), 0);
+        drop(match_count);
+        assert_eq!(compile_count, 2);
+    });
+}
+
+#[test]
+fn test_query_text_provider_that_panics() {
+    allocations::record(|| {
+        let language = get_language("json");
+        let source = r#"["a", "b", "c"]"#;
+        let mut parser = Parser::new();
+        parser.set_language(&language).unwrap();
+        let tree = parser.parse(source, None).unwrap();
+        let query = Query::new(&language, r#"((string_content) @id (#not-eq? @id "a"))"#).unwrap();
+        let mut cursor = QueryCursor::new();
+
+        // The panic is resumed once the query cursor returns.
+        let result = panic::catch_unwind(AssertUnwindSafe(|| {
+            cursor
+                .matches(&query, tree.root_node(), |node: Node| {
+                    let text = &source.as_bytes()[node.byte_range()];
+                    assert_ne!(text, b"b", "text provider panicked");
+                    iter::once(text)
+                })
+                .count()
+        }));
+        let error = result.unwrap_err();
+        let message = error
+            .downcast_ref::<String>()
+            .map(String::as_str)
+            .or_else(|| error.downcast_ref::<&str>().copied())
+            .unwrap();
+        assert!(message.contains("text provider panicked"), "{message}");
+
+        // The cursor can still be used afterward.
+        let text = |node: Node| iter::once(&source.as_bytes()[node.byte_range()]);
+        let captures = cursor
+            .matches(&query, tree.root_node(), text)
+            .map(|m| m.captures[0].node.utf8_text(source.as_bytes()).unwrap())
+            .collect::<Vec<_>>();
+        assert_eq!(captures, ["b", "c"]);
+    });
+}
+
+#[test]
+fn test_query_session_incremental_updates() {
+    allocations::record(|| {
+        let language = get_language("javascript");
+        let query = Query::new(
+            &language,
+            r#"
+            (function_declaration name: (identifier) @function)
+            ((identifier) @constant (#match? @constant "^[A-Z_]+$"))
+            ((comment) @doc . (function_declaration))
+            "#,
+        )
+        .unwrap();
+
+        let mut source =
+            b"// a\nfunction one() { return A; }\nfunction two() { return b; }\n".to_vec();
+        let mut parser = Parser::new();
+        parser.set_language(&language).unwrap();
+        let mut tree = parser.parse(&source, None).unwrap();
+        let mut cursor = QueryCursor::new();
+        let mut session = QuerySession::new(&query);
+        session.update(&mut cursor, tree.root_node(), &[], source.as_slice());
+
+        let session_matches = |session: &QuerySession, source: &[u8]| {
+            session
+                .matches()
+                .map(|m| {
+                    let captures = m
+                        .captures()
+                        .map(|(index, range)| {
+                            format!(
+                                "{}: {}",
+                                query.capture_names()[index as usize],
+                                std::str::from_utf8(&source[range.start_byte..range.end_byte])
+                                    .unwrap()
+                            )
+                        })
+                        .collect::<Vec<_>>();
+                    (m.pattern_index, captures.join(", "))
+                })
+                .collect::<Vec<_>>()
+        };
+
+        let b_position = source.windows(2).position(|w| w == b"b;").unwrap();
+        for edit in [
+            Edit {
+                position: b_position,
+                deleted_length: 1,
+                inserted_text: b"B".to_vec(),
+            },
+            Edit {
+                position: 0,
+                deleted_length: 5,
+                inserted_text: Vec::new(),
+            },
+            Edit {
+                position: 0,
+                deleted_length: 0,
+                inserted_text: b"// z\nfunction zero() {}\n".to_vec(),
+            },
+        ] {
+            let input_edit = perform_edit(&mut tree, &mut source, &edit).unwrap();
+            session.edit(&input_edit);
+            let new_tree = parser.parse(&source, Some(&tree)).unwrap();
+            let changed_ranges = tree.changed_ranges(&new_tree).collect::<Vec<_>>();
+            session.update(
+                &mut cursor,
+                new_tree.root_node(),
+                &changed_ranges,
+                source.as_slice(),
+            );
+            tree = new_tree;
+
+            // The session's matches are the same as those found by running the
+            // query over the whole new tree.
+            let mut fresh_session = QuerySession::new(&query);
+            fresh_session.update(&mut cursor, tree.root_node(), &[], source.as_slice());
+            assert_eq!(
+                session_matches(&session, &source),
+                session_matches(&fresh_session, &source),
+            );
+        }
+
+        assert_eq!(
+            session_matches(&session, &source),
+            &[
+                (2, "doc: // z".to_string()),
+                (0, "function: zero".to_string()),
+                (0, "function: one".to_string()),
+                (1, "constant: A".to_string()),
+                (0, "function: two".to_string()),
+                (1, "constant: B".to_string()),
+            ],
+        );
+    });
+}
+
 #[test]
 fn test_query_text_callback_returns_chunks() {
     allocations::record(|| {
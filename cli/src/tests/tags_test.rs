@@ -2,6 +2,7 @@ use super::helpers::{
     allocations,
     fixtures::{get_language, get_language_queries_path},
 };
+use crate::parse::{perform_edit, Edit};
 use std::{
     ffi::{CStr, CString},
     fs, ptr, slice, str,
@@ -330,6 +331,95 @@ fn test_tags_with_parse_error() {
     );
 }
 
+#[test]
+fn test_tags_incremental() {
+    let language = get_language("javascript");
+    let tags_config = TagsConfiguration::new(language, JS_TAG_QUERY, "").unwrap();
+    let mut tag_context = TagsContext::new();
+
+    let mut source = br"
+// Compute the first value.
+function first() { return helper(1); }
+
+// Compute the second value.
+function second() {
+  return helper(2);
+}
+
+// Compute the third value.
+function third() { return helper(3); }
+"
+    .to_vec();
+
+    let mut tags = tag_context
+        .generate_tags(&tags_config, &source, None)
+        .unwrap()
+        .0
+        .collect::<Result<Vec<_>, _>>()
+        .unwrap();
+    let mut tree = tag_context.parser().parse(&source, None).unwrap();
+
+    let edits = [
+        // Rename a function in the middle of the file.
+        Edit {
+            position: source.windows(6).position(|w| w == b"second").unwrap(),
+            deleted_length: 6,
+            inserted_text: b"middle".to_vec(),
+        },
+        // Change the doc comment of the last function.
+        Edit {
+            position: source.windows(5).position(|w| w == b"third").unwrap() + 5,
+            deleted_length: 0,
+            inserted_text: b" final".to_vec(),
+        },
+        // Add a function at the start of the file, moving everything else.
+        Edit {
+            position: 0,
+            deleted_length: 0,
+            inserted_text: b"\nfunction zeroth() {\n  helper(0);\n}\n".to_vec(),
+        },
+    ];
+
+    for edit in &edits {
+        let input_edit = perform_edit(&mut tree.clone(), &mut source, edit).unwrap();
+        let (new_tree, new_tags, failed) = tag_context
+            .generate_tags_incrementally(&tags_config, &source, &tree, &tags, &[input_edit], None)
+            .unwrap();
+        assert!(!failed);
+
+        let expected_tags = TagsContext::new()
+            .generate_tags(&tags_config, &source, None)
+            .unwrap()
+            .0
+            .collect::<Result<Vec<_>, _>>()
+            .unwrap();
+        assert_eq!(format!("{new_tags:?}"), format!("{expected_tags:?}"));
+
+        tree = new_tree;
+        tags = new_tags;
+    }
+
+    assert_eq!(
+        tags.iter()
+            .map(|t| (
+                substr(&source, &t.name_range),
+                tags_config.syntax_type_name(t.syntax_type_id),
+                t.docs.as_deref(),
+            ))
+            .collect::<Vec<_>>(),
+        &[
+            ("zeroth", "function", None),
+            ("helper", "call", None),
+            ("first", "function", Some("Compute the first value.")),
+            ("helper", "call", None),
+            ("middle", "function", Some("Compute the second value.")),
+            ("helper", "call", None),
+            ("third", "function", Some("Compute the third final value.")),
+            ("helper", "call", None),
+        ]
+    );
+}
+
 #[test]
 fn test_tags_via_c_api() {
     allocations::record(|| {
@@ -1,8 +1,11 @@
 use super::helpers::edits::invert_edit;
 use super::helpers::fixtures::get_language;
+use super::helpers::random::Rand;
 use crate::parse::{perform_edit, Edit};
-use std::str;
-use tree_sitter::{InputEdit, Parser, Point, Range, Tree};
+use std::{str, thread};
+use tree_sitter::{
+    DiffChange, InputEdit, LineIndex, Parser, Point, Query, QueryCursor, Range, Tree, TreeReclaimer,
+};
 
 #[test]
 fn test_tree_edit() {
@@ -297,6 +300,223 @@ fn test_tree_edit_with_included_ranges() {
     );
 }
 
+#[test]
+fn test_tree_serialization() {
+    let mut parser = Parser::new();
+    let language = get_language("python");
+    parser.set_language(&language).unwrap();
+
+    let mut source = b"def a():\n    if b:\n        c(d, e)\n    return \"x\"\n".to_vec();
+    let tree = parser.parse(&source, None).unwrap();
+
+    let data = tree.serialize();
+    let mut loaded_tree = Tree::deserialize(&data, &language).unwrap();
+    assert_eq!(
+        loaded_tree.root_node().to_sexp(),
+        tree.root_node().to_sexp()
+    );
+    assert_eq!(loaded_tree.included_ranges(), tree.included_ranges());
+    assert_eq!(loaded_tree.serialize(), data);
+
+    // Truncated data and trees from other languages are rejected.
+    assert!(Tree::deserialize(&data[0..data.len() - 1], &language).is_none());
+    assert!(Tree::deserialize(&[], &language).is_none());
+    assert!(Tree::deserialize(&data, &get_language("javascript")).is_none());
+
+    // The deserialized tree can be used for an incremental parse.
+    let edit = Edit {
+        position: 29,
+        deleted_length: 1,
+        inserted_text: b"f, g".to_vec(),
+    };
+    let mut original_tree = tree.clone();
+    let mut original_source = source.clone();
+    perform_edit(&mut original_tree, &mut original_source, &edit).unwrap();
+    perform_edit(&mut loaded_tree, &mut source, &edit).unwrap();
+
+    let new_tree = parser.parse(&source, Some(&loaded_tree)).unwrap();
+    let expected_tree = parser
+        .parse(&original_source, Some(&original_tree))
+        .unwrap();
+    assert_eq!(
+        new_tree.root_node().to_sexp(),
+        expected_tree.root_node().to_sexp()
+    );
+    assert_eq!(
+        loaded_tree.changed_ranges(&new_tree).collect::<Vec<_>>(),
+        original_tree
+            .changed_ranges(&expected_tree)
+            .collect::<Vec<_>>()
+    );
+}
+
+#[test]
+fn test_tree_deserialization_of_corrupted_data() {
+    let mut parser = Parser::new();
+    let language = get_language("json");
+    parser.set_language(&language).unwrap();
+    let tree = parser
+        .parse(
+            r#"{"a": [1, 2, {"b": null}], "c": "x", "d": [true, [[]]], e}"#,
+            None,
+        )
+        .unwrap();
+    let data = tree.serialize();
+
+    for length in 0..data.len() {
+        assert!(Tree::deserialize(&data[0..length], &language).is_none());
+    }
+
+    // Corrupted data is either rejected, or produces a tree that can be
+    // navigated safely.
+    let mut rand = Rand::new(0);
+    for _ in 0..10_000 {
+        let mut corrupted = data.clone();
+        for _ in 0..=rand.unsigned(2) {
+            let index = rand.unsigned(corrupted.len() - 1);
+            corrupted[index] = rand.unsigned(255) as u8;
+        }
+        if let Some(loaded_tree) = Tree::deserialize(&corrupted, &language) {
+            let root = loaded_tree.root_node();
+            let _ = root.to_sexp();
+            let mut cursor = root.walk();
+            for index in 0..root.descendant_count() {
+                cursor.goto_descendant(index);
+                let node = cursor.node();
+                for i in 0..node.child_count() {
+                    let _ = node.child(i);
+                    let _ = node.field_name_for_child(i as u32);
+                }
+                for i in 0..node.named_child_count() {
+                    let _ = node.named_child(i);
+                }
+            }
+        }
+    }
+}
+
+#[test]
+fn test_tree_flatten() {
+    let mut parser = Parser::new();
+    parser.set_language(&get_language("rust")).unwrap();
+
+    let tree = parser
+        .parse(
+            "struct Stuff {\n    a: A,\n    b: Option<B>,\n}\nfn f() { g(1, 2); }\n",
+            None,
+        )
+        .unwrap();
+    let flat = tree.flatten();
+
+    // Walk the tree in pre-order, recording each node's index, parent and field.
+    let mut nodes = Vec::new();
+    let mut parents = Vec::new();
+    let mut stack = Vec::<usize>::new();
+    let mut cursor = tree.walk();
+    loop {
+        let index = nodes.len();
+        nodes.push((cursor.node(), cursor.field_id().map_or(0, |id| id.get())));
+        parents.push(stack.last().copied());
+        if cursor.goto_first_child() {
+            stack.push(index);
+            continue;
+        }
+        while !cursor.goto_next_sibling() {
+            if !cursor.goto_parent() {
+                break;
+            }
+            stack.pop();
+        }
+        if stack.is_empty() {
+            break;
+        }
+    }
+
+    drop(cursor);
+
+    assert_eq!(flat.len(), nodes.len());
+    assert_eq!(flat.parent(0), None);
+    assert_eq!(flat.next_sibling(0), None);
+    for (i, (node, field_id)) in nodes.iter().enumerate() {
+        assert_eq!(flat.symbols()[i], node.kind_id());
+        assert_eq!(flat.start_bytes()[i] as usize, node.start_byte());
+        assert_eq!(flat.end_bytes()[i] as usize, node.end_byte());
+        assert_eq!(flat.start_position(i), node.start_position());
+        assert_eq!(flat.field_ids()[i], *field_id);
+        assert_eq!(flat.parent(i), parents[i]);
+
+        let first_child = flat.first_child(i);
+        assert_eq!(first_child.is_some(), node.child_count() > 0);
+        if let Some(child) = first_child {
+            assert_eq!(nodes[child].0, node.child(0).unwrap());
+        }
+        if let Some(sibling) = flat.next_sibling(i) {
+            assert_eq!(Some(nodes[sibling].0), node.next_sibling());
+        } else if i > 0 {
+            assert_eq!(node.next_sibling(), None);
+        }
+    }
+
+    // The snapshot outlives the tree that produced it.
+    drop(tree);
+    assert_eq!(flat.start_bytes()[0], 0);
+}
+
+#[test]
+fn test_tree_freeze() {
+    let mut parser = Parser::new();
+    let language = get_language("rust");
+    parser.set_language(&language).unwrap();
+
+    let source = "fn a() { b(c, d); }\nstruct E { f: G }\nimpl E { fn h(&self) {} }\n".repeat(20);
+    let mut tree = parser.parse(&source, None).unwrap();
+    tree.set_parent_index_enabled(true);
+    let query = Query::new(&language, "(call_expression function: (identifier) @f)").unwrap();
+
+    let tree = tree.freeze();
+    let results = thread::scope(|scope| {
+        (0..4)
+            .map(|_| {
+                scope.spawn(|| {
+                    let mut node_count = 0;
+                    let mut cursor = tree.walk();
+                    let mut ancestors = Vec::new();
+                    loop {
+                        let node = cursor.node();
+                        assert_eq!(node.parent(), ancestors.last().copied());
+                        node_count += 1;
+                        if cursor.goto_first_child() {
+                            ancestors.push(node);
+                            continue;
+                        }
+                        while !cursor.goto_next_sibling() {
+                            if !cursor.goto_parent() {
+                                break;
+                            }
+                            ancestors.pop();
+                        }
+                        if ancestors.is_empty() {
+                            break;
+                        }
+                    }
+
+                    let mut query_cursor = QueryCursor::new();
+                    let capture_count = query_cursor
+                        .matches(&query, tree.root_node(), source.as_bytes())
+                        .count();
+                    (node_count, capture_count)
+                })
+            })
+            .collect::<Vec<_>>()
+            .into_iter()
+            .map(|handle| handle.join().unwrap())
+            .collect::<Vec<_>>()
+    });
+
+    assert_eq!(results[0].1, 20);
+    assert!(results.iter().all(|result| *result == results[0]));
+}
+
 #[test]
 fn test_tree_cursor() {
     let mut parser = Parser::new();
@@ -452,6 +672,43 @@ fn test_tree_cursor_fields() {
     assert_eq!(cursor.field_name(), Some("parameters"));
 }
 
+#[test]
+fn test_tree_cursor_goto_child_by_field_name() {
+    let mut parser = Parser::new();
+    parser.set_language(&get_language("javascript")).unwrap();
+
+    let tree = parser
+        .parse("function /*1*/ bar /*2*/ (a, b) { return a; }", None)
+        .unwrap();
+    let function_node = tree.root_node().child(0).unwrap();
+    assert_eq!(function_node.kind(), "function_declaration");
+
+    let mut cursor = function_node.walk();
+    for field_name in ["name", "parameters", "body", "value"] {
+        cursor.reset(function_node);
+        let child = function_node.child_by_field_name(field_name);
+        assert_eq!(cursor.goto_child_by_field_name(field_name), child.is_some());
+        if let Some(child) = child {
+            assert_eq!(cursor.node(), child);
+            assert_eq!(cursor.field_name(), Some(field_name));
+        } else {
+            assert_eq!(cursor.node(), function_node);
+        }
+    }
+
+    // In the Python grammar, the `body` field refers to a hidden `suite` node,
+    // so the cursor moves to its first visible child.
+    parser.set_language(&get_language("python")).unwrap();
+    let tree = parser.parse("while a:\n  pass", None).unwrap();
+    let while_node = tree.root_node().child(0).unwrap();
+    let mut cursor = while_node.walk();
+    assert!(cursor.goto_child_by_field_name("body"));
+    assert_eq!(cursor.node(), while_node.child(3).unwrap());
+    cursor.reset(while_node);
+    assert!(!cursor.goto_child_by_field_name("alternative"));
+    assert_eq!(cursor.node(), while_node);
+}
+
 #[test]
 fn test_tree_cursor_child_for_point() {
     let mut parser = Parser::new();
@@ -571,6 +828,310 @@ fn test_tree_node_equality() {
     assert_ne!(node1.child(0).unwrap(), node2);
 }
 
+#[test]
+fn test_tree_reclaimer() {
+    let reclaimer = TreeReclaimer::new();
+    let mut parser = Parser::new();
+    parser.set_language(&get_language("javascript")).unwrap();
+    unsafe { parser.set_tree_reclaimer(Some(&reclaimer)) };
+
+    let mut source_code = b"let a = [".to_vec();
+    for i in 0..500 {
+        source_code.extend_from_slice(format!("{i}, ").as_bytes());
+    }
+    source_code.extend_from_slice(b"];");
+    let mut tree = parser.parse(&source_code, None).unwrap();
+
+    thread::scope(|s| {
+        let worker = s.spawn(|| {
+            let mut steps = 0;
+            while reclaimer.step(10) || steps < 100 {
+                steps += 1;
+                thread::yield_now();
+            }
+        });
+
+        for i in 0..20 {
+            let edit = Edit {
+                position: index_of(&source_code, &format!(" {}, ", i * 20 + 1)) + 1,
+                deleted_length: 0,
+                inserted_text: b"1".to_vec(),
+            };
+            perform_edit(&mut tree, &mut source_code, &edit).unwrap();
+            let new_tree = parser.parse(&source_code, Some(&tree)).unwrap();
+            reclaimer.add(std::mem::replace(&mut tree, new_tree));
+        }
+
+        worker.join().unwrap();
+    });
+
+    let expected_tree = parser.parse(&source_code, None).unwrap();
+    assert_eq!(
+        tree.root_node().to_sexp(),
+        expected_tree.root_node().to_sexp()
+    );
+
+    unsafe { parser.set_tree_reclaimer(None) };
+    reclaimer.add(tree);
+    while reclaimer.step(1) {}
+}
+
+#[test]
+fn test_tree_memory_usage() {
+    let mut parser = Parser::new();
+    parser.set_language(&get_language("javascript")).unwrap();
+
+    let mut source_code = b"let a = [".to_vec();
+    for i in 0..100 {
+        source_code.extend_from_slice(format!("{i}, ").as_bytes());
+    }
+    source_code.extend_from_slice(b"];");
+    let tree = parser.parse(&source_code, None).unwrap();
+    let total_bytes = tree.memory_usage();
+    assert!(total_bytes > 0);
+
+    // A copy of a tree shares all of its nodes.
+    let copy = tree.clone();
+    let (shared_bytes, unique_bytes) = Tree::shared_memory_usage(&[&tree, &copy]);
+    assert_eq!(copy.memory_usage(), total_bytes);
+    assert_eq!(shared_bytes + unique_bytes[0], total_bytes);
+    assert_eq!(unique_bytes[0], unique_bytes[1]);
+    assert!(unique_bytes[0] < 200);
+
+    // A reparsed tree shares the nodes that were reused.
+    let mut new_tree = tree.clone();
+    let edit = Edit {
+        position: index_of(&source_code, " 50, ") + 1,
+        deleted_length: 0,
+        inserted_text: b"1".to_vec(),
+    };
+    perform_edit(&mut new_tree, &mut source_code, &edit).unwrap();
+    let new_tree = parser.parse(&source_code, Some(&new_tree)).unwrap();
+    let (shared_bytes, unique_bytes) = Tree::shared_memory_usage(&[&tree, &new_tree]);
+    assert_eq!(shared_bytes + unique_bytes[0], total_bytes);
+    assert_eq!(shared_bytes + unique_bytes[1], new_tree.memory_usage());
+    assert!(shared_bytes > unique_bytes[1]);
+
+    // Trees that were parsed separately share nothing.
+    let other_tree = parser.parse(&source_code, None).unwrap();
+    let (shared_bytes, unique_bytes) = Tree::shared_memory_usage(&[&new_tree, &other_tree]);
+    assert_eq!(shared_bytes, 0);
+    assert_eq!(unique_bytes[1], other_tree.memory_usage());
+}
+
+#[test]
+fn test_line_index() {
+    let mut parser = Parser::new();
+    parser.set_language(&get_language("javascript")).unwrap();
+
+    let mut source_code = b"function a() {\n  return b;\n}\n\nc(\n  1,\n  2\n);\n".to_vec();
+    let mut tree = parser.parse(&source_code, None).unwrap();
+    let mut line_index = LineIndex::new(&source_code);
+    assert_eq!(line_index.line_count(), 9);
+    assert_eq!(line_index.line_range(1), Some(15..26));
+    assert_eq!(
+        line_index.line_range(8),
+        Some(source_code.len()..source_code.len())
+    );
+    assert_eq!(line_index.line_range(9), None);
+    assert_eq!(line_index.byte_for_point(Point::new(1, 100)), 26);
+    assert_eq!(
+        line_index.byte_for_point(Point::new(100, 0)),
+        source_code.len()
+    );
+    assert_line_index_matches_tree(&line_index, &tree);
+
+    let edits = [
+        Edit {
+            position: index_of(&source_code, "b;"),
+            deleted_length: 1,
+            inserted_text: b"x +\n    y".to_vec(),
+        },
+        Edit {
+            position: 0,
+            deleted_length: 0,
+            inserted_text: b"d();\n".to_vec(),
+        },
+        Edit {
+            position: index_of(&source_code, "1,"),
+            deleted_length: 6,
+            inserted_text: b"3".to_vec(),
+        },
+    ];
+    for edit in &edits {
+        let input_edit = perform_edit(&mut tree, &mut source_code, edit).unwrap();
+        line_index.edit(&input_edit, &source_code);
+        tree = parser.parse(&source_code, Some(&tree)).unwrap();
+        assert_line_index_matches_tree(&line_index, &tree);
+    }
+    assert_eq!(
+        str::from_utf8(&source_code).unwrap(),
+        "d();\nfunction a() {\n  return x +\n    y;\n}\n\nc(\n  3\n);\n"
+    );
+    assert_eq!(line_index.line_count(), 10);
+}
+
+fn assert_line_index_matches_tree(line_index: &LineIndex, tree: &Tree) {
+    let mut cursor = tree.walk();
+    loop {
+        let node = cursor.node();
+        assert_eq!(
+            line_index.point_for_byte(node.start_byte()),
+            node.start_position()
+        );
+        assert_eq!(
+            line_index.point_for_byte(node.end_byte()),
+            node.end_position()
+        );
+        assert_eq!(
+            line_index.byte_for_point(node.start_position()),
+            node.start_byte()
+        );
+        if !cursor.goto_first_child() {
+            while !cursor.goto_next_sibling() {
+                if !cursor.goto_parent() {
+                    return;
+                }
+            }
+        }
+    }
+}
+
+#[test]
+fn test_tree_edit_batch() {
+    let mut parser = Parser::new();
+    parser.set_language(&get_language("javascript")).unwrap();
+
+    let mut source_code = b"a(b, c);\nd(e, [f, g]);\nh(i);\n".to_vec();
+    let mut tree = parser.parse(&source_code, None).unwrap();
+    let mut batch_tree = tree.clone();
+    assert_eq!(batch_tree.edit_batch(&[]), None);
+
+    // Edit the tree one edit at a time, recording the edits.
+    let edits = [
+        Edit {
+            position: index_of(&source_code, "i"),
+            deleted_length: 1,
+            inserted_text: b"i, j".to_vec(),
+        },
+        Edit {
+            position: index_of(&source_code, "c"),
+            deleted_length: 0,
+            inserted_text: b"x, ".to_vec(),
+        },
+        Edit {
+            position: index_of(&source_code, "[f"),
+            deleted_length: 6,
+            inserted_text: b"k\n".to_vec(),
+        },
+    ];
+    let input_edits = edits
+        .iter()
+        .map(|edit| perform_edit(&mut tree, &mut source_code, edit).unwrap())
+        .collect::<Vec<_>>();
+    assert_eq!(
+        str::from_utf8(&source_code).unwrap(),
+        "a(b, x, c);\nd(e, k\n);\nh(i, j);\n"
+    );
+
+    // Applying the same edits in one batch produces the same tree.
+    let changed_range = batch_tree.edit_batch(&input_edits).unwrap();
+    assert_eq!(changed_range.start_byte, index_of(&source_code, "x"));
+    assert_eq!(changed_range.end_byte, index_of(&source_code, "j") + 1);
+    assert_eq!(changed_range.start_point, Point::new(0, 5));
+    assert_eq!(changed_range.end_point, Point::new(3, 6));
+
+    let mut cursor = tree.walk();
+    let mut batch_cursor = batch_tree.walk();
+    loop {
+        let (node, batch_node) = (cursor.node(), batch_cursor.node());
+        assert_eq!(node.kind(), batch_node.kind());
+        assert_eq!(node.byte_range(), batch_node.byte_range());
+        assert_eq!(node.start_position(), batch_node.start_position());
+        assert_eq!(node.end_position(), batch_node.end_position());
+        assert_eq!(node.has_changes(), batch_node.has_changes());
+        if cursor.goto_first_child() {
+            assert!(batch_cursor.goto_first_child());
+            continue;
+        }
+        assert!(!batch_cursor.goto_first_child());
+        let mut done = false;
+        while !cursor.goto_next_sibling() {
+            assert!(!batch_cursor.goto_next_sibling());
+            if !cursor.goto_parent() {
+                done = true;
+                break;
+            }
+            assert!(batch_cursor.goto_parent());
+        }
+        if done {
+            break;
+        }
+        assert!(batch_cursor.goto_next_sibling());
+    }
+
+    let tree = parser.parse(&source_code, Some(&tree)).unwrap();
+    let batch_tree = parser.parse(&source_code, Some(&batch_tree)).unwrap();
+    assert_eq!(tree.root_node().to_sexp(), batch_tree.root_node().to_sexp());
+    assert!(!batch_tree.root_node().has_error());
+}
+
+#[test]
+fn test_tree_diff() {
+    let mut parser = Parser::new();
+    parser.set_language(&get_language("json")).unwrap();
+
+    let old_source = r#"{"a": [1, 2], "b": {"c": true, "d": null}, "e": "x"}"#;
+    let new_source =
+        "{\n  \"b\": {\"d\": null, \"c\": true},\n  \"a\": [1, 2, 3],\n  \"e\":   \"x\"\n}";
+    let old_tree = parser.parse(old_source, None).unwrap();
+    let new_tree = parser.parse(new_source, None).unwrap();
+
+    // Reordered nodes are moved, and differences in whitespace are ignored.
+    let changes = old_tree
+        .diff(old_source.as_bytes(), &new_tree, new_source.as_bytes())
+        .into_iter()
+        .map(|change| match change {
+            DiffChange::Insert(node) => format!("insert {}", &new_source[node.byte_range()]),
+            DiffChange::Delete(node) => format!("delete {}", &old_source[node.byte_range()]),
+            DiffChange::Move { old, new } => {
+                assert_eq!(old.kind(), new.kind());
+                format!(
+                    "move {} from {} to {}",
+                    &new_source[new.byte_range()],
+                    old.start_byte(),
+                    new.start_byte()
+                )
+            }
+        })
+        .collect::<Vec<_>>();
+    assert_eq!(
+        changes,
+        [
+            "move \"b\": {\"d\": null, \"c\": true} from 14 to 4",
+            "move \"d\": null from 31 to 10",
+            "insert ,",
+            "insert 3",
+        ]
+    );
+
+    // Deleted nodes are reported in the old tree.
+    let changes = new_tree.diff(new_source.as_bytes(), &old_tree, old_source.as_bytes());
+    assert!(changes.iter().any(|change| matches!(
+        change,
+        DiffChange::Delete(node) if &new_source[node.byte_range()] == "3"
+    )));
+
+    // Identical trees have no changes.
+    let copy = parser.parse(new_source, Some(&new_tree)).unwrap();
+    assert!(new_tree
+        .diff(new_source.as_bytes(), &copy, new_source.as_bytes())
+        .is_empty());
+    assert!(new_tree
+        .diff(new_source.as_bytes(), &new_tree, new_source.as_bytes())
+        .is_empty());
+}
+
 #[test]
 fn test_get_changed_ranges() {
     let source_code = b"{a: null};\n".to_vec();
@@ -701,7 +1262,10 @@ fn get_changed_ranges(
 ) -> Vec<Range> {
     perform_edit(tree, source_code, edit).unwrap();
     let new_tree = parser.parse(&source_code, Some(tree)).unwrap();
-    let result = tree.changed_ranges(&new_tree).collect();
+    let result = tree.changed_ranges(&new_tree).collect::<Vec<_>>();
+    let mut buffered = Vec::new();
+    tree.changed_ranges_into(&new_tree, &mut buffered);
+    assert_eq!(buffered, result);
     *tree = new_tree;
     result
 }
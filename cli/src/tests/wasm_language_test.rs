@@ -1,8 +1,9 @@
 use crate::tests::helpers::{allocations, fixtures::WASM_DIR};
 use lazy_static::lazy_static;
-use std::fs;
+use std::{fs, thread};
 use tree_sitter::{
     wasmtime::Engine, Parser, Query, QueryCursor, WasmError, WasmErrorKind, WasmStore,
+    WasmStorePool,
 };
 
 lazy_static! {
@@ -194,6 +195,71 @@ fn test_load_and_reload_wasm_language() {
     });
 }
 
+#[test]
+fn test_wasm_store_pool_reuses_stores() {
+    allocations::record(|| {
+        let pool = WasmStorePool::new(ENGINE.clone(), 1).unwrap();
+        let wasm = fs::read(WASM_DIR.join("tree-sitter-rust.wasm")).unwrap();
+        let mut store = pool.acquire().unwrap();
+        let language = store.load_language("rust", &wasm).unwrap();
+        pool.release(store);
+
+        let mut parser = Parser::new();
+        for _ in 0..2 {
+            // The idle store still has the language instantiated.
+            let store = pool.acquire().unwrap();
+            assert_eq!(store.language_count(), 1);
+            parser.set_wasm_store(store).unwrap();
+            parser.set_language(&language).unwrap();
+            let tree = parser.parse("fn main() {}", None).unwrap();
+            assert_eq!(tree.root_node().to_sexp(), "(source_file (function_item name: (identifier) parameters: (parameters) body: (block)))");
+            pool.release(parser.take_wasm_store().unwrap());
+        }
+
+        // When the pool is full, released stores are deleted.
+        let store1 = pool.acquire().unwrap();
+        let store2 = pool.acquire().unwrap();
+        assert_eq!(store2.language_count(), 0);
+        pool.release(store1);
+        pool.release(store2);
+
+        // Stores that are still in use can outlive the pool.
+        let store = pool.acquire().unwrap();
+        drop(pool);
+        parser.set_wasm_store(store).unwrap();
+        parser.set_language(&language).unwrap();
+        let tree = parser.parse("fn main() {}", None).unwrap();
+        assert_eq!(tree.root_node().kind(), "source_file");
+    });
+}
+
+#[test]
+fn test_wasm_store_pool_on_multiple_threads() {
+    let pool = WasmStorePool::new(ENGINE.clone(), 4).unwrap();
+    let wasm = fs::read(WASM_DIR.join("tree-sitter-rust.wasm")).unwrap();
+    let mut store = pool.acquire().unwrap();
+    let language = store.load_language("rust", &wasm).unwrap();
+    pool.release(store);
+
+    thread::scope(|scope| {
+        for i in 0..8 {
+            let pool = &pool;
+            let language = &language;
+            scope.spawn(move || {
+                let mut parser = Parser::new();
+                for j in 0..4 {
+                    parser.set_wasm_store(pool.acquire().unwrap()).unwrap();
+                    parser.set_language(language).unwrap();
+                    let source = format!("fn f{i}_{j}() {{}}");
+                    let tree = parser.parse(&source, None).unwrap();
+                    assert_eq!(tree.root_node().to_sexp(), "(source_file (function_item name: (identifier) parameters: (parameters) body: (block)))");
+                    pool.release(parser.take_wasm_store().unwrap());
+                }
+            });
+        }
+    });
+}
+
 #[test]
 fn test_load_wasm_errors() {
     allocations::record(|| {
@@ -1,10 +1,13 @@
 use std::{
+    collections::BTreeMap,
+    io::Write,
     path::{Path, PathBuf},
     process::{Child, ChildStdin, Command, Stdio},
     sync::{
-        atomic::{AtomicUsize, Ordering},
-        Arc,
+        atomic::{AtomicBool, AtomicUsize, Ordering},
+        mpsc, Arc,
     },
+    thread,
 };
 
 use anyhow::{anyhow, Context, Result};
@@ -63,6 +66,95 @@ pub fn cancel_on_signal() -> Arc<AtomicUsize> {
     result
 }
 
+/// Process each of the given items on a pool of `jobs` threads, each of which has
+/// its own state, created by `init`. `f` writes the output for an item to a buffer,
+/// which is written to `output` as soon as the item is done or, if `ordered` is set,
+/// once the output for all of the previous items has been written.
+///
+/// If processing an item fails, no more items are started, and the first error is
+/// returned after the output that was written for that item.
+pub fn process_in_parallel<T, S>(
+    items: &[T],
+    jobs: usize,
+    ordered: bool,
+    output: &mut impl Write,
+    init: impl Fn() -> Result<S> + Sync,
+    f: impl Fn(&mut S, &T, &mut Vec<u8>) -> Result<()> + Sync,
+) -> Result<()>
+where
+    T: Sync,
+{
+    if jobs <= 1 {
+        let mut state = init()?;
+        let mut buffer = Vec::new();
+        for item in items {
+            let result = f(&mut state, item, &mut buffer);
+            output.write_all(&buffer)?;
+            buffer.clear();
+            result?;
+        }
+        return Ok(());
+    }
+
+    let next_index = AtomicUsize::new(0);
+    let failed = AtomicBool::new(false);
+    let (sender, receiver) = mpsc::channel::<(usize, Vec<u8>, Result<()>)>();
+    thread::scope(|scope| {
+        let (init, f, next_index, failed) = (&init, &f, &next_index, &failed);
+        for _ in 0..jobs.min(items.len()) {
+            let sender = sender.clone();
+            scope.spawn(move || {
+                let mut state = match init() {
+                    Ok(state) => state,
+                    Err(error) => {
+                        failed.store(true, Ordering::Relaxed);
+                        sender.send((usize::MAX, Vec::new(), Err(error))).ok();
+                        return;
+                    }
+                };
+                while !failed.load(Ordering::Relaxed) {
+                    let index = next_index.fetch_add(1, Ordering::Relaxed);
+                    let Some(item) = items.get(index) else { break };
+                    let mut buffer = Vec::new();
+                    let result = f(&mut state, item, &mut buffer);
+                    if result.is_err() {
+                        failed.store(true, Ordering::Relaxed);
+                    }
+                    if sender.send((index, buffer, result)).is_err() {
+                        break;
+                    }
+                }
+            });
+        }
+        drop(sender);
+
+        // In ordered mode, the results that arrive early are held back until
+        // all of the results before them have been written.
+        let mut first_error = None;
+        let mut pending = BTreeMap::new();
+        let mut next_output_index = 0;
+        for (index, buffer, result) in receiver {
+            if !ordered || index == usize::MAX {
+                output.write_all(&buffer)?;
+                if let Err(error) = result {
+                    first_error.get_or_insert(error);
+                }
+                continue;
+            }
+            pending.insert(index, (buffer, result));
+            while first_error.is_none() {
+                let Some((buffer, result)) = pending.remove(&next_output_index) else {
+                    break;
+                };
+                output.write_all(&buffer)?;
+                first_error = result.err();
+                next_output_index += 1;
+            }
+        }
+        first_error.map_or(Ok(()), Err)
+    })
+}
+
 pub struct LogSession {
     path: PathBuf,
     dot_process: Option<Child>,
@@ -5,6 +5,7 @@
 extern "C" {
 #endif
 
+#include <stdbool.h>
 #include <stdint.h>
 
 typedef enum {
@@ -20,6 +21,14 @@ typedef enum {
 typedef struct TSHighlighter TSHighlighter;
 typedef struct TSHighlightBuffer TSHighlightBuffer;
 
+// A callback that receives chunks of rendered HTML. Returning `false`
+// stops highlighting.
+typedef bool (*TSHighlightSink)(
+  void *payload,
+  const uint8_t *chunk,
+  uint32_t length
+);
+
 // Construct a `TSHighlighter` by providing a list of strings containing
 // the HTML attributes that should be applied for each highlight value.
 TSHighlighter *ts_highlighter_new(
@@ -62,6 +71,23 @@ TSHighlightError ts_highlighter_highlight(
   const size_t *cancellation_flag
 );
 
+// Compute syntax highlighting for a given document, passing the HTML to
+// `sink` in chunks of roughly `chunk_size` bytes as it is rendered instead
+// of storing the whole document. The `TSHighlightBuffer` is only used as
+// scratch space, so its content is empty afterwards. If the sink returns
+// `false`, highlighting stops and `TSHighlightTimeout` is returned.
+TSHighlightError ts_highlighter_highlight_streaming(
+  const TSHighlighter *self,
+  const char *scope_name,
+  const char *source_code,
+  uint32_t source_code_len,
+  TSHighlightBuffer *output,
+  uint32_t chunk_size,
+  TSHighlightSink sink,
+  void *payload,
+  const size_t *cancellation_flag
+);
+
 // TSHighlightBuffer: This struct stores the HTML output of syntax
 // highlighting. It can be reused for multiple highlighting calls.
 TSHighlightBuffer *ts_highlight_buffer_new();
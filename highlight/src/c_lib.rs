@@ -2,7 +2,7 @@ use super::{Error, Highlight, HighlightConfiguration, Highlighter, HtmlRenderer}
 use regex::Regex;
 use std::collections::HashMap;
 use std::ffi::CStr;
-use std::os::raw::c_char;
+use std::os::raw::{c_char, c_void};
 use std::process::abort;
 use std::sync::atomic::AtomicUsize;
 use std::{fmt, slice, str};
@@ -20,6 +20,11 @@ pub struct TSHighlightBuffer {
     renderer: HtmlRenderer,
 }
 
+/// A callback that receives chunks of rendered HTML from
+/// [`ts_highlighter_highlight_streaming`]. Returning `false` stops highlighting.
+pub type TSHighlightSink =
+    unsafe extern "C" fn(payload: *mut c_void, chunk: *const u8, length: u32) -> bool;
+
 #[repr(C)]
 pub enum ErrorCode {
     Ok,
@@ -263,7 +268,50 @@ pub unsafe extern "C" fn ts_highlighter_highlight(
     let scope_name = unwrap(CStr::from_ptr(scope_name).to_str());
     let source_code = slice::from_raw_parts(source_code.cast::<u8>(), source_code_len as usize);
     let cancellation_flag = cancellation_flag.as_ref();
-    this.highlight(source_code, scope_name, output, cancellation_flag)
+    this.highlight(source_code, scope_name, output, cancellation_flag, None)
+}
+
+/// Highlight a string of source code, passing the HTML to `sink` in chunks of roughly
+/// `chunk_size` bytes as it is rendered, instead of storing the whole document in `output`.
+///
+/// The `output` buffer is only used for its highlighter state and as scratch space; its
+/// content is empty when this function returns. Chunks always end on a tag or character
+/// boundary. If `sink` returns `false`, highlighting stops and [`ErrorCode::Timeout`] is
+/// returned.
+///
+/// # Safety
+///
+/// The caller must ensure that `scope_name`, `source_code`, `output`, and `cancellation_flag` are valid for
+/// the lifetime of the [`TSHighlighter`] instance, and are non-null.
+///
+/// `this` must be a non-null pointer to a [`TSHighlighter`] instance created by [`ts_highlighter_new`]
+///
+/// The chunk pointer passed to `sink` is only valid for the duration of that call.
+#[no_mangle]
+pub unsafe extern "C" fn ts_highlighter_highlight_streaming(
+    this: *const TSHighlighter,
+    scope_name: *const c_char,
+    source_code: *const c_char,
+    source_code_len: u32,
+    output: *mut TSHighlightBuffer,
+    chunk_size: u32,
+    sink: TSHighlightSink,
+    payload: *mut c_void,
+    cancellation_flag: *const AtomicUsize,
+) -> ErrorCode {
+    let this = unwrap_ptr(this);
+    let output = unwrap_mut_ptr(output);
+    let scope_name = unwrap(CStr::from_ptr(scope_name).to_str());
+    let source_code = slice::from_raw_parts(source_code.cast::<u8>(), source_code_len as usize);
+    let cancellation_flag = cancellation_flag.as_ref();
+    let mut sink = |chunk: &[u8]| sink(payload, chunk.as_ptr(), chunk.len() as u32);
+    this.highlight(
+        source_code,
+        scope_name,
+        output,
+        cancellation_flag,
+        Some((chunk_size as usize, &mut sink)),
+    )
 }
 
 impl TSHighlighter {
@@ -273,6 +321,7 @@ impl TSHighlighter {
         scope_name: &str,
         output: &mut TSHighlightBuffer,
         cancellation_flag: Option<&AtomicUsize>,
+        sink: Option<(usize, &mut dyn FnMut(&[u8]) -> bool)>,
     ) -> ErrorCode {
         let entry = self.languages.get(scope_name);
         if entry.is_none() {
@@ -303,9 +352,20 @@ impl TSHighlighter {
             output
                 .renderer
                 .set_carriage_return_highlight(self.carriage_return_index.map(Highlight));
-            let result = output
-                .renderer
-                .render(highlights, source_code, &|s| self.attribute_strings[s.0]);
+            let attribute_callback = |s: Highlight| self.attribute_strings[s.0];
+            let result = if let Some((chunk_size, sink)) = sink {
+                output.renderer.render_streaming(
+                    highlights,
+                    source_code,
+                    &attribute_callback,
+                    chunk_size,
+                    sink,
+                )
+            } else {
+                output
+                    .renderer
+                    .render(highlights, source_code, &attribute_callback)
+            };
             match result {
                 Err(Error::Cancelled | Error::Unknown) => ErrorCode::Timeout,
                 Err(Error::InvalidLanguage) => ErrorCode::InvalidLanguage,
@@ -4,18 +4,21 @@ pub mod c_lib;
 pub use c_lib as c;
 
 use lazy_static::lazy_static;
+use std::collections::hash_map::DefaultHasher;
 use std::collections::HashSet;
+use std::hash::{Hash, Hasher};
 use std::sync::atomic::{AtomicUsize, Ordering};
 use std::{iter, mem, ops, str, usize};
 use thiserror::Error;
 use tree_sitter::{
-    Language, LossyUtf8, Node, Parser, Point, Query, QueryCaptures, QueryCursor, QueryError,
-    QueryMatch, Range, Tree,
+    InputEdit, Language, LossyUtf8, Node, Parser, Point, Query, QueryCaptures, QueryCursor,
+    QueryError, QueryMatch, Range, Tree,
 };
 
 const CANCELLATION_CHECK_INTERVAL: usize = 100;
 const BUFFER_HTML_RESERVE_CAPACITY: usize = 10 * 1024;
 const BUFFER_LINES_RESERVE_CAPACITY: usize = 1000;
+const INJECTION_PARSER_CACHE_SIZE: usize = 8;
 
 lazy_static! {
     static ref STANDARD_CAPTURE_NAMES: HashSet<&'static str> = vec![
@@ -124,9 +127,51 @@ pub struct HighlightConfiguration {
 /// For the best performance `Highlighter` values should be reused between
 /// syntax highlighting calls. A separate highlighter is needed for each thread that
 /// is performing highlighting.
+///
+/// The outermost document is parsed with [`parser`](Highlighter::parser). Injected
+/// documents are parsed with a separate parser for each of the most recently used
+/// injection languages, so that documents which alternate between languages don't
+/// need to reconfigure a parser for every injection.
 pub struct Highlighter {
     pub parser: Parser,
+    injection_parsers: Vec<(Language, Parser)>,
     cursors: Vec<QueryCursor>,
+    layer_buffers: Vec<LayerBuffers>,
+    range_buffers: Vec<Vec<Range>>,
+    injection_cache: InjectionTreeCache,
+}
+
+/// The stacks of a highlighting layer that has finished, kept so that their
+/// allocations can be reused by later layers.
+#[derive(Default)]
+struct LayerBuffers {
+    highlight_end_stack: Vec<usize>,
+    scope_stack: Vec<LocalScope<'static>>,
+}
+
+impl LayerBuffers {
+    // The local scopes borrow the source code that was highlighted, so the scope stack
+    // is only kept while it's empty, which is when its lifetime doesn't matter.
+    fn clear_scope_stack(mut scope_stack: Vec<LocalScope>) -> Vec<LocalScope<'static>> {
+        scope_stack.clear();
+        unsafe { mem::transmute(scope_stack) }
+    }
+}
+
+/// A least-recently-used cache of the syntax trees of injected documents, keyed by
+/// their language and the text spanned by their included ranges.
+#[derive(Default)]
+struct InjectionTreeCache {
+    capacity: usize,
+    entries: Vec<CachedInjectionTree>,
+}
+
+struct CachedInjectionTree {
+    language: Language,
+    hash: u64,
+    text: Vec<u8>,
+    ranges: Vec<Range>,
+    tree: Tree,
 }
 
 /// Converts a general-purpose syntax highlighting iterator into a sequence of lines of HTML.
@@ -134,6 +179,13 @@ pub struct HtmlRenderer {
     pub html: Vec<u8>,
     pub line_offsets: Vec<u32>,
     carriage_return_highlight: Option<Highlight>,
+    // The opening tag of each highlight, and the span for a carriage return,
+    // as ranges of `tag_bytes`. Each one is built the first time it's needed
+    // during a render, so that the attribute callback is only called once per
+    // highlight.
+    tag_bytes: Vec<u8>,
+    tag_ranges: Vec<Option<ops::Range<usize>>>,
+    carriage_return_tag: Option<ops::Range<usize>>,
 }
 
 #[derive(Debug)]
@@ -188,7 +240,11 @@ impl Highlighter {
     pub fn new() -> Self {
         Self {
             parser: Parser::new(),
+            injection_parsers: Vec::new(),
             cursors: Vec::new(),
+            layer_buffers: Vec::new(),
+            range_buffers: Vec::new(),
+            injection_cache: InjectionTreeCache::default(),
         }
     }
 
@@ -196,6 +252,174 @@ impl Highlighter {
         &mut self.parser
     }
 
+    /// Keep the syntax trees of up to `capacity` injected documents between highlighting
+    /// calls.
+    ///
+    /// When an injection has the same language and text as a cached one, its tree is reused
+    /// instead of being parsed again. If the text has only moved within the document, the
+    /// cached tree is shifted and used as the old tree for an incremental parse. A capacity
+    /// of zero, the default, disables the cache.
+    pub fn set_injection_cache_capacity(&mut self, capacity: usize) {
+        let cache = &mut self.injection_cache;
+        cache.capacity = capacity;
+        let excess = cache.entries.len().saturating_sub(capacity);
+        cache.entries.drain(..excess);
+    }
+
+    /// Parse one layer of a document, returning `Ok(None)` if its ranges are invalid.
+    fn parse_layer(
+        &mut self,
+        language: &Language,
+        source: &[u8],
+        ranges: &[Range],
+        depth: usize,
+        cancellation_flag: Option<&AtomicUsize>,
+    ) -> Result<Option<Tree>, Error> {
+        let parser = if depth == 0 {
+            self.parser
+                .set_language(language)
+                .map_err(|_| Error::InvalidLanguage)?;
+            &mut self.parser
+        } else {
+            Self::injection_parser(&mut self.injection_parsers, language)?
+        };
+        if parser.set_included_ranges(ranges).is_err() {
+            return Ok(None);
+        }
+
+        unsafe { parser.set_cancellation_flag(cancellation_flag) };
+        let tree = Self::parse_layer_with_parser(
+            parser,
+            &mut self.injection_cache,
+            language,
+            source,
+            ranges,
+            depth > 0,
+        );
+        unsafe { parser.set_cancellation_flag(None) };
+
+        // Don't let a cached parser resume a cancelled parse the next time it's used.
+        if tree.is_none() {
+            parser.reset();
+            return Err(Error::Cancelled);
+        }
+        Ok(tree)
+    }
+
+    /// Get the parser for an injection language, creating one if none of the cached
+    /// parsers uses that language.
+    fn injection_parser<'p>(
+        parsers: &'p mut Vec<(Language, Parser)>,
+        language: &Language,
+    ) -> Result<&'p mut Parser, Error> {
+        if let Some(index) = parsers.iter().position(|(l, _)| l == language) {
+            let entry = parsers.remove(index);
+            parsers.push(entry);
+        } else {
+            let mut parser = Parser::new();
+            parser
+                .set_language(language)
+                .map_err(|_| Error::InvalidLanguage)?;
+            if parsers.len() >= INJECTION_PARSER_CACHE_SIZE {
+                parsers.remove(0);
+            }
+            parsers.push((language.clone(), parser));
+        }
+        Ok(&mut parsers.last_mut().unwrap().1)
+    }
+
+    fn parse_layer_with_parser(
+        parser: &mut Parser,
+        cache: &mut InjectionTreeCache,
+        language: &Language,
+        source: &[u8],
+        ranges: &[Range],
+        use_cache: bool,
+    ) -> Option<Tree> {
+        if !use_cache || cache.capacity == 0 || ranges.is_empty() {
+            return parser.parse(source, None);
+        }
+
+        let first_range = &ranges[0];
+        let span_end = ranges[ranges.len() - 1].end_byte.min(source.len());
+        let text = &source[first_range.start_byte.min(span_end)..span_end];
+        let mut hasher = DefaultHasher::new();
+        text.hash(&mut hasher);
+        for range in ranges {
+            (range.start_byte - first_range.start_byte).hash(&mut hasher);
+            (range.end_byte - first_range.start_byte).hash(&mut hasher);
+        }
+        let hash = hasher.finish();
+
+        let index = cache.entries.iter().rposition(|entry| {
+            entry.hash == hash
+                && entry.language == *language
+                && entry.text == text
+                && entry.ranges.len() == ranges.len()
+                && entry.ranges.iter().zip(ranges).all(|(old, new)| {
+                    old.start_byte - entry.ranges[0].start_byte
+                        == new.start_byte - first_range.start_byte
+                        && old.end_byte - entry.ranges[0].start_byte
+                            == new.end_byte - first_range.start_byte
+                })
+        });
+
+        if let Some(index) = index {
+            let mut entry = cache.entries.remove(index);
+            let old_range = &entry.ranges[0];
+            if old_range.start_byte != first_range.start_byte
+                || old_range.start_point != first_range.start_point
+            {
+                let mut old_tree = entry.tree.clone();
+                old_tree.edit(&InputEdit {
+                    start_byte: 0,
+                    old_end_byte: old_range.start_byte,
+                    new_end_byte: first_range.start_byte,
+                    start_position: Point::new(0, 0),
+                    old_end_position: old_range.start_point,
+                    new_end_position: first_range.start_point,
+                });
+                entry.tree = parser.parse(source, Some(&old_tree))?;
+                entry.ranges = ranges.to_vec();
+            }
+            let tree = entry.tree.clone();
+            cache.entries.push(entry);
+            return Some(tree);
+        }
+
+        let tree = parser.parse(source, None)?;
+        if cache.entries.len() >= cache.capacity {
+            cache.entries.remove(0);
+        }
+        cache.entries.push(CachedInjectionTree {
+            language: language.clone(),
+            hash,
+            text: text.to_vec(),
+            ranges: ranges.to_vec(),
+            tree: tree.clone(),
+        });
+        Some(tree)
+    }
+
+    /// Keep the cursor and buffers of a layer that has finished, for use by later layers.
+    fn recycle_layer(&mut self, layer: HighlightIterLayer) {
+        let HighlightIterLayer {
+            cursor,
+            mut highlight_end_stack,
+            scope_stack,
+            mut ranges,
+            ..
+        } = layer;
+        self.cursors.push(cursor);
+        highlight_end_stack.clear();
+        self.layer_buffers.push(LayerBuffers {
+            highlight_end_stack,
+            scope_stack: LayerBuffers::clear_scope_stack(scope_stack),
+        });
+        ranges.clear();
+        self.range_buffers.push(ranges);
+    }
+
     /// Iterate over the highlighted regions for a given slice of source code.
     pub fn highlight<'a>(
         &'a mut self,
@@ -204,6 +428,13 @@ impl Highlighter {
         cancellation_flag: Option<&'a AtomicUsize>,
         mut injection_callback: impl FnMut(&str) -> Option<&'a HighlightConfiguration> + 'a,
     ) -> Result<impl Iterator<Item = Result<HighlightEvent, Error>> + 'a, Error> {
+        let mut ranges = self.range_buffers.pop().unwrap_or_default();
+        ranges.push(Range {
+            start_byte: 0,
+            end_byte: usize::MAX,
+            start_point: Point::new(0, 0),
+            end_point: Point::new(usize::MAX, usize::MAX),
+        });
         let layers = HighlightIterLayer::new(
             source,
             None,
@@ -212,12 +443,7 @@ impl Highlighter {
             &mut injection_callback,
             config,
             0,
-            vec![Range {
-                start_byte: 0,
-                end_byte: usize::MAX,
-                start_point: Point::new(0, 0),
-                end_point: Point::new(usize::MAX, usize::MAX),
-            }],
+            ranges,
         )?;
         assert_ne!(layers.len(), 0);
         let mut result = HighlightIter {
@@ -436,18 +662,13 @@ impl<'a> HighlightIterLayer<'a> {
         let mut result = Vec::with_capacity(1);
         let mut queue = Vec::new();
         loop {
-            if highlighter.parser.set_included_ranges(&ranges).is_ok() {
-                highlighter
-                    .parser
-                    .set_language(&config.language)
-                    .map_err(|_| Error::InvalidLanguage)?;
-
-                unsafe { highlighter.parser.set_cancellation_flag(cancellation_flag) };
-                let tree = highlighter
-                    .parser
-                    .parse(source, None)
-                    .ok_or(Error::Cancelled)?;
-                unsafe { highlighter.parser.set_cancellation_flag(None) };
+            if let Some(tree) = highlighter.parse_layer(
+                &config.language,
+                source,
+                &ranges,
+                depth,
+                cancellation_flag,
+            )? {
                 let mut cursor = highlighter.cursors.pop().unwrap_or_default();
 
                 // Process combined injections.
@@ -481,8 +702,11 @@ impl<'a> HighlightIterLayer<'a> {
                                     &ranges,
                                     &content_nodes,
                                     includes_children,
+                                    highlighter.range_buffers.pop().unwrap_or_default(),
                                 );
-                                if !ranges.is_empty() {
+                                if ranges.is_empty() {
+                                    highlighter.range_buffers.push(ranges);
+                                } else {
                                     queue.push((next_config, depth + 1, ranges));
                                 }
                             }
@@ -500,13 +724,18 @@ impl<'a> HighlightIterLayer<'a> {
                     .captures(&config.query, tree_ref.root_node(), source)
                     .peekable();
 
+                let LayerBuffers {
+                    highlight_end_stack,
+                    mut scope_stack,
+                } = highlighter.layer_buffers.pop().unwrap_or_default();
+                scope_stack.push(LocalScope {
+                    inherits: false,
+                    range: 0..usize::MAX,
+                    local_defs: Vec::new(),
+                });
                 result.push(HighlightIterLayer {
-                    highlight_end_stack: Vec::new(),
-                    scope_stack: vec![LocalScope {
-                        inherits: false,
-                        range: 0..usize::MAX,
-                        local_defs: Vec::new(),
-                    }],
+                    highlight_end_stack,
+                    scope_stack,
                     cursor,
                     depth,
                     _tree: tree,
@@ -514,6 +743,8 @@ impl<'a> HighlightIterLayer<'a> {
                     config,
                     ranges,
                 });
+            } else {
+                highlighter.range_buffers.push(ranges);
             }
 
             if queue.is_empty() {
@@ -538,13 +769,15 @@ impl<'a> HighlightIterLayer<'a> {
     //   excluded from the nested document, so that only the content nodes' *own* content
     //   is reparsed. For other injections, the content nodes' entire ranges should be
     //   reparsed, including the ranges of their children.
+    // The ranges are written to `result`, which should be empty, so that its allocation
+    // can be reused.
     fn intersect_ranges(
         parent_ranges: &[Range],
         nodes: &[Node],
         includes_children: bool,
+        mut result: Vec<Range>,
     ) -> Vec<Range> {
         let mut cursor = nodes[0].walk();
-        let mut result = Vec::new();
         let mut parent_range_iter = parent_ranges.iter();
         let mut parent_range = parent_range_iter
             .next()
@@ -691,7 +924,7 @@ where
                 break;
             }
             let layer = self.layers.remove(0);
-            self.highlighter.cursors.push(layer.cursor);
+            self.highlighter.recycle_layer(layer);
         }
     }
 
@@ -706,10 +939,24 @@ where
                     }
                     i += 1;
                 } else {
-                    self.layers.remove(i);
+                    let layer = self.layers.remove(i);
+                    self.highlighter.recycle_layer(layer);
                 }
             }
             self.layers.push(layer);
+        } else {
+            self.highlighter.recycle_layer(layer);
+        }
+    }
+}
+
+impl<'a, F> Drop for HighlightIter<'a, F>
+where
+    F: FnMut(&str) -> Option<&'a HighlightConfiguration> + 'a,
+{
+    fn drop(&mut self) {
+        for layer in self.layers.drain(..) {
+            self.highlighter.recycle_layer(layer);
         }
     }
 }
@@ -805,8 +1052,11 @@ where
                             &self.layers[0].ranges,
                             &[content_node],
                             include_children,
+                            self.highlighter.range_buffers.pop().unwrap_or_default(),
                         );
-                        if !ranges.is_empty() {
+                        if ranges.is_empty() {
+                            self.highlighter.range_buffers.push(ranges);
+                        } else {
                             match HighlightIterLayer::new(
                                 self.source,
                                 Some(self.language_name),
@@ -991,6 +1241,9 @@ impl HtmlRenderer {
             html: Vec::with_capacity(BUFFER_HTML_RESERVE_CAPACITY),
             line_offsets: Vec::with_capacity(BUFFER_LINES_RESERVE_CAPACITY),
             carriage_return_highlight: None,
+            tag_bytes: Vec::new(),
+            tag_ranges: Vec::new(),
+            carriage_return_tag: None,
         };
         result.line_offsets.push(0);
         result
@@ -998,12 +1251,22 @@ impl HtmlRenderer {
 
     pub fn set_carriage_return_highlight(&mut self, highlight: Option<Highlight>) {
         self.carriage_return_highlight = highlight;
+        self.carriage_return_tag = None;
     }
 
     pub fn reset(&mut self) {
         shrink_and_clear(&mut self.html, BUFFER_HTML_RESERVE_CAPACITY);
         shrink_and_clear(&mut self.line_offsets, BUFFER_LINES_RESERVE_CAPACITY);
         self.line_offsets.push(0);
+        self.clear_tags();
+    }
+
+    // The attribute callback can change between renders, so the cached tags
+    // are discarded at the start of each one.
+    fn clear_tags(&mut self) {
+        self.tag_bytes.clear();
+        self.tag_ranges.clear();
+        self.carriage_return_tag = None;
     }
 
     pub fn render<'a, F>(
@@ -1015,6 +1278,84 @@ impl HtmlRenderer {
     where
         F: Fn(Highlight) -> &'a [u8],
     {
+        self.render_events(highlighter, source, attribute_callback, |_| Ok(()))?;
+        if self.html.last() != Some(&b'\n') {
+            self.html.push(b'\n');
+        }
+        if self.line_offsets.last() == Some(&(self.html.len() as u32)) {
+            self.line_offsets.pop();
+        }
+        Ok(())
+    }
+
+    /// Render HTML incrementally, passing it to `sink` in chunks instead of
+    /// accumulating the whole document.
+    ///
+    /// The rendered output is flushed to `sink` whenever roughly `chunk_size`
+    /// bytes have been buffered, and once more at the end. Chunks always end at
+    /// event boundaries, so they never split an escape sequence or a tag. If
+    /// `sink` returns `false`, rendering stops with [`Error::Cancelled`].
+    ///
+    /// The renderer's `html` and `line_offsets` are only used as a scratch
+    /// buffer, and are reset when this method returns.
+    pub fn render_streaming<'a, F, S>(
+        &mut self,
+        highlighter: impl Iterator<Item = Result<HighlightEvent, Error>>,
+        source: &'a [u8],
+        attribute_callback: &F,
+        chunk_size: usize,
+        mut sink: S,
+    ) -> Result<(), Error>
+    where
+        F: Fn(Highlight) -> &'a [u8],
+        S: FnMut(&[u8]) -> bool,
+    {
+        let mut last_byte = None;
+        let mut flush = |this: &mut Self, force: bool| {
+            if this.html.is_empty() || (!force && this.html.len() < chunk_size) {
+                return Ok(());
+            }
+            last_byte = this.html.last().copied();
+            let result = if sink(&this.html) {
+                Ok(())
+            } else {
+                Err(Error::Cancelled)
+            };
+            this.html.clear();
+            this.line_offsets.clear();
+            result
+        };
+
+        self.html.clear();
+        self.line_offsets.clear();
+        let result = self
+            .render_events(highlighter, source, attribute_callback, |this| {
+                flush(this, false)
+            })
+            .and_then(|()| flush(self, true));
+        drop(flush);
+        if result.is_ok() && last_byte != Some(b'\n') {
+            self.html.push(b'\n');
+            if !sink(&self.html) {
+                self.reset();
+                return Err(Error::Cancelled);
+            }
+        }
+        self.reset();
+        result
+    }
+
+    fn render_events<'a, F>(
+        &mut self,
+        highlighter: impl Iterator<Item = Result<HighlightEvent, Error>>,
+        source: &'a [u8],
+        attribute_callback: &F,
+        mut after_event: impl FnMut(&mut Self) -> Result<(), Error>,
+    ) -> Result<(), Error>
+    where
+        F: Fn(Highlight) -> &'a [u8],
+    {
+        self.clear_tags();
         let mut highlights = Vec::new();
         for event in highlighter {
             match event {
@@ -1031,12 +1372,7 @@ impl HtmlRenderer {
                 }
                 Err(a) => return Err(a),
             }
-        }
-        if self.html.last() != Some(&b'\n') {
-            self.html.push(b'\n');
-        }
-        if self.line_offsets.last() == Some(&(self.html.len() as u32)) {
-            self.line_offsets.pop();
+            after_event(self)?;
         }
         Ok(())
     }
@@ -1060,27 +1396,50 @@ impl HtmlRenderer {
     where
         F: Fn(Highlight) -> &'a [u8],
     {
-        if let Some(highlight) = self.carriage_return_highlight {
-            let attribute_string = (attribute_callback)(highlight);
-            if !attribute_string.is_empty() {
-                self.html.extend(b"<span ");
-                self.html.extend(attribute_string);
-                self.html.extend(b"></span>");
+        let range = match &self.carriage_return_tag {
+            Some(range) => range.clone(),
+            None => {
+                let start = self.tag_bytes.len();
+                if let Some(highlight) = self.carriage_return_highlight {
+                    let attribute_string = (attribute_callback)(highlight);
+                    if !attribute_string.is_empty() {
+                        self.tag_bytes.extend(b"<span ");
+                        self.tag_bytes.extend(attribute_string);
+                        self.tag_bytes.extend(b"></span>");
+                    }
+                }
+                let range = start..self.tag_bytes.len();
+                self.carriage_return_tag = Some(range.clone());
+                range
             }
-        }
+        };
+        self.html.extend_from_slice(&self.tag_bytes[range]);
     }
 
     fn start_highlight<'a, F>(&mut self, h: Highlight, attribute_callback: &F)
     where
         F: Fn(Highlight) -> &'a [u8],
     {
-        let attribute_string = (attribute_callback)(h);
-        self.html.extend(b"<span");
-        if !attribute_string.is_empty() {
-            self.html.extend(b" ");
-            self.html.extend(attribute_string);
-        }
-        self.html.extend(b">");
+        let range = match self.tag_ranges.get(h.0) {
+            Some(Some(range)) => range.clone(),
+            _ => {
+                let start = self.tag_bytes.len();
+                let attribute_string = (attribute_callback)(h);
+                self.tag_bytes.extend(b"<span");
+                if !attribute_string.is_empty() {
+                    self.tag_bytes.extend(b" ");
+                    self.tag_bytes.extend(attribute_string);
+                }
+                self.tag_bytes.extend(b">");
+                let range = start..self.tag_bytes.len();
+                if self.tag_ranges.len() <= h.0 {
+                    self.tag_ranges.resize(h.0 + 1, None);
+                }
+                self.tag_ranges[h.0] = Some(range.clone());
+                range
+            }
+        };
+        self.html.extend_from_slice(&self.tag_bytes[range]);
     }
 
     fn end_highlight(&mut self) {
@@ -1103,32 +1462,48 @@ impl HtmlRenderer {
         }
 
         let mut last_char_was_cr = false;
-        for c in LossyUtf8::new(src).flat_map(|p| p.bytes()) {
-            // Don't render carriage return characters, but allow lone carriage returns (not
-            // followed by line feeds) to be styled via the attribute callback.
-            if c == b'\r' {
-                last_char_was_cr = true;
-                continue;
-            }
-            if last_char_was_cr {
-                if c != b'\n' {
-                    self.add_carriage_return(attribute_callback);
+        for chunk in LossyUtf8::new(src) {
+            // Copy each run of bytes that don't need any special handling at once.
+            let mut bytes = chunk.as_bytes();
+            while !bytes.is_empty() {
+                let run_len = find_special_html_byte(bytes).unwrap_or(bytes.len());
+                if run_len > 0 {
+                    if last_char_was_cr {
+                        self.add_carriage_return(attribute_callback);
+                        last_char_was_cr = false;
+                    }
+                    self.html.extend_from_slice(&bytes[..run_len]);
+                    bytes = &bytes[run_len..];
+                    continue;
                 }
-                last_char_was_cr = false;
-            }
 
-            // At line boundaries, close and re-open all of the open tags.
-            if c == b'\n' {
-                highlights.iter().for_each(|_| self.end_highlight());
-                self.html.push(c);
-                self.line_offsets.push(self.html.len() as u32);
-                highlights
-                    .iter()
-                    .for_each(|scope| self.start_highlight(*scope, attribute_callback));
-            } else if let Some(escape) = html_escape(c) {
-                self.html.extend_from_slice(escape);
-            } else {
-                self.html.push(c);
+                let c = bytes[0];
+                bytes = &bytes[1..];
+
+                // Don't render carriage return characters, but allow lone carriage returns (not
+                // followed by line feeds) to be styled via the attribute callback.
+                if c == b'\r' {
+                    last_char_was_cr = true;
+                    continue;
+                }
+                if last_char_was_cr {
+                    if c != b'\n' {
+                        self.add_carriage_return(attribute_callback);
+                    }
+                    last_char_was_cr = false;
+                }
+
+                // At line boundaries, close and re-open all of the open tags.
+                if c == b'\n' {
+                    highlights.iter().for_each(|_| self.end_highlight());
+                    self.html.push(c);
+                    self.line_offsets.push(self.html.len() as u32);
+                    highlights
+                        .iter()
+                        .for_each(|scope| self.start_highlight(*scope, attribute_callback));
+                } else if let Some(escape) = html_escape(c) {
+                    self.html.extend_from_slice(escape);
+                }
             }
         }
     }
@@ -1205,3 +1580,290 @@ fn shrink_and_clear<T>(vec: &mut Vec<T>, capacity: usize) {
     }
     vec.clear();
 }
+
+/// Find the first byte that `HtmlRenderer::add_text` can't copy verbatim: one
+/// that must be escaped, a carriage return, or a line feed. Like the portable
+/// version of `memchr`, this examines eight bytes at a time, by checking each
+/// word for zero bytes after XORing it with each of the special bytes.
+fn find_special_html_byte(bytes: &[u8]) -> Option<usize> {
+    const LO: u64 = u64::from_ne_bytes([0x01; 8]);
+    const HI: u64 = u64::from_ne_bytes([0x80; 8]);
+    const fn repeat(byte: u8) -> u64 {
+        u64::from_ne_bytes([byte; 8])
+    }
+    const SPECIAL_WORDS: [u64; 7] = [
+        repeat(b'<'),
+        repeat(b'>'),
+        repeat(b'&'),
+        repeat(b'"'),
+        repeat(b'\''),
+        repeat(b'\r'),
+        repeat(b'\n'),
+    ];
+    const fn is_special(byte: u8) -> bool {
+        matches!(byte, b'<' | b'>' | b'&' | b'"' | b'\'' | b'\r' | b'\n')
+    }
+
+    let mut chunks = bytes.chunks_exact(8);
+    for (i, chunk) in chunks.by_ref().enumerate() {
+        let word = u64::from_le_bytes(chunk.try_into().unwrap());
+        let mut found = 0;
+        for special_word in SPECIAL_WORDS {
+            let x = word ^ special_word;
+            found |= x.wrapping_sub(LO) & !x & HI;
+        }
+        // A borrow can only flag bytes after a real match, so the lowest flagged
+        // byte is always a match.
+        if found != 0 {
+            return Some(i * 8 + found.trailing_zeros() as usize / 8);
+        }
+    }
+    let offset = bytes.len() - chunks.remainder().len();
+    chunks
+        .remainder()
+        .iter()
+        .position(|byte| is_special(*byte))
+        .map(|i| offset + i)
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn test_find_special_html_byte() {
+        fn expected_position(bytes: &[u8]) -> Option<usize> {
+            bytes
+                .iter()
+                .position(|byte| matches!(byte, b'<' | b'>' | b'&' | b'"' | b'\'' | b'\r' | b'\n'))
+        }
+
+        // Bytes next to the special ones, which the word-at-a-time search
+        // must not mistake for them.
+        let plain_bytes = [
+            b'a', b' ', b';', b'=', b'%', b'\t', 0x0b, 0x00, 0x7f, 0x80, 0xff,
+        ];
+        let special_bytes = [b'<', b'>', b'&', b'"', b'\'', b'\r', b'\n'];
+
+        let mut buffer = vec![0; 32];
+        for offset in 0..8 {
+            for len in 0..=17 {
+                for &plain_byte in &plain_bytes {
+                    let bytes = &mut buffer[offset..offset + len];
+                    bytes.fill(plain_byte);
+                    assert_eq!(find_special_html_byte(bytes), None);
+
+                    // A special byte at each position, with another one after
+                    // it to check that the first one is found.
+                    for position in 0..len {
+                        for &special_byte in &special_bytes {
+                            let bytes = &mut buffer[offset..offset + len];
+                            bytes.fill(plain_byte);
+                            bytes[position] = special_byte;
+                            if position + 2 < len {
+                                bytes[position + 2] = b'<';
+                            }
+                            assert_eq!(
+                                find_special_html_byte(bytes),
+                                expected_position(bytes),
+                                "offset {offset}, length {len}, bytes {bytes:?}",
+                            );
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    // The renderer as it was before runs of plain text were copied at once
+    // and opening tags were cached.
+    #[derive(Default)]
+    struct ReferenceRenderer {
+        html: Vec<u8>,
+        line_offsets: Vec<u32>,
+        carriage_return_highlight: Option<Highlight>,
+    }
+
+    impl ReferenceRenderer {
+        fn render<'a, F>(
+            &mut self,
+            events: &[HighlightEvent],
+            source: &'a [u8],
+            attribute_callback: &F,
+        ) where
+            F: Fn(Highlight) -> &'a [u8],
+        {
+            self.line_offsets.push(0);
+            let mut highlights = Vec::new();
+            for event in events {
+                match event {
+                    HighlightEvent::HighlightStart(s) => {
+                        highlights.push(*s);
+                        self.start_highlight(*s, attribute_callback);
+                    }
+                    HighlightEvent::HighlightEnd => {
+                        highlights.pop();
+                        self.html.extend(b"</span>");
+                    }
+                    HighlightEvent::Source { start, end } => {
+                        self.add_text(&source[*start..*end], &highlights, attribute_callback);
+                    }
+                }
+            }
+            if self.html.last() != Some(&b'\n') {
+                self.html.push(b'\n');
+            }
+            if self.line_offsets.last() == Some(&(self.html.len() as u32)) {
+                self.line_offsets.pop();
+            }
+        }
+
+        fn add_carriage_return<'a, F>(&mut self, attribute_callback: &F)
+        where
+            F: Fn(Highlight) -> &'a [u8],
+        {
+            if let Some(highlight) = self.carriage_return_highlight {
+                let attribute_string = (attribute_callback)(highlight);
+                if !attribute_string.is_empty() {
+                    self.html.extend(b"<span ");
+                    self.html.extend(attribute_string);
+                    self.html.extend(b"></span>");
+                }
+            }
+        }
+
+        fn start_highlight<'a, F>(&mut self, h: Highlight, attribute_callback: &F)
+        where
+            F: Fn(Highlight) -> &'a [u8],
+        {
+            let attribute_string = (attribute_callback)(h);
+            self.html.extend(b"<span");
+            if !attribute_string.is_empty() {
+                self.html.extend(b" ");
+                self.html.extend(attribute_string);
+            }
+            self.html.extend(b">");
+        }
+
+        fn add_text<'a, F>(&mut self, src: &[u8], highlights: &[Highlight], attribute_callback: &F)
+        where
+            F: Fn(Highlight) -> &'a [u8],
+        {
+            let mut last_char_was_cr = false;
+            for c in LossyUtf8::new(src).flat_map(|p| p.bytes()) {
+                if c == b'\r' {
+                    last_char_was_cr = true;
+                    continue;
+                }
+                if last_char_was_cr {
+                    if c != b'\n' {
+                        self.add_carriage_return(attribute_callback);
+                    }
+                    last_char_was_cr = false;
+                }
+                if c == b'\n' {
+                    highlights.iter().for_each(|_| self.html.extend(b"</span>"));
+                    self.html.push(c);
+                    self.line_offsets.push(self.html.len() as u32);
+                    highlights
+                        .iter()
+                        .for_each(|scope| self.start_highlight(*scope, attribute_callback));
+                } else {
+                    match c {
+                        b'>' => self.html.extend(b"&gt;"),
+                        b'<' => self.html.extend(b"&lt;"),
+                        b'&' => self.html.extend(b"&amp;"),
+                        b'\'' => self.html.extend(b"&#39;"),
+                        b'"' => self.html.extend(b"&quot;"),
+                        _ => self.html.push(c),
+                    }
+                }
+            }
+        }
+    }
+
+    fn assert_renders_like_reference_renderer(source: &[u8], events: &[HighlightEvent]) {
+        const ATTRIBUTES: [&[u8]; 4] = [b"class=\"a\"", b"", b"class=\"c&amp;d\"", b"style='x'"];
+        let attribute_callback = |h: Highlight| ATTRIBUTES[h.0 % ATTRIBUTES.len()];
+
+        for carriage_return_highlight in [None, Some(Highlight(0)), Some(Highlight(1))] {
+            let mut expected = ReferenceRenderer {
+                carriage_return_highlight,
+                ..Default::default()
+            };
+            expected.render(events, source, &attribute_callback);
+
+            let mut renderer = HtmlRenderer::new();
+            renderer.set_carriage_return_highlight(carriage_return_highlight);
+            renderer
+                .render(events.iter().copied().map(Ok), source, &attribute_callback)
+                .unwrap();
+            assert_eq!(
+                String::from_utf8_lossy(&renderer.html),
+                String::from_utf8_lossy(&expected.html),
+                "source {:?}",
+                String::from_utf8_lossy(source),
+            );
+            assert_eq!(renderer.line_offsets, expected.line_offsets);
+
+            // Rendering again with the same renderer gives the same result.
+            renderer.reset();
+            renderer
+                .render(events.iter().copied().map(Ok), source, &attribute_callback)
+                .unwrap();
+            assert_eq!(renderer.html, expected.html);
+        }
+    }
+
+    #[test]
+    fn test_html_renderer_matches_reference_renderer() {
+        let source = b"if (a < b && c > \"d\") { e = 'f'; }\r\nlet g = h;\r\r\n\rx\ri<>&\"'\n";
+        let source_event = |start: usize, end: usize| HighlightEvent::Source { start, end };
+
+        // The whole source as one event, nested in repeated highlights.
+        assert_renders_like_reference_renderer(
+            source,
+            &[
+                HighlightEvent::HighlightStart(Highlight(2)),
+                HighlightEvent::HighlightStart(Highlight(1)),
+                HighlightEvent::HighlightStart(Highlight(2)),
+                source_event(0, source.len()),
+                HighlightEvent::HighlightEnd,
+                HighlightEvent::HighlightEnd,
+                HighlightEvent::HighlightEnd,
+            ],
+        );
+
+        // The source split into events of every length, which separates
+        // carriage returns from the line feeds that follow them.
+        let highlights_by_event = [Some(0), None, Some(3), Some(0), Some(1), Some(0), None];
+        for event_len in 1..=source.len() {
+            let mut events = Vec::new();
+            for (i, start) in (0..source.len()).step_by(event_len).enumerate() {
+                let end = (start + event_len).min(source.len());
+                match highlights_by_event[i % highlights_by_event.len()] {
+                    Some(h) => {
+                        events.push(HighlightEvent::HighlightStart(Highlight(h)));
+                        events.push(source_event(start, end));
+                        events.push(HighlightEvent::HighlightEnd);
+                    }
+                    None => events.push(source_event(start, end)),
+                }
+            }
+            assert_renders_like_reference_renderer(source, &events);
+        }
+
+        // Invalid UTF-8 and long runs of plain text.
+        let source =
+            b"\xff\xfe<a\xc3\x28 \xe2\x82\xac & plain text without any special bytes\r\xf0\x9f";
+        assert_renders_like_reference_renderer(
+            source,
+            &[
+                HighlightEvent::HighlightStart(Highlight(3)),
+                source_event(0, 9),
+                HighlightEvent::HighlightEnd,
+                source_event(9, source.len()),
+            ],
+        );
+    }
+}
@@ -1,7 +1,8 @@
 /* automatically generated by rust-bindgen 0.69.4 */
 
-pub const TREE_SITTER_LANGUAGE_VERSION: u32 = 14;
+pub const TREE_SITTER_LANGUAGE_VERSION: u32 = 15;
 pub const TREE_SITTER_MIN_COMPATIBLE_LANGUAGE_VERSION: u32 = 13;
+pub const TS_INPUT_PENDING: u32 = 4294967295;
 pub type TSStateId = u16;
 pub type TSSymbol = u16;
 pub type TSFieldId = u16;
@@ -17,11 +18,26 @@ pub struct TSParser {
 }
 #[repr(C)]
 #[derive(Debug)]
+pub struct TSParserPool {
+    _unused: [u8; 0],
+}
+#[repr(C)]
+#[derive(Debug)]
 pub struct TSTree {
     _unused: [u8; 0],
 }
 #[repr(C)]
 #[derive(Debug)]
+pub struct TSTreeReclaimer {
+    _unused: [u8; 0],
+}
+#[repr(C)]
+#[derive(Debug)]
+pub struct TSLineIndex {
+    _unused: [u8; 0],
+}
+#[repr(C)]
+#[derive(Debug)]
 pub struct TSQuery {
     _unused: [u8; 0],
 }
@@ -32,9 +48,24 @@ pub struct TSQueryCursor {
 }
 #[repr(C)]
 #[derive(Debug)]
+pub struct TSQuerySession {
+    _unused: [u8; 0],
+}
+#[repr(C)]
+#[derive(Debug)]
 pub struct TSLookaheadIterator {
     _unused: [u8; 0],
 }
+#[repr(C)]
+#[derive(Debug, Copy, Clone)]
+pub struct TSLookaheadTable {
+    _unused: [u8; 0],
+}
+#[repr(C)]
+#[derive(Debug, Copy, Clone)]
+pub struct TSSymbolSet {
+    _unused: [u8; 0],
+}
 pub const TSInputEncodingUTF8: TSInputEncoding = 0;
 pub const TSInputEncodingUTF16: TSInputEncoding = 1;
 pub type TSInputEncoding = ::std::os::raw::c_uint;
@@ -87,6 +118,52 @@ pub struct TSLogger {
 }
 #[repr(C)]
 #[derive(Debug, Copy, Clone)]
+pub struct TSAllocator {
+    pub payload: *mut ::std::os::raw::c_void,
+    pub malloc: ::std::option::Option<
+        unsafe extern "C" fn(
+            payload: *mut ::std::os::raw::c_void,
+            size: usize,
+        ) -> *mut ::std::os::raw::c_void,
+    >,
+    pub calloc: ::std::option::Option<
+        unsafe extern "C" fn(
+            payload: *mut ::std::os::raw::c_void,
+            count: usize,
+            size: usize,
+        ) -> *mut ::std::os::raw::c_void,
+    >,
+    pub realloc: ::std::option::Option<
+        unsafe extern "C" fn(
+            payload: *mut ::std::os::raw::c_void,
+            ptr: *mut ::std::os::raw::c_void,
+            size: usize,
+        ) -> *mut ::std::os::raw::c_void,
+    >,
+    pub free: ::std::option::Option<
+        unsafe extern "C" fn(
+            payload: *mut ::std::os::raw::c_void,
+            ptr: *mut ::std::os::raw::c_void,
+        ),
+    >,
+}
+pub const TSNodeStringFormatSExpression: TSNodeStringFormat = 0;
+pub const TSNodeStringFormatJSON: TSNodeStringFormat = 1;
+pub type TSNodeStringFormat = ::std::os::raw::c_uint;
+#[repr(C)]
+#[derive(Debug)]
+pub struct TSStringWriter {
+    pub payload: *mut ::std::os::raw::c_void,
+    pub write: ::std::option::Option<
+        unsafe extern "C" fn(
+            payload: *mut ::std::os::raw::c_void,
+            data: *const ::std::os::raw::c_char,
+            length: u32,
+        ),
+    >,
+}
+#[repr(C)]
+#[derive(Debug, Copy, Clone)]
 pub struct TSInputEdit {
     pub start_byte: u32,
     pub old_end_byte: u32,
@@ -97,11 +174,66 @@ pub struct TSInputEdit {
 }
 #[repr(C)]
 #[derive(Debug, Copy, Clone)]
+pub struct TSParseStats {
+    pub lex_count: u32,
+    pub external_scan_count: u32,
+    pub lexed_byte_count: u64,
+    pub shift_count: u32,
+    pub reduce_count: u32,
+    pub reused_node_count: u32,
+    pub reused_byte_count: u64,
+    pub token_cache_hit_count: u32,
+    pub token_cache_miss_count: u32,
+    pub version_split_count: u32,
+    pub version_merge_count: u32,
+    pub version_limit_prune_count: u32,
+    pub version_cost_prune_count: u32,
+    pub max_version_count: u32,
+    pub error_recovery_micros: u64,
+}
+#[repr(C)]
+#[derive(Debug, Copy, Clone)]
+pub struct TSSyntaxCheck {
+    pub error_count: u32,
+    pub missing_count: u32,
+    pub first_error: TSRange,
+}
+pub const TSVersionPruningStrategyKeepBest: TSVersionPruningStrategy = 0;
+pub const TSVersionPruningStrategyDropNewest: TSVersionPruningStrategy = 1;
+pub type TSVersionPruningStrategy = ::std::os::raw::c_uint;
+#[repr(C)]
+#[derive(Debug, Copy, Clone)]
+pub struct TSVersionPolicy {
+    pub max_version_count: u32,
+    pub max_cost_difference: u32,
+    pub strategy: TSVersionPruningStrategy,
+}
+#[repr(C)]
+#[derive(Debug, Copy, Clone)]
 pub struct TSNode {
     pub context: [u32; 4usize],
     pub id: *const ::std::os::raw::c_void,
     pub tree: *const TSTree,
 }
+pub const TSDiffChangeTypeInsert: TSDiffChangeType = 0;
+pub const TSDiffChangeTypeDelete: TSDiffChangeType = 1;
+pub const TSDiffChangeTypeMove: TSDiffChangeType = 2;
+pub type TSDiffChangeType = ::std::os::raw::c_uint;
+#[repr(C)]
+#[derive(Debug, Copy, Clone)]
+pub struct TSDiffChange {
+    pub type_: TSDiffChangeType,
+    pub old_node: TSNode,
+    pub new_node: TSNode,
+}
+#[repr(C)]
+#[derive(Debug)]
+pub struct TSStreamCallback {
+    pub payload: *mut ::std::os::raw::c_void,
+    pub emit: ::std::option::Option<
+        unsafe extern "C" fn(payload: *mut ::std::os::raw::c_void, node: TSNode),
+    >,
+}
 #[repr(C)]
 #[derive(Debug, Copy, Clone)]
 pub struct TSTreeCursor {
@@ -129,6 +261,14 @@ pub struct TSQueryMatch {
     pub capture_count: u16,
     pub captures: *const TSQueryCapture,
 }
+#[repr(C)]
+#[derive(Debug, Copy, Clone)]
+pub struct TSQueryPatternStats {
+    pub started_state_count: u32,
+    pub copied_state_count: u32,
+    pub dropped_state_count: u32,
+    pub capture_list_count: u32,
+}
 pub const TSQueryPredicateStepTypeDone: TSQueryPredicateStepType = 0;
 pub const TSQueryPredicateStepTypeCapture: TSQueryPredicateStepType = 1;
 pub const TSQueryPredicateStepTypeString: TSQueryPredicateStepType = 2;
@@ -139,6 +279,70 @@ pub struct TSQueryPredicateStep {
     pub type_: TSQueryPredicateStepType,
     pub value_id: u32,
 }
+#[repr(C)]
+#[derive(Debug)]
+pub struct TSQueryTextProvider {
+    pub payload: *mut ::std::os::raw::c_void,
+    pub text: ::std::option::Option<
+        unsafe extern "C" fn(
+            payload: *mut ::std::os::raw::c_void,
+            node: TSNode,
+            length: *mut u32,
+        ) -> *const ::std::os::raw::c_char,
+    >,
+}
+#[repr(C)]
+#[derive(Debug)]
+pub struct TSQueryRegexEngine {
+    pub payload: *mut ::std::os::raw::c_void,
+    pub compile: ::std::option::Option<
+        unsafe extern "C" fn(
+            payload: *mut ::std::os::raw::c_void,
+            pattern: *const ::std::os::raw::c_char,
+            length: u32,
+        ) -> *mut ::std::os::raw::c_void,
+    >,
+    pub is_match: ::std::option::Option<
+        unsafe extern "C" fn(
+            payload: *mut ::std::os::raw::c_void,
+            regex: *const ::std::os::raw::c_void,
+            text: *const ::std::os::raw::c_char,
+            length: u32,
+        ) -> bool,
+    >,
+    pub destroy: ::std::option::Option<
+        unsafe extern "C" fn(
+            payload: *mut ::std::os::raw::c_void,
+            regex: *mut ::std::os::raw::c_void,
+        ),
+    >,
+}
+#[repr(C)]
+#[derive(Debug, Copy, Clone)]
+pub struct TSFlatTree {
+    pub node_count: u32,
+    pub symbols: *const TSSymbol,
+    pub start_bytes: *const u32,
+    pub end_bytes: *const u32,
+    pub start_points: *const TSPoint,
+    pub parent_indices: *const u32,
+    pub first_child_indices: *const u32,
+    pub next_sibling_indices: *const u32,
+    pub field_ids: *const TSFieldId,
+}
+#[repr(C)]
+#[derive(Debug, Copy, Clone)]
+pub struct TSQuerySessionCapture {
+    pub range: TSRange,
+    pub index: u32,
+}
+#[repr(C)]
+#[derive(Debug, Copy, Clone)]
+pub struct TSQuerySessionMatch {
+    pub pattern_index: u16,
+    pub capture_count: u16,
+    pub captures: *const TSQuerySessionCapture,
+}
 pub const TSQueryErrorNone: TSQueryError = 0;
 pub const TSQueryErrorSyntax: TSQueryError = 1;
 pub const TSQueryErrorNodeType: TSQueryError = 2;
@@ -151,6 +355,10 @@ extern "C" {
     #[doc = " Create a new parser."]
     pub fn ts_parser_new() -> *mut TSParser;
 }
+extern "C" {
+    #[doc = " Create a new parser that allocates its memory with the given allocator,\n instead of with the global allocation functions that are configured with\n [`ts_set_allocator`]. Each of the allocator's functions is called with its\n `payload`, so that different parsers can allocate from different arenas,\n or account for their memory separately.\n\n The allocator is inherited by the trees that the parser produces, and by\n their copies, so all of the memory owned by those trees comes from it as\n well. Buffers that are returned to the caller, such as the ranges returned\n by [`ts_tree_get_changed_ranges`], still come from the global functions.\n Tree cursors also use the global functions.\n\n If the allocator's `malloc` function is `NULL`, the global functions are\n used. Otherwise, all four functions must be provided. Trees can be used on\n several threads at once, so if copies of this parser's trees are shared\n between threads, the functions must be thread-safe.\n\n An old tree is only reused by [`ts_parser_parse`] if it was produced with\n the same allocator. Otherwise, it is ignored, and the document is parsed\n from scratch."]
+    pub fn ts_parser_new_with_allocator(allocator: TSAllocator) -> *mut TSParser;
+}
 extern "C" {
     #[doc = " Delete the parser, freeing all of the memory that it used."]
     pub fn ts_parser_delete(self_: *mut TSParser);
@@ -176,7 +384,7 @@ extern "C" {
     pub fn ts_parser_included_ranges(self_: *const TSParser, count: *mut u32) -> *const TSRange;
 }
 extern "C" {
-    #[doc = " Use the parser to parse some source code and create a syntax tree.\n\n If you are parsing this document for the first time, pass `NULL` for the\n `old_tree` parameter. Otherwise, if you have already parsed an earlier\n version of this document and the document has since been edited, pass the\n previous syntax tree so that the unchanged parts of it can be reused.\n This will save time and memory. For this to work correctly, you must have\n already edited the old syntax tree using the [`ts_tree_edit`] function in a\n way that exactly matches the source code changes.\n\n The [`TSInput`] parameter lets you specify how to read the text. It has the\n following three fields:\n 1. [`read`]: A function to retrieve a chunk of text at a given byte offset\n    and (row, column) position. The function should return a pointer to the\n    text and write its length to the [`bytes_read`] pointer. The parser does\n    not take ownership of this buffer; it just borrows it until it has\n    finished reading it. The function should write a zero value to the\n    [`bytes_read`] pointer to indicate the end of the document.\n 2. [`payload`]: An arbitrary pointer that will be passed to each invocation\n    of the [`read`] function.\n 3. [`encoding`]: An indication of how the text is encoded. Either\n    `TSInputEncodingUTF8` or `TSInputEncodingUTF16`.\n\n This function returns a syntax tree on success, and `NULL` on failure. There\n are three possible reasons for failure:\n 1. The parser does not have a language assigned. Check for this using the\n[`ts_parser_language`] function.\n 2. Parsing was cancelled due to a timeout that was set by an earlier call to\n    the [`ts_parser_set_timeout_micros`] function. You can resume parsing from\n    where the parser left out by calling [`ts_parser_parse`] again with the\n    same arguments. Or you can start parsing from scratch by first calling\n    [`ts_parser_reset`].\n 3. Parsing was cancelled using a cancellation flag that was set by an\n    earlier call to [`ts_parser_set_cancellation_flag`]. You can resume parsing\n    from where the parser left out by calling [`ts_parser_parse`] again with\n    the same arguments.\n\n [`read`]: TSInput::read\n [`payload`]: TSInput::payload\n [`encoding`]: TSInput::encoding\n [`bytes_read`]: TSInput::read"]
+    #[doc = " Use the parser to parse some source code and create a syntax tree.\n\n If you are parsing this document for the first time, pass `NULL` for the\n `old_tree` parameter. Otherwise, if you have already parsed an earlier\n version of this document and the document has since been edited, pass the\n previous syntax tree so that the unchanged parts of it can be reused.\n This will save time and memory. For this to work correctly, you must have\n already edited the old syntax tree using the [`ts_tree_edit`] function in a\n way that exactly matches the source code changes.\n\n The [`TSInput`] parameter lets you specify how to read the text. It has the\n following three fields:\n 1. [`read`]: A function to retrieve a chunk of text at a given byte offset\n    and (row, column) position. The function should return a pointer to the\n    text and write its length to the [`bytes_read`] pointer. The parser does\n    not take ownership of this buffer; it just borrows it until it has\n    finished reading it. The function should write a zero value to the\n    [`bytes_read`] pointer to indicate the end of the document, or\n [`TS_INPUT_PENDING`] to indicate that the text at that position is not\n available yet.\n 2. [`payload`]: An arbitrary pointer that will be passed to each invocation\n    of the [`read`] function.\n 3. [`encoding`]: An indication of how the text is encoded. Either\n    `TSInputEncodingUTF8` or `TSInputEncodingUTF16`.\n\n This function returns a syntax tree on success, and `NULL` on failure. There\n are four possible reasons for failure:\n 1. The parser does not have a language assigned. Check for this using the\n[`ts_parser_language`] function.\n 2. Parsing was cancelled due to a timeout or an operation limit that was set\n    by an earlier call to the [`ts_parser_set_timeout_micros`] or\n    [`ts_parser_set_operation_limit`] function. You can resume parsing from\n    where the parser left out by calling [`ts_parser_parse`] again with the\n    same arguments. Or you can start parsing from scratch by first calling\n    [`ts_parser_reset`].\n 3. Parsing was cancelled using a cancellation flag that was set by an\n    earlier call to [`ts_parser_set_cancellation_flag`]. You can resume parsing\n    from where the parser left out by calling [`ts_parser_parse`] again with\n    the same arguments.\n 4. The [`read`] function indicated that some text was not available yet.\n    Check for this using the [`ts_parser_is_waiting_for_input`] function.\n    Once the text is available, you can resume parsing by calling\n    [`ts_parser_parse`] again with the same arguments. The partially-read\n    token is lexed again from its start, so the [`read`] function must still\n    be able to provide all of the text that it has provided before.\n\n [`read`]: TSInput::read\n [`payload`]: TSInput::payload\n [`encoding`]: TSInput::encoding\n [`bytes_read`]: TSInput::read"]
     pub fn ts_parser_parse(
         self_: *mut TSParser,
         old_tree: *const TSTree,
@@ -203,7 +411,32 @@ extern "C" {
     ) -> *mut TSTree;
 }
 extern "C" {
-    #[doc = " Instruct the parser to start the next parse from the beginning.\n\n If the parser previously failed because of a timeout or a cancellation, then\n by default, it will resume where it left off on the next call to\n [`ts_parser_parse`] or other parsing functions. If you don't want to resume,\n and instead intend to use this parser to parse some other document, you must\n call [`ts_parser_reset`] first."]
+    #[doc = " Use the parser to parse the contents of a file, given an open file\n descriptor. The first two parameters are the same as in the\n [`ts_parser_parse`] function above. The file must be a regular file\n containing UTF8 text.\n\n Rather than being read into a buffer, the file is mapped into memory for\n the duration of the call, and the lexer reads directly from the mapping.\n The file must not be modified while it is being parsed. This function\n returns `NULL` if the file cannot be mapped, or if it is larger than 4GiB,\n in addition to all of the reasons described for [`ts_parser_parse`]."]
+    pub fn ts_parser_parse_file(
+        self_: *mut TSParser,
+        old_tree: *const TSTree,
+        file_descriptor: ::std::os::raw::c_int,
+    ) -> *mut TSTree;
+}
+extern "C" {
+    #[doc = " Use the parser to check the syntax of some source code, without building a\n syntax tree.\n\n The input is read in the same way as in the [`ts_parser_parse`] function.\n When the check finishes, this function returns `true` and stores a summary\n in `result`: the number of `ERROR` nodes and `MISSING` nodes that a full\n parse would contain, and the range of the first one. If neither count is\n nonzero, the source code has no syntax errors, and `first_error` is zeroed.\n\n This returns `false` in all of the cases where [`ts_parser_parse`] would\n return `NULL`, and a halted check can be resumed in the same way. Starting a\n check while a parse is halted, or vice versa, starts over from the beginning.\n\n The parser's memory stays bounded for grammars whose root rule is a\n repetition, because each top-level node is searched for errors and freed\n as soon as it can only become a child of the root node. Whether any errors\n are found always agrees with a full parse, but error recovery can't include\n the nodes that were freed, so in rare cases, the counts and the location of\n the first error differ. Callbacks that were set with\n [`ts_parser_set_stream_callback`] are not called during a check."]
+    pub fn ts_parser_check(
+        self_: *mut TSParser,
+        input: TSInput,
+        result: *mut TSSyntaxCheck,
+    ) -> bool;
+}
+extern "C" {
+    #[doc = " Use the parser to check the syntax of some UTF8 source code stored in one\n contiguous buffer. This works the same as the [`ts_parser_check`] function."]
+    pub fn ts_parser_check_string(
+        self_: *mut TSParser,
+        string: *const ::std::os::raw::c_char,
+        length: u32,
+        result: *mut TSSyntaxCheck,
+    ) -> bool;
+}
+extern "C" {
+    #[doc = " Instruct the parser to start the next parse from the beginning.\n\n If the parser previously failed because of a timeout, an operation limit, or\n a cancellation, then by default, it will resume where it left off on the next call to\n [`ts_parser_parse`] or other parsing functions. If you don't want to resume,\n and instead intend to use this parser to parse some other document, you must\n call [`ts_parser_reset`] first."]
     pub fn ts_parser_reset(self_: *mut TSParser);
 }
 extern "C" {
@@ -214,6 +447,38 @@ extern "C" {
     #[doc = " Get the duration in microseconds that parsing is allowed to take."]
     pub fn ts_parser_timeout_micros(self_: *const TSParser) -> u64;
 }
+extern "C" {
+    #[doc = " Set the maximum number of parse operations that each call to\n [`ts_parser_parse`] should be allowed to perform before halting.\n\n An operation is one step of the parser's main loop, in which it handles a\n single lookahead token in one version of the parse stack, so the amount of\n work that a parse performs is roughly proportional to its number of\n operations. Unlike a timeout, this limit is checked without reading the\n clock, and it halts the parse at the same point every time. This lets an\n application interleave the parsing of many documents on one thread in\n predictable slices, resuming each parse by calling [`ts_parser_parse`]\n again with the same arguments.\n\n Each call to [`ts_parser_parse`] gets a fresh budget, so a parse always\n makes progress. Passing zero removes the limit, which is the default."]
+    pub fn ts_parser_set_operation_limit(self_: *mut TSParser, operation_limit: u64);
+}
+extern "C" {
+    #[doc = " Get the maximum number of operations that each call to [`ts_parser_parse`]\n is allowed to perform."]
+    pub fn ts_parser_operation_limit(self_: *const TSParser) -> u64;
+}
+extern "C" {
+    #[doc = " Check whether the parser's most recent call to [`ts_parser_parse`] returned\n early because its input indicated that some text was not available yet,\n using [`TS_INPUT_PENDING`].\n\n This lets an application parse many documents concurrently on a few threads,\n without blocking a thread while it reads a document's text. Instead of\n waiting for the text, the `read` function can start reading it in the\n background and return [`TS_INPUT_PENDING`]. The parse can then be resumed\n on any thread, once the text has been read."]
+    pub fn ts_parser_is_waiting_for_input(self_: *const TSParser) -> bool;
+}
+extern "C" {
+    #[doc = " Set whether the parser should allocate the nodes of the trees that it\n produces out of large, shared memory chunks called *arenas*.\n\n By default, each node is allocated individually, and deleting a tree\n requires visiting and freeing all of its nodes. In arena mode, nodes are\n instead carved out of chunks that are owned by the resulting tree, so\n [`ts_tree_delete`] only needs to free the chunks. The tradeoff is that the\n memory used by a tree's nodes is not reclaimed until every tree that shares\n its arenas has been deleted. Because incremental parsing reuses nodes from\n the old tree, a tree that is produced by reparsing an arena-allocated tree\n keeps the old tree's arenas alive. This mode is therefore best suited to\n parsing many documents in bulk, rather than to long-lived documents that\n are edited and reparsed many times.\n\n This setting takes effect at the start of the next parse."]
+    pub fn ts_parser_set_arena_enabled(self_: *mut TSParser, enabled: bool);
+}
+extern "C" {
+    #[doc = " Get whether the parser allocates the trees that it produces in arenas."]
+    pub fn ts_parser_arena_enabled(self_: *const TSParser) -> bool;
+}
+extern "C" {
+    #[doc = " Set the limits that the parser should apply to the number of versions of the\n parse stack that it explores at once.\n\n When the parser encounters an ambiguity or a syntax error, it splits its\n parse stack into several versions, and explores them in parallel. The cost of\n parsing grows with the number of live versions, so on highly ambiguous\n grammars or badly broken input, tightening these limits bounds the time that\n a parse can take, at the cost of sometimes not finding the best tree:\n\n - `max_version_count`: The number of versions that are kept after each\n   token. This must be at least one, and is six by default.\n - `max_cost_difference`: How much more costly a version's errors may be\n   than those of the best version, weighted by the progress that the best\n   version has made since its last error, before the version is discarded.\n - `strategy`: Which versions are discarded when there are too many. With\n   `TSVersionPruningStrategyKeepBest`, the default, the versions are ranked\n   by their error costs, and the versions that are created by a reduction can\n   briefly exceed the limit until they are ranked. With\n   `TSVersionPruningStrategyDropNewest`, versions are never allowed to\n   exceed the limit, and the most recently created versions are discarded\n   first."]
+    pub fn ts_parser_set_version_policy(self_: *mut TSParser, policy: TSVersionPolicy);
+}
+extern "C" {
+    #[doc = " Get the parser's current version policy."]
+    pub fn ts_parser_version_policy(self_: *const TSParser) -> TSVersionPolicy;
+}
+extern "C" {
+    #[doc = " Get counters describing the work that the parser performed during its most\n recent parse.\n\n The counters record the number of times the lexer and the external scanner\n were called and how many bytes they examined, the number of shift and reduce\n actions, the number of nodes reused from the old tree and the bytes that\n they span, the number of times a token could and couldn't be reused from the\n parser's cache of recently lexed tokens, the number of times the parse stack\n was split into multiple versions because of an ambiguity or merged back\n together, the number of versions that were discarded because of the limits\n set by the parser's [`TSVersionPolicy`], and the total time spent recovering\n from errors.\n\n A version is counted in `version_limit_prune_count` when it is discarded\n because there were too many versions, and in `version_cost_prune_count` when\n it is discarded because another version had a lower error cost. The\n `max_version_count` is the largest number of versions that were live at\n once, before the versions that weren't worth pursuing were discarded.\n\n After an edit, comparing `lexed_byte_count` and `reused_byte_count` to the\n size of the edit shows how much of the document had to be parsed again.\n\n The counters are reset at the start of each parse. When a parse is halted\n early and then resumed, they accumulate across the calls."]
+    pub fn ts_parser_stats(self_: *const TSParser) -> TSParseStats;
+}
 extern "C" {
     #[doc = " Set the parser's current cancellation flag pointer.\n\n If a non-null pointer is assigned, then the parser will periodically read\n from this pointer during parsing. If it reads a non-zero value, it will\n halt early, returning NULL. See [`ts_parser_parse`] for more information."]
     pub fn ts_parser_set_cancellation_flag(self_: *mut TSParser, flag: *const usize);
@@ -230,14 +495,70 @@ extern "C" {
     #[doc = " Get the parser's current logger."]
     pub fn ts_parser_logger(self_: *const TSParser) -> TSLogger;
 }
+extern "C" {
+    #[doc = " Set the tree reclaimer that a parser should use to free the trees that it\n no longer needs, or `NULL` to free them immediately.\n\n After an incremental parse, the parser keeps a reference to the old tree's\n nodes until it is reset or parses again. When a reclaimer is set, that\n reference is handed off to the reclaimer instead of being released on the\n calling thread. The parser does not take ownership over the reclaimer, which\n must outlive any use of the parser."]
+    pub fn ts_parser_set_tree_reclaimer(self_: *mut TSParser, reclaimer: *mut TSTreeReclaimer);
+}
+extern "C" {
+    #[doc = " Get the parser's current tree reclaimer."]
+    pub fn ts_parser_tree_reclaimer(self_: *const TSParser) -> *mut TSTreeReclaimer;
+}
+extern "C" {
+    #[doc = " Set the callback that a parser should use to stream the top-level nodes of\n the documents that it parses, or pass a callback whose `emit` function is\n `NULL` to turn streaming off.\n\n In streaming mode, each time the parser finishes a run of top-level nodes,\n it passes them to the callback in order, and then frees them, so that the\n memory used while parsing a long document is proportional to its largest\n top-level node, rather than to its length. When the parse is complete, the\n root's remaining children are passed to the callback too. The nodes are only\n valid for the duration of the call.\n\n This is meant for grammars whose root rule is a repetition, such as\n line-based or record-based data formats. Top-level nodes are only streamed\n while the parser is exploring a single interpretation of the document, and\n is not recovering from an error. Streamed nodes are final, so when a later\n syntax error would be best recovered from by reinterpreting them, the parser\n cannot do so, and its result may differ from that of an ordinary parse. The\n tree returned by the parse function does not contain the streamed nodes, and\n the parser does not reuse nodes from an old tree while streaming."]
+    pub fn ts_parser_set_stream_callback(self_: *mut TSParser, callback: TSStreamCallback);
+}
+extern "C" {
+    #[doc = " Get the parser's current stream callback."]
+    pub fn ts_parser_stream_callback(self_: *const TSParser) -> TSStreamCallback;
+}
 extern "C" {
     #[doc = " Set the file descriptor to which the parser should write debugging graphs\n during parsing. The graphs are formatted in the DOT language. You may want\n to pipe these graphs directly to a `dot(1)` process in order to generate\n SVG output. You can turn off this logging by passing a negative number."]
     pub fn ts_parser_print_dot_graphs(self_: *mut TSParser, fd: ::std::os::raw::c_int);
 }
 extern "C" {
-    #[doc = " Create a shallow copy of the syntax tree. This is very fast.\n\n You need to copy a syntax tree in order to use it on more than one thread at\n a time, as syntax trees are not thread safe."]
+    #[doc = " Create a new pool of parsers for the given language.\n\n A parser pool recycles parsers instead of deleting them, so that the memory\n that they allocate while parsing can be reused by later parses. At most\n `max_parser_count` idle parsers are kept. When an idle parser is keeping\n more than `max_retained_size` bytes of working memory, that memory is freed\n before the parser is kept, so that a single large parse does not pin its\n memory for the lifetime of the pool.\n\n Returns `NULL` if the language was generated with an incompatible version of\n the Tree-sitter CLI.\n\n A parser pool is not thread safe, but languages can be shared between\n threads, so each thread can own its own pool for the same language."]
+    pub fn ts_parser_pool_new(
+        language: *const TSLanguage,
+        max_parser_count: u32,
+        max_retained_size: usize,
+    ) -> *mut TSParserPool;
+}
+extern "C" {
+    #[doc = " Delete the parser pool, along with all of its idle parsers."]
+    pub fn ts_parser_pool_delete(self_: *mut TSParserPool);
+}
+extern "C" {
+    #[doc = " Take a parser from the pool, or create a new one if the pool has no idle\n parsers. The parser's language is set to the pool's language.\n\n Parsers for wasm languages need a wasm store, so a newly created parser for\n a wasm language has no language until the caller assigns it a store with\n [`ts_parser_set_wasm_store`] and sets its language. Parsers keep their store\n while they are in the pool."]
+    pub fn ts_parser_pool_acquire(self_: *mut TSParserPool) -> *mut TSParser;
+}
+extern "C" {
+    #[doc = " Return a parser to the pool, or delete it if the pool is full.\n\n The parser is reset, its language is set back to the pool's language, and\n its logger, dot graph output, cancellation flag, timeout, operation limit,\n included ranges, arena setting, tree reclaimer, stream callback and version\n policy are restored to their defaults. As with [`ts_parser_set_logger`], the\n caller remains responsible for the logger's payload. The parser must not be\n used after it is released."]
+    pub fn ts_parser_pool_release(self_: *mut TSParserPool, parser: *mut TSParser);
+}
+extern "C" {
+    #[doc = " Create a new tree reclaimer.\n\n Deleting a large syntax tree visits every one of its nodes, which can cause\n a noticeable pause. A tree reclaimer lets an application hand trees off\n instead, and free them later in small steps, either from a background\n thread or between other work."]
+    pub fn ts_tree_reclaimer_new() -> *mut TSTreeReclaimer;
+}
+extern "C" {
+    #[doc = " Delete the tree reclaimer, freeing all of the trees that it still holds."]
+    pub fn ts_tree_reclaimer_delete(self_: *mut TSTreeReclaimer);
+}
+extern "C" {
+    #[doc = " Hand a syntax tree off to the reclaimer, which takes ownership of it. The\n tree must not be used afterward, though copies of it and their nodes remain\n valid.\n\n This function takes constant time, and may be called from any thread, even\n while another thread is calling [`ts_tree_reclaimer_step`]."]
+    pub fn ts_tree_reclaimer_add(self_: *mut TSTreeReclaimer, tree: *mut TSTree);
+}
+extern "C" {
+    #[doc = " Free some of the memory held by the reclaimer, releasing at most\n `max_subtree_count` syntax nodes. Trees are freed in the order that they\n were added.\n\n Returns `true` if the reclaimer still holds trees that have not been freed.\n Only one thread may call this function at a time."]
+    pub fn ts_tree_reclaimer_step(self_: *mut TSTreeReclaimer, max_subtree_count: u32) -> bool;
+}
+extern "C" {
+    #[doc = " Create a shallow copy of the syntax tree. This is very fast.\n\n You need to copy a syntax tree in order to use it on more than one thread at\n a time, as syntax trees are not thread safe, unless the tree has been frozen\n using [`ts_tree_freeze`]."]
     pub fn ts_tree_copy(self_: *const TSTree) -> *mut TSTree;
 }
+extern "C" {
+    #[doc = " Combine syntax trees that were parsed from consecutive pieces of a document\n into a single tree, for use as the old tree when parsing the whole document.\n\n This allows a large document to be parsed in parallel: split it into pieces,\n parse each piece separately on its own thread, then combine the results with\n this function and pass the combined tree to [`ts_parser_parse`] along with\n the full text. The final parse reuses the nodes of the pieces, reparsing only\n the text around the boundaries between them, so it produces the same tree\n as parsing the document from scratch, regardless of where it was split. Its\n speed depends on the choice of split points, though: they should be places\n where a top-level construct can begin, such as the start of a line before a\n statement or declaration.\n\n The trees must share the same language and allocator, and must have been\n parsed without included ranges. This returns `NULL` if no trees are given or\n if their languages or allocators differ. The given trees are not modified."]
+    pub fn ts_tree_concat(trees: *const *const TSTree, count: u32) -> *mut TSTree;
+}
 extern "C" {
     #[doc = " Delete the syntax tree, freeing all of the memory that it used."]
     pub fn ts_tree_delete(self_: *mut TSTree);
@@ -266,6 +587,15 @@ extern "C" {
     #[doc = " Edit the syntax tree to keep it in sync with source code that has been\n edited.\n\n You must describe the edit both in terms of byte offsets and in terms of\n (row, column) coordinates."]
     pub fn ts_tree_edit(self_: *mut TSTree, edit: *const TSInputEdit);
 }
+extern "C" {
+    #[doc = " Edit the syntax tree to keep it in sync with source code that has been\n edited in several places at once.\n\n The edits are applied in order, exactly as if [`ts_tree_edit`] had been\n called with each of them, so each edit must be described in terms of the\n document that results from the edits before it. The tree is traversed only\n once, however, which is much faster than editing it repeatedly when there\n are many edits.\n\n If `changed_range` is not `NULL`, it is set to the smallest range of the\n edited document that contains all of the inserted text."]
+    pub fn ts_tree_edit_batch(
+        self_: *mut TSTree,
+        edits: *const TSInputEdit,
+        count: u32,
+        changed_range: *mut TSRange,
+    );
+}
 extern "C" {
     #[doc = " Compare an old edited syntax tree to a new syntax tree representing the same\n document, returning an array of ranges whose syntactic structure has changed.\n\n For this to work correctly, the old syntax tree must have been edited such\n that its ranges match up to the new tree. Generally, you'll want to call\n this function right after calling one of the [`ts_parser_parse`] functions.\n You need to pass the old tree that was passed to parse, as well as the new\n tree that was returned from that function.\n\n The returned array is allocated using `malloc` and the caller is responsible\n for freeing it using `free`. The length of the array will be written to the\n given `length` pointer."]
     pub fn ts_tree_get_changed_ranges(
@@ -274,6 +604,72 @@ extern "C" {
         length: *mut u32,
     ) -> *mut TSRange;
 }
+extern "C" {
+    #[doc = " Compare an old edited syntax tree to a new syntax tree, like\n [`ts_tree_get_changed_ranges`], but write the changed ranges into a buffer\n provided by the caller instead of allocating an array.\n\n At most `capacity` ranges are written to the `ranges` buffer. The total\n number of changed ranges is returned, so if it is greater than `capacity`,\n the caller can retry with a larger buffer."]
+    pub fn ts_tree_get_changed_ranges_into(
+        old_tree: *const TSTree,
+        new_tree: *const TSTree,
+        ranges: *mut TSRange,
+        capacity: u32,
+    ) -> u32;
+}
+extern "C" {
+    #[doc = " Compare two syntax trees of the same language structurally, returning an\n array of the nodes that were inserted, deleted, or moved.\n\n Unlike [`ts_tree_get_changed_ranges`], the trees don't need to be related\n by edits: they can be parsed from any two versions of a document, such as\n two revisions of a file under review. Nodes are compared by their types and\n by the text of their leaves, which is read from the given source code, so\n differences in whitespace are ignored. Identical subtrees are found using\n hashes of their content, which are computed for each call. The trees are\n not modified, so this is safe to call concurrently on trees that share\n subtrees, including frozen trees.\n\n Each change has one of these types:\n - [`TSDiffChangeTypeDelete`]: `old_node` has no counterpart in the new tree.\n   Its descendants are deleted too, unless they are reported as moved.\n - [`TSDiffChangeTypeInsert`]: `new_node` has no counterpart in the old tree.\n   Its descendants are inserted too, unless they are reported as moved.\n - [`TSDiffChangeTypeMove`]: `old_node` became `new_node`, but either it has a\n   different parent, or it was reordered with respect to its siblings.\n\n The node that isn't used by a change is null. The deletions come first, in\n the order of the old tree, followed by the insertions and moves in the order\n of the new tree. If the trees have different languages, no changes are\n returned.\n\n The returned array is allocated using `malloc` and the caller is responsible\n for freeing it using `free`. The length of the array will be written to the\n given `length` pointer."]
+    pub fn ts_tree_diff(
+        old_tree: *const TSTree,
+        old_source: *const ::std::os::raw::c_char,
+        old_length: u32,
+        new_tree: *const TSTree,
+        new_source: *const ::std::os::raw::c_char,
+        new_length: u32,
+        length: *mut u32,
+    ) -> *mut TSDiffChange;
+}
+extern "C" {
+    #[doc = " Serialize the syntax tree into a compact binary format, so that it can be\n saved and loaded again later without re-parsing the source code.\n\n The format is a flat, position-independent byte buffer, which can be read\n back with [`ts_tree_deserialize`] directly from a memory-mapped file. It\n includes the tree's included ranges and external scanner states.\n\n The returned buffer is allocated using `malloc` and the caller is responsible\n for freeing it using `free`. Its length will be written to the given\n `length` pointer."]
+    pub fn ts_tree_serialize(self_: *const TSTree, length: *mut u32)
+        -> *mut ::std::os::raw::c_char;
+}
+extern "C" {
+    #[doc = " Load a syntax tree that was serialized with [`ts_tree_serialize`].\n\n The language must be the same one that the tree was originally parsed with.\n If the data is malformed, or was produced by a different language or an\n incompatible version of the library, this function returns `NULL`.\n\n The structure of the tree is validated as it is loaded: every symbol, parse\n state and production must exist in the language, every node's counts of\n visible and named children must match its children, and every production\n must have room for its children. Navigating a tree that was loaded from\n corrupted data is therefore safe. The nodes' positions and external scanner\n states are not checked against anything, so such a tree may not match any\n source code, and data that didn't come from [`ts_tree_serialize`] should\n not be used as the old tree for a parse with an external scanner.\n\n The returned tree is equivalent to the original, and can be passed as the\n `old_tree` for incremental reparsing. It does not reference the given data\n after this function returns."]
+    pub fn ts_tree_deserialize(
+        language: *const TSLanguage,
+        data: *const ::std::os::raw::c_char,
+        length: u32,
+    ) -> *mut TSTree;
+}
+extern "C" {
+    #[doc = " Enable or disable the syntax tree's parent index.\n\n By default, finding a node's parent or siblings requires walking down from\n the root of the tree. When the parent index is enabled, the tree instead\n records the parent of every node the first time one of these functions is\n called, so that [`ts_node_parent`] and the sibling functions run in constant\n time for nodes retrieved from this tree. The index costs memory\n proportional to the size of the tree. It is discarded when the tree is\n edited with [`ts_tree_edit`] and rebuilt lazily afterward, and it is shared\n with copies made using [`ts_tree_copy`].\n\n The index also records the offsets of the children of nodes with 32 or\n more children. Functions that find the node at a given position, like\n [`ts_node_descendant_for_byte_range`] and\n [`ts_tree_cursor_goto_first_child_for_byte`], use these offsets to binary\n search the children of such nodes. [`ts_node_child_by_field_id`],\n [`ts_node_child_by_field_name`] and\n [`ts_tree_cursor_goto_child_by_field_id`] use them in the same way, to skip\n to the first child that can have the field. The offsets are part of the\n parent index, so when it is disabled, these functions visit each child in\n turn, as they do in nodes with fewer children."]
+    pub fn ts_tree_set_parent_index_enabled(self_: *mut TSTree, enabled: bool);
+}
+extern "C" {
+    #[doc = " Check whether the syntax tree's parent index is enabled."]
+    pub fn ts_tree_parent_index_enabled(self_: *const TSTree) -> bool;
+}
+extern "C" {
+    #[doc = " Freeze the syntax tree, returning a read-only handle to it that can be\n shared by any number of threads without copying the tree.\n\n Giving each thread its own copy made with [`ts_tree_copy`] updates a\n reference count that all of the copies share. Instead, the threads can read\n a frozen tree concurrently through the returned handle, without writing to\n any memory that is shared between them. This applies to every function that\n takes a `const TSTree *` or a [`TSNode`] from the tree, as well as to tree\n cursors and query cursors, as long as each thread uses its own cursors. A\n [`TSQuery`] can be shared by the threads as well. Freezing builds anything\n that the tree would otherwise build lazily when it is first read, such as\n its parent index.\n\n The handle is only valid as long as the tree itself: the owner of the tree\n must not edit it, change its parent index setting, or delete it until all\n of the threads are done reading it."]
+    pub fn ts_tree_freeze(self_: *mut TSTree) -> *const TSTree;
+}
+extern "C" {
+    #[doc = " Create a flattened, read-only snapshot of the syntax tree, for analyses that\n walk the whole tree many times.\n\n The snapshot stores the tree's visible nodes in pre-order, as a set of\n parallel arrays indexed by node: each node's symbol, start and end byte,\n start point, and the field that it is associated with in its parent. Each\n node also has the indices of its parent, its first child, and its next\n sibling, which are `TS_FLAT_TREE_NONE` when there is no such node. The root\n node is at index zero. Node symbols reflect any aliases, as with\n [`ts_node_symbol`].\n\n Because the nodes' positions are already resolved, reading the snapshot\n never touches the tree, and the snapshot remains valid after the tree is\n edited or deleted. It must be freed with [`ts_flat_tree_delete`]."]
+    pub fn ts_tree_flatten(self_: *const TSTree) -> *mut TSFlatTree;
+}
+extern "C" {
+    #[doc = " Delete a flattened syntax tree, freeing all of the memory that it used."]
+    pub fn ts_flat_tree_delete(self_: *mut TSFlatTree);
+}
+extern "C" {
+    #[doc = " Get the number of bytes of memory that are used by the syntax tree's nodes,\n including their child arrays and external scanner states, along with the\n tree object itself.\n\n Nodes that are shared with other trees, such as copies of this tree, or\n trees that were produced by reparsing it, are included in the total. Use\n [`ts_tree_shared_memory_usage`] to find out how much memory several trees\n have in common. Caches that are built lazily, such as the parent index, are\n not included."]
+    pub fn ts_tree_memory_usage(self_: *const TSTree) -> usize;
+}
+extern "C" {
+    #[doc = " Get the number of bytes of memory that are used by the nodes that are\n reachable from more than one of the given syntax trees.\n\n If `unique_bytes` is not `NULL`, it must have room for `count` values, and it\n is filled with the number of bytes that are used by each tree alone. Unless\n the trees were allocated in arenas, this is the memory that would be freed by\n deleting that tree while keeping all of the others. The total memory used by\n all of the trees is the sum of these values and the returned value.\n\n Each shared node is visited only once, so this takes time proportional to\n the total number of distinct nodes."]
+    pub fn ts_tree_shared_memory_usage(
+        trees: *const *const TSTree,
+        count: u32,
+        unique_bytes: *mut usize,
+    ) -> usize;
+}
 extern "C" {
     #[doc = " Write a DOT graph describing the syntax tree to the given file."]
     pub fn ts_tree_print_dot_graph(self_: *const TSTree, file_descriptor: ::std::os::raw::c_int);
@@ -318,6 +714,10 @@ extern "C" {
     #[doc = " Get an S-expression representing the node as a string.\n\n This string is allocated with `malloc` and the caller is responsible for\n freeing it using `free`."]
     pub fn ts_node_string(self_: TSNode) -> *mut ::std::os::raw::c_char;
 }
+extern "C" {
+    #[doc = " Write a string representation of the node and its descendants to the given\n writer, without building the whole string in memory. The string is passed\n to the writer's callback in chunks of a bounded size, which are not\n null-terminated.\n\n With [`TSNodeStringFormatSExpression`], the string is the same S-expression\n that is returned by [`ts_node_string`].\n\n With [`TSNodeStringFormatJSON`], the string is a JSON object describing the\n node, with its `type`, `field`, byte and point ranges, and whether it is\n `named`, `missing` or `extra`. The visible nodes below it, both named and\n anonymous, are listed in its `children` array."]
+    pub fn ts_node_write_string(self_: TSNode, format: TSNodeStringFormat, writer: TSStringWriter);
+}
 extern "C" {
     #[doc = " Check if the node is null. Functions like [`ts_node_child`] and\n [`ts_node_next_sibling`] will return a null node to indicate that no such node\n was found."]
     pub fn ts_node_is_null(self_: TSNode) -> bool;
@@ -524,6 +924,13 @@ extern "C" {
         goal_point: TSPoint,
     ) -> i64;
 }
+extern "C" {
+    #[doc = " Move the cursor to the child of its current node with the given numerical\n field id, which is the node that [`ts_node_child_by_field_id`] returns.\n In nodes with many children, the child is found without visiting the\n children that come before it, when the tree's parent index is enabled.\n\n This returns `true` if the cursor successfully moved, and returns `false`\n if the current node has no child with the given field."]
+    pub fn ts_tree_cursor_goto_child_by_field_id(
+        self_: *mut TSTreeCursor,
+        field_id: TSFieldId,
+    ) -> bool;
+}
 extern "C" {
     pub fn ts_tree_cursor_copy(cursor: *const TSTreeCursor) -> TSTreeCursor;
 }
@@ -541,6 +948,21 @@ extern "C" {
     #[doc = " Delete a query, freeing all of the memory that it used."]
     pub fn ts_query_delete(self_: *mut TSQuery);
 }
+extern "C" {
+    #[doc = " Serialize a compiled query into a binary format, so that it can be saved\n and loaded again later with [`ts_query_deserialize`], skipping the work of\n parsing and analyzing the query's source.\n\n The returned buffer is allocated using `malloc` and the caller is responsible\n for freeing it using `free`. Its length will be written to the given\n `length` pointer."]
+    pub fn ts_query_serialize(
+        self_: *const TSQuery,
+        length: *mut u32,
+    ) -> *mut ::std::os::raw::c_char;
+}
+extern "C" {
+    #[doc = " Load a query that was serialized with [`ts_query_serialize`].\n\n The language must be the same one that the query was created for. If the\n data is malformed, or was produced for a different version of the language\n or by an incompatible version of the library, this function returns `NULL`."]
+    pub fn ts_query_deserialize(
+        language: *const TSLanguage,
+        data: *const ::std::os::raw::c_char,
+        length: u32,
+    ) -> *mut TSQuery;
+}
 extern "C" {
     #[doc = " Get the number of patterns, captures, or string literals in the query."]
     pub fn ts_query_pattern_count(self_: *const TSQuery) -> u32;
@@ -611,6 +1033,10 @@ extern "C" {
     #[doc = " Create a new cursor for executing a given query.\n\n The cursor stores the state that is needed to iteratively search\n for matches. To use the query cursor, first call [`ts_query_cursor_exec`]\n to start running a given query on a given syntax node. Then, there are\n two options for consuming the results of the query:\n 1. Repeatedly call [`ts_query_cursor_next_match`] to iterate over all of the\n    *matches* in the order that they were found. Each match contains the\n    index of the pattern that matched, and an array of captures. Because\n    multiple patterns can match the same set of nodes, one match may contain\n    captures that appear *before* some of the captures from a previous match.\n 2. Repeatedly call [`ts_query_cursor_next_capture`] to iterate over all of the\n    individual *captures* in the order that they appear. This is useful if\n    don't care about which pattern matched, and just want a single ordered\n    sequence of captures.\n\n If you don't care about consuming all of the results, you can stop calling\n [`ts_query_cursor_next_match`] or [`ts_query_cursor_next_capture`] at any point.\n  You can then start executing another query on another node by calling\n  [`ts_query_cursor_exec`] again."]
     pub fn ts_query_cursor_new() -> *mut TSQueryCursor;
 }
+extern "C" {
+    #[doc = " Create a new query cursor that allocates its memory with the given\n allocator, instead of with the global allocation functions. See\n [`ts_parser_new_with_allocator`]."]
+    pub fn ts_query_cursor_new_with_allocator(allocator: TSAllocator) -> *mut TSQueryCursor;
+}
 extern "C" {
     #[doc = " Delete a query cursor, freeing all of the memory that it used."]
     pub fn ts_query_cursor_delete(self_: *mut TSQueryCursor);
@@ -619,6 +1045,15 @@ extern "C" {
     #[doc = " Start running a given query on a given node."]
     pub fn ts_query_cursor_exec(self_: *mut TSQueryCursor, query: *const TSQuery, node: TSNode);
 }
+extern "C" {
+    #[doc = " Start running several queries on a given node at once.\n\n All of the queries are matched during a single traversal of the syntax\n tree, which is faster than running each of them separately. Use\n [`ts_query_cursor_next_query_match`] or [`ts_query_cursor_next_query_capture`]\n to find out which query each result belongs to. The results' pattern indices\n and capture indices refer to the patterns and captures of that query.\n\n The queries must not be deleted while the cursor is executing them. At most\n 65535 queries can be given, with at most 65535 patterns between them. If\n there are more, the cursor is halted and produces no results."]
+    pub fn ts_query_cursor_exec_queries(
+        self_: *mut TSQueryCursor,
+        queries: *const *const TSQuery,
+        query_count: u32,
+        node: TSNode,
+    );
+}
 extern "C" {
     #[doc = " Manage the maximum number of in-progress matches allowed by this query\n cursor.\n\n Query cursors have an optional maximum capacity for storing lists of\n in-progress captures. If this capacity is exceeded, then the\n earliest-starting match will silently be dropped to make room for further\n matches. This maximum capacity is optional — by default, query cursors allow\n any number of pending matches, dynamically allocating new space for them as\n needed as the query is executed."]
     pub fn ts_query_cursor_did_exceed_match_limit(self_: *const TSQueryCursor) -> bool;
@@ -629,6 +1064,20 @@ extern "C" {
 extern "C" {
     pub fn ts_query_cursor_set_match_limit(self_: *mut TSQueryCursor, limit: u32);
 }
+extern "C" {
+    #[doc = " Enable or disable the collection of per-pattern statistics by this query\n cursor. Statistics are disabled by default. Changes take effect when the\n cursor next starts executing a query."]
+    pub fn ts_query_cursor_set_pattern_stats_enabled(self_: *mut TSQueryCursor, enabled: bool);
+}
+extern "C" {
+    pub fn ts_query_cursor_pattern_stats_enabled(self_: *const TSQueryCursor) -> bool;
+}
+extern "C" {
+    #[doc = " Get the statistics that the cursor has collected for the given pattern\n since it started executing its current query.\n\n The counters record the number of in-progress matches that were started for\n the pattern, the number that were created by copying another in-progress\n match because a part of the pattern could match in more than one way, the\n number that were dropped because the match limit was exceeded, and the\n number of capture lists that were acquired for the pattern's matches.\n Patterns whose matches are frequently started, copied or dropped are the\n ones that make a query slow.\n\n When the cursor is executing several queries at once, patterns are numbered\n in the same way as in the matches that it returns. If statistics are\n disabled, all of the counters are zero."]
+    pub fn ts_query_cursor_pattern_stats(
+        self_: *const TSQueryCursor,
+        pattern_index: u32,
+    ) -> TSQueryPatternStats;
+}
 extern "C" {
     #[doc = " Set the range of bytes or (row, column) positions in which the query\n will be executed."]
     pub fn ts_query_cursor_set_byte_range(
@@ -660,10 +1109,68 @@ extern "C" {
         capture_index: *mut u32,
     ) -> bool;
 }
+extern "C" {
+    #[doc = " Like [`ts_query_cursor_next_match`], but also write the index of the query\n that the match belongs to, within the queries that were passed to\n [`ts_query_cursor_exec_queries`], to `*query_index`."]
+    pub fn ts_query_cursor_next_query_match(
+        self_: *mut TSQueryCursor,
+        match_: *mut TSQueryMatch,
+        query_index: *mut u32,
+    ) -> bool;
+}
+extern "C" {
+    #[doc = " Like [`ts_query_cursor_next_capture`], but also write the index of the query\n that the capture's match belongs to, within the queries that were passed to\n [`ts_query_cursor_exec_queries`], to `*query_index`."]
+    pub fn ts_query_cursor_next_query_capture(
+        self_: *mut TSQueryCursor,
+        match_: *mut TSQueryMatch,
+        capture_index: *mut u32,
+        query_index: *mut u32,
+    ) -> bool;
+}
 extern "C" {
     #[doc = " Set the maximum start depth for a query cursor.\n\n This prevents cursors from exploring children nodes at a certain depth.\n Note if a pattern includes many children, then they will still be checked.\n\n The zero max start depth value can be used as a special behavior and\n it helps to destructure a subtree by staying on a node and using captures\n for interested parts. Note that the zero max start depth only limit a search\n depth for a pattern's root node but other nodes that are parts of the pattern\n may be searched at any depth what defined by the pattern structure.\n\n Set to `UINT32_MAX` to remove the maximum start depth."]
     pub fn ts_query_cursor_set_max_start_depth(self_: *mut TSQueryCursor, max_start_depth: u32);
 }
+extern "C" {
+    #[doc = " Set the text provider that a query cursor uses to evaluate the text\n predicates of its queries.\n\n When a text provider is set, the cursor checks the `#eq?`, `#match?` and\n `#any-of?` predicates (along with their `not-` and `any-` variants) itself,\n and never returns matches that fail them. The provider's `text` function\n must return the text of the given node and write its length to `*length`.\n The returned text only needs to remain valid until the provider is called\n again. Other predicates are left for the caller to evaluate.\n\n Pass a provider whose `text` function is `NULL` to turn this off."]
+    pub fn ts_query_cursor_set_text_provider(
+        self_: *mut TSQueryCursor,
+        provider: TSQueryTextProvider,
+    );
+}
+extern "C" {
+    #[doc = " Set the regex engine that a query cursor uses to evaluate `#match?`\n predicates.\n\n The engine's `compile` function returns a compiled regex, or `NULL` if the\n pattern is invalid. A predicate whose pattern can't be compiled is never\n satisfied, whether it is `#match?`, `#not-match?` or one of their `any-`\n variants, so the cursor doesn't return the matches that contain it.\n Compiled regexes, and failures to compile them, are cached by the cursor\n until it is deleted or a different engine is set, at which point the\n compiled regexes are passed to `destroy`. Without an engine, `#match?`\n predicates are always satisfied."]
+    pub fn ts_query_cursor_set_regex_engine(self_: *mut TSQueryCursor, engine: TSQueryRegexEngine);
+}
+extern "C" {
+    #[doc = " Create a new query session, which keeps the matches of a query in a\n document up to date as the document is edited.\n\n Rather than re-running the query over the whole document after each edit,\n a session only recomputes the matches that the edit could have affected,\n and keeps the rest. Matches are stored as the ranges of their captures, so\n that they remain valid after the tree that produced them is deleted.\n Matches that have no captures are not stored.\n\n The query must not be deleted while the session exists."]
+    pub fn ts_query_session_new(query: *const TSQuery) -> *mut TSQuerySession;
+}
+extern "C" {
+    #[doc = " Delete a query session, freeing all of the memory that it used."]
+    pub fn ts_query_session_delete(self_: *mut TSQuerySession);
+}
+extern "C" {
+    #[doc = " Edit the session's matches to keep them in sync with source code that has\n been edited. This must be called with the same edits that are applied to\n the old syntax tree using [`ts_tree_edit`]."]
+    pub fn ts_query_session_edit(self_: *mut TSQuerySession, edit: *const TSInputEdit);
+}
+extern "C" {
+    #[doc = " Bring the session's matches up to date with a new syntax tree.\n\n The first time that this is called, the query is run over the entire given\n node. After that, the `changed_ranges` should be those returned by\n [`ts_tree_get_changed_ranges`] for the old and new trees. The session\n discards every match that extends into a changed range or an edited range,\n and runs the query again around those ranges to replace them. For\n non-local patterns (see [`ts_query_is_pattern_non_local`]), the affected\n area is widened to include the parent of the nodes where they match.\n\n The session uses the given cursor to run the query, so the cursor's match\n limit, text provider and regex engine all apply. The cursor's byte range is\n overwritten. Returns the number of matches that were recomputed."]
+    pub fn ts_query_session_update(
+        self_: *mut TSQuerySession,
+        cursor: *mut TSQueryCursor,
+        node: TSNode,
+        changed_ranges: *const TSRange,
+        changed_range_count: u32,
+    ) -> u32;
+}
+extern "C" {
+    #[doc = " Get the number of matches that the session currently has."]
+    pub fn ts_query_session_match_count(self_: *const TSQuerySession) -> u32;
+}
+extern "C" {
+    #[doc = " Get one of the session's matches. Matches are ordered by the position of\n their earliest capture. The match's captures remain valid until the next\n call to [`ts_query_session_update`] or [`ts_query_session_edit`]."]
+    pub fn ts_query_session_match(self_: *const TSQuerySession, index: u32) -> TSQuerySessionMatch;
+}
 extern "C" {
     #[doc = " Get another reference to the given language."]
     pub fn ts_language_copy(self_: *const TSLanguage) -> *const TSLanguage;
@@ -775,6 +1282,97 @@ extern "C" {
         self_: *const TSLookaheadIterator,
     ) -> *const ::std::os::raw::c_char;
 }
+extern "C" {
+    #[doc = " Create a new lookahead table for the given language.\n\n A lookahead table caches the set of symbols that are valid in each parse\n state of a language, as a bitset that is built the first time the state is\n used. This makes it cheap to combine the valid symbols of many states, for\n example to generate completion candidates, without iterating over each\n state's symbols with a [`TSLookaheadIterator`]. Each set contains the same\n symbols that a lookahead iterator would produce for its state.\n\n A lookahead table can be used from multiple threads at once."]
+    pub fn ts_lookahead_table_new(language: *const TSLanguage) -> *mut TSLookaheadTable;
+}
+extern "C" {
+    #[doc = " Delete a lookahead table, freeing all of the memory that it used."]
+    pub fn ts_lookahead_table_delete(self_: *mut TSLookaheadTable);
+}
+extern "C" {
+    #[doc = " Get the language of the lookahead table."]
+    pub fn ts_lookahead_table_language(self_: *const TSLookaheadTable) -> *const TSLanguage;
+}
+extern "C" {
+    #[doc = " Store the symbols that are valid in any of the given parse states in\n `result`, replacing its previous contents.\n\n This returns `false` and leaves `result` unchanged if any of the states is\n invalid for the table's language, or if `result` was created for a different\n language."]
+    pub fn ts_lookahead_table_union(
+        self_: *mut TSLookaheadTable,
+        states: *const TSStateId,
+        state_count: u32,
+        result: *mut TSSymbolSet,
+    ) -> bool;
+}
+extern "C" {
+    #[doc = " Store the symbols that are valid in all of the given parse states in\n `result`, replacing its previous contents. If no states are given, `result`\n is emptied.\n\n This returns `false` in the same cases as [`ts_lookahead_table_union`]."]
+    pub fn ts_lookahead_table_intersection(
+        self_: *mut TSLookaheadTable,
+        states: *const TSStateId,
+        state_count: u32,
+        result: *mut TSSymbolSet,
+    ) -> bool;
+}
+extern "C" {
+    #[doc = " Create a new, empty set of symbols for the given language."]
+    pub fn ts_symbol_set_new(language: *const TSLanguage) -> *mut TSSymbolSet;
+}
+extern "C" {
+    #[doc = " Delete a symbol set, freeing all of the memory that it used."]
+    pub fn ts_symbol_set_delete(self_: *mut TSSymbolSet);
+}
+extern "C" {
+    #[doc = " Check if a symbol set contains the given symbol."]
+    pub fn ts_symbol_set_contains(self_: *const TSSymbolSet, symbol: TSSymbol) -> bool;
+}
+extern "C" {
+    #[doc = " Get the number of symbols in a symbol set."]
+    pub fn ts_symbol_set_count(self_: *const TSSymbolSet) -> u32;
+}
+extern "C" {
+    #[doc = " Get the smallest symbol in a symbol set that is greater than or equal to\n the given symbol, or `UINT16_MAX` if there is none. To visit every symbol in\n the set, start from zero, and then continue from one past each result."]
+    pub fn ts_symbol_set_next(self_: *const TSSymbolSet, symbol: TSSymbol) -> TSSymbol;
+}
+extern "C" {
+    #[doc = " Create a new line index for the given text.\n\n A line index records the byte offset at which each line of a document\n begins, so that byte offsets and [`TSPoint`] positions can be converted into\n each other in logarithmic time, rather than by rescanning the text. As in\n the rest of the library, rows are separated by `\\n` characters and columns\n are measured in bytes."]
+    pub fn ts_line_index_new(
+        string: *const ::std::os::raw::c_char,
+        length: u32,
+    ) -> *mut TSLineIndex;
+}
+extern "C" {
+    #[doc = " Delete the line index, freeing all of the memory that it used."]
+    pub fn ts_line_index_delete(self_: *mut TSLineIndex);
+}
+extern "C" {
+    #[doc = " Update the line index to reflect an edit to its text.\n\n The `string` and `length` arguments must give the entire text after the\n edit. Only the newly inserted text is scanned, though updating the offsets\n of the lines after the edit still takes time proportional to their number."]
+    pub fn ts_line_index_edit(
+        self_: *mut TSLineIndex,
+        edit: *const TSInputEdit,
+        string: *const ::std::os::raw::c_char,
+        length: u32,
+    );
+}
+extern "C" {
+    #[doc = " Get the number of lines in the text. Text that doesn't contain any newlines\n has one line."]
+    pub fn ts_line_index_line_count(self_: *const TSLineIndex) -> u32;
+}
+extern "C" {
+    #[doc = " Get the range of bytes occupied by the given line, not including its\n trailing newline.\n\n Returns `false` if the text does not have that many lines."]
+    pub fn ts_line_index_line_range(
+        self_: *const TSLineIndex,
+        row: u32,
+        start_byte: *mut u32,
+        end_byte: *mut u32,
+    ) -> bool;
+}
+extern "C" {
+    #[doc = " Get the position of the given byte offset. Offsets past the end of the text\n are treated as the end of the text."]
+    pub fn ts_line_index_point_for_byte(self_: *const TSLineIndex, byte: u32) -> TSPoint;
+}
+extern "C" {
+    #[doc = " Get the byte offset of the given position. Columns past the end of their line\n are treated as the end of the line, and rows past the end of the text as the\n end of the text."]
+    pub fn ts_line_index_byte_for_point(self_: *const TSLineIndex, point: TSPoint) -> u32;
+}
 #[repr(C)]
 #[derive(Debug, Copy, Clone)]
 pub struct wasm_engine_t {
@@ -786,6 +1384,11 @@ pub type TSWasmEngine = wasm_engine_t;
 pub struct TSWasmStore {
     _unused: [u8; 0],
 }
+#[repr(C)]
+#[derive(Debug, Copy, Clone)]
+pub struct TSWasmStorePool {
+    _unused: [u8; 0],
+}
 pub const TSWasmErrorKindNone: TSWasmErrorKind = 0;
 pub const TSWasmErrorKindParse: TSWasmErrorKind = 1;
 pub const TSWasmErrorKindCompile: TSWasmErrorKind = 2;
@@ -823,6 +1426,29 @@ extern "C" {
     #[doc = " Get the number of languages instantiated in the given wasm store."]
     pub fn ts_wasm_store_language_count(arg1: *const TSWasmStore) -> usize;
 }
+extern "C" {
+    #[doc = " Create a pool of Wasm stores that share the given engine.\n\n Creating a Wasm store is expensive: it compiles and instantiates the Wasm\n stdlib, and every language must then be instantiated separately in each\n store that uses it. The stores that belong to a pool share one compiled\n copy of the stdlib. Released stores are kept in the pool, along with the\n languages that have been instantiated in them, so that a parser can acquire\n a store that is ready to use. At most `max_store_count` idle stores are kept.\n\n The pool takes ownership of the engine. Unlike most Tree-sitter objects,\n a store pool can be used from multiple threads at once, but each of its\n stores can still only be used by one parser at a time."]
+    pub fn ts_wasm_store_pool_new(
+        engine: *mut TSWasmEngine,
+        max_store_count: u32,
+        error: *mut TSWasmError,
+    ) -> *mut TSWasmStorePool;
+}
+extern "C" {
+    #[doc = " Delete the store pool, along with all of its idle stores. Stores that are\n still in use keep the pool's shared resources alive until they are deleted,\n but they can't be released back into the pool."]
+    pub fn ts_wasm_store_pool_delete(arg1: *mut TSWasmStorePool);
+}
+extern "C" {
+    #[doc = " Take an idle store from the pool, or create a new one if the pool has no\n idle stores. Returns `NULL` if a new store can't be created."]
+    pub fn ts_wasm_store_pool_acquire(
+        arg1: *mut TSWasmStorePool,
+        error: *mut TSWasmError,
+    ) -> *mut TSWasmStore;
+}
+extern "C" {
+    #[doc = " Return a store to the pool that it was acquired from, or delete it if the\n pool is full or if the store came from somewhere else. The store must not be\n assigned to a parser."]
+    pub fn ts_wasm_store_pool_release(arg1: *mut TSWasmStorePool, arg2: *mut TSWasmStore);
+}
 extern "C" {
     #[doc = " Check if the language came from a Wasm module. If so, then in order to use\n this language with a Parser, that parser must have a Wasm store assigned."]
     pub fn ts_language_is_wasm(arg1: *const TSLanguage) -> bool;
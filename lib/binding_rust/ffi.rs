@@ -16,6 +16,7 @@ extern "C" {
 #[cfg(windows)]
 extern "C" {
     pub(crate) fn _ts_dup(handle: *mut std::os::raw::c_void) -> std::os::raw::c_int;
+    pub(crate) fn _close(fd: std::os::raw::c_int) -> std::os::raw::c_int;
 }
 
 use crate::{
@@ -9,6 +9,7 @@ use std::os::unix::io::AsRawFd;
 use std::os::windows::io::AsRawHandle;
 
 use std::{
+    any::Any,
     char, error,
     ffi::CStr,
     fmt::{self, Write},
@@ -18,10 +19,14 @@ use std::{
     num::NonZeroU16,
     ops::{self, Deref},
     os::raw::{c_char, c_void},
+    panic::{self, AssertUnwindSafe},
     ptr::{self, NonNull},
     slice, str,
-    sync::atomic::AtomicUsize,
-    u16,
+    sync::{
+        atomic::{AtomicUsize, Ordering},
+        Mutex,
+    },
+    thread, u16,
 };
 
 #[cfg(feature = "wasm")]
@@ -61,6 +66,14 @@ pub struct LanguageRef<'a>(*const ffi::TSLanguage, PhantomData<&'a ()>);
 #[doc(alias = "TSTree")]
 pub struct Tree(NonNull<ffi::TSTree>);
 
+/// A flattened, read-only snapshot of a [`Tree`], as returned by [`Tree::flatten`].
+///
+/// The tree's visible nodes are stored in pre-order, as parallel arrays that are
+/// indexed by node, so that passes over the whole tree can read them sequentially.
+/// The root node is at index zero.
+#[doc(alias = "TSFlatTree")]
+pub struct FlatTree(NonNull<ffi::TSFlatTree>);
+
 /// A position in a multi-line text document, in terms of rows and columns.
 ///
 /// Rows and columns are zero-based.
@@ -70,6 +83,71 @@ pub struct Point {
     pub column: usize,
 }
 
+/// Counters describing the work that a [`Parser`] performed during a parse,
+/// as returned by [`Parser::stats`].
+#[derive(Clone, Copy, Debug, Default, PartialEq, Eq)]
+pub struct ParseStats {
+    pub lex_count: usize,
+    pub external_scan_count: usize,
+    pub lexed_byte_count: u64,
+    pub shift_count: usize,
+    pub reduce_count: usize,
+    pub reused_node_count: usize,
+    pub reused_byte_count: u64,
+    pub token_cache_hit_count: usize,
+    pub token_cache_miss_count: usize,
+    pub version_split_count: usize,
+    pub version_merge_count: usize,
+    pub version_limit_prune_count: usize,
+    pub version_cost_prune_count: usize,
+    pub max_version_count: usize,
+    pub error_recovery_micros: u64,
+}
+
+/// A summary of the syntax errors in a document, as returned by
+/// [`Parser::check`].
+#[doc(alias = "TSSyntaxCheck")]
+#[derive(Clone, Copy, Debug, PartialEq, Eq)]
+pub struct SyntaxCheck {
+    /// The number of `ERROR` nodes that a full parse would contain.
+    pub error_count: usize,
+    /// The number of `MISSING` nodes that a full parse would contain.
+    pub missing_count: usize,
+    /// The range of the first `ERROR` or `MISSING` node, if there is one.
+    pub first_error: Option<Range>,
+}
+
+impl SyntaxCheck {
+    /// Check if the document has any syntax errors.
+    #[must_use]
+    pub const fn has_error(&self) -> bool {
+        self.error_count > 0 || self.missing_count > 0
+    }
+}
+
+/// The strategy that a [`Parser`] uses to choose which versions of its parse
+/// stack to discard when there are too many of them.
+#[doc(alias = "TSVersionPruningStrategy")]
+#[derive(Clone, Copy, Debug, Default, PartialEq, Eq)]
+pub enum VersionPruningStrategy {
+    /// Rank the versions by their error costs and keep the best ones.
+    #[default]
+    KeepBest,
+    /// Never exceed the limit, and discard the most recently created versions
+    /// first.
+    DropNewest,
+}
+
+/// Limits on the number of versions of the parse stack that a [`Parser`]
+/// explores at once, as set by [`Parser::set_version_policy`].
+#[doc(alias = "TSVersionPolicy")]
+#[derive(Clone, Copy, Debug, PartialEq, Eq)]
+pub struct VersionPolicy {
+    pub max_version_count: u32,
+    pub max_cost_difference: u32,
+    pub strategy: VersionPruningStrategy,
+}
+
 /// A range of positions in a multi-line text document, both in terms of bytes and of
 /// rows and columns.
 #[derive(Clone, Copy, Debug, PartialEq, Eq, Hash)]
@@ -91,6 +169,21 @@ pub struct InputEdit {
     pub new_end_position: Point,
 }
 
+/// A change between two syntax trees, as returned by [`Tree::diff`].
+#[doc(alias = "TSDiffChange")]
+#[derive(Clone, Copy, Debug, PartialEq, Eq)]
+pub enum DiffChange<'tree> {
+    /// A node of the new tree that has no counterpart in the old tree. Its
+    /// descendants are inserted too, unless they are reported as moved.
+    Insert(Node<'tree>),
+    /// A node of the old tree that has no counterpart in the new tree. Its
+    /// descendants are deleted too, unless they are reported as moved.
+    Delete(Node<'tree>),
+    /// A node of the old tree that became a node of the new tree, but that
+    /// either has a different parent, or was reordered among its siblings.
+    Move { old: Node<'tree>, new: Node<'tree> },
+}
+
 /// A single node within a syntax [`Tree`].
 #[doc(alias = "TSNode")]
 #[derive(Clone, Copy)]
@@ -101,11 +194,46 @@ pub struct Node<'tree>(ffi::TSNode, PhantomData<&'tree ()>);
 #[doc(alias = "TSParser")]
 pub struct Parser(NonNull<ffi::TSParser>);
 
+/// A pool of [`Parser`]s for a single language, which recycles parsers so that
+/// the memory that they allocate while parsing is reused by later parses.
+#[doc(alias = "TSParserPool")]
+pub struct ParserPool(NonNull<ffi::TSParserPool>);
+
+/// A queue of [`Tree`]s that are freed incrementally, so that deleting a large
+/// tree does not cause a long pause on the thread that is done with it.
+#[doc(alias = "TSTreeReclaimer")]
+pub struct TreeReclaimer {
+    ptr: NonNull<ffi::TSTreeReclaimer>,
+    step_lock: Mutex<()>,
+}
+
+/// A table of the byte offsets at which the lines of a document begin, for
+/// converting between byte offsets and [`Point`]s without rescanning the text.
+#[doc(alias = "TSLineIndex")]
+pub struct LineIndex(NonNull<ffi::TSLineIndex>);
+
+/// A unit of work for [`Parser::parse_batch`]: a language, and the ranges of the
+/// document that should be parsed with it.
+#[derive(Clone, Copy, Debug)]
+pub struct ParseJob<'a> {
+    pub language: &'a Language,
+    pub ranges: &'a [Range],
+}
+
 /// A stateful object that is used to look up symbols valid in a specific parse state
 #[doc(alias = "TSLookaheadIterator")]
 pub struct LookaheadIterator(NonNull<ffi::TSLookaheadIterator>);
 struct LookaheadNamesIterator<'a>(&'a mut LookaheadIterator);
 
+/// A cache of the symbols that are valid in each parse state of a language,
+/// which can be combined across many states at once.
+#[doc(alias = "TSLookaheadTable")]
+pub struct LookaheadTable(NonNull<ffi::TSLookaheadTable>);
+
+/// A set of symbols from a particular language.
+#[doc(alias = "TSSymbolSet")]
+pub struct SymbolSet(NonNull<ffi::TSSymbolSet>);
+
 /// A type of log message.
 #[derive(Debug, PartialEq, Eq)]
 pub enum LogType {
@@ -113,11 +241,23 @@ pub enum LogType {
     Lex,
 }
 
+/// A format in which a syntax tree can be written by [`Node::write_string`].
+#[derive(Clone, Copy, Debug, PartialEq, Eq)]
+pub enum NodeStringFormat {
+    /// The S-expression that is returned by [`Node::to_sexp`].
+    SExpression,
+    /// A JSON object for each visible node, with its type, field, ranges and
+    /// flags, and the visible nodes below it in its `children` array.
+    Json,
+}
+
 type FieldId = NonZeroU16;
 
 /// A callback that receives log messages during parser.
 type Logger<'a> = Box<dyn FnMut(LogType, &str) + 'a>;
 
+type StreamCallback<'a> = Box<dyn FnMut(Node) + 'a>;
+
 /// A stateful object for walking a syntax [`Tree`] efficiently.
 #[doc(alias = "TSTreeCursor")]
 pub struct TreeCursor<'cursor>(ffi::TSTreeCursor, PhantomData<&'cursor ()>);
@@ -130,7 +270,6 @@ pub struct Query {
     ptr: NonNull<ffi::TSQuery>,
     capture_names: Box<[&'static str]>,
     capture_quantifiers: Box<[Box<[CaptureQuantifier]>]>,
-    text_predicates: Box<[Box<[TextPredicateCapture]>]>,
     property_settings: Box<[Box<[QueryProperty]>]>,
     property_predicates: Box<[Box<[(QueryProperty, bool)]>]>,
     general_predicates: Box<[Box<[QueryPredicate]>]>,
@@ -186,6 +325,25 @@ pub struct QueryPredicate {
     pub args: Box<[QueryPredicateArg]>,
 }
 
+/// Statistics that a [`QueryCursor`] has collected about one of the patterns in
+/// the query that it is executing.
+///
+/// See [`QueryCursor::set_pattern_stats_enabled`].
+#[derive(Clone, Copy, Debug, Default, PartialEq, Eq)]
+#[doc(alias = "TSQueryPatternStats")]
+pub struct QueryPatternStats {
+    /// The number of in-progress matches that were started for the pattern.
+    pub started_state_count: usize,
+    /// The number of in-progress matches that were created by copying another
+    /// one, because a part of the pattern could match in more than one way.
+    pub copied_state_count: usize,
+    /// The number of in-progress matches that were dropped because the cursor's
+    /// match limit was exceeded.
+    pub dropped_state_count: usize,
+    /// The number of capture lists that were acquired for the pattern's matches.
+    pub capture_list_count: usize,
+}
+
 /// A match of a [`Query`] to a particular set of [`Node`]s.
 pub struct QueryMatch<'cursor, 'tree> {
     pub pattern_index: usize,
@@ -197,21 +355,58 @@ pub struct QueryMatch<'cursor, 'tree> {
 /// A sequence of [`QueryMatch`]es associated with a given [`QueryCursor`].
 pub struct QueryMatches<'query, 'cursor, T: TextProvider<I>, I: AsRef<[u8]>> {
     ptr: *mut ffi::TSQueryCursor,
-    query: &'query Query,
     text_provider: T,
-    buffer1: Vec<u8>,
-    buffer2: Vec<u8>,
-    _phantom: PhantomData<(&'cursor (), I)>,
+    buffer: Vec<u8>,
+    _phantom: PhantomData<(&'query Query, &'cursor (), I)>,
 }
 
 /// A sequence of [`QueryCapture`]s associated with a given [`QueryCursor`].
 pub struct QueryCaptures<'query, 'cursor, T: TextProvider<I>, I: AsRef<[u8]>> {
     ptr: *mut ffi::TSQueryCursor,
-    query: &'query Query,
     text_provider: T,
-    buffer1: Vec<u8>,
-    buffer2: Vec<u8>,
-    _phantom: PhantomData<(&'cursor (), I)>,
+    buffer: Vec<u8>,
+    _phantom: PhantomData<(&'query Query, &'cursor (), I)>,
+}
+
+/// A sequence of [`QueryMatch`]es from several queries that are executed together,
+/// each paired with the index of the query that it belongs to.
+pub struct QueryMultiMatches<'query, 'cursor, T: TextProvider<I>, I: AsRef<[u8]>> {
+    ptr: *mut ffi::TSQueryCursor,
+    text_provider: T,
+    buffer: Vec<u8>,
+    _phantom: PhantomData<(&'query Query, &'cursor (), I)>,
+}
+
+/// A sequence of [`QueryCapture`]s from several queries that are executed together,
+/// each paired with the index of the query that its match belongs to.
+pub struct QueryMultiCaptures<'query, 'cursor, T: TextProvider<I>, I: AsRef<[u8]>> {
+    ptr: *mut ffi::TSQueryCursor,
+    text_provider: T,
+    buffer: Vec<u8>,
+    _phantom: PhantomData<(&'query Query, &'cursor (), I)>,
+}
+
+/// A set of [`Query`] matches in a document, which is kept up to date as the
+/// document is edited by recomputing only the matches that each edit affects.
+#[doc(alias = "TSQuerySession")]
+pub struct QuerySession<'query> {
+    ptr: NonNull<ffi::TSQuerySession>,
+    _phantom: PhantomData<&'query Query>,
+}
+
+/// A match that is stored in a [`QuerySession`].
+#[derive(Clone, Copy)]
+pub struct QuerySessionMatch<'session> {
+    pub pattern_index: usize,
+    captures: &'session [ffi::TSQuerySessionCapture],
+}
+
+/// A match of a [`Query`] that owns its captures, as returned by
+/// [`Query::parallel_matches`].
+#[derive(Clone, Debug)]
+pub struct OwnedQueryMatch<'tree> {
+    pub pattern_index: usize,
+    pub captures: Vec<QueryCapture<'tree>>,
 }
 
 pub trait TextProvider<I>
@@ -261,19 +456,6 @@ pub enum QueryErrorKind {
     Language,
 }
 
-#[derive(Debug)]
-/// The first item is the capture index
-/// The next is capture specific, depending on what item is expected
-/// The first bool is if the capture is positive
-/// The last item is a bool signifying whether or not it's meant to match
-/// any or all captures
-enum TextPredicateCapture {
-    EqString(u32, Box<str>, bool, bool),
-    EqCapture(u32, u32, bool, bool),
-    MatchString(u32, regex::bytes::Regex, bool, bool),
-    AnyString(u32, Box<[Box<str>]>, bool),
-}
-
 // TODO: Remove this struct at at some point. If `core::str::lossy::Utf8Lossy`
 // is ever stabilized.
 pub struct LossyUtf8<'a> {
@@ -522,6 +704,44 @@ impl Parser {
         unsafe { ffi::ts_parser_set_logger(self.0.as_ptr(), c_logger) };
     }
 
+    /// Set a callback that receives the top-level nodes of the documents that
+    /// the parser parses, as soon as they are complete, so that they can be
+    /// freed during the parse. See [`ts_parser_set_stream_callback`] for the
+    /// grammars that this is suited to.
+    ///
+    /// The tree that is returned by the parse does not contain the nodes that
+    /// were streamed, and the nodes can only be used during the call.
+    ///
+    /// [`ts_parser_set_stream_callback`]: ffi::ts_parser_set_stream_callback
+    #[doc(alias = "ts_parser_set_stream_callback")]
+    pub fn set_stream_callback(&mut self, callback: Option<StreamCallback>) {
+        let prev_callback = unsafe { ffi::ts_parser_stream_callback(self.0.as_ptr()) };
+        if !prev_callback.payload.is_null() {
+            drop(unsafe { Box::from_raw(prev_callback.payload.cast::<StreamCallback>()) });
+        }
+
+        let c_callback = if let Some(callback) = callback {
+            unsafe extern "C" fn emit(payload: *mut c_void, c_node: ffi::TSNode) {
+                let callback = payload.cast::<StreamCallback>().as_mut().unwrap();
+                if let Some(node) = Node::new(c_node) {
+                    callback(node);
+                }
+            }
+
+            ffi::TSStreamCallback {
+                payload: Box::into_raw(Box::new(callback)).cast::<c_void>(),
+                emit: Some(emit),
+            }
+        } else {
+            ffi::TSStreamCallback {
+                payload: ptr::null_mut(),
+                emit: None,
+            }
+        };
+
+        unsafe { ffi::ts_parser_set_stream_callback(self.0.as_ptr(), c_callback) };
+    }
+
     /// Set the destination to which the parser should write debugging graphs
     /// during parsing. The graphs are formatted in the DOT language. You may want
     /// to pipe these graphs directly to a `dot(1)` process in order to generate
@@ -567,6 +787,7 @@ impl Parser {
     /// Returns a [`Tree`] if parsing succeeded, or `None` if:
     ///  * The parser has not yet had a language assigned with [`Parser::set_language`]
     ///  * The timeout set with [`Parser::set_timeout_micros`] expired
+    ///  * The operation limit set with [`Parser::set_operation_limit`] was reached
     ///  * The cancellation flag set with [`Parser::set_cancellation_flag`] was flipped
     #[doc(alias = "ts_parser_parse")]
     pub fn parse(&mut self, text: impl AsRef<[u8]>, old_tree: Option<&Tree>) -> Option<Tree> {
@@ -578,6 +799,29 @@ impl Parser {
         )
     }
 
+    /// Check the syntax of a slice of UTF8 text, without building a syntax tree.
+    ///
+    /// This counts the `ERROR` and `MISSING` nodes that [`parse`](Parser::parse)
+    /// would produce, using much less memory for grammars whose root rule is a
+    /// repetition. Whether there are any errors always agrees with `parse`, but
+    /// for some documents with errors, the counts can differ slightly. This
+    /// returns `None` in all of the cases where `parse` does, and the stream
+    /// callback is not called.
+    #[doc(alias = "ts_parser_check_string")]
+    pub fn check(&mut self, text: impl AsRef<[u8]>) -> Option<SyntaxCheck> {
+        let bytes = text.as_ref();
+        let mut result = MaybeUninit::<ffi::TSSyntaxCheck>::uninit();
+        let finished = unsafe {
+            ffi::ts_parser_check_string(
+                self.0.as_ptr(),
+                bytes.as_ptr().cast::<c_char>(),
+                bytes.len() as u32,
+                result.as_mut_ptr(),
+            )
+        };
+        finished.then(|| unsafe { result.assume_init() }.into())
+    }
+
     /// Parse a slice of UTF16 text.
     ///
     /// # Arguments:
@@ -705,11 +949,102 @@ impl Parser {
         }
     }
 
+    /// Parse UTF8 text provided in chunks by a callback, which may not have all
+    /// of the text available yet.
+    ///
+    /// This works like [`parse_with`](Parser::parse_with), except that the
+    /// callback can return `None` to indicate that the text at the given byte
+    /// offset is not available yet. In that case, parsing halts early and this
+    /// method returns `None`, and [`is_waiting_for_input`](Parser::is_waiting_for_input)
+    /// returns `true`. Once the text is available, call this method again with
+    /// the same arguments to resume parsing. The token that was being read is
+    /// lexed again from its start, so the callback must still be able to
+    /// provide all of the text that it has provided before.
+    #[doc(alias = "TS_INPUT_PENDING")]
+    pub fn parse_with_pending<T: AsRef<[u8]>, F: FnMut(usize, Point) -> Option<T>>(
+        &mut self,
+        callback: &mut F,
+        old_tree: Option<&Tree>,
+    ) -> Option<Tree> {
+        // See `parse_with` for a description of the payload.
+        let mut payload: (&mut F, Option<T>) = (callback, None);
+
+        unsafe extern "C" fn read<T: AsRef<[u8]>, F: FnMut(usize, Point) -> Option<T>>(
+            payload: *mut c_void,
+            byte_offset: u32,
+            position: ffi::TSPoint,
+            bytes_read: *mut u32,
+        ) -> *const c_char {
+            let (callback, text) = payload.cast::<(&mut F, Option<T>)>().as_mut().unwrap();
+            *text = callback(byte_offset as usize, position.into());
+            if let Some(text) = text.as_ref() {
+                let slice = text.as_ref();
+                *bytes_read = slice.len() as u32;
+                slice.as_ptr().cast::<c_char>()
+            } else {
+                *bytes_read = ffi::TS_INPUT_PENDING;
+                ptr::null()
+            }
+        }
+
+        let c_input = ffi::TSInput {
+            payload: std::ptr::addr_of_mut!(payload).cast::<c_void>(),
+            read: Some(read::<T, F>),
+            encoding: ffi::TSInputEncodingUTF8,
+        };
+
+        let c_old_tree = old_tree.map_or(ptr::null_mut(), |t| t.0.as_ptr());
+        unsafe {
+            let c_new_tree = ffi::ts_parser_parse(self.0.as_ptr(), c_old_tree, c_input);
+            NonNull::new(c_new_tree).map(Tree)
+        }
+    }
+
+    /// Parse the contents of a file containing UTF8 text.
+    ///
+    /// Instead of reading the file into a buffer, the file is mapped into memory
+    /// while it is being parsed. The file must not be modified during that time.
+    /// Returns `None` if the file can't be memory-mapped, in addition to all of
+    /// the reasons described for [`parse`](Parser::parse).
+    ///
+    /// # Arguments:
+    /// * `file` The file to parse.
+    /// * `old_tree` A previous syntax tree parsed from the same document.
+    ///   If the text of the document has changed since `old_tree` was
+    ///   created, then you must edit `old_tree` to match the new text using
+    ///   [`Tree::edit`].
+    #[doc(alias = "ts_parser_parse_file")]
+    pub fn parse_file(
+        &mut self,
+        #[cfg(not(windows))] file: &impl AsRawFd,
+        #[cfg(windows)] file: &impl AsRawHandle,
+        old_tree: Option<&Tree>,
+    ) -> Option<Tree> {
+        let c_old_tree = old_tree.map_or(ptr::null_mut(), |t| t.0.as_ptr());
+
+        #[cfg(not(windows))]
+        let c_new_tree =
+            unsafe { ffi::ts_parser_parse_file(self.0.as_ptr(), c_old_tree, file.as_raw_fd()) };
+
+        #[cfg(windows)]
+        let c_new_tree = unsafe {
+            let fd = ffi::_ts_dup(file.as_raw_handle());
+            if fd < 0 {
+                return None;
+            }
+            let tree = ffi::ts_parser_parse_file(self.0.as_ptr(), c_old_tree, fd);
+            ffi::_close(fd);
+            tree
+        };
+
+        NonNull::new(c_new_tree).map(Tree)
+    }
+
     /// Instruct the parser to start the next parse from the beginning.
     ///
-    /// If the parser previously failed because of a timeout or a cancellation, then by default, it
-    /// will resume where it left off on the next call to [`parse`](Parser::parse) or other parsing
-    /// functions. If you don't want to resume, and instead intend to use this parser to parse some
+    /// If the parser previously failed because of a timeout, an operation limit, or a cancellation,
+    /// then by default, it will resume where it left off on the next call to
+    /// [`parse`](Parser::parse) or other parsing functions. If you don't want to resume, and instead intend to use this parser to parse some
     /// other document, you must call `reset` first.
     #[doc(alias = "ts_parser_reset")]
     pub fn reset(&mut self) {
@@ -735,6 +1070,90 @@ impl Parser {
         unsafe { ffi::ts_parser_set_timeout_micros(self.0.as_ptr(), timeout_micros) }
     }
 
+    /// Get the maximum number of operations that each parse call is allowed to
+    /// perform.
+    ///
+    /// This is set via [`set_operation_limit`](Parser::set_operation_limit).
+    #[doc(alias = "ts_parser_operation_limit")]
+    #[must_use]
+    pub fn operation_limit(&self) -> u64 {
+        unsafe { ffi::ts_parser_operation_limit(self.0.as_ptr()) }
+    }
+
+    /// Set the maximum number of parse operations that each parse call should
+    /// be allowed to perform before halting.
+    ///
+    /// If parsing needs more operations than this, it will halt early, returning
+    /// `None`, and it can be resumed by calling the same parsing method again.
+    /// Unlike a timeout, this limit doesn't depend on the clock, so it can be used
+    /// to interleave the parsing of many documents in predictable slices. Passing
+    /// zero removes the limit. See [`parse`](Parser::parse) for more information.
+    #[doc(alias = "ts_parser_set_operation_limit")]
+    pub fn set_operation_limit(&mut self, operation_limit: u64) {
+        unsafe { ffi::ts_parser_set_operation_limit(self.0.as_ptr(), operation_limit) }
+    }
+
+    /// Check whether the most recent parse halted early because its input
+    /// did not have some text available yet.
+    ///
+    /// See [`parse_with_pending`](Parser::parse_with_pending) for more information.
+    #[doc(alias = "ts_parser_is_waiting_for_input")]
+    #[must_use]
+    pub fn is_waiting_for_input(&self) -> bool {
+        unsafe { ffi::ts_parser_is_waiting_for_input(self.0.as_ptr()) }
+    }
+
+    /// Get whether the parser allocates the trees that it produces in arenas.
+    #[doc(alias = "ts_parser_arena_enabled")]
+    #[must_use]
+    pub fn arena_enabled(&self) -> bool {
+        unsafe { ffi::ts_parser_arena_enabled(self.0.as_ptr()) }
+    }
+
+    /// Get counters describing the work that the parser performed during its
+    /// most recent parse.
+    ///
+    /// The counters are reset at the start of each parse, and accumulate across
+    /// calls that resume a parse which was halted early.
+    #[doc(alias = "ts_parser_stats")]
+    #[must_use]
+    pub fn stats(&self) -> ParseStats {
+        unsafe { ffi::ts_parser_stats(self.0.as_ptr()) }.into()
+    }
+
+    /// Set the limits on the number of versions of the parse stack that the
+    /// parser explores at once.
+    ///
+    /// Tightening these limits bounds the time spent parsing highly ambiguous
+    /// or badly broken input, at the cost of sometimes not finding the best
+    /// tree. See [`ts_parser_set_version_policy`] for details.
+    ///
+    /// [`ts_parser_set_version_policy`]: ffi::ts_parser_set_version_policy
+    #[doc(alias = "ts_parser_set_version_policy")]
+    pub fn set_version_policy(&mut self, policy: VersionPolicy) {
+        unsafe { ffi::ts_parser_set_version_policy(self.0.as_ptr(), policy.into()) }
+    }
+
+    /// Get the parser's current version policy.
+    #[doc(alias = "ts_parser_version_policy")]
+    #[must_use]
+    pub fn version_policy(&self) -> VersionPolicy {
+        unsafe { ffi::ts_parser_version_policy(self.0.as_ptr()) }.into()
+    }
+
+    /// Set whether the parser should allocate the nodes of the trees that it
+    /// produces out of large, shared memory chunks.
+    ///
+    /// In arena mode, dropping a [`Tree`] frees its memory in bulk instead of
+    /// visiting every node. The memory is only reclaimed once every tree that
+    /// shares the arenas has been dropped, and trees produced by reparsing an
+    /// arena-allocated tree keep the old tree's arenas alive, so this mode is
+    /// best suited to parsing many documents in bulk.
+    #[doc(alias = "ts_parser_set_arena_enabled")]
+    pub fn set_arena_enabled(&mut self, enabled: bool) {
+        unsafe { ffi::ts_parser_set_arena_enabled(self.0.as_ptr(), enabled) }
+    }
+
     /// Set the ranges of text that the parser should include when parsing.
     ///
     /// By default, the parser will always include entire documents. This function
@@ -831,16 +1250,335 @@ impl Parser {
             ffi::ts_parser_set_cancellation_flag(self.0.as_ptr(), ptr::null());
         }
     }
+
+    /// Set the tree reclaimer that the parser should use to free the old tree's
+    /// nodes after an incremental parse, instead of freeing them immediately.
+    ///
+    /// # Safety
+    ///
+    /// The reclaimer must outlive the parser, or be unset before it is dropped.
+    #[doc(alias = "ts_parser_set_tree_reclaimer")]
+    pub unsafe fn set_tree_reclaimer(&mut self, reclaimer: Option<&TreeReclaimer>) {
+        ffi::ts_parser_set_tree_reclaimer(
+            self.0.as_ptr(),
+            reclaimer.map_or(ptr::null_mut(), |reclaimer| reclaimer.ptr.as_ptr()),
+        );
+    }
+
+    /// Parse several independent sets of ranges of the same document concurrently.
+    ///
+    /// Each [`ParseJob`] is parsed from scratch with its own language and included
+    /// ranges, and its tree is returned at the same index as the job. The jobs are
+    /// distributed across the given `parsers`, each of which is driven by its own
+    /// thread, so the amount of parallelism is `parsers.len()`. The language and
+    /// included ranges of every parser that picks up a job are overwritten; any
+    /// logger, timeout or cancellation flag that is set on a parser still applies.
+    ///
+    /// A job's result is `None` if its language is incompatible, its ranges are
+    /// invalid, or its parse was halted.
+    ///
+    /// This is intended for injected languages, such as the `<script>` and `<style>`
+    /// elements of an HTML document, whose ranges do not depend on one another once
+    /// the outer document has been parsed.
+    #[must_use]
+    pub fn parse_batch(parsers: &mut [Self], text: &[u8], jobs: &[ParseJob]) -> Vec<Option<Tree>> {
+        Self::run_jobs(parsers, jobs.len(), |parser, i| {
+            let job = &jobs[i];
+            parser.set_language(job.language).ok()?;
+            parser.set_included_ranges(job.ranges).ok()?;
+            let tree = parser.parse(text, None);
+            parser.set_included_ranges(&[]).unwrap();
+            tree
+        })
+    }
+
+    /// Parse a large document using several threads.
+    ///
+    /// The text is split at the given byte offsets, and the pieces are parsed
+    /// from scratch by the given `parsers`, each of which is driven by its own
+    /// thread, as in [`Parser::parse_batch`]. The pieces' trees are combined using
+    /// [`Tree::concat`], and then this parser reparses the whole text, reusing all
+    /// of the nodes that don't touch a split point. The resulting tree is the same
+    /// as the one produced by [`Parser::parse`] without an old tree.
+    ///
+    /// Any split point is correct, but only split points where a top-level
+    /// construct of the grammar begins, such as the start of a line that begins a
+    /// statement, save work. The language and included ranges of every parser that
+    /// picks up a piece are overwritten.
+    ///
+    /// Returns `None` if this parser has no language, or if any parse was halted.
+    #[doc(alias = "ts_tree_concat")]
+    pub fn parse_parallel(
+        &mut self,
+        parsers: &mut [Self],
+        text: impl AsRef<[u8]>,
+        split_points: &[usize],
+    ) -> Option<Tree> {
+        let text = text.as_ref();
+        let language = self.language()?;
+        let mut boundaries = split_points
+            .iter()
+            .copied()
+            .filter(|offset| *offset > 0 && *offset < text.len())
+            .collect::<Vec<_>>();
+        boundaries.sort_unstable();
+        boundaries.dedup();
+        if boundaries.is_empty() || parsers.is_empty() {
+            return self.parse(text, None);
+        }
+        boundaries.insert(0, 0);
+        boundaries.push(text.len());
+
+        let pieces = Self::run_jobs(parsers, boundaries.len() - 1, |parser, i| {
+            parser.set_language(&language).ok()?;
+            parser.set_included_ranges(&[]).ok()?;
+            parser.parse(&text[boundaries[i]..boundaries[i + 1]], None)
+        })
+        .into_iter()
+        .collect::<Option<Vec<_>>>()?;
+        let old_tree = Tree::concat(&pieces)?;
+        drop(pieces);
+        self.parse(text, Some(&old_tree))
+    }
+
+    /// Run the jobs with the given indices on the given parsers, each of which is
+    /// driven by its own thread, and return their results in order.
+    fn run_jobs<T: Send>(
+        parsers: &mut [Self],
+        job_count: usize,
+        run: impl Fn(&mut Self, usize) -> Option<T> + Sync,
+    ) -> Vec<Option<T>> {
+        let mut results = iter::repeat_with(|| None)
+            .take(job_count)
+            .collect::<Vec<_>>();
+        if job_count == 0 || parsers.is_empty() {
+            return results;
+        }
+        if parsers.len() == 1 || job_count == 1 {
+            for (i, result) in results.iter_mut().enumerate() {
+                *result = run(&mut parsers[0], i);
+            }
+            return results;
+        }
+
+        let next_job = AtomicUsize::new(0);
+        let worker_count = parsers.len().min(job_count);
+        let finished = std::thread::scope(|scope| {
+            parsers[..worker_count]
+                .iter_mut()
+                .map(|parser| {
+                    let next_job = &next_job;
+                    let run = &run;
+                    scope.spawn(move || {
+                        let mut finished = Vec::new();
+                        loop {
+                            let i = next_job.fetch_add(1, Ordering::Relaxed);
+                            if i >= job_count {
+                                break;
+                            }
+                            finished.push((i, run(parser, i)));
+                        }
+                        finished
+                    })
+                })
+                .collect::<Vec<_>>()
+                .into_iter()
+                .flat_map(|handle| handle.join().unwrap())
+                .collect::<Vec<_>>()
+        });
+        for (i, result) in finished {
+            results[i] = result;
+        }
+        results
+    }
 }
 
 impl Drop for Parser {
     fn drop(&mut self) {
         self.stop_printing_dot_graphs();
         self.set_logger(None);
+        self.set_stream_callback(None);
         unsafe { ffi::ts_parser_delete(self.0.as_ptr()) }
     }
 }
 
+impl ParserPool {
+    /// Create a new pool of parsers for the given language.
+    ///
+    /// At most `max_parser_count` idle parsers are kept. When a parser that
+    /// is returned to the pool is keeping more than `max_retained_size` bytes
+    /// of working memory, that memory is freed first.
+    ///
+    /// Returns a [`LanguageError`] if the language was generated with an
+    /// incompatible version of the Tree-sitter CLI.
+    #[doc(alias = "ts_parser_pool_new")]
+    pub fn new(
+        language: &Language,
+        max_parser_count: u32,
+        max_retained_size: usize,
+    ) -> Result<Self, LanguageError> {
+        let ptr =
+            unsafe { ffi::ts_parser_pool_new(language.0, max_parser_count, max_retained_size) };
+        NonNull::new(ptr).map(Self).ok_or(LanguageError {
+            version: language.version(),
+        })
+    }
+
+    /// Take a parser from the pool, or create a new one if the pool has no
+    /// idle parsers. The parser's language is set to the pool's language.
+    #[doc(alias = "ts_parser_pool_acquire")]
+    #[must_use]
+    pub fn acquire(&mut self) -> Parser {
+        unsafe {
+            Parser(NonNull::new_unchecked(ffi::ts_parser_pool_acquire(
+                self.0.as_ptr(),
+            )))
+        }
+    }
+
+    /// Return a parser to the pool, or delete it if the pool is full.
+    ///
+    /// The parser is reset, and all of its settings are restored to their
+    /// defaults.
+    #[doc(alias = "ts_parser_pool_release")]
+    pub fn release(&mut self, mut parser: Parser) {
+        parser.stop_printing_dot_graphs();
+        parser.set_logger(None);
+        parser.set_stream_callback(None);
+        let ptr = parser.0.as_ptr();
+        std::mem::forget(parser);
+        unsafe { ffi::ts_parser_pool_release(self.0.as_ptr(), ptr) }
+    }
+}
+
+impl Drop for ParserPool {
+    fn drop(&mut self) {
+        unsafe { ffi::ts_parser_pool_delete(self.0.as_ptr()) }
+    }
+}
+
+impl TreeReclaimer {
+    /// Create a new, empty tree reclaimer.
+    #[doc(alias = "ts_tree_reclaimer_new")]
+    #[must_use]
+    pub fn new() -> Self {
+        Self {
+            ptr: unsafe { NonNull::new_unchecked(ffi::ts_tree_reclaimer_new()) },
+            step_lock: Mutex::new(()),
+        }
+    }
+
+    /// Hand a tree off to the reclaimer. This takes constant time, and can be
+    /// called from any thread, even while another thread is calling
+    /// [`step`](TreeReclaimer::step).
+    #[doc(alias = "ts_tree_reclaimer_add")]
+    pub fn add(&self, tree: Tree) {
+        let ptr = tree.0.as_ptr();
+        std::mem::forget(tree);
+        unsafe { ffi::ts_tree_reclaimer_add(self.ptr.as_ptr(), ptr) }
+    }
+
+    /// Free at most `max_node_count` of the nodes held by the reclaimer, in
+    /// the order that their trees were added.
+    ///
+    /// Returns `true` if the reclaimer still holds trees that have not been
+    /// freed.
+    #[doc(alias = "ts_tree_reclaimer_step")]
+    pub fn step(&self, max_node_count: u32) -> bool {
+        let _lock = self.step_lock.lock().unwrap_or_else(|e| e.into_inner());
+        unsafe { ffi::ts_tree_reclaimer_step(self.ptr.as_ptr(), max_node_count) }
+    }
+}
+
+impl Default for TreeReclaimer {
+    fn default() -> Self {
+        Self::new()
+    }
+}
+
+impl Drop for TreeReclaimer {
+    fn drop(&mut self) {
+        unsafe { ffi::ts_tree_reclaimer_delete(self.ptr.as_ptr()) }
+    }
+}
+
+impl LineIndex {
+    /// Create a line index for the given text.
+    #[doc(alias = "ts_line_index_new")]
+    #[must_use]
+    pub fn new(text: &[u8]) -> Self {
+        unsafe {
+            Self(NonNull::new_unchecked(ffi::ts_line_index_new(
+                text.as_ptr().cast::<c_char>(),
+                text.len() as u32,
+            )))
+        }
+    }
+
+    /// Update the line index to reflect an edit to its text. `text` must be the
+    /// entire text after the edit, but only the inserted text is scanned.
+    #[doc(alias = "ts_line_index_edit")]
+    pub fn edit(&mut self, edit: &InputEdit, text: &[u8]) {
+        let edit = edit.into();
+        unsafe {
+            ffi::ts_line_index_edit(
+                self.0.as_ptr(),
+                &edit,
+                text.as_ptr().cast::<c_char>(),
+                text.len() as u32,
+            );
+        }
+    }
+
+    /// Get the number of lines in the text.
+    #[doc(alias = "ts_line_index_line_count")]
+    #[must_use]
+    pub fn line_count(&self) -> usize {
+        unsafe { ffi::ts_line_index_line_count(self.0.as_ptr()) as usize }
+    }
+
+    /// Get the range of bytes occupied by the given line, not including its
+    /// trailing newline, or `None` if the text does not have that many lines.
+    #[doc(alias = "ts_line_index_line_range")]
+    #[must_use]
+    pub fn line_range(&self, row: usize) -> Option<ops::Range<usize>> {
+        let mut start_byte = 0;
+        let mut end_byte = 0;
+        unsafe {
+            ffi::ts_line_index_line_range(
+                self.0.as_ptr(),
+                row as u32,
+                &mut start_byte,
+                &mut end_byte,
+            )
+        }
+        .then_some(start_byte as usize..end_byte as usize)
+    }
+
+    /// Get the position of the given byte offset. Offsets past the end of the
+    /// text are treated as the end of the text.
+    #[doc(alias = "ts_line_index_point_for_byte")]
+    #[must_use]
+    pub fn point_for_byte(&self, byte: usize) -> Point {
+        unsafe { ffi::ts_line_index_point_for_byte(self.0.as_ptr(), byte as u32) }.into()
+    }
+
+    /// Get the byte offset of the given position. Columns past the end of their
+    /// line are treated as the end of the line, and rows past the end of the
+    /// text as the end of the text.
+    #[doc(alias = "ts_line_index_byte_for_point")]
+    #[must_use]
+    pub fn byte_for_point(&self, point: Point) -> usize {
+        unsafe { ffi::ts_line_index_byte_for_point(self.0.as_ptr(), point.into()) as usize }
+    }
+}
+
+impl Drop for LineIndex {
+    fn drop(&mut self) {
+        unsafe { ffi::ts_line_index_delete(self.0.as_ptr()) }
+    }
+}
+
 impl Tree {
     /// Get the root node of the syntax tree.
     #[doc(alias = "ts_tree_root_node")]
@@ -874,6 +1612,24 @@ impl Tree {
         )
     }
 
+    /// Combine trees that were parsed from consecutive pieces of a document into
+    /// a single tree, for use as the old tree when parsing the whole document.
+    ///
+    /// The final parse reuses the nodes of the pieces, reparsing only the text
+    /// around the boundaries between them. See [`Parser::parse_parallel`].
+    ///
+    /// Returns `None` if no trees are given or if their languages differ.
+    #[doc(alias = "ts_tree_concat")]
+    #[must_use]
+    pub fn concat(trees: &[Self]) -> Option<Self> {
+        let trees = trees
+            .iter()
+            .map(|tree| tree.0.as_ptr().cast_const())
+            .collect::<Vec<_>>();
+        let ptr = unsafe { ffi::ts_tree_concat(trees.as_ptr(), trees.len() as u32) };
+        NonNull::new(ptr).map(Self)
+    }
+
     /// Edit the syntax tree to keep it in sync with source code that has been
     /// edited.
     ///
@@ -885,6 +1641,37 @@ impl Tree {
         unsafe { ffi::ts_tree_edit(self.0.as_ptr(), &edit) };
     }
 
+    /// Edit the syntax tree to keep it in sync with source code that has been
+    /// edited in several places at once.
+    ///
+    /// The edits are applied in order, exactly as if [`Tree::edit`] had been
+    /// called with each of them, but the tree is only traversed once. Each edit
+    /// must be described in terms of the text that results from the edits
+    /// before it.
+    ///
+    /// Returns the smallest range of the edited text that contains all of the
+    /// inserted text, or `None` if there were no edits.
+    #[doc(alias = "ts_tree_edit_batch")]
+    pub fn edit_batch(&mut self, edits: &[InputEdit]) -> Option<Range> {
+        if edits.is_empty() {
+            return None;
+        }
+        let edits = edits
+            .iter()
+            .map(Into::into)
+            .collect::<Vec<ffi::TSInputEdit>>();
+        let mut changed_range = MaybeUninit::<ffi::TSRange>::uninit();
+        unsafe {
+            ffi::ts_tree_edit_batch(
+                self.0.as_ptr(),
+                edits.as_ptr(),
+                edits.len() as u32,
+                changed_range.as_mut_ptr(),
+            );
+            Some(changed_range.assume_init().into())
+        }
+    }
+
     /// Create a new [`TreeCursor`] starting from the root of the tree.
     #[must_use]
     pub fn walk(&self) -> TreeCursor {
@@ -912,6 +1699,85 @@ impl Tree {
         }
     }
 
+    /// Compare this old edited syntax tree to a new syntax tree, like
+    /// [`Tree::changed_ranges`], but write the changed ranges into the given
+    /// vector, replacing its previous contents.
+    ///
+    /// This avoids allocating a new buffer for each comparison when the vector
+    /// is reused between edits.
+    #[doc(alias = "ts_tree_get_changed_ranges_into")]
+    pub fn changed_ranges_into(&self, other: &Self, ranges: &mut Vec<Range>) {
+        const INLINE_CAPACITY: usize = 16;
+        let mut buffer = [MaybeUninit::<ffi::TSRange>::uninit(); INLINE_CAPACITY];
+        ranges.clear();
+        unsafe {
+            let count = ffi::ts_tree_get_changed_ranges_into(
+                self.0.as_ptr(),
+                other.0.as_ptr(),
+                buffer.as_mut_ptr().cast::<ffi::TSRange>(),
+                INLINE_CAPACITY as u32,
+            ) as usize;
+            if count <= INLINE_CAPACITY {
+                ranges.extend(buffer[..count].iter().map(|r| Range::from(r.assume_init())));
+            } else {
+                let mut buffer = Vec::<ffi::TSRange>::with_capacity(count);
+                ffi::ts_tree_get_changed_ranges_into(
+                    self.0.as_ptr(),
+                    other.0.as_ptr(),
+                    buffer.as_mut_ptr(),
+                    count as u32,
+                );
+                buffer.set_len(count);
+                ranges.extend(buffer.into_iter().map(Range::from));
+            }
+        }
+    }
+
+    /// Compare this syntax tree structurally to a newer syntax tree of the same
+    /// language, returning the nodes that were inserted, deleted, or moved.
+    ///
+    /// Unlike [`Tree::changed_ranges`], the trees don't need to be related by
+    /// edits: they can be parsed from any two versions of a document. Nodes are
+    /// compared by their types and by the text of their leaves, which is read
+    /// from the given source code, so differences in whitespace are ignored.
+    /// The deletions come first, in the order of this tree, followed by the
+    /// insertions and moves in the order of the new tree.
+    #[doc(alias = "ts_tree_diff")]
+    #[must_use]
+    pub fn diff<'tree>(
+        &'tree self,
+        source: &[u8],
+        new_tree: &'tree Self,
+        new_source: &[u8],
+    ) -> Vec<DiffChange<'tree>> {
+        let mut count = 0u32;
+        unsafe {
+            let ptr = ffi::ts_tree_diff(
+                self.0.as_ptr(),
+                source.as_ptr().cast::<c_char>(),
+                source.len() as u32,
+                new_tree.0.as_ptr(),
+                new_source.as_ptr().cast::<c_char>(),
+                new_source.len() as u32,
+                std::ptr::addr_of_mut!(count),
+            );
+            util::CBufferIter::new(ptr, count as usize)
+                .map(|change| match change.type_ {
+                    ffi::TSDiffChangeTypeInsert => {
+                        DiffChange::Insert(Node::new(change.new_node).unwrap())
+                    }
+                    ffi::TSDiffChangeTypeDelete => {
+                        DiffChange::Delete(Node::new(change.old_node).unwrap())
+                    }
+                    _ => DiffChange::Move {
+                        old: Node::new(change.old_node).unwrap(),
+                        new: Node::new(change.new_node).unwrap(),
+                    },
+                })
+                .collect()
+        }
+    }
+
     /// Get the included ranges that were used to parse the syntax tree.
     #[doc(alias = "ts_tree_included_ranges")]
     #[must_use]
@@ -930,6 +1796,124 @@ impl Tree {
         }
     }
 
+    /// Serialize the tree into a compact binary format, so that it can be stored
+    /// and later loaded with [`Tree::deserialize`] without re-parsing the source.
+    #[doc(alias = "ts_tree_serialize")]
+    #[must_use]
+    pub fn serialize(&self) -> Vec<u8> {
+        let mut length = 0u32;
+        unsafe {
+            let ptr = ffi::ts_tree_serialize(self.0.as_ptr(), std::ptr::addr_of_mut!(length));
+            let result = slice::from_raw_parts(ptr.cast::<u8>(), length as usize).to_vec();
+            (FREE_FN)(ptr.cast::<c_void>());
+            result
+        }
+    }
+
+    /// Load a tree that was serialized with [`Tree::serialize`].
+    ///
+    /// The language must be the one that the tree was originally parsed with.
+    /// Returns `None` if the data is malformed, or was produced by a different
+    /// language or an incompatible version of the library. The resulting tree
+    /// can be passed as the `old_tree` when reparsing.
+    ///
+    /// The tree's structure is validated as it is loaded, so navigating a tree
+    /// that was loaded from corrupted data is safe. Its positions and external
+    /// scanner states aren't checked, though, so data that didn't come from
+    /// [`Tree::serialize`] shouldn't be used as the `old_tree` for a language
+    /// with an external scanner.
+    #[doc(alias = "ts_tree_deserialize")]
+    #[must_use]
+    pub fn deserialize(data: &[u8], language: &Language) -> Option<Self> {
+        let length = u32::try_from(data.len()).ok()?;
+        unsafe {
+            let ptr = ffi::ts_tree_deserialize(language.0, data.as_ptr().cast::<c_char>(), length);
+            NonNull::new(ptr).map(Self)
+        }
+    }
+
+    /// Enable or disable the tree's parent index.
+    ///
+    /// When the parent index is enabled, the tree records the parent of every node
+    /// the first time it is needed, so that [`Node::parent`] and the sibling methods
+    /// run in constant time. The index is discarded by [`Tree::edit`] and rebuilt
+    /// lazily afterward, and it is shared with clones of the tree.
+    ///
+    /// The index also records the offsets of the children of nodes with 32 or more
+    /// children, so that methods like [`Node::descendant_for_byte_range`] and
+    /// [`TreeCursor::goto_first_child_for_byte`] can find the child at a given
+    /// position with a binary search. [`Node::child_by_field_id`] and
+    /// [`TreeCursor::goto_child_by_field_id`] use them to skip to the first child
+    /// that can have the field. When the index is disabled, these methods visit
+    /// each child in turn.
+    #[doc(alias = "ts_tree_set_parent_index_enabled")]
+    pub fn set_parent_index_enabled(&mut self, enabled: bool) {
+        unsafe { ffi::ts_tree_set_parent_index_enabled(self.0.as_ptr(), enabled) }
+    }
+
+    /// Check whether the tree's parent index is enabled.
+    #[doc(alias = "ts_tree_parent_index_enabled")]
+    #[must_use]
+    pub fn parent_index_enabled(&self) -> bool {
+        unsafe { ffi::ts_tree_parent_index_enabled(self.0.as_ptr()) }
+    }
+
+    /// Freeze the tree, so that many threads can read it at once.
+    ///
+    /// A shared reference to a tree can always be used from several threads, and
+    /// reading through it never updates a reference count the way cloning the
+    /// tree does. Freezing also builds everything that the tree would otherwise
+    /// build lazily when it is first read, such as its parent index, so that
+    /// threads reading through the returned reference never write to the tree.
+    #[doc(alias = "ts_tree_freeze")]
+    pub fn freeze(&mut self) -> &Self {
+        unsafe { ffi::ts_tree_freeze(self.0.as_ptr()) };
+        self
+    }
+
+    /// Create a flattened, read-only snapshot of the tree, for analyses that walk
+    /// the whole tree many times. The snapshot does not borrow the tree.
+    #[doc(alias = "ts_tree_flatten")]
+    #[must_use]
+    pub fn flatten(&self) -> FlatTree {
+        unsafe {
+            FlatTree(NonNull::new_unchecked(ffi::ts_tree_flatten(
+                self.0.as_ptr(),
+            )))
+        }
+    }
+
+    /// Get the number of bytes of memory used by the tree's nodes, including
+    /// nodes that it shares with other trees.
+    #[doc(alias = "ts_tree_memory_usage")]
+    #[must_use]
+    pub fn memory_usage(&self) -> usize {
+        unsafe { ffi::ts_tree_memory_usage(self.0.as_ptr()) }
+    }
+
+    /// Measure how much memory several trees have in common.
+    ///
+    /// Returns the number of bytes used by nodes that are reachable from more
+    /// than one of the trees, along with the number of bytes used by each tree
+    /// alone.
+    #[doc(alias = "ts_tree_shared_memory_usage")]
+    #[must_use]
+    pub fn shared_memory_usage(trees: &[&Self]) -> (usize, Vec<usize>) {
+        let ptrs = trees
+            .iter()
+            .map(|tree| tree.0.as_ptr().cast_const())
+            .collect::<Vec<_>>();
+        let mut unique_bytes = vec![0; trees.len()];
+        let shared_bytes = unsafe {
+            ffi::ts_tree_shared_memory_usage(
+                ptrs.as_ptr(),
+                ptrs.len() as u32,
+                unique_bytes.as_mut_ptr(),
+            )
+        };
+        (shared_bytes, unique_bytes)
+    }
+
     /// Print a graph of the tree to the given file descriptor.
     /// The graph is formatted in the DOT language. You may want to pipe this graph
     /// directly to a `dot(1)` process in order to generate SVG output.
@@ -959,6 +1943,92 @@ impl fmt::Debug for Tree {
     }
 }
 
+impl FlatTree {
+    const NONE: u32 = u32::MAX;
+
+    fn raw(&self) -> &ffi::TSFlatTree {
+        unsafe { self.0.as_ref() }
+    }
+
+    fn slice<T>(&self, ptr: *const T) -> &[T] {
+        unsafe { slice::from_raw_parts(ptr, self.len()) }
+    }
+
+    fn index(value: u32) -> Option<usize> {
+        (value != Self::NONE).then_some(value as usize)
+    }
+
+    /// Get the number of nodes in the snapshot.
+    #[must_use]
+    pub fn len(&self) -> usize {
+        self.raw().node_count as usize
+    }
+
+    /// Check whether the snapshot has no nodes.
+    #[must_use]
+    pub fn is_empty(&self) -> bool {
+        self.len() == 0
+    }
+
+    /// Get the symbol of each node, reflecting any aliases.
+    #[must_use]
+    pub fn symbols(&self) -> &[u16] {
+        self.slice(self.raw().symbols)
+    }
+
+    /// Get the byte offset where each node starts.
+    #[must_use]
+    pub fn start_bytes(&self) -> &[u32] {
+        self.slice(self.raw().start_bytes)
+    }
+
+    /// Get the byte offset where each node ends.
+    #[must_use]
+    pub fn end_bytes(&self) -> &[u32] {
+        self.slice(self.raw().end_bytes)
+    }
+
+    /// Get the id of the field that each node is associated with in its parent,
+    /// or zero if it has none.
+    #[must_use]
+    pub fn field_ids(&self) -> &[u16] {
+        self.slice(self.raw().field_ids)
+    }
+
+    /// Get the row and column where the given node starts.
+    #[must_use]
+    pub fn start_position(&self, index: usize) -> Point {
+        self.slice(self.raw().start_points)[index].into()
+    }
+
+    /// Get the index of the given node's parent.
+    #[must_use]
+    pub fn parent(&self, index: usize) -> Option<usize> {
+        Self::index(self.slice(self.raw().parent_indices)[index])
+    }
+
+    /// Get the index of the given node's first child.
+    #[must_use]
+    pub fn first_child(&self, index: usize) -> Option<usize> {
+        Self::index(self.slice(self.raw().first_child_indices)[index])
+    }
+
+    /// Get the index of the given node's next sibling.
+    #[must_use]
+    pub fn next_sibling(&self, index: usize) -> Option<usize> {
+        Self::index(self.slice(self.raw().next_sibling_indices)[index])
+    }
+}
+
+impl Drop for FlatTree {
+    fn drop(&mut self) {
+        unsafe { ffi::ts_flat_tree_delete(self.0.as_ptr()) }
+    }
+}
+
+unsafe impl Send for FlatTree {}
+unsafe impl Sync for FlatTree {}
+
 impl Drop for Tree {
     fn drop(&mut self) {
         unsafe { ffi::ts_tree_delete(self.0.as_ptr()) }
@@ -1414,6 +2484,46 @@ impl<'tree> Node<'tree> {
         result
     }
 
+    /// Write a string representation of this node and its descendants to the
+    /// given writer, in chunks, without building the whole string in memory.
+    ///
+    /// If the writer returns an error, nothing more is written to it, and the
+    /// error is returned.
+    #[doc(alias = "ts_node_write_string")]
+    pub fn write_string(
+        &self,
+        format: NodeStringFormat,
+        writer: &mut impl std::io::Write,
+    ) -> std::io::Result<()> {
+        struct Payload<'a> {
+            writer: &'a mut dyn std::io::Write,
+            result: std::io::Result<()>,
+        }
+
+        unsafe extern "C" fn write(payload: *mut c_void, data: *const c_char, length: u32) {
+            let payload = payload.cast::<Payload>().as_mut().unwrap();
+            if payload.result.is_ok() {
+                let data = slice::from_raw_parts(data.cast::<u8>(), length as usize);
+                payload.result = payload.writer.write_all(data);
+            }
+        }
+
+        let format = match format {
+            NodeStringFormat::SExpression => ffi::TSNodeStringFormatSExpression,
+            NodeStringFormat::Json => ffi::TSNodeStringFormatJSON,
+        };
+        let mut payload = Payload {
+            writer,
+            result: Ok(()),
+        };
+        let c_writer = ffi::TSStringWriter {
+            payload: ptr::addr_of_mut!(payload).cast::<c_void>(),
+            write: Some(write),
+        };
+        unsafe { ffi::ts_node_write_string(self.0, format, c_writer) };
+        payload.result
+    }
+
     pub fn utf8_text<'a>(&self, source: &'a [u8]) -> Result<&'a str, str::Utf8Error> {
         str::from_utf8(&source[self.start_byte()..self.end_byte()])
     }
@@ -1622,6 +2732,26 @@ impl<'cursor> TreeCursor<'cursor> {
         (result >= 0).then_some(result as usize)
     }
 
+    /// Move this cursor to the child of its current node with the given numerical
+    /// field id, which is the node that [`Node::child_by_field_id`] returns.
+    ///
+    /// This returns `true` if the cursor successfully moved, and returns `false`
+    /// if the current node has no child with the given field.
+    #[doc(alias = "ts_tree_cursor_goto_child_by_field_id")]
+    pub fn goto_child_by_field_id(&mut self, field_id: u16) -> bool {
+        unsafe { ffi::ts_tree_cursor_goto_child_by_field_id(&mut self.0, field_id) }
+    }
+
+    /// Move this cursor to the child of its current node with the given field
+    /// name, which is the node that [`Node::child_by_field_name`] returns.
+    ///
+    /// This returns `true` if the cursor successfully moved, and returns `false`
+    /// if the current node has no child with the given field.
+    pub fn goto_child_by_field_name(&mut self, field_name: impl AsRef<[u8]>) -> bool {
+        let field_id = self.node().language().field_id_for_name(field_name);
+        field_id.is_some_and(|field_id| self.goto_child_by_field_id(field_id.get()))
+    }
+
     /// Re-initialize this tree cursor to start at a different node.
     #[doc(alias = "ts_tree_cursor_reset")]
     pub fn reset(&mut self, node: Node<'cursor>) {
@@ -1708,27 +2838,142 @@ impl LookaheadIterator {
 impl Iterator for LookaheadNamesIterator<'_> {
     type Item = &'static str;
 
-    #[doc(alias = "ts_lookahead_iterator_next")]
-    fn next(&mut self) -> Option<Self::Item> {
-        unsafe { ffi::ts_lookahead_iterator_next(self.0 .0.as_ptr()) }
-            .then(|| self.0.current_symbol_name())
+    #[doc(alias = "ts_lookahead_iterator_next")]
+    fn next(&mut self) -> Option<Self::Item> {
+        unsafe { ffi::ts_lookahead_iterator_next(self.0 .0.as_ptr()) }
+            .then(|| self.0.current_symbol_name())
+    }
+}
+
+impl Iterator for LookaheadIterator {
+    type Item = u16;
+
+    #[doc(alias = "ts_lookahead_iterator_next")]
+    fn next(&mut self) -> Option<Self::Item> {
+        // the first symbol is always `0` so we can safely skip it
+        unsafe { ffi::ts_lookahead_iterator_next(self.0.as_ptr()) }.then(|| self.current_symbol())
+    }
+}
+
+impl Drop for LookaheadIterator {
+    #[doc(alias = "ts_lookahead_iterator_delete")]
+    fn drop(&mut self) {
+        unsafe { ffi::ts_lookahead_iterator_delete(self.0.as_ptr()) }
+    }
+}
+
+impl LookaheadTable {
+    /// Create a new lookahead table for the given language.
+    ///
+    /// The set of symbols that are valid in each parse state is built the first
+    /// time that the state is used, and contains the same symbols that a
+    /// [`LookaheadIterator`] would produce. References to lookahead tables can
+    /// be shared between multiple threads.
+    #[doc(alias = "ts_lookahead_table_new")]
+    #[must_use]
+    pub fn new(language: &Language) -> Self {
+        Self(unsafe { NonNull::new_unchecked(ffi::ts_lookahead_table_new(language.0)) })
+    }
+
+    /// Get the language of the lookahead table.
+    #[doc(alias = "ts_lookahead_table_language")]
+    #[must_use]
+    pub fn language(&self) -> LanguageRef<'_> {
+        LanguageRef(
+            unsafe { ffi::ts_lookahead_table_language(self.0.as_ptr()) },
+            PhantomData,
+        )
+    }
+
+    /// Store the symbols that are valid in any of the given parse states in
+    /// `result`, replacing its previous contents.
+    ///
+    /// This returns `false` and leaves `result` unchanged if any of the states
+    /// is invalid for this table's language, or if `result` belongs to a
+    /// different language.
+    #[doc(alias = "ts_lookahead_table_union")]
+    pub fn union(&self, states: &[u16], result: &mut SymbolSet) -> bool {
+        unsafe {
+            ffi::ts_lookahead_table_union(
+                self.0.as_ptr(),
+                states.as_ptr(),
+                states.len() as u32,
+                result.0.as_ptr(),
+            )
+        }
+    }
+
+    /// Store the symbols that are valid in all of the given parse states in
+    /// `result`, replacing its previous contents. If no states are given,
+    /// `result` is emptied.
+    ///
+    /// This returns `false` in the same cases as [`union`](LookaheadTable::union).
+    #[doc(alias = "ts_lookahead_table_intersection")]
+    pub fn intersection(&self, states: &[u16], result: &mut SymbolSet) -> bool {
+        unsafe {
+            ffi::ts_lookahead_table_intersection(
+                self.0.as_ptr(),
+                states.as_ptr(),
+                states.len() as u32,
+                result.0.as_ptr(),
+            )
+        }
+    }
+}
+
+impl Drop for LookaheadTable {
+    #[doc(alias = "ts_lookahead_table_delete")]
+    fn drop(&mut self) {
+        unsafe { ffi::ts_lookahead_table_delete(self.0.as_ptr()) }
+    }
+}
+
+impl SymbolSet {
+    /// Create a new, empty set of symbols for the given language.
+    #[doc(alias = "ts_symbol_set_new")]
+    #[must_use]
+    pub fn new(language: &Language) -> Self {
+        Self(unsafe { NonNull::new_unchecked(ffi::ts_symbol_set_new(language.0)) })
+    }
+
+    /// Check if the set contains the given symbol.
+    #[doc(alias = "ts_symbol_set_contains")]
+    #[must_use]
+    pub fn contains(&self, symbol: u16) -> bool {
+        unsafe { ffi::ts_symbol_set_contains(self.0.as_ptr(), symbol) }
+    }
+
+    /// Get the number of symbols in the set.
+    #[doc(alias = "ts_symbol_set_count")]
+    #[must_use]
+    pub fn len(&self) -> usize {
+        unsafe { ffi::ts_symbol_set_count(self.0.as_ptr()) as usize }
     }
-}
 
-impl Iterator for LookaheadIterator {
-    type Item = u16;
+    /// Check if the set is empty.
+    #[must_use]
+    pub fn is_empty(&self) -> bool {
+        self.iter().next().is_none()
+    }
 
-    #[doc(alias = "ts_lookahead_iterator_next")]
-    fn next(&mut self) -> Option<Self::Item> {
-        // the first symbol is always `0` so we can safely skip it
-        unsafe { ffi::ts_lookahead_iterator_next(self.0.as_ptr()) }.then(|| self.current_symbol())
+    /// Iterate over the symbols in the set, in increasing order.
+    #[doc(alias = "ts_symbol_set_next")]
+    pub fn iter(&self) -> impl Iterator<Item = u16> + '_ {
+        let mut next = 0;
+        iter::from_fn(move || {
+            let symbol = unsafe { ffi::ts_symbol_set_next(self.0.as_ptr(), next) };
+            (symbol != u16::MAX).then(|| {
+                next = symbol.saturating_add(1);
+                symbol
+            })
+        })
     }
 }
 
-impl Drop for LookaheadIterator {
-    #[doc(alias = "ts_lookahead_iterator_delete")]
+impl Drop for SymbolSet {
+    #[doc(alias = "ts_symbol_set_delete")]
     fn drop(&mut self) {
-        unsafe { ffi::ts_lookahead_iterator_delete(self.0.as_ptr()) }
+        unsafe { ffi::ts_symbol_set_delete(self.0.as_ptr()) }
     }
 }
 
@@ -1828,6 +3073,39 @@ impl Query {
         unsafe { Self::from_raw_parts(ptr, source) }
     }
 
+    /// Serialize the compiled query into a binary format, so that it can be
+    /// loaded again later with [`Query::deserialize`] without parsing and
+    /// analyzing its source.
+    #[doc(alias = "ts_query_serialize")]
+    #[must_use]
+    pub fn serialize(&self) -> Vec<u8> {
+        let mut length = 0u32;
+        unsafe {
+            let ptr = ffi::ts_query_serialize(self.ptr.as_ptr(), std::ptr::addr_of_mut!(length));
+            let result = slice::from_raw_parts(ptr.cast::<u8>(), length as usize).to_vec();
+            (FREE_FN)(ptr.cast::<c_void>());
+            result
+        }
+    }
+
+    /// Load a query that was serialized with [`Query::serialize`].
+    ///
+    /// The language must be the one that the query was created for. Returns
+    /// `None` if the data is malformed, or was produced for a different version
+    /// of the language or by an incompatible version of the library.
+    #[doc(alias = "ts_query_deserialize")]
+    #[must_use]
+    pub fn deserialize(language: &Language, data: &[u8]) -> Option<Self> {
+        let length = u32::try_from(data.len()).ok()?;
+        unsafe {
+            let ptr = ffi::ts_query_deserialize(language.0, data.as_ptr().cast::<c_char>(), length);
+            if ptr.is_null() {
+                return None;
+            }
+            Self::from_raw_parts(ptr, "").ok()
+        }
+    }
+
     #[doc(hidden)]
     unsafe fn from_raw_parts(ptr: *mut ffi::TSQuery, source: &str) -> Result<Self, QueryError> {
         let ptr = {
@@ -1846,7 +3124,6 @@ impl Query {
 
         let mut capture_names = Vec::with_capacity(capture_count as usize);
         let mut capture_quantifiers_vec = Vec::with_capacity(pattern_count as usize);
-        let mut text_predicates_vec = Vec::with_capacity(pattern_count);
         let mut property_predicates_vec = Vec::with_capacity(pattern_count);
         let mut property_settings_vec = Vec::with_capacity(pattern_count);
         let mut general_predicates_vec = Vec::with_capacity(pattern_count);
@@ -1915,7 +3192,6 @@ impl Query {
             const TYPE_CAPTURE: T = ffi::TSQueryPredicateStepTypeCapture;
             const TYPE_STRING: T = ffi::TSQueryPredicateStepTypeString;
 
-            let mut text_predicates = Vec::new();
             let mut property_predicates = Vec::new();
             let mut property_settings = Vec::new();
             let mut general_predicates = Vec::new();
@@ -1953,28 +3229,6 @@ impl Query {
                                 string_values[p[1].value_id as usize],
                             )));
                         }
-
-                        let is_positive = operator_name == "eq?" || operator_name == "any-eq?";
-                        let match_all = match operator_name {
-                            "eq?" | "not-eq?" => true,
-                            "any-eq?" | "any-not-eq?" => false,
-                            _ => unreachable!(),
-                        };
-                        text_predicates.push(if p[2].type_ == TYPE_CAPTURE {
-                            TextPredicateCapture::EqCapture(
-                                p[1].value_id,
-                                p[2].value_id,
-                                is_positive,
-                                match_all,
-                            )
-                        } else {
-                            TextPredicateCapture::EqString(
-                                p[1].value_id,
-                                string_values[p[2].value_id as usize].to_string().into(),
-                                is_positive,
-                                match_all,
-                            )
-                        });
                     }
 
                     "match?" | "not-match?" | "any-match?" | "any-not-match?" => {
@@ -1997,22 +3251,12 @@ impl Query {
                             )));
                         }
 
-                        let is_positive =
-                            operator_name == "match?" || operator_name == "any-match?";
-                        let match_all = match operator_name {
-                            "match?" | "not-match?" => true,
-                            "any-match?" | "any-not-match?" => false,
-                            _ => unreachable!(),
-                        };
+                        // The regex is compiled again by the query cursor when it's
+                        // used, so this only checks that it is valid.
                         let regex = &string_values[p[2].value_id as usize];
-                        text_predicates.push(TextPredicateCapture::MatchString(
-                            p[1].value_id,
-                            regex::bytes::Regex::new(regex).map_err(|_| {
-                                predicate_error(row, format!("Invalid regex '{regex}'"))
-                            })?,
-                            is_positive,
-                            match_all,
-                        ));
+                        regex::bytes::Regex::new(regex).map_err(|_| {
+                            predicate_error(row, format!("Invalid regex '{regex}'"))
+                        })?;
                     }
 
                     "set!" => property_settings.push(Self::parse_property(
@@ -2048,8 +3292,6 @@ impl Query {
                             )));
                         }
 
-                        let is_positive = operator_name == "any-of?";
-                        let mut values = Vec::new();
                         for arg in &p[2..] {
                             if arg.type_ == TYPE_CAPTURE {
                                 return Err(predicate_error(row, format!(
@@ -2057,17 +3299,7 @@ impl Query {
                                     capture_names[arg.value_id as usize],
                                 )));
                             }
-                            values.push(string_values[arg.value_id as usize]);
                         }
-                        text_predicates.push(TextPredicateCapture::AnyString(
-                            p[1].value_id,
-                            values
-                                .iter()
-                                .map(|x| (*x).to_string().into())
-                                .collect::<Vec<_>>()
-                                .into(),
-                            is_positive,
-                        ));
                     }
 
                     _ => general_predicates.push(QueryPredicate {
@@ -2088,7 +3320,6 @@ impl Query {
                 }
             }
 
-            text_predicates_vec.push(text_predicates.into());
             property_predicates_vec.push(property_predicates.into());
             property_settings_vec.push(property_settings.into());
             general_predicates_vec.push(general_predicates.into());
@@ -2098,7 +3329,6 @@ impl Query {
             ptr: unsafe { NonNull::new_unchecked(ptr.0) },
             capture_names: capture_names.into(),
             capture_quantifiers: capture_quantifiers_vec.into(),
-            text_predicates: text_predicates_vec.into(),
             property_predicates: property_predicates_vec.into(),
             property_settings: property_settings_vec.into(),
             general_predicates: general_predicates_vec.into(),
@@ -2114,9 +3344,9 @@ impl Query {
     #[must_use]
     pub fn start_byte_for_pattern(&self, pattern_index: usize) -> usize {
         assert!(
-            pattern_index < self.text_predicates.len(),
+            pattern_index < self.general_predicates.len(),
             "Pattern index is {pattern_index} but the pattern count is {}",
-            self.text_predicates.len(),
+            self.general_predicates.len(),
         );
         unsafe {
             ffi::ts_query_start_byte_for_pattern(self.ptr.as_ptr(), pattern_index as u32) as usize
@@ -2217,6 +3447,109 @@ impl Query {
         unsafe { ffi::ts_query_is_pattern_non_local(self.ptr.as_ptr(), index as u32) }
     }
 
+    /// Find all of the matches of the query within the given node, using up to
+    /// `thread_count` threads.
+    ///
+    /// The node's children are split into contiguous partitions, and each thread
+    /// runs a [`QueryCursor`] over one partition at a time, restricted to that
+    /// partition's byte range. Patterns that can match a sequence of siblings
+    /// spanning several partitions (see [`Query::is_pattern_non_local`]) are
+    /// instead matched in a separate pass over the whole node.
+    ///
+    /// The matches are returned in order of their first capture's start byte.
+    /// Matches with the same pattern and captures, which can be found by more
+    /// than one partition, are only returned once.
+    #[must_use]
+    pub fn parallel_matches<'tree>(
+        &self,
+        node: Node<'tree>,
+        text: &[u8],
+        thread_count: usize,
+    ) -> Vec<OwnedQueryMatch<'tree>> {
+        let child_count = node.child_count();
+        let partition_count = child_count.min(thread_count.max(1) * 4);
+        let has_non_local_patterns =
+            (0..self.pattern_count()).any(|index| self.is_pattern_non_local(index));
+
+        // Split the node's children into partitions of adjacent byte ranges, which
+        // together cover the entire document.
+        let mut boundaries = vec![0];
+        for i in 1..partition_count {
+            boundaries.push(
+                node.child(i * child_count / partition_count)
+                    .unwrap()
+                    .start_byte(),
+            );
+        }
+        boundaries.push(u32::MAX as usize);
+
+        let next_partition = AtomicUsize::new(0);
+        let run_partitions = || {
+            let mut cursor = QueryCursor::new();
+            let mut result = Vec::new();
+            loop {
+                let partition = next_partition.fetch_add(1, Ordering::Relaxed);
+                if partition >= partition_count {
+                    break;
+                }
+                cursor.set_byte_range(boundaries[partition]..boundaries[partition + 1]);
+                for m in cursor.matches(self, node, text) {
+                    if !self.is_pattern_non_local(m.pattern_index) {
+                        result.push(OwnedQueryMatch {
+                            pattern_index: m.pattern_index,
+                            captures: m.captures.to_vec(),
+                        });
+                    }
+                }
+            }
+            result
+        };
+
+        let mut matches = thread::scope(|scope| {
+            let workers = (0..thread_count.max(1).min(partition_count))
+                .map(|_| scope.spawn(run_partitions))
+                .collect::<Vec<_>>();
+
+            let mut matches = Vec::new();
+            if has_non_local_patterns || partition_count == 0 {
+                let mut cursor = QueryCursor::new();
+                for m in cursor.matches(self, node, text) {
+                    if partition_count == 0 || self.is_pattern_non_local(m.pattern_index) {
+                        matches.push(OwnedQueryMatch {
+                            pattern_index: m.pattern_index,
+                            captures: m.captures.to_vec(),
+                        });
+                    }
+                }
+            }
+            for worker in workers {
+                matches.extend(worker.join().unwrap());
+            }
+            matches
+        });
+
+        let key = |m: &OwnedQueryMatch| {
+            (
+                m.captures.iter().map(|c| c.node.start_byte()).min(),
+                m.pattern_index,
+                m.captures
+                    .iter()
+                    .map(|c| (c.index, c.node.id()))
+                    .collect::<Vec<_>>(),
+            )
+        };
+        matches.sort_by_cached_key(key);
+        matches.dedup_by(|a, b| {
+            a.pattern_index == b.pattern_index
+                && a.captures.len() == b.captures.len()
+                && a.captures
+                    .iter()
+                    .zip(&b.captures)
+                    .all(|(a, b)| a.index == b.index && a.node == b.node)
+        });
+        matches
+    }
+
     /// Check if a given step in a query is 'definite'.
     ///
     /// A query step is 'definite' if its parent pattern will be guaranteed to match
@@ -2301,8 +3634,20 @@ impl QueryCursor {
     #[doc(alias = "ts_query_cursor_new")]
     #[must_use]
     pub fn new() -> Self {
-        Self {
-            ptr: unsafe { NonNull::new_unchecked(ffi::ts_query_cursor_new()) },
+        unsafe {
+            let ptr = ffi::ts_query_cursor_new();
+            ffi::ts_query_cursor_set_regex_engine(
+                ptr,
+                ffi::TSQueryRegexEngine {
+                    payload: ptr::null_mut(),
+                    compile: Some(regex_compile),
+                    is_match: Some(regex_is_match),
+                    destroy: Some(regex_destroy),
+                },
+            );
+            Self {
+                ptr: NonNull::new_unchecked(ptr),
+            }
         }
     }
 
@@ -2330,6 +3675,38 @@ impl QueryCursor {
         unsafe { ffi::ts_query_cursor_did_exceed_match_limit(self.ptr.as_ptr()) }
     }
 
+    /// Enable or disable the collection of per-pattern statistics, which can be
+    /// used to find the patterns that make a query slow. Changes take effect the
+    /// next time that the cursor starts executing a query.
+    #[doc(alias = "ts_query_cursor_set_pattern_stats_enabled")]
+    pub fn set_pattern_stats_enabled(&mut self, enabled: bool) {
+        unsafe {
+            ffi::ts_query_cursor_set_pattern_stats_enabled(self.ptr.as_ptr(), enabled);
+        }
+    }
+
+    /// Check if this cursor collects per-pattern statistics.
+    #[doc(alias = "ts_query_cursor_pattern_stats_enabled")]
+    #[must_use]
+    pub fn pattern_stats_enabled(&self) -> bool {
+        unsafe { ffi::ts_query_cursor_pattern_stats_enabled(self.ptr.as_ptr()) }
+    }
+
+    /// Get the statistics that this cursor has collected for the given pattern
+    /// since it started executing its current query.
+    #[doc(alias = "ts_query_cursor_pattern_stats")]
+    #[must_use]
+    pub fn pattern_stats(&self, pattern_index: usize) -> QueryPatternStats {
+        let stats =
+            unsafe { ffi::ts_query_cursor_pattern_stats(self.ptr.as_ptr(), pattern_index as u32) };
+        QueryPatternStats {
+            started_state_count: stats.started_state_count as usize,
+            copied_state_count: stats.copied_state_count as usize,
+            dropped_state_count: stats.dropped_state_count as usize,
+            capture_list_count: stats.capture_list_count as usize,
+        }
+    }
+
     /// Iterate over all of the matches in the order that they were found.
     ///
     /// Each match contains the index of the pattern that matched, and a list of captures.
@@ -2346,10 +3723,8 @@ impl QueryCursor {
         unsafe { ffi::ts_query_cursor_exec(ptr, query.ptr.as_ptr(), node.0) };
         QueryMatches {
             ptr,
-            query,
             text_provider,
-            buffer1: Vec::default(),
-            buffer2: Vec::default(),
+            buffer: Vec::default(),
             _phantom: PhantomData,
         }
     }
@@ -2369,14 +3744,74 @@ impl QueryCursor {
         unsafe { ffi::ts_query_cursor_exec(ptr, query.ptr.as_ptr(), node.0) };
         QueryCaptures {
             ptr,
-            query,
             text_provider,
-            buffer1: Vec::default(),
-            buffer2: Vec::default(),
+            buffer: Vec::default(),
+            _phantom: PhantomData,
+        }
+    }
+
+    /// Iterate over the matches of several queries, which are all run during a
+    /// single traversal of the tree.
+    ///
+    /// Each item contains the index of the query within `queries`, along with a
+    /// match whose pattern index and captures refer to that query. At most 65535
+    /// queries can be run at once, with at most 65535 patterns between them. If
+    /// there are more, there are no matches.
+    #[doc(alias = "ts_query_cursor_exec_queries")]
+    pub fn multi_matches<'query, 'cursor: 'query, 'tree, T: TextProvider<I>, I: AsRef<[u8]>>(
+        &'cursor mut self,
+        queries: &'query [&'query Query],
+        node: Node<'tree>,
+        text_provider: T,
+    ) -> QueryMultiMatches<'query, 'tree, T, I> {
+        let ptr = self.ptr.as_ptr();
+        Self::exec_queries(ptr, queries, node);
+        QueryMultiMatches {
+            ptr,
+            text_provider,
+            buffer: Vec::default(),
+            _phantom: PhantomData,
+        }
+    }
+
+    /// Iterate over the individual captures of several queries in the order that
+    /// they appear, running all of the queries during a single traversal of the tree.
+    ///
+    /// Each item contains the index of the query within `queries`, along with the
+    /// match and the index of the capture within that match. The queries are
+    /// subject to the same limits as in [`multi_matches`](QueryCursor::multi_matches).
+    #[doc(alias = "ts_query_cursor_exec_queries")]
+    pub fn multi_captures<'query, 'cursor: 'query, 'tree, T: TextProvider<I>, I: AsRef<[u8]>>(
+        &'cursor mut self,
+        queries: &'query [&'query Query],
+        node: Node<'tree>,
+        text_provider: T,
+    ) -> QueryMultiCaptures<'query, 'tree, T, I> {
+        let ptr = self.ptr.as_ptr();
+        Self::exec_queries(ptr, queries, node);
+        QueryMultiCaptures {
+            ptr,
+            text_provider,
+            buffer: Vec::default(),
             _phantom: PhantomData,
         }
     }
 
+    fn exec_queries(ptr: *mut ffi::TSQueryCursor, queries: &[&Query], node: Node) {
+        let query_ptrs = queries
+            .iter()
+            .map(|query| query.ptr.as_ptr().cast_const())
+            .collect::<Vec<_>>();
+        unsafe {
+            ffi::ts_query_cursor_exec_queries(
+                ptr,
+                query_ptrs.as_ptr(),
+                query_ptrs.len() as u32,
+                node.0,
+            );
+        }
+    }
+
     /// Set the range in which the query will be executed, in terms of byte offsets.
     #[doc(alias = "ts_query_cursor_set_byte_range")]
     pub fn set_byte_range(&mut self, range: ops::Range<usize>) -> &mut Self {
@@ -2427,6 +3862,100 @@ impl QueryCursor {
     }
 }
 
+impl<'query> QuerySession<'query> {
+    /// Create a new session for the given query. It has no matches until
+    /// [`QuerySession::update`] is first called.
+    #[doc(alias = "ts_query_session_new")]
+    #[must_use]
+    pub fn new(query: &'query Query) -> Self {
+        Self {
+            ptr: unsafe { NonNull::new_unchecked(ffi::ts_query_session_new(query.ptr.as_ptr())) },
+            _phantom: PhantomData,
+        }
+    }
+
+    /// Edit the session's matches to keep them in sync with source code that
+    /// has been edited. This must be called with the same edits that are
+    /// applied to the old syntax tree using [`Tree::edit`].
+    #[doc(alias = "ts_query_session_edit")]
+    pub fn edit(&mut self, edit: &InputEdit) {
+        let edit = edit.into();
+        unsafe { ffi::ts_query_session_edit(self.ptr.as_ptr(), &edit) }
+    }
+
+    /// Bring the session's matches up to date with a new syntax tree.
+    ///
+    /// The first time that this is called, the query is run over the whole
+    /// node. After that, `changed_ranges` should be the result of
+    /// [`Tree::changed_ranges`] for the old and new trees, and only the
+    /// matches that touch those ranges, or the edited ranges, are recomputed.
+    ///
+    /// The query's text predicates are evaluated using `text_provider`.
+    /// Returns the number of matches that were recomputed.
+    #[doc(alias = "ts_query_session_update")]
+    pub fn update<T: TextProvider<I>, I: AsRef<[u8]>>(
+        &mut self,
+        cursor: &mut QueryCursor,
+        node: Node,
+        changed_ranges: &[Range],
+        mut text_provider: T,
+    ) -> usize {
+        let ranges = changed_ranges
+            .iter()
+            .map(|range| (*range).into())
+            .collect::<Vec<ffi::TSRange>>();
+        let ptr = cursor.ptr.as_ptr();
+        let mut buffer = Vec::new();
+        unsafe {
+            advance_with_text(ptr, &mut text_provider, &mut buffer, || {
+                ffi::ts_query_session_update(
+                    self.ptr.as_ptr(),
+                    ptr,
+                    node.0,
+                    ranges.as_ptr(),
+                    ranges.len() as u32,
+                )
+            }) as usize
+        }
+    }
+
+    /// Get the number of matches that the session currently has.
+    #[doc(alias = "ts_query_session_match_count")]
+    #[must_use]
+    pub fn match_count(&self) -> usize {
+        unsafe { ffi::ts_query_session_match_count(self.ptr.as_ptr()) as usize }
+    }
+
+    /// Iterate over the session's matches, ordered by the position of their
+    /// earliest capture.
+    #[doc(alias = "ts_query_session_match")]
+    pub fn matches(&self) -> impl ExactSizeIterator<Item = QuerySessionMatch<'_>> + '_ {
+        (0..self.match_count()).map(move |i| unsafe {
+            let m = ffi::ts_query_session_match(self.ptr.as_ptr(), i as u32);
+            QuerySessionMatch {
+                pattern_index: m.pattern_index as usize,
+                captures: slice::from_raw_parts(m.captures, m.capture_count as usize),
+            }
+        })
+    }
+}
+
+impl Drop for QuerySession<'_> {
+    fn drop(&mut self) {
+        unsafe { ffi::ts_query_session_delete(self.ptr.as_ptr()) }
+    }
+}
+
+impl QuerySessionMatch<'_> {
+    /// Iterate over the match's captures, each given as the index of the
+    /// capture name and the range of the captured node.
+    pub fn captures(&self) -> impl ExactSizeIterator<Item = (u32, Range)> + '_ {
+        self.captures
+            .iter()
+            .map(|capture| (capture.index, capture.range.into()))
+    }
+}
+
 impl<'tree> QueryMatch<'_, 'tree> {
     #[must_use]
     pub const fn id(&self) -> u32 {
@@ -2462,109 +3991,6 @@ impl<'tree> QueryMatch<'_, 'tree> {
                 .unwrap_or_default(),
         }
     }
-
-    fn satisfies_text_predicates<I: AsRef<[u8]>>(
-        &self,
-        query: &Query,
-        buffer1: &mut Vec<u8>,
-        buffer2: &mut Vec<u8>,
-        text_provider: &mut impl TextProvider<I>,
-    ) -> bool {
-        struct NodeText<'a, T> {
-            buffer: &'a mut Vec<u8>,
-            first_chunk: Option<T>,
-        }
-        impl<'a, T: AsRef<[u8]>> NodeText<'a, T> {
-            fn new(buffer: &'a mut Vec<u8>) -> Self {
-                Self {
-                    buffer,
-                    first_chunk: None,
-                }
-            }
-
-            fn get_text(&mut self, chunks: &mut impl Iterator<Item = T>) -> &[u8] {
-                self.first_chunk = chunks.next();
-                if let Some(next_chunk) = chunks.next() {
-                    self.buffer.clear();
-                    self.buffer
-                        .extend_from_slice(self.first_chunk.as_ref().unwrap().as_ref());
-                    self.buffer.extend_from_slice(next_chunk.as_ref());
-                    for chunk in chunks {
-                        self.buffer.extend_from_slice(chunk.as_ref());
-                    }
-                    self.buffer.as_slice()
-                } else if let Some(ref first_chunk) = self.first_chunk {
-                    first_chunk.as_ref()
-                } else {
-                    Default::default()
-                }
-            }
-        }
-
-        let mut node_text1 = NodeText::new(buffer1);
-        let mut node_text2 = NodeText::new(buffer2);
-
-        query.text_predicates[self.pattern_index]
-            .iter()
-            .all(|predicate| match predicate {
-                TextPredicateCapture::EqCapture(i, j, is_positive, match_all_nodes) => {
-                    let mut nodes_1 = self.nodes_for_capture_index(*i);
-                    let mut nodes_2 = self.nodes_for_capture_index(*j);
-                    while let (Some(node1), Some(node2)) = (nodes_1.next(), nodes_2.next()) {
-                        let mut text1 = text_provider.text(node1);
-                        let mut text2 = text_provider.text(node2);
-                        let text1 = node_text1.get_text(&mut text1);
-                        let text2 = node_text2.get_text(&mut text2);
-                        if (text1 == text2) != *is_positive && *match_all_nodes {
-                            return false;
-                        }
-                        if (text1 == text2) == *is_positive && !*match_all_nodes {
-                            return true;
-                        }
-                    }
-                    nodes_1.next().is_none() && nodes_2.next().is_none()
-                }
-                TextPredicateCapture::EqString(i, s, is_positive, match_all_nodes) => {
-                    let nodes = self.nodes_for_capture_index(*i);
-                    for node in nodes {
-                        let mut text = text_provider.text(node);
-                        let text = node_text1.get_text(&mut text);
-                        if (text == s.as_bytes()) != *is_positive && *match_all_nodes {
-                            return false;
-                        }
-                        if (text == s.as_bytes()) == *is_positive && !*match_all_nodes {
-                            return true;
-                        }
-                    }
-                    true
-                }
-                TextPredicateCapture::MatchString(i, r, is_positive, match_all_nodes) => {
-                    let nodes = self.nodes_for_capture_index(*i);
-                    for node in nodes {
-                        let mut text = text_provider.text(node);
-                        let text = node_text1.get_text(&mut text);
-                        if (r.is_match(text)) != *is_positive && *match_all_nodes {
-                            return false;
-                        }
-                        if (r.is_match(text)) == *is_positive && !*match_all_nodes {
-                            return true;
-                        }
-                    }
-                    true
-                }
-                TextPredicateCapture::AnyString(i, v, is_positive) => {
-                    let nodes = self.nodes_for_capture_index(*i);
-                    for node in nodes {
-                        let mut text = text_provider.text(node);
-                        let text = node_text1.get_text(&mut text);
-                        if (v.iter().any(|s| text == s.as_bytes())) != *is_positive {
-                            return false;
-                        }
-                    }
-                    true
-                }
-            })
-    }
 }
 
 impl QueryProperty {
@@ -2578,6 +4004,106 @@ impl QueryProperty {
     }
 }
 
+/// The payload of the text provider that a query cursor calls while one of the
+/// query iterators is advancing it.
+struct NodeTextPayload<'a, T> {
+    text_provider: &'a mut T,
+    buffer: &'a mut Vec<u8>,
+    panic: Option<Box<dyn Any + Send>>,
+}
+
+unsafe extern "C" fn node_text<T: TextProvider<I>, I: AsRef<[u8]>>(
+    payload: *mut c_void,
+    node: ffi::TSNode,
+    length: *mut u32,
+) -> *const c_char {
+    let payload = &mut *payload.cast::<NodeTextPayload<T>>();
+    payload.buffer.clear();
+
+    // A panic can't unwind through the query cursor, so it is caught here and
+    // resumed once the cursor returns. Until then, every node's text is empty.
+    if payload.panic.is_none() {
+        if let Some(node) = Node::new(node) {
+            let text_provider = &mut *payload.text_provider;
+            let buffer = &mut *payload.buffer;
+            let result = panic::catch_unwind(AssertUnwindSafe(|| {
+                for chunk in text_provider.text(node) {
+                    buffer.extend_from_slice(chunk.as_ref());
+                }
+            }));
+            if let Err(error) = result {
+                payload.buffer.clear();
+                payload.panic = Some(error);
+            }
+        }
+    }
+    *length = payload.buffer.len() as u32;
+    payload.buffer.as_ptr().cast()
+}
+
+/// Advance a query cursor with a text provider installed, so that the cursor
+/// evaluates the text predicates of its queries and skips the matches that
+/// fail them.
+unsafe fn advance_with_text<T: TextProvider<I>, I: AsRef<[u8]>, R>(
+    ptr: *mut ffi::TSQueryCursor,
+    text_provider: &mut T,
+    buffer: &mut Vec<u8>,
+    advance: impl FnOnce() -> R,
+) -> R {
+    let mut payload = NodeTextPayload {
+        text_provider,
+        buffer,
+        panic: None,
+    };
+    ffi::ts_query_cursor_set_text_provider(
+        ptr,
+        ffi::TSQueryTextProvider {
+            payload: ptr::addr_of_mut!(payload).cast::<c_void>(),
+            text: Some(node_text::<T, I>),
+        },
+    );
+    let result = advance();
+    ffi::ts_query_cursor_set_text_provider(
+        ptr,
+        ffi::TSQueryTextProvider {
+            payload: ptr::null_mut(),
+            text: None,
+        },
+    );
+    if let Some(error) = payload.panic {
+        panic::resume_unwind(error);
+    }
+    result
+}
+
+unsafe extern "C" fn regex_compile(
+    _payload: *mut c_void,
+    pattern: *const c_char,
+    length: u32,
+) -> *mut c_void {
+    let pattern = slice::from_raw_parts(pattern.cast::<u8>(), length as usize);
+    str::from_utf8(pattern)
+        .ok()
+        .and_then(|pattern| regex::bytes::Regex::new(pattern).ok())
+        .map_or(ptr::null_mut(), |regex| {
+            Box::into_raw(Box::new(regex)).cast::<c_void>()
+        })
+}
+
+unsafe extern "C" fn regex_is_match(
+    _payload: *mut c_void,
+    regex: *const c_void,
+    text: *const c_char,
+    length: u32,
+) -> bool {
+    let regex = &*regex.cast::<regex::bytes::Regex>();
+    regex.is_match(slice::from_raw_parts(text.cast::<u8>(), length as usize))
+}
+
+unsafe extern "C" fn regex_destroy(_payload: *mut c_void, regex: *mut c_void) {
+    drop(Box::from_raw(regex.cast::<regex::bytes::Regex>()));
+}
+
 impl<'query, 'tree: 'query, T: TextProvider<I>, I: AsRef<[u8]>> Iterator
     for QueryMatches<'query, 'tree, T, I>
 {
@@ -2585,22 +4111,12 @@ impl<'query, 'tree: 'query, T: TextProvider<I>, I: AsRef<[u8]>> Iterator
 
     fn next(&mut self) -> Option<Self::Item> {
         unsafe {
-            loop {
-                let mut m = MaybeUninit::<ffi::TSQueryMatch>::uninit();
-                if ffi::ts_query_cursor_next_match(self.ptr, m.as_mut_ptr()) {
-                    let result = QueryMatch::new(&m.assume_init(), self.ptr);
-                    if result.satisfies_text_predicates(
-                        self.query,
-                        &mut self.buffer1,
-                        &mut self.buffer2,
-                        &mut self.text_provider,
-                    ) {
-                        return Some(result);
-                    }
-                } else {
-                    return None;
-                }
-            }
+            let ptr = self.ptr;
+            let mut m = MaybeUninit::<ffi::TSQueryMatch>::uninit();
+            advance_with_text(ptr, &mut self.text_provider, &mut self.buffer, || {
+                ffi::ts_query_cursor_next_match(ptr, m.as_mut_ptr())
+            })
+            .then(|| QueryMatch::new(&m.assume_init(), ptr))
         }
     }
 }
@@ -2612,28 +4128,74 @@ impl<'query, 'tree: 'query, T: TextProvider<I>, I: AsRef<[u8]>> Iterator
 
     fn next(&mut self) -> Option<Self::Item> {
         unsafe {
-            loop {
-                let mut capture_index = 0u32;
-                let mut m = MaybeUninit::<ffi::TSQueryMatch>::uninit();
-                if ffi::ts_query_cursor_next_capture(
-                    self.ptr,
+            let ptr = self.ptr;
+            let mut capture_index = 0u32;
+            let mut m = MaybeUninit::<ffi::TSQueryMatch>::uninit();
+            advance_with_text(ptr, &mut self.text_provider, &mut self.buffer, || {
+                ffi::ts_query_cursor_next_capture(
+                    ptr,
                     m.as_mut_ptr(),
                     std::ptr::addr_of_mut!(capture_index),
-                ) {
-                    let result = QueryMatch::new(&m.assume_init(), self.ptr);
-                    if result.satisfies_text_predicates(
-                        self.query,
-                        &mut self.buffer1,
-                        &mut self.buffer2,
-                        &mut self.text_provider,
-                    ) {
-                        return Some((result, capture_index as usize));
-                    }
-                    result.remove();
-                } else {
-                    return None;
-                }
-            }
+                )
+            })
+            .then(|| {
+                (
+                    QueryMatch::new(&m.assume_init(), ptr),
+                    capture_index as usize,
+                )
+            })
+        }
+    }
+}
+
+impl<'query, 'tree: 'query, T: TextProvider<I>, I: AsRef<[u8]>> Iterator
+    for QueryMultiMatches<'query, 'tree, T, I>
+{
+    type Item = (usize, QueryMatch<'query, 'tree>);
+
+    fn next(&mut self) -> Option<Self::Item> {
+        unsafe {
+            let ptr = self.ptr;
+            let mut query_index = 0u32;
+            let mut m = MaybeUninit::<ffi::TSQueryMatch>::uninit();
+            advance_with_text(ptr, &mut self.text_provider, &mut self.buffer, || {
+                ffi::ts_query_cursor_next_query_match(
+                    ptr,
+                    m.as_mut_ptr(),
+                    std::ptr::addr_of_mut!(query_index),
+                )
+            })
+            .then(|| (query_index as usize, QueryMatch::new(&m.assume_init(), ptr)))
+        }
+    }
+}
+
+impl<'query, 'tree: 'query, T: TextProvider<I>, I: AsRef<[u8]>> Iterator
+    for QueryMultiCaptures<'query, 'tree, T, I>
+{
+    type Item = (usize, QueryMatch<'query, 'tree>, usize);
+
+    fn next(&mut self) -> Option<Self::Item> {
+        unsafe {
+            let ptr = self.ptr;
+            let mut capture_index = 0u32;
+            let mut query_index = 0u32;
+            let mut m = MaybeUninit::<ffi::TSQueryMatch>::uninit();
+            advance_with_text(ptr, &mut self.text_provider, &mut self.buffer, || {
+                ffi::ts_query_cursor_next_query_capture(
+                    ptr,
+                    m.as_mut_ptr(),
+                    std::ptr::addr_of_mut!(capture_index),
+                    std::ptr::addr_of_mut!(query_index),
+                )
+            })
+            .then(|| {
+                (
+                    query_index as usize,
+                    QueryMatch::new(&m.assume_init(), ptr),
+                    capture_index as usize,
+                )
+            })
         }
     }
 }
@@ -2772,6 +4334,66 @@ impl From<ffi::TSRange> for Range {
     }
 }
 
+impl From<ffi::TSParseStats> for ParseStats {
+    fn from(stats: ffi::TSParseStats) -> Self {
+        Self {
+            lex_count: stats.lex_count as usize,
+            external_scan_count: stats.external_scan_count as usize,
+            lexed_byte_count: stats.lexed_byte_count,
+            shift_count: stats.shift_count as usize,
+            reduce_count: stats.reduce_count as usize,
+            reused_node_count: stats.reused_node_count as usize,
+            reused_byte_count: stats.reused_byte_count,
+            token_cache_hit_count: stats.token_cache_hit_count as usize,
+            token_cache_miss_count: stats.token_cache_miss_count as usize,
+            version_split_count: stats.version_split_count as usize,
+            version_merge_count: stats.version_merge_count as usize,
+            version_limit_prune_count: stats.version_limit_prune_count as usize,
+            version_cost_prune_count: stats.version_cost_prune_count as usize,
+            max_version_count: stats.max_version_count as usize,
+            error_recovery_micros: stats.error_recovery_micros,
+        }
+    }
+}
+
+impl From<ffi::TSSyntaxCheck> for SyntaxCheck {
+    fn from(check: ffi::TSSyntaxCheck) -> Self {
+        Self {
+            error_count: check.error_count as usize,
+            missing_count: check.missing_count as usize,
+            first_error: (check.error_count > 0 || check.missing_count > 0)
+                .then(|| check.first_error.into()),
+        }
+    }
+}
+
+impl From<VersionPolicy> for ffi::TSVersionPolicy {
+    fn from(policy: VersionPolicy) -> Self {
+        Self {
+            max_version_count: policy.max_version_count,
+            max_cost_difference: policy.max_cost_difference,
+            strategy: match policy.strategy {
+                VersionPruningStrategy::KeepBest => ffi::TSVersionPruningStrategyKeepBest,
+                VersionPruningStrategy::DropNewest => ffi::TSVersionPruningStrategyDropNewest,
+            },
+        }
+    }
+}
+
+impl From<ffi::TSVersionPolicy> for VersionPolicy {
+    fn from(policy: ffi::TSVersionPolicy) -> Self {
+        Self {
+            max_version_count: policy.max_version_count,
+            max_cost_difference: policy.max_cost_difference,
+            strategy: if policy.strategy == ffi::TSVersionPruningStrategyDropNewest {
+                VersionPruningStrategy::DropNewest
+            } else {
+                VersionPruningStrategy::KeepBest
+            },
+        }
+    }
+}
+
 impl From<&'_ InputEdit> for ffi::TSInputEdit {
     fn from(val: &'_ InputEdit) -> Self {
         Self {
@@ -3032,15 +4654,31 @@ unsafe impl Sync for LookaheadIterator {}
 unsafe impl Send for LookaheadNamesIterator<'_> {}
 unsafe impl Sync for LookaheadNamesIterator<'_> {}
 
+unsafe impl Send for LookaheadTable {}
+unsafe impl Sync for LookaheadTable {}
+
+unsafe impl Send for SymbolSet {}
+unsafe impl Sync for SymbolSet {}
+
 unsafe impl Send for Parser {}
 unsafe impl Sync for Parser {}
 
+unsafe impl Send for ParserPool {}
+
+unsafe impl Send for TreeReclaimer {}
+unsafe impl Sync for TreeReclaimer {}
+
+unsafe impl Send for LineIndex {}
+unsafe impl Sync for LineIndex {}
+
 unsafe impl Send for Query {}
 unsafe impl Sync for Query {}
 
 unsafe impl Send for QueryCursor {}
 unsafe impl Sync for QueryCursor {}
 
+unsafe impl Send for QuerySession<'_> {}
+
 unsafe impl Send for Tree {}
 unsafe impl Sync for Tree {}
 
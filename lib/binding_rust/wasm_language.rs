@@ -24,6 +24,12 @@ pub struct wasm_engine_t {
 
 pub struct WasmStore(*mut ffi::TSWasmStore);
 
+/// A pool of [`WasmStore`]s that share one engine and one compiled copy of the
+/// wasm stdlib. Released stores keep the languages that were instantiated in
+/// them, so that later parsers can reuse them. A pool can be shared between
+/// threads.
+pub struct WasmStorePool(*mut ffi::TSWasmStorePool);
+
 #[derive(Debug, PartialEq, Eq)]
 pub struct WasmError {
     pub kind: WasmErrorKind,
@@ -80,6 +86,48 @@ impl WasmStore {
     }
 }
 
+impl WasmStorePool {
+    /// Create a pool that keeps at most `max_store_count` idle stores.
+    pub fn new(engine: wasmtime::Engine, max_store_count: u32) -> Result<Self, WasmError> {
+        unsafe {
+            let mut error = MaybeUninit::<ffi::TSWasmError>::uninit();
+            let engine = Box::new(wasm_engine_t { engine });
+            let pool = ffi::ts_wasm_store_pool_new(
+                (Box::leak(engine) as *mut wasm_engine_t).cast(),
+                max_store_count,
+                error.as_mut_ptr(),
+            );
+            if pool.is_null() {
+                Err(WasmError::new(error.assume_init()))
+            } else {
+                Ok(Self(pool))
+            }
+        }
+    }
+
+    /// Take an idle store from the pool, or create a new one if the pool has
+    /// no idle stores.
+    pub fn acquire(&self) -> Result<WasmStore, WasmError> {
+        unsafe {
+            let mut error = MaybeUninit::<ffi::TSWasmError>::uninit();
+            let store = ffi::ts_wasm_store_pool_acquire(self.0, error.as_mut_ptr());
+            if store.is_null() {
+                Err(WasmError::new(error.assume_init()))
+            } else {
+                Ok(WasmStore(store))
+            }
+        }
+    }
+
+    /// Return a store to the pool, or delete it if the pool is full or if the
+    /// store didn't come from this pool.
+    pub fn release(&self, store: WasmStore) {
+        let ptr = store.0;
+        mem::forget(store);
+        unsafe { ffi::ts_wasm_store_pool_release(self.0, ptr) };
+    }
+}
+
 impl WasmError {
     unsafe fn new(error: ffi::TSWasmError) -> Self {
         let message = CStr::from_ptr(error.message).to_str().unwrap().to_string();
@@ -126,6 +174,16 @@ impl Drop for WasmStore {
     }
 }
 
+impl Drop for WasmStorePool {
+    fn drop(&mut self) {
+        unsafe { ffi::ts_wasm_store_pool_delete(self.0) };
+    }
+}
+
+unsafe impl Send for WasmStore {}
+unsafe impl Send for WasmStorePool {}
+unsafe impl Sync for WasmStorePool {}
+
 impl fmt::Display for WasmError {
     fn fmt(&self, f: &mut fmt::Formatter) -> fmt::Result {
         let kind = match self.kind {
@@ -22,28 +22,62 @@ void *ts_init() {
   return TRANSFER_BUFFER;
 }
 
-static uint32_t code_unit_to_byte(uint32_t unit) {
-  return unit << 1;
+// Positions are exposed to JavaScript as UTF-16 code units, except in
+// trees that were parsed from UTF-8, where they are identical to byte
+// offsets. The set of parsers and trees that use byte offsets is kept
+// sorted by address. Each function looks up the shift between bytes and
+// code units for the tree or parser that it is given, and passes it to
+// the marshaling functions.
+static Array(uintptr_t) byte_offset_objects = array_new();
+
+static int compare_addresses(const uintptr_t *a, const uintptr_t *b) {
+  return *a < *b ? -1 : *a > *b ? 1 : 0;
+}
+
+static bool uses_byte_offsets(const void *object) {
+  uintptr_t address = (uintptr_t)object;
+  unsigned index, exists;
+  array_search_sorted_with(&byte_offset_objects, compare_addresses, &address, &index, &exists);
+  return exists;
+}
+
+static void set_uses_byte_offsets(const void *object, bool value) {
+  uintptr_t address = (uintptr_t)object;
+  unsigned index, exists;
+  array_search_sorted_with(&byte_offset_objects, compare_addresses, &address, &index, &exists);
+  if (value && !exists) {
+    array_insert(&byte_offset_objects, index, address);
+  } else if (!value && exists) {
+    array_erase(&byte_offset_objects, index);
+  }
+}
+
+static inline uint32_t code_unit_shift(const void *object) {
+  return byte_offset_objects.size && uses_byte_offsets(object) ? 0 : 1;
 }
 
-static uint32_t byte_to_code_unit(uint32_t byte) {
-  return byte >> 1;
+static uint32_t code_unit_to_byte(uint32_t unit, uint32_t shift) {
+  return unit << shift;
 }
 
-static inline void marshal_node(const void **buffer, TSNode node) {
+static uint32_t byte_to_code_unit(uint32_t byte, uint32_t shift) {
+  return byte >> shift;
+}
+
+static inline void marshal_node(const void **buffer, TSNode node, uint32_t shift) {
   buffer[0] = node.id;
-  buffer[1] = (const void *)byte_to_code_unit(node.context[0]);
+  buffer[1] = (const void *)byte_to_code_unit(node.context[0], shift);
   buffer[2] = (const void *)node.context[1];
-  buffer[3] = (const void *)byte_to_code_unit(node.context[2]);
+  buffer[3] = (const void *)byte_to_code_unit(node.context[2], shift);
   buffer[4] = (const void *)node.context[3];
 }
 
-static inline TSNode unmarshal_node(const TSTree *tree) {
+static inline TSNode unmarshal_node(const TSTree *tree, uint32_t shift) {
   TSNode node;
   node.id = TRANSFER_BUFFER[0];
-  node.context[0] = code_unit_to_byte((uint32_t)TRANSFER_BUFFER[1]);
+  node.context[0] = code_unit_to_byte((uint32_t)TRANSFER_BUFFER[1], shift);
   node.context[1] = (uint32_t)TRANSFER_BUFFER[2];
-  node.context[2] = code_unit_to_byte((uint32_t)TRANSFER_BUFFER[3]);
+  node.context[2] = code_unit_to_byte((uint32_t)TRANSFER_BUFFER[3], shift);
   node.context[3] = (uint32_t)TRANSFER_BUFFER[4];
   node.tree = tree;
   return node;
@@ -66,41 +100,41 @@ static inline TSTreeCursor unmarshal_cursor(const void **buffer, const TSTree *t
   return cursor;
 }
 
-static void marshal_point(TSPoint point) {
+static void marshal_point(TSPoint point, uint32_t shift) {
   TRANSFER_BUFFER[0] = (const void *)point.row;
-  TRANSFER_BUFFER[1] = (const void *)byte_to_code_unit(point.column);
+  TRANSFER_BUFFER[1] = (const void *)byte_to_code_unit(point.column, shift);
 }
 
-static TSPoint unmarshal_point(const void **address) {
+static TSPoint unmarshal_point(const void **address, uint32_t shift) {
   TSPoint point;
   point.row = (uint32_t)address[0];
-  point.column = code_unit_to_byte((uint32_t)address[1]);
+  point.column = code_unit_to_byte((uint32_t)address[1], shift);
   return point;
 }
 
-static void marshal_range(TSRange *range) {
-  range->start_byte = byte_to_code_unit(range->start_byte);
-  range->end_byte = byte_to_code_unit(range->end_byte);
-  range->start_point.column = byte_to_code_unit(range->start_point.column);
-  range->end_point.column = byte_to_code_unit(range->end_point.column);
+static void marshal_range(TSRange *range, uint32_t shift) {
+  range->start_byte = byte_to_code_unit(range->start_byte, shift);
+  range->end_byte = byte_to_code_unit(range->end_byte, shift);
+  range->start_point.column = byte_to_code_unit(range->start_point.column, shift);
+  range->end_point.column = byte_to_code_unit(range->end_point.column, shift);
 }
 
-static void unmarshal_range(TSRange *range) {
-  range->start_byte = code_unit_to_byte(range->start_byte);
-  range->end_byte = code_unit_to_byte(range->end_byte);
-  range->start_point.column = code_unit_to_byte(range->start_point.column);
-  range->end_point.column = code_unit_to_byte(range->end_point.column);
+static void unmarshal_range(TSRange *range, uint32_t shift) {
+  range->start_byte = code_unit_to_byte(range->start_byte, shift);
+  range->end_byte = code_unit_to_byte(range->end_byte, shift);
+  range->start_point.column = code_unit_to_byte(range->start_point.column, shift);
+  range->end_point.column = code_unit_to_byte(range->end_point.column, shift);
 }
 
-static TSInputEdit unmarshal_edit() {
+static TSInputEdit unmarshal_edit(uint32_t shift) {
   TSInputEdit edit;
   const void **address = TRANSFER_BUFFER;
-  edit.start_point = unmarshal_point(address); address += 2;
-  edit.old_end_point = unmarshal_point(address); address += 2;
-  edit.new_end_point = unmarshal_point(address); address += 2;
-  edit.start_byte = code_unit_to_byte((uint32_t)*address); address += 1;
-  edit.old_end_byte = code_unit_to_byte((uint32_t)*address); address += 1;
-  edit.new_end_byte = code_unit_to_byte((uint32_t)*address); address += 1;
+  edit.start_point = unmarshal_point(address, shift); address += 2;
+  edit.old_end_point = unmarshal_point(address, shift); address += 2;
+  edit.new_end_point = unmarshal_point(address, shift); address += 2;
+  edit.start_byte = code_unit_to_byte((uint32_t)*address, shift); address += 1;
+  edit.old_end_byte = code_unit_to_byte((uint32_t)*address, shift); address += 1;
+  edit.new_end_byte = code_unit_to_byte((uint32_t)*address, shift); address += 1;
   return edit;
 }
 
@@ -127,15 +161,16 @@ static const char *call_parse_callback(
   TSPoint position,
   uint32_t *bytes_read
 ) {
+  // The callback always provides UTF-16 text.
   char *buffer = (char *)payload;
   tree_sitter_parse_callback(
     buffer,
-    byte_to_code_unit(byte),
+    byte >> 1,
     position.row,
-    byte_to_code_unit(position.column),
+    position.column >> 1,
     bytes_read
   );
-  *bytes_read = code_unit_to_byte(*bytes_read);
+  *bytes_read = *bytes_read << 1;
   if (*bytes_read >= INPUT_BUFFER_SIZE) {
     *bytes_read = INPUT_BUFFER_SIZE - 2;
   }
@@ -157,6 +192,11 @@ void ts_parser_new_wasm() {
   TRANSFER_BUFFER[1] = input_buffer;
 }
 
+void ts_parser_delete_wasm(TSParser *self) {
+  set_uses_byte_offsets(self, false);
+  ts_parser_delete(self);
+}
+
 void ts_parser_enable_logger_wasm(TSParser *self, bool should_log) {
   TSLogger logger = {self, should_log ? call_log_callback : NULL};
   ts_parser_set_logger(self, logger);
@@ -174,25 +214,55 @@ TSTree *ts_parser_parse_wasm(
     call_parse_callback,
     TSInputEncodingUTF16
   };
+  set_uses_byte_offsets(self, false);
   if (range_count) {
     for (unsigned i = 0; i < range_count; i++) {
-      unmarshal_range(&ranges[i]);
+      unmarshal_range(&ranges[i], 1);
     }
     ts_parser_set_included_ranges(self, ranges, range_count);
     free(ranges);
   } else {
     ts_parser_set_included_ranges(self, NULL, 0);
   }
-  return ts_parser_parse(self, old_tree, input);
+  TSTree *result = ts_parser_parse(self, old_tree, input);
+  if (result) set_uses_byte_offsets(result, false);
+  return result;
+}
+
+TSTree *ts_parser_parse_utf8_wasm(
+  TSParser *self,
+  const char *string,
+  uint32_t length,
+  const TSTree *old_tree,
+  TSRange *ranges,
+  uint32_t range_count
+) {
+  set_uses_byte_offsets(self, true);
+  if (range_count) {
+    ts_parser_set_included_ranges(self, ranges, range_count);
+    free(ranges);
+  } else {
+    ts_parser_set_included_ranges(self, NULL, 0);
+  }
+  TSTree *result = ts_parser_parse_string_encoding(
+    self,
+    old_tree,
+    string,
+    length,
+    TSInputEncodingUTF8
+  );
+  if (result) set_uses_byte_offsets(result, true);
+  return result;
 }
 
 void ts_parser_included_ranges_wasm(TSParser *self) {
+  uint32_t shift = code_unit_shift(self);
   uint32_t range_count = 0;
   const TSRange *ranges = ts_parser_included_ranges(self, &range_count);
   TSRange *copied_ranges = malloc(sizeof(TSRange) * range_count);
   memcpy(copied_ranges, ranges, sizeof(TSRange) * range_count);
   for (unsigned i = 0; i < range_count; i++) {
-    marshal_range(&copied_ranges[i]);
+    marshal_range(&copied_ranges[i], shift);
   }
   TRANSFER_BUFFER[0] = range_count ? (const void *)range_count : NULL;
   TRANSFER_BUFFER[1] = copied_ranges;
@@ -216,39 +286,55 @@ int ts_language_type_is_visible_wasm(const TSLanguage *self, TSSymbol typeId) {
 /* Section - Tree */
 /******************/
 
+TSTree *ts_tree_copy_wasm(const TSTree *tree) {
+  TSTree *result = ts_tree_copy(tree);
+  set_uses_byte_offsets(result, uses_byte_offsets(tree));
+  return result;
+}
+
+void ts_tree_delete_wasm(TSTree *tree) {
+  set_uses_byte_offsets(tree, false);
+  ts_tree_delete(tree);
+}
+
 void ts_tree_root_node_wasm(const TSTree *tree) {
-  marshal_node(TRANSFER_BUFFER, ts_tree_root_node(tree));
+  uint32_t shift = code_unit_shift(tree);
+  marshal_node(TRANSFER_BUFFER, ts_tree_root_node(tree), shift);
 }
 
 void ts_tree_root_node_with_offset_wasm(const TSTree *tree) {
+  uint32_t shift = code_unit_shift(tree);
   // read int and point from transfer buffer
   const void **address = TRANSFER_BUFFER + 5;
-  uint32_t offset = code_unit_to_byte((uint32_t)address[0]);
-  TSPoint extent = unmarshal_point(address + 1);
+  uint32_t offset = code_unit_to_byte((uint32_t)address[0], shift);
+  TSPoint extent = unmarshal_point(address + 1, shift);
   TSNode node = ts_tree_root_node_with_offset(tree, offset, extent);
-  marshal_node(TRANSFER_BUFFER, node);
+  marshal_node(TRANSFER_BUFFER, node, shift);
 }
 
 void ts_tree_edit_wasm(TSTree *tree) {
-  TSInputEdit edit = unmarshal_edit();
+  uint32_t shift = code_unit_shift(tree);
+  TSInputEdit edit = unmarshal_edit(shift);
   ts_tree_edit(tree, &edit);
 }
 
 void ts_tree_included_ranges_wasm(const TSTree *tree) {
+  uint32_t shift = code_unit_shift(tree);
   uint32_t range_count;
   TSRange *ranges = ts_tree_included_ranges(tree, &range_count);
   for (unsigned i = 0; i < range_count; i++) {
-    marshal_range(&ranges[i]);
+    marshal_range(&ranges[i], shift);
   }
   TRANSFER_BUFFER[0] = (range_count ? (const void *)range_count : NULL);
   TRANSFER_BUFFER[1] = (const void *)ranges;
 }
 
 void ts_tree_get_changed_ranges_wasm(TSTree *tree, TSTree *other) {
+  uint32_t shift = code_unit_shift(tree);
   unsigned range_count;
   TSRange *ranges = ts_tree_get_changed_ranges(tree, other, &range_count);
   for (unsigned i = 0; i < range_count; i++) {
-    marshal_range(&ranges[i]);
+    marshal_range(&ranges[i], shift);
   }
   TRANSFER_BUFFER[0] = (const void *)range_count;
   TRANSFER_BUFFER[1] = (const void *)ranges;
@@ -259,7 +345,8 @@ void ts_tree_get_changed_ranges_wasm(TSTree *tree, TSTree *other) {
 /************************/
 
 void ts_tree_cursor_new_wasm(const TSTree *tree) {
-  TSNode node = unmarshal_node(tree);
+  uint32_t shift = code_unit_shift(tree);
+  TSNode node = unmarshal_node(tree, shift);
   TSTreeCursor cursor = ts_tree_cursor_new(node);
   marshal_cursor(&cursor);
 }
@@ -270,7 +357,8 @@ void ts_tree_cursor_delete_wasm(const TSTree *tree) {
 }
 
 void ts_tree_cursor_reset_wasm(const TSTree *tree) {
-  TSNode node = unmarshal_node(tree);
+  uint32_t shift = code_unit_shift(tree);
+  TSNode node = unmarshal_node(tree, shift);
   TSTreeCursor cursor = unmarshal_cursor(&TRANSFER_BUFFER[5], tree);
   ts_tree_cursor_reset(&cursor, node);
   marshal_cursor(&cursor);
@@ -300,7 +388,8 @@ bool ts_tree_cursor_goto_last_child_wasm(const TSTree *tree) {
 bool ts_tree_cursor_goto_first_child_for_index_wasm(const TSTree *tree) {
   TSTreeCursor cursor = unmarshal_cursor(TRANSFER_BUFFER, tree);
   const void **address = TRANSFER_BUFFER + 3;
-  uint32_t index = code_unit_to_byte((uint32_t)address[0]);
+  uint32_t shift = code_unit_shift(tree);
+  uint32_t index = code_unit_to_byte((uint32_t)address[0], shift);
   bool result = ts_tree_cursor_goto_first_child_for_byte(&cursor, index);
   marshal_cursor(&cursor);
   return result;
@@ -309,7 +398,8 @@ bool ts_tree_cursor_goto_first_child_for_index_wasm(const TSTree *tree) {
 bool ts_tree_cursor_goto_first_child_for_position_wasm(const TSTree *tree) {
   TSTreeCursor cursor = unmarshal_cursor(TRANSFER_BUFFER, tree);
   const void **address = TRANSFER_BUFFER + 3;
-  TSPoint point = unmarshal_point(address);
+  uint32_t shift = code_unit_shift(tree);
+  TSPoint point = unmarshal_point(address, shift);
   bool result = ts_tree_cursor_goto_first_child_for_point(&cursor, point);
   marshal_cursor(&cursor);
   return result;
@@ -375,25 +465,29 @@ uint32_t ts_tree_cursor_current_node_id_wasm(const TSTree *tree) {
 void ts_tree_cursor_start_position_wasm(const TSTree *tree) {
   TSTreeCursor cursor = unmarshal_cursor(TRANSFER_BUFFER, tree);
   TSNode node = ts_tree_cursor_current_node(&cursor);
-  marshal_point(ts_node_start_point(node));
+  uint32_t shift = code_unit_shift(tree);
+  marshal_point(ts_node_start_point(node), shift);
 }
 
 void ts_tree_cursor_end_position_wasm(const TSTree *tree) {
   TSTreeCursor cursor = unmarshal_cursor(TRANSFER_BUFFER, tree);
   TSNode node = ts_tree_cursor_current_node(&cursor);
-  marshal_point(ts_node_end_point(node));
+  uint32_t shift = code_unit_shift(tree);
+  marshal_point(ts_node_end_point(node), shift);
 }
 
 uint32_t ts_tree_cursor_start_index_wasm(const TSTree *tree) {
   TSTreeCursor cursor = unmarshal_cursor(TRANSFER_BUFFER, tree);
   TSNode node = ts_tree_cursor_current_node(&cursor);
-  return byte_to_code_unit(ts_node_start_byte(node));
+  uint32_t shift = code_unit_shift(tree);
+  return byte_to_code_unit(ts_node_start_byte(node), shift);
 }
 
 uint32_t ts_tree_cursor_end_index_wasm(const TSTree *tree) {
   TSTreeCursor cursor = unmarshal_cursor(TRANSFER_BUFFER, tree);
   TSNode node = ts_tree_cursor_current_node(&cursor);
-  return byte_to_code_unit(ts_node_end_byte(node));
+  uint32_t shift = code_unit_shift(tree);
+  return byte_to_code_unit(ts_node_end_byte(node), shift);
 }
 
 uint32_t ts_tree_cursor_current_field_id_wasm(const TSTree *tree) {
@@ -413,7 +507,8 @@ uint32_t ts_tree_cursor_current_descendant_index_wasm(const TSTree *tree) {
 
 void ts_tree_cursor_current_node_wasm(const TSTree *tree) {
   TSTreeCursor cursor = unmarshal_cursor(TRANSFER_BUFFER, tree);
-  marshal_node(TRANSFER_BUFFER, ts_tree_cursor_current_node(&cursor));
+  uint32_t shift = code_unit_shift(tree);
+  marshal_node(TRANSFER_BUFFER, ts_tree_cursor_current_node(&cursor), shift);
 }
 
 /******************/
@@ -424,17 +519,20 @@ static TSTreeCursor scratch_cursor = {0};
 static TSQueryCursor *scratch_query_cursor = NULL;
 
 uint16_t ts_node_symbol_wasm(const TSTree *tree) {
-  TSNode node = unmarshal_node(tree);
+  uint32_t shift = code_unit_shift(tree);
+  TSNode node = unmarshal_node(tree, shift);
   return ts_node_symbol(node);
 }
 
 const char *ts_node_field_name_for_child_wasm(const TSTree *tree, uint32_t index) {
-  TSNode node = unmarshal_node(tree);
+  uint32_t shift = code_unit_shift(tree);
+  TSNode node = unmarshal_node(tree, shift);
   return ts_node_field_name_for_child(node, index);
 }
 
 void ts_node_children_by_field_id_wasm(const TSTree *tree, uint32_t field_id) {
-  TSNode node = unmarshal_node(tree);
+  uint32_t shift = code_unit_shift(tree);
+  TSNode node = unmarshal_node(tree, shift);
   TSTreeCursor cursor = ts_tree_cursor_new(node);
 
   bool done = field_id == 0;
@@ -460,7 +558,7 @@ void ts_node_children_by_field_id_wasm(const TSTree *tree, uint32_t field_id) {
       done = true;
     }
     array_grow_by(&result, 5);
-    marshal_node(result.contents + result.size - 5, result_node);
+    marshal_node(result.contents + result.size - 5, result_node, shift);
   }
   ts_tree_cursor_delete(&cursor);
 
@@ -469,138 +567,162 @@ void ts_node_children_by_field_id_wasm(const TSTree *tree, uint32_t field_id) {
 }
 
 void ts_node_first_child_for_byte_wasm(const TSTree *tree) {
-  TSNode node = unmarshal_node(tree);
+  uint32_t shift = code_unit_shift(tree);
+  TSNode node = unmarshal_node(tree, shift);
   const void** address = TRANSFER_BUFFER + 5;
-  uint32_t byte = code_unit_to_byte((uint32_t)address[0]);
-  marshal_node(TRANSFER_BUFFER, ts_node_first_child_for_byte(node, byte));
+  uint32_t byte = code_unit_to_byte((uint32_t)address[0], shift);
+  marshal_node(TRANSFER_BUFFER, ts_node_first_child_for_byte(node, byte), shift);
 }
 
 void ts_node_first_named_child_for_byte_wasm(const TSTree *tree) {
-  TSNode node = unmarshal_node(tree);
+  uint32_t shift = code_unit_shift(tree);
+  TSNode node = unmarshal_node(tree, shift);
   const void** address = TRANSFER_BUFFER + 5;
-  uint32_t byte = code_unit_to_byte((uint32_t)address[0]);
-  marshal_node(TRANSFER_BUFFER, ts_node_first_named_child_for_byte(node, byte));
+  uint32_t byte = code_unit_to_byte((uint32_t)address[0], shift);
+  marshal_node(TRANSFER_BUFFER, ts_node_first_named_child_for_byte(node, byte), shift);
 }
 
 uint16_t ts_node_grammar_symbol_wasm(const TSTree *tree) {
-  TSNode node = unmarshal_node(tree);
+  uint32_t shift = code_unit_shift(tree);
+  TSNode node = unmarshal_node(tree, shift);
   return ts_node_grammar_symbol(node);
 }
 
 uint32_t ts_node_child_count_wasm(const TSTree *tree) {
-  TSNode node = unmarshal_node(tree);
+  uint32_t shift = code_unit_shift(tree);
+  TSNode node = unmarshal_node(tree, shift);
   return ts_node_child_count(node);
 }
 
 uint32_t ts_node_named_child_count_wasm(const TSTree *tree) {
-  TSNode node = unmarshal_node(tree);
+  uint32_t shift = code_unit_shift(tree);
+  TSNode node = unmarshal_node(tree, shift);
   return ts_node_named_child_count(node);
 }
 
 void ts_node_child_wasm(const TSTree *tree, uint32_t index) {
-  TSNode node = unmarshal_node(tree);
-  marshal_node(TRANSFER_BUFFER, ts_node_child(node, index));
+  uint32_t shift = code_unit_shift(tree);
+  TSNode node = unmarshal_node(tree, shift);
+  marshal_node(TRANSFER_BUFFER, ts_node_child(node, index), shift);
 }
 
 void ts_node_named_child_wasm(const TSTree *tree, uint32_t index) {
-  TSNode node = unmarshal_node(tree);
-  marshal_node(TRANSFER_BUFFER, ts_node_named_child(node, index));
+  uint32_t shift = code_unit_shift(tree);
+  TSNode node = unmarshal_node(tree, shift);
+  marshal_node(TRANSFER_BUFFER, ts_node_named_child(node, index), shift);
 }
 
 void ts_node_child_by_field_id_wasm(const TSTree *tree, uint32_t field_id) {
-  TSNode node = unmarshal_node(tree);
-  marshal_node(TRANSFER_BUFFER, ts_node_child_by_field_id(node, field_id));
+  uint32_t shift = code_unit_shift(tree);
+  TSNode node = unmarshal_node(tree, shift);
+  marshal_node(TRANSFER_BUFFER, ts_node_child_by_field_id(node, field_id), shift);
 }
 
 void ts_node_next_sibling_wasm(const TSTree *tree) {
-  TSNode node = unmarshal_node(tree);
-  marshal_node(TRANSFER_BUFFER, ts_node_next_sibling(node));
+  uint32_t shift = code_unit_shift(tree);
+  TSNode node = unmarshal_node(tree, shift);
+  marshal_node(TRANSFER_BUFFER, ts_node_next_sibling(node), shift);
 }
 
 void ts_node_prev_sibling_wasm(const TSTree *tree) {
-  TSNode node = unmarshal_node(tree);
-  marshal_node(TRANSFER_BUFFER, ts_node_prev_sibling(node));
+  uint32_t shift = code_unit_shift(tree);
+  TSNode node = unmarshal_node(tree, shift);
+  marshal_node(TRANSFER_BUFFER, ts_node_prev_sibling(node), shift);
 }
 
 void ts_node_next_named_sibling_wasm(const TSTree *tree) {
-  TSNode node = unmarshal_node(tree);
-  marshal_node(TRANSFER_BUFFER, ts_node_next_named_sibling(node));
+  uint32_t shift = code_unit_shift(tree);
+  TSNode node = unmarshal_node(tree, shift);
+  marshal_node(TRANSFER_BUFFER, ts_node_next_named_sibling(node), shift);
 }
 
 void ts_node_prev_named_sibling_wasm(const TSTree *tree) {
-  TSNode node = unmarshal_node(tree);
-  marshal_node(TRANSFER_BUFFER, ts_node_prev_named_sibling(node));
+  uint32_t shift = code_unit_shift(tree);
+  TSNode node = unmarshal_node(tree, shift);
+  marshal_node(TRANSFER_BUFFER, ts_node_prev_named_sibling(node), shift);
 }
 
 uint32_t ts_node_descendant_count_wasm(const TSTree *tree) {
-  TSNode node = unmarshal_node(tree);
+  uint32_t shift = code_unit_shift(tree);
+  TSNode node = unmarshal_node(tree, shift);
   return ts_node_descendant_count(node);
 }
 
 void ts_node_parent_wasm(const TSTree *tree) {
-  TSNode node = unmarshal_node(tree);
-  marshal_node(TRANSFER_BUFFER, ts_node_parent(node));
+  uint32_t shift = code_unit_shift(tree);
+  TSNode node = unmarshal_node(tree, shift);
+  marshal_node(TRANSFER_BUFFER, ts_node_parent(node), shift);
 }
 
 void ts_node_descendant_for_index_wasm(const TSTree *tree) {
-  TSNode node = unmarshal_node(tree);
+  uint32_t shift = code_unit_shift(tree);
+  TSNode node = unmarshal_node(tree, shift);
   const void **address = TRANSFER_BUFFER + 5;
-  uint32_t start = code_unit_to_byte((uint32_t)address[0]);
-  uint32_t end = code_unit_to_byte((uint32_t)address[1]);
-  marshal_node(TRANSFER_BUFFER, ts_node_descendant_for_byte_range(node, start, end));
+  uint32_t start = code_unit_to_byte((uint32_t)address[0], shift);
+  uint32_t end = code_unit_to_byte((uint32_t)address[1], shift);
+  marshal_node(TRANSFER_BUFFER, ts_node_descendant_for_byte_range(node, start, end), shift);
 }
 
 void ts_node_named_descendant_for_index_wasm(const TSTree *tree) {
-  TSNode node = unmarshal_node(tree);
+  uint32_t shift = code_unit_shift(tree);
+  TSNode node = unmarshal_node(tree, shift);
   const void **address = TRANSFER_BUFFER + 5;
-  uint32_t start = code_unit_to_byte((uint32_t)address[0]);
-  uint32_t end = code_unit_to_byte((uint32_t)address[1]);
-  marshal_node(TRANSFER_BUFFER, ts_node_named_descendant_for_byte_range(node, start, end));
+  uint32_t start = code_unit_to_byte((uint32_t)address[0], shift);
+  uint32_t end = code_unit_to_byte((uint32_t)address[1], shift);
+  marshal_node(TRANSFER_BUFFER, ts_node_named_descendant_for_byte_range(node, start, end), shift);
 }
 
 void ts_node_descendant_for_position_wasm(const TSTree *tree) {
-  TSNode node = unmarshal_node(tree);
+  uint32_t shift = code_unit_shift(tree);
+  TSNode node = unmarshal_node(tree, shift);
   const void **address = TRANSFER_BUFFER + 5;
-  TSPoint start = unmarshal_point(address); address += 2;
-  TSPoint end = unmarshal_point(address);
-  marshal_node(TRANSFER_BUFFER, ts_node_descendant_for_point_range(node, start, end));
+  TSPoint start = unmarshal_point(address, shift); address += 2;
+  TSPoint end = unmarshal_point(address, shift);
+  marshal_node(TRANSFER_BUFFER, ts_node_descendant_for_point_range(node, start, end), shift);
 }
 
 void ts_node_named_descendant_for_position_wasm(const TSTree *tree) {
-  TSNode node = unmarshal_node(tree);
+  uint32_t shift = code_unit_shift(tree);
+  TSNode node = unmarshal_node(tree, shift);
   const void **address = TRANSFER_BUFFER + 5;
-  TSPoint start = unmarshal_point(address); address += 2;
-  TSPoint end = unmarshal_point(address);
-  marshal_node(TRANSFER_BUFFER, ts_node_named_descendant_for_point_range(node, start, end));
+  TSPoint start = unmarshal_point(address, shift); address += 2;
+  TSPoint end = unmarshal_point(address, shift);
+  marshal_node(TRANSFER_BUFFER, ts_node_named_descendant_for_point_range(node, start, end), shift);
 }
 
 void ts_node_start_point_wasm(const TSTree *tree) {
-  TSNode node = unmarshal_node(tree);
-  marshal_point(ts_node_start_point(node));
+  uint32_t shift = code_unit_shift(tree);
+  TSNode node = unmarshal_node(tree, shift);
+  marshal_point(ts_node_start_point(node), shift);
 }
 
 void ts_node_end_point_wasm(const TSTree *tree) {
-  TSNode node = unmarshal_node(tree);
-  marshal_point(ts_node_end_point(node));
+  uint32_t shift = code_unit_shift(tree);
+  TSNode node = unmarshal_node(tree, shift);
+  marshal_point(ts_node_end_point(node), shift);
 }
 
 uint32_t ts_node_start_index_wasm(const TSTree *tree) {
-  TSNode node = unmarshal_node(tree);
-  return byte_to_code_unit(ts_node_start_byte(node));
+  uint32_t shift = code_unit_shift(tree);
+  TSNode node = unmarshal_node(tree, shift);
+  return byte_to_code_unit(ts_node_start_byte(node), shift);
 }
 
 uint32_t ts_node_end_index_wasm(const TSTree *tree) {
-  TSNode node = unmarshal_node(tree);
-  return byte_to_code_unit(ts_node_end_byte(node));
+  uint32_t shift = code_unit_shift(tree);
+  TSNode node = unmarshal_node(tree, shift);
+  return byte_to_code_unit(ts_node_end_byte(node), shift);
 }
 
 char *ts_node_to_string_wasm(const TSTree *tree) {
-  TSNode node = unmarshal_node(tree);
+  uint32_t shift = code_unit_shift(tree);
+  TSNode node = unmarshal_node(tree, shift);
   return ts_node_string(node);
 }
 
 void ts_node_children_wasm(const TSTree *tree) {
-  TSNode node = unmarshal_node(tree);
+  uint32_t shift = code_unit_shift(tree);
+  TSNode node = unmarshal_node(tree, shift);
   uint32_t count = ts_node_child_count(node);
   const void **result = NULL;
   if (count > 0) {
@@ -608,12 +730,12 @@ void ts_node_children_wasm(const TSTree *tree) {
     const void **address = result;
     ts_tree_cursor_reset(&scratch_cursor, node);
     ts_tree_cursor_goto_first_child(&scratch_cursor);
-    marshal_node(address, ts_tree_cursor_current_node(&scratch_cursor));
+    marshal_node(address, ts_tree_cursor_current_node(&scratch_cursor), shift);
     for (uint32_t i = 1; i < count; i++) {
       address += 5;
       ts_tree_cursor_goto_next_sibling(&scratch_cursor);
       TSNode child = ts_tree_cursor_current_node(&scratch_cursor);
-      marshal_node(address, child);
+      marshal_node(address, child, shift);
     }
   }
   TRANSFER_BUFFER[0] = (const void *)count;
@@ -621,7 +743,8 @@ void ts_node_children_wasm(const TSTree *tree) {
 }
 
 void ts_node_named_children_wasm(const TSTree *tree) {
-  TSNode node = unmarshal_node(tree);
+  uint32_t shift = code_unit_shift(tree);
+  TSNode node = unmarshal_node(tree, shift);
   uint32_t count = ts_node_named_child_count(node);
   const void **result = NULL;
   if (count > 0) {
@@ -633,7 +756,7 @@ void ts_node_named_children_wasm(const TSTree *tree) {
     for (;;) {
       TSNode child = ts_tree_cursor_current_node(&scratch_cursor);
       if (ts_node_is_named(child)) {
-        marshal_node(address, child);
+        marshal_node(address, child, shift);
         address += 5;
         i++;
         if (i == count) {
@@ -670,9 +793,10 @@ void ts_node_descendants_of_type_wasm(
   uint32_t end_row,
   uint32_t end_column
 ) {
-  TSNode node = unmarshal_node(tree);
-  TSPoint start_point = {start_row, code_unit_to_byte(start_column)};
-  TSPoint end_point = {end_row, code_unit_to_byte(end_column)};
+  uint32_t shift = code_unit_shift(tree);
+  TSNode node = unmarshal_node(tree, shift);
+  TSPoint start_point = {start_row, code_unit_to_byte(start_column, shift)};
+  TSPoint end_point = {end_row, code_unit_to_byte(end_column, shift)};
   if (end_point.row == 0 && end_point.column == 0) {
     end_point = (TSPoint) {UINT32_MAX, UINT32_MAX};
   }
@@ -709,7 +833,7 @@ void ts_node_descendants_of_type_wasm(
       // node types.
       if (symbols_contain(symbols, symbol_count, ts_node_symbol(descendant))) {
         array_grow_by(&result, 5);
-        marshal_node(result.contents + result.size - 5, descendant);
+        marshal_node(result.contents + result.size - 5, descendant, shift);
       }
 
       // Continue walking.
@@ -738,43 +862,102 @@ void ts_node_descendants_of_type_wasm(
   TRANSFER_BUFFER[1] = result.contents;
 }
 
+// Each node in the array filled by `ts_node_flatten_wasm` is described
+// by this many words. The first five are the same as `marshal_node`.
+static const uint32_t FLAT_NODE_STRIDE = 11;
+
+static inline void marshal_flat_node(const void **buffer, TSNode node, uint32_t shift) {
+  TSPoint end_point = ts_node_end_point(node);
+  marshal_node(buffer, node, shift);
+  buffer[5] = (const void *)byte_to_code_unit(ts_node_end_byte(node), shift);
+  buffer[6] = (const void *)end_point.row;
+  buffer[7] = (const void *)byte_to_code_unit(end_point.column, shift);
+  buffer[8] = (const void *)(uint32_t)ts_node_symbol(node);
+}
+
+void ts_node_flatten_wasm(const TSTree *tree) {
+  uint32_t shift = code_unit_shift(tree);
+  TSNode node = unmarshal_node(tree, shift);
+  uint32_t count = ts_node_descendant_count(node);
+  const void **result = calloc(sizeof(void *), FLAT_NODE_STRIDE * count);
+  Array(uint32_t) parent_indices = array_new();
+
+  // Walk the tree in pre-order, keeping a stack of the indices of
+  // the current node's ancestors.
+  ts_tree_cursor_reset(&scratch_cursor, node);
+  uint32_t index = 0;
+  for (;;) {
+    const void **address = result + FLAT_NODE_STRIDE * index;
+    marshal_flat_node(address, ts_tree_cursor_current_node(&scratch_cursor), shift);
+    address[9] = (const void *)(uint32_t)ts_tree_cursor_current_field_id(&scratch_cursor);
+    address[10] = (const void *)(parent_indices.size
+      ? *array_back(&parent_indices)
+      : UINT32_MAX);
+    index++;
+
+    if (ts_tree_cursor_goto_first_child(&scratch_cursor)) {
+      array_push(&parent_indices, index - 1);
+      continue;
+    }
+    while (!ts_tree_cursor_goto_next_sibling(&scratch_cursor)) {
+      if (!parent_indices.size || !ts_tree_cursor_goto_parent(&scratch_cursor)) {
+        goto done;
+      }
+      parent_indices.size--;
+    }
+  }
+
+done:
+  array_delete(&parent_indices);
+  TRANSFER_BUFFER[0] = (const void *)index;
+  TRANSFER_BUFFER[1] = result;
+}
+
 int ts_node_is_named_wasm(const TSTree *tree) {
-  TSNode node = unmarshal_node(tree);
+  uint32_t shift = code_unit_shift(tree);
+  TSNode node = unmarshal_node(tree, shift);
   return ts_node_is_named(node);
 }
 
 int ts_node_has_changes_wasm(const TSTree *tree) {
-  TSNode node = unmarshal_node(tree);
+  uint32_t shift = code_unit_shift(tree);
+  TSNode node = unmarshal_node(tree, shift);
   return ts_node_has_changes(node);
 }
 
 int ts_node_has_error_wasm(const TSTree *tree) {
-  TSNode node = unmarshal_node(tree);
+  uint32_t shift = code_unit_shift(tree);
+  TSNode node = unmarshal_node(tree, shift);
   return ts_node_has_error(node);
 }
 
 int ts_node_is_error_wasm(const TSTree *tree) {
-  TSNode node = unmarshal_node(tree);
+  uint32_t shift = code_unit_shift(tree);
+  TSNode node = unmarshal_node(tree, shift);
   return ts_node_is_error(node);
 }
 
 int ts_node_is_missing_wasm(const TSTree *tree) {
-  TSNode node = unmarshal_node(tree);
+  uint32_t shift = code_unit_shift(tree);
+  TSNode node = unmarshal_node(tree, shift);
   return ts_node_is_missing(node);
 }
 
 int ts_node_is_extra_wasm(const TSTree *tree) {
-  TSNode node = unmarshal_node(tree);
+  uint32_t shift = code_unit_shift(tree);
+  TSNode node = unmarshal_node(tree, shift);
   return ts_node_is_extra(node);
 }
 
 uint16_t ts_node_parse_state_wasm(const TSTree *tree) {
-  TSNode node = unmarshal_node(tree);
+  uint32_t shift = code_unit_shift(tree);
+  TSNode node = unmarshal_node(tree, shift);
   return ts_node_parse_state(node);
 }
 
 uint16_t ts_node_next_parse_state_wasm(const TSTree *tree) {
-  TSNode node = unmarshal_node(tree);
+  uint32_t shift = code_unit_shift(tree);
+  TSNode node = unmarshal_node(tree, shift);
   return ts_node_next_parse_state(node);
 }
 
@@ -803,9 +986,10 @@ void ts_query_matches_wasm(
     ts_query_cursor_set_match_limit(scratch_query_cursor, match_limit);
   }
 
-  TSNode node = unmarshal_node(tree);
-  TSPoint start_point = {start_row, code_unit_to_byte(start_column)};
-  TSPoint end_point = {end_row, code_unit_to_byte(end_column)};
+  uint32_t shift = code_unit_shift(tree);
+  TSNode node = unmarshal_node(tree, shift);
+  TSPoint start_point = {start_row, code_unit_to_byte(start_column, shift)};
+  TSPoint end_point = {end_row, code_unit_to_byte(end_column, shift)};
   ts_query_cursor_set_point_range(scratch_query_cursor, start_point, end_point);
   ts_query_cursor_set_byte_range(scratch_query_cursor, start_index, end_index);
   ts_query_cursor_set_match_limit(scratch_query_cursor, match_limit);
@@ -825,7 +1009,7 @@ void ts_query_matches_wasm(
     for (unsigned i = 0; i < match.capture_count; i++) {
       const TSQueryCapture *capture = &match.captures[i];
       result.contents[index++] = (const void *)capture->index;
-      marshal_node(result.contents + index, capture->node);
+      marshal_node(result.contents + index, capture->node, shift);
       index += 5;
     }
   }
@@ -855,9 +1039,10 @@ void ts_query_captures_wasm(
 
   ts_query_cursor_set_match_limit(scratch_query_cursor, match_limit);
 
-  TSNode node = unmarshal_node(tree);
-  TSPoint start_point = {start_row, code_unit_to_byte(start_column)};
-  TSPoint end_point = {end_row, code_unit_to_byte(end_column)};
+  uint32_t shift = code_unit_shift(tree);
+  TSNode node = unmarshal_node(tree, shift);
+  TSPoint start_point = {start_row, code_unit_to_byte(start_column, shift)};
+  TSPoint end_point = {end_row, code_unit_to_byte(end_column, shift)};
   ts_query_cursor_set_point_range(scratch_query_cursor, start_point, end_point);
   ts_query_cursor_set_byte_range(scratch_query_cursor, start_index, end_index);
   ts_query_cursor_set_match_limit(scratch_query_cursor, match_limit);
@@ -884,7 +1069,7 @@ void ts_query_captures_wasm(
     for (unsigned i = 0; i < match.capture_count; i++) {
       const TSQueryCapture *capture = &match.captures[i];
       result.contents[index++] = (const void *)capture->index;
-      marshal_node(result.contents + index, capture->node);
+      marshal_node(result.contents + index, capture->node, shift);
       index += 5;
     }
   }
@@ -895,3 +1080,80 @@ void ts_query_captures_wasm(
   TRANSFER_BUFFER[1] = result.contents;
   TRANSFER_BUFFER[2] = (const void *)(did_exceed_match_limit);
 }
+
+// Each capture in the array filled by `ts_query_captures_flat_wasm` is
+// described by this many words. The first nine are the same as in
+// `ts_node_flatten_wasm`.
+static const uint32_t FLAT_CAPTURE_STRIDE = 12;
+
+void ts_query_captures_flat_wasm(
+  const TSQuery *self,
+  const TSTree *tree,
+  uint32_t start_row,
+  uint32_t start_column,
+  uint32_t end_row,
+  uint32_t end_column,
+  uint32_t start_index,
+  uint32_t end_index,
+  uint32_t match_limit,
+  uint32_t max_start_depth
+) {
+  if (!scratch_query_cursor) {
+    scratch_query_cursor = ts_query_cursor_new();
+  }
+
+  uint32_t shift = code_unit_shift(tree);
+  TSNode node = unmarshal_node(tree, shift);
+  TSPoint start_point = {start_row, code_unit_to_byte(start_column, shift)};
+  TSPoint end_point = {end_row, code_unit_to_byte(end_column, shift)};
+  ts_query_cursor_set_point_range(scratch_query_cursor, start_point, end_point);
+  ts_query_cursor_set_byte_range(scratch_query_cursor, start_index, end_index);
+  ts_query_cursor_set_match_limit(scratch_query_cursor, match_limit);
+  ts_query_cursor_set_max_start_depth(scratch_query_cursor, max_start_depth);
+  ts_query_cursor_exec(scratch_query_cursor, self, node);
+
+  unsigned capture_count = 0;
+  Array(const void *) result = array_new();
+  Array(const void *) matches = array_new();
+
+  TSQueryMatch match;
+  uint32_t capture_index;
+  while (ts_query_cursor_next_capture(
+    scratch_query_cursor,
+    &match,
+    &capture_index
+  )) {
+    capture_count++;
+    const TSQueryCapture *capture = &match.captures[capture_index];
+    array_grow_by(&result, FLAT_CAPTURE_STRIDE);
+    const void **address = result.contents + result.size - FLAT_CAPTURE_STRIDE;
+    marshal_flat_node(address, capture->node, shift);
+    address[9] = (const void *)(uint32_t)match.pattern_index;
+    address[10] = (const void *)capture->index;
+
+    // Predicates can only be evaluated in JavaScript, and they may refer to
+    // any of the match's captures. For patterns that have predicates, store
+    // the whole match in a separate array, in the same format as
+    // `ts_query_captures_wasm`, along with its offset plus one.
+    uint32_t step_count;
+    ts_query_predicates_for_pattern(self, match.pattern_index, &step_count);
+    if (step_count > 0) {
+      address[11] = (const void *)(matches.size + 1);
+      array_grow_by(&matches, 1 + 6 * match.capture_count);
+      unsigned index = matches.size - 6 * match.capture_count - 1;
+      matches.contents[index++] = (const void *)(uint32_t)match.capture_count;
+      for (unsigned i = 0; i < match.capture_count; i++) {
+        matches.contents[index++] = (const void *)match.captures[i].index;
+        marshal_node(matches.contents + index, match.captures[i].node, shift);
+        index += 5;
+      }
+    }
+  }
+
+  bool did_exceed_match_limit =
+    ts_query_cursor_did_exceed_match_limit(scratch_query_cursor);
+  TRANSFER_BUFFER[0] = (const void *)(capture_count);
+  TRANSFER_BUFFER[1] = result.contents;
+  TRANSFER_BUFFER[2] = (const void *)(did_exceed_match_limit);
+  TRANSFER_BUFFER[3] = matches.contents;
+}
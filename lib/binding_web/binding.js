@@ -10,8 +10,11 @@ const SIZE_OF_CURSOR = 4 * SIZE_OF_INT;
 const SIZE_OF_NODE = 5 * SIZE_OF_INT;
 const SIZE_OF_POINT = 2 * SIZE_OF_INT;
 const SIZE_OF_RANGE = 2 * SIZE_OF_INT + 2 * SIZE_OF_POINT;
+const FLAT_NODE_STRIDE = 11;
+const FLAT_CAPTURE_STRIDE = 12;
 const ZERO_POINT = {row: 0, column: 0};
 const QUERY_WORD_REGEX = /[\w-.]*/g;
+const ASCII_REGEX = /^[\x00-\x7F]*$/;
 
 const PREDICATE_STEP_TYPE_CAPTURE = 1;
 const PREDICATE_STEP_TYPE_STRING = 2;
@@ -40,7 +43,7 @@ class ParserImpl {
   }
 
   delete() {
-    C._ts_parser_delete(this[0]);
+    C._ts_parser_delete_wasm(this[0]);
     C._free(this[1]);
     this[0] = 0;
     this[1] = 0;
@@ -73,12 +76,31 @@ class ParserImpl {
   }
 
   parse(callback, oldTree, options) {
-    if (typeof callback === 'string') {
-      currentParseCallback = (index, _) => callback.slice(index);
+    // ASCII strings and UTF-8 byte arrays are copied into linear memory
+    // and parsed in one call. Their positions are byte offsets, which are
+    // identical to UTF-16 code units for ASCII text. An old tree can only
+    // be reused if it was parsed with the same kind of positions.
+    let bytes = null;
+    let textCallback;
+    if (callback instanceof Uint8Array) {
+      bytes = callback;
+      textCallback = (index, _, endIndex) => decodeUTF8(bytes, index, endIndex);
+      if (oldTree && !oldTree.usesByteOffsets) oldTree = null;
+    } else if (typeof callback === 'string') {
+      const string = callback;
+      textCallback = (index, _) => string.slice(index);
+      if (!oldTree || oldTree.usesByteOffsets) {
+        if (ASCII_REGEX.test(string)) {
+          bytes = string;
+        } else {
+          oldTree = null;
+        }
+      }
     } else if (typeof callback === 'function') {
-      currentParseCallback = callback;
+      textCallback = callback;
+      if (oldTree && oldTree.usesByteOffsets) oldTree = null;
     } else {
-      throw new Error('Argument must be a string or a function');
+      throw new Error('Argument must be a string, a Uint8Array, or a function');
     }
 
     if (this.logCallback) {
@@ -101,13 +123,36 @@ class ParserImpl {
       }
     }
 
-    const treeAddress = C._ts_parser_parse_wasm(
-      this[0],
-      this[1],
-      oldTree ? oldTree[0] : 0,
-      rangeAddress,
-      rangeCount,
-    );
+    let treeAddress;
+    if (bytes !== null) {
+      const length = bytes.length;
+      const inputAddress = C._malloc(length || 1);
+      if (typeof bytes === 'string') {
+        for (let i = 0; i < length; i++) {
+          HEAPU8[inputAddress + i] = bytes.charCodeAt(i);
+        }
+      } else {
+        HEAPU8.set(bytes, inputAddress);
+      }
+      treeAddress = C._ts_parser_parse_utf8_wasm(
+        this[0],
+        inputAddress,
+        length,
+        oldTree ? oldTree[0] : 0,
+        rangeAddress,
+        rangeCount,
+      );
+      C._free(inputAddress);
+    } else {
+      currentParseCallback = textCallback;
+      treeAddress = C._ts_parser_parse_wasm(
+        this[0],
+        this[1],
+        oldTree ? oldTree[0] : 0,
+        rangeAddress,
+        rangeCount,
+      );
+    }
 
     if (!treeAddress) {
       currentParseCallback = null;
@@ -115,7 +160,9 @@ class ParserImpl {
       throw new Error('Parsing failed');
     }
 
-    const result = new Tree(INTERNAL, treeAddress, this.language, currentParseCallback);
+    const result = new Tree(INTERNAL, treeAddress, this.language, textCallback);
+    result.usesByteOffsets = bytes !== null;
+    if (bytes instanceof Uint8Array) result.textBytes = bytes;
     currentParseCallback = null;
     currentLogCallback = null;
     return result;
@@ -170,15 +217,20 @@ class Tree {
     this[0] = address;
     this.language = language;
     this.textCallback = textCallback;
+    this.usesByteOffsets = false;
+    this.textBytes = null;
   }
 
   copy() {
-    const address = C._ts_tree_copy(this[0]);
-    return new Tree(INTERNAL, address, this.language, this.textCallback);
+    const address = C._ts_tree_copy_wasm(this[0]);
+    const result = new Tree(INTERNAL, address, this.language, this.textCallback);
+    result.usesByteOffsets = this.usesByteOffsets;
+    result.textBytes = this.textBytes;
+    return result;
   }
 
   delete() {
-    C._ts_tree_delete(this[0]);
+    C._ts_tree_delete_wasm(this[0]);
     this[0] = 0;
   }
 
@@ -607,6 +659,16 @@ class Node {
     return new TreeCursor(INTERNAL, this.tree);
   }
 
+  flatten() {
+    marshalNode(this);
+    C._ts_node_flatten_wasm(this.tree[0]);
+    const count = getValue(TRANSFER_BUFFER, 'i32');
+    const address = getValue(TRANSFER_BUFFER + SIZE_OF_INT, 'i32');
+    const data = HEAPU32.slice(address >> 2, (address >> 2) + count * FLAT_NODE_STRIDE);
+    C._free(address);
+    return new FlatNodes(INTERNAL, this.tree, data, FLAT_NODE_STRIDE);
+  }
+
   toString() {
     marshalNode(this);
     const address = C._ts_node_to_string_wasm(this.tree[0]);
@@ -616,6 +678,96 @@ class Node {
   }
 }
 
+class FlatNodes {
+  constructor(internal, tree, data, stride) {
+    assertInternal(internal);
+    this.tree = tree;
+    this.data = data;
+    this.stride = stride;
+    this.length = data.length / stride;
+  }
+
+  node(index) {
+    const offset = index * this.stride;
+    const result = new Node(INTERNAL, this.tree);
+    result.id = this.data[offset];
+    result.startIndex = this.data[offset + 1];
+    result.startPosition = {row: this.data[offset + 2], column: this.data[offset + 3]};
+    result[0] = this.data[offset + 4];
+    return result;
+  }
+
+  id(index) {
+    return this.data[index * this.stride];
+  }
+
+  startIndex(index) {
+    return this.data[index * this.stride + 1];
+  }
+
+  startPosition(index) {
+    const offset = index * this.stride;
+    return {row: this.data[offset + 2], column: this.data[offset + 3]};
+  }
+
+  endIndex(index) {
+    return this.data[index * this.stride + 5];
+  }
+
+  endPosition(index) {
+    const offset = index * this.stride;
+    return {row: this.data[offset + 6], column: this.data[offset + 7]};
+  }
+
+  typeId(index) {
+    return this.data[index * this.stride + 8];
+  }
+
+  type(index) {
+    return this.tree.language.types[this.typeId(index)] || 'ERROR';
+  }
+
+  text(index) {
+    return getText(this.tree, this.startIndex(index), this.endIndex(index));
+  }
+
+  fieldId(index) {
+    return this.data[index * this.stride + 9];
+  }
+
+  parentIndex(index) {
+    const parentIndex = this.data[index * this.stride + 10];
+    return parentIndex === 0xFFFFFFFF ? -1 : parentIndex;
+  }
+}
+
+class FlatCaptures extends FlatNodes {
+  constructor(internal, tree, data, stride, query) {
+    super(internal, tree, data, stride);
+    this.query = query;
+  }
+
+  patternIndex(index) {
+    return this.data[index * this.stride + 9];
+  }
+
+  captureIndex(index) {
+    return this.data[index * this.stride + 10];
+  }
+
+  name(index) {
+    return this.query.captureNames[this.captureIndex(index)];
+  }
+
+  fieldId() {
+    throw new Error('Field ids are not available for captures');
+  }
+
+  parentIndex() {
+    throw new Error('Parent indices are not available for captures');
+  }
+}
+
 class TreeCursor {
   constructor(internal, tree) {
     assertInternal(internal);
@@ -1395,6 +1547,79 @@ class Query {
     return result;
   }
 
+  capturesFlat(
+    node,
+    {
+      startPosition = ZERO_POINT,
+      endPosition = ZERO_POINT,
+      startIndex = 0,
+      endIndex = 0,
+      matchLimit = 0xFFFFFFFF,
+      maxStartDepth = 0xFFFFFFFF,
+    } = {},
+  ) {
+    if (typeof matchLimit !== 'number') {
+      throw new Error('Arguments must be numbers');
+    }
+
+    marshalNode(node);
+
+    C._ts_query_captures_flat_wasm(
+      this[0],
+      node.tree[0],
+      startPosition.row,
+      startPosition.column,
+      endPosition.row,
+      endPosition.column,
+      startIndex,
+      endIndex,
+      matchLimit,
+      maxStartDepth,
+    );
+
+    const count = getValue(TRANSFER_BUFFER, 'i32');
+    const startAddress = getValue(TRANSFER_BUFFER + SIZE_OF_INT, 'i32');
+    const didExceedMatchLimit = getValue(TRANSFER_BUFFER + 2 * SIZE_OF_INT, 'i32');
+    const matchesAddress = getValue(TRANSFER_BUFFER + 3 * SIZE_OF_INT, 'i32');
+    this.exceededMatchLimit = !!didExceedMatchLimit;
+
+    const start = startAddress >> 2;
+    let data = HEAPU32.slice(start, start + count * FLAT_CAPTURE_STRIDE);
+
+    // Captures from patterns with predicates refer to a copy of their whole match,
+    // which is only needed to evaluate the predicates.
+    if (matchesAddress) {
+      const captures = [];
+      let filteredCount = 0;
+      for (let i = 0; i < count; i++) {
+        const offset = i * FLAT_CAPTURE_STRIDE;
+        const matchOffset = data[offset + 11];
+        if (matchOffset) {
+          let address = matchesAddress + (matchOffset - 1) * SIZE_OF_INT;
+          captures.length = getValue(address, 'i32');
+          address += SIZE_OF_INT;
+          unmarshalCaptures(this, node.tree, address, captures);
+          if (!this.textPredicates[data[offset + 9]].every((p) => p(captures))) {
+            continue;
+          }
+        }
+        if (filteredCount !== i) {
+          data.copyWithin(
+            filteredCount * FLAT_CAPTURE_STRIDE,
+            offset,
+            offset + FLAT_CAPTURE_STRIDE,
+          );
+        }
+        filteredCount++;
+      }
+      data = data.slice(0, filteredCount * FLAT_CAPTURE_STRIDE);
+      C._free(matchesAddress);
+    }
+
+    C._free(startAddress);
+    return new FlatCaptures(INTERNAL, node.tree, data, FLAT_CAPTURE_STRIDE, this);
+  }
+
   predicatesForPattern(patternIndex) {
     return this.predicates[patternIndex];
   }
@@ -1413,6 +1638,10 @@ class Query {
 }
 
 function getText(tree, startIndex, endIndex) {
+  if (tree.textBytes) {
+    return decodeUTF8(tree.textBytes, startIndex, endIndex);
+  }
+
   const length = endIndex - startIndex;
   let result = tree.textCallback(startIndex, null, endIndex);
   startIndex += result.length;
@@ -1431,6 +1660,13 @@ function getText(tree, startIndex, endIndex) {
   return result;
 }
 
+let utf8Decoder;
+
+function decodeUTF8(bytes, startIndex, endIndex) {
+  if (!utf8Decoder) utf8Decoder = new TextDecoder();
+  return utf8Decoder.decode(bytes.subarray(startIndex, endIndex));
+}
+
 function unmarshalCaptures(query, tree, address, result) {
   for (let i = 0, n = result.length; i < n; i++) {
     const captureIndex = getValue(address, 'i32');
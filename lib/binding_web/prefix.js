@@ -4,6 +4,242 @@ var TreeSitter = function() {
     ? {currentScript: window.document.currentScript}
     : null;
 
+  // Parsing in a worker. These classes are defined outside of `init`, so
+  // that the main thread can use them without loading the WASM module.
+
+  function canShareMemory() {
+    return typeof SharedArrayBuffer === 'function' &&
+      (typeof crossOriginIsolated === 'undefined' || crossOriginIsolated);
+  }
+
+  // Listen to a browser `Worker`, a worker's global scope, a `MessagePort`,
+  // or a Node.js `worker_threads` port.
+  function onMessage(port, callback) {
+    if (typeof port.on === 'function') {
+      port.on('message', callback);
+    } else {
+      port.addEventListener('message', (event) => callback(event.data));
+      if (typeof port.start === 'function') port.start();
+    }
+  }
+
+  function decodeUTF16(array, length) {
+    let result = '';
+    for (let i = 0; i < length; i += 8192) {
+      result += String.fromCharCode.apply(null, array.subarray(i, Math.min(i + 8192, length)));
+    }
+    return result;
+  }
+
+  // The nodes of a tree that was parsed in a worker, in the same flattened
+  // format as `SyntaxNode.flatten`. The tree itself stays in the worker, so
+  // the nodes can only be read through their indices.
+  class WorkerFlatNodes {
+    constructor(data, stride, source, language) {
+      this.data = data;
+      this.stride = stride;
+      this.length = data.length / stride;
+      this.source = source;
+      this.language = language;
+    }
+
+    id(index) {
+      return this.data[index * this.stride];
+    }
+
+    startIndex(index) {
+      return this.data[index * this.stride + 1];
+    }
+
+    startPosition(index) {
+      const offset = index * this.stride;
+      return {row: this.data[offset + 2], column: this.data[offset + 3]};
+    }
+
+    endIndex(index) {
+      return this.data[index * this.stride + 5];
+    }
+
+    endPosition(index) {
+      const offset = index * this.stride;
+      return {row: this.data[offset + 6], column: this.data[offset + 7]};
+    }
+
+    typeId(index) {
+      return this.data[index * this.stride + 8];
+    }
+
+    type(index) {
+      return this.language.types[this.typeId(index)] || 'ERROR';
+    }
+
+    text(index) {
+      return this.source.slice(this.startIndex(index), this.endIndex(index));
+    }
+
+    fieldId(index) {
+      return this.data[index * this.stride + 9];
+    }
+
+    parentIndex(index) {
+      const parentIndex = this.data[index * this.stride + 10];
+      return parentIndex === 0xFFFFFFFF ? -1 : parentIndex;
+    }
+  }
+
+  // A parser that runs in a worker which called `Parser.serveWorker`.
+  //
+  // The source code is copied into a `SharedArrayBuffer` when one is
+  // available, and the edits are sent along with each parse. Only one parse
+  // runs at a time. Parses that are requested in the meantime are combined:
+  // their edits are applied together, the most recent text is parsed, and
+  // all of their promises resolve with the result.
+  class WorkerParser {
+    constructor(worker) {
+      this.worker = worker;
+      this.nextRequestId = 0;
+      this.requests = new Map();
+      this.languagePromise = Promise.resolve(null);
+      this.buffer = null;
+      this.isParsing = false;
+      this.pendingParse = null;
+      onMessage(worker, ({id, result, error}) => {
+        const request = this.requests.get(id);
+        if (!request) return;
+        this.requests.delete(id);
+        if (error !== undefined) {
+          request.reject(new Error(error));
+        } else {
+          request.resolve(result);
+        }
+      });
+    }
+
+    init(moduleOptions) {
+      return this.request({type: 'init', moduleOptions}).then(() => {});
+    }
+
+    setLanguage(language) {
+      this.languagePromise = this.request({type: 'setLanguage', language});
+      return this.languagePromise.then(() => {});
+    }
+
+    parse(text, edits = []) {
+      return new Promise((resolve, reject) => {
+        if (this.pendingParse) {
+          this.pendingParse.text = text;
+          this.pendingParse.edits.push(...edits);
+          this.pendingParse.callbacks.push({resolve, reject});
+        } else {
+          this.pendingParse = {text, edits: [...edits], callbacks: [{resolve, reject}]};
+        }
+        if (!this.isParsing) this.sendParse();
+      });
+    }
+
+    delete() {
+      this.request({type: 'delete'});
+    }
+
+    sendParse() {
+      const {text, edits, callbacks} = this.pendingParse;
+      this.pendingParse = null;
+      this.isParsing = true;
+
+      // The worker copies the text out of the shared buffer before it replies,
+      // so the buffer can be reused once the previous parse has finished.
+      const message = {type: 'parse', edits, length: text.length};
+      if (canShareMemory()) {
+        if (!this.buffer || this.buffer.length < text.length) {
+          const capacity = Math.max(text.length, 2 * (this.buffer ? this.buffer.length : 0), 1024);
+          this.buffer = new Uint16Array(new SharedArrayBuffer(2 * capacity));
+        }
+        for (let i = 0; i < text.length; i++) this.buffer[i] = text.charCodeAt(i);
+        message.buffer = this.buffer;
+      } else {
+        message.text = text;
+      }
+
+      const languagePromise = this.languagePromise;
+      this.request(message)
+        .then(async ({data, stride}) => {
+          const language = await languagePromise;
+          const nodes = new WorkerFlatNodes(data, stride, text, language);
+          for (const {resolve} of callbacks) resolve(nodes);
+        }, (error) => {
+          for (const {reject} of callbacks) reject(error);
+        })
+        .finally(() => {
+          this.isParsing = false;
+          if (this.pendingParse) this.sendParse();
+        });
+    }
+
+    request(message) {
+      const id = this.nextRequestId++;
+      return new Promise((resolve, reject) => {
+        this.requests.set(id, {resolve, reject});
+        this.worker.postMessage({id, ...message});
+      });
+    }
+  }
+
+  // Handle the requests of a `WorkerParser` on the other side of `port`.
+  // Requests are handled one at a time, in the order that they were sent.
+  function serveWorker(port) {
+    let parser = null;
+    let tree = null;
+    let queue = Promise.resolve();
+
+    const handlers = {
+      async init({moduleOptions}) {
+        await Parser.init(moduleOptions);
+        parser = new Parser();
+      },
+
+      async setLanguage({language}) {
+        const loadedLanguage = await Parser.Language.load(language);
+        parser.setLanguage(loadedLanguage);
+        if (tree) tree.delete();
+        tree = null;
+        return {types: loadedLanguage.types, fields: loadedLanguage.fields};
+      },
+
+      parse({edits, length, buffer, text}) {
+        if (buffer) text = decodeUTF16(buffer, length);
+        if (tree) {
+          for (const edit of edits) tree.edit(edit);
+        }
+        const newTree = parser.parse(text, tree);
+        if (tree) tree.delete();
+        tree = newTree;
+        const nodes = tree.rootNode.flatten();
+        return {data: nodes.data, stride: nodes.stride};
+      },
+
+      delete() {
+        if (tree) tree.delete();
+        if (parser) parser.delete();
+        tree = parser = null;
+      },
+    };
+
+    onMessage(port, (message) => {
+      queue = queue.then(async () => {
+        try {
+          if (!parser && message.type !== 'init') {
+            throw new Error('The worker parser must be initialized with `init()`');
+          }
+          const result = await handlers[message.type](message);
+          const transfer = result && result.data instanceof Uint32Array ? [result.data.buffer] : [];
+          port.postMessage({id: message.id, result}, transfer);
+        } catch (error) {
+          port.postMessage({id: message.id, error: String(error && error.message || error)});
+        }
+      });
+    });
+  }
+
   class Parser {
     constructor() {
       this.initialize();
@@ -15,6 +15,9 @@
     }
   }
 
+  Parser.WorkerParser = WorkerParser;
+  Parser.serveWorker = serveWorker;
+
   return Parser;
 }();
 
@@ -633,4 +633,42 @@ describe('Node', () => {
       assert.equal(overflow, null);
     });
   });
+
+  describe('.flatten()', () => {
+    it('returns every descendant in pre-order, with their parents and fields', () => {
+      tree = parser.parse('let a = 5; foo(b, "c")');
+      const nodes = getAllNodes(tree);
+      const flat = tree.rootNode.flatten();
+
+      assert.equal(flat.length, nodes.length);
+      assert.equal(flat.parentIndex(0), -1);
+      for (let i = 0; i < flat.length; i++) {
+        const node = nodes[i];
+        assert(flat.node(i).equals(node));
+        assert.equal(flat.type(i), node.type);
+        assert.equal(flat.typeId(i), node.typeId);
+        assert.equal(flat.startIndex(i), node.startIndex);
+        assert.equal(flat.endIndex(i), node.endIndex);
+        assert.deepEqual(flat.startPosition(i), node.startPosition);
+        assert.deepEqual(flat.endPosition(i), node.endPosition);
+        assert.equal(flat.text(i), node.text);
+        if (i > 0) {
+          const parent = nodes[flat.parentIndex(i)];
+          assert(parent.equals(node.parent));
+          const childIndex = parent.children.findIndex((child) => child.equals(node));
+          const fieldName = parent.fieldNameForChild(childIndex);
+          assert.equal(flat.fieldId(i), fieldName ? JavaScript.fieldIdForName(fieldName) : 0);
+        }
+      }
+    });
+
+    it('can flatten a subtree', () => {
+      tree = parser.parse('a(b + c); d');
+      const call = tree.rootNode.firstChild.firstChild;
+      const flat = call.flatten();
+      assert.equal(flat.length, call.descendantCount);
+      assert.equal(flat.type(0), 'call_expression');
+      assert.equal(flat.text(flat.length - 1), ')');
+    });
+  });
 });
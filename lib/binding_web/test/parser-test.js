@@ -244,9 +244,58 @@ describe('Parser', () => {
     });
 
     it('throws an exception when the given input is not a function', () => {
-      assert.throws(() => parser.parse(null), 'Argument must be a string or a function');
-      assert.throws(() => parser.parse(5), 'Argument must be a string or a function');
-      assert.throws(() => parser.parse({}), 'Argument must be a string or a function');
+      assert.throws(() => parser.parse(null), 'Argument must be a string, a Uint8Array, or a function');
+      assert.throws(() => parser.parse(5), 'Argument must be a string, a Uint8Array, or a function');
+      assert.throws(() => parser.parse({}), 'Argument must be a string, a Uint8Array, or a function');
+    });
+
+    it('reads UTF-8 text from a Uint8Array, using byte offsets', () => {
+      const bytes = new TextEncoder().encode('"café" + x');
+      tree = parser.parse(bytes);
+      assert.equal(
+        tree.rootNode.toString(),
+        '(program (expression_statement (binary_expression left: (string (string_fragment)) right: (identifier))))',
+      );
+      assert.isTrue(tree.usesByteOffsets);
+
+      const identifier = tree.rootNode.descendantForIndex(bytes.length - 1);
+      assert.equal(identifier.text, 'x');
+      assert.equal(identifier.startIndex, 10);
+      assert.deepEqual(identifier.startPosition, {row: 0, column: 10});
+      assert.equal(tree.rootNode.firstChild.firstChild.firstChild.text, '"café"');
+    });
+
+    it('reparses UTF-8 input incrementally', () => {
+      const bytes = new TextEncoder().encode('"é" + a');
+      tree = parser.parse(bytes);
+      const newBytes = new TextEncoder().encode('"é" + ab');
+      tree.edit({
+        startIndex: 7,
+        oldEndIndex: 7,
+        newEndIndex: 8,
+        startPosition: {row: 0, column: 7},
+        oldEndPosition: {row: 0, column: 7},
+        newEndPosition: {row: 0, column: 8},
+      });
+      const newTree = parser.parse(newBytes, tree);
+      assert.equal(newTree.rootNode.descendantForIndex(7).text, 'ab');
+
+      const copy = newTree.copy();
+      assert.isTrue(copy.usesByteOffsets);
+      assert.equal(copy.rootNode.text, '"é" + ab');
+      copy.delete();
+      newTree.delete();
+    });
+
+    it('parses ASCII strings using byte offsets', () => {
+      tree = parser.parse('a + b');
+      assert.isTrue(tree.usesByteOffsets);
+      assert.equal(tree.rootNode.descendantForIndex(4).text, 'b');
+
+      const newTree = parser.parse('a + b // é', tree);
+      assert.isFalse(newTree.usesByteOffsets);
+      assert.equal(newTree.rootNode.descendantForIndex(6).text, '// é');
+      newTree.delete();
     });
 
     it('handles long input strings', () => {
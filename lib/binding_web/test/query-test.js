@@ -363,6 +363,40 @@ describe('Query', () => {
     });
   });
 
+  describe('.capturesFlat', () => {
+    it('returns the same captures as .captures, in typed arrays', () => {
+      tree = parser.parse(`
+        const a = b('c');
+        if (d == e) { f = a.g(1); }
+      `);
+      query = JavaScript.query(`
+        (identifier) @id
+        (call_expression function: (_) @call)
+        ((identifier) @ab (#match? @ab "^[ab]$"))
+        ((string) @string (#eq? @string "'c'"))
+        (number) @number
+      `);
+
+      const captures = query.captures(tree.rootNode);
+      const flat = query.capturesFlat(tree.rootNode);
+      assert.equal(flat.length, captures.length);
+      for (let i = 0; i < flat.length; i++) {
+        assert.equal(flat.name(i), captures[i].name);
+        assert(flat.node(i).equals(captures[i].node));
+        assert.equal(flat.type(i), captures[i].node.type);
+        assert.equal(flat.startIndex(i), captures[i].node.startIndex);
+        assert.equal(flat.endIndex(i), captures[i].node.endIndex);
+        assert.deepEqual(flat.endPosition(i), captures[i].node.endPosition);
+      }
+      assert.deepEqual(
+        [...Array(flat.length).keys()]
+          .filter((i) => flat.name(i) === 'ab')
+          .map((i) => flat.text(i)),
+        ['a', 'b', 'a'],
+      );
+    });
+  });
+
   describe('.predicatesForPattern(index)', () => {
     it('returns all of the predicates as objects', () => {
       query = JavaScript.query(`
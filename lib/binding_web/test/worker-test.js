@@ -0,0 +1,83 @@
+const {assert} = require('chai');
+const {Worker} = require('worker_threads');
+let Parser; let JavaScript; let languageURL;
+
+const workerSource = `
+  require(${JSON.stringify(require.resolve('..'))})
+    .serveWorker(require('worker_threads').parentPort);
+`;
+
+describe('WorkerParser', () => {
+  let worker; let workerParser; let parser;
+
+  before(async () =>
+    ({Parser, JavaScript, languageURL} = await require('./helper')),
+  );
+
+  beforeEach(async () => {
+    worker = new Worker(workerSource, {eval: true});
+    workerParser = new Parser.WorkerParser(worker);
+    await workerParser.init();
+    await workerParser.setLanguage(languageURL('javascript'));
+    parser = new Parser().setLanguage(JavaScript);
+  });
+
+  afterEach(async () => {
+    workerParser.delete();
+    parser.delete();
+    await worker.terminate();
+  });
+
+  function assertSameNodes(nodes, source) {
+    const tree = parser.parse(source);
+    const expected = tree.rootNode.flatten();
+    assert.equal(nodes.length, expected.length);
+    assert.deepEqual(Array.from(nodes.data), Array.from(expected.data));
+    for (let i = 0; i < nodes.length; i++) {
+      assert.equal(nodes.type(i), expected.type(i));
+      assert.equal(nodes.text(i), expected.text(i));
+    }
+    tree.delete();
+  }
+
+  it('parses text in the worker', async () => {
+    const source = 'let x = a(b, "é");\ny = [1, 2];';
+    const nodes = await workerParser.parse(source);
+    assertSameNodes(nodes, source);
+    assert.equal(nodes.type(0), 'program');
+    assert.equal(nodes.parentIndex(0), -1);
+  });
+
+  it('reuses the previous tree when given edits', async () => {
+    await workerParser.parse('abc + cde');
+    const nodes = await workerParser.parse('abc * cde', [{
+      startIndex: 4,
+      oldEndIndex: 5,
+      newEndIndex: 5,
+      startPosition: {row: 0, column: 4},
+      oldEndPosition: {row: 0, column: 5},
+      newEndPosition: {row: 0, column: 5},
+    }]);
+    assertSameNodes(nodes, 'abc * cde');
+  });
+
+  it('combines the parses that are requested while the worker is busy', async () => {
+    const first = workerParser.parse('a;');
+    const second = workerParser.parse('a; b;');
+    const third = workerParser.parse('a; b; c;');
+    const results = await Promise.all([first, second, third]);
+    assertSameNodes(results[0], 'a;');
+    assert.strictEqual(results[1], results[2]);
+    assertSameNodes(results[2], 'a; b; c;');
+  });
+
+  it('rejects requests that fail in the worker', async () => {
+    let error;
+    try {
+      await workerParser.setLanguage('/nonexistent/tree-sitter-nothing.wasm');
+    } catch (e) {
+      error = e;
+    }
+    assert.instanceOf(error, Error);
+  });
+});
@@ -5,8 +5,14 @@ declare module 'web-tree-sitter' {
      * @param moduleOptions Optional emscripten module-object, see https://emscripten.org/docs/api_reference/module.html
      */
     static init(moduleOptions?: object): Promise<void>;
+    /**
+     * Handle the requests of a `Parser.WorkerParser` in a worker.
+     *
+     * @param port The worker's global scope, a `MessagePort`, or a Node.js `worker_threads` port
+     */
+    static serveWorker(port: Parser.WorkerPort): void;
     delete(): void;
-    parse(input: string | Parser.Input, oldTree?: Parser.Tree, options?: Parser.Options): Parser.Tree;
+    parse(input: string | Uint8Array | Parser.Input, oldTree?: Parser.Tree, options?: Parser.Options): Parser.Tree;
     getIncludedRanges(): Parser.Range[];
     getTimeoutMicros(): number;
     setTimeoutMicros(timeout: number): void;
@@ -111,6 +117,52 @@ declare module 'web-tree-sitter' {
       descendantsOfType(types: String | Array<String>, startPosition?: Point, endPosition?: Point): Array<SyntaxNode>;
 
       walk(): TreeCursor;
+      flatten(): FlatNodes;
+    }
+
+    export interface FlatNodes {
+      readonly tree: Tree;
+      readonly data: Uint32Array;
+      readonly stride: number;
+      readonly length: number;
+
+      node(index: number): SyntaxNode;
+      id(index: number): number;
+      startIndex(index: number): number;
+      startPosition(index: number): Point;
+      endIndex(index: number): number;
+      endPosition(index: number): Point;
+      typeId(index: number): number;
+      type(index: number): string;
+      text(index: number): string;
+      fieldId(index: number): number;
+      parentIndex(index: number): number;
+    }
+
+    export interface WorkerFlatNodes {
+      readonly data: Uint32Array;
+      readonly stride: number;
+      readonly length: number;
+      readonly source: string;
+
+      id(index: number): number;
+      startIndex(index: number): number;
+      startPosition(index: number): Point;
+      endIndex(index: number): number;
+      endPosition(index: number): Point;
+      typeId(index: number): number;
+      type(index: number): string;
+      text(index: number): string;
+      fieldId(index: number): number;
+      parentIndex(index: number): number;
+    }
+
+    export interface FlatCaptures extends FlatNodes {
+      readonly query: Query;
+
+      patternIndex(index: number): number;
+      captureIndex(index: number): number;
+      name(index: number): string;
     }
 
     export interface TreeCursor {
@@ -146,6 +198,7 @@ declare module 'web-tree-sitter' {
 
     export interface Tree {
       readonly rootNode: SyntaxNode;
+      readonly usesByteOffsets: boolean;
 
       rootNodeWithOffset(offsetBytes: number, offsetExtent: Point): SyntaxNode;
       copy(): Tree;
@@ -196,6 +249,7 @@ declare module 'web-tree-sitter' {
 
       delete(): void;
       captures(node: SyntaxNode, options?: QueryOptions): QueryCapture[];
+      capturesFlat(node: SyntaxNode, options?: QueryOptions): FlatCaptures;
       matches(node: SyntaxNode, options?: QueryOptions): QueryMatch[];
       predicatesForPattern(patternIndex: number): PredicateResult[];
       disableCapture(captureName: string): void;
@@ -226,6 +280,18 @@ declare module 'web-tree-sitter' {
       lookaheadIterator(stateId: number): LookaheadIterable | null;
     }
 
+    export type WorkerPort = {
+      postMessage(message: any, transfer?: any[]): void;
+    };
+
+    export class WorkerParser {
+      constructor(worker: WorkerPort);
+      init(moduleOptions?: object): Promise<void>;
+      setLanguage(language: string | Uint8Array): Promise<void>;
+      parse(text: string, edits?: Edit[]): Promise<WorkerFlatNodes>;
+      delete(): void;
+    }
+
     export class LookaheadIterable {
       readonly language: Language;
       readonly currentTypeId: number;
@@ -26,7 +26,7 @@ extern "C" {
  * The Tree-sitter library is generally backwards-compatible with languages
  * generated using older CLI versions, but is not forwards-compatible.
  */
-#define TREE_SITTER_LANGUAGE_VERSION 14
+#define TREE_SITTER_LANGUAGE_VERSION 15
 
 /**
  * The earliest ABI version that is supported by the current version of the
@@ -34,6 +34,13 @@ extern "C" {
  */
 #define TREE_SITTER_MIN_COMPATIBLE_LANGUAGE_VERSION 13
 
+/**
+ * A value that the `read` function of a [`TSInput`] can write to its
+ * `bytes_read` parameter to indicate that the text at the requested position
+ * is not available yet. See [`ts_parser_parse`] for more information.
+ */
+#define TS_INPUT_PENDING UINT32_MAX
+
 /*******************/
 /* Section - Types */
 /*******************/
@@ -43,10 +50,16 @@ typedef uint16_t TSSymbol;
 typedef uint16_t TSFieldId;
 typedef struct TSLanguage TSLanguage;
 typedef struct TSParser TSParser;
+typedef struct TSParserPool TSParserPool;
 typedef struct TSTree TSTree;
+typedef struct TSTreeReclaimer TSTreeReclaimer;
+typedef struct TSLineIndex TSLineIndex;
 typedef struct TSQuery TSQuery;
 typedef struct TSQueryCursor TSQueryCursor;
+typedef struct TSQuerySession TSQuerySession;
 typedef struct TSLookaheadIterator TSLookaheadIterator;
+typedef struct TSLookaheadTable TSLookaheadTable;
+typedef struct TSSymbolSet TSSymbolSet;
 
 typedef enum TSInputEncoding {
   TSInputEncodingUTF8,
@@ -87,6 +100,24 @@ typedef struct TSLogger {
   void (*log)(void *payload, TSLogType log_type, const char *buffer);
 } TSLogger;
 
+typedef struct TSAllocator {
+  void *payload;
+  void *(*malloc)(void *payload, size_t size);
+  void *(*calloc)(void *payload, size_t count, size_t size);
+  void *(*realloc)(void *payload, void *ptr, size_t size);
+  void (*free)(void *payload, void *ptr);
+} TSAllocator;
+
+typedef enum TSNodeStringFormat {
+  TSNodeStringFormatSExpression,
+  TSNodeStringFormatJSON,
+} TSNodeStringFormat;
+
+typedef struct TSStringWriter {
+  void *payload;
+  void (*write)(void *payload, const char *data, uint32_t length);
+} TSStringWriter;
+
 typedef struct TSInputEdit {
   uint32_t start_byte;
   uint32_t old_end_byte;
@@ -96,12 +127,64 @@ typedef struct TSInputEdit {
   TSPoint new_end_point;
 } TSInputEdit;
 
+typedef struct TSParseStats {
+  uint32_t lex_count;
+  uint32_t external_scan_count;
+  uint64_t lexed_byte_count;
+  uint32_t shift_count;
+  uint32_t reduce_count;
+  uint32_t reused_node_count;
+  uint64_t reused_byte_count;
+  uint32_t token_cache_hit_count;
+  uint32_t token_cache_miss_count;
+  uint32_t version_split_count;
+  uint32_t version_merge_count;
+  uint32_t version_limit_prune_count;
+  uint32_t version_cost_prune_count;
+  uint32_t max_version_count;
+  uint64_t error_recovery_micros;
+} TSParseStats;
+
+typedef struct TSSyntaxCheck {
+  uint32_t error_count;
+  uint32_t missing_count;
+  TSRange first_error;
+} TSSyntaxCheck;
+
+typedef enum TSVersionPruningStrategy {
+  TSVersionPruningStrategyKeepBest,
+  TSVersionPruningStrategyDropNewest,
+} TSVersionPruningStrategy;
+
+typedef struct TSVersionPolicy {
+  uint32_t max_version_count;
+  uint32_t max_cost_difference;
+  TSVersionPruningStrategy strategy;
+} TSVersionPolicy;
+
 typedef struct TSNode {
   uint32_t context[4];
   const void *id;
   const TSTree *tree;
 } TSNode;
 
+typedef enum TSDiffChangeType {
+  TSDiffChangeTypeInsert,
+  TSDiffChangeTypeDelete,
+  TSDiffChangeTypeMove,
+} TSDiffChangeType;
+
+typedef struct TSDiffChange {
+  TSDiffChangeType type;
+  TSNode old_node;
+  TSNode new_node;
+} TSDiffChange;
+
+typedef struct TSStreamCallback {
+  void *payload;
+  void (*emit)(void *payload, TSNode node);
+} TSStreamCallback;
+
 typedef struct TSTreeCursor {
   const void *tree;
   const void *id;
@@ -128,6 +211,13 @@ typedef struct TSQueryMatch {
   const TSQueryCapture *captures;
 } TSQueryMatch;
 
+typedef struct TSQueryPatternStats {
+  uint32_t started_state_count;
+  uint32_t copied_state_count;
+  uint32_t dropped_state_count;
+  uint32_t capture_list_count;
+} TSQueryPatternStats;
+
 typedef enum TSQueryPredicateStepType {
   TSQueryPredicateStepTypeDone,
   TSQueryPredicateStepTypeCapture,
@@ -139,6 +229,43 @@ typedef struct TSQueryPredicateStep {
   uint32_t value_id;
 } TSQueryPredicateStep;
 
+typedef struct TSQueryTextProvider {
+  void *payload;
+  const char *(*text)(void *payload, TSNode node, uint32_t *length);
+} TSQueryTextProvider;
+
+typedef struct TSQueryRegexEngine {
+  void *payload;
+  void *(*compile)(void *payload, const char *pattern, uint32_t length);
+  bool (*is_match)(void *payload, const void *regex, const char *text, uint32_t length);
+  void (*destroy)(void *payload, void *regex);
+} TSQueryRegexEngine;
+
+#define TS_FLAT_TREE_NONE UINT32_MAX
+
+typedef struct TSFlatTree {
+  uint32_t node_count;
+  const TSSymbol *symbols;
+  const uint32_t *start_bytes;
+  const uint32_t *end_bytes;
+  const TSPoint *start_points;
+  const uint32_t *parent_indices;
+  const uint32_t *first_child_indices;
+  const uint32_t *next_sibling_indices;
+  const TSFieldId *field_ids;
+} TSFlatTree;
+
+typedef struct TSQuerySessionCapture {
+  TSRange range;
+  uint32_t index;
+} TSQuerySessionCapture;
+
+typedef struct TSQuerySessionMatch {
+  uint16_t pattern_index;
+  uint16_t capture_count;
+  const TSQuerySessionCapture *captures;
+} TSQuerySessionMatch;
+
 typedef enum TSQueryError {
   TSQueryErrorNone = 0,
   TSQueryErrorSyntax,
@@ -158,6 +285,30 @@ typedef enum TSQueryError {
  */
 TSParser *ts_parser_new(void);
 
+/**
+ * Create a new parser that allocates its memory with the given allocator,
+ * instead of with the global allocation functions that are configured with
+ * [`ts_set_allocator`]. Each of the allocator's functions is called with its
+ * `payload`, so that different parsers can allocate from different arenas,
+ * or account for their memory separately.
+ *
+ * The allocator is inherited by the trees that the parser produces, and by
+ * their copies, so all of the memory owned by those trees comes from it as
+ * well. Buffers that are returned to the caller, such as the ranges returned
+ * by [`ts_tree_get_changed_ranges`], still come from the global functions.
+ * Tree cursors also use the global functions.
+ *
+ * If the allocator's `malloc` function is `NULL`, the global functions are
+ * used. Otherwise, all four functions must be provided. Trees can be used on
+ * several threads at once, so if copies of this parser's trees are shared
+ * between threads, the functions must be thread-safe.
+ *
+ * An old tree is only reused by [`ts_parser_parse`] if it was produced with
+ * the same allocator. Otherwise, it is ignored, and the document is parsed
+ * from scratch.
+ */
+TSParser *ts_parser_new_with_allocator(TSAllocator allocator);
+
 /**
  * Delete the parser, freeing all of the memory that it used.
  */
@@ -238,18 +389,21 @@ const TSRange *ts_parser_included_ranges(
  *    text and write its length to the [`bytes_read`] pointer. The parser does
  *    not take ownership of this buffer; it just borrows it until it has
  *    finished reading it. The function should write a zero value to the
- *    [`bytes_read`] pointer to indicate the end of the document.
+ *    [`bytes_read`] pointer to indicate the end of the document, or
+ *    [`TS_INPUT_PENDING`] to indicate that the text at that position is not
+ *    available yet.
  * 2. [`payload`]: An arbitrary pointer that will be passed to each invocation
  *    of the [`read`] function.
  * 3. [`encoding`]: An indication of how the text is encoded. Either
  *    `TSInputEncodingUTF8` or `TSInputEncodingUTF16`.
  *
  * This function returns a syntax tree on success, and `NULL` on failure. There
- * are three possible reasons for failure:
+ * are four possible reasons for failure:
  * 1. The parser does not have a language assigned. Check for this using the
       [`ts_parser_language`] function.
- * 2. Parsing was cancelled due to a timeout that was set by an earlier call to
- *    the [`ts_parser_set_timeout_micros`] function. You can resume parsing from
+ * 2. Parsing was cancelled due to a timeout or an operation limit that was set
+ *    by an earlier call to the [`ts_parser_set_timeout_micros`] or
+ *    [`ts_parser_set_operation_limit`] function. You can resume parsing from
  *    where the parser left out by calling [`ts_parser_parse`] again with the
  *    same arguments. Or you can start parsing from scratch by first calling
  *    [`ts_parser_reset`].
@@ -257,6 +411,12 @@ const TSRange *ts_parser_included_ranges(
  *    earlier call to [`ts_parser_set_cancellation_flag`]. You can resume parsing
  *    from where the parser left out by calling [`ts_parser_parse`] again with
  *    the same arguments.
+ * 4. The [`read`] function indicated that some text was not available yet.
+ *    Check for this using the [`ts_parser_is_waiting_for_input`] function.
+ *    Once the text is available, you can resume parsing by calling
+ *    [`ts_parser_parse`] again with the same arguments. The partially-read
+ *    token is lexed again from its start, so the [`read`] function must still
+ *    be able to provide all of the text that it has provided before.
  *
  * [`read`]: TSInput::read
  * [`payload`]: TSInput::payload
@@ -296,11 +456,68 @@ TSTree *ts_parser_parse_string_encoding(
   TSInputEncoding encoding
 );
 
+/**
+ * Use the parser to parse the contents of a file, given an open file
+ * descriptor. The first two parameters are the same as in the
+ * [`ts_parser_parse`] function above. The file must be a regular file
+ * containing UTF8 text.
+ *
+ * Rather than being read into a buffer, the file is mapped into memory for
+ * the duration of the call, and the lexer reads directly from the mapping.
+ * The file must not be modified while it is being parsed. This function
+ * returns `NULL` if the file cannot be mapped, or if it is larger than 4GiB,
+ * in addition to all of the reasons described for [`ts_parser_parse`].
+ */
+TSTree *ts_parser_parse_file(
+  TSParser *self,
+  const TSTree *old_tree,
+  int file_descriptor
+);
+
+/**
+ * Use the parser to check the syntax of some source code, without building a
+ * syntax tree.
+ *
+ * The input is read in the same way as in the [`ts_parser_parse`] function.
+ * When the check finishes, this function returns `true` and stores a summary
+ * in `result`: the number of `ERROR` nodes and `MISSING` nodes that a full
+ * parse would contain, and the range of the first one. If neither count is
+ * nonzero, the source code has no syntax errors, and `first_error` is zeroed.
+ *
+ * This returns `false` in all of the cases where [`ts_parser_parse`] would
+ * return `NULL`, and a halted check can be resumed in the same way. Starting a
+ * check while a parse is halted, or vice versa, starts over from the beginning.
+ *
+ * The parser's memory stays bounded for grammars whose root rule is a
+ * repetition, because each top-level node is searched for errors and freed
+ * as soon as it can only become a child of the root node. Whether any errors
+ * are found always agrees with a full parse, but error recovery can't include
+ * the nodes that were freed, so in rare cases, the counts and the location of
+ * the first error differ. Callbacks that were set with
+ * [`ts_parser_set_stream_callback`] are not called during a check.
+ */
+bool ts_parser_check(
+  TSParser *self,
+  TSInput input,
+  TSSyntaxCheck *result
+);
+
+/**
+ * Use the parser to check the syntax of some UTF8 source code stored in one
+ * contiguous buffer. This works the same as the [`ts_parser_check`] function.
+ */
+bool ts_parser_check_string(
+  TSParser *self,
+  const char *string,
+  uint32_t length,
+  TSSyntaxCheck *result
+);
+
 /**
  * Instruct the parser to start the next parse from the beginning.
  *
- * If the parser previously failed because of a timeout or a cancellation, then
- * by default, it will resume where it left off on the next call to
+ * If the parser previously failed because of a timeout, an operation limit, or
+ * a cancellation, then by default, it will resume where it left off on the next call to
  * [`ts_parser_parse`] or other parsing functions. If you don't want to resume,
  * and instead intend to use this parser to parse some other document, you must
  * call [`ts_parser_reset`] first.
@@ -321,6 +538,125 @@ void ts_parser_set_timeout_micros(TSParser *self, uint64_t timeout_micros);
  */
 uint64_t ts_parser_timeout_micros(const TSParser *self);
 
+/**
+ * Set the maximum number of parse operations that each call to
+ * [`ts_parser_parse`] should be allowed to perform before halting.
+ *
+ * An operation is one step of the parser's main loop, in which it handles a
+ * single lookahead token in one version of the parse stack, so the amount of
+ * work that a parse performs is roughly proportional to its number of
+ * operations. Unlike a timeout, this limit is checked without reading the
+ * clock, and it halts the parse at the same point every time. This lets an
+ * application interleave the parsing of many documents on one thread in
+ * predictable slices, resuming each parse by calling [`ts_parser_parse`]
+ * again with the same arguments.
+ *
+ * Each call to [`ts_parser_parse`] gets a fresh budget, so a parse always
+ * makes progress. Passing zero removes the limit, which is the default.
+ */
+void ts_parser_set_operation_limit(TSParser *self, uint64_t operation_limit);
+
+/**
+ * Get the maximum number of operations that each call to [`ts_parser_parse`]
+ * is allowed to perform.
+ */
+uint64_t ts_parser_operation_limit(const TSParser *self);
+
+/**
+ * Check whether the parser's most recent call to [`ts_parser_parse`] returned
+ * early because its input indicated that some text was not available yet,
+ * using [`TS_INPUT_PENDING`].
+ *
+ * This lets an application parse many documents concurrently on a few threads,
+ * without blocking a thread while it reads a document's text. Instead of
+ * waiting for the text, the `read` function can start reading it in the
+ * background and return [`TS_INPUT_PENDING`]. The parse can then be resumed
+ * on any thread, once the text has been read.
+ */
+bool ts_parser_is_waiting_for_input(const TSParser *self);
+
+/**
+ * Set whether the parser should allocate the nodes of the trees that it
+ * produces out of large, shared memory chunks called *arenas*.
+ *
+ * By default, each node is allocated individually, and deleting a tree
+ * requires visiting and freeing all of its nodes. In arena mode, nodes are
+ * instead carved out of chunks that are owned by the resulting tree, so
+ * [`ts_tree_delete`] only needs to free the chunks. The tradeoff is that the
+ * memory used by a tree's nodes is not reclaimed until every tree that shares
+ * its arenas has been deleted. Because incremental parsing reuses nodes from
+ * the old tree, a tree that is produced by reparsing an arena-allocated tree
+ * keeps the old tree's arenas alive. This mode is therefore best suited to
+ * parsing many documents in bulk, rather than to long-lived documents that
+ * are edited and reparsed many times.
+ *
+ * This setting takes effect at the start of the next parse.
+ */
+void ts_parser_set_arena_enabled(TSParser *self, bool enabled);
+
+/**
+ * Get whether the parser allocates the trees that it produces in arenas.
+ */
+bool ts_parser_arena_enabled(const TSParser *self);
+
+/**
+ * Set the limits that the parser should apply to the number of versions of the
+ * parse stack that it explores at once.
+ *
+ * When the parser encounters an ambiguity or a syntax error, it splits its
+ * parse stack into several versions, and explores them in parallel. The cost of
+ * parsing grows with the number of live versions, so on highly ambiguous
+ * grammars or badly broken input, tightening these limits bounds the time that
+ * a parse can take, at the cost of sometimes not finding the best tree:
+ *
+ * - `max_version_count`: The number of versions that are kept after each
+ *   token. This must be at least one, and is six by default.
+ * - `max_cost_difference`: How much more costly a version's errors may be
+ *   than those of the best version, weighted by the progress that the best
+ *   version has made since its last error, before the version is discarded.
+ * - `strategy`: Which versions are discarded when there are too many. With
+ *   `TSVersionPruningStrategyKeepBest`, the default, the versions are ranked
+ *   by their error costs, and the versions that are created by a reduction can
+ *   briefly exceed the limit until they are ranked. With
+ *   `TSVersionPruningStrategyDropNewest`, versions are never allowed to
+ *   exceed the limit, and the most recently created versions are discarded
+ *   first.
+ */
+void ts_parser_set_version_policy(TSParser *self, TSVersionPolicy policy);
+
+/**
+ * Get the parser's current version policy.
+ */
+TSVersionPolicy ts_parser_version_policy(const TSParser *self);
+
+/**
+ * Get counters describing the work that the parser performed during its most
+ * recent parse.
+ *
+ * The counters record the number of times the lexer and the external scanner
+ * were called and how many bytes they examined, the number of shift and reduce
+ * actions, the number of nodes reused from the old tree and the bytes that
+ * they span, the number of times a token could and couldn't be reused from the
+ * parser's cache of recently lexed tokens, the number of times the parse stack
+ * was split into multiple versions because of an ambiguity or merged back
+ * together, the number of versions that were discarded because of the limits
+ * set by the parser's [`TSVersionPolicy`], and the total time spent recovering
+ * from errors.
+ *
+ * A version is counted in `version_limit_prune_count` when it is discarded
+ * because there were too many versions, and in `version_cost_prune_count` when
+ * it is discarded because another version had a lower error cost. The
+ * `max_version_count` is the largest number of versions that were live at
+ * once, before the versions that weren't worth pursuing were discarded.
+ *
+ * After an edit, comparing `lexed_byte_count` and `reused_byte_count` to the
+ * size of the edit shows how much of the document had to be parsed again.
+ *
+ * The counters are reset at the start of each parse. When a parse is halted
+ * early and then resumed, they accumulate across the calls.
+ */
+TSParseStats ts_parser_stats(const TSParser *self);
+
 /**
  * Set the parser's current cancellation flag pointer.
  *
@@ -349,6 +685,51 @@ void ts_parser_set_logger(TSParser *self, TSLogger logger);
  */
 TSLogger ts_parser_logger(const TSParser *self);
 
+/**
+ * Set the tree reclaimer that a parser should use to free the trees that it
+ * no longer needs, or `NULL` to free them immediately.
+ *
+ * After an incremental parse, the parser keeps a reference to the old tree's
+ * nodes until it is reset or parses again. When a reclaimer is set, that
+ * reference is handed off to the reclaimer instead of being released on the
+ * calling thread. The parser does not take ownership over the reclaimer, which
+ * must outlive any use of the parser.
+ */
+void ts_parser_set_tree_reclaimer(TSParser *self, TSTreeReclaimer *reclaimer);
+
+/**
+ * Get the parser's current tree reclaimer.
+ */
+TSTreeReclaimer *ts_parser_tree_reclaimer(const TSParser *self);
+
+/**
+ * Set the callback that a parser should use to stream the top-level nodes of
+ * the documents that it parses, or pass a callback whose `emit` function is
+ * `NULL` to turn streaming off.
+ *
+ * In streaming mode, each time the parser finishes a run of top-level nodes,
+ * it passes them to the callback in order, and then frees them, so that the
+ * memory used while parsing a long document is proportional to its largest
+ * top-level node, rather than to its length. When the parse is complete, the
+ * root's remaining children are passed to the callback too. The nodes are only
+ * valid for the duration of the call.
+ *
+ * This is meant for grammars whose root rule is a repetition, such as
+ * line-based or record-based data formats. Top-level nodes are only streamed
+ * while the parser is exploring a single interpretation of the document, and
+ * is not recovering from an error. Streamed nodes are final, so when a later
+ * syntax error would be best recovered from by reinterpreting them, the parser
+ * cannot do so, and its result may differ from that of an ordinary parse. The
+ * tree returned by the parse function does not contain the streamed nodes, and
+ * the parser does not reuse nodes from an old tree while streaming.
+ */
+void ts_parser_set_stream_callback(TSParser *self, TSStreamCallback callback);
+
+/**
+ * Get the parser's current stream callback.
+ */
+TSStreamCallback ts_parser_stream_callback(const TSParser *self);
+
 /**
  * Set the file descriptor to which the parser should write debugging graphs
  * during parsing. The graphs are formatted in the DOT language. You may want
@@ -357,6 +738,99 @@ TSLogger ts_parser_logger(const TSParser *self);
  */
 void ts_parser_print_dot_graphs(TSParser *self, int fd);
 
+/************************/
+/* Section - ParserPool */
+/************************/
+
+/**
+ * Create a new pool of parsers for the given language.
+ *
+ * A parser pool recycles parsers instead of deleting them, so that the memory
+ * that they allocate while parsing can be reused by later parses. At most
+ * `max_parser_count` idle parsers are kept. When an idle parser is keeping
+ * more than `max_retained_size` bytes of working memory, that memory is freed
+ * before the parser is kept, so that a single large parse does not pin its
+ * memory for the lifetime of the pool.
+ *
+ * Returns `NULL` if the language was generated with an incompatible version of
+ * the Tree-sitter CLI.
+ *
+ * A parser pool is not thread safe, but languages can be shared between
+ * threads, so each thread can own its own pool for the same language.
+ */
+TSParserPool *ts_parser_pool_new(
+  const TSLanguage *language,
+  uint32_t max_parser_count,
+  size_t max_retained_size
+);
+
+/**
+ * Delete the parser pool, along with all of its idle parsers.
+ */
+void ts_parser_pool_delete(TSParserPool *self);
+
+/**
+ * Take a parser from the pool, or create a new one if the pool has no idle
+ * parsers. The parser's language is set to the pool's language.
+ *
+ * Parsers for wasm languages need a wasm store, so a newly created parser for
+ * a wasm language has no language until the caller assigns it a store with
+ * [`ts_parser_set_wasm_store`] and sets its language. Parsers keep their store
+ * while they are in the pool.
+ */
+TSParser *ts_parser_pool_acquire(TSParserPool *self);
+
+/**
+ * Return a parser to the pool, or delete it if the pool is full.
+ *
+ * The parser is reset, its language is set back to the pool's language, and
+ * its logger, dot graph output, cancellation flag, timeout, operation limit,
+ * included ranges, arena setting, tree reclaimer, stream callback and version
+ * policy are restored to their defaults. As with [`ts_parser_set_logger`], the
+ * caller remains responsible for the logger's payload. The parser must not be
+ * used after it is released.
+ */
+void ts_parser_pool_release(TSParserPool *self, TSParser *parser);
+
+/***************************/
+/* Section - TreeReclaimer */
+/***************************/
+
+/**
+ * Create a new tree reclaimer.
+ *
+ * Deleting a large syntax tree visits every one of its nodes, which can cause
+ * a noticeable pause. A tree reclaimer lets an application hand trees off
+ * instead, and free them later in small steps, either from a background
+ * thread or between other work.
+ */
+TSTreeReclaimer *ts_tree_reclaimer_new(void);
+
+/**
+ * Delete the tree reclaimer, freeing all of the trees that it still holds.
+ */
+void ts_tree_reclaimer_delete(TSTreeReclaimer *self);
+
+/**
+ * Hand a syntax tree off to the reclaimer, which takes ownership of it. The
+ * tree must not be used afterward, though copies of it and their nodes remain
+ * valid.
+ *
+ * This function takes constant time, and may be called from any thread, even
+ * while another thread is calling [`ts_tree_reclaimer_step`].
+ */
+void ts_tree_reclaimer_add(TSTreeReclaimer *self, TSTree *tree);
+
+/**
+ * Free some of the memory held by the reclaimer, releasing at most
+ * `max_subtree_count` syntax nodes. Trees are freed in the order that they
+ * were added.
+ *
+ * Returns `true` if the reclaimer still holds trees that have not been freed.
+ * Only one thread may call this function at a time.
+ */
+bool ts_tree_reclaimer_step(TSTreeReclaimer *self, uint32_t max_subtree_count);
+
 /******************/
 /* Section - Tree */
 /******************/
@@ -365,10 +839,31 @@ void ts_parser_print_dot_graphs(TSParser *self, int fd);
  * Create a shallow copy of the syntax tree. This is very fast.
  *
  * You need to copy a syntax tree in order to use it on more than one thread at
- * a time, as syntax trees are not thread safe.
+ * a time, as syntax trees are not thread safe, unless the tree has been frozen
+ * using [`ts_tree_freeze`].
  */
 TSTree *ts_tree_copy(const TSTree *self);
 
+/**
+ * Combine syntax trees that were parsed from consecutive pieces of a document
+ * into a single tree, for use as the old tree when parsing the whole document.
+ *
+ * This allows a large document to be parsed in parallel: split it into pieces,
+ * parse each piece separately on its own thread, then combine the results with
+ * this function and pass the combined tree to [`ts_parser_parse`] along with
+ * the full text. The final parse reuses the nodes of the pieces, reparsing only
+ * the text around the boundaries between them, so it produces the same tree
+ * as parsing the document from scratch, regardless of where it was split. Its
+ * speed depends on the choice of split points, though: they should be places
+ * where a top-level construct can begin, such as the start of a line before a
+ * statement or declaration.
+ *
+ * The trees must share the same language and allocator, and must have been
+ * parsed without included ranges. This returns `NULL` if no trees are given or
+ * if their languages or allocators differ. The given trees are not modified.
+ */
+TSTree *ts_tree_concat(const TSTree *const *trees, uint32_t count);
+
 /**
  * Delete the syntax tree, freeing all of the memory that it used.
  */
@@ -410,6 +905,26 @@ TSRange *ts_tree_included_ranges(const TSTree *self, uint32_t *length);
  */
 void ts_tree_edit(TSTree *self, const TSInputEdit *edit);
 
+/**
+ * Edit the syntax tree to keep it in sync with source code that has been
+ * edited in several places at once.
+ *
+ * The edits are applied in order, exactly as if [`ts_tree_edit`] had been
+ * called with each of them, so each edit must be described in terms of the
+ * document that results from the edits before it. The tree is traversed only
+ * once, however, which is much faster than editing it repeatedly when there
+ * are many edits.
+ *
+ * If `changed_range` is not `NULL`, it is set to the smallest range of the
+ * edited document that contains all of the inserted text.
+ */
+void ts_tree_edit_batch(
+  TSTree *self,
+  const TSInputEdit *edits,
+  uint32_t count,
+  TSRange *changed_range
+);
+
 /**
  * Compare an old edited syntax tree to a new syntax tree representing the same
  * document, returning an array of ranges whose syntactic structure has changed.
@@ -430,6 +945,199 @@ TSRange *ts_tree_get_changed_ranges(
   uint32_t *length
 );
 
+/**
+ * Compare an old edited syntax tree to a new syntax tree, like
+ * [`ts_tree_get_changed_ranges`], but write the changed ranges into a buffer
+ * provided by the caller instead of allocating an array.
+ *
+ * At most `capacity` ranges are written to the `ranges` buffer. The total
+ * number of changed ranges is returned, so if it is greater than `capacity`,
+ * the caller can retry with a larger buffer.
+ */
+uint32_t ts_tree_get_changed_ranges_into(
+  const TSTree *old_tree,
+  const TSTree *new_tree,
+  TSRange *ranges,
+  uint32_t capacity
+);
+
+/**
+ * Compare two syntax trees of the same language structurally, returning an
+ * array of the nodes that were inserted, deleted, or moved.
+ *
+ * Unlike [`ts_tree_get_changed_ranges`], the trees don't need to be related
+ * by edits: they can be parsed from any two versions of a document, such as
+ * two revisions of a file under review. Nodes are compared by their types and
+ * by the text of their leaves, which is read from the given source code, so
+ * differences in whitespace are ignored. Identical subtrees are found using
+ * hashes of their content, which are computed for each call. The trees are
+ * not modified, so this is safe to call concurrently on trees that share
+ * subtrees, including frozen trees.
+ *
+ * Each change has one of these types:
+ * - [`TSDiffChangeTypeDelete`]: `old_node` has no counterpart in the new tree.
+ *   Its descendants are deleted too, unless they are reported as moved.
+ * - [`TSDiffChangeTypeInsert`]: `new_node` has no counterpart in the old tree.
+ *   Its descendants are inserted too, unless they are reported as moved.
+ * - [`TSDiffChangeTypeMove`]: `old_node` became `new_node`, but either it has a
+ *   different parent, or it was reordered with respect to its siblings.
+ *
+ * The node that isn't used by a change is null. The deletions come first, in
+ * the order of the old tree, followed by the insertions and moves in the order
+ * of the new tree. If the trees have different languages, no changes are
+ * returned.
+ *
+ * The returned array is allocated using `malloc` and the caller is responsible
+ * for freeing it using `free`. The length of the array will be written to the
+ * given `length` pointer.
+ */
+TSDiffChange *ts_tree_diff(
+  const TSTree *old_tree,
+  const char *old_source,
+  uint32_t old_length,
+  const TSTree *new_tree,
+  const char *new_source,
+  uint32_t new_length,
+  uint32_t *length
+);
+
+/**
+ * Serialize the syntax tree into a compact binary format, so that it can be
+ * saved and loaded again later without re-parsing the source code.
+ *
+ * The format is a flat, position-independent byte buffer, which can be read
+ * back with [`ts_tree_deserialize`] directly from a memory-mapped file. It
+ * includes the tree's included ranges and external scanner states.
+ *
+ * The returned buffer is allocated using `malloc` and the caller is responsible
+ * for freeing it using `free`. Its length will be written to the given
+ * `length` pointer.
+ */
+char *ts_tree_serialize(const TSTree *self, uint32_t *length);
+
+/**
+ * Load a syntax tree that was serialized with [`ts_tree_serialize`].
+ *
+ * The language must be the same one that the tree was originally parsed with.
+ * If the data is malformed, or was produced by a different language or an
+ * incompatible version of the library, this function returns `NULL`.
+ *
+ * The structure of the tree is validated as it is loaded: every symbol, parse
+ * state and production must exist in the language, every node's counts of
+ * visible and named children must match its children, and every production
+ * must have room for its children. Navigating a tree that was loaded from
+ * corrupted data is therefore safe. The nodes' positions and external scanner
+ * states are not checked against anything, so such a tree may not match any
+ * source code, and data that didn't come from [`ts_tree_serialize`] should
+ * not be used as the old tree for a parse with an external scanner.
+ *
+ * The returned tree is equivalent to the original, and can be passed as the
+ * `old_tree` for incremental reparsing. It does not reference the given data
+ * after this function returns.
+ */
+TSTree *ts_tree_deserialize(const TSLanguage *language, const char *data, uint32_t length);
+
+/**
+ * Enable or disable the syntax tree's parent index.
+ *
+ * By default, finding a node's parent or siblings requires walking down from
+ * the root of the tree. When the parent index is enabled, the tree instead
+ * records the parent of every node the first time one of these functions is
+ * called, so that [`ts_node_parent`] and the sibling functions run in constant
+ * time for nodes retrieved from this tree. The index costs memory
+ * proportional to the size of the tree. It is discarded when the tree is
+ * edited with [`ts_tree_edit`] and rebuilt lazily afterward, and it is shared
+ * with copies made using [`ts_tree_copy`].
+ *
+ * The index also records the offsets of the children of nodes with 32 or
+ * more children. Functions that find the node at a given position, like
+ * [`ts_node_descendant_for_byte_range`] and
+ * [`ts_tree_cursor_goto_first_child_for_byte`], use these offsets to binary
+ * search the children of such nodes. [`ts_node_child_by_field_id`],
+ * [`ts_node_child_by_field_name`] and
+ * [`ts_tree_cursor_goto_child_by_field_id`] use them in the same way, to skip
+ * to the first child that can have the field. The offsets are part of the
+ * parent index, so when it is disabled, these functions visit each child in
+ * turn, as they do in nodes with fewer children.
+ */
+void ts_tree_set_parent_index_enabled(TSTree *self, bool enabled);
+
+/**
+ * Check whether the syntax tree's parent index is enabled.
+ */
+bool ts_tree_parent_index_enabled(const TSTree *self);
+
+/**
+ * Freeze the syntax tree, returning a read-only handle to it that can be
+ * shared by any number of threads without copying the tree.
+ *
+ * Giving each thread its own copy made with [`ts_tree_copy`] updates a
+ * reference count that all of the copies share. Instead, the threads can read
+ * a frozen tree concurrently through the returned handle, without writing to
+ * any memory that is shared between them. This applies to every function that
+ * takes a `const TSTree *` or a [`TSNode`] from the tree, as well as to tree
+ * cursors and query cursors, as long as each thread uses its own cursors. A
+ * [`TSQuery`] can be shared by the threads as well. Freezing builds anything
+ * that the tree would otherwise build lazily when it is first read, such as
+ * its parent index.
+ *
+ * The handle is only valid as long as the tree itself: the owner of the tree
+ * must not edit it, change its parent index setting, or delete it until all
+ * of the threads are done reading it.
+ */
+const TSTree *ts_tree_freeze(TSTree *self);
+
+/**
+ * Create a flattened, read-only snapshot of the syntax tree, for analyses that
+ * walk the whole tree many times.
+ *
+ * The snapshot stores the tree's visible nodes in pre-order, as a set of
+ * parallel arrays indexed by node: each node's symbol, start and end byte,
+ * start point, and the field that it is associated with in its parent. Each
+ * node also has the indices of its parent, its first child, and its next
+ * sibling, which are `TS_FLAT_TREE_NONE` when there is no such node. The root
+ * node is at index zero. Node symbols reflect any aliases, as with
+ * [`ts_node_symbol`].
+ *
+ * Because the nodes' positions are already resolved, reading the snapshot
+ * never touches the tree, and the snapshot remains valid after the tree is
+ * edited or deleted. It must be freed with [`ts_flat_tree_delete`].
+ */
+TSFlatTree *ts_tree_flatten(const TSTree *self);
+
+/**
+ * Delete a flattened syntax tree, freeing all of the memory that it used.
+ */
+void ts_flat_tree_delete(TSFlatTree *self);
+
+/**
+ * Get the number of bytes of memory that are used by the syntax tree's nodes,
+ * including their child arrays and external scanner states, along with the
+ * tree object itself.
+ *
+ * Nodes that are shared with other trees, such as copies of this tree, or
+ * trees that were produced by reparsing it, are included in the total. Use
+ * [`ts_tree_shared_memory_usage`] to find out how much memory several trees
+ * have in common. Caches that are built lazily, such as the parent index, are
+ * not included.
+ */
+size_t ts_tree_memory_usage(const TSTree *self);
+
+/**
+ * Get the number of bytes of memory that are used by the nodes that are
+ * reachable from more than one of the given syntax trees.
+ *
+ * If `unique_bytes` is not `NULL`, it must have room for `count` values, and it
+ * is filled with the number of bytes that are used by each tree alone. Unless
+ * the trees were allocated in arenas, this is the memory that would be freed by
+ * deleting that tree while keeping all of the others. The total memory used by
+ * all of the trees is the sum of these values and the returned value.
+ *
+ * Each shared node is visited only once, so this takes time proportional to
+ * the total number of distinct nodes.
+ */
+size_t ts_tree_shared_memory_usage(const TSTree *const *trees, uint32_t count, size_t *unique_bytes);
+
 /**
  * Write a DOT graph describing the syntax tree to the given file.
  */
@@ -495,6 +1203,22 @@ TSPoint ts_node_end_point(TSNode self);
  */
 char *ts_node_string(TSNode self);
 
+/**
+ * Write a string representation of the node and its descendants to the given
+ * writer, without building the whole string in memory. The string is passed
+ * to the writer's callback in chunks of a bounded size, which are not
+ * null-terminated.
+ *
+ * With [`TSNodeStringFormatSExpression`], the string is the same S-expression
+ * that is returned by [`ts_node_string`].
+ *
+ * With [`TSNodeStringFormatJSON`], the string is a JSON object describing the
+ * node, with its `type`, `field`, byte and point ranges, and whether it is
+ * `named`, `missing` or `extra`. The visible nodes below it, both named and
+ * anonymous, are listed in its `children` array.
+ */
+void ts_node_write_string(TSNode self, TSNodeStringFormat format, TSStringWriter writer);
+
 /**
  * Check if the node is null. Functions like [`ts_node_child`] and
  * [`ts_node_next_sibling`] will return a null node to indicate that no such node
@@ -786,6 +1510,17 @@ uint32_t ts_tree_cursor_current_depth(const TSTreeCursor *self);
 int64_t ts_tree_cursor_goto_first_child_for_byte(TSTreeCursor *self, uint32_t goal_byte);
 int64_t ts_tree_cursor_goto_first_child_for_point(TSTreeCursor *self, TSPoint goal_point);
 
+/**
+ * Move the cursor to the child of its current node with the given numerical
+ * field id, which is the node that [`ts_node_child_by_field_id`] returns.
+ * In nodes with many children, the child is found without visiting the
+ * children that come before it, when the tree's parent index is enabled.
+ *
+ * This returns `true` if the cursor successfully moved, and returns `false`
+ * if the current node has no child with the given field.
+ */
+bool ts_tree_cursor_goto_child_by_field_id(TSTreeCursor *self, TSFieldId field_id);
+
 TSTreeCursor ts_tree_cursor_copy(const TSTreeCursor *cursor);
 
 /*******************/
@@ -816,6 +1551,26 @@ TSQuery *ts_query_new(
  */
 void ts_query_delete(TSQuery *self);
 
+/**
+ * Serialize a compiled query into a binary format, so that it can be saved
+ * and loaded again later with [`ts_query_deserialize`], skipping the work of
+ * parsing and analyzing the query's source.
+ *
+ * The returned buffer is allocated using `malloc` and the caller is responsible
+ * for freeing it using `free`. Its length will be written to the given
+ * `length` pointer.
+ */
+char *ts_query_serialize(const TSQuery *self, uint32_t *length);
+
+/**
+ * Load a query that was serialized with [`ts_query_serialize`].
+ *
+ * The language must be the same one that the query was created for. If the
+ * data is malformed, or was produced for a different version of the language
+ * or by an incompatible version of the library, this function returns `NULL`.
+ */
+TSQuery *ts_query_deserialize(const TSLanguage *language, const char *data, uint32_t length);
+
 /**
  * Get the number of patterns, captures, or string literals in the query.
  */
@@ -942,6 +1697,13 @@ void ts_query_disable_pattern(TSQuery *self, uint32_t pattern_index);
  */
 TSQueryCursor *ts_query_cursor_new(void);
 
+/**
+ * Create a new query cursor that allocates its memory with the given
+ * allocator, instead of with the global allocation functions. See
+ * [`ts_parser_new_with_allocator`].
+ */
+TSQueryCursor *ts_query_cursor_new_with_allocator(TSAllocator allocator);
+
 /**
  * Delete a query cursor, freeing all of the memory that it used.
  */
@@ -952,6 +1714,26 @@ void ts_query_cursor_delete(TSQueryCursor *self);
  */
 void ts_query_cursor_exec(TSQueryCursor *self, const TSQuery *query, TSNode node);
 
+/**
+ * Start running several queries on a given node at once.
+ *
+ * All of the queries are matched during a single traversal of the syntax
+ * tree, which is faster than running each of them separately. Use
+ * [`ts_query_cursor_next_query_match`] or [`ts_query_cursor_next_query_capture`]
+ * to find out which query each result belongs to. The results' pattern indices
+ * and capture indices refer to the patterns and captures of that query.
+ *
+ * The queries must not be deleted while the cursor is executing them. At most
+ * 65535 queries can be given, with at most 65535 patterns between them. If
+ * there are more, the cursor is halted and produces no results.
+ */
+void ts_query_cursor_exec_queries(
+  TSQueryCursor *self,
+  const TSQuery *const *queries,
+  uint32_t query_count,
+  TSNode node
+);
+
 /**
  * Manage the maximum number of in-progress matches allowed by this query
  * cursor.
@@ -967,6 +1749,35 @@ bool ts_query_cursor_did_exceed_match_limit(const TSQueryCursor *self);
 uint32_t ts_query_cursor_match_limit(const TSQueryCursor *self);
 void ts_query_cursor_set_match_limit(TSQueryCursor *self, uint32_t limit);
 
+/**
+ * Enable or disable the collection of per-pattern statistics by this query
+ * cursor. Statistics are disabled by default. Changes take effect when the
+ * cursor next starts executing a query.
+ */
+void ts_query_cursor_set_pattern_stats_enabled(TSQueryCursor *self, bool enabled);
+bool ts_query_cursor_pattern_stats_enabled(const TSQueryCursor *self);
+
+/**
+ * Get the statistics that the cursor has collected for the given pattern
+ * since it started executing its current query.
+ *
+ * The counters record the number of in-progress matches that were started for
+ * the pattern, the number that were created by copying another in-progress
+ * match because a part of the pattern could match in more than one way, the
+ * number that were dropped because the match limit was exceeded, and the
+ * number of capture lists that were acquired for the pattern's matches.
+ * Patterns whose matches are frequently started, copied or dropped are the
+ * ones that make a query slow.
+ *
+ * When the cursor is executing several queries at once, patterns are numbered
+ * in the same way as in the matches that it returns. If statistics are
+ * disabled, all of the counters are zero.
+ */
+TSQueryPatternStats ts_query_cursor_pattern_stats(
+  const TSQueryCursor *self,
+  uint32_t pattern_index
+);
+
 /**
  * Set the range of bytes or (row, column) positions in which the query
  * will be executed.
@@ -995,6 +1806,29 @@ bool ts_query_cursor_next_capture(
   uint32_t *capture_index
 );
 
+/**
+ * Like [`ts_query_cursor_next_match`], but also write the index of the query
+ * that the match belongs to, within the queries that were passed to
+ * [`ts_query_cursor_exec_queries`], to `*query_index`.
+ */
+bool ts_query_cursor_next_query_match(
+  TSQueryCursor *self,
+  TSQueryMatch *match,
+  uint32_t *query_index
+);
+
+/**
+ * Like [`ts_query_cursor_next_capture`], but also write the index of the query
+ * that the capture's match belongs to, within the queries that were passed to
+ * [`ts_query_cursor_exec_queries`], to `*query_index`.
+ */
+bool ts_query_cursor_next_query_capture(
+  TSQueryCursor *self,
+  TSQueryMatch *match,
+  uint32_t *capture_index,
+  uint32_t *query_index
+);
+
 /**
  * Set the maximum start depth for a query cursor.
  *
@@ -1011,6 +1845,101 @@ bool ts_query_cursor_next_capture(
  */
 void ts_query_cursor_set_max_start_depth(TSQueryCursor *self, uint32_t max_start_depth);
 
+/**
+ * Set the text provider that a query cursor uses to evaluate the text
+ * predicates of its queries.
+ *
+ * When a text provider is set, the cursor checks the `#eq?`, `#match?` and
+ * `#any-of?` predicates (along with their `not-` and `any-` variants) itself,
+ * and never returns matches that fail them. The provider's `text` function
+ * must return the text of the given node and write its length to `*length`.
+ * The returned text only needs to remain valid until the provider is called
+ * again. Other predicates are left for the caller to evaluate.
+ *
+ * Pass a provider whose `text` function is `NULL` to turn this off.
+ */
+void ts_query_cursor_set_text_provider(TSQueryCursor *self, TSQueryTextProvider provider);
+
+/**
+ * Set the regex engine that a query cursor uses to evaluate `#match?`
+ * predicates.
+ *
+ * The engine's `compile` function returns a compiled regex, or `NULL` if the
+ * pattern is invalid. A predicate whose pattern can't be compiled is never
+ * satisfied, whether it is `#match?`, `#not-match?` or one of their `any-`
+ * variants, so the cursor doesn't return the matches that contain it.
+ * Compiled regexes, and failures to compile them, are cached by the cursor
+ * until it is deleted or a different engine is set, at which point the
+ * compiled regexes are passed to `destroy`. Without an engine, `#match?`
+ * predicates are always satisfied.
+ */
+void ts_query_cursor_set_regex_engine(TSQueryCursor *self, TSQueryRegexEngine engine);
+
+/**************************/
+/* Section - QuerySession */
+/**************************/
+
+/**
+ * Create a new query session, which keeps the matches of a query in a
+ * document up to date as the document is edited.
+ *
+ * Rather than re-running the query over the whole document after each edit,
+ * a session only recomputes the matches that the edit could have affected,
+ * and keeps the rest. Matches are stored as the ranges of their captures, so
+ * that they remain valid after the tree that produced them is deleted.
+ * Matches that have no captures are not stored.
+ *
+ * The query must not be deleted while the session exists.
+ */
+TSQuerySession *ts_query_session_new(const TSQuery *query);
+
+/**
+ * Delete a query session, freeing all of the memory that it used.
+ */
+void ts_query_session_delete(TSQuerySession *self);
+
+/**
+ * Edit the session's matches to keep them in sync with source code that has
+ * been edited. This must be called with the same edits that are applied to
+ * the old syntax tree using [`ts_tree_edit`].
+ */
+void ts_query_session_edit(TSQuerySession *self, const TSInputEdit *edit);
+
+/**
+ * Bring the session's matches up to date with a new syntax tree.
+ *
+ * The first time that this is called, the query is run over the entire given
+ * node. After that, the `changed_ranges` should be those returned by
+ * [`ts_tree_get_changed_ranges`] for the old and new trees. The session
+ * discards every match that extends into a changed range or an edited range,
+ * and runs the query again around those ranges to replace them. For
+ * non-local patterns (see [`ts_query_is_pattern_non_local`]), the affected
+ * area is widened to include the parent of the nodes where they match.
+ *
+ * The session uses the given cursor to run the query, so the cursor's match
+ * limit, text provider and regex engine all apply. The cursor's byte range is
+ * overwritten. Returns the number of matches that were recomputed.
+ */
+uint32_t ts_query_session_update(
+  TSQuerySession *self,
+  TSQueryCursor *cursor,
+  TSNode node,
+  const TSRange *changed_ranges,
+  uint32_t changed_range_count
+);
+
+/**
+ * Get the number of matches that the session currently has.
+ */
+uint32_t ts_query_session_match_count(const TSQuerySession *self);
+
+/**
+ * Get one of the session's matches. Matches are ordered by the position of
+ * their earliest capture. The match's captures remain valid until the next
+ * call to [`ts_query_session_update`] or [`ts_query_session_edit`].
+ */
+TSQuerySessionMatch ts_query_session_match(const TSQuerySession *self, uint32_t index);
+
 /**********************/
 /* Section - Language */
 /**********************/
@@ -1155,12 +2084,163 @@ TSSymbol ts_lookahead_iterator_current_symbol(const TSLookaheadIterator *self);
 */
 const char *ts_lookahead_iterator_current_symbol_name(const TSLookaheadIterator *self);
 
+/*****************************/
+/* Section - Lookahead Table */
+/*****************************/
+
+/**
+ * Create a new lookahead table for the given language.
+ *
+ * A lookahead table caches the set of symbols that are valid in each parse
+ * state of a language, as a bitset that is built the first time the state is
+ * used. This makes it cheap to combine the valid symbols of many states, for
+ * example to generate completion candidates, without iterating over each
+ * state's symbols with a [`TSLookaheadIterator`]. Each set contains the same
+ * symbols that a lookahead iterator would produce for its state.
+ *
+ * A lookahead table can be used from multiple threads at once.
+ */
+TSLookaheadTable *ts_lookahead_table_new(const TSLanguage *language);
+
+/**
+ * Delete a lookahead table, freeing all of the memory that it used.
+ */
+void ts_lookahead_table_delete(TSLookaheadTable *self);
+
+/**
+ * Get the language of the lookahead table.
+ */
+const TSLanguage *ts_lookahead_table_language(const TSLookaheadTable *self);
+
+/**
+ * Store the symbols that are valid in any of the given parse states in
+ * `result`, replacing its previous contents.
+ *
+ * This returns `false` and leaves `result` unchanged if any of the states is
+ * invalid for the table's language, or if `result` was created for a different
+ * language.
+ */
+bool ts_lookahead_table_union(
+  TSLookaheadTable *self,
+  const TSStateId *states,
+  uint32_t state_count,
+  TSSymbolSet *result
+);
+
+/**
+ * Store the symbols that are valid in all of the given parse states in
+ * `result`, replacing its previous contents. If no states are given, `result`
+ * is emptied.
+ *
+ * This returns `false` in the same cases as [`ts_lookahead_table_union`].
+ */
+bool ts_lookahead_table_intersection(
+  TSLookaheadTable *self,
+  const TSStateId *states,
+  uint32_t state_count,
+  TSSymbolSet *result
+);
+
+/**
+ * Create a new, empty set of symbols for the given language.
+ */
+TSSymbolSet *ts_symbol_set_new(const TSLanguage *language);
+
+/**
+ * Delete a symbol set, freeing all of the memory that it used.
+ */
+void ts_symbol_set_delete(TSSymbolSet *self);
+
+/**
+ * Check if a symbol set contains the given symbol.
+ */
+bool ts_symbol_set_contains(const TSSymbolSet *self, TSSymbol symbol);
+
+/**
+ * Get the number of symbols in a symbol set.
+ */
+uint32_t ts_symbol_set_count(const TSSymbolSet *self);
+
+/**
+ * Get the smallest symbol in a symbol set that is greater than or equal to
+ * the given symbol, or `UINT16_MAX` if there is none. To visit every symbol in
+ * the set, start from zero, and then continue from one past each result.
+ */
+TSSymbol ts_symbol_set_next(const TSSymbolSet *self, TSSymbol symbol);
+
+/***********************/
+/* Section - LineIndex */
+/***********************/
+
+/**
+ * Create a new line index for the given text.
+ *
+ * A line index records the byte offset at which each line of a document
+ * begins, so that byte offsets and [`TSPoint`] positions can be converted into
+ * each other in logarithmic time, rather than by rescanning the text. As in
+ * the rest of the library, rows are separated by `\n` characters and columns
+ * are measured in bytes.
+ */
+TSLineIndex *ts_line_index_new(const char *string, uint32_t length);
+
+/**
+ * Delete the line index, freeing all of the memory that it used.
+ */
+void ts_line_index_delete(TSLineIndex *self);
+
+/**
+ * Update the line index to reflect an edit to its text.
+ *
+ * The `string` and `length` arguments must give the entire text after the
+ * edit. Only the newly inserted text is scanned, though updating the offsets
+ * of the lines after the edit still takes time proportional to their number.
+ */
+void ts_line_index_edit(
+  TSLineIndex *self,
+  const TSInputEdit *edit,
+  const char *string,
+  uint32_t length
+);
+
+/**
+ * Get the number of lines in the text. Text that doesn't contain any newlines
+ * has one line.
+ */
+uint32_t ts_line_index_line_count(const TSLineIndex *self);
+
+/**
+ * Get the range of bytes occupied by the given line, not including its
+ * trailing newline.
+ *
+ * Returns `false` if the text does not have that many lines.
+ */
+bool ts_line_index_line_range(
+  const TSLineIndex *self,
+  uint32_t row,
+  uint32_t *start_byte,
+  uint32_t *end_byte
+);
+
+/**
+ * Get the position of the given byte offset. Offsets past the end of the text
+ * are treated as the end of the text.
+ */
+TSPoint ts_line_index_point_for_byte(const TSLineIndex *self, uint32_t byte);
+
+/**
+ * Get the byte offset of the given position. Columns past the end of their line
+ * are treated as the end of the line, and rows past the end of the text as the
+ * end of the text.
+ */
+uint32_t ts_line_index_byte_for_point(const TSLineIndex *self, TSPoint point);
+
 /*************************************/
 /* Section - WebAssembly Integration */
 /************************************/
 
 typedef struct wasm_engine_t TSWasmEngine;
 typedef struct TSWasmStore TSWasmStore;
+typedef struct TSWasmStorePool TSWasmStorePool;
 
 typedef enum {
   TSWasmErrorKindNone = 0,
@@ -1208,6 +2288,46 @@ const TSLanguage *ts_wasm_store_load_language(
  */
 size_t ts_wasm_store_language_count(const TSWasmStore *);
 
+/**
+ * Create a pool of Wasm stores that share the given engine.
+ *
+ * Creating a Wasm store is expensive: it compiles and instantiates the Wasm
+ * stdlib, and every language must then be instantiated separately in each
+ * store that uses it. The stores that belong to a pool share one compiled
+ * copy of the stdlib. Released stores are kept in the pool, along with the
+ * languages that have been instantiated in them, so that a parser can acquire
+ * a store that is ready to use. At most `max_store_count` idle stores are kept.
+ *
+ * The pool takes ownership of the engine. Unlike most Tree-sitter objects,
+ * a store pool can be used from multiple threads at once, but each of its
+ * stores can still only be used by one parser at a time.
+ */
+TSWasmStorePool *ts_wasm_store_pool_new(
+  TSWasmEngine *engine,
+  uint32_t max_store_count,
+  TSWasmError *error
+);
+
+/**
+ * Delete the store pool, along with all of its idle stores. Stores that are
+ * still in use keep the pool's shared resources alive until they are deleted,
+ * but they can't be released back into the pool.
+ */
+void ts_wasm_store_pool_delete(TSWasmStorePool *);
+
+/**
+ * Take an idle store from the pool, or create a new one if the pool has no
+ * idle stores. Returns `NULL` if a new store can't be created.
+ */
+TSWasmStore *ts_wasm_store_pool_acquire(TSWasmStorePool *, TSWasmError *error);
+
+/**
+ * Return a store to the pool that it was acquired from, or delete it if the
+ * pool is full or if the store came from somewhere else. The store must not be
+ * assigned to a parser.
+ */
+void ts_wasm_store_pool_release(TSWasmStorePool *, TSWasmStore *);
+
 /**
  * Check if the language came from a Wasm module. If so, then in order to use
  * this language with a Parser, that parser must have a Wasm store assigned.
@@ -9,6 +9,8 @@ extern "C" {
 #include <stdio.h>
 #include <stdlib.h>
 
+#include "tree_sitter/api.h"
+
 #if defined(TREE_SITTER_HIDDEN_SYMBOLS) || defined(_WIN32)
 #define TS_PUBLIC
 #else
@@ -20,18 +22,87 @@ TS_PUBLIC extern void *(*ts_current_calloc)(size_t, size_t);
 TS_PUBLIC extern void *(*ts_current_realloc)(void *, size_t);
 TS_PUBLIC extern void (*ts_current_free)(void *);
 
+#if defined(TREE_SITTER_SINGLE_THREADED)
+#define TS_THREAD_LOCAL
+#elif defined(_MSC_VER) && !defined(__clang__)
+#define TS_THREAD_LOCAL __declspec(thread)
+#else
+#define TS_THREAD_LOCAL _Thread_local
+#endif
+
+// The allocator of the object that the library is currently doing work for on
+// this thread, or `NULL` if the global allocation functions should be used.
+extern TS_THREAD_LOCAL const TSAllocator *ts_current_allocator;
+
+// Make the given allocator current, until the matching call to
+// `ts_allocator_pop`. An allocator without a `malloc` function stands for the
+// global allocation functions. Returns the allocator that was current before.
+static inline const TSAllocator *ts_allocator_push(const TSAllocator *allocator) {
+  const TSAllocator *previous = ts_current_allocator;
+  ts_current_allocator = allocator && allocator->malloc ? allocator : NULL;
+  return previous;
+}
+
+static inline void ts_allocator_pop(const TSAllocator *previous) {
+  ts_current_allocator = previous;
+}
+
+// Get a copy of the current allocator, so that an object that is created now
+// keeps using it.
+static inline TSAllocator ts_allocator_current(void) {
+  return ts_current_allocator ? *ts_current_allocator : (TSAllocator) {0};
+}
+
+// Determine whether memory from one allocator can be freed by another.
+static inline bool ts_allocator_eq(const TSAllocator *left, const TSAllocator *right) {
+  if (!left->malloc || !right->malloc) return !left->malloc && !right->malloc;
+  return
+    left->payload == right->payload &&
+    left->malloc == right->malloc &&
+    left->calloc == right->calloc &&
+    left->realloc == right->realloc &&
+    left->free == right->free;
+}
+
+static inline void *ts_allocator_malloc(size_t size) {
+  const TSAllocator *allocator = ts_current_allocator;
+  if (allocator) return allocator->malloc(allocator->payload, size);
+  return ts_current_malloc(size);
+}
+
+static inline void *ts_allocator_calloc(size_t count, size_t size) {
+  const TSAllocator *allocator = ts_current_allocator;
+  if (allocator) return allocator->calloc(allocator->payload, count, size);
+  return ts_current_calloc(count, size);
+}
+
+static inline void *ts_allocator_realloc(void *buffer, size_t size) {
+  const TSAllocator *allocator = ts_current_allocator;
+  if (allocator) return allocator->realloc(allocator->payload, buffer, size);
+  return ts_current_realloc(buffer, size);
+}
+
+static inline void ts_allocator_free(void *buffer) {
+  const TSAllocator *allocator = ts_current_allocator;
+  if (allocator) {
+    allocator->free(allocator->payload, buffer);
+  } else {
+    ts_current_free(buffer);
+  }
+}
+
 // Allow clients to override allocation functions
 #ifndef ts_malloc
-#define ts_malloc  ts_current_malloc
+#define ts_malloc  ts_allocator_malloc
 #endif
 #ifndef ts_calloc
-#define ts_calloc  ts_current_calloc
+#define ts_calloc  ts_allocator_calloc
 #endif
 #ifndef ts_realloc
-#define ts_realloc ts_current_realloc
+#define ts_realloc ts_allocator_realloc
 #endif
 #ifndef ts_free
-#define ts_free    ts_current_free
+#define ts_free    ts_allocator_free
 #endif
 
 #ifdef __cplusplus
@@ -1,11 +1,16 @@
 #ifndef TREE_SITTER_ATOMIC_H_
 #define TREE_SITTER_ATOMIC_H_
 
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdlib.h>
 
-#ifdef __TINYC__
+// When the library is built with `TREE_SITTER_SINGLE_THREADED` defined, as it
+// is for the web binding, these operations are plain loads and stores, which
+// makes retaining and releasing subtrees cheaper. Trees and their copies must
+// then only ever be used on one thread.
+#if defined(__TINYC__) || defined(TREE_SITTER_SINGLE_THREADED)
 
 static inline size_t atomic_load(const volatile size_t *p) {
   return *p;
@@ -21,6 +26,16 @@ static inline uint32_t atomic_dec(volatile uint32_t *p) {
   return *p;
 }
 
+static inline void *atomic_load_ptr(void *const volatile *p) {
+  return *p;
+}
+
+static inline bool atomic_compare_exchange_ptr(void *volatile *p, void *expected, void *desired) {
+  if (*p != expected) return false;
+  *p = desired;
+  return true;
+}
+
 #elif defined(_WIN32)
 
 #include <windows.h>
@@ -37,6 +52,14 @@ static inline uint32_t atomic_dec(volatile uint32_t *p) {
   return InterlockedDecrement((long volatile *)p);
 }
 
+static inline void *atomic_load_ptr(void *const volatile *p) {
+  return InterlockedCompareExchangePointer((void *volatile *)p, NULL, NULL);
+}
+
+static inline bool atomic_compare_exchange_ptr(void *volatile *p, void *expected, void *desired) {
+  return InterlockedCompareExchangePointer(p, desired, expected) == expected;
+}
+
 #else
 
 static inline size_t atomic_load(const volatile size_t *p) {
@@ -63,6 +86,22 @@ static inline uint32_t atomic_dec(volatile uint32_t *p) {
   #endif
 }
 
+static inline void *atomic_load_ptr(void *const volatile *p) {
+  #ifdef __ATOMIC_ACQUIRE
+    return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+  #else
+    return __sync_val_compare_and_swap((void *volatile *)p, NULL, NULL);
+  #endif
+}
+
+static inline bool atomic_compare_exchange_ptr(void *volatile *p, void *expected, void *desired) {
+  #ifdef __ATOMIC_ACQ_REL
+    return __atomic_compare_exchange_n(p, &expected, desired, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+  #else
+    return __sync_bool_compare_and_swap(p, expected, desired);
+  #endif
+}
+
 #endif
 
 #endif  // TREE_SITTER_ATOMIC_H_
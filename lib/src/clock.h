@@ -49,6 +49,10 @@ static inline bool clock_is_gt(TSClock self, TSClock other) {
   return self > other;
 }
 
+static inline TSDuration clock_duration_since(TSClock self, TSClock start) {
+  return self - start;
+}
+
 #elif defined(CLOCK_MONOTONIC) && !defined(__APPLE__)
 
 // POSIX with monotonic clock support (Linux)
@@ -100,6 +104,11 @@ static inline bool clock_is_gt(TSClock self, TSClock other) {
   return self.tv_nsec > other.tv_nsec;
 }
 
+static inline TSDuration clock_duration_since(TSClock self, TSClock start) {
+  return (TSDuration)(self.tv_sec - start.tv_sec) * 1000000 +
+    (self.tv_nsec - start.tv_nsec) / 1000;
+}
+
 #else
 
 // macOS or POSIX without monotonic clock support
@@ -141,6 +150,10 @@ static inline bool clock_is_gt(TSClock self, TSClock other) {
   return self > other;
 }
 
+static inline TSDuration clock_duration_since(TSClock self, TSClock start) {
+  return self - start;
+}
+
 #endif
 
 #endif  // TREE_SITTER_CLOCK_H_
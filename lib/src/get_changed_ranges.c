@@ -27,6 +27,27 @@ static void ts_range_array_add(
   }
 }
 
+static void changed_range_buffer_add(
+  ChangedRangeBuffer *self,
+  Length start,
+  Length end
+) {
+  if (self->count > 0 && start.bytes <= self->last.end_byte) {
+    self->last.end_byte = end.bytes;
+    self->last.end_point = end.extent;
+  } else if (start.bytes < end.bytes) {
+    self->last = (TSRange) { start.extent, end.extent, start.bytes, end.bytes };
+    if (self->count == self->capacity && self->can_grow) {
+      self->capacity = self->capacity < 8 ? 8 : self->capacity * 2;
+      self->contents = ts_realloc(self->contents, self->capacity * sizeof(TSRange));
+    }
+    self->count++;
+  } else {
+    return;
+  }
+  if (self->count <= self->capacity) self->contents[self->count - 1] = self->last;
+}
+
 bool ts_range_array_intersects(
   const TSRangeArray *self,
   unsigned start_index,
@@ -153,11 +174,11 @@ static Length iterator_end_position(Iterator *self) {
   }
 }
 
-static bool iterator_tree_is_visible(const Iterator *self) {
-  TreeCursorEntry entry = *array_back(&self->cursor.stack);
+static bool iterator_entry_is_visible(const Iterator *self, uint32_t depth) {
+  TreeCursorEntry entry = self->cursor.stack.contents[depth];
   if (ts_subtree_visible(*entry.subtree)) return true;
-  if (self->cursor.stack.size > 1) {
-    Subtree parent = *self->cursor.stack.contents[self->cursor.stack.size - 2].subtree;
+  if (depth > 0) {
+    Subtree parent = *self->cursor.stack.contents[depth - 1].subtree;
     return ts_language_alias_at(
       self->language,
       parent.ptr->production_id,
@@ -167,6 +188,10 @@ static bool iterator_tree_is_visible(const Iterator *self) {
   return false;
 }
 
+static bool iterator_tree_is_visible(const Iterator *self) {
+  return iterator_entry_is_visible(self, self->cursor.stack.size - 1);
+}
+
 static void iterator_get_visible_state(
   const Iterator *self,
   Subtree *tree,
@@ -295,6 +320,71 @@ static void iterator_advance(Iterator *self) {
   }
 }
 
+// Move past the end of the subtree at the given depth of the iterator's stack,
+// without visiting the rest of its descendants.
+static void iterator_skip_to_end_of(Iterator *self, uint32_t depth) {
+  while (self->cursor.stack.size > depth + 1) iterator_ascend(self);
+  self->in_padding = false;
+  iterator_advance(self);
+}
+
+// When the new tree reuses a subtree from the old tree, and both iterators are
+// inside of it at the same position, then the rest of that subtree can't have
+// changed, as long as it is nested within the same number of visible nodes in
+// both trees. Find the outermost hidden subtree that the iterators share in
+// this way, and its depth in each of their stacks.
+//
+// Both stacks' entries contain the current position, so they are walked from
+// the outside in, always advancing whichever entry is larger.
+static bool iterators_find_shared_subtree(
+  const Iterator *old_iter,
+  const Iterator *new_iter,
+  uint32_t *old_depth,
+  uint32_t *new_depth
+) {
+  uint32_t i = 1, j = 1;
+  uint32_t old_visible_count = 1, new_visible_count = 1;
+  while (i < old_iter->cursor.stack.size && j < new_iter->cursor.stack.size) {
+    TreeCursorEntry old_entry = old_iter->cursor.stack.contents[i];
+    TreeCursorEntry new_entry = new_iter->cursor.stack.contents[j];
+    Subtree old_tree = *old_entry.subtree;
+    Subtree new_tree = *new_entry.subtree;
+    bool advance_old, advance_new;
+    if (
+      old_tree.ptr == new_tree.ptr &&
+      old_entry.position.bytes == new_entry.position.bytes
+    ) {
+      if (
+        old_visible_count == new_visible_count &&
+        !old_tree.data.is_inline &&
+        old_tree.ptr->child_count > 0 &&
+        !ts_subtree_has_changes(old_tree) &&
+        !iterator_entry_is_visible(old_iter, i) &&
+        !iterator_entry_is_visible(new_iter, j)
+      ) {
+        *old_depth = i;
+        *new_depth = j;
+        return true;
+      }
+      advance_old = advance_new = true;
+    } else {
+      uint32_t old_size = ts_subtree_total_bytes(old_tree);
+      uint32_t new_size = ts_subtree_total_bytes(new_tree);
+      advance_old = old_size >= new_size;
+      advance_new = new_size >= old_size;
+    }
+    if (advance_old) {
+      if (iterator_entry_is_visible(old_iter, i)) old_visible_count++;
+      i++;
+    }
+    if (advance_new) {
+      if (iterator_entry_is_visible(new_iter, j)) new_visible_count++;
+      j++;
+    }
+  }
+  return false;
+}
+
 typedef enum {
   IteratorDiffers,
   IteratorMayDiffer,
@@ -354,15 +444,13 @@ static inline void iterator_print_state(Iterator *self) {
 }
 #endif
 
-unsigned ts_subtree_get_changed_ranges(
+void ts_subtree_get_changed_ranges(
   const Subtree *old_tree, const Subtree *new_tree,
   TreeCursor *cursor1, TreeCursor *cursor2,
   const TSLanguage *language,
   const TSRangeArray *included_range_differences,
-  TSRange **ranges
+  ChangedRangeBuffer *results
 ) {
-  TSRangeArray results = array_new();
-
   Iterator old_iter = iterator_new(cursor1, old_tree, language);
   Iterator new_iter = iterator_new(cursor2, new_tree, language);
 
@@ -371,10 +459,10 @@ unsigned ts_subtree_get_changed_ranges(
   Length position = iterator_start_position(&old_iter);
   Length next_position = iterator_start_position(&new_iter);
   if (position.bytes < next_position.bytes) {
-    ts_range_array_add(&results, position, next_position);
+    changed_range_buffer_add(results, position, next_position);
     position = next_position;
   } else if (position.bytes > next_position.bytes) {
-    ts_range_array_add(&results, next_position, position);
+    changed_range_buffer_add(results, next_position, position);
     next_position = position;
   }
 
@@ -387,57 +475,80 @@ unsigned ts_subtree_get_changed_ranges(
     puts("");
     #endif
 
-    // Compare the old and new subtrees.
-    IteratorComparison comparison = iterator_compare(&old_iter, &new_iter);
-
-    // Even if the two subtrees appear to be identical, they could differ
-    // internally if they contain a range of text that was previously
-    // excluded from the parse, and is now included, or vice-versa.
-    if (comparison == IteratorMatches && ts_range_array_intersects(
-      included_range_differences,
-      included_range_difference_index,
-      position.bytes,
-      iterator_end_position(&old_iter).bytes
-    )) {
-      comparison = IteratorMayDiffer;
+    // If both iterators are inside of the same reused subtree, skip the rest
+    // of it, unless it contains a range of text whose inclusion changed.
+    bool is_changed = false;
+    uint32_t old_depth, new_depth;
+    Length shared_end = length_zero();
+    bool is_shared = iterators_find_shared_subtree(&old_iter, &new_iter, &old_depth, &new_depth);
+    if (is_shared) {
+      TreeCursorEntry entry = old_iter.cursor.stack.contents[old_depth];
+      shared_end = length_add(entry.position, ts_subtree_total_size(*entry.subtree));
+      is_shared = !ts_range_array_intersects(
+        included_range_differences,
+        included_range_difference_index,
+        position.bytes,
+        shared_end.bytes
+      );
     }
 
-    bool is_changed = false;
-    switch (comparison) {
-      // If the subtrees are definitely identical, move to the end
-      // of both subtrees.
-      case IteratorMatches:
-        next_position = iterator_end_position(&old_iter);
-        break;
+    if (is_shared) {
+      next_position = shared_end;
+      iterator_skip_to_end_of(&old_iter, old_depth);
+      iterator_skip_to_end_of(&new_iter, new_depth);
+    } else {
+      // Compare the old and new subtrees.
+      IteratorComparison comparison = iterator_compare(&old_iter, &new_iter);
+
+      // Even if the two subtrees appear to be identical, they could differ
+      // internally if they contain a range of text that was previously
+      // excluded from the parse, and is now included, or vice-versa.
+      if (comparison == IteratorMatches && ts_range_array_intersects(
+        included_range_differences,
+        included_range_difference_index,
+        position.bytes,
+        iterator_end_position(&old_iter).bytes
+      )) {
+        comparison = IteratorMayDiffer;
+      }
 
-      // If the subtrees might differ internally, descend into both
-      // subtrees, finding the first child that spans the current position.
-      case IteratorMayDiffer:
-        if (iterator_descend(&old_iter, position.bytes)) {
-          if (!iterator_descend(&new_iter, position.bytes)) {
+      switch (comparison) {
+        // If the subtrees are definitely identical, move to the end
+        // of both subtrees.
+        case IteratorMatches:
+          next_position = iterator_end_position(&old_iter);
+          break;
+
+        // If the subtrees might differ internally, descend into both
+        // subtrees, finding the first child that spans the current position.
+        case IteratorMayDiffer:
+          if (iterator_descend(&old_iter, position.bytes)) {
+            if (!iterator_descend(&new_iter, position.bytes)) {
+              is_changed = true;
+              next_position = iterator_end_position(&old_iter);
+            }
+          } else if (iterator_descend(&new_iter, position.bytes)) {
             is_changed = true;
-            next_position = iterator_end_position(&old_iter);
+            next_position = iterator_end_position(&new_iter);
+          } else {
+            next_position = length_min(
+              iterator_end_position(&old_iter),
+              iterator_end_position(&new_iter)
+            );
           }
-        } else if (iterator_descend(&new_iter, position.bytes)) {
+          break;
+
+        // If the subtrees are different, record a change and then move
+        // to the end of both subtrees.
+        case IteratorDiffers:
           is_changed = true;
-          next_position = iterator_end_position(&new_iter);
-        } else {
           next_position = length_min(
             iterator_end_position(&old_iter),
             iterator_end_position(&new_iter)
           );
-        }
-        break;
+          break;
+      }
 
-      // If the subtrees are different, record a change and then move
-      // to the end of both subtrees.
-      case IteratorDiffers:
-        is_changed = true;
-        next_position = length_min(
-          iterator_end_position(&old_iter),
-          iterator_end_position(&new_iter)
-        );
-        break;
     }
 
     // Ensure that both iterators are caught up to the current position.
@@ -467,7 +578,7 @@ unsigned ts_subtree_get_changed_ranges(
       );
       #endif
 
-      ts_range_array_add(&results, position, next_position);
+      changed_range_buffer_add(results, position, next_position);
     }
 
     position = next_position;
@@ -489,13 +600,11 @@ unsigned ts_subtree_get_changed_ranges(
   Length old_size = ts_subtree_total_size(*old_tree);
   Length new_size = ts_subtree_total_size(*new_tree);
   if (old_size.bytes < new_size.bytes) {
-    ts_range_array_add(&results, old_size, new_size);
+    changed_range_buffer_add(results, old_size, new_size);
   } else if (new_size.bytes < old_size.bytes) {
-    ts_range_array_add(&results, new_size, old_size);
+    changed_range_buffer_add(results, new_size, old_size);
   }
 
   *cursor1 = old_iter.cursor;
   *cursor2 = new_iter.cursor;
-  *ranges = results.contents;
-  return results.size;
 }
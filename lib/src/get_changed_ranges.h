@@ -21,12 +21,24 @@ bool ts_range_array_intersects(
   uint32_t start_byte, uint32_t end_byte
 );
 
-unsigned ts_subtree_get_changed_ranges(
+// The ranges produced by `ts_subtree_get_changed_ranges`. They are stored
+// either in a heap-allocated array that grows as needed, or in a fixed-size
+// buffer that belongs to the caller. In the latter case, ranges that don't
+// fit are only counted.
+typedef struct {
+  TSRange *contents;
+  uint32_t capacity;
+  uint32_t count;
+  TSRange last;
+  bool can_grow;
+} ChangedRangeBuffer;
+
+void ts_subtree_get_changed_ranges(
   const Subtree *old_tree, const Subtree *new_tree,
   TreeCursor *cursor1, TreeCursor *cursor2,
   const TSLanguage *language,
   const TSRangeArray *included_range_differences,
-  TSRange **ranges
+  ChangedRangeBuffer *ranges
 );
 
 #ifdef __cplusplus
@@ -1,3 +1,5 @@
+#include "./alloc.h"
+#include "./atomic.h"
 #include "./language.h"
 #include "./wasm_store.h"
 #include "tree_sitter/api.h"
@@ -12,7 +14,9 @@ const TSLanguage *ts_language_copy(const TSLanguage *self) {
 
 void ts_language_delete(const TSLanguage *self) {
   if (self && ts_language_is_wasm(self)) {
+    const TSAllocator *previous_allocator = ts_allocator_push(NULL);
     ts_wasm_language_release(self);
+    ts_allocator_pop(previous_allocator);
   }
 }
 
@@ -32,6 +36,44 @@ uint32_t ts_language_field_count(const TSLanguage *self) {
   return self->field_count;
 }
 
+static inline uint32_t ts_language__hash_uint32(uint32_t hash, uint32_t value) {
+  for (unsigned i = 0; i < 4; i++) {
+    hash = (hash ^ ((value >> (i * 8)) & 0xff)) * 16777619u;
+  }
+  return hash;
+}
+
+static inline uint32_t ts_language__hash_string(uint32_t hash, const char *string) {
+  if (!string) return ts_language__hash_uint32(hash, 0);
+  for (const char *c = string; *c; c++) {
+    hash = (hash ^ (uint8_t)*c) * 16777619u;
+  }
+  return (hash ^ 0xff) * 16777619u;
+}
+
+// Compute a hash of the parts of a language that serialized trees and queries
+// depend on, so that they are not loaded with a different version of their
+// grammar.
+uint32_t ts_language_fingerprint(const TSLanguage *language) {
+  uint32_t hash = 2166136261u;
+  hash = ts_language__hash_uint32(hash, language->version);
+  hash = ts_language__hash_uint32(hash, language->symbol_count);
+  hash = ts_language__hash_uint32(hash, language->alias_count);
+  hash = ts_language__hash_uint32(hash, language->token_count);
+  hash = ts_language__hash_uint32(hash, language->external_token_count);
+  hash = ts_language__hash_uint32(hash, language->state_count);
+  hash = ts_language__hash_uint32(hash, language->large_state_count);
+  hash = ts_language__hash_uint32(hash, language->production_id_count);
+  hash = ts_language__hash_uint32(hash, language->field_count);
+  for (uint32_t i = 0, n = ts_language_symbol_count(language); i < n; i++) {
+    hash = ts_language__hash_string(hash, language->symbol_names[i]);
+  }
+  for (uint32_t i = 1; i <= language->field_count; i++) {
+    hash = ts_language__hash_string(hash, language->field_names[i]);
+  }
+  return hash;
+}
+
 void ts_language_table_entry(
   const TSLanguage *self,
   TSStateId state,
@@ -219,3 +261,159 @@ const char *ts_lookahead_iterator_current_symbol_name(const TSLookaheadIterator
   const LookaheadIterator *iterator = (const LookaheadIterator *)self;
   return ts_language_symbol_name(iterator->language, iterator->symbol);
 }
+
+// Lookahead tables and symbol sets
+
+struct TSSymbolSet {
+  const TSLanguage *language;
+  uint32_t word_count;
+  uint32_t *words;
+};
+
+struct TSLookaheadTable {
+  const TSLanguage *language;
+  uint32_t word_count;
+  uint32_t **sets;
+};
+
+static inline uint32_t ts_language__symbol_set_word_count(const TSLanguage *self) {
+  return (self->symbol_count + 31) / 32;
+}
+
+// Get the set of symbols that are valid in the given state. The sets are
+// built on first use. Tables may be used concurrently, so each set is published
+// with a compare-and-swap, and a thread that loses the race discards its own
+// copy.
+static const uint32_t *ts_lookahead_table__set(TSLookaheadTable *self, TSStateId state) {
+  uint32_t *set = atomic_load_ptr((void *const volatile *)&self->sets[state]);
+  if (!set) {
+    set = ts_calloc(self->word_count, sizeof(uint32_t));
+    LookaheadIterator iterator = ts_language_lookaheads(self->language, state);
+    while (ts_lookahead_iterator__next(&iterator)) {
+      set[iterator.symbol / 32] |= 1u << (iterator.symbol % 32);
+    }
+    void *volatile *location = (void *volatile *)&self->sets[state];
+    if (!atomic_compare_exchange_ptr(location, NULL, set)) {
+      ts_free(set);
+      set = atomic_load_ptr((void *const volatile *)location);
+    }
+  }
+  return set;
+}
+
+static bool ts_lookahead_table__can_combine(
+  const TSLookaheadTable *self,
+  const TSStateId *states,
+  uint32_t state_count,
+  const TSSymbolSet *result
+) {
+  if (result->language != self->language) return false;
+  for (uint32_t i = 0; i < state_count; i++) {
+    if (states[i] >= self->language->state_count) return false;
+  }
+  return true;
+}
+
+TSLookaheadTable *ts_lookahead_table_new(const TSLanguage *language) {
+  TSLookaheadTable *self = ts_malloc(sizeof(TSLookaheadTable));
+  self->language = ts_language_copy(language);
+  self->word_count = ts_language__symbol_set_word_count(language);
+  self->sets = ts_calloc(language->state_count, sizeof(uint32_t *));
+  return self;
+}
+
+void ts_lookahead_table_delete(TSLookaheadTable *self) {
+  if (!self) return;
+  for (uint32_t i = 0; i < self->language->state_count; i++) {
+    ts_free(self->sets[i]);
+  }
+  ts_free(self->sets);
+  ts_language_delete(self->language);
+  ts_free(self);
+}
+
+const TSLanguage *ts_lookahead_table_language(const TSLookaheadTable *self) {
+  return self->language;
+}
+
+bool ts_lookahead_table_union(
+  TSLookaheadTable *self,
+  const TSStateId *states,
+  uint32_t state_count,
+  TSSymbolSet *result
+) {
+  if (!ts_lookahead_table__can_combine(self, states, state_count, result)) return false;
+  memset(result->words, 0, result->word_count * sizeof(uint32_t));
+  for (uint32_t i = 0; i < state_count; i++) {
+    const uint32_t *set = ts_lookahead_table__set(self, states[i]);
+    for (uint32_t j = 0; j < self->word_count; j++) {
+      result->words[j] |= set[j];
+    }
+  }
+  return true;
+}
+
+bool ts_lookahead_table_intersection(
+  TSLookaheadTable *self,
+  const TSStateId *states,
+  uint32_t state_count,
+  TSSymbolSet *result
+) {
+  if (!ts_lookahead_table__can_combine(self, states, state_count, result)) return false;
+  if (state_count == 0) {
+    memset(result->words, 0, result->word_count * sizeof(uint32_t));
+    return true;
+  }
+  const uint32_t *first_set = ts_lookahead_table__set(self, states[0]);
+  memcpy(result->words, first_set, self->word_count * sizeof(uint32_t));
+  for (uint32_t i = 1; i < state_count; i++) {
+    const uint32_t *set = ts_lookahead_table__set(self, states[i]);
+    for (uint32_t j = 0; j < self->word_count; j++) {
+      result->words[j] &= set[j];
+    }
+  }
+  return true;
+}
+
+TSSymbolSet *ts_symbol_set_new(const TSLanguage *language) {
+  TSSymbolSet *self = ts_malloc(sizeof(TSSymbolSet));
+  self->language = ts_language_copy(language);
+  self->word_count = ts_language__symbol_set_word_count(language);
+  self->words = ts_calloc(self->word_count, sizeof(uint32_t));
+  return self;
+}
+
+void ts_symbol_set_delete(TSSymbolSet *self) {
+  if (!self) return;
+  ts_free(self->words);
+  ts_language_delete(self->language);
+  ts_free(self);
+}
+
+bool ts_symbol_set_contains(const TSSymbolSet *self, TSSymbol symbol) {
+  if (symbol >= self->language->symbol_count) return false;
+  return self->words[symbol / 32] & (1u << (symbol % 32));
+}
+
+uint32_t ts_symbol_set_count(const TSSymbolSet *self) {
+  uint32_t result = 0;
+  for (uint32_t i = 0; i < self->word_count; i++) {
+    for (uint32_t word = self->words[i]; word; word &= word - 1) {
+      result++;
+    }
+  }
+  return result;
+}
+
+TSSymbol ts_symbol_set_next(const TSSymbolSet *self, TSSymbol symbol) {
+  if (symbol >= self->language->symbol_count) return UINT16_MAX;
+  uint32_t index = symbol / 32;
+  uint32_t word = self->words[index] & (UINT32_MAX << (symbol % 32));
+  while (!word) {
+    if (++index == self->word_count) return UINT16_MAX;
+    word = self->words[index];
+  }
+  uint32_t bit = 0;
+  while (!(word & (1u << bit))) bit++;
+  return (TSSymbol)(index * 32 + bit);
+}
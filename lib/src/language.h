@@ -11,6 +11,7 @@ extern "C" {
 #define ts_builtin_sym_error_repeat (ts_builtin_sym_error - 1)
 
 #define LANGUAGE_VERSION_WITH_PRIMARY_STATES 14
+#define LANGUAGE_VERSION_WITH_SMALL_STATE_HASHES 15
 #define LANGUAGE_VERSION_USABLE_VIA_WASM 13
 
 typedef struct {
@@ -43,6 +44,8 @@ TSSymbol ts_language_public_symbol(const TSLanguage *, TSSymbol);
 
 TSStateId ts_language_next_state(const TSLanguage *self, TSStateId state, TSSymbol symbol);
 
+uint32_t ts_language_fingerprint(const TSLanguage *);
+
 static inline bool ts_language_is_symbol_external(const TSLanguage *self, TSSymbol symbol) {
   return 0 < symbol && symbol < self->external_token_count + 1;
 }
@@ -69,12 +72,35 @@ static inline bool ts_language_has_reduce_action(
   return entry.action_count > 0 && entry.actions[0].type == TSParseActionTypeReduce;
 }
 
+// Lookup a symbol in a small parse state's hash table.
+//
+// The table starts with the base-2 logarithm of its slot count, followed by
+// the slots, which are pairs of a symbol and its table value. Collisions are
+// resolved by linear probing, and unused slots hold `UINT16_MAX`. The table
+// always has some unused slots, so that every probe sequence terminates.
+static inline uint16_t ts_language__small_state_hash_lookup(
+  const uint16_t *data,
+  TSSymbol symbol
+) {
+  uint16_t bits = data[0];
+  uint32_t mask = (1u << bits) - 1;
+  uint32_t slot = ((uint32_t)symbol * 0x9E3779B9u) >> (32 - bits);
+  const uint16_t *slots = &data[1];
+  for (;;) {
+    uint16_t slot_symbol = slots[2 * slot];
+    if (slot_symbol == symbol) return slots[2 * slot + 1];
+    if (slot_symbol == UINT16_MAX) return 0;
+    slot = (slot + 1) & mask;
+  }
+}
+
 // Lookup the table value for a given symbol and state.
 //
 // For non-terminal symbols, the table value represents a successor state.
 // For terminal symbols, it represents an index in the actions table.
 // For 'large' parse states, this is a direct lookup. For 'small' parse
-// states, this requires searching through the symbol groups to find
+// states, this uses the state's hash table if the language provides one,
+// and otherwise requires searching through the symbol groups to find
 // the given symbol.
 static inline uint16_t ts_language_lookup(
   const TSLanguage *self,
@@ -82,6 +108,13 @@ static inline uint16_t ts_language_lookup(
   TSSymbol symbol
 ) {
   if (state >= self->large_state_count) {
+    if (
+      self->version >= LANGUAGE_VERSION_WITH_SMALL_STATE_HASHES &&
+      self->small_parse_table_hashes
+    ) {
+      uint32_t index = self->small_parse_table_hash_map[state - self->large_state_count];
+      return ts_language__small_state_hash_lookup(&self->small_parse_table_hashes[index], symbol);
+    }
     uint32_t index = self->small_parse_table_map[state - self->large_state_count];
     const uint16_t *data = &self->small_parse_table[index];
     uint16_t group_count = *(data++);
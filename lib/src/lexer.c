@@ -4,6 +4,19 @@
 #include "./length.h"
 #include "./unicode.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TS_LEXER_SSE2
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define TS_LEXER_NEON
+#endif
+
+// The maximum number of ASCII ranges that are compared in parallel, 16 bytes
+// at a time, by `ts_lexer__advance_while`. Character classes with more ranges
+// than this are matched one byte at a time.
+#define MAX_VECTOR_RANGE_COUNT 8
+
 #define LOG(message, character)              \
   if (self->logger.log) {                    \
     snprintf(                                \
@@ -14,11 +27,14 @@
         message " character:%d",             \
       character                              \
     );                                       \
+    const TSAllocator *previous_allocator =  \
+      ts_allocator_push(NULL);               \
     self->logger.log(                        \
       self->logger.payload,                  \
       TSLogTypeLex,                          \
       self->debug_buffer                     \
     );                                       \
+    ts_allocator_pop(previous_allocator);    \
   }
 
 static const int32_t BYTE_ORDER_MARK = 0xFEFF;
@@ -56,12 +72,24 @@ static void ts_lexer__clear_chunk(Lexer *self) {
 // for the current position.
 static void ts_lexer__get_chunk(Lexer *self) {
   self->chunk_start = self->current_position.bytes;
+
+  // The caller's callbacks always run with the global allocator, even while
+  // the lexer is working for a parser that has its own.
+  const TSAllocator *previous_allocator = ts_allocator_push(NULL);
   self->chunk = self->input.read(
     self->input.payload,
     self->current_position.bytes,
     self->current_position.extent,
     &self->chunk_size
   );
+  ts_allocator_pop(previous_allocator);
+
+  // If the text is not available yet, then treat this as the end of the
+  // input. The parser will discard the current token and try again later.
+  if (self->chunk_size == TS_INPUT_PENDING) {
+    self->input_pending = true;
+    self->chunk_size = 0;
+  }
   if (!self->chunk_size) {
     self->current_included_range_index = self->included_range_count;
     self->chunk = NULL;
@@ -82,6 +110,14 @@ static void ts_lexer__get_lookahead(Lexer *self) {
   }
 
   const uint8_t *chunk = (const uint8_t *)self->chunk + position_in_chunk;
+
+  // Most source code is ASCII, which doesn't need to be decoded.
+  if (self->input.encoding == TSInputEncodingUTF8 && *chunk < 0x80) {
+    self->lookahead_size = 1;
+    self->data.lookahead = *chunk;
+    return;
+  }
+
   UnicodeDecodeFunction decode = self->input.encoding == TSInputEncodingUTF8
     ? ts_decode_utf8
     : ts_decode_utf16;
@@ -95,6 +131,35 @@ static void ts_lexer__get_lookahead(Lexer *self) {
     chunk = (const uint8_t *)self->chunk;
     size = self->chunk_size;
     self->lookahead_size = decode(chunk, size, &self->data.lookahead);
+
+    // If the fresh chunk also ends in the middle of the character, then the
+    // rest of the character may not be available yet. In that case, treat
+    // this as the end of the input, like any other text that isn't available.
+    // Otherwise, the probe's text can't be decoded together with this chunk,
+    // so it is discarded, and the character is treated as invalid.
+    if (self->data.lookahead == TS_DECODE_ERROR && size > 0 && size < 4) {
+      uint32_t bytes_read = 0;
+      const TSAllocator *previous_allocator = ts_allocator_push(NULL);
+      self->input.read(
+        self->input.payload,
+        self->current_position.bytes + size,
+        (TSPoint) {
+          self->current_position.extent.row,
+          self->current_position.extent.column + size
+        },
+        &bytes_read
+      );
+      ts_allocator_pop(previous_allocator);
+      if (bytes_read == TS_INPUT_PENDING) {
+        self->input_pending = true;
+        self->chunk = NULL;
+        self->chunk_size = 0;
+        self->current_included_range_index = self->included_range_count;
+        self->lookahead_size = 1;
+        self->data.lookahead = '\0';
+        return;
+      }
+    }
   }
 
   if (self->data.lookahead == TS_DECODE_ERROR) {
@@ -219,6 +284,163 @@ static void ts_lexer__advance(TSLexer *_self, bool skip) {
   ts_lexer__do_advance(self, skip);
 }
 
+// The ASCII portion of a set of character ranges, as a bitmap for matching
+// single bytes, and as a list of byte ranges for matching many bytes at once.
+typedef struct {
+  uint32_t bitmap[4];
+  uint8_t range_starts[MAX_VECTOR_RANGE_COUNT];
+  uint8_t range_widths[MAX_VECTOR_RANGE_COUNT];
+  uint32_t range_count;
+  bool is_vectorizable;
+} AsciiCharacterClass;
+
+static void ts_lexer__ascii_class_init(
+  AsciiCharacterClass *self,
+  const TSCharacterRange *ranges,
+  uint32_t range_count
+) {
+  *self = (AsciiCharacterClass) {.is_vectorizable = true};
+  for (uint32_t i = 0; i < range_count; i++) {
+    int32_t start = ranges[i].start < 0 ? 0 : ranges[i].start;
+    int32_t end = ranges[i].end > 0x7F ? 0x7F : ranges[i].end;
+    if (start > end) continue;
+    for (int32_t c = start; c <= end; c++) {
+      self->bitmap[c >> 5] |= 1u << (c & 31);
+    }
+    if (self->range_count < MAX_VECTOR_RANGE_COUNT) {
+      self->range_starts[self->range_count] = (uint8_t)start;
+      self->range_widths[self->range_count] = (uint8_t)(end - start);
+      self->range_count++;
+    } else {
+      self->is_vectorizable = false;
+    }
+  }
+}
+
+static inline bool ts_lexer__ascii_class_contains(const AsciiCharacterClass *self, uint8_t c) {
+  return c < 0x80 && (self->bitmap[c >> 5] >> (c & 31)) & 1;
+}
+
+// Find the length of the prefix of the given bytes that belongs to the class.
+// A byte belongs to a range if its offset from the range's start, as an
+// unsigned byte, is at most the range's width. Because the ranges never
+// extend past 0x7F, this also rules out all non-ASCII bytes.
+static uint32_t ts_lexer__ascii_class_span(
+  const AsciiCharacterClass *self,
+  const uint8_t *bytes,
+  uint32_t length
+) {
+  uint32_t i = 0;
+  if (self->is_vectorizable) {
+#if defined(TS_LEXER_SSE2)
+    for (; i + 16 <= length; i += 16) {
+      __m128i block = _mm_loadu_si128((const __m128i *)(bytes + i));
+      __m128i matches = _mm_setzero_si128();
+      for (uint32_t j = 0; j < self->range_count; j++) {
+        __m128i offset = _mm_sub_epi8(block, _mm_set1_epi8((char)self->range_starts[j]));
+        __m128i width = _mm_set1_epi8((char)self->range_widths[j]);
+        matches = _mm_or_si128(matches, _mm_cmpeq_epi8(_mm_max_epu8(offset, width), width));
+      }
+      if (_mm_movemask_epi8(matches) != 0xFFFF) break;
+    }
+#elif defined(TS_LEXER_NEON)
+    for (; i + 16 <= length; i += 16) {
+      uint8x16_t block = vld1q_u8(bytes + i);
+      uint8x16_t matches = vdupq_n_u8(0);
+      for (uint32_t j = 0; j < self->range_count; j++) {
+        uint8x16_t offset = vsubq_u8(block, vdupq_n_u8(self->range_starts[j]));
+        matches = vorrq_u8(matches, vcleq_u8(offset, vdupq_n_u8(self->range_widths[j])));
+      }
+      if (vminvq_u8(matches) != 0xFF) break;
+    }
+#endif
+  }
+  while (i < length && ts_lexer__ascii_class_contains(self, bytes[i])) i++;
+  return i;
+}
+
+static inline bool ts_lexer__ranges_contain(
+  const TSCharacterRange *ranges,
+  uint32_t range_count,
+  int32_t c
+) {
+  for (uint32_t i = 0; i < range_count; i++) {
+    if (ranges[i].start <= c && c <= ranges[i].end) return true;
+  }
+  return false;
+}
+
+// Advance past all of the consecutive characters that fall within any of the
+// given ranges, returning the number of characters that were advanced past.
+// Runs of ASCII text are consumed directly from the current chunk, without
+// decoding each character; everything else goes through the normal
+// `ts_lexer__do_advance` path, so that chunk and included range boundaries
+// are handled exactly as they are by `ts_lexer__advance`.
+static uint32_t ts_lexer__advance_while(
+  TSLexer *_self,
+  const TSCharacterRange *ranges,
+  uint32_t range_count,
+  bool skip
+) {
+  Lexer *self = (Lexer *)_self;
+  bool can_use_fast_path =
+    self->input.encoding == TSInputEncodingUTF8 &&
+    !self->logger.log;
+
+  AsciiCharacterClass ascii_class;
+  ts_lexer__ascii_class_init(&ascii_class, ranges, range_count);
+  bool class_contains_newline = ts_lexer__ascii_class_contains(&ascii_class, '\n');
+
+  uint32_t result = 0;
+  while (
+    self->chunk &&
+    !ts_lexer__eof(&self->data) &&
+    ts_lexer__ranges_contain(ranges, range_count, self->data.lookahead)
+  ) {
+    if (can_use_fast_path && self->lookahead_size == 1 && self->data.lookahead < 0x80) {
+      // Find the bytes after the lookahead character that are within both the
+      // current chunk and the current included range.
+      const TSRange *current_range = &self->included_ranges[self->current_included_range_index];
+      uint32_t end_byte = self->chunk_start + self->chunk_size;
+      if (current_range->end_byte < end_byte) end_byte = current_range->end_byte;
+      uint32_t position_in_chunk = self->current_position.bytes - self->chunk_start;
+      const uint8_t *bytes = (const uint8_t *)self->chunk + position_in_chunk;
+      uint32_t length = end_byte - self->current_position.bytes;
+
+      // Consume all but the last byte of the run in place. The last byte is
+      // consumed below, so that the new lookahead character is read properly.
+      uint32_t span = ts_lexer__ascii_class_span(&ascii_class, bytes, length);
+      if (span > 1) {
+        uint32_t consumed = span - 1;
+        if (class_contains_newline) {
+          for (uint32_t i = 0; i < consumed; i++) {
+            if (bytes[i] == '\n') {
+              self->current_position.extent.row++;
+              self->current_position.extent.column = 0;
+            } else {
+              self->current_position.extent.column++;
+            }
+          }
+        } else {
+          self->current_position.extent.column += consumed;
+        }
+        self->current_position.bytes += consumed;
+        self->data.lookahead = bytes[consumed];
+        result += consumed;
+      }
+    }
+
+    if (skip) {
+      LOG("skip", self->data.lookahead)
+    } else {
+      LOG("consume", self->data.lookahead)
+    }
+    ts_lexer__do_advance(self, skip);
+    result++;
+  }
+  return result;
+}
+
 // Mark that a token match has completed. This can be called multiple
 // times if a longer match is found later.
 static void ts_lexer__mark_end(TSLexer *_self) {
@@ -295,6 +517,7 @@ void ts_lexer_init(Lexer *self) {
       .get_column = ts_lexer__get_column,
       .is_at_included_range_start = ts_lexer__is_at_included_range_start,
       .eof = ts_lexer__eof,
+      .advance_while = ts_lexer__advance_while,
       .lookahead = 0,
       .result_symbol = 0,
     },
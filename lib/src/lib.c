@@ -4,6 +4,7 @@
 #include "./get_changed_ranges.c"
 #include "./language.c"
 #include "./lexer.c"
+#include "./line_index.c"
 #include "./node.c"
 #include "./parser.c"
 #include "./query.c"
@@ -11,4 +12,5 @@
 #include "./subtree.c"
 #include "./tree_cursor.c"
 #include "./tree.c"
+#include "./tree_diff.c"
 #include "./wasm_store.c"
@@ -0,0 +1,127 @@
+#include <string.h>
+#include "tree_sitter/api.h"
+#include "./alloc.h"
+#include "./array.h"
+
+// The byte offset at which each line of a document begins. The first line
+// always begins at zero, so the array is never empty.
+struct TSLineIndex {
+  Array(uint32_t) line_starts;
+  uint32_t length;
+};
+
+// Count the lines that begin within the given range of the text, and if
+// `line_starts` is non-null, write their starting offsets to it, in order.
+static uint32_t ts_line_index__scan(
+  const char *string,
+  uint32_t start_byte,
+  uint32_t end_byte,
+  uint32_t *line_starts
+) {
+  const char *position = string + start_byte;
+  const char *end = string + end_byte;
+  uint32_t count = 0;
+  while (position < end) {
+    const char *newline = memchr(position, '\n', end - position);
+    if (!newline) break;
+    if (line_starts) line_starts[count] = (uint32_t)(newline - string) + 1;
+    count++;
+    position = newline + 1;
+  }
+  return count;
+}
+
+// Find the index of the first line that begins strictly after the given byte.
+static uint32_t ts_line_index__upper_bound(const TSLineIndex *self, uint32_t byte) {
+  uint32_t lo = 0, hi = self->line_starts.size;
+  while (lo < hi) {
+    uint32_t mid = lo + (hi - lo) / 2;
+    if (self->line_starts.contents[mid] <= byte) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+static uint32_t ts_line_index__line_end(const TSLineIndex *self, uint32_t row) {
+  return row + 1 < self->line_starts.size
+    ? self->line_starts.contents[row + 1] - 1
+    : self->length;
+}
+
+TSLineIndex *ts_line_index_new(const char *string, uint32_t length) {
+  TSLineIndex *self = ts_malloc(sizeof(TSLineIndex));
+  uint32_t count = ts_line_index__scan(string, 0, length, NULL);
+  array_init(&self->line_starts);
+  array_grow_by(&self->line_starts, 1 + count);
+  ts_line_index__scan(string, 0, length, self->line_starts.contents + 1);
+  self->length = length;
+  return self;
+}
+
+void ts_line_index_delete(TSLineIndex *self) {
+  if (!self) return;
+  array_delete(&self->line_starts);
+  ts_free(self);
+}
+
+void ts_line_index_edit(
+  TSLineIndex *self,
+  const TSInputEdit *edit,
+  const char *string,
+  uint32_t length
+) {
+  uint32_t start_byte = edit->start_byte;
+  uint32_t old_end_byte = edit->old_end_byte;
+  uint32_t new_end_byte = edit->new_end_byte;
+  if (start_byte > self->length) start_byte = self->length;
+  if (old_end_byte > self->length) old_end_byte = self->length;
+  if (old_end_byte < start_byte) old_end_byte = start_byte;
+  if (new_end_byte > length) new_end_byte = length;
+  if (new_end_byte < start_byte) new_end_byte = start_byte;
+
+  // Replace the lines that began within the old text with the ones that
+  // begin within the new text.
+  uint32_t index = ts_line_index__upper_bound(self, start_byte);
+  uint32_t old_count = ts_line_index__upper_bound(self, old_end_byte) - index;
+  uint32_t new_count = ts_line_index__scan(string, start_byte, new_end_byte, NULL);
+  array_splice(&self->line_starts, index, old_count, new_count, NULL);
+  ts_line_index__scan(string, start_byte, new_end_byte, self->line_starts.contents + index);
+
+  // Shift the lines that begin after the edit.
+  for (uint32_t i = index + new_count; i < self->line_starts.size; i++) {
+    self->line_starts.contents[i] = self->line_starts.contents[i] - old_end_byte + new_end_byte;
+  }
+  self->length = length;
+}
+
+uint32_t ts_line_index_line_count(const TSLineIndex *self) {
+  return self->line_starts.size;
+}
+
+bool ts_line_index_line_range(
+  const TSLineIndex *self,
+  uint32_t row,
+  uint32_t *start_byte,
+  uint32_t *end_byte
+) {
+  if (row >= self->line_starts.size) return false;
+  *start_byte = self->line_starts.contents[row];
+  *end_byte = ts_line_index__line_end(self, row);
+  return true;
+}
+
+TSPoint ts_line_index_point_for_byte(const TSLineIndex *self, uint32_t byte) {
+  if (byte > self->length) byte = self->length;
+  uint32_t row = ts_line_index__upper_bound(self, byte) - 1;
+  return (TSPoint) {row, byte - self->line_starts.contents[row]};
+}
+
+uint32_t ts_line_index_byte_for_point(const TSLineIndex *self, TSPoint point) {
+  if (point.row >= self->line_starts.size) return self->length;
+  uint32_t start = self->line_starts.contents[point.row];
+  uint32_t end = ts_line_index__line_end(self, point.row);
+  return point.column < end - start ? start + point.column : end;
+}
@@ -70,6 +70,48 @@ static inline NodeChildIterator ts_node_iterate_children(const TSNode *node) {
   };
 }
 
+// Move a new child iterator directly to the given child, using the offsets
+// recorded in the tree's parent index.
+static inline void ts_node_child_iterator_seek(
+  NodeChildIterator *self,
+  const ChildOffsetEntry *offsets,
+  uint32_t child_index
+) {
+  if (child_index == 0) return;
+  if (child_index >= self->parent.ptr->child_count) {
+    self->child_index = self->parent.ptr->child_count;
+    return;
+  }
+  Subtree previous_child = ts_subtree_children(self->parent)[child_index - 1];
+  self->position = length_add(
+    length_add(self->position, offsets[child_index - 1].position),
+    ts_subtree_size(previous_child)
+  );
+  self->child_index = child_index;
+  self->structural_child_index = offsets[child_index].structural_child_index;
+}
+
+// In nodes with many children, skip the children that end before the given
+// byte and point.
+static inline void ts_node_child_iterator_skip_to(
+  NodeChildIterator *self,
+  uint32_t goal_byte,
+  TSPoint goal_point
+) {
+  if (!self->parent.ptr) return;
+  const ChildOffsetEntry *offsets = ts_tree_child_offsets(self->tree, self->parent);
+  if (offsets) {
+    uint32_t child_index = ts_tree_child_offsets_search(
+      offsets,
+      self->parent,
+      self->position,
+      goal_byte,
+      goal_point
+    );
+    ts_node_child_iterator_seek(self, offsets, child_index);
+  }
+}
+
 static inline bool ts_node_child_iterator_done(NodeChildIterator *self) {
   return self->child_index == self->parent.ptr->child_count;
 }
@@ -184,7 +226,107 @@ static bool ts_subtree_has_trailing_empty_descendant(
   return false;
 }
 
+static inline TSNode ts_node__parent_from_entry(
+  const TSTree *tree,
+  const ParentCacheEntry *entry
+) {
+  return ts_node_new(
+    tree,
+    entry->parent ? entry->parent : &tree->root,
+    entry->position,
+    entry->alias_symbol
+  );
+}
+
+static inline const ParentCacheEntry *ts_node__parent_cache_entry(TSNode self) {
+  return ts_tree_parent_cache_entry(self.tree, self.id, ts_node_start_byte(self));
+}
+
+static inline TSNode ts_node__indexed_prev_sibling(
+  TSNode self,
+  const ParentCacheEntry *entry,
+  bool include_anonymous
+) {
+  for (;;) {
+    TSNode parent = ts_node__parent_from_entry(self.tree, entry);
+    TSNode earlier_child = ts_node__null();
+    bool earlier_child_is_relevant = false;
+
+    TSNode child;
+    NodeChildIterator iterator = ts_node_iterate_children(&parent);
+    while (
+      iterator.child_index < entry->child_index &&
+      ts_node_child_iterator_next(&iterator, &child)
+    ) {
+      if (ts_node__is_relevant(child, include_anonymous)) {
+        earlier_child = child;
+        earlier_child_is_relevant = true;
+      } else if (ts_node__relevant_child_count(child, include_anonymous) > 0) {
+        earlier_child = child;
+        earlier_child_is_relevant = false;
+      }
+    }
+
+    if (earlier_child_is_relevant) return earlier_child;
+    if (!ts_node_is_null(earlier_child)) {
+      uint32_t count = ts_node__relevant_child_count(earlier_child, include_anonymous);
+      return ts_node__child(earlier_child, count - 1, include_anonymous);
+    }
+
+    if (ts_node__is_relevant(parent, true)) break;
+    entry = ts_node__parent_cache_entry(parent);
+    if (!entry) break;
+  }
+
+  return ts_node__null();
+}
+
+static inline TSNode ts_node__indexed_next_sibling(
+  TSNode self,
+  const ParentCacheEntry *entry,
+  bool include_anonymous
+) {
+  TSNode node = self;
+  for (;;) {
+    TSNode parent = ts_node__parent_from_entry(self.tree, entry);
+    Subtree parent_subtree = ts_node__subtree(parent);
+    NodeChildIterator iterator = {
+      .tree = self.tree,
+      .parent = parent_subtree,
+      .position = length_add(
+        (Length) {ts_node_start_byte(node), ts_node_start_point(node)},
+        ts_subtree_size(ts_node__subtree(node))
+      ),
+      .child_index = entry->child_index + 1,
+      .structural_child_index =
+        entry->structural_child_index + !ts_subtree_extra(ts_node__subtree(node)),
+      .alias_sequence = ts_language_alias_sequence(
+        self.tree->language,
+        parent_subtree.ptr->production_id
+      ),
+    };
+
+    TSNode child;
+    while (ts_node_child_iterator_next(&iterator, &child)) {
+      if (ts_node__is_relevant(child, include_anonymous)) return child;
+      if (ts_node__relevant_child_count(child, include_anonymous) > 0) {
+        return ts_node__child(child, 0, include_anonymous);
+      }
+    }
+
+    if (ts_node__is_relevant(parent, true)) break;
+    entry = ts_node__parent_cache_entry(parent);
+    if (!entry) break;
+    node = parent;
+  }
+
+  return ts_node__null();
+}
+
 static inline TSNode ts_node__prev_sibling(TSNode self, bool include_anonymous) {
+  const ParentCacheEntry *entry = ts_node__parent_cache_entry(self);
+  if (entry) return ts_node__indexed_prev_sibling(self, entry, include_anonymous);
+
   Subtree self_subtree = ts_node__subtree(self);
   bool self_is_empty = ts_subtree_total_bytes(self_subtree) == 0;
   uint32_t target_end_byte = ts_node_end_byte(self);
@@ -246,6 +388,9 @@ static inline TSNode ts_node__prev_sibling(TSNode self, bool include_anonymous)
 }
 
 static inline TSNode ts_node__next_sibling(TSNode self, bool include_anonymous) {
+  const ParentCacheEntry *entry = ts_node__parent_cache_entry(self);
+  if (entry) return ts_node__indexed_next_sibling(self, entry, include_anonymous);
+
   uint32_t target_end_byte = ts_node_end_byte(self);
 
   TSNode node = ts_node_parent(self);
@@ -309,6 +454,7 @@ static inline TSNode ts_node__first_child_for_byte(
 
     TSNode child;
     NodeChildIterator iterator = ts_node_iterate_children(&node);
+    ts_node_child_iterator_skip_to(&iterator, goal, POINT_ZERO);
     while (ts_node_child_iterator_next(&iterator, &child)) {
       if (ts_node_end_byte(child) > goal) {
         if (ts_node__is_relevant(child, include_anonymous)) {
@@ -340,6 +486,7 @@ static inline TSNode ts_node__descendant_for_byte_range(
 
     TSNode child;
     NodeChildIterator iterator = ts_node_iterate_children(&node);
+    ts_node_child_iterator_skip_to(&iterator, range_end > range_start ? range_end : range_start, POINT_ZERO);
     while (ts_node_child_iterator_next(&iterator, &child)) {
       uint32_t node_end = iterator.position.bytes;
 
@@ -379,6 +526,7 @@ static inline TSNode ts_node__descendant_for_point_range(
 
     TSNode child;
     NodeChildIterator iterator = ts_node_iterate_children(&node);
+    ts_node_child_iterator_skip_to(&iterator, 0, point_max(range_start, range_end));
     while (ts_node_child_iterator_next(&iterator, &child)) {
       TSPoint node_end = iterator.position.extent;
 
@@ -449,6 +597,24 @@ char *ts_node_string(TSNode self) {
   );
 }
 
+void ts_node_write_string(TSNode self, TSNodeStringFormat format, TSStringWriter writer) {
+  TSSymbol alias_symbol = ts_node__alias(&self);
+  TSSymbolMetadata metadata = ts_language_symbol_metadata(self.tree->language, alias_symbol);
+
+  // Like `ts_node_string`, the S-expression treats an aliased node as named
+  // whenever its alias is visible.
+  ts_subtree_write_string(
+    ts_node__subtree(self),
+    alias_symbol,
+    format == TSNodeStringFormatSExpression ? metadata.visible : metadata.named,
+    (Length) {ts_node_start_byte(self), ts_node_start_point(self)},
+    self.tree->language,
+    false,
+    format,
+    writer
+  );
+}
+
 bool ts_node_eq(TSNode self, TSNode other) {
   return self.tree == other.tree && self.id == other.id;
 }
@@ -504,6 +670,16 @@ TSStateId ts_node_next_parse_state(TSNode self) {
 }
 
 TSNode ts_node_parent(TSNode self) {
+  const ParentCacheEntry *entry = ts_node__parent_cache_entry(self);
+  if (entry) {
+    for (;;) {
+      TSNode parent = ts_node__parent_from_entry(self.tree, entry);
+      if (ts_node__is_relevant(parent, true)) return parent;
+      entry = ts_node__parent_cache_entry(parent);
+      if (!entry) return parent;
+    }
+  }
+
   TSNode node = ts_tree_root_node(self.tree);
   uint32_t end_byte = ts_node_end_byte(self);
   if (node.id == self.id) return ts_node__null();
@@ -568,6 +744,20 @@ recur:
 
   TSNode child;
   NodeChildIterator iterator = ts_node_iterate_children(&self);
+
+  // In nodes with many children, skip directly to the first child that
+  // can have the field. This only works when the parent index is enabled.
+  const ChildOffsetEntry *offsets = iterator.parent.ptr
+    ? ts_tree_child_offsets(self.tree, iterator.parent)
+    : NULL;
+  if (offsets) {
+    ts_node_child_iterator_seek(&iterator, offsets, ts_tree_child_offsets_search_structural(
+      offsets,
+      iterator.parent,
+      field_map->child_index
+    ));
+  }
+
   while (ts_node_child_iterator_next(&iterator, &child)) {
     if (!ts_subtree_extra(ts_node__subtree(child))) {
       uint32_t index = iterator.structural_child_index - 1;
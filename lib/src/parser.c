@@ -23,6 +23,14 @@
 #include "./tree.h"
 #include "./wasm_store.h"
 
+#ifdef _WIN32
+#include <io.h>
+#include <windows.h>
+#elif defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
 #define LOG(...)                                                                            \
   if (self->lexer.logger.log || self->dot_graph_file) {                                     \
     snprintf(self->lexer.debug_buffer, TREE_SITTER_SERIALIZATION_BUFFER_SIZE, __VA_ARGS__); \
@@ -75,19 +83,39 @@
 
 #define TREE_NAME(tree) SYM_NAME(ts_subtree_symbol(tree))
 
-static const unsigned MAX_VERSION_COUNT = 6;
+static const unsigned DEFAULT_MAX_VERSION_COUNT = 6;
 static const unsigned MAX_VERSION_COUNT_OVERFLOW = 4;
 static const unsigned MAX_SUMMARY_DEPTH = 16;
-static const unsigned MAX_COST_DIFFERENCE = 16 * ERROR_COST_PER_SKIPPED_TREE;
+static const unsigned DEFAULT_MAX_COST_DIFFERENCE = 16 * ERROR_COST_PER_SKIPPED_TREE;
+static const unsigned MAX_STREAM_STACK_DEPTH = 8;
 static const unsigned OP_COUNT_PER_TIMEOUT_CHECK = 100;
 
+#define TOKEN_CACHE_SIZE 4
+
 typedef struct {
   Subtree token;
   Subtree last_external_token;
   uint32_t byte_index;
+} TokenCacheEntry;
+
+// The tokens that were most recently returned by the lexer. When several stack
+// versions reach the same position in states with different lex modes, each of
+// them needs its own token, so more than one is kept. `next_index` is the slot
+// that will be overwritten next, which is the oldest one.
+typedef struct {
+  TokenCacheEntry entries[TOKEN_CACHE_SIZE];
+  uint32_t next_index;
 } TokenCache;
 
+// A subtree that still needs to be searched for errors during a syntax check,
+// along with the position where its padding begins.
+typedef struct {
+  Subtree tree;
+  Length position;
+} SyntaxCheckEntry;
+
 struct TSParser {
+  TSAllocator allocator;
   Lexer lexer;
   Stack *stack;
   SubtreePool tree_pool;
@@ -101,16 +129,31 @@ struct TSParser {
   TokenCache token_cache;
   ReusableNode reusable_node;
   void *external_scanner_payload;
+  Subtree external_scanner_state_token;
+  bool external_scanner_state_is_current;
+  bool external_scanner_reports_unchanged;
   FILE *dot_graph_file;
   TSClock end_clock;
   TSDuration timeout_duration;
   unsigned accept_count;
   unsigned operation_count;
+  uint64_t operation_limit;
+  uint64_t operations_remaining;
   const volatile size_t *cancellation_flag;
   Subtree old_tree;
+  TSTreeReclaimer *tree_reclaimer;
+  TSStreamCallback stream_callback;
+  TSVersionPolicy version_policy;
   TSRangeArray included_range_differences;
   unsigned included_range_difference_index;
+  SubtreeArenaArray arenas;
+  bool arena_enabled;
   bool has_scanner_error;
+  TSParseStats stats;
+  TSDuration error_recovery_duration;
+  bool is_checking;
+  TSSyntaxCheck syntax_check;
+  Array(SyntaxCheckEntry) syntax_check_stack;
 };
 
 typedef struct {
@@ -156,11 +199,13 @@ static const char *ts_string_input_read(
 
 static void ts_parser__log(TSParser *self) {
   if (self->lexer.logger.log) {
+    const TSAllocator *previous_allocator = ts_allocator_push(NULL);
     self->lexer.logger.log(
       self->lexer.logger.payload,
       TSLogTypeParse,
       self->lexer.debug_buffer
     );
+    ts_allocator_pop(previous_allocator);
   }
 
   if (self->dot_graph_file) {
@@ -266,7 +311,7 @@ static ErrorComparison ts_parser__compare_versions(
   }
 
   if (a.cost < b.cost) {
-    if ((b.cost - a.cost) * (1 + a.node_count) > MAX_COST_DIFFERENCE) {
+    if ((b.cost - a.cost) * (1 + a.node_count) > self->version_policy.max_cost_difference) {
       return ErrorComparisonTakeLeft;
     } else {
       return ErrorComparisonPreferLeft;
@@ -274,7 +319,7 @@ static ErrorComparison ts_parser__compare_versions(
   }
 
   if (b.cost < a.cost) {
-    if ((a.cost - b.cost) * (1 + b.node_count) > MAX_COST_DIFFERENCE) {
+    if ((a.cost - b.cost) * (1 + b.node_count) > self->version_policy.max_cost_difference) {
       return ErrorComparisonTakeRight;
     } else {
       return ErrorComparisonPreferRight;
@@ -301,6 +346,16 @@ static ErrorStatus ts_parser__version_status(
   };
 }
 
+// Get the number of versions that are allowed to exist while versions are
+// being advanced, before they are sorted and truncated.
+static inline uint32_t ts_parser__max_version_count_while_advancing(TSParser *self) {
+  uint32_t result = self->version_policy.max_version_count;
+  if (self->version_policy.strategy == TSVersionPruningStrategyKeepBest) {
+    result += MAX_VERSION_COUNT_OVERFLOW;
+  }
+  return result;
+}
+
 static bool ts_parser__better_version_exists(
   TSParser *self,
   StackVersion version,
@@ -434,10 +489,49 @@ static void ts_parser__external_scanner_deserialize(
   }
 }
 
+// Scanners that return `TREE_SITTER_SERIALIZATION_UNCHANGED` from `serialize`
+// allow the parser to keep track of which state they currently hold. In that
+// case, `external_scanner_state_token` is a token whose state is identical to
+// the scanner's current state, and deserializing that same state again can be
+// skipped.
+static void ts_parser__set_external_scanner_state_token(
+  TSParser *self,
+  Subtree token
+) {
+  if (token.ptr) ts_subtree_retain(token);
+  if (self->external_scanner_state_token.ptr) {
+    ts_subtree_release(&self->tree_pool, self->external_scanner_state_token);
+  }
+  self->external_scanner_state_token = token;
+  self->external_scanner_state_is_current = true;
+}
+
+static void ts_parser__clear_external_scanner_state_token(TSParser *self) {
+  if (self->external_scanner_state_token.ptr) {
+    ts_subtree_release(&self->tree_pool, self->external_scanner_state_token);
+    self->external_scanner_state_token = NULL_SUBTREE;
+  }
+  self->external_scanner_state_is_current = false;
+}
+
+static void ts_parser__external_scanner_restore(
+  TSParser *self,
+  Subtree external_token
+) {
+  if (
+    self->external_scanner_state_is_current &&
+    ts_subtree_external_scanner_state_eq(self->external_scanner_state_token, external_token)
+  ) return;
+
+  ts_parser__external_scanner_deserialize(self, external_token);
+  ts_parser__set_external_scanner_state_token(self, external_token);
+}
+
 static bool ts_parser__external_scanner_scan(
   TSParser *self,
   TSStateId external_lex_state
 ) {
+  self->stats.external_scan_count++;
   if (ts_language_is_wasm(self->language)) {
     bool result = ts_wasm_store_call_scanner_scan(
       self->wasm_store,
@@ -509,6 +603,7 @@ static Subtree ts_parser__lex(
 
   const Length start_position = ts_stack_position(self->stack, version);
   const Subtree external_token = ts_stack_last_external_token(self->stack, version);
+  self->stats.lex_count++;
 
   bool found_external_token = false;
   bool error_mode = parse_state == ERROR_STATE;
@@ -520,6 +615,7 @@ static Subtree ts_parser__lex(
   uint32_t lookahead_end_byte = 0;
   uint32_t external_scanner_state_len = 0;
   bool external_scanner_state_changed = false;
+  bool external_scanner_state_unchanged = false;
   ts_lexer_reset(&self->lexer, start_position);
 
   for (;;) {
@@ -534,18 +630,36 @@ static Subtree ts_parser__lex(
         current_position.extent.column
       );
       ts_lexer_start(&self->lexer);
-      ts_parser__external_scanner_deserialize(self, external_token);
+      ts_parser__external_scanner_restore(self, external_token);
       found_token = ts_parser__external_scanner_scan(self, lex_mode.external_lex_state);
       if (self->has_scanner_error) return NULL_SUBTREE;
       ts_lexer_finish(&self->lexer, &lookahead_end_byte);
 
-      if (found_token) {
+      // Scanners that report unchanged states are also asked about their state
+      // after failed scans, so that the parser still knows what state they hold.
+      external_scanner_state_unchanged = false;
+      if (found_token || self->external_scanner_reports_unchanged) {
         external_scanner_state_len = ts_parser__external_scanner_serialize(self);
-        external_scanner_state_changed = !ts_external_scanner_state_eq(
-          ts_subtree_external_scanner_state(external_token),
-          self->lexer.debug_buffer,
-          external_scanner_state_len
-        );
+        if (external_scanner_state_len == TREE_SITTER_SERIALIZATION_UNCHANGED) {
+          self->external_scanner_reports_unchanged = true;
+          external_scanner_state_unchanged = true;
+        }
+      }
+      if (!external_scanner_state_unchanged) {
+        ts_parser__clear_external_scanner_state_token(self);
+      }
+
+      if (found_token) {
+        if (external_scanner_state_unchanged) {
+          external_scanner_state_len = ts_subtree_external_scanner_state(external_token)->length;
+          external_scanner_state_changed = false;
+        } else {
+          external_scanner_state_changed = !ts_external_scanner_state_eq(
+            ts_subtree_external_scanner_state(external_token),
+            self->lexer.debug_buffer,
+            external_scanner_state_len
+          );
+        }
 
         // When recovering from an error, ignore any zero-length external tokens
         // unless they have changed the external scanner's state. This helps to
@@ -617,6 +731,10 @@ static Subtree ts_parser__lex(
     error_end_position = self->lexer.current_position;
   }
 
+  if (lookahead_end_byte > start_position.bytes) {
+    self->stats.lexed_byte_count += lookahead_end_byte - start_position.bytes;
+  }
+
   Subtree result;
   if (skipped_error) {
     Length padding = length_sub(error_start_position, start_position);
@@ -671,11 +789,23 @@ static Subtree ts_parser__lex(
 
     if (found_external_token) {
       MutableSubtree mut_result = ts_subtree_to_mut_unsafe(result);
-      ts_external_scanner_state_init(
-        &mut_result.ptr->external_scanner_state,
-        self->lexer.debug_buffer,
-        external_scanner_state_len
-      );
+      if (external_scanner_state_unchanged) {
+        ts_external_scanner_state_init_shared(
+          &mut_result.ptr->external_scanner_state,
+          self->tree_pool.arena,
+          external_token
+        );
+      } else {
+        ts_external_scanner_state_init(
+          &mut_result.ptr->external_scanner_state,
+          self->tree_pool.arena,
+          self->lexer.debug_buffer,
+          external_scanner_state_len
+        );
+        if (self->external_scanner_reports_unchanged) {
+          ts_parser__set_external_scanner_state_token(self, result);
+        }
+      }
       mut_result.ptr->has_external_scanner_state_change = external_scanner_state_changed;
     }
   }
@@ -695,33 +825,60 @@ static Subtree ts_parser__get_cached_token(
   TableEntry *table_entry
 ) {
   TokenCache *cache = &self->token_cache;
-  if (
-    cache->token.ptr && cache->byte_index == position &&
-    ts_subtree_external_scanner_state_eq(cache->last_external_token, last_external_token)
-  ) {
-    ts_language_table_entry(self->language, state, ts_subtree_symbol(cache->token), table_entry);
-    if (ts_parser__can_reuse_first_leaf(self, state, cache->token, table_entry)) {
-      ts_subtree_retain(cache->token);
-      return cache->token;
+
+  // Check the most recently lexed tokens first.
+  for (uint32_t i = 1; i <= TOKEN_CACHE_SIZE; i++) {
+    TokenCacheEntry *entry = &cache->entries[(cache->next_index + TOKEN_CACHE_SIZE - i) % TOKEN_CACHE_SIZE];
+    if (
+      entry->token.ptr && entry->byte_index == position &&
+      ts_subtree_external_scanner_state_eq(entry->last_external_token, last_external_token)
+    ) {
+      ts_language_table_entry(self->language, state, ts_subtree_symbol(entry->token), table_entry);
+      if (ts_parser__can_reuse_first_leaf(self, state, entry->token, table_entry)) {
+        self->stats.token_cache_hit_count++;
+        ts_subtree_retain(entry->token);
+        return entry->token;
+      }
     }
   }
+  self->stats.token_cache_miss_count++;
   return NULL_SUBTREE;
 }
 
-static void ts_parser__set_cached_token(
+static void ts_parser__set_cached_token_entry(
   TSParser *self,
+  TokenCacheEntry *entry,
   uint32_t byte_index,
   Subtree last_external_token,
   Subtree token
 ) {
-  TokenCache *cache = &self->token_cache;
   if (token.ptr) ts_subtree_retain(token);
   if (last_external_token.ptr) ts_subtree_retain(last_external_token);
-  if (cache->token.ptr) ts_subtree_release(&self->tree_pool, cache->token);
-  if (cache->last_external_token.ptr) ts_subtree_release(&self->tree_pool, cache->last_external_token);
-  cache->token = token;
-  cache->byte_index = byte_index;
-  cache->last_external_token = last_external_token;
+  if (entry->token.ptr) ts_subtree_release(&self->tree_pool, entry->token);
+  if (entry->last_external_token.ptr) ts_subtree_release(&self->tree_pool, entry->last_external_token);
+  entry->token = token;
+  entry->byte_index = byte_index;
+  entry->last_external_token = last_external_token;
+}
+
+static void ts_parser__set_cached_token(
+  TSParser *self,
+  uint32_t byte_index,
+  Subtree last_external_token,
+  Subtree token
+) {
+  TokenCache *cache = &self->token_cache;
+  TokenCacheEntry *entry = &cache->entries[cache->next_index];
+  ts_parser__set_cached_token_entry(self, entry, byte_index, last_external_token, token);
+  cache->next_index = (cache->next_index + 1) % TOKEN_CACHE_SIZE;
+}
+
+static void ts_parser__clear_token_cache(TSParser *self) {
+  TokenCache *cache = &self->token_cache;
+  for (uint32_t i = 0; i < TOKEN_CACHE_SIZE; i++) {
+    ts_parser__set_cached_token_entry(self, &cache->entries[i], 0, NULL_SUBTREE, NULL_SUBTREE);
+  }
+  cache->next_index = 0;
 }
 
 static bool ts_parser__has_included_range_difference(
@@ -809,6 +966,8 @@ static Subtree ts_parser__reuse_node(
     }
 
     LOG("reuse_node symbol:%s", TREE_NAME(result));
+    self->stats.reused_node_count++;
+    self->stats.reused_byte_count += ts_subtree_total_bytes(result);
     ts_subtree_retain(result);
     return result;
   }
@@ -879,6 +1038,7 @@ static bool ts_parser__select_children(
   // room for its own heap data. The scratch tree is never explicitly released,
   // so the same 'scratch trees' array can be reused again later.
   MutableSubtree scratch_tree = ts_subtree_new_node(
+    NULL,
     ts_subtree_symbol(left),
     &self->scratch_trees,
     0,
@@ -899,6 +1059,7 @@ static void ts_parser__shift(
   Subtree lookahead,
   bool extra
 ) {
+  self->stats.shift_count++;
   bool is_leaf = ts_subtree_child_count(lookahead) == 0;
   Subtree subtree_to_push = lookahead;
   if (extra != ts_subtree_extra(lookahead) && is_leaf) {
@@ -915,6 +1076,12 @@ static void ts_parser__shift(
   }
 }
 
+static bool ts_parser__merge_versions(TSParser *self, StackVersion left, StackVersion right) {
+  if (!ts_stack_merge(self->stack, left, right)) return false;
+  self->stats.version_merge_count++;
+  return true;
+}
+
 static StackVersion ts_parser__reduce(
   TSParser *self,
   StackVersion version,
@@ -925,6 +1092,7 @@ static StackVersion ts_parser__reduce(
   bool is_fragile,
   bool end_of_non_terminal_extra
 ) {
+  self->stats.reduce_count++;
   uint32_t initial_version_count = ts_stack_version_count(self->stack);
 
   // Pop the given number of nodes from the given version of the parse stack.
@@ -937,12 +1105,14 @@ static StackVersion ts_parser__reduce(
   for (uint32_t i = 0; i < pop.size; i++) {
     StackSlice slice = pop.contents[i];
     StackVersion slice_version = slice.version - removed_version_count;
+    if (i > 0) self->stats.version_split_count++;
 
     // This is where new versions are added to the parse stack. The versions
     // will all be sorted and truncated at the end of the outer parsing loop.
-    // Allow the maximum version count to be temporarily exceeded, but only
-    // by a limited threshold.
-    if (slice_version > MAX_VERSION_COUNT + MAX_VERSION_COUNT_OVERFLOW) {
+    // Unless the newest versions are to be dropped, allow the maximum version
+    // count to be temporarily exceeded, but only by a limited threshold.
+    if (slice_version > ts_parser__max_version_count_while_advancing(self)) {
+      self->stats.version_limit_prune_count++;
       ts_stack_remove_version(self->stack, slice_version);
       ts_subtree_array_delete(&self->tree_pool, &slice.subtrees);
       removed_version_count++;
@@ -962,7 +1132,7 @@ static StackVersion ts_parser__reduce(
     ts_subtree_array_remove_trailing_extras(&children, &self->trailing_extras);
 
     MutableSubtree parent = ts_subtree_new_node(
-      symbol, &children, production_id, self->language
+      &self->tree_pool, symbol, &children, production_id, self->language
     );
 
     // This pop operation may have caused multiple stack versions to collapse
@@ -986,7 +1156,7 @@ static StackVersion ts_parser__reduce(
         ts_subtree_release(&self->tree_pool, ts_subtree_from_mut(parent));
         array_swap(&self->trailing_extras, &self->trailing_extras2);
         parent = ts_subtree_new_node(
-          symbol, &next_slice_children, production_id, self->language
+          &self->tree_pool, symbol, &next_slice_children, production_id, self->language
         );
       } else {
         array_clear(&self->trailing_extras2);
@@ -1017,7 +1187,7 @@ static StackVersion ts_parser__reduce(
 
     for (StackVersion j = 0; j < slice_version; j++) {
       if (j == version) continue;
-      if (ts_stack_merge(self->stack, j, slice_version)) {
+      if (ts_parser__merge_versions(self, j, slice_version)) {
         removed_version_count++;
         break;
       }
@@ -1054,6 +1224,7 @@ static void ts_parser__accept(
         }
         array_splice(&trees, j, 1, child_count, children);
         root = ts_subtree_from_mut(ts_subtree_new_node(
+          &self->tree_pool,
           ts_subtree_symbol(tree),
           &trees,
           tree.ptr->production_id,
@@ -1098,7 +1269,7 @@ static bool ts_parser__do_all_potential_reductions(
 
     bool merged = false;
     for (StackVersion j = initial_version_count; j < version; j++) {
-      if (ts_stack_merge(self->stack, j, version)) {
+      if (ts_parser__merge_versions(self, j, version)) {
         merged = true;
         break;
       }
@@ -1156,7 +1327,7 @@ static bool ts_parser__do_all_potential_reductions(
 
     if (has_shift_action) {
       can_shift_lookahead_symbol = true;
-    } else if (reduction_version != STACK_VERSION_NONE && i < MAX_VERSION_COUNT) {
+    } else if (reduction_version != STACK_VERSION_NONE && i < self->version_policy.max_version_count) {
       ts_stack_renumber_version(self->stack, reduction_version, version);
       continue;
     } else if (lookahead_symbol != 0) {
@@ -1215,7 +1386,7 @@ static bool ts_parser__recover_to_state(
     ts_subtree_array_remove_trailing_extras(&slice.subtrees, &self->trailing_extras);
 
     if (slice.subtrees.size > 0) {
-      Subtree error = ts_subtree_new_error_node(&slice.subtrees, true, self->language);
+      Subtree error = ts_subtree_new_error_node(&self->tree_pool, &slice.subtrees, true, self->language);
       ts_stack_push(self->stack, slice.version, error, false, goal_state);
     } else {
       array_delete(&slice.subtrees);
@@ -1312,7 +1483,8 @@ static void ts_parser__recover(
   // current lookahead token by wrapping it in an ERROR node.
 
   // Don't pursue this additional strategy if there are already too many stack versions.
-  if (did_recover && ts_stack_version_count(self->stack) > MAX_VERSION_COUNT) {
+  if (did_recover && ts_stack_version_count(self->stack) > self->version_policy.max_version_count) {
+    self->stats.version_limit_prune_count++;
     ts_stack_halt(self->stack, version);
     ts_subtree_release(&self->tree_pool, lookahead);
     return;
@@ -1332,7 +1504,7 @@ static void ts_parser__recover(
   if (ts_subtree_is_eof(lookahead)) {
     LOG("recover_eof");
     SubtreeArray children = array_new();
-    Subtree parent = ts_subtree_new_error_node(&children, false, self->language);
+    Subtree parent = ts_subtree_new_error_node(&self->tree_pool, &children, false, self->language);
     ts_stack_push(self->stack, version, parent, false, 1);
     ts_parser__accept(self, version, lookahead);
     return;
@@ -1344,6 +1516,7 @@ static void ts_parser__recover(
     ts_subtree_total_bytes(lookahead) * ERROR_COST_PER_SKIPPED_CHAR +
     ts_subtree_total_size(lookahead).extent.row * ERROR_COST_PER_SKIPPED_LINE;
   if (ts_parser__better_version_exists(self, version, false, new_cost)) {
+    self->stats.version_cost_prune_count++;
     ts_stack_halt(self->stack, version);
     ts_subtree_release(&self->tree_pool, lookahead);
     return;
@@ -1365,6 +1538,7 @@ static void ts_parser__recover(
   array_reserve(&children, 1);
   array_push(&children, lookahead);
   MutableSubtree error_repeat = ts_subtree_new_node(
+    &self->tree_pool,
     ts_builtin_sym_error_repeat,
     &children,
     0,
@@ -1393,6 +1567,7 @@ static void ts_parser__recover(
     ts_stack_renumber_version(self->stack, pop.contents[0].version, version);
     array_push(&pop.contents[0].subtrees, ts_subtree_from_mut(error_repeat));
     error_repeat = ts_subtree_new_node(
+      &self->tree_pool,
       ts_builtin_sym_error_repeat,
       &pop.contents[0].subtrees,
       0,
@@ -1409,11 +1584,16 @@ static void ts_parser__recover(
   }
 }
 
+static void ts_parser__record_error_recovery(TSParser *self, TSClock start_clock) {
+  self->error_recovery_duration += clock_duration_since(clock_now(), start_clock);
+}
+
 static void ts_parser__handle_error(
   TSParser *self,
   StackVersion version,
   Subtree lookahead
 ) {
+  TSClock start_clock = clock_now();
   uint32_t previous_version_count = ts_stack_version_count(self->stack);
 
   // Perform any reductions that can happen in this state, regardless of the lookahead. After
@@ -1455,6 +1635,7 @@ static void ts_parser__handle_error(
           uint32_t lookahead_bytes = ts_subtree_total_bytes(lookahead) + ts_subtree_lookahead_bytes(lookahead);
 
           StackVersion version_with_missing_tree = ts_stack_copy_version(self->stack, v);
+          self->stats.version_split_count++;
           Subtree missing_tree = ts_subtree_new_missing_leaf(
             &self->tree_pool, missing_symbol,
             padding, lookahead_bytes,
@@ -1487,7 +1668,7 @@ static void ts_parser__handle_error(
   }
 
   for (unsigned i = previous_version_count; i < version_count; i++) {
-    bool did_merge = ts_stack_merge(self->stack, version, previous_version_count);
+    bool did_merge = ts_parser__merge_versions(self, version, previous_version_count);
     assert(did_merge);
     (void)did_merge;	//	fix warning/error with clang -Os
   }
@@ -1503,6 +1684,7 @@ static void ts_parser__handle_error(
     ts_parser__breakdown_lookahead(self, &lookahead, ERROR_STATE, &self->reusable_node);
   }
   ts_parser__recover(self, version, lookahead);
+  ts_parser__record_error_recovery(self, start_clock);
 
   LOG_STACK();
 }
@@ -1544,6 +1726,15 @@ static bool ts_parser__advance(
       lookahead = ts_parser__lex(self, version, state);
       if (self->has_scanner_error) return false;
 
+      // If the lexer reached text that is not available yet, then this token
+      // may be incomplete. Discard it, and lex it again when parsing resumes.
+      if (self->lexer.input_pending) {
+        LOG("input_pending");
+        if (lookahead.ptr) ts_subtree_release(&self->tree_pool, lookahead);
+        ts_parser__clear_external_scanner_state_token(self);
+        return false;
+      }
+
       if (lookahead.ptr) {
         ts_parser__set_cached_token(self, position, last_external_token, lookahead);
         ts_language_table_entry(self->language, state, ts_subtree_symbol(lookahead), &table_entry);
@@ -1557,6 +1748,18 @@ static bool ts_parser__advance(
       }
     }
 
+    // If an operation limit was provided, then halt once this call has used
+    // up its budget. This is just a counter, so it's checked every time.
+    if (self->operation_limit) {
+      if (self->operations_remaining == 0) {
+        if (lookahead.ptr) {
+          ts_subtree_release(&self->tree_pool, lookahead);
+        }
+        return false;
+      }
+      self->operations_remaining--;
+    }
+
     // If a cancellation flag or a timeout was provided, then check every
     // time a fixed number of parse actions has been processed.
     if (++self->operation_count == OP_COUNT_PER_TIMEOUT_CHECK) {
@@ -1573,6 +1776,20 @@ static bool ts_parser__advance(
       return false;
     }
 
+    // Count the actions that will actually be performed. Shift actions that
+    // implement repetitions are skipped, so they don't make the state
+    // ambiguous. Each performed action after the first one is performed on a
+    // separate version of the stack, and nodes reduced in ambiguous states are
+    // marked as fragile, because they cannot be safely reused.
+    uint32_t performed_action_count = 0;
+    for (uint32_t i = 0; i < table_entry.action_count; i++) {
+      TSParseAction action = table_entry.actions[i];
+      if (action.type != TSParseActionTypeShift || !action.shift.repetition) {
+        if (performed_action_count > 0) self->stats.version_split_count++;
+        performed_action_count++;
+      }
+    }
+
     // Process each parse action for the current lookahead token in
     // the current state. If there are multiple actions, then this is
     // an ambiguous state. REDUCE actions always create a new stack
@@ -1605,7 +1822,7 @@ static bool ts_parser__advance(
         }
 
         case TSParseActionTypeReduce: {
-          bool is_fragile = table_entry.action_count > 1;
+          bool is_fragile = performed_action_count > 1;
           bool end_of_non_terminal_extra = lookahead.ptr == NULL;
           LOG("reduce sym:%s, child_count:%u", SYM_NAME(action.reduce.symbol), action.reduce.child_count);
           StackVersion reduction_version = ts_parser__reduce(
@@ -1630,7 +1847,9 @@ static bool ts_parser__advance(
             ts_parser__breakdown_lookahead(self, &lookahead, ERROR_STATE, &self->reusable_node);
           }
 
+          TSClock start_clock = clock_now();
           ts_parser__recover(self, version, lookahead);
+          ts_parser__record_error_recovery(self, start_clock);
           if (did_reuse) reusable_node_advance(&self->reusable_node);
           return true;
         }
@@ -1698,7 +1917,9 @@ static bool ts_parser__advance(
     // already in the error state, restart the error recovery process.
     // TODO - can this be unified with the other `RECOVER` case above?
     if (state == ERROR_STATE) {
+      TSClock start_clock = clock_now();
       ts_parser__recover(self, version, lookahead);
+      ts_parser__record_error_recovery(self, start_clock);
       return true;
     }
 
@@ -1728,6 +1949,24 @@ static bool ts_parser__advance(
 static unsigned ts_parser__condense_stack(TSParser *self) {
   bool made_changes = false;
   unsigned min_error_cost = UINT_MAX;
+
+  // Versions are added to the end of the stack, so before the versions are
+  // sorted, the newest ones are last. Halted versions are removed first, so
+  // that they don't take the place of live ones.
+  if (self->version_policy.strategy == TSVersionPruningStrategyDropNewest) {
+    for (StackVersion i = 0; i < ts_stack_version_count(self->stack); i++) {
+      if (ts_stack_is_halted(self->stack, i)) {
+        ts_stack_remove_version(self->stack, i);
+        i--;
+      }
+    }
+    while (ts_stack_version_count(self->stack) > self->version_policy.max_version_count) {
+      self->stats.version_limit_prune_count++;
+      ts_stack_remove_version(self->stack, ts_stack_version_count(self->stack) - 1);
+      made_changes = true;
+    }
+  }
+
   for (StackVersion i = 0; i < ts_stack_version_count(self->stack); i++) {
     // Prune any versions that have been marked for removal.
     if (ts_stack_is_halted(self->stack, i)) {
@@ -1752,6 +1991,7 @@ static unsigned ts_parser__condense_stack(TSParser *self) {
       switch (ts_parser__compare_versions(self, status_j, status_i)) {
         case ErrorComparisonTakeLeft:
           made_changes = true;
+          self->stats.version_cost_prune_count++;
           ts_stack_remove_version(self->stack, i);
           i--;
           j = i;
@@ -1759,7 +1999,7 @@ static unsigned ts_parser__condense_stack(TSParser *self) {
 
         case ErrorComparisonPreferLeft:
         case ErrorComparisonNone:
-          if (ts_stack_merge(self->stack, j, i)) {
+          if (ts_parser__merge_versions(self, j, i)) {
             made_changes = true;
             i--;
             j = i;
@@ -1768,7 +2008,7 @@ static unsigned ts_parser__condense_stack(TSParser *self) {
 
         case ErrorComparisonPreferRight:
           made_changes = true;
-          if (ts_stack_merge(self->stack, j, i)) {
+          if (ts_parser__merge_versions(self, j, i)) {
             i--;
             j = i;
           } else {
@@ -1778,6 +2018,7 @@ static unsigned ts_parser__condense_stack(TSParser *self) {
 
         case ErrorComparisonTakeRight:
           made_changes = true;
+          self->stats.version_cost_prune_count++;
           ts_stack_remove_version(self->stack, j);
           i--;
           j--;
@@ -1788,8 +2029,9 @@ static unsigned ts_parser__condense_stack(TSParser *self) {
 
   // Enforce a hard upper bound on the number of stack versions by
   // discarding the least promising versions.
-  while (ts_stack_version_count(self->stack) > MAX_VERSION_COUNT) {
-    ts_stack_remove_version(self->stack, MAX_VERSION_COUNT);
+  while (ts_stack_version_count(self->stack) > self->version_policy.max_version_count) {
+    self->stats.version_limit_prune_count++;
+    ts_stack_remove_version(self->stack, self->version_policy.max_version_count);
     made_changes = true;
   }
 
@@ -1800,7 +2042,7 @@ static unsigned ts_parser__condense_stack(TSParser *self) {
     bool has_unpaused_version = false;
     for (StackVersion i = 0, n = ts_stack_version_count(self->stack); i < n; i++) {
       if (ts_stack_is_paused(self->stack, i)) {
-        if (!has_unpaused_version && self->accept_count < MAX_VERSION_COUNT) {
+        if (!has_unpaused_version && self->accept_count < self->version_policy.max_version_count) {
           LOG("resume version:%u", i);
           min_error_cost = ts_stack_error_cost(self->stack, i);
           Subtree lookahead = ts_stack_resume(self->stack, i);
@@ -1825,8 +2067,116 @@ static unsigned ts_parser__condense_stack(TSParser *self) {
   return min_error_cost;
 }
 
+// Check whether a subtree that is alone on the stack, in the given state, would
+// be the only child of the root node if the document ended there.
+static bool ts_parser__can_reduce_to_root(TSParser *self, TSStateId state) {
+  TableEntry entry;
+  ts_language_table_entry(self->language, state, ts_builtin_sym_end, &entry);
+  for (uint32_t i = 0; i < entry.action_count; i++) {
+    TSParseAction action = entry.actions[i];
+    if (action.type != TSParseActionTypeReduce || action.reduce.child_count != 1) continue;
+    TSStateId next_state = ts_language_next_state(self->language, 1, action.reduce.symbol);
+    TableEntry next_entry;
+    ts_language_table_entry(self->language, next_state, ts_builtin_sym_end, &next_entry);
+    if (next_entry.action_count > 0 && next_entry.actions[0].type == TSParseActionTypeAccept) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static void ts_parser__emit_children(TSParser *self, TSNode node) {
+  TSTreeCursor cursor = ts_tree_cursor_new(node);
+  if (ts_tree_cursor_goto_first_child(&cursor)) {
+    do {
+      TSNode child = ts_tree_cursor_current_node(&cursor);
+      const TSAllocator *previous_allocator = ts_allocator_push(NULL);
+      self->stream_callback.emit(self->stream_callback.payload, child);
+      ts_allocator_pop(previous_allocator);
+    } while (ts_tree_cursor_goto_next_sibling(&cursor));
+  }
+  ts_tree_cursor_delete(&cursor);
+}
+
+// Add the ERROR and MISSING nodes within a subtree that starts at the beginning
+// of the document to the parser's syntax check. Like `ts_node_has_error`, this
+// only descends into subtrees whose error cost is nonzero.
+static void ts_parser__check_subtree(TSParser *self, Subtree tree) {
+  TSSyntaxCheck *check = &self->syntax_check;
+  array_clear(&self->syntax_check_stack);
+  array_push(&self->syntax_check_stack, ((SyntaxCheckEntry) {tree, length_zero()}));
+  while (self->syntax_check_stack.size > 0) {
+    SyntaxCheckEntry entry = array_pop(&self->syntax_check_stack);
+    bool is_error = ts_subtree_is_error(entry.tree);
+    bool is_missing = ts_subtree_missing(entry.tree);
+    if (is_error || is_missing) {
+      Length start = length_add(entry.position, ts_subtree_padding(entry.tree));
+      Length end = length_add(start, ts_subtree_size(entry.tree));
+      if (check->error_count + check->missing_count == 0) {
+        check->first_error = (TSRange) {start.extent, end.extent, start.bytes, end.bytes};
+      }
+      if (is_error) check->error_count++;
+      if (is_missing) check->missing_count++;
+    }
+
+    uint32_t child_count = ts_subtree_child_count(entry.tree);
+    if (child_count == 0 || ts_subtree_error_cost(entry.tree) == 0) continue;
+
+    // Push the children in reverse, so that they are visited in document order.
+    uint32_t end_index = self->syntax_check_stack.size + child_count;
+    array_grow_by(&self->syntax_check_stack, child_count);
+    Length position = entry.position;
+    const Subtree *children = ts_subtree_children(entry.tree);
+    for (uint32_t i = 0; i < child_count; i++) {
+      self->syntax_check_stack.contents[end_index - 1 - i] = (SyntaxCheckEntry) {children[i], position};
+      position = length_add(position, ts_subtree_total_size(children[i]));
+    }
+  }
+}
+
+// If the stack has collapsed to a single hidden subtree that can only become
+// part of the root node, pass its children to the stream callback, and replace
+// it with a hidden leaf of the same length, so that its memory can be freed.
+// During a syntax check, the subtree is searched for errors instead.
+// Only shallow stacks are examined, so that this takes constant time. The
+// stack is shallow whenever the next top-level node has just begun, apart from
+// any extras that follow the previous one.
+static void ts_parser__stream(TSParser *self) {
+  Subtree bottom;
+  TSStateId state;
+  if (
+    ts_stack_version_count(self->stack) != 1 ||
+    ts_stack_state(self->stack, 0) == ERROR_STATE ||
+    !ts_stack_bottom_subtree(self->stack, 0, MAX_STREAM_STACK_DEPTH, &bottom, &state) ||
+    !bottom.ptr ||
+    ts_subtree_child_count(bottom) == 0 ||
+    ts_subtree_visible(bottom) ||
+    !ts_parser__can_reduce_to_root(self, state)
+  ) return;
+
+  LOG("stream symbol:%s", SYM_NAME(ts_subtree_symbol(bottom)));
+  if (self->is_checking) {
+    ts_parser__check_subtree(self, bottom);
+  } else {
+    TSTree tree = {
+      .root = bottom,
+      .language = self->language,
+      .included_ranges = self->lexer.included_ranges,
+      .included_range_count = self->lexer.included_range_count,
+      .arenas = array_new(),
+      .parent_index = NULL,
+      .parent_index_enabled = false,
+    };
+    ts_parser__emit_children(self, ts_tree_root_node(&tree));
+  }
+
+  Subtree placeholder = ts_subtree_new_placeholder(&self->tree_pool, bottom, self->language);
+  ts_stack_replace_bottom_subtree(self->stack, 0, placeholder);
+}
+
 static bool ts_parser_has_outstanding_parse(TSParser *self) {
   return (
+    self->lexer.input_pending ||
     self->external_scanner_payload ||
     ts_stack_state(self->stack, 0) != 1 ||
     ts_stack_node_count_since_error(self->stack, 0) != 0
@@ -1836,7 +2186,13 @@ static bool ts_parser_has_outstanding_parse(TSParser *self) {
 // Parser - Public
 
 TSParser *ts_parser_new(void) {
+  return ts_parser_new_with_allocator((TSAllocator) {0});
+}
+
+TSParser *ts_parser_new_with_allocator(TSAllocator allocator) {
+  const TSAllocator *previous_allocator = ts_allocator_push(&allocator);
   TSParser *self = ts_calloc(1, sizeof(TSParser));
+  self->allocator = allocator;
   ts_lexer_init(&self->lexer);
   array_init(&self->reduce_actions);
   array_reserve(&self->reduce_actions, 4);
@@ -1847,21 +2203,39 @@ TSParser *ts_parser_new(void) {
   self->dot_graph_file = NULL;
   self->cancellation_flag = NULL;
   self->timeout_duration = 0;
+  self->operation_limit = 0;
+  self->operations_remaining = 0;
   self->language = NULL;
   self->has_scanner_error = false;
   self->external_scanner_payload = NULL;
+  self->external_scanner_state_token = NULL_SUBTREE;
+  self->external_scanner_state_is_current = false;
+  self->external_scanner_reports_unchanged = false;
   self->end_clock = clock_null();
   self->operation_count = 0;
   self->old_tree = NULL_SUBTREE;
+  self->tree_reclaimer = NULL;
+  self->stream_callback = (TSStreamCallback) {NULL, NULL};
+  self->version_policy = (TSVersionPolicy) {
+    .max_version_count = DEFAULT_MAX_VERSION_COUNT,
+    .max_cost_difference = DEFAULT_MAX_COST_DIFFERENCE,
+    .strategy = TSVersionPruningStrategyKeepBest,
+  };
   self->included_range_differences = (TSRangeArray) array_new();
   self->included_range_difference_index = 0;
-  ts_parser__set_cached_token(self, 0, NULL_SUBTREE, NULL_SUBTREE);
+  self->arenas = (SubtreeArenaArray) array_new();
+  self->arena_enabled = false;
+  ts_parser__clear_token_cache(self);
+  ts_allocator_pop(previous_allocator);
   return self;
 }
 
 void ts_parser_delete(TSParser *self) {
   if (!self) return;
 
+  // The parser's own memory is freed with its allocator, so use a copy of it.
+  TSAllocator allocator = self->allocator;
+  const TSAllocator *previous_allocator = ts_allocator_push(&allocator);
   ts_parser_set_language(self, NULL);
   ts_stack_delete(self->stack);
   if (self->reduce_actions.contents) {
@@ -1876,13 +2250,15 @@ void ts_parser_delete(TSParser *self) {
   }
   ts_wasm_store_delete(self->wasm_store);
   ts_lexer_delete(&self->lexer);
-  ts_parser__set_cached_token(self, 0, NULL_SUBTREE, NULL_SUBTREE);
+  ts_parser__clear_token_cache(self);
   ts_subtree_pool_delete(&self->tree_pool);
   reusable_node_delete(&self->reusable_node);
   array_delete(&self->trailing_extras);
   array_delete(&self->trailing_extras2);
   array_delete(&self->scratch_trees);
+  array_delete(&self->syntax_check_stack);
   ts_free(self);
+  ts_allocator_pop(previous_allocator);
 }
 
 const TSLanguage *ts_parser_language(const TSParser *self) {
@@ -1916,6 +2292,31 @@ TSLogger ts_parser_logger(const TSParser *self) {
   return self->lexer.logger;
 }
 
+TSTreeReclaimer *ts_parser_tree_reclaimer(const TSParser *self) {
+  return self->tree_reclaimer;
+}
+
+void ts_parser_set_tree_reclaimer(TSParser *self, TSTreeReclaimer *reclaimer) {
+  self->tree_reclaimer = reclaimer;
+}
+
+TSVersionPolicy ts_parser_version_policy(const TSParser *self) {
+  return self->version_policy;
+}
+
+void ts_parser_set_version_policy(TSParser *self, TSVersionPolicy policy) {
+  if (policy.max_version_count == 0) policy.max_version_count = 1;
+  self->version_policy = policy;
+}
+
+TSStreamCallback ts_parser_stream_callback(const TSParser *self) {
+  return self->stream_callback;
+}
+
+void ts_parser_set_stream_callback(TSParser *self, TSStreamCallback callback) {
+  self->stream_callback = callback;
+}
+
 void ts_parser_set_logger(TSParser *self, TSLogger logger) {
   self->lexer.logger = logger;
 }
@@ -1952,12 +2353,41 @@ void ts_parser_set_timeout_micros(TSParser *self, uint64_t timeout_micros) {
   self->timeout_duration = duration_from_micros(timeout_micros);
 }
 
+uint64_t ts_parser_operation_limit(const TSParser *self) {
+  return self->operation_limit;
+}
+
+void ts_parser_set_operation_limit(TSParser *self, uint64_t operation_limit) {
+  self->operation_limit = operation_limit;
+}
+
+bool ts_parser_is_waiting_for_input(const TSParser *self) {
+  return self->lexer.input_pending;
+}
+
+bool ts_parser_arena_enabled(const TSParser *self) {
+  return self->arena_enabled;
+}
+
+void ts_parser_set_arena_enabled(TSParser *self, bool enabled) {
+  self->arena_enabled = enabled;
+}
+
+TSParseStats ts_parser_stats(const TSParser *self) {
+  TSParseStats result = self->stats;
+  result.error_recovery_micros = duration_to_micros(self->error_recovery_duration);
+  return result;
+}
+
 bool ts_parser_set_included_ranges(
   TSParser *self,
   const TSRange *ranges,
   uint32_t count
 ) {
-  return ts_lexer_set_included_ranges(&self->lexer, ranges, count);
+  const TSAllocator *previous_allocator = ts_allocator_push(&self->allocator);
+  bool result = ts_lexer_set_included_ranges(&self->lexer, ranges, count);
+  ts_allocator_pop(previous_allocator);
+  return result;
 }
 
 const TSRange *ts_parser_included_ranges(const TSParser *self, uint32_t *count) {
@@ -1965,38 +2395,68 @@ const TSRange *ts_parser_included_ranges(const TSParser *self, uint32_t *count)
 }
 
 void ts_parser_reset(TSParser *self) {
+  const TSAllocator *previous_allocator = ts_allocator_push(&self->allocator);
   ts_parser__external_scanner_destroy(self);
   if (self->wasm_store) {
     ts_wasm_store_reset(self->wasm_store);
   }
 
   if (self->old_tree.ptr) {
-    ts_subtree_release(&self->tree_pool, self->old_tree);
+    if (self->tree_reclaimer) {
+      ts_tree_reclaimer_add_subtree(self->tree_reclaimer, self->old_tree, self->language, &self->arenas);
+    } else {
+      ts_subtree_release(&self->tree_pool, self->old_tree);
+    }
     self->old_tree = NULL_SUBTREE;
   }
 
   reusable_node_clear(&self->reusable_node);
   ts_lexer_reset(&self->lexer, length_zero());
+  self->lexer.input_pending = false;
   ts_stack_clear(self->stack);
-  ts_parser__set_cached_token(self, 0, NULL_SUBTREE, NULL_SUBTREE);
+  ts_parser__clear_token_cache(self);
+  ts_parser__clear_external_scanner_state_token(self);
+  self->external_scanner_reports_unchanged = false;
   if (self->finished_tree.ptr) {
     ts_subtree_release(&self->tree_pool, self->finished_tree);
     self->finished_tree = NULL_SUBTREE;
   }
+
+  // Release the arenas only after every subtree owned by the parser has been
+  // released, since releasing a subtree writes to its reference count.
+  ts_subtree_arena_array_delete(&self->arenas);
+  self->tree_pool.arena = NULL;
   self->accept_count = 0;
   self->has_scanner_error = false;
+  ts_allocator_pop(previous_allocator);
 }
 
-TSTree *ts_parser_parse(
+// Parse a document, or check its syntax if `is_checking` is true. This returns
+// `false` if the parse could not be performed, or was halted before finishing.
+// A finished parse stores its tree in `result`, and a finished syntax check
+// leaves its summary in the parser's `syntax_check` field.
+static bool ts_parser__parse(
   TSParser *self,
   const TSTree *old_tree,
-  TSInput input
+  TSInput input,
+  bool is_checking,
+  TSTree **result
 ) {
-  TSTree *result = NULL;
-  if (!self->language || !input.read) return NULL;
+  bool did_finish = false;
+  if (!self->language || !input.read) return false;
+
+  // The old tree's nodes can only be reused if they can be freed by the
+  // parser's allocator.
+  if (old_tree && !ts_allocator_eq(&old_tree->allocator, &self->allocator)) old_tree = NULL;
+  if (is_checking) old_tree = NULL;
+
+  // A halted parse can only be resumed in the same mode that it began in.
+  if (ts_parser_has_outstanding_parse(self) && self->is_checking != is_checking) {
+    ts_parser_reset(self);
+  }
 
   if (ts_language_is_wasm(self->language)) {
-    if (!self->wasm_store) return NULL;
+    if (!self->wasm_store) return false;
     ts_wasm_store_start(self->wasm_store, &self->lexer.data, self->language);
   }
 
@@ -2007,10 +2467,24 @@ TSTree *ts_parser_parse(
   if (ts_parser_has_outstanding_parse(self)) {
     LOG("resume_parsing");
   } else {
+    self->stats = (TSParseStats) {0};
+    self->error_recovery_duration = 0;
+    self->is_checking = is_checking;
+    self->syntax_check = (TSSyntaxCheck) {0};
     ts_parser__external_scanner_create(self);
     if (self->has_scanner_error) goto exit;
 
-    if (old_tree) {
+    if (self->arena_enabled) {
+      self->tree_pool.arena = ts_subtree_arena_new();
+      array_push(&self->arenas, self->tree_pool.arena);
+    }
+
+    if (old_tree && !self->stream_callback.emit) {
+      // Nodes from the old tree may be reused, so any arenas that they live
+      // in must outlive the new tree.
+      for (uint32_t i = 0; i < old_tree->arenas.size; i++) {
+        ts_subtree_arena_array_add(&self->arenas, old_tree->arenas.contents[i]);
+      }
       ts_subtree_retain(old_tree->root);
       self->old_tree = old_tree->root;
       ts_range_array_get_changed_ranges(
@@ -2030,8 +2504,10 @@ TSTree *ts_parser_parse(
       LOG("new_parse");
     }
   }
+  self->lexer.input_pending = false;
 
   self->operation_count = 0;
+  self->operations_remaining = self->operation_limit;
   if (self->timeout_duration) {
     self->end_clock = clock_after(clock_now(), self->timeout_duration);
   } else {
@@ -2059,10 +2535,11 @@ TSTree *ts_parser_parse(
 
         if (!ts_parser__advance(self, version, allow_node_reuse)) {
           if (self->has_scanner_error) goto exit;
-          return NULL;
+          return false;
         }
 
         LOG_STACK();
+        if (self->stream_callback.emit || self->is_checking) ts_parser__stream(self);
 
         position = ts_stack_position(self->stack, version).bytes;
         if (position > last_position || (version > 0 && position == last_position)) {
@@ -2072,6 +2549,10 @@ TSTree *ts_parser_parse(
       }
     }
 
+    if (version_count > self->stats.max_version_count) {
+      self->stats.max_version_count = version_count;
+    }
+
     // After advancing each version of the stack, re-sort the versions by their cost,
     // removing any versions that are no longer worth pursuing.
     unsigned min_error_cost = ts_parser__condense_stack(self);
@@ -2096,20 +2577,43 @@ TSTree *ts_parser_parse(
   } while (version_count != 0);
 
   assert(self->finished_tree.ptr);
-  ts_subtree_balance(self->finished_tree, &self->tree_pool, self->language);
+  did_finish = true;
   LOG("done");
+
+  // A syntax check doesn't produce a tree, so the finished tree doesn't need
+  // to be balanced. It is released when the parser is reset.
+  if (self->is_checking) {
+    ts_parser__check_subtree(self, self->finished_tree);
+    goto exit;
+  }
+
+  ts_subtree_balance(self->finished_tree, &self->tree_pool, self->language);
   LOG_TREE(self->finished_tree);
 
-  result = ts_tree_new(
+  *result = ts_tree_new(
     self->finished_tree,
     self->language,
     self->lexer.included_ranges,
     self->lexer.included_range_count
   );
+  ts_tree_add_arenas(*result, &self->arenas);
   self->finished_tree = NULL_SUBTREE;
+  if (self->stream_callback.emit) ts_parser__emit_children(self, ts_tree_root_node(*result));
 
 exit:
   ts_parser_reset(self);
+  return did_finish;
+}
+
+TSTree *ts_parser_parse(
+  TSParser *self,
+  const TSTree *old_tree,
+  TSInput input
+) {
+  const TSAllocator *previous_allocator = ts_allocator_push(&self->allocator);
+  TSTree *result = NULL;
+  ts_parser__parse(self, old_tree, input, false, &result);
+  ts_allocator_pop(previous_allocator);
   return result;
 }
 
@@ -2137,6 +2641,99 @@ TSTree *ts_parser_parse_string_encoding(
   });
 }
 
+bool ts_parser_check(
+  TSParser *self,
+  TSInput input,
+  TSSyntaxCheck *result
+) {
+  const TSAllocator *previous_allocator = ts_allocator_push(&self->allocator);
+  TSTree *tree = NULL;
+  bool did_finish = ts_parser__parse(self, NULL, input, true, &tree);
+  ts_allocator_pop(previous_allocator);
+  if (did_finish) *result = self->syntax_check;
+  return did_finish;
+}
+
+bool ts_parser_check_string(
+  TSParser *self,
+  const char *string,
+  uint32_t length,
+  TSSyntaxCheck *result
+) {
+  TSStringInput input = {string, length};
+  return ts_parser_check(self, (TSInput) {
+    &input,
+    ts_string_input_read,
+    TSInputEncodingUTF8,
+  }, result);
+}
+
+#ifdef _WIN32
+
+TSTree *ts_parser_parse_file(
+  TSParser *self,
+  const TSTree *old_tree,
+  int file_descriptor
+) {
+  HANDLE file = (HANDLE)_get_osfhandle(file_descriptor);
+  LARGE_INTEGER size;
+  if (file == INVALID_HANDLE_VALUE || !GetFileSizeEx(file, &size)) return NULL;
+  if (size.QuadPart == 0) return ts_parser_parse_string(self, old_tree, "", 0);
+  if (size.QuadPart > UINT32_MAX) return NULL;
+
+  HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+  if (!mapping) return NULL;
+  const char *contents = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  if (!contents) {
+    CloseHandle(mapping);
+    return NULL;
+  }
+
+  TSTree *result = ts_parser_parse_string(self, old_tree, contents, (uint32_t)size.QuadPart);
+  UnmapViewOfFile(contents);
+  CloseHandle(mapping);
+  return result;
+}
+
+#elif defined(__unix__) || defined(__APPLE__)
+
+TSTree *ts_parser_parse_file(
+  TSParser *self,
+  const TSTree *old_tree,
+  int file_descriptor
+) {
+  struct stat file_info;
+  if (fstat(file_descriptor, &file_info) != 0 || !S_ISREG(file_info.st_mode)) return NULL;
+  if (file_info.st_size == 0) return ts_parser_parse_string(self, old_tree, "", 0);
+  if ((uint64_t)file_info.st_size > UINT32_MAX) return NULL;
+
+  size_t size = (size_t)file_info.st_size;
+  void *contents = mmap(NULL, size, PROT_READ, MAP_PRIVATE, file_descriptor, 0);
+  if (contents == MAP_FAILED) return NULL;
+
+  // The lexer mostly reads forward, so let the OS read ahead aggressively.
+  posix_madvise(contents, size, POSIX_MADV_SEQUENTIAL);
+
+  TSTree *result = ts_parser_parse_string(self, old_tree, contents, (uint32_t)size);
+  munmap(contents, size);
+  return result;
+}
+
+#else
+
+TSTree *ts_parser_parse_file(
+  TSParser *self,
+  const TSTree *old_tree,
+  int file_descriptor
+) {
+  (void)self;
+  (void)old_tree;
+  (void)file_descriptor;
+  return NULL;
+}
+
+#endif
+
 void ts_parser_set_wasm_store(TSParser *self, TSWasmStore *store) {
   ts_wasm_store_delete(self->wasm_store);
   self->wasm_store = store;
@@ -2148,4 +2745,115 @@ TSWasmStore *ts_parser_take_wasm_store(TSParser *self) {
   return result;
 }
 
+// Parser Pool
+
+struct TSParserPool {
+  const TSLanguage *language;
+  Array(TSParser *) parsers;
+  uint32_t max_parser_count;
+  size_t max_retained_size;
+};
+
+// Get the number of bytes that the parser keeps allocated between parses, in
+// order to avoid reallocating its working memory on each parse.
+static size_t ts_parser__retained_size(const TSParser *self) {
+  return
+    ts_stack_retained_size(self->stack) +
+    self->tree_pool.free_trees.capacity * sizeof(MutableSubtree) +
+    self->tree_pool.free_trees.size * sizeof(SubtreeHeapData) +
+    self->tree_pool.tree_stack.capacity * sizeof(MutableSubtree) +
+    self->reduce_actions.capacity * sizeof(ReduceAction) +
+    self->trailing_extras.capacity * sizeof(Subtree) +
+    self->trailing_extras2.capacity * sizeof(Subtree) +
+    self->scratch_trees.capacity * sizeof(Subtree) +
+    self->reusable_node.stack.capacity * sizeof(StackEntry) +
+    self->included_range_differences.capacity * sizeof(TSRange);
+}
+
+// Release the working memory that the parser has kept from previous parses.
+// The parser must have been reset.
+static void ts_parser__shrink(TSParser *self) {
+  const TSAllocator *previous_allocator = ts_allocator_push(&self->allocator);
+  ts_stack_shrink(self->stack);
+  ts_subtree_pool_delete(&self->tree_pool);
+  self->tree_pool = ts_subtree_pool_new(32);
+  array_delete(&self->reduce_actions);
+  array_reserve(&self->reduce_actions, 4);
+  array_delete(&self->trailing_extras);
+  array_delete(&self->trailing_extras2);
+  array_delete(&self->scratch_trees);
+  array_delete(&self->reusable_node.stack);
+  array_delete(&self->included_range_differences);
+  ts_allocator_pop(previous_allocator);
+}
+
+TSParserPool *ts_parser_pool_new(
+  const TSLanguage *language,
+  uint32_t max_parser_count,
+  size_t max_retained_size
+) {
+  if (
+    !language ||
+    language->version > TREE_SITTER_LANGUAGE_VERSION ||
+    language->version < TREE_SITTER_MIN_COMPATIBLE_LANGUAGE_VERSION
+  ) return NULL;
+
+  TSParserPool *self = ts_malloc(sizeof(TSParserPool));
+  self->language = ts_language_copy(language);
+  array_init(&self->parsers);
+  self->max_parser_count = max_parser_count;
+  self->max_retained_size = max_retained_size;
+  return self;
+}
+
+void ts_parser_pool_delete(TSParserPool *self) {
+  if (!self) return;
+  for (unsigned i = 0; i < self->parsers.size; i++) {
+    ts_parser_delete(self->parsers.contents[i]);
+  }
+  array_delete(&self->parsers);
+  ts_language_delete(self->language);
+  ts_free(self);
+}
+
+TSParser *ts_parser_pool_acquire(TSParserPool *self) {
+  if (self->parsers.size > 0) return array_pop(&self->parsers);
+  TSParser *parser = ts_parser_new();
+  ts_parser_set_language(parser, self->language);
+  return parser;
+}
+
+void ts_parser_pool_release(TSParserPool *self, TSParser *parser) {
+  if (!parser) return;
+  if (self->parsers.size >= self->max_parser_count) {
+    ts_parser_delete(parser);
+    return;
+  }
+
+  if (parser->language == self->language) {
+    ts_parser_reset(parser);
+  } else {
+    ts_parser_set_language(parser, self->language);
+  }
+  ts_parser_set_logger(parser, (TSLogger) {NULL, NULL});
+  ts_parser_print_dot_graphs(parser, -1);
+  ts_parser_set_cancellation_flag(parser, NULL);
+  ts_parser_set_timeout_micros(parser, 0);
+  ts_parser_set_operation_limit(parser, 0);
+  ts_parser_set_included_ranges(parser, NULL, 0);
+  ts_parser_set_tree_reclaimer(parser, NULL);
+  ts_parser_set_stream_callback(parser, (TSStreamCallback) {NULL, NULL});
+  ts_parser_set_version_policy(parser, (TSVersionPolicy) {
+    .max_version_count = DEFAULT_MAX_VERSION_COUNT,
+    .max_cost_difference = DEFAULT_MAX_COST_DIFFERENCE,
+    .strategy = TSVersionPruningStrategyKeepBest,
+  });
+  parser->arena_enabled = false;
+
+  if (ts_parser__retained_size(parser) > self->max_retained_size) {
+    ts_parser__shrink(parser);
+  }
+  array_push(&self->parsers, parser);
+}
+
 #undef LOG
@@ -13,6 +13,13 @@ extern "C" {
 #define ts_builtin_sym_end 0
 #define TREE_SITTER_SERIALIZATION_BUFFER_SIZE 1024
 
+// An external scanner's `serialize` function can return this value instead of
+// writing its state to the buffer, if its state hasn't changed since it was
+// last serialized or deserialized. Scanners that do this can avoid copying
+// their state after every token, and also allow the parser to skip calls to
+// `deserialize` when the scanner already holds the state being restored.
+#define TREE_SITTER_SERIALIZATION_UNCHANGED ((unsigned)-1)
+
 #ifndef TREE_SITTER_API_H_
 typedef uint16_t TSStateId;
 typedef uint16_t TSSymbol;
@@ -37,6 +44,11 @@ typedef struct {
   bool supertype;
 } TSSymbolMetadata;
 
+typedef struct {
+  int32_t start;
+  int32_t end;
+} TSCharacterRange;
+
 typedef struct TSLexer TSLexer;
 
 struct TSLexer {
@@ -47,6 +59,7 @@ struct TSLexer {
   uint32_t (*get_column)(TSLexer *);
   bool (*is_at_included_range_start)(const TSLexer *);
   bool (*eof)(const TSLexer *);
+  uint32_t (*advance_while)(TSLexer *, const TSCharacterRange *, uint32_t, bool);
 };
 
 typedef enum {
@@ -123,6 +136,8 @@ struct TSLanguage {
     void (*deserialize)(void *, const char *, unsigned);
   } external_scanner;
   const TSStateId *primary_state_ids;
+  const uint32_t *small_parse_table_hash_map;
+  const uint16_t *small_parse_table_hashes;
 };
 
 /*
@@ -168,6 +183,75 @@ struct TSLanguage {
 
 #define END_STATE() return result;
 
+/*
+ *  Table-Driven Lexer
+ */
+
+#ifdef TREE_SITTER_TABLE_LEXER
+
+typedef struct {
+  int32_t start;
+  uint16_t char_class;
+} TSLexClassRange;
+
+typedef struct {
+  uint32_t row_offset;
+  TSSymbol accept_symbol;
+  bool accepts;
+} TSLexTableState;
+
+// An entry in the transition table. The action is the next state's id,
+// shifted left by one, with the low bit set if the character is skipped.
+typedef struct {
+  TSStateId state;
+  uint16_t action;
+} TSLexTableEntry;
+
+// A lex table generated with `--table-lexer`. Characters are mapped to
+// classes, and each state's transition for a class is found at the state's
+// row offset plus the class. An entry that belongs to a different state means
+// that there is no transition. Class 0 is used for the end of the input.
+typedef struct {
+  const uint16_t *ascii_classes;
+  const TSLexClassRange *class_ranges;
+  uint32_t class_range_count;
+  const TSLexTableState *states;
+  const TSLexTableEntry *entries;
+} TSLexTable;
+
+static inline uint16_t ts_lex_table_char_class(const TSLexTable *table, int32_t c) {
+  if (c >= 0 && c < 128) return table->ascii_classes[c];
+  if (c < 0 || c > 0x10FFFF) c = 0x10FFFF;
+  const TSLexClassRange *ranges = table->class_ranges;
+  uint32_t index = 0;
+  uint32_t size = table->class_range_count;
+  while (size > 1) {
+    uint32_t half_size = size / 2;
+    if (ranges[index + half_size].start <= c) index += half_size;
+    size -= half_size;
+  }
+  return ranges[index].char_class;
+}
+
+static inline bool ts_lex_with_table(TSLexer *lexer, TSStateId state, const TSLexTable *table) {
+  bool result = false;
+  for (;;) {
+    const TSLexTableState *lex_state = &table->states[state];
+    if (lex_state->accepts) {
+      result = true;
+      lexer->result_symbol = lex_state->accept_symbol;
+      lexer->mark_end(lexer);
+    }
+    uint16_t char_class = lexer->eof(lexer) ? 0 : ts_lex_table_char_class(table, lexer->lookahead);
+    const TSLexTableEntry *entry = &table->entries[lex_state->row_offset + char_class];
+    if (entry->state != state) return result;
+    state = entry->action >> 1;
+    lexer->advance(lexer, entry->action & 1);
+  }
+}
+
+#endif  // TREE_SITTER_TABLE_LEXER
+
 /*
  *  Parse Table Macros
  */
@@ -221,6 +305,86 @@ struct TSLanguage {
     .type = TSParseActionTypeAccept \
   }}
 
+/*
+ *  Compressed Tables
+ */
+
+#ifdef TREE_SITTER_COMPRESSED_TABLES
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+static inline uint32_t ts_read_varint(const uint8_t **data) {
+  uint32_t value = 0;
+  unsigned shift = 0;
+  uint8_t byte;
+  do {
+    byte = *(*data)++;
+    value |= (uint32_t)(byte & 0x7f) << shift;
+    shift += 7;
+  } while (byte & 0x80);
+  return value;
+}
+
+// Decode a table generated with `--compress-tables` into a zeroed buffer.
+// The data is a sequence of LEB128-encoded values, where each zero value is
+// followed by the length of a run of zeros. The runs are skipped over, so the
+// corresponding pages of the buffer are never touched.
+static inline void ts_inflate_table(uint16_t *table, const uint8_t *data, size_t length) {
+  const uint8_t *end = data + length;
+  while (data < end) {
+    uint32_t value = ts_read_varint(&data);
+    if (value == 0) {
+      table += ts_read_varint(&data);
+    } else {
+      *table++ = (uint16_t)value;
+    }
+  }
+}
+
+// Call `inflate` exactly once, even if the language is loaded on several
+// threads at the same time. The state is 0 before inflation starts, 1 while
+// it is in progress, and 2 once it has finished.
+static inline void ts_inflate_tables_once(volatile uint32_t *state, void (*inflate)(void)) {
+#if defined(__TINYC__)
+  if (*state == 0) {
+    *state = 1;
+    inflate();
+    *state = 2;
+  }
+#elif defined(_MSC_VER)
+  volatile long *flag = (volatile long *)state;
+  if (_InterlockedCompareExchange(flag, 2, 2) == 2) return;
+  if (_InterlockedCompareExchange(flag, 1, 0) == 0) {
+    inflate();
+    _InterlockedExchange(flag, 2);
+  } else {
+    while (_InterlockedCompareExchange(flag, 2, 2) != 2) {}
+  }
+#elif defined(__ATOMIC_ACQUIRE)
+  if (__atomic_load_n(state, __ATOMIC_ACQUIRE) == 2) return;
+  uint32_t expected = 0;
+  if (__atomic_compare_exchange_n(state, &expected, 1, false, __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE)) {
+    inflate();
+    __atomic_store_n(state, 2, __ATOMIC_RELEASE);
+  } else {
+    while (__atomic_load_n(state, __ATOMIC_ACQUIRE) != 2) {}
+  }
+#else
+  if (__sync_fetch_and_add(state, 0) == 2) return;
+  if (__sync_bool_compare_and_swap(state, 0, 1)) {
+    inflate();
+    __sync_synchronize();
+    *state = 2;
+  } else {
+    while (__sync_fetch_and_add(state, 0) != 2) {}
+  }
+#endif
+}
+
+#endif  // TREE_SITTER_COMPRESSED_TABLES
+
 #ifdef __cplusplus
 }
 #endif
@@ -3,6 +3,7 @@
 #include "./array.h"
 #include "./language.h"
 #include "./point.h"
+#include "./serialization.h"
 #include "./tree_cursor.h"
 #include "./unicode.h"
 #include <wctype.h>
@@ -177,10 +178,14 @@ typedef struct {
  *    different steps in their pattern. This means that in order to obey the
  *    'longest-match' rule, this state should not be returned as a match until
  *    it is clear that there can be no other alternative match with more captures.
+ * - `finish_index` - The number of states that had finished before this one.
+ *    Among finished states whose next captures are tied, this preserves the
+ *    order in which they finished.
  */
 typedef struct {
   uint32_t id;
   uint32_t capture_list_id;
+  uint32_t finish_index;
   uint16_t start_depth;
   uint16_t step_index;
   uint16_t pattern_index;
@@ -285,6 +290,7 @@ struct TSQuery {
   Array(CaptureQuantifiers) capture_quantifiers;
   Array(QueryStep) steps;
   Array(PatternEntry) pattern_map;
+  Array(uint32_t) pattern_map_offsets;
   Array(TSQueryPredicateStep) predicate_steps;
   Array(QueryPattern) patterns;
   Array(StepOffset) step_offsets;
@@ -295,14 +301,68 @@ struct TSQuery {
   uint16_t wildcard_root_pattern_count;
 };
 
+/*
+ * CursorQuery - One of several queries that a `TSQueryCursor` is executing
+ * together. The cursor numbers the patterns of all of its queries in sequence,
+ * and `pattern_offset` is the number assigned to this query's first pattern.
+ */
+typedef struct {
+  const TSQuery *query;
+  uint32_t pattern_offset;
+} CursorQuery;
+
+/*
+ * CursorRegex - A regular expression that a `TSQueryCursor` has compiled with
+ * its regex engine, in order to evaluate `#match?` predicates. Regexes are
+ * cached by their source, so that they can be shared between queries and
+ * reused across executions.
+ */
+typedef struct {
+  char *pattern;
+  uint32_t length;
+  void *regex;
+} CursorRegex;
+
+/*
+ * InProgressCapture - The earliest capture among the cursor's in-progress
+ * states, as found by `ts_query_cursor__first_in_progress_capture`. It is
+ * recomputed only after the in-progress states have changed.
+ */
+typedef struct {
+  uint32_t state_index;
+  uint32_t byte_offset;
+  uint32_t pattern_index;
+  bool is_definite;
+  bool is_current;
+} InProgressCapture;
+
 /*
  * TSQueryCursor - A stateful struct used to execute a query on a tree.
+ *
+ * When several queries are executed at once, they are stored in `queries`,
+ * and `pattern_query_indices` maps each of the cursor's pattern numbers to
+ * the query that it belongs to. Otherwise, both arrays are empty, and the
+ * single query is stored in `query`.
+ *
+ * If a text provider is set, the cursor evaluates the standard text predicates
+ * itself, and discards matches that fail them before they are returned.
+ *
+ * When captures are consumed one at a time, the first `finished_heap_size`
+ * elements of `finished_states` are kept as a binary min-heap, ordered by the
+ * position of each state's next capture, so that the earliest one can be found
+ * without scanning all of them.
  */
 struct TSQueryCursor {
+  TSAllocator allocator;
   const TSQuery *query;
+  Array(CursorQuery) queries;
+  Array(uint16_t) pattern_query_indices;
   TSTreeCursor cursor;
   Array(QueryState) states;
   Array(QueryState) finished_states;
+  uint32_t finished_heap_size;
+  uint32_t next_finish_index;
+  InProgressCapture in_progress_capture;
   CaptureListPool capture_list_pool;
   uint32_t depth;
   uint32_t max_start_depth;
@@ -311,10 +371,16 @@ struct TSQueryCursor {
   TSPoint start_point;
   TSPoint end_point;
   uint32_t next_state_id;
+  TSQueryTextProvider text_provider;
+  TSQueryRegexEngine regex_engine;
+  Array(CursorRegex) regexes;
+  Array(char) text_buffer;
   bool on_visible_node;
   bool ascending;
   bool halted;
   bool did_exceed_match_limit;
+  bool pattern_stats_enabled;
+  Array(TSQueryPatternStats) pattern_stats;
 };
 
 static const TSQueryError PARENT_DONE = -1;
@@ -1078,9 +1144,11 @@ static inline int analysis_subgraph_node__compare(const AnalysisSubgraphNode *se
 // of the patterns in the query, and a `step_index`, which indicates the start
 // offset of that pattern's steps within the `steps` array.
 //
-// The entries are sorted by the patterns' root symbols, and lookups use a
-// binary search. This ensures that the cost of this initial lookup step
-// scales logarithmically with the number of patterns in the query.
+// The entries are sorted by the patterns' root symbols. While the query is
+// being built, entries are found using a binary search. Once it is built, the
+// `pattern_map_offsets` table maps each symbol directly to its range of entries,
+// so that the query cursor can find the patterns for a node, or determine that
+// there are none, without searching.
 //
 // This returns `true` if the symbol is present and `false` otherwise.
 // If the symbol is not present `*result` is set to the index where the
@@ -1152,6 +1220,51 @@ static inline void ts_query__pattern_map_insert(
   array_insert(&self->pattern_map, index, new_entry);
 }
 
+// Map a symbol to its slot in the `pattern_map_offsets` table. Error nodes
+// don't have a symbol within the language's range of symbols, so they use the
+// last slot. Because the error symbol is also the largest symbol, the slots
+// are ordered in the same way as the `pattern_map` entries.
+static inline uint32_t ts_query__pattern_map_slot(const TSQuery *self, TSSymbol symbol) {
+  if (symbol == ts_builtin_sym_error) return ts_language_symbol_count(self->language);
+  return symbol;
+}
+
+// Build the `pattern_map_offsets` table. The entries for the symbols in slot
+// `i` start at index `pattern_map_offsets[i]` and end at index
+// `pattern_map_offsets[i + 1]` of the `pattern_map`.
+static void ts_query__build_pattern_map_offsets(TSQuery *self) {
+  uint32_t slot_count = ts_language_symbol_count(self->language) + 1;
+  array_clear(&self->pattern_map_offsets);
+  array_reserve(&self->pattern_map_offsets, slot_count + 1);
+  uint32_t index = self->wildcard_root_pattern_count;
+  for (uint32_t slot = 0; slot <= slot_count; slot++) {
+    while (index < self->pattern_map.size) {
+      PatternEntry *entry = &self->pattern_map.contents[index];
+      TSSymbol symbol = self->steps.contents[entry->step_index].symbol;
+      if (ts_query__pattern_map_slot(self, symbol) >= slot) break;
+      index++;
+    }
+    array_push(&self->pattern_map_offsets, index);
+  }
+}
+
+// Find the range of entries in the `pattern_map` for the patterns whose root
+// node matches the given symbol.
+static inline void ts_query__pattern_map_range(
+  const TSQuery *self,
+  TSSymbol symbol,
+  uint32_t *start,
+  uint32_t *end
+) {
+  uint32_t slot = ts_query__pattern_map_slot(self, symbol);
+  if (slot + 1 >= self->pattern_map_offsets.size) {
+    *start = *end = 0;
+    return;
+  }
+  *start = self->pattern_map_offsets.contents[slot];
+  *end = self->pattern_map_offsets.contents[slot + 1];
+}
+
 // Walk the subgraph for this non-terminal, tracking all of the possible
 // sequences of progress within the pattern.
 static void ts_query__perform_analysis(
@@ -2680,6 +2793,7 @@ TSQuery *ts_query_new(
   *self = (TSQuery) {
     .steps = array_new(),
     .pattern_map = array_new(),
+    .pattern_map_offsets = array_new(),
     .captures = symbol_table_new(),
     .capture_quantifiers = array_new(),
     .predicate_values = symbol_table_new(),
@@ -2790,6 +2904,7 @@ TSQuery *ts_query_new(
     return NULL;
   }
 
+  ts_query__build_pattern_map_offsets(self);
   array_delete(&self->string_buffer);
   return self;
 }
@@ -2798,6 +2913,7 @@ void ts_query_delete(TSQuery *self) {
   if (self) {
     array_delete(&self->steps);
     array_delete(&self->pattern_map);
+    array_delete(&self->pattern_map_offsets);
     array_delete(&self->predicate_steps);
     array_delete(&self->patterns);
     array_delete(&self->step_offsets);
@@ -2816,6 +2932,338 @@ void ts_query_delete(TSQuery *self) {
   }
 }
 
+/*
+ * Serialization - A compiled query can be saved in a binary format, so that
+ * it can later be loaded without parsing and analyzing its source again. The
+ * format starts with a header of little-endian 32-bit words:
+ *
+ *   magic, format version, language fingerprint, checksum
+ *
+ * and is followed by the contents of each of the query's arrays, in the order
+ * of the fields of `TSQuery`, with every integer stored as a varint. Loading
+ * a query checks that its indices are in bounds, but the query cursor relies
+ * on other invariants of the steps that are too costly to verify, so the
+ * checksum of the remaining data is used to reject corrupted queries.
+ */
+
+#define TS_SERIALIZED_QUERY_MAGIC 0x59515354
+#define TS_SERIALIZED_QUERY_VERSION 1
+#define TS_SERIALIZED_QUERY_HEADER_SIZE 16
+
+static void symbol_table_serialize(const SymbolTable *self, SerializationBuffer *buffer) {
+  serialization_write_varint(buffer, self->characters.size);
+  array_extend(buffer, self->characters.size, (const uint8_t *)self->characters.contents);
+  serialization_write_varint(buffer, self->slices.size);
+  for (unsigned i = 0; i < self->slices.size; i++) {
+    serialization_write_varint(buffer, self->slices.contents[i].offset);
+    serialization_write_varint(buffer, self->slices.contents[i].length);
+  }
+}
+
+static void symbol_table_deserialize(SymbolTable *self, SerializationReader *reader) {
+  uint32_t character_count = serialization_read_varint(reader);
+  const uint8_t *characters = serialization_read_bytes(reader, character_count);
+  if (!characters) return;
+  array_extend(&self->characters, character_count, (const char *)characters);
+
+  // Every name is followed by a null character.
+  uint32_t slice_count = serialization_read_bounded_varint(reader, character_count);
+  for (unsigned i = 0; i < slice_count && !reader->failed; i++) {
+    Slice slice;
+    slice.offset = serialization_read_bounded_varint(reader, character_count);
+    slice.length = serialization_read_bounded_varint(reader, character_count - slice.offset);
+    if (slice.offset + slice.length >= character_count || characters[slice.offset + slice.length]) {
+      reader->failed = true;
+    }
+    array_push(&self->slices, slice);
+  }
+}
+
+char *ts_query_serialize(const TSQuery *self, uint32_t *length) {
+  SerializationBuffer buffer = array_new();
+  serialization_write_uint32(&buffer, TS_SERIALIZED_QUERY_MAGIC);
+  serialization_write_uint32(&buffer, TS_SERIALIZED_QUERY_VERSION);
+  serialization_write_uint32(&buffer, ts_language_fingerprint(self->language));
+  serialization_write_uint32(&buffer, 0);
+
+  symbol_table_serialize(&self->captures, &buffer);
+  symbol_table_serialize(&self->predicate_values, &buffer);
+
+  serialization_write_varint(&buffer, self->capture_quantifiers.size);
+  for (unsigned i = 0; i < self->capture_quantifiers.size; i++) {
+    const CaptureQuantifiers *capture_quantifiers = &self->capture_quantifiers.contents[i];
+    serialization_write_varint(&buffer, capture_quantifiers->size);
+    array_extend(&buffer, capture_quantifiers->size, capture_quantifiers->contents);
+  }
+
+  serialization_write_varint(&buffer, self->steps.size);
+  for (unsigned i = 0; i < self->steps.size; i++) {
+    const QueryStep *step = &self->steps.contents[i];
+    serialization_write_varint(&buffer, step->symbol);
+    serialization_write_varint(&buffer, step->supertype_symbol);
+    serialization_write_varint(&buffer, step->field);
+    for (unsigned j = 0; j < MAX_STEP_CAPTURE_COUNT; j++) {
+      serialization_write_varint(&buffer, step->capture_ids[j]);
+    }
+    serialization_write_varint(&buffer, step->depth);
+    serialization_write_varint(&buffer, step->alternative_index);
+    serialization_write_varint(&buffer, step->negated_field_list_id);
+    serialization_write_varint(&buffer,
+      step->is_named << 0 |
+      step->is_immediate << 1 |
+      step->is_last_child << 2 |
+      step->is_pass_through << 3 |
+      step->is_dead_end << 4 |
+      step->alternative_is_immediate << 5 |
+      step->contains_captures << 6 |
+      step->root_pattern_guaranteed << 7 |
+      step->parent_pattern_guaranteed << 8
+    );
+  }
+
+  serialization_write_varint(&buffer, self->pattern_map.size);
+  for (unsigned i = 0; i < self->pattern_map.size; i++) {
+    const PatternEntry *entry = &self->pattern_map.contents[i];
+    serialization_write_varint(&buffer, entry->step_index);
+    serialization_write_varint(&buffer, entry->pattern_index);
+    serialization_write_varint(&buffer, entry->is_rooted);
+  }
+
+  serialization_write_varint(&buffer, self->predicate_steps.size);
+  for (unsigned i = 0; i < self->predicate_steps.size; i++) {
+    const TSQueryPredicateStep *step = &self->predicate_steps.contents[i];
+    serialization_write_varint(&buffer, step->type);
+    serialization_write_varint(&buffer, step->value_id);
+  }
+
+  serialization_write_varint(&buffer, self->patterns.size);
+  for (unsigned i = 0; i < self->patterns.size; i++) {
+    const QueryPattern *pattern = &self->patterns.contents[i];
+    serialization_write_varint(&buffer, pattern->steps.offset);
+    serialization_write_varint(&buffer, pattern->steps.length);
+    serialization_write_varint(&buffer, pattern->predicate_steps.offset);
+    serialization_write_varint(&buffer, pattern->predicate_steps.length);
+    serialization_write_varint(&buffer, pattern->start_byte);
+    serialization_write_varint(&buffer, pattern->is_non_local);
+  }
+
+  serialization_write_varint(&buffer, self->step_offsets.size);
+  for (unsigned i = 0; i < self->step_offsets.size; i++) {
+    serialization_write_varint(&buffer, self->step_offsets.contents[i].byte_offset);
+    serialization_write_varint(&buffer, self->step_offsets.contents[i].step_index);
+  }
+
+  serialization_write_varint(&buffer, self->negated_fields.size);
+  for (unsigned i = 0; i < self->negated_fields.size; i++) {
+    serialization_write_varint(&buffer, self->negated_fields.contents[i]);
+  }
+
+  serialization_write_varint(&buffer, self->repeat_symbols_with_rootless_patterns.size);
+  for (unsigned i = 0; i < self->repeat_symbols_with_rootless_patterns.size; i++) {
+    serialization_write_varint(&buffer, self->repeat_symbols_with_rootless_patterns.contents[i]);
+  }
+
+  serialization_write_varint(&buffer, self->wildcard_root_pattern_count);
+
+  uint32_t checksum = serialization_checksum(
+    &buffer.contents[TS_SERIALIZED_QUERY_HEADER_SIZE],
+    buffer.size - TS_SERIALIZED_QUERY_HEADER_SIZE
+  );
+  for (unsigned i = 0; i < 4; i++) {
+    buffer.contents[TS_SERIALIZED_QUERY_HEADER_SIZE - 4 + i] = (uint8_t)(checksum >> (i * 8));
+  }
+
+  *length = buffer.size;
+  return (char *)buffer.contents;
+}
+
+static inline TSSymbol ts_query__read_symbol(SerializationReader *reader, const TSLanguage *language) {
+  uint32_t symbol = serialization_read_bounded_varint(reader, UINT16_MAX);
+  if (!reader->failed && !ts_language_symbol_name(language, (TSSymbol)symbol)) {
+    reader->failed = true;
+  }
+  return (TSSymbol)symbol;
+}
+
+// Read an index into an array with the given size, or the `NONE` value.
+static inline uint16_t ts_query__read_optional_index(SerializationReader *reader, uint32_t size) {
+  uint32_t index = serialization_read_bounded_varint(reader, UINT16_MAX);
+  if (index != NONE && index >= size) reader->failed = true;
+  return (uint16_t)index;
+}
+
+TSQuery *ts_query_deserialize(const TSLanguage *language, const char *data, uint32_t length) {
+  if (
+    !language ||
+    language->version > TREE_SITTER_LANGUAGE_VERSION ||
+    language->version < TREE_SITTER_MIN_COMPATIBLE_LANGUAGE_VERSION
+  ) return NULL;
+
+  SerializationReader reader = {
+    .data = (const uint8_t *)data,
+    .end = (const uint8_t *)data + length,
+    .failed = false,
+  };
+  if (
+    serialization_read_uint32(&reader) != TS_SERIALIZED_QUERY_MAGIC ||
+    serialization_read_uint32(&reader) != TS_SERIALIZED_QUERY_VERSION ||
+    serialization_read_uint32(&reader) != ts_language_fingerprint(language) ||
+    serialization_read_uint32(&reader) != serialization_checksum(reader.data, reader.end - reader.data)
+  ) return NULL;
+
+  TSQuery *self = ts_malloc(sizeof(TSQuery));
+  *self = (TSQuery) {
+    .steps = array_new(),
+    .pattern_map = array_new(),
+    .pattern_map_offsets = array_new(),
+    .captures = symbol_table_new(),
+    .capture_quantifiers = array_new(),
+    .predicate_values = symbol_table_new(),
+    .predicate_steps = array_new(),
+    .patterns = array_new(),
+    .step_offsets = array_new(),
+    .string_buffer = array_new(),
+    .negated_fields = array_new(),
+    .repeat_symbols_with_rootless_patterns = array_new(),
+    .wildcard_root_pattern_count = 0,
+    .language = ts_language_copy(language),
+  };
+
+  symbol_table_deserialize(&self->captures, &reader);
+  symbol_table_deserialize(&self->predicate_values, &reader);
+  uint32_t capture_count = self->captures.slices.size;
+  uint32_t field_count = ts_language_field_count(language);
+
+  uint32_t pattern_count = serialization_read_count(&reader);
+  for (unsigned i = 0; i < pattern_count && !reader.failed; i++) {
+    CaptureQuantifiers capture_quantifiers = capture_quantifiers_new();
+    uint32_t quantifier_count = serialization_read_bounded_varint(&reader, capture_count);
+    const uint8_t *quantifiers = serialization_read_bytes(&reader, quantifier_count);
+    for (unsigned j = 0; quantifiers && j < quantifier_count; j++) {
+      if (quantifiers[j] > TSQuantifierOneOrMore) reader.failed = true;
+    }
+    if (quantifiers) array_extend(&capture_quantifiers, quantifier_count, quantifiers);
+    array_push(&self->capture_quantifiers, capture_quantifiers);
+  }
+
+  uint32_t step_count = serialization_read_count(&reader);
+  array_reserve(&self->steps, step_count);
+  for (unsigned i = 0; i < step_count && !reader.failed; i++) {
+    QueryStep step;
+    step.symbol = ts_query__read_symbol(&reader, language);
+    step.supertype_symbol = ts_query__read_symbol(&reader, language);
+    step.field = (TSFieldId)serialization_read_bounded_varint(&reader, field_count);
+    for (unsigned j = 0; j < MAX_STEP_CAPTURE_COUNT; j++) {
+      step.capture_ids[j] = ts_query__read_optional_index(&reader, capture_count);
+    }
+    step.depth = (uint16_t)serialization_read_bounded_varint(&reader, UINT16_MAX);
+    step.alternative_index = ts_query__read_optional_index(&reader, step_count);
+    step.negated_field_list_id = (uint16_t)serialization_read_bounded_varint(&reader, UINT16_MAX);
+    uint32_t flags = serialization_read_varint(&reader);
+    step.is_named = flags & (1 << 0);
+    step.is_immediate = flags & (1 << 1);
+    step.is_last_child = flags & (1 << 2);
+    step.is_pass_through = flags & (1 << 3);
+    step.is_dead_end = flags & (1 << 4);
+    step.alternative_is_immediate = flags & (1 << 5);
+    step.contains_captures = flags & (1 << 6);
+    step.root_pattern_guaranteed = flags & (1 << 7);
+    step.parent_pattern_guaranteed = flags & (1 << 8);
+    array_push(&self->steps, step);
+  }
+
+  // Query cursors rely on every pattern being terminated by a 'done' step.
+  if (
+    !reader.failed &&
+    (step_count > 0 ? self->steps.contents[step_count - 1].depth != PATTERN_DONE_MARKER : pattern_count > 0)
+  ) reader.failed = true;
+
+  uint32_t pattern_map_size = serialization_read_count(&reader);
+  for (unsigned i = 0; i < pattern_map_size && !reader.failed; i++) {
+    PatternEntry entry;
+    uint32_t step_index = serialization_read_varint(&reader);
+    uint32_t pattern_index = serialization_read_varint(&reader);
+    if (step_index >= step_count || pattern_index >= pattern_count) reader.failed = true;
+    entry.step_index = (uint16_t)step_index;
+    entry.pattern_index = (uint16_t)pattern_index;
+    entry.is_rooted = serialization_read_bounded_varint(&reader, 1);
+    array_push(&self->pattern_map, entry);
+  }
+
+  uint32_t string_count = self->predicate_values.slices.size;
+  uint32_t predicate_step_count = serialization_read_count(&reader);
+  for (unsigned i = 0; i < predicate_step_count && !reader.failed; i++) {
+    TSQueryPredicateStep step;
+    step.type = serialization_read_bounded_varint(&reader, TSQueryPredicateStepTypeString);
+    step.value_id = serialization_read_varint(&reader);
+    if (
+      (step.type == TSQueryPredicateStepTypeCapture && step.value_id >= capture_count) ||
+      (step.type == TSQueryPredicateStepTypeString && step.value_id >= string_count)
+    ) reader.failed = true;
+    array_push(&self->predicate_steps, step);
+  }
+
+  if (serialization_read_varint(&reader) != pattern_count) reader.failed = true;
+  for (unsigned i = 0; i < pattern_count && !reader.failed; i++) {
+    QueryPattern pattern;
+    pattern.steps.offset = serialization_read_bounded_varint(&reader, step_count);
+    pattern.steps.length = serialization_read_bounded_varint(&reader, step_count - pattern.steps.offset);
+    pattern.predicate_steps.offset = serialization_read_bounded_varint(&reader, predicate_step_count);
+    pattern.predicate_steps.length = serialization_read_bounded_varint(
+      &reader,
+      predicate_step_count - pattern.predicate_steps.offset
+    );
+    pattern.start_byte = serialization_read_varint(&reader);
+    pattern.is_non_local = serialization_read_bounded_varint(&reader, 1);
+    array_push(&self->patterns, pattern);
+  }
+
+  uint32_t step_offset_count = serialization_read_count(&reader);
+  for (unsigned i = 0; i < step_offset_count && !reader.failed; i++) {
+    StepOffset step_offset;
+    step_offset.byte_offset = serialization_read_varint(&reader);
+    step_offset.step_index = (uint16_t)serialization_read_bounded_varint(&reader, step_count);
+    array_push(&self->step_offsets, step_offset);
+  }
+
+  uint32_t negated_field_count = serialization_read_count(&reader);
+  for (unsigned i = 0; i < negated_field_count && !reader.failed; i++) {
+    TSFieldId field_id = (TSFieldId)serialization_read_bounded_varint(&reader, field_count);
+    array_push(&self->negated_fields, field_id);
+  }
+
+  // Each list of negated fields is terminated by a zero.
+  for (unsigned i = 0; i < self->steps.size; i++) {
+    uint16_t list_id = self->steps.contents[i].negated_field_list_id;
+    if (!list_id) continue;
+    if (list_id >= self->negated_fields.size) {
+      reader.failed = true;
+      break;
+    }
+    while (list_id < self->negated_fields.size && self->negated_fields.contents[list_id]) list_id++;
+    if (list_id == self->negated_fields.size) reader.failed = true;
+  }
+
+  uint32_t repeat_symbol_count = serialization_read_count(&reader);
+  for (unsigned i = 0; i < repeat_symbol_count && !reader.failed; i++) {
+    TSSymbol symbol = ts_query__read_symbol(&reader, language);
+    array_push(&self->repeat_symbols_with_rootless_patterns, symbol);
+  }
+
+  self->wildcard_root_pattern_count = (uint16_t)serialization_read_bounded_varint(
+    &reader,
+    self->pattern_map.size
+  );
+
+  if (reader.failed || reader.data != reader.end) {
+    ts_query_delete(self);
+    return NULL;
+  }
+
+  ts_query__build_pattern_map_offsets(self);
+  return self;
+}
+
 uint32_t ts_query_pattern_count(const TSQuery *self) {
   return self->patterns.size;
 }
@@ -2953,10 +3401,12 @@ void ts_query_disable_pattern(
   for (unsigned i = 0; i < self->pattern_map.size; i++) {
     PatternEntry *pattern = &self->pattern_map.contents[i];
     if (pattern->pattern_index == pattern_index) {
+      if (i < self->wildcard_root_pattern_count) self->wildcard_root_pattern_count--;
       array_erase(&self->pattern_map, i);
       i--;
     }
   }
+  ts_query__build_pattern_map_offsets(self);
 }
 
 /***************
@@ -2964,13 +3414,30 @@ void ts_query_disable_pattern(
  ***************/
 
 TSQueryCursor *ts_query_cursor_new(void) {
+  return ts_query_cursor_new_with_allocator((TSAllocator) {0});
+}
+
+TSQueryCursor *ts_query_cursor_new_with_allocator(TSAllocator allocator) {
+  const TSAllocator *previous_allocator = ts_allocator_push(&allocator);
   TSQueryCursor *self = ts_malloc(sizeof(TSQueryCursor));
   *self = (TSQueryCursor) {
+    .allocator = allocator,
     .did_exceed_match_limit = false,
     .ascending = false,
     .halted = false,
+    .pattern_stats_enabled = false,
+    .pattern_stats = array_new(),
+    .queries = array_new(),
+    .pattern_query_indices = array_new(),
+    .text_provider = {NULL, NULL},
+    .regex_engine = {NULL, NULL, NULL, NULL},
+    .regexes = array_new(),
+    .text_buffer = array_new(),
     .states = array_new(),
     .finished_states = array_new(),
+    .finished_heap_size = 0,
+    .next_finish_index = 0,
+    .in_progress_capture = {0},
     .capture_list_pool = capture_list_pool_new(),
     .start_byte = 0,
     .end_byte = UINT32_MAX,
@@ -2980,15 +3447,38 @@ TSQueryCursor *ts_query_cursor_new(void) {
   };
   array_reserve(&self->states, 8);
   array_reserve(&self->finished_states, 8);
+  ts_allocator_pop(previous_allocator);
   return self;
 }
 
+static void ts_query_cursor__clear_regexes(TSQueryCursor *self) {
+  for (unsigned i = 0; i < self->regexes.size; i++) {
+    CursorRegex *entry = &self->regexes.contents[i];
+    if (entry->regex) {
+      const TSAllocator *previous_allocator = ts_allocator_push(NULL);
+      self->regex_engine.destroy(self->regex_engine.payload, entry->regex);
+      ts_allocator_pop(previous_allocator);
+    }
+    ts_free(entry->pattern);
+  }
+  array_clear(&self->regexes);
+}
+
 void ts_query_cursor_delete(TSQueryCursor *self) {
+  TSAllocator allocator = self->allocator;
+  const TSAllocator *previous_allocator = ts_allocator_push(&allocator);
+  ts_query_cursor__clear_regexes(self);
+  array_delete(&self->regexes);
+  array_delete(&self->text_buffer);
+  array_delete(&self->queries);
+  array_delete(&self->pattern_query_indices);
+  array_delete(&self->pattern_stats);
   array_delete(&self->states);
   array_delete(&self->finished_states);
   ts_tree_cursor_delete(&self->cursor);
   capture_list_pool_delete(&self->capture_list_pool);
   ts_free(self);
+  ts_allocator_pop(previous_allocator);
 }
 
 bool ts_query_cursor_did_exceed_match_limit(const TSQueryCursor *self) {
@@ -3003,17 +3493,96 @@ void ts_query_cursor_set_match_limit(TSQueryCursor *self, uint32_t limit) {
   self->capture_list_pool.max_capture_list_count = limit;
 }
 
+void ts_query_cursor_set_pattern_stats_enabled(TSQueryCursor *self, bool enabled) {
+  self->pattern_stats_enabled = enabled;
+}
+
+bool ts_query_cursor_pattern_stats_enabled(const TSQueryCursor *self) {
+  return self->pattern_stats_enabled;
+}
+
+TSQueryPatternStats ts_query_cursor_pattern_stats(
+  const TSQueryCursor *self,
+  uint32_t pattern_index
+) {
+  if (pattern_index >= self->pattern_stats.size) return (TSQueryPatternStats) {0};
+  return self->pattern_stats.contents[pattern_index];
+}
+
+void ts_query_cursor_set_text_provider(TSQueryCursor *self, TSQueryTextProvider provider) {
+  self->text_provider = provider;
+}
+
+void ts_query_cursor_set_regex_engine(TSQueryCursor *self, TSQueryRegexEngine engine) {
+  const TSAllocator *previous_allocator = ts_allocator_push(&self->allocator);
+  ts_query_cursor__clear_regexes(self);
+  ts_allocator_pop(previous_allocator);
+  self->regex_engine = engine;
+}
+
 #ifdef DEBUG_EXECUTE_QUERY
 #define LOG(...) fprintf(stderr, __VA_ARGS__)
 #else
 #define LOG(...)
 #endif
 
+static inline uint32_t ts_query_cursor__query_count(const TSQueryCursor *self) {
+  return self->queries.size > 0 ? self->queries.size : 1;
+}
+
+static inline CursorQuery ts_query_cursor__query_at(const TSQueryCursor *self, uint32_t index) {
+  if (self->queries.size > 0) return self->queries.contents[index];
+  return (CursorQuery) {self->query, 0};
+}
+
+static inline uint32_t ts_query_cursor__query_index(const TSQueryCursor *self, uint16_t pattern_index) {
+  if (self->queries.size > 0) return self->pattern_query_indices.contents[pattern_index];
+  return 0;
+}
+
+// Get the query that a state's pattern belongs to.
+static inline const TSQuery *ts_query_cursor__state_query(
+  const TSQueryCursor *self,
+  const QueryState *state
+) {
+  if (self->queries.size > 0) {
+    uint16_t query_index = self->pattern_query_indices.contents[state->pattern_index];
+    return self->queries.contents[query_index].query;
+  }
+  return self->query;
+}
+
+static inline QueryStep *ts_query_cursor__state_step(
+  const TSQueryCursor *self,
+  const QueryState *state
+) {
+  return &ts_query_cursor__state_query(self, state)->steps.contents[state->step_index];
+}
+
+// Get the statistics for the given pattern, if they are being collected.
+static inline TSQueryPatternStats *ts_query_cursor__pattern_stats(
+  TSQueryCursor *self,
+  uint16_t pattern_index
+) {
+  if (pattern_index >= self->pattern_stats.size) return NULL;
+  return &self->pattern_stats.contents[pattern_index];
+}
+
+static void ts_query_cursor__reset_pattern_stats(TSQueryCursor *self) {
+  array_clear(&self->pattern_stats);
+  if (!self->pattern_stats_enabled) return;
+  uint32_t pattern_count = self->queries.size > 0
+    ? self->pattern_query_indices.size
+    : self->query ? self->query->patterns.size : 0;
+  array_grow_by(&self->pattern_stats, pattern_count);
+}
+
 void ts_query_cursor_exec(
   TSQueryCursor *self,
   const TSQuery *query,
   TSNode node
 ) {
+  const TSAllocator *previous_allocator = ts_allocator_push(&self->allocator);
   if  (query) {
     LOG("query steps:\n");
     for (unsigned i = 0; i < query->steps.size; i++) {
@@ -3042,6 +3611,9 @@ void ts_query_cursor_exec(
 
   array_clear(&self->states);
   array_clear(&self->finished_states);
+  self->finished_heap_size = 0;
+  self->next_finish_index = 0;
+  self->in_progress_capture.is_current = false;
   ts_tree_cursor_reset(&self->cursor, node);
   capture_list_pool_reset(&self->capture_list_pool);
   self->on_visible_node = true;
@@ -3051,6 +3623,48 @@ void ts_query_cursor_exec(
   self->halted = false;
   self->query = query;
   self->did_exceed_match_limit = false;
+  array_clear(&self->queries);
+  array_clear(&self->pattern_query_indices);
+  ts_query_cursor__reset_pattern_stats(self);
+  ts_allocator_pop(previous_allocator);
+}
+
+void ts_query_cursor_exec_queries(
+  TSQueryCursor *self,
+  const TSQuery *const *queries,
+  uint32_t query_count,
+  TSNode node
+) {
+  // The cursor's pattern indices and query indices are 16 bits wide.
+  uint64_t pattern_count = 0;
+  for (uint32_t i = 0; i < query_count && pattern_count <= UINT16_MAX; i++) {
+    pattern_count += queries[i]->patterns.size;
+  }
+  bool is_valid =
+    query_count > 0 &&
+    query_count <= UINT16_MAX &&
+    pattern_count <= UINT16_MAX;
+
+  ts_query_cursor_exec(self, is_valid ? queries[0] : NULL, node);
+  if (!is_valid) {
+    self->halted = true;
+    return;
+  }
+  if (query_count == 1) return;
+
+  const TSAllocator *previous_allocator = ts_allocator_push(&self->allocator);
+  for (uint32_t i = 0; i < query_count; i++) {
+    const TSQuery *query = queries[i];
+    array_push(&self->queries, ((CursorQuery) {
+      .query = query,
+      .pattern_offset = self->pattern_query_indices.size,
+    }));
+    for (uint32_t j = 0; j < query->patterns.size; j++) {
+      array_push(&self->pattern_query_indices, (uint16_t)i);
+    }
+  }
+  ts_query_cursor__reset_pattern_stats(self);
+  ts_allocator_pop(previous_allocator);
 }
 
 void ts_query_cursor_set_byte_range(
@@ -3063,6 +3677,7 @@ void ts_query_cursor_set_byte_range(
   }
   self->start_byte = start_byte;
   self->end_byte = end_byte;
+  self->in_progress_capture.is_current = false;
 }
 
 void ts_query_cursor_set_point_range(
@@ -3075,63 +3690,475 @@ void ts_query_cursor_set_point_range(
   }
   self->start_point = start_point;
   self->end_point = end_point;
+  self->in_progress_capture.is_current = false;
 }
 
-// Search through all of the in-progress states, and find the captured
-// node that occurs earliest in the document.
-static bool ts_query_cursor__first_in_progress_capture(
-  TSQueryCursor *self,
-  uint32_t *state_index,
-  uint32_t *byte_offset,
-  uint32_t *pattern_index,
-  bool *root_pattern_guaranteed
+// Find the next node in a capture list with the given capture id, starting
+// at the given index.
+static inline bool capture_list__next_node(
+  const CaptureList *self,
+  uint32_t capture_id,
+  uint32_t *index,
+  TSNode *node
 ) {
-  bool result = false;
-  *state_index = UINT32_MAX;
-  *byte_offset = UINT32_MAX;
-  *pattern_index = UINT32_MAX;
-  for (unsigned i = 0; i < self->states.size; i++) {
-    QueryState *state = &self->states.contents[i];
-    if (state->dead) continue;
-
-    const CaptureList *captures = capture_list_pool_get(
-      &self->capture_list_pool,
-      state->capture_list_id
-    );
-    if (state->consumed_capture_count >= captures->size) {
-      continue;
+  while (*index < self->size) {
+    const TSQueryCapture *capture = &self->contents[(*index)++];
+    if (capture->index == capture_id) {
+      *node = capture->node;
+      return true;
     }
+  }
+  return false;
+}
 
-    TSNode node = captures->contents[state->consumed_capture_count].node;
-    if (
-      ts_node_end_byte(node) <= self->start_byte ||
-      point_lte(ts_node_end_point(node), self->start_point)
-    ) {
-      state->consumed_capture_count++;
-      i--;
-      continue;
-    }
+static inline const char *ts_query_cursor__node_text(
+  TSQueryCursor *self,
+  TSNode node,
+  uint32_t *length
+) {
+  *length = 0;
+  const TSAllocator *previous_allocator = ts_allocator_push(NULL);
+  const char *text = self->text_provider.text(self->text_provider.payload, node, length);
+  ts_allocator_pop(previous_allocator);
+  if (!text) {
+    *length = 0;
+    return "";
+  }
+  return text;
+}
 
-    uint32_t node_start_byte = ts_node_start_byte(node);
-    if (
-      !result ||
-      node_start_byte < *byte_offset ||
-      (node_start_byte == *byte_offset && state->pattern_index < *pattern_index)
-    ) {
-      QueryStep *step = &self->query->steps.contents[state->step_index];
-      if (root_pattern_guaranteed) {
-        *root_pattern_guaranteed = step->root_pattern_guaranteed;
-      } else if (step->root_pattern_guaranteed) {
-        continue;
-      }
+static bool ts_query_cursor__node_text_eq(
+  TSQueryCursor *self,
+  TSNode node,
+  const char *string,
+  uint32_t length
+) {
+  uint32_t text_length;
+  const char *text = ts_query_cursor__node_text(self, node, &text_length);
+  return text_length == length && !memcmp(text, string, length);
+}
 
-      result = true;
-      *state_index = i;
-      *byte_offset = node_start_byte;
-      *pattern_index = state->pattern_index;
+// Get the compiled form of a regex, compiling it with the cursor's regex engine
+// the first time it is used. Returns `NULL` if the regex cannot be compiled.
+// Failures are cached too, so that the engine only sees each pattern once.
+static void *ts_query_cursor__regex(TSQueryCursor *self, const char *pattern, uint32_t length) {
+  for (unsigned i = 0; i < self->regexes.size; i++) {
+    CursorRegex *entry = &self->regexes.contents[i];
+    if (entry->length == length && !memcmp(entry->pattern, pattern, length)) {
+      return entry->regex;
     }
   }
-  return result;
+
+  const TSAllocator *previous_allocator = ts_allocator_push(NULL);
+  void *regex = self->regex_engine.compile(self->regex_engine.payload, pattern, length);
+  ts_allocator_pop(previous_allocator);
+
+  CursorRegex entry = {
+    .pattern = ts_malloc(length + 1),
+    .length = length,
+    .regex = regex,
+  };
+  memcpy(entry.pattern, pattern, length);
+  entry.pattern[length] = '\0';
+  array_push(&self->regexes, entry);
+  return entry.regex;
+}
+
+typedef enum {
+  TextPredicateEq,
+  TextPredicateMatch,
+  TextPredicateAnyOf,
+} TextPredicateKind;
+
+// Evaluate a single predicate against a state's captures. Predicates that are
+// not text predicates are treated as satisfied.
+static bool ts_query_cursor__satisfies_text_predicate(
+  TSQueryCursor *self,
+  const TSQuery *query,
+  const CaptureList *captures,
+  const TSQueryPredicateStep *steps,
+  uint32_t step_count
+) {
+  if (
+    step_count < 2 ||
+    steps[0].type != TSQueryPredicateStepTypeString ||
+    steps[1].type != TSQueryPredicateStepTypeCapture
+  ) return true;
+
+  uint32_t name_length;
+  const char *name = symbol_table_name_for_id(&query->predicate_values, steps[0].value_id, &name_length);
+
+  TextPredicateKind kind;
+  bool is_positive = true;
+  bool match_all_nodes = true;
+  if (name_length > 4 && !strncmp(name, "any-", 4) && strncmp(name, "any-of?", name_length)) {
+    match_all_nodes = false;
+    name += 4;
+    name_length -= 4;
+  }
+  if (name_length > 4 && !strncmp(name, "not-", 4)) {
+    is_positive = false;
+    name += 4;
+    name_length -= 4;
+  }
+  if (name_length == 3 && !strncmp(name, "eq?", 3)) {
+    kind = TextPredicateEq;
+  } else if (name_length == 6 && !strncmp(name, "match?", 6)) {
+    kind = TextPredicateMatch;
+  } else if (name_length == 7 && !strncmp(name, "any-of?", 7) && match_all_nodes) {
+    kind = TextPredicateAnyOf;
+  } else {
+    return true;
+  }
+
+  uint32_t capture_id = steps[1].value_id;
+  uint32_t index = 0;
+  TSNode node;
+  switch (kind) {
+    case TextPredicateEq: {
+      if (step_count != 3) return true;
+
+      if (steps[2].type == TSQueryPredicateStepTypeString) {
+        uint32_t length;
+        const char *string = symbol_table_name_for_id(&query->predicate_values, steps[2].value_id, &length);
+        while (capture_list__next_node(captures, capture_id, &index, &node)) {
+          bool is_equal = ts_query_cursor__node_text_eq(self, node, string, length);
+          if (is_equal != is_positive && match_all_nodes) return false;
+          if (is_equal == is_positive && !match_all_nodes) return true;
+        }
+        return true;
+      }
+
+      // When comparing two captures, compare their nodes pairwise. The text of
+      // the first node is copied, because the text provider's buffer is only
+      // valid until it is called again.
+      uint32_t other_capture_id = steps[2].value_id;
+      uint32_t other_index = 0;
+      TSNode other_node;
+      for (;;) {
+        bool has_node = capture_list__next_node(captures, capture_id, &index, &node);
+        bool has_other_node = capture_list__next_node(captures, other_capture_id, &other_index, &other_node);
+        if (!has_node || !has_other_node) break;
+
+        uint32_t length;
+        const char *text = ts_query_cursor__node_text(self, node, &length);
+        array_clear(&self->text_buffer);
+        array_extend(&self->text_buffer, length, text);
+        bool is_equal = ts_query_cursor__node_text_eq(
+          self,
+          other_node,
+          self->text_buffer.contents,
+          self->text_buffer.size
+        );
+        if (is_equal != is_positive && match_all_nodes) return false;
+        if (is_equal == is_positive && !match_all_nodes) return true;
+      }
+      return (
+        !capture_list__next_node(captures, capture_id, &index, &node) &&
+        !capture_list__next_node(captures, other_capture_id, &other_index, &other_node)
+      );
+    }
+
+    case TextPredicateMatch: {
+      if (step_count != 3 || steps[2].type != TSQueryPredicateStepTypeString) return true;
+      if (!self->regex_engine.compile) return true;
+
+      // A regex that the engine can't compile doesn't match anything, and
+      // doesn't fail to match anything either, so the predicate can't be
+      // satisfied, whichever variant it is.
+      uint32_t length;
+      const char *pattern = symbol_table_name_for_id(&query->predicate_values, steps[2].value_id, &length);
+      void *regex = ts_query_cursor__regex(self, pattern, length);
+      if (!regex) return false;
+      while (capture_list__next_node(captures, capture_id, &index, &node)) {
+        uint32_t text_length;
+        const char *text = ts_query_cursor__node_text(self, node, &text_length);
+        const TSAllocator *previous_allocator = ts_allocator_push(NULL);
+        bool is_match = self->regex_engine.is_match(self->regex_engine.payload, regex, text, text_length);
+        ts_allocator_pop(previous_allocator);
+        if (is_match != is_positive && match_all_nodes) return false;
+        if (is_match == is_positive && !match_all_nodes) return true;
+      }
+      return true;
+    }
+
+    case TextPredicateAnyOf: {
+      while (capture_list__next_node(captures, capture_id, &index, &node)) {
+        uint32_t text_length;
+        const char *text = ts_query_cursor__node_text(self, node, &text_length);
+        bool is_any = false;
+        for (uint32_t i = 2; i < step_count; i++) {
+          if (steps[i].type != TSQueryPredicateStepTypeString) return true;
+          uint32_t length;
+          const char *string = symbol_table_name_for_id(&query->predicate_values, steps[i].value_id, &length);
+          if (length == text_length && !memcmp(text, string, length)) {
+            is_any = true;
+            break;
+          }
+        }
+        if (is_any != is_positive) return false;
+      }
+      return true;
+    }
+  }
+
+  return true;
+}
+
+// Check whether a state's captures satisfy the text predicates of its pattern.
+// This always succeeds if the cursor has no text provider.
+static bool ts_query_cursor__satisfies_text_predicates(
+  TSQueryCursor *self,
+  const QueryState *state
+) {
+  if (!self->text_provider.text) return true;
+
+  uint32_t query_index = ts_query_cursor__query_index(self, state->pattern_index);
+  CursorQuery cursor_query = ts_query_cursor__query_at(self, query_index);
+  const TSQuery *query = cursor_query.query;
+  const QueryPattern *pattern = &query->patterns.contents[
+    state->pattern_index - cursor_query.pattern_offset
+  ];
+  if (pattern->predicate_steps.length == 0) return true;
+
+  const CaptureList *captures = capture_list_pool_get(
+    &self->capture_list_pool,
+    state->capture_list_id
+  );
+  const TSQueryPredicateStep *steps = &query->predicate_steps.contents[pattern->predicate_steps.offset];
+  uint32_t step_count = pattern->predicate_steps.length;
+  for (uint32_t start = 0, end = 0; start < step_count; start = end + 1) {
+    end = start;
+    while (end < step_count && steps[end].type != TSQueryPredicateStepTypeDone) end++;
+    if (!ts_query_cursor__satisfies_text_predicate(self, query, captures, &steps[start], end - start)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Move a state whose pattern has finished to the list of finished states,
+// unless its captures fail the pattern's text predicates, in which case the
+// state is discarded. Returns whether the state was kept.
+static bool ts_query_cursor__finish_state(TSQueryCursor *self, const QueryState *state) {
+  if (!ts_query_cursor__satisfies_text_predicates(self, state)) {
+    LOG("  discard pattern %u due to predicates\n", state->pattern_index);
+    capture_list_pool_release(&self->capture_list_pool, state->capture_list_id);
+    return false;
+  }
+  QueryState finished_state = *state;
+  finished_state.finish_index = self->next_finish_index++;
+  array_push(&self->finished_states, finished_state);
+  return true;
+}
+
+// Get the start byte of a finished state's next capture, or zero if all of its
+// captures have been consumed, so that exhausted states sort before all others.
+static inline uint32_t ts_query_cursor__next_capture_byte(
+  const TSQueryCursor *self,
+  const QueryState *state
+) {
+  const CaptureList *captures = capture_list_pool_get(
+    &self->capture_list_pool,
+    state->capture_list_id
+  );
+  if (state->consumed_capture_count >= captures->size) return 0;
+  return ts_node_start_byte(captures->contents[state->consumed_capture_count].node);
+}
+
+// Skip over any of a finished state's upcoming captures that are outside of
+// the cursor's range. Returns false if the state has no captures left.
+static bool ts_query_cursor__skip_captures_outside_of_range(
+  TSQueryCursor *self,
+  QueryState *state
+) {
+  const CaptureList *captures = capture_list_pool_get(
+    &self->capture_list_pool,
+    state->capture_list_id
+  );
+  while (state->consumed_capture_count < captures->size) {
+    TSNode node = captures->contents[state->consumed_capture_count].node;
+    bool node_precedes_range = (
+      ts_node_end_byte(node) <= self->start_byte ||
+      point_lte(ts_node_end_point(node), self->start_point)
+    );
+    bool node_follows_range = (
+      ts_node_start_byte(node) >= self->end_byte ||
+      point_gte(ts_node_start_point(node), self->end_point)
+    );
+    if (!node_precedes_range && !node_follows_range) return true;
+    state->consumed_capture_count++;
+  }
+  return false;
+}
+
+// Determine whether the next capture of one finished state should be returned
+// before that of another: by position, then by pattern, then by the order in
+// which the states finished.
+static inline bool ts_query_cursor__finished_state_precedes(
+  const TSQueryCursor *self,
+  const QueryState *left,
+  const QueryState *right
+) {
+  uint32_t left_byte = ts_query_cursor__next_capture_byte(self, left);
+  uint32_t right_byte = ts_query_cursor__next_capture_byte(self, right);
+  if (left_byte != right_byte) return left_byte < right_byte;
+  if (left->pattern_index != right->pattern_index) {
+    return left->pattern_index < right->pattern_index;
+  }
+  return left->finish_index < right->finish_index;
+}
+
+static void ts_query_cursor__sift_finished_state_up(TSQueryCursor *self, uint32_t index) {
+  QueryState *states = self->finished_states.contents;
+  while (index > 0) {
+    uint32_t parent = (index - 1) / 2;
+    if (!ts_query_cursor__finished_state_precedes(self, &states[index], &states[parent])) break;
+    QueryState state = states[index];
+    states[index] = states[parent];
+    states[parent] = state;
+    index = parent;
+  }
+}
+
+static void ts_query_cursor__sift_finished_state_down(TSQueryCursor *self, uint32_t index) {
+  QueryState *states = self->finished_states.contents;
+  for (;;) {
+    uint32_t first = index;
+    uint32_t left = 2 * index + 1;
+    uint32_t right = left + 1;
+    if (
+      left < self->finished_heap_size &&
+      ts_query_cursor__finished_state_precedes(self, &states[left], &states[first])
+    ) first = left;
+    if (
+      right < self->finished_heap_size &&
+      ts_query_cursor__finished_state_precedes(self, &states[right], &states[first])
+    ) first = right;
+    if (first == index) break;
+    QueryState state = states[index];
+    states[index] = states[first];
+    states[first] = state;
+    index = first;
+  }
+}
+
+// Add any states that have finished since the last capture was returned to
+// the heap of finished states. States whose remaining captures are all outside
+// of the cursor's range are discarded instead.
+static void ts_query_cursor__update_finished_heap(TSQueryCursor *self) {
+  while (self->finished_heap_size < self->finished_states.size) {
+    QueryState *state = &self->finished_states.contents[self->finished_heap_size];
+    if (ts_query_cursor__skip_captures_outside_of_range(self, state)) {
+      self->finished_heap_size++;
+      ts_query_cursor__sift_finished_state_up(self, self->finished_heap_size - 1);
+    } else {
+      capture_list_pool_release(&self->capture_list_pool, state->capture_list_id);
+      QueryState last_state = array_pop(&self->finished_states);
+      if (self->finished_heap_size < self->finished_states.size) {
+        self->finished_states.contents[self->finished_heap_size] = last_state;
+      }
+    }
+  }
+}
+
+// Remove a finished state and release its capture list, preserving the order
+// of the heap if the state is part of it.
+static void ts_query_cursor__remove_finished_state(TSQueryCursor *self, uint32_t index) {
+  capture_list_pool_release(
+    &self->capture_list_pool,
+    self->finished_states.contents[index].capture_list_id
+  );
+  if (index < self->finished_heap_size) {
+    uint32_t last_index = --self->finished_heap_size;
+    if (index < last_index) {
+      self->finished_states.contents[index] = self->finished_states.contents[last_index];
+    }
+    array_erase(&self->finished_states, last_index);
+    if (index < last_index) {
+      ts_query_cursor__sift_finished_state_down(self, index);
+      ts_query_cursor__sift_finished_state_up(self, index);
+    }
+  } else {
+    array_erase(&self->finished_states, index);
+  }
+}
+
+// Search through all of the in-progress states, and find the captured
+// node that occurs earliest in the document.
+static bool ts_query_cursor__first_in_progress_capture(
+  TSQueryCursor *self,
+  uint32_t *state_index,
+  uint32_t *byte_offset,
+  uint32_t *pattern_index,
+  bool *root_pattern_guaranteed
+) {
+  bool result = false;
+  *state_index = UINT32_MAX;
+  *byte_offset = UINT32_MAX;
+  *pattern_index = UINT32_MAX;
+  for (unsigned i = 0; i < self->states.size; i++) {
+    QueryState *state = &self->states.contents[i];
+    if (state->dead) continue;
+
+    const CaptureList *captures = capture_list_pool_get(
+      &self->capture_list_pool,
+      state->capture_list_id
+    );
+    if (state->consumed_capture_count >= captures->size) {
+      continue;
+    }
+
+    TSNode node = captures->contents[state->consumed_capture_count].node;
+    if (
+      ts_node_end_byte(node) <= self->start_byte ||
+      point_lte(ts_node_end_point(node), self->start_point)
+    ) {
+      state->consumed_capture_count++;
+      i--;
+      continue;
+    }
+
+    uint32_t node_start_byte = ts_node_start_byte(node);
+    if (
+      !result ||
+      node_start_byte < *byte_offset ||
+      (node_start_byte == *byte_offset && state->pattern_index < *pattern_index)
+    ) {
+      QueryStep *step = ts_query_cursor__state_step(self, state);
+      if (root_pattern_guaranteed) {
+        *root_pattern_guaranteed = step->root_pattern_guaranteed;
+      } else if (step->root_pattern_guaranteed) {
+        continue;
+      }
+
+      result = true;
+      *state_index = i;
+      *byte_offset = node_start_byte;
+      *pattern_index = state->pattern_index;
+    }
+  }
+  return result;
+}
+
+// Get the earliest capture among the in-progress states, reusing the result
+// of the last search if the states haven't changed since.
+static const InProgressCapture *ts_query_cursor__cached_in_progress_capture(
+  TSQueryCursor *self
+) {
+  InProgressCapture *capture = &self->in_progress_capture;
+  if (!capture->is_current) {
+    capture->is_definite = false;
+    ts_query_cursor__first_in_progress_capture(
+      self,
+      &capture->state_index,
+      &capture->byte_offset,
+      &capture->pattern_index,
+      &capture->is_definite
+    );
+    capture->is_current = true;
+  }
+  return capture;
 }
 
 // Determine which node is first in a depth-first traversal
@@ -3209,10 +4236,12 @@ void ts_query_cursor__compare_captures(
 
 static void ts_query_cursor__add_state(
   TSQueryCursor *self,
+  CursorQuery query,
   const PatternEntry *pattern
 ) {
-  QueryStep *step = &self->query->steps.contents[pattern->step_index];
+  QueryStep *step = &query.query->steps.contents[pattern->step_index];
   uint32_t start_depth = self->depth - step->depth;
+  uint16_t pattern_index = (uint16_t)(query.pattern_offset + pattern->pattern_index);
 
   // Keep the states array in ascending order of start_depth and pattern_index,
   // so that it can be processed more efficiently elsewhere. Usually, there is
@@ -3241,24 +4270,24 @@ static void ts_query_cursor__add_state(
       // Avoid inserting an unnecessary duplicate state, which would be
       // immediately pruned by the longest-match criteria.
       if (
-        prev_state->pattern_index == pattern->pattern_index &&
+        prev_state->pattern_index == pattern_index &&
         prev_state->step_index == pattern->step_index
       ) return;
-      if (prev_state->pattern_index <= pattern->pattern_index) break;
+      if (prev_state->pattern_index <= pattern_index) break;
     }
     index--;
   }
 
   LOG(
     "  start state. pattern:%u, step:%u\n",
-    pattern->pattern_index,
+    pattern_index,
     pattern->step_index
   );
   array_insert(&self->states, index, ((QueryState) {
     .id = UINT32_MAX,
     .capture_list_id = NONE,
     .step_index = pattern->step_index,
-    .pattern_index = pattern->pattern_index,
+    .pattern_index = pattern_index,
     .start_depth = start_depth,
     .consumed_capture_count = 0,
     .seeking_immediate_match = true,
@@ -3266,6 +4295,9 @@ static void ts_query_cursor__add_state(
     .needs_parent = step->depth == 1,
     .dead = false,
   }));
+
+  TSQueryPatternStats *stats = ts_query_cursor__pattern_stats(self, pattern_index);
+  if (stats) stats->started_state_count++;
 }
 
 // Acquire a capture list for this state. If there are no capture lists left in the
@@ -3278,6 +4310,8 @@ static CaptureList *ts_query_cursor__prepare_to_capture(
 ) {
   if (state->capture_list_id == NONE) {
     state->capture_list_id = capture_list_pool_acquire(&self->capture_list_pool);
+    TSQueryPatternStats *stats = ts_query_cursor__pattern_stats(self, state->pattern_index);
+    if (stats) stats->capture_list_count++;
 
     // If there are no capture lists left in the pool, then terminate whichever
     // state has captured the earliest node in the document, and steal its
@@ -3303,6 +4337,8 @@ static CaptureList *ts_query_cursor__prepare_to_capture(
         state->capture_list_id = other_state->capture_list_id;
         other_state->capture_list_id = NONE;
         other_state->dead = true;
+        TSQueryPatternStats *other_stats = ts_query_cursor__pattern_stats(self, other_state->pattern_index);
+        if (other_stats) other_stats->dropped_state_count++;
         CaptureList *list = capture_list_pool_get_mut(
           &self->capture_list_pool,
           state->capture_list_id
@@ -3311,6 +4347,10 @@ static CaptureList *ts_query_cursor__prepare_to_capture(
         return list;
       } else {
         LOG("  ran out of capture lists");
+        if (stats) {
+          stats->capture_list_count--;
+          stats->dropped_state_count++;
+        }
         return NULL;
       }
     }
@@ -3370,6 +4410,9 @@ static QueryState *ts_query_cursor__copy_state(
 
   array_insert(&self->states, state_index + 1, copy);
   *state_ref = &self->states.contents[state_index];
+
+  TSQueryPatternStats *stats = ts_query_cursor__pattern_stats(self, copy.pattern_index);
+  if (stats) stats->copied_state_count++;
   return &self->states.contents[state_index + 1];
 }
 
@@ -3386,7 +4429,7 @@ static inline bool ts_query_cursor__should_descend(
   // deeper in the tree, then descend.
   for (unsigned i = 0; i < self->states.size; i++) {
     QueryState *state = &self->states.contents[i];;
-    QueryStep *next_step = &self->query->steps.contents[state->step_index];
+    QueryStep *next_step = ts_query_cursor__state_step(self, state);
     if (
       next_step->depth != PATTERN_DONE_MARKER &&
       state->start_depth + next_step->depth > self->depth
@@ -3410,15 +4453,18 @@ static inline bool ts_query_cursor__should_descend(
     // of this type of repetition node.
     Subtree subtree = ts_tree_cursor_current_subtree(&self->cursor);
     if (ts_subtree_is_repetition(subtree)) {
-      bool exists;
-      uint32_t index;
-      array_search_sorted_by(
-        &self->query->repeat_symbols_with_rootless_patterns,,
-        ts_subtree_symbol(subtree),
-        &index,
-        &exists
-      );
-      return exists;
+      for (uint32_t i = 0, n = ts_query_cursor__query_count(self); i < n; i++) {
+        bool exists;
+        uint32_t index;
+        array_search_sorted_by(
+          &ts_query_cursor__query_at(self, i).query->repeat_symbols_with_rootless_patterns,,
+          ts_subtree_symbol(subtree),
+          &index,
+          &exists
+        );
+        if (exists) return true;
+      }
+      return false;
     }
 
     return true;
@@ -3436,6 +4482,7 @@ static inline bool ts_query_cursor__advance(
   bool stop_on_definite_step
 ) {
   bool did_match = false;
+  self->in_progress_capture.is_current = false;
   for (;;) {
     if (self->halted) {
       while (self->states.size > 0) {
@@ -3462,7 +4509,7 @@ static inline bool ts_query_cursor__advance(
         uint32_t deleted_count = 0;
         for (unsigned i = 0, n = self->states.size; i < n; i++) {
           QueryState *state = &self->states.contents[i];
-          QueryStep *step = &self->query->steps.contents[state->step_index];
+          QueryStep *step = ts_query_cursor__state_step(self, state);
 
           // If a state completed its pattern inside of this node, but was deferred from finishing
           // in order to search for longer matches, mark it as finished.
@@ -3471,8 +4518,7 @@ static inline bool ts_query_cursor__advance(
             (state->start_depth > self->depth || self->depth == 0)
           ) {
             LOG("  finish pattern %u\n", state->pattern_index);
-            array_push(&self->finished_states, *state);
-            did_match = true;
+            if (ts_query_cursor__finish_state(self, state)) did_match = true;
             deleted_count++;
           }
 
@@ -3583,37 +4629,43 @@ static inline bool ts_query_cursor__advance(
         bool parent_is_error =
           !ts_node_is_null(parent_node) &&
           ts_node_symbol(parent_node) == ts_builtin_sym_error;
-
-        // Add new states for any patterns whose root node is a wildcard.
-        if (!node_is_error) {
-          for (unsigned i = 0; i < self->query->wildcard_root_pattern_count; i++) {
-            PatternEntry *pattern = &self->query->pattern_map.contents[i];
-
-            // If this node matches the first step of the pattern, then add a new
-            // state at the start of this pattern.
-            QueryStep *step = &self->query->steps.contents[pattern->step_index];
-            uint32_t start_depth = self->depth - step->depth;
-            if (
-              (pattern->is_rooted ?
-                node_intersects_range :
-                (parent_intersects_range && !parent_is_error)) &&
-              (!step->field || field_id == step->field) &&
-              (!step->supertype_symbol || supertype_count > 0) &&
-              (start_depth <= self->max_start_depth)
-            ) {
-              ts_query_cursor__add_state(self, pattern);
+        uint32_t query_count = ts_query_cursor__query_count(self);
+
+        // Add new states for any patterns, in any of the queries, whose root
+        // node matches this node.
+        for (uint32_t query_index = 0; query_index < query_count; query_index++) {
+          CursorQuery query = ts_query_cursor__query_at(self, query_index);
+
+          // Add new states for any patterns whose root node is a wildcard.
+          if (!node_is_error) {
+            for (unsigned i = 0; i < query.query->wildcard_root_pattern_count; i++) {
+              PatternEntry *pattern = &query.query->pattern_map.contents[i];
+
+              // If this node matches the first step of the pattern, then add a new
+              // state at the start of this pattern.
+              QueryStep *step = &query.query->steps.contents[pattern->step_index];
+              uint32_t start_depth = self->depth - step->depth;
+              if (
+                (pattern->is_rooted ?
+                  node_intersects_range :
+                  (parent_intersects_range && !parent_is_error)) &&
+                (!step->field || field_id == step->field) &&
+                (!step->supertype_symbol || supertype_count > 0) &&
+                (start_depth <= self->max_start_depth)
+              ) {
+                ts_query_cursor__add_state(self, query, pattern);
+              }
             }
           }
-        }
 
-        // Add new states for any patterns whose root node matches this node.
-        unsigned i;
-        if (ts_query__pattern_map_search(self->query, symbol, &i)) {
-          PatternEntry *pattern = &self->query->pattern_map.contents[i];
+          // Add new states for any patterns whose root node matches this node.
+          uint32_t start, end;
+          ts_query__pattern_map_range(query.query, symbol, &start, &end);
+          for (uint32_t i = start; i < end; i++) {
+            PatternEntry *pattern = &query.query->pattern_map.contents[i];
+            QueryStep *step = &query.query->steps.contents[pattern->step_index];
+            uint32_t start_depth = self->depth - step->depth;
 
-          QueryStep *step = &self->query->steps.contents[pattern->step_index];
-          uint32_t start_depth = self->depth - step->depth;
-          do {
             // If this node matches the first step of the pattern, then add a new
             // state at the start of this pattern.
             if (
@@ -3623,21 +4675,16 @@ static inline bool ts_query_cursor__advance(
               (!step->field || field_id == step->field) &&
               (start_depth <= self->max_start_depth)
             ) {
-              ts_query_cursor__add_state(self, pattern);
+              ts_query_cursor__add_state(self, query, pattern);
             }
-
-            // Advance to the next pattern whose root node matches this node.
-            i++;
-            if (i == self->query->pattern_map.size) break;
-            pattern = &self->query->pattern_map.contents[i];
-            step = &self->query->steps.contents[pattern->step_index];
-          } while (step->symbol == symbol);
+          }
         }
 
         // Update all of the in-progress states with current node.
         for (unsigned j = 0, copy_count = 0; j < self->states.size; j += 1 + copy_count) {
           QueryState *state = &self->states.contents[j];
-          QueryStep *step = &self->query->steps.contents[state->step_index];
+          const TSQuery *query = ts_query_cursor__state_query(self, state);
+          QueryStep *step = &query->steps.contents[state->step_index];
           state->has_in_progress_alternatives = false;
           copy_count = 0;
 
@@ -3682,7 +4729,7 @@ static inline bool ts_query_cursor__advance(
           }
 
           if (step->negated_field_list_id) {
-            TSFieldId *negated_field_ids = &self->query->negated_fields.contents[step->negated_field_list_id];
+            TSFieldId *negated_field_ids = &query->negated_fields.contents[step->negated_field_list_id];
             for (;;) {
               TSFieldId negated_field_id = *negated_field_ids;
               if (negated_field_id) {
@@ -3722,7 +4769,7 @@ static inline bool ts_query_cursor__advance(
           // this node, to preserve the possibility of matching later siblings.
           if (later_sibling_can_match && (
             step->contains_captures ||
-            ts_query__step_is_fallible(self->query, state->step_index)
+            ts_query__step_is_fallible(query, state->step_index)
           )) {
             if (ts_query_cursor__copy_state(self, &state)) {
               LOG(
@@ -3784,7 +4831,7 @@ static inline bool ts_query_cursor__advance(
             state->step_index
           );
 
-          QueryStep *next_step = &self->query->steps.contents[state->step_index];
+          QueryStep *next_step = &query->steps.contents[state->step_index];
           if (stop_on_definite_step && next_step->root_pattern_guaranteed) did_match = true;
 
           // If this state's next step has an alternative step, then copy the state in order
@@ -3793,7 +4840,7 @@ static inline bool ts_query_cursor__advance(
           unsigned end_index = j + 1;
           for (unsigned k = j; k < end_index; k++) {
             QueryState *child_state = &self->states.contents[k];
-            QueryStep *child_step = &self->query->steps.contents[child_state->step_index];
+            QueryStep *child_step = &query->steps.contents[child_state->step_index];
             if (child_step->alternative_index != NONE) {
               // A "dead-end" step exists only to add a non-sequential jump into the step sequence,
               // via its alternative index. When a state reaches a dead-end step, it jumps straight
@@ -3906,15 +4953,14 @@ static inline bool ts_query_cursor__advance(
               state->step_index,
               capture_list_pool_get(&self->capture_list_pool, state->capture_list_id)->size
             );
-            QueryStep *next_step = &self->query->steps.contents[state->step_index];
+            QueryStep *next_step = ts_query_cursor__state_step(self, state);
             if (next_step->depth == PATTERN_DONE_MARKER) {
               if (state->has_in_progress_alternatives) {
                 LOG("  defer finishing pattern %u\n", state->pattern_index);
               } else {
                 LOG("  finish pattern %u\n", state->pattern_index);
-                array_push(&self->finished_states, *state);
+                if (ts_query_cursor__finish_state(self, state)) did_match = true;
                 array_erase(&self->states, (uint32_t)(state - self->states.contents));
-                did_match = true;
                 j--;
               }
             }
@@ -3941,9 +4987,35 @@ static inline bool ts_query_cursor__advance(
   }
 }
 
+// Fill in a match's id and pattern index from the given state, translating
+// the cursor's pattern numbering back to the pattern's own query.
+static void ts_query_cursor__set_match(
+  TSQueryCursor *self,
+  QueryState *state,
+  TSQueryMatch *match,
+  uint32_t *query_index
+) {
+  if (state->id == UINT32_MAX) state->id = self->next_state_id++;
+  uint32_t index = ts_query_cursor__query_index(self, state->pattern_index);
+  match->id = state->id;
+  match->pattern_index = (uint16_t)(
+    state->pattern_index - ts_query_cursor__query_at(self, index).pattern_offset
+  );
+  *query_index = index;
+}
+
 bool ts_query_cursor_next_match(
   TSQueryCursor *self,
   TSQueryMatch *match
+) {
+  uint32_t query_index;
+  return ts_query_cursor_next_query_match(self, match, &query_index);
+}
+
+static bool ts_query_cursor__next_query_match(
+  TSQueryCursor *self,
+  TSQueryMatch *match,
+  uint32_t *query_index
 ) {
   if (self->finished_states.size == 0) {
     if (!ts_query_cursor__advance(self, false)) {
@@ -3951,21 +5023,40 @@ bool ts_query_cursor_next_match(
     }
   }
 
-  QueryState *state = &self->finished_states.contents[0];
-  if (state->id == UINT32_MAX) state->id = self->next_state_id++;
-  match->id = state->id;
-  match->pattern_index = state->pattern_index;
+  // Matches are returned in the order in which they finished. If captures
+  // have been consumed from this cursor, the finished states are ordered by
+  // their next capture instead, so find the earliest one that finished.
+  uint32_t index = 0;
+  for (uint32_t i = 1; i < self->finished_heap_size; i++) {
+    if (
+      self->finished_states.contents[i].finish_index <
+      self->finished_states.contents[index].finish_index
+    ) index = i;
+  }
+
+  QueryState *state = &self->finished_states.contents[index];
+  ts_query_cursor__set_match(self, state, match, query_index);
   const CaptureList *captures = capture_list_pool_get(
     &self->capture_list_pool,
     state->capture_list_id
   );
   match->captures = captures->contents;
   match->capture_count = captures->size;
-  capture_list_pool_release(&self->capture_list_pool, state->capture_list_id);
-  array_erase(&self->finished_states, 0);
+  ts_query_cursor__remove_finished_state(self, index);
   return true;
 }
 
+bool ts_query_cursor_next_query_match(
+  TSQueryCursor *self,
+  TSQueryMatch *match,
+  uint32_t *query_index
+) {
+  const TSAllocator *previous_allocator = ts_allocator_push(&self->allocator);
+  bool result = ts_query_cursor__next_query_match(self, match, query_index);
+  ts_allocator_pop(previous_allocator);
+  return result;
+}
+
 void ts_query_cursor_remove_match(
   TSQueryCursor *self,
   uint32_t match_id
@@ -3973,11 +5064,7 @@ void ts_query_cursor_remove_match(
   for (unsigned i = 0; i < self->finished_states.size; i++) {
     const QueryState *state = &self->finished_states.contents[i];
     if (state->id == match_id) {
-      capture_list_pool_release(
-        &self->capture_list_pool,
-        state->capture_list_id
-      );
-      array_erase(&self->finished_states, i);
+      ts_query_cursor__remove_finished_state(self, i);
       return;
     }
   }
@@ -3992,6 +5079,7 @@ void ts_query_cursor_remove_match(
         state->capture_list_id
       );
       array_erase(&self->states, i);
+      self->in_progress_capture.is_current = false;
       return;
     }
   }
@@ -4001,77 +5089,47 @@ bool ts_query_cursor_next_capture(
   TSQueryCursor *self,
   TSQueryMatch *match,
   uint32_t *capture_index
+) {
+  uint32_t query_index;
+  return ts_query_cursor_next_query_capture(self, match, capture_index, &query_index);
+}
+
+static bool ts_query_cursor__next_query_capture(
+  TSQueryCursor *self,
+  TSQueryMatch *match,
+  uint32_t *capture_index,
+  uint32_t *query_index
 ) {
   // The goal here is to return captures in order, even though they may not
   // be discovered in order, because patterns can overlap. Search for matches
   // until there is a finished capture that is before any unfinished capture.
   for (;;) {
     // First, find the earliest capture in an unfinished match.
-    uint32_t first_unfinished_capture_byte;
-    uint32_t first_unfinished_pattern_index;
-    uint32_t first_unfinished_state_index;
-    bool first_unfinished_state_is_definite = false;
-    ts_query_cursor__first_in_progress_capture(
-      self,
-      &first_unfinished_state_index,
-      &first_unfinished_capture_byte,
-      &first_unfinished_pattern_index,
-      &first_unfinished_state_is_definite
-    );
-
-    // Then find the earliest capture in a finished match. It must occur
-    // before the first capture in an *unfinished* match.
+    const InProgressCapture *first_unfinished = ts_query_cursor__cached_in_progress_capture(self);
+
+    // Then find the earliest capture in a finished match, which is at the top
+    // of the heap once the states whose captures are all consumed have been
+    // removed. It must occur before the first capture in an *unfinished* match.
+    ts_query_cursor__update_finished_heap(self);
+    while (
+      self->finished_heap_size > 0 &&
+      !ts_query_cursor__skip_captures_outside_of_range(self, &self->finished_states.contents[0])
+    ) {
+      ts_query_cursor__remove_finished_state(self, 0);
+    }
     QueryState *first_finished_state = NULL;
-    uint32_t first_finished_capture_byte = first_unfinished_capture_byte;
-    uint32_t first_finished_pattern_index = first_unfinished_pattern_index;
-    for (unsigned i = 0; i < self->finished_states.size;) {
-      QueryState *state = &self->finished_states.contents[i];
-      const CaptureList *captures = capture_list_pool_get(
-        &self->capture_list_pool,
-        state->capture_list_id
-      );
-
-      // Remove states whose captures are all consumed.
-      if (state->consumed_capture_count >= captures->size) {
-        capture_list_pool_release(
-          &self->capture_list_pool,
-          state->capture_list_id
-        );
-        array_erase(&self->finished_states, i);
-        continue;
-      }
-
-      TSNode node = captures->contents[state->consumed_capture_count].node;
-
-      bool node_precedes_range = (
-        ts_node_end_byte(node) <= self->start_byte ||
-        point_lte(ts_node_end_point(node), self->start_point)
-      );
-      bool node_follows_range = (
-        ts_node_start_byte(node) >= self->end_byte ||
-        point_gte(ts_node_start_point(node), self->end_point)
-      );
-      bool node_outside_of_range = node_precedes_range || node_follows_range;
-
-      // Skip captures that are outside of the cursor's range.
-      if (node_outside_of_range) {
-        state->consumed_capture_count++;
-        continue;
-      }
-
-      uint32_t node_start_byte = ts_node_start_byte(node);
+    if (self->finished_heap_size > 0) {
+      QueryState *state = &self->finished_states.contents[0];
+      uint32_t node_start_byte = ts_query_cursor__next_capture_byte(self, state);
       if (
-        node_start_byte < first_finished_capture_byte ||
+        node_start_byte < first_unfinished->byte_offset ||
         (
-          node_start_byte == first_finished_capture_byte &&
-          state->pattern_index < first_finished_pattern_index
+          node_start_byte == first_unfinished->byte_offset &&
+          state->pattern_index < first_unfinished->pattern_index
         )
       ) {
         first_finished_state = state;
-        first_finished_capture_byte = node_start_byte;
-        first_finished_pattern_index = state->pattern_index;
       }
-      i++;
     }
 
     // If there is finished capture that is clearly before any unfinished
@@ -4080,16 +5138,24 @@ bool ts_query_cursor_next_capture(
     QueryState *state;
     if (first_finished_state) {
       state = first_finished_state;
-    } else if (first_unfinished_state_is_definite) {
-      state = &self->states.contents[first_unfinished_state_index];
+    } else if (first_unfinished->is_definite) {
+      state = &self->states.contents[first_unfinished->state_index];
+
+      // The captures of an unfinished match are returned before it finishes,
+      // so any predicates on the captures that it has so far must be checked
+      // now.
+      if (!ts_query_cursor__satisfies_text_predicates(self, state)) {
+        capture_list_pool_release(&self->capture_list_pool, state->capture_list_id);
+        array_erase(&self->states, first_unfinished->state_index);
+        self->in_progress_capture.is_current = false;
+        continue;
+      }
     } else {
       state = NULL;
     }
 
     if (state) {
-      if (state->id == UINT32_MAX) state->id = self->next_state_id++;
-      match->id = state->id;
-      match->pattern_index = state->pattern_index;
+      ts_query_cursor__set_match(self, state, match, query_index);
       const CaptureList *captures = capture_list_pool_get(
         &self->capture_list_pool,
         state->capture_list_id
@@ -4098,21 +5164,32 @@ bool ts_query_cursor_next_capture(
       match->capture_count = captures->size;
       *capture_index = state->consumed_capture_count;
       state->consumed_capture_count++;
+
+      // A finished state stays at the top of the heap until its next capture
+      // is known. If it has none left, it is removed on the next call.
+      if (state == first_finished_state) {
+        if (ts_query_cursor__skip_captures_outside_of_range(self, state)) {
+          ts_query_cursor__sift_finished_state_down(self, 0);
+        }
+      } else {
+        self->in_progress_capture.is_current = false;
+      }
       return true;
     }
 
     if (capture_list_pool_is_empty(&self->capture_list_pool)) {
       LOG(
         "  abandon state. index:%u, pattern:%u, offset:%u.\n",
-        first_unfinished_state_index,
-        first_unfinished_pattern_index,
-        first_unfinished_capture_byte
+        first_unfinished->state_index,
+        first_unfinished->pattern_index,
+        first_unfinished->byte_offset
       );
       capture_list_pool_release(
         &self->capture_list_pool,
-        self->states.contents[first_unfinished_state_index].capture_list_id
+        self->states.contents[first_unfinished->state_index].capture_list_id
       );
-      array_erase(&self->states, first_unfinished_state_index);
+      array_erase(&self->states, first_unfinished->state_index);
+      self->in_progress_capture.is_current = false;
     }
 
     // If there are no finished matches that are ready to be returned, then
@@ -4124,6 +5201,18 @@ bool ts_query_cursor_next_capture(
   }
 }
 
+bool ts_query_cursor_next_query_capture(
+  TSQueryCursor *self,
+  TSQueryMatch *match,
+  uint32_t *capture_index,
+  uint32_t *query_index
+) {
+  const TSAllocator *previous_allocator = ts_allocator_push(&self->allocator);
+  bool result = ts_query_cursor__next_query_capture(self, match, capture_index, query_index);
+  ts_allocator_pop(previous_allocator);
+  return result;
+}
+
 void ts_query_cursor_set_max_start_depth(
   TSQueryCursor *self,
   uint32_t max_start_depth
@@ -4131,4 +5220,405 @@ void ts_query_cursor_set_max_start_depth(
   self->max_start_depth = max_start_depth;
 }
 
+
+/************************
+ * QuerySession
+ ************************/
+
+/*
+ * SessionMatch - A match that a `TSQuerySession` has recorded. Its captures
+ * are stored contiguously in the session's `captures` array. The `start_byte`
+ * and `end_byte` span the node where the match's pattern starts, or for
+ * non-local patterns, that node's parent. A change outside of this extent
+ * cannot affect the match.
+ */
+typedef struct {
+  uint32_t start_byte;
+  uint32_t end_byte;
+  uint32_t capture_offset;
+  uint16_t capture_count;
+  uint16_t pattern_index;
+} SessionMatch;
+
+typedef struct {
+  uint32_t start_byte;
+  uint32_t end_byte;
+} ByteRange;
+
+typedef Array(ByteRange) ByteRangeArray;
+typedef Array(SessionMatch) SessionMatchArray;
+typedef Array(TSQuerySessionCapture) SessionCaptureArray;
+
+struct TSQuerySession {
+  const TSQuery *query;
+  SessionMatchArray matches;
+  SessionCaptureArray captures;
+  ByteRangeArray edited_ranges;
+  bool has_results;
+};
+
+TSQuerySession *ts_query_session_new(const TSQuery *query) {
+  TSQuerySession *self = ts_malloc(sizeof(TSQuerySession));
+  *self = (TSQuerySession) {
+    .query = query,
+    .matches = array_new(),
+    .captures = array_new(),
+    .edited_ranges = array_new(),
+    .has_results = false,
+  };
+  return self;
+}
+
+void ts_query_session_delete(TSQuerySession *self) {
+  array_delete(&self->matches);
+  array_delete(&self->captures);
+  array_delete(&self->edited_ranges);
+  ts_free(self);
+}
+
+uint32_t ts_query_session_match_count(const TSQuerySession *self) {
+  return self->matches.size;
+}
+
+TSQuerySessionMatch ts_query_session_match(const TSQuerySession *self, uint32_t index) {
+  const SessionMatch *match = array_get(&self->matches, index);
+  return (TSQuerySessionMatch) {
+    .pattern_index = match->pattern_index,
+    .capture_count = match->capture_count,
+    .captures = &self->captures.contents[match->capture_offset],
+  };
+}
+
+static inline void ts_query_session__edit_position(
+  uint32_t *byte,
+  TSPoint *point,
+  const TSInputEdit *edit
+) {
+  if (*byte >= edit->old_end_byte) {
+    *byte = edit->new_end_byte + (*byte - edit->old_end_byte);
+    if (point) *point = point_add(edit->new_end_point, point_sub(*point, edit->old_end_point));
+  } else if (*byte > edit->start_byte) {
+    *byte = edit->start_byte;
+    if (point) *point = edit->start_point;
+  }
+}
+
+void ts_query_session_edit(TSQuerySession *self, const TSInputEdit *edit) {
+  for (unsigned i = 0; i < self->captures.size; i++) {
+    TSRange *range = &self->captures.contents[i].range;
+    ts_query_session__edit_position(&range->start_byte, &range->start_point, edit);
+    ts_query_session__edit_position(&range->end_byte, &range->end_point, edit);
+  }
+  for (unsigned i = 0; i < self->matches.size; i++) {
+    SessionMatch *match = &self->matches.contents[i];
+    ts_query_session__edit_position(&match->start_byte, NULL, edit);
+    ts_query_session__edit_position(&match->end_byte, NULL, edit);
+  }
+  for (unsigned i = 0; i < self->edited_ranges.size; i++) {
+    ByteRange *range = &self->edited_ranges.contents[i];
+    ts_query_session__edit_position(&range->start_byte, NULL, edit);
+    ts_query_session__edit_position(&range->end_byte, NULL, edit);
+  }
+  if (self->has_results) {
+    array_push(&self->edited_ranges, ((ByteRange) {edit->start_byte, edit->new_end_byte}));
+  }
+}
+
+// Ranges are treated as closed intervals here, so that a change which only
+// touches the edge of a match still invalidates it.
+static inline bool byte_ranges__intersect(
+  const ByteRange *ranges,
+  uint32_t count,
+  uint32_t start_byte,
+  uint32_t end_byte
+) {
+  for (unsigned i = 0; i < count; i++) {
+    if (ranges[i].start_byte > end_byte) break;
+    if (ranges[i].end_byte >= start_byte) return true;
+  }
+  return false;
+}
+
+// Sort a list of byte ranges, and merge any ranges that overlap.
+static void byte_ranges__normalize(ByteRangeArray *ranges) {
+  for (unsigned i = 1; i < ranges->size; i++) {
+    ByteRange range = ranges->contents[i];
+    unsigned j = i;
+    while (j > 0 && ranges->contents[j - 1].start_byte > range.start_byte) {
+      ranges->contents[j] = ranges->contents[j - 1];
+      j--;
+    }
+    ranges->contents[j] = range;
+  }
+  unsigned size = 0;
+  for (unsigned i = 0; i < ranges->size; i++) {
+    ByteRange range = ranges->contents[i];
+    if (size > 0 && ranges->contents[size - 1].end_byte >= range.start_byte) {
+      ByteRange *previous = &ranges->contents[size - 1];
+      if (range.end_byte > previous->end_byte) previous->end_byte = range.end_byte;
+    } else {
+      ranges->contents[size++] = range;
+    }
+  }
+  ranges->size = size;
+}
+
+static inline uint32_t session_match__start_byte(
+  const SessionMatch *match,
+  const TSQuerySessionCapture *captures
+) {
+  uint32_t result = UINT32_MAX;
+  for (unsigned i = 0; i < match->capture_count; i++) {
+    uint32_t start_byte = captures[match->capture_offset + i].range.start_byte;
+    if (start_byte < result) result = start_byte;
+  }
+  return result;
+}
+
+// Order matches by the position of their earliest capture, then by pattern,
+// then by their captures. Matches that compare equal are duplicates.
+static int session_match__compare(
+  const SessionMatch *left,
+  const TSQuerySessionCapture *left_captures,
+  const SessionMatch *right,
+  const TSQuerySessionCapture *right_captures
+) {
+  uint32_t left_start = session_match__start_byte(left, left_captures);
+  uint32_t right_start = session_match__start_byte(right, right_captures);
+  if (left_start != right_start) return left_start < right_start ? -1 : 1;
+  if (left->pattern_index != right->pattern_index) {
+    return left->pattern_index < right->pattern_index ? -1 : 1;
+  }
+  if (left->capture_count != right->capture_count) {
+    return left->capture_count < right->capture_count ? -1 : 1;
+  }
+  for (unsigned i = 0; i < left->capture_count; i++) {
+    const TSQuerySessionCapture *a = &left_captures[left->capture_offset + i];
+    const TSQuerySessionCapture *b = &right_captures[right->capture_offset + i];
+    if (a->index != b->index) return a->index < b->index ? -1 : 1;
+    if (a->range.start_byte != b->range.start_byte) return a->range.start_byte < b->range.start_byte ? -1 : 1;
+    if (a->range.end_byte != b->range.end_byte) return a->range.end_byte < b->range.end_byte ? -1 : 1;
+  }
+  return 0;
+}
+
+// Find the node where a match's pattern starts, by walking up from its first
+// capture by the depth of that capture within the pattern. When a capture
+// appears at several depths, the deepest one is used, so that the result may
+// be an ancestor of the pattern's start, but never a descendant.
+static TSNode ts_query_session__match_root(
+  const TSQuerySession *self,
+  const TSQueryMatch *match
+) {
+  const TSQuery *query = self->query;
+  const QueryPattern *pattern = &query->patterns.contents[match->pattern_index];
+  uint32_t capture_id = match->captures[0].index;
+  uint16_t depth = 0;
+  for (uint32_t i = 0; i < pattern->steps.length; i++) {
+    const QueryStep *step = &query->steps.contents[pattern->steps.offset + i];
+    if (step->depth == PATTERN_DONE_MARKER) continue;
+    for (unsigned j = 0; j < MAX_STEP_CAPTURE_COUNT; j++) {
+      if (step->capture_ids[j] == NONE) break;
+      if (step->capture_ids[j] == capture_id && step->depth > depth) depth = step->depth;
+    }
+  }
+
+  // A non-local pattern matches a sequence of siblings, so a change anywhere
+  // in their parent can affect it.
+  if (pattern->is_non_local) depth++;
+
+  TSNode node = match->captures[0].node;
+  for (uint16_t i = 0; i < depth; i++) {
+    TSNode parent = ts_node_parent(node);
+    if (ts_node_is_null(parent)) break;
+    node = parent;
+  }
+  return node;
+}
+
+// Record a match found by the query cursor in the given arrays, unless it is
+// a duplicate of a match that is already there.
+static void ts_query_session__record_match(
+  SessionMatchArray *matches,
+  SessionCaptureArray *captures,
+  const TSQueryMatch *match,
+  TSNode root
+) {
+  SessionMatch entry = {
+    .start_byte = ts_node_start_byte(root),
+    .end_byte = ts_node_end_byte(root),
+    .capture_offset = captures->size,
+    .capture_count = match->capture_count,
+    .pattern_index = match->pattern_index,
+  };
+  for (unsigned i = 0; i < match->capture_count; i++) {
+    TSNode node = match->captures[i].node;
+    TSQuerySessionCapture capture = {
+      .range = {
+        .start_point = ts_node_start_point(node),
+        .end_point = ts_node_end_point(node),
+        .start_byte = ts_node_start_byte(node),
+        .end_byte = ts_node_end_byte(node),
+      },
+      .index = match->captures[i].index,
+    };
+    if (capture.range.start_byte < entry.start_byte) entry.start_byte = capture.range.start_byte;
+    if (capture.range.end_byte > entry.end_byte) entry.end_byte = capture.range.end_byte;
+    array_push(captures, capture);
+  }
+
+  // The cursor returns matches in roughly increasing order, so search for the
+  // insertion point from the end.
+  uint32_t index = matches->size;
+  while (index > 0) {
+    int comparison = session_match__compare(
+      &matches->contents[index - 1], captures->contents,
+      &entry, captures->contents
+    );
+    if (comparison == 0) {
+      captures->size = entry.capture_offset;
+      return;
+    }
+    if (comparison < 0) break;
+    index--;
+  }
+  array_insert(matches, index, entry);
+}
+
+uint32_t ts_query_session_update(
+  TSQuerySession *self,
+  TSQueryCursor *cursor,
+  TSNode node,
+  const TSRange *changed_ranges,
+  uint32_t changed_range_count
+) {
+  SessionMatchArray new_matches = array_new();
+  SessionCaptureArray new_captures = array_new();
+
+  // On the first update, run the query over the entire node.
+  if (!self->has_results) {
+    ts_query_cursor_set_byte_range(cursor, 0, UINT32_MAX);
+    ts_query_cursor_exec(cursor, self->query, node);
+    TSQueryMatch match;
+    while (ts_query_cursor_next_match(cursor, &match)) {
+      if (match.capture_count == 0) continue;
+      TSNode root = ts_query_session__match_root(self, &match);
+      ts_query_session__record_match(&new_matches, &new_captures, &match, root);
+    }
+    array_delete(&self->matches);
+    array_delete(&self->captures);
+    self->matches = new_matches;
+    self->captures = new_captures;
+    self->has_results = true;
+    return self->matches.size;
+  }
+
+  // Determine which parts of the document have changed: every range that was
+  // edited, along with every range whose syntactic structure has changed.
+  ByteRangeArray changed = array_new();
+  array_swap(&changed, &self->edited_ranges);
+  for (unsigned i = 0; i < changed_range_count; i++) {
+    array_push(&changed, ((ByteRange) {
+      changed_ranges[i].start_byte,
+      changed_ranges[i].end_byte,
+    }));
+  }
+  byte_ranges__normalize(&changed);
+
+  // Any previous match whose extent touches a changed range must be computed
+  // again. The query is re-run over those matches' extents, as well as the
+  // changed ranges themselves, in order to find their replacements.
+  ByteRangeArray search_ranges = array_new();
+  array_extend(&search_ranges, changed.size, changed.contents);
+  for (unsigned i = 0; i < self->matches.size; i++) {
+    const SessionMatch *match = &self->matches.contents[i];
+    if (byte_ranges__intersect(changed.contents, changed.size, match->start_byte, match->end_byte)) {
+      array_push(&search_ranges, ((ByteRange) {match->start_byte, match->end_byte}));
+    }
+  }
+  byte_ranges__normalize(&search_ranges);
+
+  uint32_t recomputed_count = 0;
+  for (unsigned i = 0; i < search_ranges.size; i++) {
+    ByteRange range = search_ranges.contents[i];
+    ts_query_cursor_set_byte_range(
+      cursor,
+      range.start_byte > 0 ? range.start_byte - 1 : 0,
+      range.end_byte < UINT32_MAX ? range.end_byte + 1 : UINT32_MAX
+    );
+    ts_query_cursor_exec(cursor, self->query, node);
+    TSQueryMatch match;
+    while (ts_query_cursor_next_match(cursor, &match)) {
+      if (match.capture_count == 0) continue;
+      TSNode root = ts_query_session__match_root(self, &match);
+      uint32_t start_byte = ts_node_start_byte(root);
+      uint32_t end_byte = ts_node_end_byte(root);
+      for (unsigned j = 0; j < match.capture_count; j++) {
+        TSNode capture_node = match.captures[j].node;
+        if (ts_node_start_byte(capture_node) < start_byte) start_byte = ts_node_start_byte(capture_node);
+        if (ts_node_end_byte(capture_node) > end_byte) end_byte = ts_node_end_byte(capture_node);
+      }
+
+      // Matches that don't touch any changed range are unaffected, and their
+      // previous versions are kept.
+      if (!byte_ranges__intersect(changed.contents, changed.size, start_byte, end_byte)) continue;
+      uint32_t previous_size = new_matches.size;
+      ts_query_session__record_match(&new_matches, &new_captures, &match, root);
+      if (new_matches.size > previous_size) recomputed_count++;
+    }
+  }
+  ts_query_cursor_set_byte_range(cursor, 0, UINT32_MAX);
+
+  // Merge the unaffected previous matches with the recomputed ones.
+  SessionMatchArray matches = array_new();
+  SessionCaptureArray captures = array_new();
+  array_reserve(&matches, self->matches.size + new_matches.size);
+  unsigned new_index = 0;
+  for (unsigned i = 0; i <= self->matches.size; i++) {
+    const SessionMatch *old_match = NULL;
+    if (i < self->matches.size) {
+      old_match = &self->matches.contents[i];
+      if (byte_ranges__intersect(changed.contents, changed.size, old_match->start_byte, old_match->end_byte)) {
+        continue;
+      }
+    }
+
+    bool is_duplicate = false;
+    while (new_index < new_matches.size) {
+      const SessionMatch *new_match = &new_matches.contents[new_index];
+      if (old_match) {
+        int comparison = session_match__compare(
+          new_match, new_captures.contents,
+          old_match, self->captures.contents
+        );
+        if (comparison > 0) break;
+        if (comparison == 0) is_duplicate = true;
+      }
+      SessionMatch entry = *new_match;
+      entry.capture_offset = captures.size;
+      array_extend(&captures, entry.capture_count, &new_captures.contents[new_match->capture_offset]);
+      array_push(&matches, entry);
+      new_index++;
+      if (is_duplicate) break;
+    }
+
+    if (old_match && !is_duplicate) {
+      SessionMatch entry = *old_match;
+      entry.capture_offset = captures.size;
+      array_extend(&captures, entry.capture_count, &self->captures.contents[old_match->capture_offset]);
+      array_push(&matches, entry);
+    }
+  }
+
+  array_delete(&self->matches);
+  array_delete(&self->captures);
+  self->matches = matches;
+  self->captures = captures;
+  array_delete(&new_matches);
+  array_delete(&new_captures);
+  array_delete(&changed);
+  array_delete(&search_ranges);
+  return recomputed_count;
+}
+
 #undef LOG
@@ -0,0 +1,117 @@
+#ifndef TREE_SITTER_SERIALIZATION_H_
+#define TREE_SITTER_SERIALIZATION_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "./array.h"
+
+// Helpers for reading and writing the library's binary serialization formats.
+//
+// Fixed-width integers are stored in little-endian byte order, and other
+// integers are stored as LEB128 varints. Nothing is read with alignment
+// requirements, so serialized data can be read directly out of a
+// memory-mapped file. A reader records a failure instead of reading past
+// the end of its data, and returns zero for all subsequent values.
+
+typedef Array(uint8_t) SerializationBuffer;
+
+typedef struct {
+  const uint8_t *data;
+  const uint8_t *end;
+  bool failed;
+} SerializationReader;
+
+static inline void serialization_write_uint32(SerializationBuffer *self, uint32_t value) {
+  uint8_t bytes[4] = {
+    (uint8_t)value,
+    (uint8_t)(value >> 8),
+    (uint8_t)(value >> 16),
+    (uint8_t)(value >> 24),
+  };
+  array_extend(self, 4, bytes);
+}
+
+static inline void serialization_write_varint(SerializationBuffer *self, uint32_t value) {
+  while (value >= 0x80) {
+    array_push(self, (uint8_t)(value | 0x80));
+    value >>= 7;
+  }
+  array_push(self, (uint8_t)value);
+}
+
+static inline void serialization_write_signed_varint(SerializationBuffer *self, int32_t value) {
+  serialization_write_varint(self, ((uint32_t)value << 1) ^ (uint32_t)(value >> 31));
+}
+
+static inline uint32_t serialization_read_uint32(SerializationReader *self) {
+  if (self->end - self->data < 4) {
+    self->failed = true;
+    return 0;
+  }
+  const uint8_t *bytes = self->data;
+  self->data += 4;
+  return
+    (uint32_t)bytes[0] |
+    (uint32_t)bytes[1] << 8 |
+    (uint32_t)bytes[2] << 16 |
+    (uint32_t)bytes[3] << 24;
+}
+
+static inline uint32_t serialization_read_varint(SerializationReader *self) {
+  uint32_t result = 0;
+  for (unsigned shift = 0; shift < 32 && self->data < self->end; shift += 7) {
+    uint8_t byte = *self->data++;
+    result |= (uint32_t)(byte & 0x7f) << shift;
+    if (!(byte & 0x80)) return result;
+  }
+  self->failed = true;
+  return 0;
+}
+
+static inline int32_t serialization_read_signed_varint(SerializationReader *self) {
+  uint32_t value = serialization_read_varint(self);
+  return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+
+static inline uint32_t serialization_read_bounded_varint(SerializationReader *self, uint32_t max) {
+  uint32_t value = serialization_read_varint(self);
+  if (value > max) self->failed = true;
+  return value;
+}
+
+// Compute a 32-bit FNV-1a hash of the given bytes, which is used to detect
+// data that has been corrupted.
+static inline uint32_t serialization_checksum(const uint8_t *data, size_t length) {
+  uint32_t hash = 2166136261u;
+  for (size_t i = 0; i < length; i++) {
+    hash = (hash ^ data[i]) * 16777619u;
+  }
+  return hash;
+}
+
+// Read the size of an array whose elements each take at least one byte, so
+// that the size can be checked against the amount of remaining data before
+// anything is allocated.
+static inline uint32_t serialization_read_count(SerializationReader *self) {
+  return serialization_read_bounded_varint(self, (uint32_t)(self->end - self->data));
+}
+
+static inline const uint8_t *serialization_read_bytes(SerializationReader *self, uint32_t length) {
+  if ((size_t)(self->end - self->data) < length) {
+    self->failed = true;
+    return NULL;
+  }
+  const uint8_t *result = self->data;
+  self->data += length;
+  return result;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // TREE_SITTER_SERIALIZATION_H_
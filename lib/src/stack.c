@@ -456,6 +456,30 @@ void ts_stack_delete(Stack *self) {
   ts_free(self);
 }
 
+size_t ts_stack_retained_size(const Stack *self) {
+  return
+    self->heads.capacity * sizeof(StackHead) +
+    self->slices.capacity * sizeof(StackSlice) +
+    self->iterators.capacity * sizeof(StackIterator) +
+    self->node_pool.capacity * sizeof(StackNode *) +
+    self->node_pool.size * sizeof(StackNode);
+}
+
+void ts_stack_shrink(Stack *self) {
+  for (uint32_t i = 0; i < self->node_pool.size; i++) {
+    ts_free(self->node_pool.contents[i]);
+  }
+  array_clear(&self->node_pool);
+  if (self->slices.capacity > 4) {
+    array_delete(&self->slices);
+    array_reserve(&self->slices, 4);
+  }
+  if (self->iterators.capacity > 4) {
+    array_delete(&self->iterators);
+    array_reserve(&self->iterators, 4);
+  }
+}
+
 uint32_t ts_stack_version_count(const Stack *self) {
   return self->heads.size;
 }
@@ -472,6 +496,37 @@ Subtree ts_stack_last_external_token(const Stack *self, StackVersion version) {
   return array_get(&self->heads, version)->last_external_token;
 }
 
+static StackNode *ts_stack__bottom_node(const Stack *self, StackVersion version, uint32_t max_depth) {
+  StackNode *node = array_get(&self->heads, version)->node;
+  for (uint32_t depth = 0; depth < max_depth; depth++) {
+    if (node->link_count != 1 || node->links[0].is_pending) return NULL;
+    if (node->links[0].node == self->base_node) return node;
+    node = node->links[0].node;
+  }
+  return NULL;
+}
+
+bool ts_stack_bottom_subtree(
+  const Stack *self,
+  StackVersion version,
+  uint32_t max_depth,
+  Subtree *subtree,
+  TSStateId *state
+) {
+  StackNode *node = ts_stack__bottom_node(self, version, max_depth);
+  if (!node) return false;
+  *subtree = node->links[0].subtree;
+  *state = node->state;
+  return true;
+}
+
+void ts_stack_replace_bottom_subtree(Stack *self, StackVersion version, Subtree subtree) {
+  StackNode *node = ts_stack__bottom_node(self, version, UINT32_MAX);
+  assert(node);
+  ts_subtree_release(self->subtree_pool, node->links[0].subtree);
+  node->links[0].subtree = subtree;
+}
+
 void ts_stack_set_last_external_token(Stack *self, StackVersion version, Subtree token) {
   StackHead *head = array_get(&self->heads, version);
   if (token.ptr) ts_subtree_retain(token);
@@ -34,6 +34,13 @@ Stack *ts_stack_new(SubtreePool *);
 // Release the memory reserved for a given stack.
 void ts_stack_delete(Stack *);
 
+// Get the number of bytes that the stack keeps allocated between parses.
+size_t ts_stack_retained_size(const Stack *);
+
+// Release the memory that the stack keeps allocated between parses. The stack
+// must have been cleared.
+void ts_stack_shrink(Stack *);
+
 // Get the stack's current number of versions.
 uint32_t ts_stack_version_count(const Stack *);
 
@@ -50,6 +57,16 @@ void ts_stack_set_last_external_token(Stack *, StackVersion, Subtree );
 // Get the position of the given version of the stack within the document.
 Length ts_stack_position(const Stack *, StackVersion);
 
+// Get the subtree at the bottom of the given version of the stack, and the
+// state that follows it. This fails if the version has more than `max_depth`
+// entries, or if its entries have been merged from several paths.
+bool ts_stack_bottom_subtree(const Stack *, StackVersion, uint32_t max_depth, Subtree *, TSStateId *);
+
+// Replace the subtree at the bottom of the given version of the stack, which
+// must have been found by `ts_stack_bottom_subtree`, with another subtree of
+// the same total length. This transfers ownership of the new tree.
+void ts_stack_replace_bottom_subtree(Stack *, StackVersion, Subtree);
+
 // Push a tree and state onto the given version of the stack.
 //
 // This transfers ownership of the tree to the Stack. Callers that
@@ -19,33 +19,169 @@ typedef struct {
   Length new_end;
 } Edit;
 
+// An edit that has been applied to a node, along with the number of rows in
+// the node's padding immediately after that edit.
+typedef struct {
+  Edit edit;
+  uint32_t padding_rows;
+} NodeEdit;
+
+// A node whose children still need to be edited, along with the range of
+// edits within a shared buffer that have been applied to it.
+typedef struct {
+  Subtree *tree;
+  uint32_t edit_index;
+  uint32_t edit_count;
+} EditEntry;
+
+typedef struct {
+  uint32_t child_index;
+  uint32_t order;
+  NodeEdit node_edit;
+} ChildEdit;
+
 #define TS_MAX_INLINE_TREE_LENGTH UINT8_MAX
 #define TS_MAX_TREE_POOL_SIZE 32
+#define TS_SUBTREE_ARENA_CHUNK_SIZE (64 * 1024)
+#define TS_SUBTREE_ARENA_ALIGNMENT 8
+
+// SubtreeArena
+
+SubtreeArena *ts_subtree_arena_new(void) {
+  SubtreeArena *self = ts_malloc(sizeof(SubtreeArena));
+  array_init(&self->chunks);
+  self->next = NULL;
+  self->remaining = 0;
+  self->ref_count = 1;
+  self->has_foreign_references = false;
+  return self;
+}
+
+void ts_subtree_arena_retain(SubtreeArena *self) {
+  assert(self->ref_count > 0);
+  atomic_inc(&self->ref_count);
+}
+
+void ts_subtree_arena_release(SubtreeArena *self) {
+  assert(self->ref_count > 0);
+  if (atomic_dec(&self->ref_count) == 0) {
+    for (uint32_t i = 0; i < self->chunks.size; i++) {
+      ts_free(self->chunks.contents[i]);
+    }
+    array_delete(&self->chunks);
+    ts_free(self);
+  }
+}
+
+static void *ts_subtree_arena_allocate(SubtreeArena *self, size_t size) {
+  size = (size + TS_SUBTREE_ARENA_ALIGNMENT - 1) & ~(size_t)(TS_SUBTREE_ARENA_ALIGNMENT - 1);
+
+  // Oversized allocations get a dedicated chunk, so that the remainder of
+  // the current chunk is not wasted.
+  if (size > TS_SUBTREE_ARENA_CHUNK_SIZE / 4) {
+    char *chunk = ts_malloc(size);
+    array_push(&self->chunks, chunk);
+    return chunk;
+  }
+
+  if (size > self->remaining) {
+    char *chunk = ts_malloc(TS_SUBTREE_ARENA_CHUNK_SIZE);
+    array_push(&self->chunks, chunk);
+    self->next = chunk;
+    self->remaining = TS_SUBTREE_ARENA_CHUNK_SIZE;
+  }
+
+  void *result = self->next;
+  self->next += size;
+  self->remaining -= size;
+  return result;
+}
+
+void ts_subtree_arena_array_add(SubtreeArenaArray *self, SubtreeArena *arena) {
+  for (uint32_t i = 0; i < self->size; i++) {
+    if (self->contents[i] == arena) return;
+  }
+  ts_subtree_arena_retain(arena);
+  array_push(self, arena);
+}
+
+void ts_subtree_arena_array_delete(SubtreeArenaArray *self) {
+  for (uint32_t i = 0; i < self->size; i++) {
+    ts_subtree_arena_release(self->contents[i]);
+  }
+  array_delete(self);
+}
 
 // ExternalScannerState
 
-void ts_external_scanner_state_init(ExternalScannerState *self, const char *data, unsigned length) {
+// The header of a long external scanner state that is allocated on the heap.
+typedef struct {
+  volatile uint32_t ref_count;
+  char data[];
+} ExternalScannerStateBuffer;
+
+static inline ExternalScannerStateBuffer *ts_external_scanner_state__buffer(char *data) {
+  return (ExternalScannerStateBuffer *)(data - offsetof(ExternalScannerStateBuffer, data));
+}
+
+static char *ts_external_scanner_state__allocate(SubtreeArena *arena, unsigned length) {
+  if (arena) return ts_subtree_arena_allocate(arena, length);
+  ExternalScannerStateBuffer *buffer = ts_malloc(sizeof(ExternalScannerStateBuffer) + length);
+  buffer->ref_count = 1;
+  return buffer->data;
+}
+
+void ts_external_scanner_state_init(
+  ExternalScannerState *self,
+  SubtreeArena *arena,
+  const char *data,
+  unsigned length
+) {
   self->length = length;
   if (length > sizeof(self->short_data)) {
-    self->long_data = ts_malloc(length);
+    self->long_data = ts_external_scanner_state__allocate(arena, length);
     memcpy(self->long_data, data, length);
   } else {
     memcpy(self->short_data, data, length);
   }
 }
 
-ExternalScannerState ts_external_scanner_state_copy(const ExternalScannerState *self) {
+// Copy the state of a subtree into a subtree whose memory is managed by the
+// given arena, or that is individually allocated if there is no arena. A long
+// state is only copied if it is managed differently than the new subtree.
+static ExternalScannerState ts_external_scanner_state_copy(
+  const ExternalScannerState *self,
+  bool self_in_arena,
+  SubtreeArena *arena
+) {
   ExternalScannerState result = *self;
   if (self->length > sizeof(self->short_data)) {
-    result.long_data = ts_malloc(self->length);
-    memcpy(result.long_data, self->long_data, self->length);
+    if (!arena && !self_in_arena) {
+      atomic_inc(&ts_external_scanner_state__buffer(self->long_data)->ref_count);
+    } else if (!arena || !self_in_arena) {
+      result.long_data = ts_external_scanner_state__allocate(arena, self->length);
+      memcpy(result.long_data, self->long_data, self->length);
+    }
   }
   return result;
 }
 
+void ts_external_scanner_state_init_shared(
+  ExternalScannerState *self,
+  SubtreeArena *arena,
+  Subtree source
+) {
+  *self = ts_external_scanner_state_copy(
+    ts_subtree_external_scanner_state(source),
+    source.ptr && !source.data.is_inline && source.ptr->in_arena,
+    arena
+  );
+}
+
 void ts_external_scanner_state_delete(ExternalScannerState *self) {
   if (self->length > sizeof(self->short_data)) {
-    ts_free(self->long_data);
+    ExternalScannerStateBuffer *buffer = ts_external_scanner_state__buffer(self->long_data);
+    if (atomic_dec(&buffer->ref_count) == 0) ts_free(buffer);
   }
 }
 
@@ -58,9 +194,9 @@ const char *ts_external_scanner_state_data(const ExternalScannerState *self) {
 }
 
 bool ts_external_scanner_state_eq(const ExternalScannerState *self, const char *buffer, unsigned length) {
-  return
-    self->length == length &&
-    memcmp(ts_external_scanner_state_data(self), buffer, length) == 0;
+  if (self->length != length) return false;
+  const char *data = ts_external_scanner_state_data(self);
+  return data == buffer || memcmp(data, buffer, length) == 0;
 }
 
 // SubtreeArray
@@ -119,7 +255,7 @@ void ts_subtree_array_reverse(SubtreeArray *self) {
 // SubtreePool
 
 SubtreePool ts_subtree_pool_new(uint32_t capacity) {
-  SubtreePool self = {array_new(), array_new()};
+  SubtreePool self = {array_new(), array_new(), NULL};
   array_reserve(&self.free_trees, capacity);
   return self;
 }
@@ -135,7 +271,9 @@ void ts_subtree_pool_delete(SubtreePool *self) {
 }
 
 static SubtreeHeapData *ts_subtree_pool_allocate(SubtreePool *self) {
-  if (self->free_trees.size > 0) {
+  if (self->arena) {
+    return ts_subtree_arena_allocate(self->arena, sizeof(SubtreeHeapData));
+  } else if (self->free_trees.size > 0) {
     return array_pop(&self->free_trees).ptr;
   } else {
     return ts_malloc(sizeof(SubtreeHeapData));
@@ -162,6 +300,41 @@ static inline bool ts_subtree_can_inline(Length padding, Length size, uint32_t l
     lookahead_bytes < 16;
 }
 
+static Subtree ts_subtree__new_heap_leaf(
+  SubtreePool *pool, TSSymbol symbol, Length padding, Length size,
+  uint32_t lookahead_bytes, TSStateId parse_state,
+  bool has_external_tokens, bool depends_on_column,
+  bool is_keyword, const TSLanguage *language
+) {
+  TSSymbolMetadata metadata = ts_language_symbol_metadata(language, symbol);
+  bool extra = symbol == ts_builtin_sym_end;
+  SubtreeHeapData *data = ts_subtree_pool_allocate(pool);
+  *data = (SubtreeHeapData) {
+    .ref_count = 1,
+    .padding = padding,
+    .size = size,
+    .lookahead_bytes = lookahead_bytes,
+    .error_cost = 0,
+    .child_count = 0,
+    .symbol = symbol,
+    .parse_state = parse_state,
+    .visible = metadata.visible,
+    .named = metadata.named,
+    .extra = extra,
+    .fragile_left = false,
+    .fragile_right = false,
+    .has_changes = false,
+    .has_external_tokens = has_external_tokens,
+    .has_external_scanner_state_change = false,
+    .depends_on_column = depends_on_column,
+    .is_missing = false,
+    .is_keyword = is_keyword,
+    .in_arena = pool->arena != NULL,
+    {{.first_leaf = {.symbol = 0, .parse_state = 0}}}
+  };
+  return (Subtree) {.ptr = data};
+}
+
 Subtree ts_subtree_new_leaf(
   SubtreePool *pool, TSSymbol symbol, Length padding, Length size,
   uint32_t lookahead_bytes, TSStateId parse_state,
@@ -195,30 +368,10 @@ Subtree ts_subtree_new_leaf(
       .is_inline = true,
     }};
   } else {
-    SubtreeHeapData *data = ts_subtree_pool_allocate(pool);
-    *data = (SubtreeHeapData) {
-      .ref_count = 1,
-      .padding = padding,
-      .size = size,
-      .lookahead_bytes = lookahead_bytes,
-      .error_cost = 0,
-      .child_count = 0,
-      .symbol = symbol,
-      .parse_state = parse_state,
-      .visible = metadata.visible,
-      .named = metadata.named,
-      .extra = extra,
-      .fragile_left = false,
-      .fragile_right = false,
-      .has_changes = false,
-      .has_external_tokens = has_external_tokens,
-      .has_external_scanner_state_change = false,
-      .depends_on_column = depends_on_column,
-      .is_missing = false,
-      .is_keyword = is_keyword,
-      {{.first_leaf = {.symbol = 0, .parse_state = 0}}}
-    };
-    return (Subtree) {.ptr = data};
+    return ts_subtree__new_heap_leaf(
+      pool, symbol, padding, size, lookahead_bytes, parse_state,
+      has_external_tokens, depends_on_column, is_keyword, language
+    );
   }
 }
 
@@ -255,23 +408,35 @@ Subtree ts_subtree_new_error(
   return result;
 }
 
-// Clone a subtree.
-MutableSubtree ts_subtree_clone(Subtree self) {
+// Record that an arena subtree is taking a reference to the given child.
+static inline void ts_subtree_arena_note_child(SubtreeArena *arena, Subtree child) {
+  if (!child.data.is_inline && !child.ptr->in_arena) {
+    arena->has_foreign_references = true;
+  }
+}
+
+// Clone a subtree, allocating the copy in the pool's arena if it has one.
+static MutableSubtree ts_subtree_clone(SubtreePool *pool, Subtree self) {
+  SubtreeArena *arena = pool->arena;
   size_t alloc_size = ts_subtree_alloc_size(self.ptr->child_count);
-  Subtree *new_children = ts_malloc(alloc_size);
+  Subtree *new_children = arena ? ts_subtree_arena_allocate(arena, alloc_size) : ts_malloc(alloc_size);
   Subtree *old_children = ts_subtree_children(self);
   memcpy(new_children, old_children, alloc_size);
   SubtreeHeapData *result = (SubtreeHeapData *)&new_children[self.ptr->child_count];
   if (self.ptr->child_count > 0) {
     for (uint32_t i = 0; i < self.ptr->child_count; i++) {
       ts_subtree_retain(new_children[i]);
+      if (arena) ts_subtree_arena_note_child(arena, new_children[i]);
     }
   } else if (self.ptr->has_external_tokens) {
     result->external_scanner_state = ts_external_scanner_state_copy(
-      &self.ptr->external_scanner_state
+      &self.ptr->external_scanner_state,
+      self.ptr->in_arena,
+      arena
     );
   }
   result->ref_count = 1;
+  result->in_arena = arena != NULL;
   return (MutableSubtree) {.ptr = result};
 }
 
@@ -282,8 +447,13 @@ MutableSubtree ts_subtree_clone(Subtree self) {
 // perform a copy.
 MutableSubtree ts_subtree_make_mut(SubtreePool *pool, Subtree self) {
   if (self.data.is_inline) return (MutableSubtree) {self.data};
-  if (self.ptr->ref_count == 1) return ts_subtree_to_mut_unsafe(self);
-  MutableSubtree result = ts_subtree_clone(self);
+  // Arena subtrees are only mutated in place by pools that allocate in an
+  // arena, since the subtrees that are stored in them afterward may not be
+  // arena-allocated, and the arena wouldn't know to visit them when released.
+  if (self.ptr->ref_count == 1 && (!self.ptr->in_arena || pool->arena)) {
+    return ts_subtree_to_mut_unsafe(self);
+  }
+  MutableSubtree result = ts_subtree_clone(pool, self);
   ts_subtree_release(pool, self);
   return result;
 }
@@ -309,16 +479,28 @@ static void ts_subtree__compress(
       child.ptr->symbol != symbol
     ) break;
 
+    // The grandchild's last child becomes the child's first child, so the
+    // grandchild must itself be a repetition of two nodes. This is not always
+    // the case when a reused repetition node has been pushed on the right.
     MutableSubtree grandchild = ts_subtree_to_mut_unsafe(ts_subtree_children(child)[0]);
     if (
       grandchild.data.is_inline ||
       grandchild.ptr->child_count < 2 ||
       grandchild.ptr->ref_count > 1 ||
-      grandchild.ptr->symbol != symbol
+      grandchild.ptr->symbol != symbol ||
+      ts_subtree_symbol(ts_subtree_children(grandchild)[0]) != symbol
     ) break;
 
+    // The child moves to the position of the grandchild's last child, so it
+    // now begins in the parse state where that node began. Keep that state
+    // accurate so that the child can still be reused after an edit.
+    Subtree last_grandchild = ts_subtree_children(grandchild)[grandchild.ptr->child_count - 1];
+    if (child.ptr->parse_state != TS_TREE_STATE_NONE) {
+      child.ptr->parse_state = ts_subtree_parse_state(last_grandchild);
+    }
+
     ts_subtree_children(tree)[0] = ts_subtree_from_mut(grandchild);
-    ts_subtree_children(child)[0] = ts_subtree_children(grandchild)[grandchild.ptr->child_count - 1];
+    ts_subtree_children(child)[0] = last_grandchild;
     ts_subtree_children(grandchild)[grandchild.ptr->child_count - 1] = ts_subtree_from_mut(child);
     array_push(stack, tree);
     tree = grandchild;
@@ -502,8 +684,11 @@ void ts_subtree_summarize_children(
 
 // Create a new parent node with the given children.
 //
-// This takes ownership of the children array.
+// This takes ownership of the children array. If the given pool has an
+// arena, the children are copied into it and the array is freed. Otherwise,
+// the array itself is grown to hold the node's data. The pool may be NULL.
 MutableSubtree ts_subtree_new_node(
+  SubtreePool *pool,
   TSSymbol symbol,
   SubtreeArray *children,
   unsigned production_id,
@@ -511,19 +696,34 @@ MutableSubtree ts_subtree_new_node(
 ) {
   TSSymbolMetadata metadata = ts_language_symbol_metadata(language, symbol);
   bool fragile = symbol == ts_builtin_sym_error || symbol == ts_builtin_sym_error_repeat;
+  SubtreeArena *arena = pool ? pool->arena : NULL;
+  uint32_t child_count = children->size;
 
   // Allocate the node's data at the end of the array of children.
-  size_t new_byte_size = ts_subtree_alloc_size(children->size);
-  if (children->capacity * sizeof(Subtree) < new_byte_size) {
-    children->contents = ts_realloc(children->contents, new_byte_size);
-    children->capacity = (uint32_t)(new_byte_size / sizeof(Subtree));
+  size_t new_byte_size = ts_subtree_alloc_size(child_count);
+  Subtree *contents;
+  if (arena) {
+    contents = ts_subtree_arena_allocate(arena, new_byte_size);
+    if (child_count > 0) {
+      memcpy(contents, children->contents, child_count * sizeof(Subtree));
+    }
+    for (uint32_t i = 0; i < child_count; i++) {
+      ts_subtree_arena_note_child(arena, contents[i]);
+    }
+    array_delete(children);
+  } else {
+    if (children->capacity * sizeof(Subtree) < new_byte_size) {
+      children->contents = ts_realloc(children->contents, new_byte_size);
+      children->capacity = (uint32_t)(new_byte_size / sizeof(Subtree));
+    }
+    contents = children->contents;
   }
-  SubtreeHeapData *data = (SubtreeHeapData *)&children->contents[children->size];
+  SubtreeHeapData *data = (SubtreeHeapData *)&contents[child_count];
 
   *data = (SubtreeHeapData) {
     .ref_count = 1,
     .symbol = symbol,
-    .child_count = children->size,
+    .child_count = child_count,
     .visible = metadata.visible,
     .named = metadata.named,
     .has_changes = false,
@@ -531,6 +731,7 @@ MutableSubtree ts_subtree_new_node(
     .fragile_left = fragile,
     .fragile_right = fragile,
     .is_keyword = false,
+    .in_arena = arena != NULL,
     {{
       .visible_descendant_count = 0,
       .production_id = production_id,
@@ -542,22 +743,62 @@ MutableSubtree ts_subtree_new_node(
   return result;
 }
 
+// Allocate a zeroed heap subtree in the given arena, with room for the given
+// number of children. This is used for reconstructing serialized trees, so the
+// caller is responsible for initializing every field and child.
+MutableSubtree ts_subtree_arena_new_node(SubtreeArena *arena, uint32_t child_count) {
+  size_t alloc_size = ts_subtree_alloc_size(child_count);
+  Subtree *contents = ts_subtree_arena_allocate(arena, alloc_size);
+  memset(contents, 0, alloc_size);
+  SubtreeHeapData *data = (SubtreeHeapData *)&contents[child_count];
+  data->child_count = child_count;
+  data->in_arena = true;
+  return (MutableSubtree) {.ptr = data};
+}
+
 // Create a new error node containing the given children.
 //
 // This node is treated as 'extra'. Its children are prevented from having
 // having any effect on the parse state.
 Subtree ts_subtree_new_error_node(
+  SubtreePool *pool,
   SubtreeArray *children,
   bool extra,
   const TSLanguage *language
 ) {
   MutableSubtree result = ts_subtree_new_node(
-    ts_builtin_sym_error, children, 0, language
+    pool, ts_builtin_sym_error, children, 0, language
   );
   result.ptr->extra = extra;
   return ts_subtree_from_mut(result);
 }
 
+// Create a hidden leaf that takes the place of the given subtree, so that the
+// subtree's memory can be released. The leaf keeps the subtree's error cost,
+// so that versions of the parse stack that contain it are compared in the same
+// way, and it is allocated on the heap if that cost is nonzero.
+Subtree ts_subtree_new_placeholder(
+  SubtreePool *pool,
+  Subtree self,
+  const TSLanguage *language
+) {
+  uint32_t error_cost = ts_subtree_error_cost(self);
+  if (error_cost == 0) {
+    return ts_subtree_new_leaf(
+      pool, ts_subtree_symbol(self), ts_subtree_padding(self), ts_subtree_size(self),
+      ts_subtree_lookahead_bytes(self), ts_subtree_parse_state(self),
+      false, false, false, language
+    );
+  }
+  Subtree result = ts_subtree__new_heap_leaf(
+    pool, ts_subtree_symbol(self), ts_subtree_padding(self), ts_subtree_size(self),
+    ts_subtree_lookahead_bytes(self), ts_subtree_parse_state(self),
+    false, false, false, language
+  );
+  ((SubtreeHeapData *)result.ptr)->error_cost = error_cost;
+  return result;
+}
+
 // Create a new 'missing leaf' node.
 //
 // This node is treated as 'extra'. Its children are prevented from having
@@ -588,37 +829,223 @@ void ts_subtree_retain(Subtree self) {
   assert(self.ptr->ref_count != 0);
 }
 
-void ts_subtree_release(SubtreePool *pool, Subtree self) {
+// Release a reference to a subtree, freeing any subtrees that are no longer
+// referenced. Arena subtrees are never freed individually, but they still
+// release their children. If `skip_arena_subtrees` is set, then references
+// held on arena subtrees are left in place, and their descendants are not
+// visited at all.
+static inline void ts_subtree__release_start(SubtreePool *pool, Subtree self, bool skip_arena_subtrees) {
   if (self.data.is_inline) return;
-  array_clear(&pool->tree_stack);
-
+  if (skip_arena_subtrees && self.ptr->in_arena) return;
   assert(self.ptr->ref_count > 0);
   if (atomic_dec((volatile uint32_t *)&self.ptr->ref_count) == 0) {
     array_push(&pool->tree_stack, ts_subtree_to_mut_unsafe(self));
   }
+}
 
-  while (pool->tree_stack.size > 0) {
+static inline uint32_t ts_subtree__release_step(SubtreePool *pool, bool skip_arena_subtrees, uint32_t max_count) {
+  uint32_t count = 0;
+  while (count < max_count && pool->tree_stack.size > 0) {
     MutableSubtree tree = array_pop(&pool->tree_stack);
     if (tree.ptr->child_count > 0) {
       Subtree *children = ts_subtree_children(tree);
       for (uint32_t i = 0; i < tree.ptr->child_count; i++) {
         Subtree child = children[i];
         if (child.data.is_inline) continue;
+        if (skip_arena_subtrees && child.ptr->in_arena) continue;
         assert(child.ptr->ref_count > 0);
         if (atomic_dec((volatile uint32_t *)&child.ptr->ref_count) == 0) {
           array_push(&pool->tree_stack, ts_subtree_to_mut_unsafe(child));
         }
       }
-      ts_free(children);
-    } else {
+      if (!tree.ptr->in_arena) ts_free(children);
+    } else if (!tree.ptr->in_arena) {
       if (tree.ptr->has_external_tokens) {
         ts_external_scanner_state_delete(&tree.ptr->external_scanner_state);
       }
       ts_subtree_pool_free(pool, tree.ptr);
     }
+    count++;
+  }
+  return count;
+}
+
+static void ts_subtree__release(SubtreePool *pool, Subtree self, bool skip_arena_subtrees) {
+  array_clear(&pool->tree_stack);
+  ts_subtree__release_start(pool, self, skip_arena_subtrees);
+  ts_subtree__release_step(pool, skip_arena_subtrees, UINT32_MAX);
+}
+
+void ts_subtree_release(SubtreePool *pool, Subtree self) {
+  ts_subtree__release(pool, self, false);
+}
+
+// Release a reference to a subtree without visiting any of the arena subtrees
+// that it contains. This is only valid when the memory for those subtrees is
+// about to be reclaimed by releasing their arenas, and when none of those
+// arenas have foreign references.
+void ts_subtree_release_outside_arenas(SubtreePool *pool, Subtree self) {
+  ts_subtree__release(pool, self, true);
+}
+
+// Release a reference to a subtree, but leave the subtrees that need to be
+// freed as a result on the pool's tree stack, so that they can be freed
+// incrementally by `ts_subtree_release_step`.
+void ts_subtree_release_start(SubtreePool *pool, Subtree self, bool skip_arena_subtrees) {
+  ts_subtree__release_start(pool, self, skip_arena_subtrees);
+}
+
+// Free at most `max_count` of the subtrees on the pool's tree stack, releasing
+// their children. Returns the number of subtrees that were freed.
+uint32_t ts_subtree_release_step(SubtreePool *pool, bool skip_arena_subtrees, uint32_t max_count) {
+  return ts_subtree__release_step(pool, skip_arena_subtrees, max_count);
+}
+
+// Memory accounting
+
+// The owner of a block of memory that is reachable from more than one root.
+#define SUBTREE_MEMORY_SHARED UINT32_MAX
+
+typedef struct {
+  const void *block;
+  uint32_t owner;
+} SubtreeMemoryEntry;
+
+typedef struct {
+  SubtreeMemoryEntry *slots;
+  uint32_t capacity;
+  uint32_t size;
+} SubtreeMemoryMap;
+
+typedef struct {
+  Subtree subtree;
+  bool is_shared;
+} SubtreeMemoryStackEntry;
+
+static inline uint32_t ts_subtree__memory_hash(const void *block) {
+  return (uint32_t)(((uintptr_t)block >> 3) * 2654435761u);
+}
+
+// Find the entry for the given block of memory, adding one with the given
+// owner if there is none.
+static SubtreeMemoryEntry *ts_subtree__memory_entry(
+  SubtreeMemoryMap *self,
+  const void *block,
+  uint32_t owner,
+  bool *is_new
+) {
+  if ((self->size + 1) * 2 > self->capacity) {
+    SubtreeMemoryMap grown = {
+      .slots = ts_calloc(self->capacity ? self->capacity * 2 : 64, sizeof(SubtreeMemoryEntry)),
+      .capacity = self->capacity ? self->capacity * 2 : 64,
+      .size = self->size,
+    };
+    uint32_t mask = grown.capacity - 1;
+    for (uint32_t i = 0; i < self->capacity; i++) {
+      SubtreeMemoryEntry *entry = &self->slots[i];
+      if (!entry->block) continue;
+      uint32_t j = ts_subtree__memory_hash(entry->block) & mask;
+      while (grown.slots[j].block) j = (j + 1) & mask;
+      grown.slots[j] = *entry;
+    }
+    ts_free(self->slots);
+    *self = grown;
+  }
+
+  uint32_t mask = self->capacity - 1;
+  for (uint32_t i = ts_subtree__memory_hash(block) & mask;; i = (i + 1) & mask) {
+    SubtreeMemoryEntry *entry = &self->slots[i];
+    if (entry->block == block) {
+      *is_new = false;
+      return entry;
+    }
+    if (!entry->block) {
+      *entry = (SubtreeMemoryEntry) {block, owner};
+      self->size++;
+      *is_new = true;
+      return entry;
+    }
+  }
+}
+
+// Record that a block of memory is reachable from the given root. Returns true
+// if the memory hadn't already been attributed to that root, in which case
+// the blocks that are reachable from it need to be visited too.
+//
+// Whenever a block is reachable from a root, so is everything that is reachable
+// from that block. So a block that is attributed to one root only refers to
+// blocks that are attributed to the same root, or are shared, and a shared
+// block only refers to shared blocks.
+static bool ts_subtree__memory_visit(
+  SubtreeMemoryMap *map,
+  const void *block,
+  size_t size,
+  uint32_t owner,
+  bool *is_shared,
+  size_t *unique_bytes,
+  size_t *shared_bytes
+) {
+  bool is_new;
+  SubtreeMemoryEntry *entry = ts_subtree__memory_entry(map, block, *is_shared ? SUBTREE_MEMORY_SHARED : owner, &is_new);
+  if (is_new) {
+    if (*is_shared) *shared_bytes += size;
+    else unique_bytes[owner] += size;
+    return true;
+  }
+  if (entry->owner == SUBTREE_MEMORY_SHARED) return false;
+  if (entry->owner == owner && !*is_shared) return false;
+  unique_bytes[entry->owner] -= size;
+  *shared_bytes += size;
+  entry->owner = SUBTREE_MEMORY_SHARED;
+  *is_shared = true;
+  return true;
+}
+
+size_t ts_subtree_shared_memory_usage(const Subtree *roots, uint32_t count, size_t *unique_bytes) {
+  SubtreeMemoryMap map = {NULL, 0, 0};
+  Array(SubtreeMemoryStackEntry) stack = array_new();
+  size_t shared_bytes = 0;
+
+  for (uint32_t i = 0; i < count; i++) {
+    unique_bytes[i] = 0;
+    if (!roots[i].ptr) continue;
+    array_push(&stack, ((SubtreeMemoryStackEntry) {roots[i], false}));
+    while (stack.size > 0) {
+      SubtreeMemoryStackEntry entry = array_pop(&stack);
+      Subtree tree = entry.subtree;
+      if (tree.data.is_inline) continue;
+
+      uint32_t child_count = tree.ptr->child_count;
+      if (!ts_subtree__memory_visit(
+        &map, tree.ptr, ts_subtree_alloc_size(child_count),
+        i, &entry.is_shared, unique_bytes, &shared_bytes
+      )) continue;
+
+      if (child_count > 0) {
+        Subtree *children = ts_subtree_children(tree);
+        for (uint32_t j = 0; j < child_count; j++) {
+          array_push(&stack, ((SubtreeMemoryStackEntry) {children[j], entry.is_shared}));
+        }
+      } else if (tree.ptr->has_external_tokens) {
+        // Long external scanner states can be shared between subtrees.
+        const ExternalScannerState *state = &tree.ptr->external_scanner_state;
+        if (state->length > sizeof(state->short_data)) {
+          size_t size = state->length;
+          if (!tree.ptr->in_arena) size += sizeof(ExternalScannerStateBuffer);
+          bool is_shared = entry.is_shared;
+          ts_subtree__memory_visit(&map, state->long_data, size, i, &is_shared, unique_bytes, &shared_bytes);
+        }
+      }
+    }
   }
+
+  array_delete(&stack);
+  ts_free(map.slots);
+  return shared_bytes;
 }
 
+#undef SUBTREE_MEMORY_SHARED
+
 int ts_subtree_compare(Subtree left, Subtree right, SubtreePool *pool) {
   array_push(&pool->tree_stack, ts_subtree_to_mut_unsafe(left));
   array_push(&pool->tree_stack, ts_subtree_to_mut_unsafe(right));
@@ -656,155 +1083,258 @@ static inline void ts_subtree_set_has_changes(MutableSubtree *self) {
   }
 }
 
-Subtree ts_subtree_edit(Subtree self, const TSInputEdit *input_edit, SubtreePool *pool) {
-  typedef struct {
-    Subtree *tree;
-    Edit edit;
-  } EditEntry;
+// Apply an edit to a subtree's own padding and size, without descending into
+// its children. Returns false if the edit does not affect the subtree.
+static bool ts_subtree__edit_node(Subtree *tree, Edit edit, SubtreePool *pool) {
+  bool is_noop = edit.old_end.bytes == edit.start.bytes && edit.new_end.bytes == edit.start.bytes;
+  bool is_pure_insertion = edit.old_end.bytes == edit.start.bytes;
+
+  Length size = ts_subtree_size(*tree);
+  Length padding = ts_subtree_padding(*tree);
+  Length total_size = length_add(padding, size);
+  uint32_t lookahead_bytes = ts_subtree_lookahead_bytes(*tree);
+  uint32_t end_byte = total_size.bytes + lookahead_bytes;
+  if (edit.start.bytes > end_byte || (is_noop && edit.start.bytes == end_byte)) return false;
+
+  // If the edit is entirely within the space before this subtree, then shift this
+  // subtree over according to the edit without changing its size.
+  if (edit.old_end.bytes <= padding.bytes) {
+    padding = length_add(edit.new_end, length_sub(padding, edit.old_end));
+  }
 
+  // If the edit starts in the space before this subtree and extends into this subtree,
+  // shrink the subtree's content to compensate for the change in the space before it.
+  else if (edit.start.bytes < padding.bytes) {
+    size = length_saturating_sub(size, length_sub(edit.old_end, padding));
+    padding = edit.new_end;
+  }
+
+  // If the edit is a pure insertion right at the start of the subtree,
+  // shift the subtree over according to the insertion.
+  else if (edit.start.bytes == padding.bytes && is_pure_insertion) {
+    padding = edit.new_end;
+  }
+
+  // If the edit is within this subtree, resize the subtree to reflect the edit.
+  else if (
+    edit.start.bytes < total_size.bytes ||
+    (edit.start.bytes == total_size.bytes && is_pure_insertion)
+  ) {
+    size = length_add(
+      length_sub(edit.new_end, padding),
+      length_saturating_sub(total_size, edit.old_end)
+    );
+  }
+
+  MutableSubtree result = ts_subtree_make_mut(pool, *tree);
+
+  if (result.data.is_inline) {
+    if (ts_subtree_can_inline(padding, size, lookahead_bytes)) {
+      result.data.padding_bytes = padding.bytes;
+      result.data.padding_rows = padding.extent.row;
+      result.data.padding_columns = padding.extent.column;
+      result.data.size_bytes = size.bytes;
+    } else {
+      SubtreeHeapData *data = ts_subtree_pool_allocate(pool);
+      data->ref_count = 1;
+      data->padding = padding;
+      data->size = size;
+      data->lookahead_bytes = lookahead_bytes;
+      data->error_cost = 0;
+      data->child_count = 0;
+      data->symbol = result.data.symbol;
+      data->parse_state = result.data.parse_state;
+      data->visible = result.data.visible;
+      data->named = result.data.named;
+      data->extra = result.data.extra;
+      data->fragile_left = false;
+      data->fragile_right = false;
+      data->has_changes = false;
+      data->has_external_tokens = false;
+      data->depends_on_column = false;
+      data->is_missing = result.data.is_missing;
+      data->is_keyword = result.data.is_keyword;
+      data->in_arena = pool->arena != NULL;
+      result.ptr = data;
+    }
+  } else {
+    result.ptr->padding = padding;
+    result.ptr->size = size;
+  }
+
+  ts_subtree_set_has_changes(&result);
+  *tree = ts_subtree_from_mut(result);
+  return true;
+}
+
+static int ts_subtree__compare_child_edits(const void *a, const void *b) {
+  const ChildEdit *left = a, *right = b;
+  if (left->child_index != right->child_index) {
+    return left->child_index < right->child_index ? -1 : 1;
+  }
+  return left->order < right->order ? -1 : left->order > right->order ? 1 : 0;
+}
+
+// Apply a sequence of edits to a subtree, as if they were applied one at a
+// time, but visiting each affected node only once.
+//
+// Applying an edit to a node only depends on the node's own padding and size,
+// and on the sizes of its children. So each node is resized as soon as an edit
+// reaches it, and the edits that reach it are queued, in order, so that they
+// can be distributed among its children when the node itself is visited.
+Subtree ts_subtree_edit(
+  Subtree self,
+  const TSInputEdit *input_edits,
+  uint32_t count,
+  SubtreePool *pool
+) {
+  Array(NodeEdit) node_edits = array_new();
+  Array(ChildEdit) child_edits = array_new();
   Array(EditEntry) stack = array_new();
-  array_push(&stack, ((EditEntry) {
-    .tree = &self,
-    .edit = (Edit) {
+
+  for (uint32_t i = 0; i < count; i++) {
+    const TSInputEdit *input_edit = &input_edits[i];
+    Edit edit = {
       .start = {input_edit->start_byte, input_edit->start_point},
       .old_end = {input_edit->old_end_byte, input_edit->old_end_point},
       .new_end = {input_edit->new_end_byte, input_edit->new_end_point},
-    },
-  }));
+    };
+    if (ts_subtree__edit_node(&self, edit, pool)) {
+      array_push(&node_edits, ((NodeEdit) {edit, ts_subtree_padding(self).extent.row}));
+    }
+  }
+  if (node_edits.size > 0) {
+    array_push(&stack, ((EditEntry) {&self, 0, node_edits.size}));
+  }
 
   while (stack.size) {
     EditEntry entry = array_pop(&stack);
-    Edit edit = entry.edit;
-    bool is_noop = edit.old_end.bytes == edit.start.bytes && edit.new_end.bytes == edit.start.bytes;
-    bool is_pure_insertion = edit.old_end.bytes == edit.start.bytes;
+    uint32_t child_count = ts_subtree_child_count(*entry.tree);
+    if (child_count == 0) continue;
+
     bool invalidate_first_row = ts_subtree_depends_on_column(*entry.tree);
+    Subtree *children = ts_subtree_children(*entry.tree);
+    array_clear(&child_edits);
+
+    for (uint32_t j = 0; j < entry.edit_count; j++) {
+      NodeEdit node_edit = node_edits.contents[entry.edit_index + j];
+      Edit edit = node_edit.edit;
+      bool is_pure_insertion = edit.old_end.bytes == edit.start.bytes;
+
+      Length child_left, child_right = length_zero();
+      for (uint32_t i = 0; i < child_count; i++) {
+        Subtree *child = &children[i];
+        Length child_size = ts_subtree_total_size(*child);
+        child_left = child_right;
+        child_right = length_add(child_left, child_size);
+
+        // If this child ends before the edit, it is not affected.
+        if (child_right.bytes + ts_subtree_lookahead_bytes(*child) < edit.start.bytes) continue;
+
+        // Keep editing child nodes until a node is reached that starts after the edit.
+        // Also, if this node's validity depends on its column position, then continue
+        // invaliditing child nodes until reaching a line break.
+        if ((
+          (child_left.bytes > edit.old_end.bytes) ||
+          (child_left.bytes == edit.old_end.bytes && child_size.bytes > 0 && i > 0)
+        ) && (
+          !invalidate_first_row ||
+          child_left.extent.row > node_edit.padding_rows
+        )) {
+          break;
+        }
 
-    Length size = ts_subtree_size(*entry.tree);
-    Length padding = ts_subtree_padding(*entry.tree);
-    Length total_size = length_add(padding, size);
-    uint32_t lookahead_bytes = ts_subtree_lookahead_bytes(*entry.tree);
-    uint32_t end_byte = total_size.bytes + lookahead_bytes;
-    if (edit.start.bytes > end_byte || (is_noop && edit.start.bytes == end_byte)) continue;
-
-    // If the edit is entirely within the space before this subtree, then shift this
-    // subtree over according to the edit without changing its size.
-    if (edit.old_end.bytes <= padding.bytes) {
-      padding = length_add(edit.new_end, length_sub(padding, edit.old_end));
-    }
+        // Transform edit into the child's coordinate space.
+        Edit child_edit = {
+          .start = length_saturating_sub(edit.start, child_left),
+          .old_end = length_saturating_sub(edit.old_end, child_left),
+          .new_end = length_saturating_sub(edit.new_end, child_left),
+        };
+
+        // Interpret all inserted text as applying to the *first* child that touches the edit.
+        // Subsequent children are only never have any text inserted into them; they are only
+        // shrunk to compensate for the edit.
+        if (
+          child_right.bytes > edit.start.bytes ||
+          (child_right.bytes == edit.start.bytes && is_pure_insertion)
+        ) {
+          edit.new_end = edit.start;
+        }
 
-    // If the edit starts in the space before this subtree and extends into this subtree,
-    // shrink the subtree's content to compensate for the change in the space before it.
-    else if (edit.start.bytes < padding.bytes) {
-      size = length_saturating_sub(size, length_sub(edit.old_end, padding));
-      padding = edit.new_end;
-    }
+        // Children that occur before the edit are not reshaped by the edit.
+        else {
+          child_edit.old_end = child_edit.start;
+          child_edit.new_end = child_edit.start;
+        }
 
-    // If the edit is a pure insertion right at the start of the subtree,
-    // shift the subtree over according to the insertion.
-    else if (edit.start.bytes == padding.bytes && is_pure_insertion) {
-      padding = edit.new_end;
+        // Resize the child right away, so that the next edit sees its new size,
+        // and queue the edit for processing of the child's own children.
+        if (ts_subtree__edit_node(child, child_edit, pool)) {
+          array_push(&child_edits, ((ChildEdit) {
+            .child_index = i,
+            .order = child_edits.size,
+            .node_edit = {child_edit, ts_subtree_padding(*child).extent.row},
+          }));
+        }
+      }
     }
 
-    // If the edit is within this subtree, resize the subtree to reflect the edit.
-    else if (
-      edit.start.bytes < total_size.bytes ||
-      (edit.start.bytes == total_size.bytes && is_pure_insertion)
-    ) {
-      size = length_add(
-        length_sub(edit.new_end, padding),
-        length_saturating_sub(total_size, edit.old_end)
-      );
+    // Group the queued edits by child, keeping each child's edits in order.
+    bool is_sorted = true;
+    for (uint32_t i = 1; i < child_edits.size; i++) {
+      if (child_edits.contents[i].child_index < child_edits.contents[i - 1].child_index) {
+        is_sorted = false;
+        break;
+      }
+    }
+    if (!is_sorted) {
+      qsort(child_edits.contents, child_edits.size, sizeof(ChildEdit), ts_subtree__compare_child_edits);
     }
 
-    MutableSubtree result = ts_subtree_make_mut(pool, *entry.tree);
-
-    if (result.data.is_inline) {
-      if (ts_subtree_can_inline(padding, size, lookahead_bytes)) {
-        result.data.padding_bytes = padding.bytes;
-        result.data.padding_rows = padding.extent.row;
-        result.data.padding_columns = padding.extent.column;
-        result.data.size_bytes = size.bytes;
-      } else {
-        SubtreeHeapData *data = ts_subtree_pool_allocate(pool);
-        data->ref_count = 1;
-        data->padding = padding;
-        data->size = size;
-        data->lookahead_bytes = lookahead_bytes;
-        data->error_cost = 0;
-        data->child_count = 0;
-        data->symbol = result.data.symbol;
-        data->parse_state = result.data.parse_state;
-        data->visible = result.data.visible;
-        data->named = result.data.named;
-        data->extra = result.data.extra;
-        data->fragile_left = false;
-        data->fragile_right = false;
-        data->has_changes = false;
-        data->has_external_tokens = false;
-        data->depends_on_column = false;
-        data->is_missing = result.data.is_missing;
-        data->is_keyword = result.data.is_keyword;
-        result.ptr = data;
+    for (uint32_t i = 0; i < child_edits.size;) {
+      uint32_t child_index = child_edits.contents[i].child_index;
+      EditEntry child_entry = {&children[child_index], node_edits.size, 0};
+      for (; i < child_edits.size && child_edits.contents[i].child_index == child_index; i++) {
+        array_push(&node_edits, child_edits.contents[i].node_edit);
+        child_entry.edit_count++;
       }
-    } else {
-      result.ptr->padding = padding;
-      result.ptr->size = size;
+      array_push(&stack, child_entry);
     }
+  }
+
+  array_delete(&stack);
+  array_delete(&child_edits);
+  array_delete(&node_edits);
+  return self;
+}
+
+Subtree ts_subtree_invalidate(Subtree self, uint32_t start_byte, uint32_t end_byte, SubtreePool *pool) {
+  typedef struct {
+    Subtree *tree;
+    uint32_t offset;
+  } InvalidateEntry;
+
+  Array(InvalidateEntry) stack = array_new();
+  array_push(&stack, ((InvalidateEntry) {.tree = &self, .offset = 0}));
+
+  while (stack.size) {
+    InvalidateEntry entry = array_pop(&stack);
+
+    // Subtrees whose text, or the text that was examined after them by the
+    // lexer, doesn't touch the range are unaffected.
+    uint32_t end = entry.offset + ts_subtree_total_bytes(*entry.tree) + ts_subtree_lookahead_bytes(*entry.tree);
+    if (entry.offset > end_byte || end < start_byte) continue;
 
+    MutableSubtree result = ts_subtree_make_mut(pool, *entry.tree);
     ts_subtree_set_has_changes(&result);
     *entry.tree = ts_subtree_from_mut(result);
 
-    Length child_left, child_right = length_zero();
+    uint32_t child_offset = entry.offset;
     for (uint32_t i = 0, n = ts_subtree_child_count(*entry.tree); i < n; i++) {
       Subtree *child = &ts_subtree_children(*entry.tree)[i];
-      Length child_size = ts_subtree_total_size(*child);
-      child_left = child_right;
-      child_right = length_add(child_left, child_size);
-
-      // If this child ends before the edit, it is not affected.
-      if (child_right.bytes + ts_subtree_lookahead_bytes(*child) < edit.start.bytes) continue;
-
-      // Keep editing child nodes until a node is reached that starts after the edit.
-      // Also, if this node's validity depends on its column position, then continue
-      // invaliditing child nodes until reaching a line break.
-      if ((
-        (child_left.bytes > edit.old_end.bytes) ||
-        (child_left.bytes == edit.old_end.bytes && child_size.bytes > 0 && i > 0)
-      ) && (
-        !invalidate_first_row ||
-        child_left.extent.row > entry.tree->ptr->padding.extent.row
-      )) {
-        break;
-      }
-
-      // Transform edit into the child's coordinate space.
-      Edit child_edit = {
-        .start = length_saturating_sub(edit.start, child_left),
-        .old_end = length_saturating_sub(edit.old_end, child_left),
-        .new_end = length_saturating_sub(edit.new_end, child_left),
-      };
-
-      // Interpret all inserted text as applying to the *first* child that touches the edit.
-      // Subsequent children are only never have any text inserted into them; they are only
-      // shrunk to compensate for the edit.
-      if (
-        child_right.bytes > edit.start.bytes ||
-        (child_right.bytes == edit.start.bytes && is_pure_insertion)
-      ) {
-        edit.new_end = edit.start;
-      }
-
-      // Children that occur before the edit are not reshaped by the edit.
-      else {
-        child_edit.old_end = child_edit.start;
-        child_edit.new_end = child_edit.start;
-      }
-
-      // Queue processing of this child's subtree.
-      array_push(&stack, ((EditEntry) {
-        .tree = child,
-        .edit = child_edit,
-      }));
+      if (child_offset > end_byte) break;
+      array_push(&stack, ((InvalidateEntry) {.tree = child, .offset = child_offset}));
+      child_offset += ts_subtree_total_bytes(*child);
     }
   }
 
@@ -845,15 +1375,72 @@ static size_t ts_subtree__write_char_to_string(char *str, size_t n, int32_t chr)
 
 static const char *const ROOT_FIELD = "__ROOT__";
 
-static size_t ts_subtree__write_to_string(
-  Subtree self, char *string, size_t limit,
+#define TS_STRING_WRITER_BUFFER_SIZE 1024
+
+// A buffer that collects small pieces of a string, and passes them on to a
+// `TSStringWriter` in larger chunks.
+typedef struct {
+  TSStringWriter writer;
+  uint32_t length;
+  char buffer[TS_STRING_WRITER_BUFFER_SIZE];
+} StringWriter;
+
+static void string_writer__flush(StringWriter *self) {
+  if (self->length > 0) {
+    self->writer.write(self->writer.payload, self->buffer, self->length);
+    self->length = 0;
+  }
+}
+
+static void string_writer__write(StringWriter *self, const char *data, size_t length) {
+  while (length > 0) {
+    if (self->length == TS_STRING_WRITER_BUFFER_SIZE) string_writer__flush(self);
+    size_t count = TS_STRING_WRITER_BUFFER_SIZE - self->length;
+    if (count > length) count = length;
+    memcpy(&self->buffer[self->length], data, count);
+    self->length += count;
+    data += count;
+    length -= count;
+  }
+}
+
+static void string_writer__puts(StringWriter *self, const char *string) {
+  string_writer__write(self, string, strlen(string));
+}
+
+static void string_writer__put_uint(StringWriter *self, uint32_t value) {
+  char buffer[16];
+  int length = snprintf(buffer, sizeof(buffer), "%u", value);
+  string_writer__write(self, buffer, length);
+}
+
+static void string_writer__put_json_string(StringWriter *self, const char *string) {
+  string_writer__puts(self, "\"");
+  for (const char *c = string; *c; c++) {
+    if (*c == '"' || *c == '\\') {
+      char escaped[2] = {'\\', *c};
+      string_writer__write(self, escaped, 2);
+    } else if ((unsigned char)*c < 0x20) {
+      char escaped[8];
+      int length = snprintf(escaped, sizeof(escaped), "\\u%04x", (unsigned char)*c);
+      string_writer__write(self, escaped, length);
+    } else {
+      string_writer__write(self, c, 1);
+    }
+  }
+  string_writer__puts(self, "\"");
+}
+
+static void ts_subtree__write_sexp(
+  StringWriter *writer, Subtree self,
   const TSLanguage *language, bool include_all,
   TSSymbol alias_symbol, bool alias_is_named, const char *field_name
 ) {
-  if (!self.ptr) return snprintf(string, limit, "(NULL)");
+  if (!self.ptr) {
+    string_writer__puts(writer, "(NULL)");
+    return;
+  }
 
-  char *cursor = string;
-  char **writer = (limit > 1) ? &cursor : &string;
   bool is_root = field_name == ROOT_FIELD;
   bool is_visible =
     include_all ||
@@ -866,38 +1453,49 @@ static size_t ts_subtree__write_to_string(
 
   if (is_visible) {
     if (!is_root) {
-      cursor += snprintf(*writer, limit, " ");
+      string_writer__puts(writer, " ");
       if (field_name) {
-        cursor += snprintf(*writer, limit, "%s: ", field_name);
+        string_writer__puts(writer, field_name);
+        string_writer__puts(writer, ": ");
       }
     }
 
     if (ts_subtree_is_error(self) && ts_subtree_child_count(self) == 0 && self.ptr->size.bytes > 0) {
-      cursor += snprintf(*writer, limit, "(UNEXPECTED ");
-      cursor += ts_subtree__write_char_to_string(*writer, limit, self.ptr->lookahead_char);
+      char buffer[16];
+      size_t length = ts_subtree__write_char_to_string(buffer, sizeof(buffer), self.ptr->lookahead_char);
+      string_writer__puts(writer, "(UNEXPECTED ");
+      string_writer__write(writer, buffer, length);
     } else {
       TSSymbol symbol = alias_symbol ? alias_symbol : ts_subtree_symbol(self);
       const char *symbol_name = ts_language_symbol_name(language, symbol);
       if (ts_subtree_missing(self)) {
-        cursor += snprintf(*writer, limit, "(MISSING ");
+        string_writer__puts(writer, "(MISSING ");
         if (alias_is_named || ts_subtree_named(self)) {
-          cursor += snprintf(*writer, limit, "%s", symbol_name);
+          string_writer__puts(writer, symbol_name);
         } else {
-          cursor += snprintf(*writer, limit, "\"%s\"", symbol_name);
+          string_writer__puts(writer, "\"");
+          string_writer__puts(writer, symbol_name);
+          string_writer__puts(writer, "\"");
         }
       } else {
-        cursor += snprintf(*writer, limit, "(%s", symbol_name);
+        string_writer__puts(writer, "(");
+        string_writer__puts(writer, symbol_name);
       }
     }
   } else if (is_root) {
     TSSymbol symbol = alias_symbol ? alias_symbol : ts_subtree_symbol(self);
     const char *symbol_name = ts_language_symbol_name(language, symbol);
     if (ts_subtree_child_count(self) > 0) {
-      cursor += snprintf(*writer, limit, "(%s", symbol_name);
+      string_writer__puts(writer, "(");
+      string_writer__puts(writer, symbol_name);
     } else if (ts_subtree_named(self)) {
-      cursor += snprintf(*writer, limit, "(%s)", symbol_name);
+      string_writer__puts(writer, "(");
+      string_writer__puts(writer, symbol_name);
+      string_writer__puts(writer, ")");
     } else {
-      cursor += snprintf(*writer, limit, "(\"%s\")", symbol_name);
+      string_writer__puts(writer, "(\"");
+      string_writer__puts(writer, symbol_name);
+      string_writer__puts(writer, "\")");
     }
   }
 
@@ -915,8 +1513,8 @@ static size_t ts_subtree__write_to_string(
     for (uint32_t i = 0; i < self.ptr->child_count; i++) {
       Subtree child = ts_subtree_children(self)[i];
       if (ts_subtree_extra(child)) {
-        cursor += ts_subtree__write_to_string(
-          child, *writer, limit,
+        ts_subtree__write_sexp(
+          writer, child,
           language, include_all,
           0, false, NULL
         );
@@ -936,8 +1534,8 @@ static size_t ts_subtree__write_to_string(
           }
         }
 
-        cursor += ts_subtree__write_to_string(
-          child, *writer, limit,
+        ts_subtree__write_sexp(
+          writer, child,
           language, include_all,
           subtree_alias_symbol, subtree_alias_is_named, child_field_name
         );
@@ -946,9 +1544,135 @@ static size_t ts_subtree__write_to_string(
     }
   }
 
-  if (is_visible) cursor += snprintf(*writer, limit, ")");
+  if (is_visible) string_writer__puts(writer, ")");
+}
 
-  return cursor - string;
+static void ts_subtree__write_json_point(StringWriter *writer, TSPoint point) {
+  string_writer__puts(writer, "{\"row\":");
+  string_writer__put_uint(writer, point.row);
+  string_writer__puts(writer, ",\"column\":");
+  string_writer__put_uint(writer, point.column);
+  string_writer__puts(writer, "}");
+}
+
+// Write the visible nodes in the given subtree as JSON objects. Invisible
+// nodes are skipped, and their visible descendants are listed as children of
+// their nearest visible ancestor, which is tracked using `has_children`.
+static void ts_subtree__write_json(
+  StringWriter *writer, Subtree self, Length position,
+  const TSLanguage *language, TSSymbol alias_symbol, bool alias_is_named,
+  const char *field_name, bool *has_children
+) {
+  bool is_root = field_name == ROOT_FIELD;
+  bool is_visible = is_root || alias_symbol || ts_subtree_visible(self);
+
+  bool child_has_children = false;
+  if (is_visible) {
+    if (!is_root) {
+      string_writer__puts(writer, *has_children ? "," : ",\"children\":[");
+      *has_children = true;
+    }
+
+    TSSymbol symbol = alias_symbol ? alias_symbol : ts_subtree_symbol(self);
+    bool is_named = alias_symbol ? alias_is_named : ts_subtree_named(self);
+    Length end = length_add(position, ts_subtree_size(self));
+    string_writer__puts(writer, "{\"type\":");
+    string_writer__put_json_string(writer, ts_language_symbol_name(language, symbol));
+    if (field_name && !is_root) {
+      string_writer__puts(writer, ",\"field\":");
+      string_writer__put_json_string(writer, field_name);
+    }
+    string_writer__puts(writer, is_named ? ",\"named\":true" : ",\"named\":false");
+    string_writer__puts(writer, ts_subtree_missing(self) ? ",\"missing\":true" : ",\"missing\":false");
+    string_writer__puts(writer, ts_subtree_extra(self) ? ",\"extra\":true" : ",\"extra\":false");
+    string_writer__puts(writer, ",\"start_byte\":");
+    string_writer__put_uint(writer, position.bytes);
+    string_writer__puts(writer, ",\"end_byte\":");
+    string_writer__put_uint(writer, end.bytes);
+    string_writer__puts(writer, ",\"start_point\":");
+    ts_subtree__write_json_point(writer, position.extent);
+    string_writer__puts(writer, ",\"end_point\":");
+    ts_subtree__write_json_point(writer, end.extent);
+    has_children = &child_has_children;
+  }
+
+  if (ts_subtree_child_count(self)) {
+    const TSSymbol *alias_sequence = ts_language_alias_sequence(language, self.ptr->production_id);
+    const TSFieldMapEntry *field_map, *field_map_end;
+    ts_language_field_map(
+      language,
+      self.ptr->production_id,
+      &field_map,
+      &field_map_end
+    );
+
+    uint32_t structural_child_index = 0;
+    for (uint32_t i = 0; i < self.ptr->child_count; i++) {
+      Subtree child = ts_subtree_children(self)[i];
+      if (i > 0) position = length_add(position, ts_subtree_padding(child));
+
+      TSSymbol subtree_alias_symbol = 0;
+      bool subtree_alias_is_named = false;
+      const char *child_field_name = NULL;
+      if (!ts_subtree_extra(child)) {
+        if (alias_sequence) subtree_alias_symbol = alias_sequence[structural_child_index];
+        if (subtree_alias_symbol) {
+          subtree_alias_is_named = ts_language_symbol_metadata(language, subtree_alias_symbol).named;
+        }
+
+        child_field_name = is_visible ? NULL : field_name;
+        for (const TSFieldMapEntry *map = field_map; map < field_map_end; map++) {
+          if (!map->inherited && map->child_index == structural_child_index) {
+            child_field_name = language->field_names[map->field_id];
+            break;
+          }
+        }
+        structural_child_index++;
+      }
+
+      ts_subtree__write_json(
+        writer, child, position,
+        language, subtree_alias_symbol, subtree_alias_is_named,
+        child_field_name, has_children
+      );
+      position = length_add(position, ts_subtree_size(child));
+    }
+  }
+
+  if (is_visible) string_writer__puts(writer, child_has_children ? "]}" : "}");
+}
+
+void ts_subtree_write_string(
+  Subtree self,
+  TSSymbol alias_symbol,
+  bool alias_is_named,
+  Length position,
+  const TSLanguage *language,
+  bool include_all,
+  TSNodeStringFormat format,
+  TSStringWriter writer
+) {
+  StringWriter string_writer = {.writer = writer, .length = 0};
+  if (format == TSNodeStringFormatJSON) {
+    bool has_children = false;
+    ts_subtree__write_json(
+      &string_writer, self, position,
+      language, alias_symbol, alias_is_named,
+      ROOT_FIELD, &has_children
+    );
+  } else {
+    ts_subtree__write_sexp(
+      &string_writer, self,
+      language, include_all,
+      alias_symbol, alias_is_named, ROOT_FIELD
+    );
+  }
+  string_writer__flush(&string_writer);
+}
+
+static void ts_subtree__append_to_string(void *payload, const char *data, uint32_t length) {
+  Array(char) *string = payload;
+  array_extend(string, length, data);
 }
 
 char *ts_subtree_string(
@@ -958,19 +1682,14 @@ char *ts_subtree_string(
   const TSLanguage *language,
   bool include_all
 ) {
-  char scratch_string[1];
-  size_t size = ts_subtree__write_to_string(
-    self, scratch_string, 1,
-    language, include_all,
-    alias_symbol, alias_is_named, ROOT_FIELD
-  ) + 1;
-  char *result = ts_malloc(size * sizeof(char));
-  ts_subtree__write_to_string(
-    self, result, size,
-    language, include_all,
-    alias_symbol, alias_is_named, ROOT_FIELD
+  Array(char) string = array_new();
+  ts_subtree_write_string(
+    self, alias_symbol, alias_is_named, length_zero(),
+    language, include_all, TSNodeStringFormatSExpression,
+    (TSStringWriter) {&string, ts_subtree__append_to_string}
   );
-  return result;
+  array_push(&string, '\0');
+  return string.contents;
 }
 
 void ts_subtree__print_dot_graph(const Subtree *self, uint32_t start_offset,
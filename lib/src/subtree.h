@@ -27,11 +27,17 @@ extern "C" {
 // restored using its `deserialize` function.
 //
 // Small byte arrays are stored inline, and long ones are allocated
-// separately on the heap.
+// separately. The inline buffer is no larger than the fields of a parent
+// node, so that this struct, which shares a union with those fields, does
+// not make every heap subtree larger. Long heap-allocated states are
+// reference counted, so that consecutive tokens with the same scanner
+// state can share one copy of it.
+// Long states in arena subtrees live in the arena, and are shared directly
+// between the arena subtrees that refer to them.
 typedef struct {
   union {
     char *long_data;
-    char short_data[24];
+    char short_data[16];
   };
   uint32_t length;
 } ExternalScannerState;
@@ -129,6 +135,7 @@ typedef struct {
   bool depends_on_column: 1;
   bool is_missing : 1;
   bool is_keyword : 1;
+  bool in_arena : 1;
 
   union {
     // Non-terminal subtrees (`child_count > 0`)
@@ -168,12 +175,35 @@ typedef union {
 typedef Array(Subtree) SubtreeArray;
 typedef Array(MutableSubtree) MutableSubtreeArray;
 
+// A chunked bump allocator for heap subtrees.
+//
+// When a parser is in arena mode, the heap data and child arrays of the
+// subtrees that it creates are carved out of large chunks instead of being
+// allocated one at a time. Arena subtrees are still reference counted, but
+// their memory is only returned to the system when the entire arena is freed.
+// Every tree retains the arenas that its nodes live in.
+typedef struct {
+  Array(char *) chunks;
+  char *next;
+  size_t remaining;
+  volatile uint32_t ref_count;
+
+  // Whether any subtree in this arena holds a reference to a heap subtree that
+  // is *not* arena-allocated. Trees that only reference clean arenas can be
+  // deleted without visiting their arena nodes.
+  bool has_foreign_references;
+} SubtreeArena;
+
+typedef Array(SubtreeArena *) SubtreeArenaArray;
+
 typedef struct {
   MutableSubtreeArray free_trees;
   MutableSubtreeArray tree_stack;
+  SubtreeArena *arena;
 } SubtreePool;
 
-void ts_external_scanner_state_init(ExternalScannerState *, const char *, unsigned);
+void ts_external_scanner_state_init(ExternalScannerState *, SubtreeArena *, const char *, unsigned);
+void ts_external_scanner_state_init_shared(ExternalScannerState *, SubtreeArena *, Subtree);
 const char *ts_external_scanner_state_data(const ExternalScannerState *);
 bool ts_external_scanner_state_eq(const ExternalScannerState *self, const char *, unsigned);
 void ts_external_scanner_state_delete(ExternalScannerState *self);
@@ -187,6 +217,12 @@ void ts_subtree_array_reverse(SubtreeArray *);
 SubtreePool ts_subtree_pool_new(uint32_t capacity);
 void ts_subtree_pool_delete(SubtreePool *);
 
+SubtreeArena *ts_subtree_arena_new(void);
+void ts_subtree_arena_retain(SubtreeArena *);
+void ts_subtree_arena_release(SubtreeArena *);
+void ts_subtree_arena_array_add(SubtreeArenaArray *, SubtreeArena *);
+void ts_subtree_arena_array_delete(SubtreeArenaArray *);
+
 Subtree ts_subtree_new_leaf(
   SubtreePool *, TSSymbol, Length, Length, uint32_t,
   TSStateId, bool, bool, bool, const TSLanguage *
@@ -194,19 +230,27 @@ Subtree ts_subtree_new_leaf(
 Subtree ts_subtree_new_error(
   SubtreePool *, int32_t, Length, Length, uint32_t, TSStateId, const TSLanguage *
 );
-MutableSubtree ts_subtree_new_node(TSSymbol, SubtreeArray *, unsigned, const TSLanguage *);
-Subtree ts_subtree_new_error_node(SubtreeArray *, bool, const TSLanguage *);
+MutableSubtree ts_subtree_new_node(SubtreePool *, TSSymbol, SubtreeArray *, unsigned, const TSLanguage *);
+MutableSubtree ts_subtree_arena_new_node(SubtreeArena *, uint32_t);
+Subtree ts_subtree_new_error_node(SubtreePool *, SubtreeArray *, bool, const TSLanguage *);
 Subtree ts_subtree_new_missing_leaf(SubtreePool *, TSSymbol, Length, uint32_t, const TSLanguage *);
+Subtree ts_subtree_new_placeholder(SubtreePool *, Subtree, const TSLanguage *);
 MutableSubtree ts_subtree_make_mut(SubtreePool *, Subtree);
 void ts_subtree_retain(Subtree);
 void ts_subtree_release(SubtreePool *, Subtree);
+void ts_subtree_release_outside_arenas(SubtreePool *, Subtree);
+void ts_subtree_release_start(SubtreePool *, Subtree, bool skip_arena_subtrees);
+uint32_t ts_subtree_release_step(SubtreePool *, bool skip_arena_subtrees, uint32_t max_count);
 int ts_subtree_compare(Subtree, Subtree, SubtreePool *);
+size_t ts_subtree_shared_memory_usage(const Subtree *, uint32_t, size_t *);
 void ts_subtree_set_symbol(MutableSubtree *, TSSymbol, const TSLanguage *);
 void ts_subtree_summarize(MutableSubtree, const Subtree *, uint32_t, const TSLanguage *);
 void ts_subtree_summarize_children(MutableSubtree, const TSLanguage *);
 void ts_subtree_balance(Subtree, SubtreePool *, const TSLanguage *);
-Subtree ts_subtree_edit(Subtree, const TSInputEdit *edit, SubtreePool *);
+Subtree ts_subtree_edit(Subtree, const TSInputEdit *edits, uint32_t count, SubtreePool *);
+Subtree ts_subtree_invalidate(Subtree, uint32_t start_byte, uint32_t end_byte, SubtreePool *);
 char *ts_subtree_string(Subtree, TSSymbol, bool, const TSLanguage *, bool include_all);
+void ts_subtree_write_string(Subtree, TSSymbol, bool, Length, const TSLanguage *, bool include_all, TSNodeStringFormat, TSStringWriter);
 void ts_subtree_print_dot_graph(Subtree, const TSLanguage *, FILE *);
 Subtree ts_subtree_last_external_token(Subtree);
 const ExternalScannerState *ts_subtree_external_scanner_state(Subtree self);
@@ -2,8 +2,11 @@
 
 #include "tree_sitter/api.h"
 #include "./array.h"
+#include "./atomic.h"
 #include "./get_changed_ranges.h"
+#include "./language.h"
 #include "./length.h"
+#include "./serialization.h"
 #include "./subtree.h"
 #include "./tree_cursor.h"
 #include "./tree.h"
@@ -13,30 +16,452 @@ TSTree *ts_tree_new(
   const TSRange *included_ranges, unsigned included_range_count
 ) {
   TSTree *result = ts_malloc(sizeof(TSTree));
+  result->allocator = ts_allocator_current();
   result->root = root;
   result->language = ts_language_copy(language);
   result->included_ranges = ts_calloc(included_range_count, sizeof(TSRange));
-  memcpy(result->included_ranges, included_ranges, included_range_count * sizeof(TSRange));
+  if (included_range_count > 0) {
+    memcpy(result->included_ranges, included_ranges, included_range_count * sizeof(TSRange));
+  }
   result->included_range_count = included_range_count;
+  array_init(&result->arenas);
+  result->parent_index = NULL;
+  result->parent_index_enabled = false;
+  return result;
+}
+
+void ts_tree_add_arenas(TSTree *self, const SubtreeArenaArray *arenas) {
+  for (uint32_t i = 0; i < arenas->size; i++) {
+    ts_subtree_arena_array_add(&self->arenas, arenas->contents[i]);
+  }
+}
+
+// The number of children at and above which a node's child offsets are
+// recorded in the parent index.
+#define TS_TREE_WIDE_NODE_CHILD_COUNT 32
+
+typedef struct {
+  const Subtree *slot;
+  Subtree subtree;
+  Length position;
+  TSSymbol alias_symbol;
+} ParentIndexStackEntry;
+
+static inline uint32_t ts_tree__parent_index_hash(const Subtree *child, uint32_t start_byte) {
+  uint64_t hash = ((uint64_t)(uintptr_t)child >> 3) ^ ((uint64_t)start_byte * 0x9E3779B97F4A7C15ULL);
+  hash ^= hash >> 29;
+  hash *= 0xBF58476D1CE4E5B9ULL;
+  hash ^= hash >> 32;
+  return (uint32_t)hash;
+}
+
+static ParentIndex *ts_tree__parent_index_new(const TSTree *self) {
+  ParentIndex *result = ts_malloc(sizeof(ParentIndex));
+  array_init(&result->entries);
+  array_init(&result->child_offsets);
+  array_init(&result->wide_nodes);
+  result->ref_count = 1;
+
+  // Visit every subtree, recording the parent and position of each child. The
+  // root's children record a `NULL` parent, which stands for the tree's own
+  // root slot.
+  Array(ParentIndexStackEntry) stack = array_new();
+  array_push(&stack, ((ParentIndexStackEntry) {
+    .slot = NULL,
+    .subtree = self->root,
+    .position = ts_subtree_padding(self->root),
+    .alias_symbol = 0,
+  }));
+  while (stack.size > 0) {
+    ParentIndexStackEntry entry = array_pop(&stack);
+    if (ts_subtree_child_count(entry.subtree) == 0) continue;
+    const Subtree *children = ts_subtree_children(entry.subtree);
+    const TSSymbol *alias_sequence = ts_language_alias_sequence(
+      self->language,
+      entry.subtree.ptr->production_id
+    );
+    Length position = entry.position;
+    uint32_t structural_child_index = 0;
+
+    // For nodes with many children, also record each child's offset within
+    // the node, along with the counts that a child iterator would have
+    // accumulated upon reaching it.
+    bool is_wide = entry.subtree.ptr->child_count >= TS_TREE_WIDE_NODE_CHILD_COUNT;
+    Length relative_position = length_zero();
+    uint32_t descendant_index = 0, visible_child_index = 0;
+    if (is_wide) {
+      array_push(&result->wide_nodes, ((WideNodeEntry) {children, result->child_offsets.size}));
+    }
+
+    for (uint32_t i = 0, n = entry.subtree.ptr->child_count; i < n; i++) {
+      const Subtree *child = &children[i];
+      if (i > 0) position = length_add(position, ts_subtree_padding(*child));
+      if (is_wide) {
+        if (i > 0) relative_position = length_add(relative_position, ts_subtree_padding(*child));
+        array_push(&result->child_offsets, ((ChildOffsetEntry) {
+          .position = relative_position,
+          .structural_child_index = structural_child_index,
+          .descendant_index = descendant_index,
+          .visible_child_index = visible_child_index,
+        }));
+        bool visible = ts_subtree_visible(*child);
+        if (!ts_subtree_extra(*child) && alias_sequence) {
+          visible |= alias_sequence[structural_child_index] != 0;
+        }
+        descendant_index += ts_subtree_visible_descendant_count(*child) + (visible ? 1 : 0);
+        visible_child_index += visible ? 1 : ts_subtree_visible_child_count(*child);
+        relative_position = length_add(relative_position, ts_subtree_size(*child));
+      }
+      array_push(&result->entries, ((ParentCacheEntry) {
+        .child = child,
+        .parent = entry.slot,
+        .position = entry.position,
+        .child_start_byte = position.bytes,
+        .child_index = i,
+        .structural_child_index = structural_child_index,
+        .alias_symbol = entry.alias_symbol,
+      }));
+      TSSymbol alias_symbol = 0;
+      if (!ts_subtree_extra(*child)) {
+        if (alias_sequence) alias_symbol = alias_sequence[structural_child_index];
+        structural_child_index++;
+      }
+      if (ts_subtree_child_count(*child) > 0) {
+        array_push(&stack, ((ParentIndexStackEntry) {
+          .slot = child,
+          .subtree = *child,
+          .position = position,
+          .alias_symbol = alias_symbol,
+        }));
+      }
+      position = length_add(position, ts_subtree_size(*child));
+    }
+  }
+  array_delete(&stack);
+
+  // Build an open-addressing table of entry indices, kept at most half full.
+  uint32_t slot_count = 8;
+  while (slot_count < result->entries.size * 2) slot_count *= 2;
+  result->slots = ts_calloc(slot_count, sizeof(uint32_t));
+  result->slot_mask = slot_count - 1;
+  for (uint32_t i = 0; i < result->entries.size; i++) {
+    const ParentCacheEntry *entry = &result->entries.contents[i];
+    uint32_t slot = ts_tree__parent_index_hash(entry->child, entry->child_start_byte);
+    for (;;) {
+      slot &= result->slot_mask;
+      if (!result->slots[slot]) {
+        result->slots[slot] = i + 1;
+        break;
+      }
+      slot++;
+    }
+  }
+
+  slot_count = 8;
+  while (slot_count < result->wide_nodes.size * 2) slot_count *= 2;
+  result->wide_node_slots = ts_calloc(slot_count, sizeof(uint32_t));
+  result->wide_node_slot_mask = slot_count - 1;
+  for (uint32_t i = 0; i < result->wide_nodes.size; i++) {
+    uint32_t slot = ts_tree__parent_index_hash(result->wide_nodes.contents[i].children, 0);
+    for (;;) {
+      slot &= result->wide_node_slot_mask;
+      if (!result->wide_node_slots[slot]) {
+        result->wide_node_slots[slot] = i + 1;
+        break;
+      }
+      slot++;
+    }
+  }
+
   return result;
 }
 
+static void ts_tree__parent_index_release(ParentIndex *self) {
+  if (atomic_dec(&self->ref_count) == 0) {
+    array_delete(&self->entries);
+    array_delete(&self->child_offsets);
+    array_delete(&self->wide_nodes);
+    ts_free(self->slots);
+    ts_free(self->wide_node_slots);
+    ts_free(self);
+  }
+}
+
+static void ts_tree__clear_parent_index(TSTree *self) {
+  if (self->parent_index) {
+    ts_tree__parent_index_release(self->parent_index);
+    self->parent_index = NULL;
+  }
+}
+
+static const ParentIndex *ts_tree__parent_index(const TSTree *self) {
+  // The index is built on first use. Trees may be read concurrently, so the
+  // index is published with a compare-and-swap, and a thread that loses the race
+  // discards its own copy.
+  ParentIndex *index = atomic_load_ptr((void *const volatile *)&self->parent_index);
+  if (!index) {
+    const TSAllocator *previous_allocator = ts_allocator_push(&self->allocator);
+    index = ts_tree__parent_index_new(self);
+    void *volatile *location = (void *volatile *)&((TSTree *)self)->parent_index;
+    if (!atomic_compare_exchange_ptr(location, NULL, index)) {
+      ts_tree__parent_index_release(index);
+      index = atomic_load_ptr((void *const volatile *)location);
+    }
+    ts_allocator_pop(previous_allocator);
+  }
+  return index;
+}
+
+const ParentCacheEntry *ts_tree_parent_cache_entry(
+  const TSTree *self,
+  const Subtree *child,
+  uint32_t start_byte
+) {
+  if (!self->parent_index_enabled) return NULL;
+  const ParentIndex *index = ts_tree__parent_index(self);
+
+  uint32_t slot = ts_tree__parent_index_hash(child, start_byte);
+  for (;;) {
+    slot &= index->slot_mask;
+    uint32_t entry_index = index->slots[slot];
+    if (!entry_index) return NULL;
+    const ParentCacheEntry *entry = &index->entries.contents[entry_index - 1];
+    if (entry->child == child && entry->child_start_byte == start_byte) return entry;
+    slot++;
+  }
+}
+
+// Get the offsets of the children of a node with many children, or `NULL` if
+// the node has few children or the tree's parent index is disabled, in which
+// case the children have to be walked.
+const ChildOffsetEntry *ts_tree_child_offsets(const TSTree *self, Subtree parent) {
+  if (
+    !self->parent_index_enabled ||
+    ts_subtree_child_count(parent) < TS_TREE_WIDE_NODE_CHILD_COUNT
+  ) return NULL;
+  const ParentIndex *index = ts_tree__parent_index(self);
+
+  const Subtree *children = ts_subtree_children(parent);
+  uint32_t slot = ts_tree__parent_index_hash(children, 0);
+  for (;;) {
+    slot &= index->wide_node_slot_mask;
+    uint32_t entry_index = index->wide_node_slots[slot];
+    if (!entry_index) return NULL;
+    const WideNodeEntry *entry = &index->wide_nodes.contents[entry_index - 1];
+    if (entry->children == children) return &index->child_offsets.contents[entry->offset];
+    slot++;
+  }
+}
+
+// Find the first child of the given node, which starts at the given position,
+// that ends at or after both the goal byte and the goal point.
+uint32_t ts_tree_child_offsets_search(
+  const ChildOffsetEntry *offsets,
+  Subtree parent,
+  Length position,
+  uint32_t goal_byte,
+  TSPoint goal_point
+) {
+  const Subtree *children = ts_subtree_children(parent);
+  uint32_t lo = 0, hi = parent.ptr->child_count;
+  while (lo < hi) {
+    uint32_t mid = lo + (hi - lo) / 2;
+    Length end = length_add(
+      length_add(position, offsets[mid].position),
+      ts_subtree_size(children[mid])
+    );
+    if (end.bytes >= goal_byte && point_gte(end.extent, goal_point)) {
+      hi = mid;
+    } else {
+      lo = mid + 1;
+    }
+  }
+  return lo;
+}
+
+// Find the first child of the given node that is preceded by at least the given
+// number of structural children, i.e. children that aren't extras.
+uint32_t ts_tree_child_offsets_search_structural(
+  const ChildOffsetEntry *offsets,
+  Subtree parent,
+  uint32_t structural_child_index
+) {
+  uint32_t lo = 0, hi = parent.ptr->child_count;
+  while (lo < hi) {
+    uint32_t mid = lo + (hi - lo) / 2;
+    if (offsets[mid].structural_child_index >= structural_child_index) {
+      hi = mid;
+    } else {
+      lo = mid + 1;
+    }
+  }
+  return lo;
+}
+
+void ts_tree_set_parent_index_enabled(TSTree *self, bool enabled) {
+  self->parent_index_enabled = enabled;
+  if (!enabled) {
+    const TSAllocator *previous_allocator = ts_allocator_push(&self->allocator);
+    ts_tree__clear_parent_index(self);
+    ts_allocator_pop(previous_allocator);
+  }
+}
+
+bool ts_tree_parent_index_enabled(const TSTree *self) {
+  return self->parent_index_enabled;
+}
+
+const TSTree *ts_tree_freeze(TSTree *self) {
+  // Build everything that would otherwise be built lazily by the tree's first
+  // reader, so that reading a frozen tree never writes to shared memory.
+  if (self->parent_index_enabled && !self->parent_index) {
+    const TSAllocator *previous_allocator = ts_allocator_push(&self->allocator);
+    self->parent_index = ts_tree__parent_index_new(self);
+    ts_allocator_pop(previous_allocator);
+  }
+  return self;
+}
+
 TSTree *ts_tree_copy(const TSTree *self) {
+  const TSAllocator *previous_allocator = ts_allocator_push(&self->allocator);
   ts_subtree_retain(self->root);
-  return ts_tree_new(self->root, self->language, self->included_ranges, self->included_range_count);
+  TSTree *result = ts_tree_new(self->root, self->language, self->included_ranges, self->included_range_count);
+  ts_tree_add_arenas(result, &self->arenas);
+  result->parent_index_enabled = self->parent_index_enabled;
+  ParentIndex *parent_index = atomic_load_ptr((void *const volatile *)&self->parent_index);
+  if (parent_index) {
+    atomic_inc(&parent_index->ref_count);
+    result->parent_index = parent_index;
+  }
+  ts_allocator_pop(previous_allocator);
+  return result;
 }
 
-void ts_tree_delete(TSTree *self) {
-  if (!self) return;
+// Find the end of the first external token in the given subtree. If it has no
+// external tokens, return the end of the subtree.
+static uint32_t ts_tree__first_external_token_end(Subtree tree) {
+  if (!ts_subtree_has_external_tokens(tree)) return ts_subtree_total_bytes(tree);
+  uint32_t offset = 0;
+  while (ts_subtree_child_count(tree) > 0) {
+    for (uint32_t i = 0, n = ts_subtree_child_count(tree); i < n; i++) {
+      Subtree child = ts_subtree_children(tree)[i];
+      if (ts_subtree_has_external_tokens(child)) {
+        tree = child;
+        break;
+      }
+      offset += ts_subtree_total_bytes(child);
+    }
+  }
+  return offset + ts_subtree_total_bytes(tree);
+}
 
+TSTree *ts_tree_concat(const TSTree *const *trees, uint32_t count) {
+  if (count == 0) return NULL;
+  const TSLanguage *language = trees[0]->language;
+  for (uint32_t i = 1; i < count; i++) {
+    if (
+      trees[i]->language != language ||
+      !ts_allocator_eq(&trees[i]->allocator, &trees[0]->allocator)
+    ) return NULL;
+  }
+
+  const TSAllocator *previous_allocator = ts_allocator_push(&trees[0]->allocator);
   SubtreePool pool = ts_subtree_pool_new(0);
-  ts_subtree_release(&pool, self->root);
+  SubtreeArray children = array_new();
+  for (uint32_t i = 0; i < count; i++) {
+    Subtree root = trees[i]->root;
+    uint32_t child_count = ts_subtree_child_count(root);
+    if (child_count == 0) {
+      ts_subtree_retain(root);
+      array_push(&children, root);
+      continue;
+    }
+    const Subtree *root_children = ts_subtree_children(root);
+    for (uint32_t j = 0; j < child_count; j++) {
+      ts_subtree_retain(root_children[j]);
+    }
+    array_extend(&children, child_count, root_children);
+  }
+
+  Subtree root = ts_subtree_from_mut(ts_subtree_new_node(
+    &pool,
+    ts_subtree_symbol(trees[0]->root),
+    &children,
+    0,
+    language
+  ));
+
+  // Each tree was parsed without seeing the text that surrounds it, so the
+  // nodes that touch a boundary between two trees can't be reused.
+  uint32_t offset = 0;
+  Subtree last_external_token = NULL_SUBTREE;
+  for (uint32_t i = 0; i + 1 < count; i++) {
+    offset += ts_subtree_total_bytes(trees[i]->root);
+    Subtree external_token = ts_subtree_last_external_token(trees[i]->root);
+    if (external_token.ptr) last_external_token = external_token;
+
+    // The next tree was parsed with the external scanner in its initial state.
+    // If the preceding text leaves the scanner in a different state, then none
+    // of the next tree's nodes can be reused until its first external token.
+    uint32_t end_byte = offset;
+    if (!ts_subtree_external_scanner_state_eq(last_external_token, NULL_SUBTREE)) {
+      end_byte += ts_tree__first_external_token_end(trees[i + 1]->root);
+    }
+    root = ts_subtree_invalidate(root, offset, end_byte, &pool);
+  }
   ts_subtree_pool_delete(&pool);
+
+  TSRange included_range = {
+    .start_point = {0, 0},
+    .end_point = POINT_MAX,
+    .start_byte = 0,
+    .end_byte = UINT32_MAX,
+  };
+  TSTree *result = ts_tree_new(root, language, &included_range, 1);
+  for (uint32_t i = 0; i < count; i++) {
+    ts_tree_add_arenas(result, &trees[i]->arenas);
+  }
+  ts_allocator_pop(previous_allocator);
+  return result;
+}
+
+// If none of the tree's arenas refer to any individually-allocated subtrees,
+// then the arena subtrees don't need to be visited: their memory is owned
+// by the arenas, which are freed in bulk once no other tree retains them.
+static bool ts_tree__can_release_in_bulk(const TSTree *self) {
+  if (self->arenas.size == 0) return false;
+  for (uint32_t i = 0; i < self->arenas.size; i++) {
+    if (self->arenas.contents[i]->has_foreign_references) return false;
+  }
+  return true;
+}
+
+// Free the memory owned by the tree itself, once its reference to its root
+// subtree has been released. The tree's allocator must be current.
+static void ts_tree__free(TSTree *self) {
+  ts_subtree_arena_array_delete(&self->arenas);
+  ts_tree__clear_parent_index(self);
   ts_language_delete(self->language);
   ts_free(self->included_ranges);
   ts_free(self);
 }
 
+void ts_tree_delete(TSTree *self) {
+  if (!self) return;
+
+  TSAllocator allocator = self->allocator;
+  const TSAllocator *previous_allocator = ts_allocator_push(&allocator);
+  SubtreePool pool = ts_subtree_pool_new(0);
+  if (ts_tree__can_release_in_bulk(self)) {
+    ts_subtree_release_outside_arenas(&pool, self->root);
+  } else {
+    ts_subtree_release(&pool, self->root);
+  }
+  ts_subtree_pool_delete(&pool);
+  ts_tree__free(self);
+  ts_allocator_pop(previous_allocator);
+}
+
 TSNode ts_tree_root_node(const TSTree *self) {
   return ts_node_new(self, &self->root, ts_subtree_padding(self->root), 0);
 }
@@ -54,7 +479,7 @@ const TSLanguage *ts_tree_language(const TSTree *self) {
   return self->language;
 }
 
-void ts_tree_edit(TSTree *self, const TSInputEdit *edit) {
+static void ts_tree__edit_included_ranges(TSTree *self, const TSInputEdit *edit) {
   for (unsigned i = 0; i < self->included_range_count; i++) {
     TSRange *range = &self->included_ranges[i];
     if (range->end_byte >= edit->old_end_byte) {
@@ -88,10 +513,64 @@ void ts_tree_edit(TSTree *self, const TSInputEdit *edit) {
       range->start_point = edit->start_point;
     }
   }
+}
+
+// Map a position in a document to its position after the given edit. Positions
+// within the removed text move to the start of the edit.
+static void ts_tree__edit_position(const TSInputEdit *edit, uint32_t *byte, TSPoint *point) {
+  if (*byte >= edit->old_end_byte) {
+    *byte = edit->new_end_byte + (*byte - edit->old_end_byte);
+    *point = point_add(edit->new_end_point, point_sub(*point, edit->old_end_point));
+  } else if (*byte > edit->start_byte) {
+    *byte = edit->start_byte;
+    *point = edit->start_point;
+  }
+}
 
+void ts_tree_edit(TSTree *self, const TSInputEdit *edit) {
+  ts_tree_edit_batch(self, edit, 1, NULL);
+}
+
+void ts_tree_edit_batch(
+  TSTree *self,
+  const TSInputEdit *edits,
+  uint32_t count,
+  TSRange *changed_range
+) {
+  TSRange range = {POINT_ZERO, POINT_ZERO, 0, 0};
+  for (uint32_t i = 0; i < count; i++) {
+    const TSInputEdit *edit = &edits[i];
+    ts_tree__edit_included_ranges(self, edit);
+
+    // Keep the union of the edited regions up to date with each edit, in the
+    // coordinates of the document after that edit.
+    if (i == 0) {
+      range.start_byte = edit->start_byte;
+      range.start_point = edit->start_point;
+      range.end_byte = edit->new_end_byte;
+      range.end_point = edit->new_end_point;
+    } else {
+      ts_tree__edit_position(edit, &range.start_byte, &range.start_point);
+      ts_tree__edit_position(edit, &range.end_byte, &range.end_point);
+      if (edit->start_byte < range.start_byte) {
+        range.start_byte = edit->start_byte;
+        range.start_point = edit->start_point;
+      }
+      if (edit->new_end_byte > range.end_byte) {
+        range.end_byte = edit->new_end_byte;
+        range.end_point = edit->new_end_point;
+      }
+    }
+  }
+  if (changed_range) *changed_range = range;
+  if (count == 0) return;
+
+  const TSAllocator *previous_allocator = ts_allocator_push(&self->allocator);
   SubtreePool pool = ts_subtree_pool_new(0);
-  self->root = ts_subtree_edit(self->root, edit, &pool);
+  self->root = ts_subtree_edit(self->root, edits, count, &pool);
   ts_subtree_pool_delete(&pool);
+  ts_tree__clear_parent_index(self);
+  ts_allocator_pop(previous_allocator);
 }
 
 TSRange *ts_tree_included_ranges(const TSTree *self, uint32_t *length) {
@@ -101,7 +580,11 @@ TSRange *ts_tree_included_ranges(const TSTree *self, uint32_t *length) {
   return ranges;
 }
 
-TSRange *ts_tree_get_changed_ranges(const TSTree *old_tree, const TSTree *new_tree, uint32_t *length) {
+static void ts_tree__get_changed_ranges(
+  const TSTree *old_tree,
+  const TSTree *new_tree,
+  ChangedRangeBuffer *ranges
+) {
   TreeCursor cursor1 = {NULL, array_new(), 0};
   TreeCursor cursor2 = {NULL, array_new(), 0};
   ts_tree_cursor_init(&cursor1, ts_tree_root_node(old_tree));
@@ -114,15 +597,609 @@ TSRange *ts_tree_get_changed_ranges(const TSTree *old_tree, const TSTree *new_tr
     &included_range_differences
   );
 
-  TSRange *result;
-  *length = ts_subtree_get_changed_ranges(
+  ts_subtree_get_changed_ranges(
     &old_tree->root, &new_tree->root, &cursor1, &cursor2,
-    old_tree->language, &included_range_differences, &result
+    old_tree->language, &included_range_differences, ranges
   );
 
   array_delete(&included_range_differences);
   array_delete(&cursor1.stack);
   array_delete(&cursor2.stack);
+}
+
+TSRange *ts_tree_get_changed_ranges(const TSTree *old_tree, const TSTree *new_tree, uint32_t *length) {
+  ChangedRangeBuffer ranges = {.contents = NULL, .capacity = 0, .count = 0, .can_grow = true};
+  ts_tree__get_changed_ranges(old_tree, new_tree, &ranges);
+  *length = ranges.count;
+  return ranges.contents;
+}
+
+uint32_t ts_tree_get_changed_ranges_into(
+  const TSTree *old_tree,
+  const TSTree *new_tree,
+  TSRange *ranges,
+  uint32_t capacity
+) {
+  ChangedRangeBuffer buffer = {.contents = ranges, .capacity = capacity, .count = 0, .can_grow = false};
+  ts_tree__get_changed_ranges(old_tree, new_tree, &buffer);
+  return buffer.count;
+}
+
+// Serialization
+//
+// A serialized tree is a flat, position-independent byte buffer, so that it can
+// be written to disk and later read straight out of a memory-mapped file. It
+// starts with a header of little-endian 32-bit words:
+//
+//   magic, format version, language fingerprint, node count, range count
+//
+// This is followed by the tree's included ranges, and then by one record for
+// each distinct subtree, in post-order, ending with the root. Every other
+// integer is stored as a LEB128 varint. Parent records refer to each child by
+// the distance back to that child's record, so subtrees that are shared within
+// the tree are only written once.
+
+#define TS_SERIALIZED_TREE_MAGIC 0x52545354
+#define TS_SERIALIZED_TREE_VERSION 1
+#define TS_SERIALIZED_TREE_HEADER_SIZE 20
+
+typedef struct {
+  Subtree subtree;
+  uint32_t child_index;
+} SerializationStackEntry;
+
+typedef struct {
+  const SubtreeHeapData *subtree;
+  uint32_t index;
+} SerializedSubtreeEntry;
+
+typedef struct {
+  SerializedSubtreeEntry *slots;
+  uint32_t capacity;
+  uint32_t size;
+} SerializedSubtreeMap;
+
+enum {
+  SerializedSubtreeInline = 0,
+  SerializedSubtreeHeap = 1,
+};
+
+static inline uint32_t ts_tree__serialized_subtree_hash(const SubtreeHeapData *subtree) {
+  return (uint32_t)(((uintptr_t)subtree >> 3) * 2654435761u);
+}
+
+static uint32_t *ts_tree__serialized_subtree_find(
+  const SerializedSubtreeMap *self,
+  const SubtreeHeapData *subtree
+) {
+  if (self->capacity == 0) return NULL;
+  uint32_t mask = self->capacity - 1;
+  for (uint32_t i = ts_tree__serialized_subtree_hash(subtree) & mask;; i = (i + 1) & mask) {
+    SerializedSubtreeEntry *entry = &self->slots[i];
+    if (!entry->subtree) return NULL;
+    if (entry->subtree == subtree) return &entry->index;
+  }
+}
+
+static void ts_tree__serialized_subtree_insert(
+  SerializedSubtreeMap *self,
+  const SubtreeHeapData *subtree,
+  uint32_t index
+) {
+  if ((self->size + 1) * 2 > self->capacity) {
+    SerializedSubtreeMap grown = {
+      .slots = ts_calloc(self->capacity ? self->capacity * 2 : 64, sizeof(SerializedSubtreeEntry)),
+      .capacity = self->capacity ? self->capacity * 2 : 64,
+      .size = 0,
+    };
+    for (uint32_t i = 0; i < self->capacity; i++) {
+      SerializedSubtreeEntry *entry = &self->slots[i];
+      if (entry->subtree) ts_tree__serialized_subtree_insert(&grown, entry->subtree, entry->index);
+    }
+    ts_free(self->slots);
+    *self = grown;
+  }
+
+  uint32_t mask = self->capacity - 1;
+  uint32_t i = ts_tree__serialized_subtree_hash(subtree) & mask;
+  while (self->slots[i].subtree) i = (i + 1) & mask;
+  self->slots[i] = (SerializedSubtreeEntry) {subtree, index};
+  self->size++;
+}
+
+static inline void ts_tree__write_length(SerializationBuffer *self, Length length) {
+  serialization_write_varint(self, length.bytes);
+  serialization_write_varint(self, length.extent.row);
+  serialization_write_varint(self, length.extent.column);
+}
+
+static inline Length ts_tree__read_length(SerializationReader *self) {
+  Length result;
+  result.bytes = serialization_read_varint(self);
+  result.extent.row = serialization_read_varint(self);
+  result.extent.column = serialization_read_varint(self);
+  return result;
+}
+
+static inline TSSymbol ts_tree__read_symbol(SerializationReader *self, const TSLanguage *language) {
+  uint32_t symbol = serialization_read_varint(self);
+  if (
+    symbol >= ts_language_symbol_count(language) &&
+    symbol != ts_builtin_sym_error &&
+    symbol != ts_builtin_sym_error_repeat
+  ) self->failed = true;
+  return (TSSymbol)symbol;
+}
+
+static inline TSStateId ts_tree__read_state(SerializationReader *self, const TSLanguage *language) {
+  uint32_t state = serialization_read_varint(self);
+  if (state >= language->state_count && state != TS_TREE_STATE_NONE) self->failed = true;
+  return (TSStateId)state;
+}
+
+// Check that a deserialized node's child counts are consistent with its
+// children, and that its production has room for an alias of each of its
+// structural children. Nodes are navigated using these counts, so they can't
+// be trusted from the serialized data.
+static bool ts_tree__check_child_counts(Subtree tree, const TSLanguage *language) {
+  const SubtreeHeapData *data = tree.ptr;
+  const TSSymbol *alias_sequence = ts_language_alias_sequence(language, data->production_id);
+  uint32_t structural_index = 0;
+  uint64_t visible_child_count = 0, named_child_count = 0, visible_descendant_count = 0;
+
+  const Subtree *children = ts_subtree_children(tree);
+  for (uint32_t i = 0; i < data->child_count; i++) {
+    Subtree child = children[i];
+    bool is_extra = ts_subtree_extra(child);
+    if (!is_extra && alias_sequence && structural_index >= language->max_alias_sequence_length) {
+      return false;
+    }
+
+    visible_descendant_count += ts_subtree_visible_descendant_count(child);
+    if (!is_extra && alias_sequence && alias_sequence[structural_index] != 0) {
+      visible_descendant_count++;
+      visible_child_count++;
+      if (ts_language_symbol_metadata(language, alias_sequence[structural_index]).named) {
+        named_child_count++;
+      }
+    } else if (ts_subtree_visible(child)) {
+      visible_descendant_count++;
+      visible_child_count++;
+      if (ts_subtree_named(child)) named_child_count++;
+    } else if (ts_subtree_child_count(child) > 0) {
+      visible_child_count += child.ptr->visible_child_count;
+      named_child_count += child.ptr->named_child_count;
+    }
+
+    if (!is_extra) structural_index++;
+  }
+
+  return
+    visible_child_count == data->visible_child_count &&
+    named_child_count == data->named_child_count &&
+    visible_descendant_count == data->visible_descendant_count;
+}
+
+static void ts_tree__write_subtree(
+  SerializationBuffer *self,
+  Subtree tree,
+  uint32_t index,
+  const uint32_t *child_indices
+) {
+  if (tree.data.is_inline) {
+    uint32_t flags =
+      tree.data.visible << 0 |
+      tree.data.named << 1 |
+      tree.data.extra << 2 |
+      tree.data.has_changes << 3 |
+      tree.data.is_missing << 4 |
+      tree.data.is_keyword << 5;
+    serialization_write_varint(self, flags << 1 | SerializedSubtreeInline);
+    serialization_write_varint(self, tree.data.symbol);
+    serialization_write_varint(self, tree.data.parse_state);
+    serialization_write_varint(self, tree.data.padding_bytes);
+    serialization_write_varint(self, tree.data.padding_rows);
+    serialization_write_varint(self, tree.data.padding_columns);
+    serialization_write_varint(self, tree.data.size_bytes);
+    serialization_write_varint(self, tree.data.lookahead_bytes);
+    return;
+  }
+
+  const SubtreeHeapData *data = tree.ptr;
+  uint32_t flags =
+    data->visible << 0 |
+    data->named << 1 |
+    data->extra << 2 |
+    data->fragile_left << 3 |
+    data->fragile_right << 4 |
+    data->has_changes << 5 |
+    data->has_external_tokens << 6 |
+    data->has_external_scanner_state_change << 7 |
+    data->depends_on_column << 8 |
+    data->is_missing << 9 |
+    data->is_keyword << 10;
+  serialization_write_varint(self, flags << 1 | SerializedSubtreeHeap);
+  serialization_write_varint(self, data->symbol);
+  serialization_write_varint(self, data->parse_state);
+  ts_tree__write_length(self, data->padding);
+  ts_tree__write_length(self, data->size);
+  serialization_write_varint(self, data->lookahead_bytes);
+  serialization_write_varint(self, data->error_cost);
+  serialization_write_varint(self, data->child_count);
+
+  if (data->child_count > 0) {
+    for (uint32_t i = 0; i < data->child_count; i++) {
+      serialization_write_varint(self, index - child_indices[i]);
+    }
+    serialization_write_varint(self, data->visible_child_count);
+    serialization_write_varint(self, data->named_child_count);
+    serialization_write_varint(self, data->visible_descendant_count);
+    serialization_write_signed_varint(self, data->dynamic_precedence);
+    serialization_write_varint(self, data->repeat_depth);
+    serialization_write_varint(self, data->production_id);
+    serialization_write_varint(self, data->first_leaf.symbol);
+    serialization_write_varint(self, data->first_leaf.parse_state);
+  } else if (data->has_external_tokens) {
+    const ExternalScannerState *state = &data->external_scanner_state;
+    serialization_write_varint(self, state->length);
+    array_extend(self, state->length, (const uint8_t *)ts_external_scanner_state_data(state));
+  } else if (data->symbol == ts_builtin_sym_error) {
+    serialization_write_signed_varint(self, data->lookahead_char);
+  }
+}
+
+static Subtree ts_tree__read_subtree(
+  SerializationReader *self,
+  SubtreeArena *arena,
+  const TSLanguage *language,
+  const Subtree *nodes,
+  uint32_t index
+) {
+  uint32_t header = serialization_read_varint(self);
+  uint32_t flags = header >> 1;
+  TSSymbol symbol = ts_tree__read_symbol(self, language);
+  TSStateId parse_state = ts_tree__read_state(self, language);
+
+  if ((header & 1) == SerializedSubtreeInline) {
+    if (symbol > UINT8_MAX) self->failed = true;
+    Subtree result = {.data = {.is_inline = true}};
+    result.data.visible = flags & (1 << 0);
+    result.data.named = flags & (1 << 1);
+    result.data.extra = flags & (1 << 2);
+    result.data.has_changes = flags & (1 << 3);
+    result.data.is_missing = flags & (1 << 4);
+    result.data.is_keyword = flags & (1 << 5);
+    result.data.symbol = (uint8_t)symbol;
+    result.data.parse_state = parse_state;
+    result.data.padding_bytes = (uint8_t)serialization_read_bounded_varint(self, UINT8_MAX);
+    result.data.padding_rows = (uint8_t)serialization_read_bounded_varint(self, 0xf);
+    result.data.padding_columns = (uint8_t)serialization_read_bounded_varint(self, UINT8_MAX);
+    result.data.size_bytes = (uint8_t)serialization_read_bounded_varint(self, UINT8_MAX);
+    result.data.lookahead_bytes = (uint8_t)serialization_read_bounded_varint(self, 0xf);
+    return result;
+  }
+
+  Length padding = ts_tree__read_length(self);
+  Length size = ts_tree__read_length(self);
+  uint32_t lookahead_bytes = serialization_read_varint(self);
+  uint32_t error_cost = serialization_read_varint(self);
+
+  uint32_t child_count = serialization_read_count(self);
+  if (self->failed) return NULL_SUBTREE;
+
+  MutableSubtree result = ts_subtree_arena_new_node(arena, child_count);
+  SubtreeHeapData *data = result.ptr;
+  data->padding = padding;
+  data->size = size;
+  data->lookahead_bytes = lookahead_bytes;
+  data->error_cost = error_cost;
+  data->symbol = symbol;
+  data->parse_state = parse_state;
+  data->visible = flags & (1 << 0);
+  data->named = flags & (1 << 1);
+  data->extra = flags & (1 << 2);
+  data->fragile_left = flags & (1 << 3);
+  data->fragile_right = flags & (1 << 4);
+  data->has_changes = flags & (1 << 5);
+  data->has_external_tokens = flags & (1 << 6);
+  data->has_external_scanner_state_change = flags & (1 << 7);
+  data->depends_on_column = flags & (1 << 8);
+  data->is_missing = flags & (1 << 9);
+  data->is_keyword = flags & (1 << 10);
+
+  if (child_count > 0) {
+    Subtree *children = ts_subtree_children(result);
+    for (uint32_t i = 0; i < child_count; i++) {
+      uint32_t distance = serialization_read_varint(self);
+      if (distance == 0 || distance > index) {
+        self->failed = true;
+        break;
+      }
+      Subtree child = nodes[index - distance];
+      if (!child.data.is_inline) ((SubtreeHeapData *)child.ptr)->ref_count++;
+      children[i] = child;
+    }
+    data->visible_child_count = serialization_read_varint(self);
+    data->named_child_count = serialization_read_varint(self);
+    data->visible_descendant_count = serialization_read_varint(self);
+    data->dynamic_precedence = serialization_read_signed_varint(self);
+    data->repeat_depth = (uint16_t)serialization_read_bounded_varint(self, UINT16_MAX);
+    data->production_id = (uint16_t)serialization_read_bounded_varint(self, UINT16_MAX);
+    data->first_leaf.symbol = ts_tree__read_symbol(self, language);
+    data->first_leaf.parse_state = ts_tree__read_state(self, language);
+    if (data->production_id > 0 && data->production_id >= language->production_id_count) {
+      self->failed = true;
+    }
+    if (!self->failed && !ts_tree__check_child_counts(ts_subtree_from_mut(result), language)) {
+      self->failed = true;
+    }
+  } else if (data->has_external_tokens) {
+    uint32_t length = serialization_read_varint(self);
+    const uint8_t *state = serialization_read_bytes(self, length);
+    if (state) {
+      ts_external_scanner_state_init(&data->external_scanner_state, arena, (const char *)state, length);
+    }
+  } else if (symbol == ts_builtin_sym_error) {
+    data->lookahead_char = serialization_read_signed_varint(self);
+  }
+
+  return ts_subtree_from_mut(result);
+}
+
+char *ts_tree_serialize(const TSTree *self, uint32_t *length) {
+  SerializationBuffer buffer = array_new();
+  Array(SerializationStackEntry) stack = array_new();
+  Array(uint32_t) child_indices = array_new();
+  SerializedSubtreeMap shared_subtrees = {NULL, 0, 0};
+
+  serialization_write_uint32(&buffer, TS_SERIALIZED_TREE_MAGIC);
+  serialization_write_uint32(&buffer, TS_SERIALIZED_TREE_VERSION);
+  serialization_write_uint32(&buffer, ts_language_fingerprint(self->language));
+  serialization_write_uint32(&buffer, 0);
+  serialization_write_uint32(&buffer, self->included_range_count);
+  for (unsigned i = 0; i < self->included_range_count; i++) {
+    const TSRange *range = &self->included_ranges[i];
+    serialization_write_varint(&buffer, range->start_byte);
+    serialization_write_varint(&buffer, range->start_point.row);
+    serialization_write_varint(&buffer, range->start_point.column);
+    serialization_write_varint(&buffer, range->end_byte);
+    serialization_write_varint(&buffer, range->end_point.row);
+    serialization_write_varint(&buffer, range->end_point.column);
+  }
+
+  // Write the subtrees in post-order, so that every child's index is known by
+  // the time its parent is written. Subtrees that may be referenced from more
+  // than one place are remembered, and only written the first time.
+  uint32_t node_count = 0;
+  array_push(&stack, ((SerializationStackEntry) {self->root, 0}));
+  while (stack.size > 0) {
+    SerializationStackEntry *entry = array_back(&stack);
+    Subtree tree = entry->subtree;
+    uint32_t child_count = ts_subtree_child_count(tree);
+    if (entry->child_index < child_count) {
+      Subtree child = ts_subtree_children(tree)[entry->child_index++];
+      if (!child.data.is_inline && child.ptr->ref_count > 1) {
+        uint32_t *child_index = ts_tree__serialized_subtree_find(&shared_subtrees, child.ptr);
+        if (child_index) {
+          array_push(&child_indices, *child_index);
+          continue;
+        }
+      }
+      array_push(&stack, ((SerializationStackEntry) {child, 0}));
+      continue;
+    }
+
+    stack.size--;
+    uint32_t index = node_count++;
+    child_indices.size -= child_count;
+    ts_tree__write_subtree(&buffer, tree, index, child_indices.contents + child_indices.size);
+    if (!tree.data.is_inline && tree.ptr->ref_count > 1) {
+      ts_tree__serialized_subtree_insert(&shared_subtrees, tree.ptr, index);
+    }
+    array_push(&child_indices, index);
+  }
+
+  uint8_t *node_count_bytes = &buffer.contents[12];
+  for (unsigned i = 0; i < 4; i++) {
+    node_count_bytes[i] = (uint8_t)(node_count >> (i * 8));
+  }
+
+  ts_free(shared_subtrees.slots);
+  array_delete(&child_indices);
+  array_delete(&stack);
+  *length = buffer.size;
+  return (char *)buffer.contents;
+}
+
+TSTree *ts_tree_deserialize(const TSLanguage *language, const char *data, uint32_t length) {
+  SerializationReader reader = {
+    .data = (const uint8_t *)data,
+    .end = (const uint8_t *)data + length,
+    .failed = false,
+  };
+  if (
+    serialization_read_uint32(&reader) != TS_SERIALIZED_TREE_MAGIC ||
+    serialization_read_uint32(&reader) != TS_SERIALIZED_TREE_VERSION ||
+    serialization_read_uint32(&reader) != ts_language_fingerprint(language)
+  ) return NULL;
+
+  // Every node and range takes at least one byte, so the counts can be checked
+  // against the data's length before allocating anything.
+  uint32_t node_count = serialization_read_uint32(&reader);
+  uint32_t range_count = serialization_read_uint32(&reader);
+  if (
+    reader.failed ||
+    node_count == 0 ||
+    node_count > reader.end - reader.data ||
+    range_count > reader.end - reader.data
+  ) return NULL;
+
+  TSRange *ranges = ts_calloc(range_count, sizeof(TSRange));
+  for (uint32_t i = 0; i < range_count; i++) {
+    TSRange *range = &ranges[i];
+    range->start_byte = serialization_read_varint(&reader);
+    range->start_point.row = serialization_read_varint(&reader);
+    range->start_point.column = serialization_read_varint(&reader);
+    range->end_byte = serialization_read_varint(&reader);
+    range->end_point.row = serialization_read_varint(&reader);
+    range->end_point.column = serialization_read_varint(&reader);
+  }
+
+  // The deserialized subtrees are allocated in an arena, which the new tree
+  // retains. Reference counts start at zero and are incremented as each
+  // subtree is referenced by its parents.
+  SubtreeArena *arena = ts_subtree_arena_new();
+  Subtree *nodes = ts_malloc(node_count * sizeof(Subtree));
+  for (uint32_t i = 0; i < node_count && !reader.failed; i++) {
+    nodes[i] = ts_tree__read_subtree(&reader, arena, language, nodes, i);
+  }
+
+  TSTree *result = NULL;
+  if (!reader.failed && reader.data == reader.end) {
+    Subtree root = nodes[node_count - 1];
+    if (!root.data.is_inline) ((SubtreeHeapData *)root.ptr)->ref_count++;
+    result = ts_tree_new(root, language, ranges, range_count);
+    ts_subtree_arena_array_add(&result->arenas, arena);
+  }
+
+  ts_subtree_arena_release(arena);
+  ts_free(nodes);
+  ts_free(ranges);
+  return result;
+}
+
+// A node of a flattened tree, as it is being collected. The nodes are split
+// into separate arrays once they have all been found.
+typedef struct {
+  uint32_t start_byte;
+  uint32_t end_byte;
+  TSPoint start_point;
+  uint32_t parent_index;
+  uint32_t first_child_index;
+  uint32_t next_sibling_index;
+  TSSymbol symbol;
+  TSFieldId field_id;
+} FlatTreeEntry;
+
+typedef Array(FlatTreeEntry) FlatTreeEntryArray;
+
+static inline uint32_t ts_tree__flatten_add(
+  FlatTreeEntryArray *entries,
+  const TSTreeCursor *cursor,
+  uint32_t parent_index
+) {
+  TSNode node = ts_tree_cursor_current_node(cursor);
+  array_push(entries, ((FlatTreeEntry) {
+    .start_byte = ts_node_start_byte(node),
+    .end_byte = ts_node_end_byte(node),
+    .start_point = ts_node_start_point(node),
+    .parent_index = parent_index,
+    .first_child_index = TS_FLAT_TREE_NONE,
+    .next_sibling_index = TS_FLAT_TREE_NONE,
+    .symbol = ts_node_symbol(node),
+    .field_id = ts_tree_cursor_current_field_id(cursor),
+  }));
+  return entries->size - 1;
+}
+
+TSFlatTree *ts_tree_flatten(const TSTree *self) {
+  FlatTreeEntryArray entries = array_new();
+  Array(uint32_t) path = array_new();
+  TSTreeCursor cursor = ts_tree_cursor_new(ts_tree_root_node(self));
+
+  // Visit the tree's visible nodes in pre-order, keeping track of the indices
+  // of the current node's ancestors.
+  array_push(&path, ts_tree__flatten_add(&entries, &cursor, TS_FLAT_TREE_NONE));
+  for (;;) {
+    if (ts_tree_cursor_goto_first_child(&cursor)) {
+      uint32_t parent_index = *array_back(&path);
+      uint32_t index = ts_tree__flatten_add(&entries, &cursor, parent_index);
+      entries.contents[parent_index].first_child_index = index;
+      array_push(&path, index);
+      continue;
+    }
+
+    while (path.size > 1) {
+      uint32_t previous_index = array_pop(&path);
+      if (ts_tree_cursor_goto_next_sibling(&cursor)) {
+        uint32_t index = ts_tree__flatten_add(&entries, &cursor, *array_back(&path));
+        entries.contents[previous_index].next_sibling_index = index;
+        array_push(&path, index);
+        break;
+      }
+      ts_tree_cursor_goto_parent(&cursor);
+    }
+    if (path.size == 1) break;
+  }
+  ts_tree_cursor_delete(&cursor);
+  array_delete(&path);
+
+  // Store all of the arrays in a single allocation, ordered by alignment.
+  uint32_t count = entries.size;
+  size_t size =
+    sizeof(TSFlatTree) +
+    count * (sizeof(TSPoint) + 5 * sizeof(uint32_t) + 2 * sizeof(uint16_t));
+  TSFlatTree *result = ts_malloc(size);
+  TSPoint *start_points = (TSPoint *)(result + 1);
+  uint32_t *start_bytes = (uint32_t *)(start_points + count);
+  uint32_t *end_bytes = start_bytes + count;
+  uint32_t *parent_indices = end_bytes + count;
+  uint32_t *first_child_indices = parent_indices + count;
+  uint32_t *next_sibling_indices = first_child_indices + count;
+  TSSymbol *symbols = (TSSymbol *)(next_sibling_indices + count);
+  TSFieldId *field_ids = symbols + count;
+  for (uint32_t i = 0; i < count; i++) {
+    const FlatTreeEntry *entry = &entries.contents[i];
+    symbols[i] = entry->symbol;
+    start_bytes[i] = entry->start_byte;
+    end_bytes[i] = entry->end_byte;
+    start_points[i] = entry->start_point;
+    parent_indices[i] = entry->parent_index;
+    first_child_indices[i] = entry->first_child_index;
+    next_sibling_indices[i] = entry->next_sibling_index;
+    field_ids[i] = entry->field_id;
+  }
+  array_delete(&entries);
+
+  *result = (TSFlatTree) {
+    .node_count = count,
+    .symbols = symbols,
+    .start_bytes = start_bytes,
+    .end_bytes = end_bytes,
+    .start_points = start_points,
+    .parent_indices = parent_indices,
+    .first_child_indices = first_child_indices,
+    .next_sibling_indices = next_sibling_indices,
+    .field_ids = field_ids,
+  };
+  return result;
+}
+
+void ts_flat_tree_delete(TSFlatTree *self) {
+  ts_free(self);
+}
+
+size_t ts_tree_memory_usage(const TSTree *self) {
+  size_t result;
+  ts_tree_shared_memory_usage(&self, 1, &result);
+  return result;
+}
+
+size_t ts_tree_shared_memory_usage(const TSTree *const *trees, uint32_t count, size_t *unique_bytes) {
+  Subtree *roots = ts_malloc(count * sizeof(Subtree));
+  size_t *bytes = unique_bytes ? unique_bytes : ts_malloc(count * sizeof(size_t));
+  for (uint32_t i = 0; i < count; i++) roots[i] = trees[i]->root;
+
+  size_t result = ts_subtree_shared_memory_usage(roots, count, bytes);
+  for (uint32_t i = 0; i < count; i++) {
+    bytes[i] +=
+      sizeof(TSTree) +
+      trees[i]->included_range_count * sizeof(TSRange) +
+      trees[i]->arenas.capacity * sizeof(SubtreeArena *);
+  }
+
+  if (!unique_bytes) ts_free(bytes);
+  ts_free(roots);
   return result;
 }
 
@@ -163,3 +1240,133 @@ void ts_tree_print_dot_graph(const TSTree *self, int file_descriptor) {
 }
 
 #endif
+
+// TSTreeReclaimer
+
+typedef struct TreeReclaimerEntry {
+  struct TreeReclaimerEntry *next;
+  TSTree *tree;
+  bool release_in_bulk;
+} TreeReclaimerEntry;
+
+struct TSTreeReclaimer {
+  // Trees that have been handed to the reclaimer, in reverse order. Any thread
+  // can push onto this list, and the stepping thread takes the whole list.
+  TreeReclaimerEntry *volatile pending;
+
+  // The trees that the stepping thread has taken, in order, and the tree
+  // whose subtrees are being freed.
+  TreeReclaimerEntry *queue;
+  TreeReclaimerEntry *current;
+  TSAllocator allocator;
+  SubtreePool pool;
+};
+
+TSTreeReclaimer *ts_tree_reclaimer_new(void) {
+  TSTreeReclaimer *self = ts_malloc(sizeof(TSTreeReclaimer));
+  self->pending = NULL;
+  self->queue = NULL;
+  self->current = NULL;
+  self->allocator = (TSAllocator) {0};
+  self->pool = ts_subtree_pool_new(0);
+  return self;
+}
+
+void ts_tree_reclaimer_delete(TSTreeReclaimer *self) {
+  if (!self) return;
+  while (ts_tree_reclaimer_step(self, UINT32_MAX)) {}
+  ts_subtree_pool_delete(&self->pool);
+  ts_free(self);
+}
+
+// The reclaimer's own memory always comes from the global allocator, because it
+// can be handed trees with different allocators.
+static void ts_tree_reclaimer__push(TSTreeReclaimer *self, TSTree *tree, bool release_in_bulk) {
+  const TSAllocator *previous_allocator = ts_allocator_push(NULL);
+  TreeReclaimerEntry *entry = ts_malloc(sizeof(TreeReclaimerEntry));
+  ts_allocator_pop(previous_allocator);
+  entry->tree = tree;
+  entry->release_in_bulk = release_in_bulk;
+  do {
+    entry->next = atomic_load_ptr((void *const volatile *)&self->pending);
+  } while (!atomic_compare_exchange_ptr((void *volatile *)&self->pending, entry->next, entry));
+}
+
+void ts_tree_reclaimer_add(TSTreeReclaimer *self, TSTree *tree) {
+  if (!tree) return;
+  ts_tree_reclaimer__push(self, tree, ts_tree__can_release_in_bulk(tree));
+}
+
+void ts_tree_reclaimer_add_subtree(
+  TSTreeReclaimer *self,
+  Subtree root,
+  const TSLanguage *language,
+  const SubtreeArenaArray *arenas
+) {
+  // The subtree's reference count is always decremented, because a parser's
+  // reference to a subtree may be in an arena that another tree still uses.
+  TSTree *tree = ts_tree_new(root, language, NULL, 0);
+  ts_tree_add_arenas(tree, arenas);
+  ts_tree_reclaimer__push(self, tree, false);
+}
+
+// Move the trees that have been handed to the reclaimer since the last step
+// onto the end of its queue.
+static void ts_tree_reclaimer__take_pending(TSTreeReclaimer *self) {
+  TreeReclaimerEntry *list;
+  do {
+    list = atomic_load_ptr((void *const volatile *)&self->pending);
+    if (!list) return;
+  } while (!atomic_compare_exchange_ptr((void *volatile *)&self->pending, list, NULL));
+
+  TreeReclaimerEntry *reversed = NULL;
+  while (list) {
+    TreeReclaimerEntry *next = list->next;
+    list->next = reversed;
+    reversed = list;
+    list = next;
+  }
+
+  TreeReclaimerEntry **end = &self->queue;
+  while (*end) end = &(*end)->next;
+  *end = reversed;
+}
+
+bool ts_tree_reclaimer_step(TSTreeReclaimer *self, uint32_t max_subtree_count) {
+  uint32_t remaining_count = max_subtree_count;
+  for (;;) {
+    if (!self->current) {
+      if (!self->queue) ts_tree_reclaimer__take_pending(self);
+      if (!self->queue) return false;
+      self->current = self->queue;
+      self->queue = self->current->next;
+      self->allocator = self->current->tree->allocator;
+    }
+
+    // While a tree's subtrees are being freed, the stack of subtrees that
+    // remain belongs to that tree, and uses its allocator.
+    const TSAllocator *previous_allocator = ts_allocator_push(&self->allocator);
+    if (self->pool.tree_stack.size == 0) {
+      ts_subtree_release_start(&self->pool, self->current->tree->root, self->current->release_in_bulk);
+    }
+    remaining_count -= ts_subtree_release_step(
+      &self->pool,
+      self->current->release_in_bulk,
+      remaining_count
+    );
+    if (self->pool.tree_stack.size > 0) {
+      ts_allocator_pop(previous_allocator);
+      return true;
+    }
+    array_delete(&self->pool.tree_stack);
+    ts_tree__free(self->current->tree);
+    ts_allocator_push(NULL);
+    ts_free(self->current);
+    ts_allocator_pop(previous_allocator);
+    self->current = NULL;
+
+    if (remaining_count == 0) {
+      return self->queue || atomic_load_ptr((void *const volatile *)&self->pending);
+    }
+  }
+}
@@ -7,21 +7,63 @@
 extern "C" {
 #endif
 
+// An entry in a tree's parent index, describing the position of one subtree
+// within its parent. A `NULL` parent refers to the tree's root, so that the
+// index can be shared between copies of the same tree.
 typedef struct {
   const Subtree *child;
   const Subtree *parent;
   Length position;
+  uint32_t child_start_byte;
+  uint32_t child_index;
+  uint32_t structural_child_index;
   TSSymbol alias_symbol;
 } ParentCacheEntry;
 
+// An entry in a tree's parent index describing one child of a node with many
+// children, relative to the start of that node. These let the child at a given
+// position be found with a binary search, instead of by walking the children.
+typedef struct {
+  Length position;
+  uint32_t structural_child_index;
+  uint32_t descendant_index;
+  uint32_t visible_child_index;
+} ChildOffsetEntry;
+
+typedef struct {
+  const Subtree *children;
+  uint32_t offset;
+} WideNodeEntry;
+
+typedef struct {
+  Array(ParentCacheEntry) entries;
+  uint32_t *slots;
+  uint32_t slot_mask;
+  Array(ChildOffsetEntry) child_offsets;
+  Array(WideNodeEntry) wide_nodes;
+  uint32_t *wide_node_slots;
+  uint32_t wide_node_slot_mask;
+  volatile uint32_t ref_count;
+} ParentIndex;
+
 struct TSTree {
+  TSAllocator allocator;
   Subtree root;
   const TSLanguage *language;
   TSRange *included_ranges;
   unsigned included_range_count;
+  SubtreeArenaArray arenas;
+  ParentIndex *volatile parent_index;
+  bool parent_index_enabled;
 };
 
 TSTree *ts_tree_new(Subtree root, const TSLanguage *language, const TSRange *, unsigned);
+void ts_tree_add_arenas(TSTree *, const SubtreeArenaArray *);
+void ts_tree_reclaimer_add_subtree(TSTreeReclaimer *, Subtree, const TSLanguage *, const SubtreeArenaArray *);
+const ParentCacheEntry *ts_tree_parent_cache_entry(const TSTree *, const Subtree *, uint32_t);
+const ChildOffsetEntry *ts_tree_child_offsets(const TSTree *, Subtree);
+uint32_t ts_tree_child_offsets_search(const ChildOffsetEntry *, Subtree, Length, uint32_t, TSPoint);
+uint32_t ts_tree_child_offsets_search_structural(const ChildOffsetEntry *, Subtree, uint32_t);
 TSNode ts_node_new(const TSTree *, const Subtree *, Length, TSSymbol);
 
 #ifdef __cplusplus
@@ -97,6 +97,24 @@ static inline bool ts_tree_cursor_child_iterator_next(
   return true;
 }
 
+// Move a new child iterator directly to the given child, using the offsets
+// recorded in the tree's parent index.
+static inline void ts_tree_cursor_child_iterator_seek(
+  CursorChildIterator *self,
+  const ChildOffsetEntry *offsets,
+  uint32_t child_index
+) {
+  if (child_index >= self->parent.ptr->child_count) {
+    self->child_index = self->parent.ptr->child_count;
+    return;
+  }
+  const ChildOffsetEntry *offset = &offsets[child_index];
+  self->position = length_add(self->position, offset->position);
+  self->child_index = child_index;
+  self->structural_child_index = offset->structural_child_index;
+  self->descendant_index += offset->descendant_index;
+}
+
 // Return a position that, when `b` is added to it, yields `a`. This
 // can only be computed if `b` has zero rows. Otherwise, this function
 // returns `LENGTH_UNDEFINED`, and the caller needs to recompute
@@ -272,6 +290,25 @@ static inline int64_t ts_tree_cursor_goto_first_child_for_byte_and_point(
     bool visible;
     TreeCursorEntry entry;
     CursorChildIterator iterator = ts_tree_cursor_iterate_children(self);
+
+    // In nodes with many children, skip the children that end before the goal.
+    const ChildOffsetEntry *offsets = iterator.parent.ptr
+      ? ts_tree_child_offsets(self->tree, iterator.parent)
+      : NULL;
+    if (offsets) {
+      uint32_t child_index = ts_tree_child_offsets_search(
+        offsets,
+        iterator.parent,
+        iterator.position,
+        goal_byte,
+        goal_point
+      );
+      ts_tree_cursor_child_iterator_seek(&iterator, offsets, child_index);
+      if (child_index < iterator.parent.ptr->child_count) {
+        visible_child_index += offsets[child_index].visible_child_index;
+      }
+    }
+
     while (ts_tree_cursor_child_iterator_next(&iterator, &entry, &visible)) {
       Length entry_end = length_add(entry.position, ts_subtree_size(*entry.subtree));
       bool at_goal = entry_end.bytes >= goal_byte && point_gte(entry_end.extent, goal_point);
@@ -306,6 +343,83 @@ int64_t ts_tree_cursor_goto_first_child_for_point(TSTreeCursor *self, TSPoint go
   return ts_tree_cursor_goto_first_child_for_byte_and_point(self, 0, goal_point);
 }
 
+// This follows the same steps as `ts_node_child_by_field_id`, but pushes the
+// hidden nodes that it descends through onto the cursor's stack.
+bool ts_tree_cursor_goto_child_by_field_id(TSTreeCursor *_self, TSFieldId field_id) {
+  TreeCursor *self = (TreeCursor *)_self;
+  if (!field_id) return false;
+  uint32_t initial_size = self->stack.size;
+
+  bool did_descend;
+  do {
+    did_descend = false;
+
+    const Subtree *parent = array_back(&self->stack)->subtree;
+    if (ts_subtree_child_count(*parent) == 0) break;
+
+    const TSFieldMapEntry *field_map, *field_map_end;
+    ts_language_field_map(
+      self->tree->language,
+      parent->ptr->production_id,
+      &field_map,
+      &field_map_end
+    );
+    while (field_map < field_map_end && field_map->field_id < field_id) field_map++;
+    while (field_map < field_map_end && field_map_end[-1].field_id > field_id) field_map_end--;
+    if (field_map == field_map_end) break;
+
+    bool visible;
+    TreeCursorEntry entry;
+    CursorChildIterator iterator = ts_tree_cursor_iterate_children(self);
+
+    // In nodes with many children, skip directly to the first child that
+    // can have the field. This only works when the parent index is enabled.
+    const ChildOffsetEntry *offsets = ts_tree_child_offsets(self->tree, iterator.parent);
+    if (offsets) {
+      ts_tree_cursor_child_iterator_seek(&iterator, offsets, ts_tree_child_offsets_search_structural(
+        offsets,
+        iterator.parent,
+        field_map->child_index
+      ));
+    }
+
+    while (ts_tree_cursor_child_iterator_next(&iterator, &entry, &visible)) {
+      if (ts_subtree_extra(*entry.subtree)) continue;
+      if (entry.structural_child_index < field_map->child_index) continue;
+
+      // Hidden nodes' fields are "inherited" by their visible parent.
+      if (field_map->inherited) {
+        array_push(&self->stack, entry);
+        if (field_map + 1 == field_map_end) {
+          did_descend = true;
+          break;
+        }
+        if (ts_tree_cursor_goto_child_by_field_id(_self, field_id)) return true;
+        self->stack.size--;
+      }
+
+      else if (visible) {
+        array_push(&self->stack, entry);
+        return true;
+      }
+
+      // If the field refers to a hidden node with visible children,
+      // move to the first visible child.
+      else if (ts_subtree_visible_child_count(*entry.subtree) > 0) {
+        array_push(&self->stack, entry);
+        ts_tree_cursor_goto_first_child(_self);
+        return true;
+      }
+
+      field_map++;
+      if (field_map == field_map_end) break;
+    }
+  } while (did_descend);
+
+  self->stack.size = initial_size;
+  return false;
+}
+
 TreeCursorStep ts_tree_cursor_goto_sibling_internal(
     TSTreeCursor *_self,
     bool (*advance)(CursorChildIterator *, TreeCursorEntry *, bool *)) {
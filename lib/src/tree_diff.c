@@ -0,0 +1,857 @@
+#include <stdlib.h>
+#include <string.h>
+#include "./array.h"
+#include "./language.h"
+#include "./subtree.h"
+#include "./tree.h"
+
+// A structural diff between two syntax trees.
+//
+// Both trees are flattened into arrays of their visible nodes, in pre-order,
+// so that the descendants of each node form a contiguous range that ends at
+// the node's `end` index. Each node is given a hash of its symbol and content,
+// which is computed as the tree is flattened. The hashes are only kept for the
+// duration of the call, so the trees themselves are never written to.
+//
+// The nodes are then matched up in three passes:
+//
+// 1. Top-down, each node of the new tree that has children is matched with an
+//    identical node of the old tree, if it is the only such node in each tree.
+//    Then, larger subtrees that occur more than once are matched with the
+//    identical, unmatched node of the old tree whose position is closest to
+//    that of the new node, relative to the nodes matched before it. Matching a
+//    node matches all of its descendants.
+// 2. Bottom-up, each node of the new tree that is still unmatched is matched
+//    with a node of the same type in the old tree that contains the
+//    counterparts of the most of its children.
+// 3. Top-down, the unmatched children of each pair of matched nodes are aligned
+//    with each other, first by identity, and then by type.
+//
+// Hashes are only used to find candidates, and every match between identical
+// subtrees is checked node by node, so hash collisions can't produce wrong
+// matches.
+
+#define DIFF_NONE UINT32_MAX
+
+// The content hash of a subtree summarizes the visible nodes that it contains,
+// with their symbols after aliasing, and the symbols and text of all of its
+// leaves. It doesn't cover the subtree's own symbol, which can depend on the
+// alias that its parent gives it, or the whitespace between tokens. Hidden
+// children are spliced into the sequence of their parent's children, just as
+// they are when iterating over a node's children, so the hash doesn't depend
+// on how repetitions happened to be balanced.
+//
+// A sequence of child hashes is combined as a polynomial in the base below,
+// modulo 2^32, so that the hash of a hidden child can be spliced into its
+// parent's sequence without revisiting the child's own children.
+#define DIFF_HASH_BASE 0x01000193u
+
+// The maximum number of candidates that are considered for each identical
+// match, so that very common subtrees don't make the diff quadratic.
+#define DIFF_MAX_CANDIDATES 32
+
+// The minimum number of nodes in a subtree that occurs more than once for it to
+// be matched outside of the nodes that contain it.
+#define DIFF_MIN_AMBIGUOUS_SIZE 4
+
+// The maximum size of the table used to align two lists of children. Longer
+// lists are aligned greedily instead.
+#define DIFF_MAX_ALIGNMENT_CELLS 65536
+
+typedef struct {
+  TSNode node;
+  uint32_t hash;
+  uint32_t parent;
+  uint32_t end;
+  uint32_t match;
+  TSSymbol symbol;
+  bool is_moved;
+} DiffNode;
+
+typedef struct {
+  uint32_t hash;
+  uint32_t index;
+} DiffHashEntry;
+
+// A subtree whose children are being compared, along with the position of the
+// next child.
+typedef struct {
+  Subtree tree;
+  uint32_t child_index;
+  uint32_t byte;
+} DiffLeafEntry;
+
+// A subtree whose children are being flattened, along with the position of
+// its next child, the index of its nearest visible ancestor, and the content
+// hash of the children that have been flattened so far.
+typedef struct {
+  Subtree tree;
+  const TSSymbol *alias_sequence;
+  uint32_t child_index;
+  uint32_t structural_child_index;
+  Length position;
+  uint32_t node_index;
+  uint32_t parent;
+  uint32_t hash;
+} DiffFlattenEntry;
+
+typedef Array(uint32_t) DiffIndexArray;
+typedef Array(DiffFlattenEntry) DiffFlattenStack;
+typedef Array(DiffLeafEntry) DiffLeafStack;
+typedef Array(DiffHashEntry) DiffHashArray;
+
+typedef struct {
+  Array(DiffNode) nodes;
+  const char *source;
+  uint32_t length;
+} DiffSide;
+
+typedef struct {
+  DiffSide old_side;
+  DiffSide new_side;
+  DiffHashArray old_hashes;
+  DiffIndexArray old_children;
+  DiffIndexArray new_children;
+  Array(uint16_t) table;
+  DiffIndexArray votes;
+  DiffLeafStack old_stack;
+  DiffLeafStack new_stack;
+} TreeDiff;
+
+static inline bool ts_tree_diff__is_leaf(const DiffSide *side, uint32_t index) {
+  return side->nodes.contents[index].end == index + 1;
+}
+
+static inline uint32_t ts_tree_diff__hash_power(uint32_t exponent) {
+  uint32_t result = 1;
+  uint32_t base = DIFF_HASH_BASE;
+  while (exponent) {
+    if (exponent & 1) result *= base;
+    base *= base;
+    exponent >>= 1;
+  }
+  return result;
+}
+
+static uint32_t ts_tree_diff__leaf_hash(
+  const DiffSide *self,
+  Subtree leaf,
+  uint32_t start_byte
+) {
+  uint32_t hash = 2166136261u;
+  uint32_t end_byte = start_byte + ts_subtree_size(leaf).bytes;
+  if (end_byte > self->length) end_byte = self->length;
+  for (uint32_t i = start_byte; i < end_byte; i++) {
+    hash = (hash ^ (uint8_t)self->source[i]) * 16777619u;
+  }
+  if (ts_subtree_missing(leaf)) hash = ~hash;
+  return hash;
+}
+
+// Combine the content hash of a node with its visible symbol.
+static inline uint32_t ts_tree_diff__hash_node(uint32_t content_hash, TSSymbol symbol) {
+  uint32_t hash = content_hash ^ (symbol * 0x9e3779b1u);
+  hash ^= hash >> 16;
+  hash *= 0x85ebca6bu;
+  hash ^= hash >> 13;
+  hash *= 0xc2b2ae35u;
+  hash ^= hash >> 16;
+  return hash;
+}
+
+// Add the content hash of a child to the content hash of its parent's
+// preceding children. The child's node is NULL if the child is hidden.
+static inline uint32_t ts_tree_diff__append_hash(
+  uint32_t hash,
+  Subtree child,
+  const DiffNode *node,
+  uint32_t child_hash,
+  const TSLanguage *language
+) {
+  if (node) {
+    return hash * DIFF_HASH_BASE + ts_tree_diff__hash_node(child_hash, node->symbol);
+  } else if (ts_subtree_child_count(child) == 0) {
+    // Hidden leaves are added without shifting the sequence, as if they were
+    // part of the next visible node, so that they don't change its length.
+    TSSymbol symbol = ts_language_public_symbol(language, ts_subtree_symbol(child));
+    return hash + ts_tree_diff__hash_node(child_hash, symbol);
+  } else {
+    return hash * ts_tree_diff__hash_power(child.ptr->visible_child_count) + child_hash;
+  }
+}
+
+// Add a visible node. Its hash is assigned once its content hash is known.
+static inline void ts_tree_diff__push_node(
+  DiffSide *self,
+  const TSTree *tree,
+  const Subtree *subtree,
+  Length position,
+  TSSymbol alias,
+  uint32_t parent
+) {
+  TSSymbol symbol = ts_language_public_symbol(
+    tree->language,
+    alias ? alias : ts_subtree_symbol(*subtree)
+  );
+  uint32_t end = self->nodes.size + 1;
+  array_push(&self->nodes, ((DiffNode) {
+    .node = ts_node_new(tree, subtree, position, alias),
+    .parent = parent,
+    .end = end,
+    .match = DIFF_NONE,
+    .symbol = symbol,
+  }));
+}
+
+// Walk the tree's subtrees directly, rather than with a tree cursor, adding
+// each visible node along with the index of its visible parent. Once a
+// subtree is finished, record the end of its node's descendants, and combine
+// its content hash into that of its parent.
+static void ts_tree_diff__flatten(
+  DiffSide *self,
+  const TSTree *tree,
+  const char *source,
+  uint32_t length,
+  DiffFlattenStack *stack
+) {
+  self->source = source;
+  self->length = length;
+
+  Length root_position = ts_subtree_padding(tree->root);
+  ts_tree_diff__push_node(self, tree, &tree->root, root_position, 0, DIFF_NONE);
+  if (ts_subtree_child_count(tree->root) == 0) {
+    DiffNode *root = &self->nodes.contents[0];
+    root->hash = ts_tree_diff__hash_node(
+      ts_tree_diff__leaf_hash(self, tree->root, root_position.bytes),
+      root->symbol
+    );
+    return;
+  }
+  array_clear(stack);
+  array_push(stack, ((DiffFlattenEntry) {
+    .tree = tree->root,
+    .alias_sequence = ts_language_alias_sequence(tree->language, tree->root.ptr->production_id),
+    .position = length_zero(),
+    .node_index = 0,
+    .parent = 0,
+  }));
+
+  while (stack->size > 0) {
+    DiffFlattenEntry *entry = array_back(stack);
+    if (entry->child_index == entry->tree.ptr->child_count) {
+      Subtree subtree = entry->tree;
+      uint32_t hash = entry->hash;
+      const DiffNode *node = NULL;
+      if (entry->node_index != DIFF_NONE) {
+        DiffNode *visible_node = &self->nodes.contents[entry->node_index];
+        visible_node->end = self->nodes.size;
+        visible_node->hash = ts_tree_diff__hash_node(hash, visible_node->symbol);
+        node = visible_node;
+      }
+      stack->size--;
+      if (stack->size > 0) {
+        DiffFlattenEntry *parent = array_back(stack);
+        parent->hash = ts_tree_diff__append_hash(parent->hash, subtree, node, hash, tree->language);
+      }
+      continue;
+    }
+
+    const Subtree *child = &ts_subtree_children(entry->tree)[entry->child_index++];
+    TSSymbol alias = 0;
+    if (!ts_subtree_extra(*child)) {
+      if (entry->alias_sequence) alias = entry->alias_sequence[entry->structural_child_index];
+      entry->structural_child_index++;
+    }
+    Length child_position = entry->position;
+    entry->position = length_add(entry->position, ts_subtree_total_size(*child));
+    Length start = length_add(child_position, ts_subtree_padding(*child));
+    uint32_t parent = entry->parent;
+
+    uint32_t node_index = DIFF_NONE;
+    if (alias || ts_subtree_visible(*child)) {
+      node_index = self->nodes.size;
+      parent = node_index;
+      ts_tree_diff__push_node(self, tree, child, start, alias, entry->parent);
+    }
+    if (ts_subtree_child_count(*child) > 0) {
+      array_push(stack, ((DiffFlattenEntry) {
+        .tree = *child,
+        .alias_sequence = ts_language_alias_sequence(tree->language, child->ptr->production_id),
+        .position = child_position,
+        .node_index = node_index,
+        .parent = parent,
+      }));
+    } else {
+      uint32_t hash = ts_tree_diff__leaf_hash(self, *child, start.bytes);
+      DiffNode *node = NULL;
+      if (node_index != DIFF_NONE) {
+        node = &self->nodes.contents[node_index];
+        node->hash = ts_tree_diff__hash_node(hash, node->symbol);
+      }
+      entry->hash = ts_tree_diff__append_hash(entry->hash, *child, node, hash, tree->language);
+    }
+  }
+}
+
+static int ts_tree_diff__compare_hashes(const void *a, const void *b) {
+  const DiffHashEntry *left = a, *right = b;
+  if (left->hash != right->hash) return left->hash < right->hash ? -1 : 1;
+  if (left->index != right->index) return left->index < right->index ? -1 : 1;
+  return 0;
+}
+
+static inline bool ts_tree_diff__next_child(DiffLeafStack *stack, DiffLeafEntry *result) {
+  while (stack->size > 0) {
+    DiffLeafEntry *entry = array_back(stack);
+    if (entry->child_index == ts_subtree_child_count(entry->tree)) {
+      stack->size--;
+      continue;
+    }
+    Subtree child = ts_subtree_children(entry->tree)[entry->child_index++];
+    *result = (DiffLeafEntry) {child, 0, entry->byte + ts_subtree_padding(child).bytes};
+    entry->byte += ts_subtree_total_bytes(child);
+    return true;
+  }
+  return false;
+}
+
+static inline void ts_tree_diff__push_children(DiffLeafStack *stack, DiffLeafEntry entry) {
+  entry.byte -= ts_subtree_padding(entry.tree).bytes;
+  array_push(stack, entry);
+}
+
+// Check whether two subtrees' text, starting at the given bytes, is the same.
+static inline bool ts_tree_diff__have_same_text(
+  const TreeDiff *self,
+  Subtree old_tree,
+  uint32_t old_byte,
+  Subtree new_tree,
+  uint32_t new_byte
+) {
+  uint32_t size = ts_subtree_size(old_tree).bytes;
+  return
+    ts_subtree_size(new_tree).bytes == size &&
+    old_byte + size <= self->old_side.length &&
+    new_byte + size <= self->new_side.length &&
+    memcmp(self->old_side.source + old_byte, self->new_side.source + new_byte, size) == 0;
+}
+
+// Check whether two subtrees have the same leaves, with the same symbols and
+// text. Subtrees that are shared between the two trees are only compared by
+// their text.
+static bool ts_tree_diff__have_same_leaves(TreeDiff *self, TSNode old_node, TSNode new_node) {
+  DiffLeafEntry old_entry = {*(const Subtree *)old_node.id, 0, ts_node_start_byte(old_node)};
+  DiffLeafEntry new_entry = {*(const Subtree *)new_node.id, 0, ts_node_start_byte(new_node)};
+  array_clear(&self->old_stack);
+  array_clear(&self->new_stack);
+  bool has_old_entry = true, has_new_entry = true;
+
+  while (has_old_entry && has_new_entry) {
+    bool old_is_leaf = ts_subtree_child_count(old_entry.tree) == 0;
+    bool new_is_leaf = ts_subtree_child_count(new_entry.tree) == 0;
+    if (
+      (old_is_leaf && new_is_leaf) ||
+      (!old_entry.tree.data.is_inline && old_entry.tree.ptr == new_entry.tree.ptr)
+    ) {
+      if (old_is_leaf && (
+        ts_subtree_symbol(old_entry.tree) != ts_subtree_symbol(new_entry.tree) ||
+        ts_subtree_missing(old_entry.tree) != ts_subtree_missing(new_entry.tree)
+      )) return false;
+      if (!ts_tree_diff__have_same_text(
+        self,
+        old_entry.tree,
+        old_entry.byte,
+        new_entry.tree,
+        new_entry.byte
+      )) {
+        if (old_is_leaf) return false;
+
+        // A shared subtree whose text differs must be compared leaf by leaf.
+        ts_tree_diff__push_children(&self->old_stack, old_entry);
+        ts_tree_diff__push_children(&self->new_stack, new_entry);
+      }
+      has_old_entry = ts_tree_diff__next_child(&self->old_stack, &old_entry);
+      has_new_entry = ts_tree_diff__next_child(&self->new_stack, &new_entry);
+    } else if (!old_is_leaf) {
+      ts_tree_diff__push_children(&self->old_stack, old_entry);
+      has_old_entry = ts_tree_diff__next_child(&self->old_stack, &old_entry);
+    } else {
+      ts_tree_diff__push_children(&self->new_stack, new_entry);
+      has_new_entry = ts_tree_diff__next_child(&self->new_stack, &new_entry);
+    }
+  }
+  return has_old_entry == has_new_entry;
+}
+
+// Check whether two subtrees are identical, and have no matched nodes.
+static bool ts_tree_diff__are_identical(
+  TreeDiff *self,
+  uint32_t old_index,
+  uint32_t new_index
+) {
+  const DiffNode *old_nodes = self->old_side.nodes.contents;
+  const DiffNode *new_nodes = self->new_side.nodes.contents;
+  uint32_t size = old_nodes[old_index].end - old_index;
+  if (new_nodes[new_index].end - new_index != size) return false;
+
+  for (uint32_t i = 0; i < size; i++) {
+    const DiffNode *old_node = &old_nodes[old_index + i];
+    const DiffNode *new_node = &new_nodes[new_index + i];
+    if (
+      old_node->hash != new_node->hash ||
+      old_node->symbol != new_node->symbol ||
+      old_node->match != DIFF_NONE ||
+      new_node->match != DIFF_NONE ||
+      old_node->end - old_index != new_node->end - new_index
+    ) return false;
+  }
+  return ts_tree_diff__have_same_leaves(self, old_nodes[old_index].node, new_nodes[new_index].node);
+}
+
+static void ts_tree_diff__match(TreeDiff *self, uint32_t old_index, uint32_t new_index) {
+  self->old_side.nodes.contents[old_index].match = new_index;
+  self->new_side.nodes.contents[new_index].match = old_index;
+}
+
+// Match two identical subtrees. Because their structure is the same, their
+// descendants correspond to each other in pre-order.
+static void ts_tree_diff__match_subtrees(TreeDiff *self, uint32_t old_index, uint32_t new_index) {
+  uint32_t size = self->old_side.nodes.contents[old_index].end - old_index;
+  for (uint32_t i = 0; i < size; i++) {
+    ts_tree_diff__match(self, old_index + i, new_index + i);
+  }
+}
+
+// Find the first entry that is not less than the given hash and index.
+static uint32_t ts_tree_diff__lower_bound(
+  const DiffHashArray *entries,
+  uint32_t hash,
+  uint32_t index
+) {
+  uint32_t start = 0, end = entries->size;
+  while (start < end) {
+    uint32_t middle = start + (end - start) / 2;
+    const DiffHashEntry *entry = &entries->contents[middle];
+    if (entry->hash < hash || (entry->hash == hash && entry->index < index)) start = middle + 1;
+    else end = middle;
+  }
+  return start;
+}
+
+// Count the entries with the given hash, and find the first one whose index is
+// not less than the given index.
+static inline uint32_t ts_tree_diff__count_hashes(
+  const DiffHashArray *entries,
+  uint32_t hash,
+  uint32_t index,
+  uint32_t *start,
+  uint32_t *position
+) {
+  *start = ts_tree_diff__lower_bound(entries, hash, 0);
+  *position = ts_tree_diff__lower_bound(entries, hash, index);
+  return ts_tree_diff__lower_bound(entries, hash, UINT32_MAX) - *start;
+}
+
+static void ts_tree_diff__index_hashes(const DiffSide *side, DiffHashArray *entries) {
+  for (uint32_t i = 1; i < side->nodes.size; i++) {
+    if (!ts_tree_diff__is_leaf(side, i)) {
+      array_push(entries, ((DiffHashEntry) {side->nodes.contents[i].hash, i}));
+    }
+  }
+  if (entries->size > 1) {
+    qsort(entries->contents, entries->size, sizeof(DiffHashEntry), ts_tree_diff__compare_hashes);
+  }
+}
+
+// Find an unmatched subtree in the old tree that is identical to the given
+// subtree of the new tree, starting from the candidate closest to the given
+// index and working outward from there, as far as the given distance.
+static uint32_t ts_tree_diff__find_identical(
+  TreeDiff *self,
+  uint32_t new_index,
+  uint32_t target,
+  uint32_t max_distance
+) {
+  uint32_t hash = self->new_side.nodes.contents[new_index].hash;
+  const DiffHashEntry *entries = self->old_hashes.contents;
+  uint32_t start, right;
+  uint32_t end = start + ts_tree_diff__count_hashes(&self->old_hashes, hash, target, &start, &right);
+  uint32_t left = right;
+
+  for (unsigned i = 0; i < DIFF_MAX_CANDIDATES && (left > start || right < end); i++) {
+    uint32_t candidate;
+    if (
+      right == end ||
+      (left > start && target - entries[left - 1].index < entries[right].index - target)
+    ) {
+      candidate = entries[--left].index;
+    } else {
+      candidate = entries[right++].index;
+    }
+    if ((candidate > target ? candidate - target : target - candidate) > max_distance) break;
+    if (ts_tree_diff__are_identical(self, candidate, new_index)) return candidate;
+  }
+  return DIFF_NONE;
+}
+
+static void ts_tree_diff__match_identical(TreeDiff *self) {
+  const DiffSide *new_side = &self->new_side;
+  const DiffNode *new_nodes = new_side->nodes.contents;
+
+  if (ts_tree_diff__are_identical(self, 0, 0)) {
+    ts_tree_diff__match_subtrees(self, 0, 0);
+    return;
+  }
+  ts_tree_diff__match(self, 0, 0);
+
+  DiffHashArray new_hashes = array_new();
+  ts_tree_diff__index_hashes(&self->old_side, &self->old_hashes);
+  ts_tree_diff__index_hashes(new_side, &new_hashes);
+
+  // First, match the subtrees that occur exactly once in each tree.
+  for (uint32_t j = 1; j < new_side->nodes.size;) {
+    if (!ts_tree_diff__is_leaf(new_side, j)) {
+      uint32_t hash = new_nodes[j].hash, old_start, new_start, position;
+      if (
+        ts_tree_diff__count_hashes(&new_hashes, hash, 0, &new_start, &position) == 1 &&
+        ts_tree_diff__count_hashes(&self->old_hashes, hash, 0, &old_start, &position) == 1
+      ) {
+        uint32_t i = self->old_hashes.contents[old_start].index;
+        if (ts_tree_diff__are_identical(self, i, j)) {
+          ts_tree_diff__match_subtrees(self, i, j);
+          j = new_nodes[j].end;
+          continue;
+        }
+      }
+    }
+    j++;
+  }
+  array_delete(&new_hashes);
+
+  // Then match the remaining subtrees to the candidates that are closest to
+  // where they would be, relative to the previous matched node. A candidate
+  // that is further from there than the new node is from that node is part of
+  // some other context, so it isn't considered. Leaves and other small
+  // subtrees are too common to be matched reliably this way, so they are only
+  // matched within nodes that have already been matched.
+  uint32_t anchor_old = 0, anchor_new = 0;
+  for (uint32_t j = 1; j < new_side->nodes.size; j++) {
+    if (new_nodes[j].match != DIFF_NONE) {
+      anchor_old = new_nodes[j].match;
+      anchor_new = j;
+      continue;
+    }
+    if (new_nodes[j].end - j < DIFF_MIN_AMBIGUOUS_SIZE) continue;
+
+    uint32_t target = anchor_old + (j - anchor_new);
+    uint32_t i = ts_tree_diff__find_identical(self, j, target, j - anchor_new);
+    if (i != DIFF_NONE) {
+      ts_tree_diff__match_subtrees(self, i, j);
+      anchor_old = i;
+      anchor_new = j;
+    }
+  }
+}
+
+static int ts_tree_diff__compare_indices(const void *a, const void *b) {
+  uint32_t left = *(const uint32_t *)a, right = *(const uint32_t *)b;
+  return left < right ? -1 : left > right ? 1 : 0;
+}
+
+static void ts_tree_diff__match_containers(TreeDiff *self) {
+  const DiffNode *old_nodes = self->old_side.nodes.contents;
+  const DiffNode *new_nodes = self->new_side.nodes.contents;
+
+  // Visiting the nodes in reverse pre-order visits every node's descendants
+  // before the node itself.
+  for (uint32_t j = self->new_side.nodes.size; j-- > 1;) {
+    const DiffNode *node = &new_nodes[j];
+    if (node->match != DIFF_NONE || node->end == j + 1) continue;
+
+    array_clear(&self->votes);
+    for (uint32_t child = j + 1; child < node->end; child = new_nodes[child].end) {
+      uint32_t match = new_nodes[child].match;
+      if (match == DIFF_NONE) continue;
+      uint32_t parent = old_nodes[match].parent;
+      if (
+        parent != DIFF_NONE &&
+        old_nodes[parent].match == DIFF_NONE &&
+        old_nodes[parent].symbol == node->symbol
+      ) {
+        array_push(&self->votes, parent);
+      }
+    }
+    if (self->votes.size == 0) continue;
+
+    qsort(self->votes.contents, self->votes.size, sizeof(uint32_t), ts_tree_diff__compare_indices);
+    uint32_t best = DIFF_NONE, best_count = 0;
+    for (uint32_t i = 0; i < self->votes.size;) {
+      uint32_t k = i;
+      while (k < self->votes.size && self->votes.contents[k] == self->votes.contents[i]) k++;
+      if (k - i > best_count) {
+        best = self->votes.contents[i];
+        best_count = k - i;
+      }
+      i = k;
+    }
+    ts_tree_diff__match(self, best, j);
+  }
+}
+
+static void ts_tree_diff__collect_unmatched_children(
+  const DiffSide *side,
+  uint32_t index,
+  DiffIndexArray *children
+) {
+  const DiffNode *nodes = side->nodes.contents;
+  array_clear(children);
+  for (uint32_t child = index + 1; child < nodes[index].end; child = nodes[child].end) {
+    if (nodes[child].match == DIFF_NONE) array_push(children, child);
+  }
+}
+
+static inline bool ts_tree_diff__can_align(
+  const TreeDiff *self,
+  uint32_t old_index,
+  uint32_t new_index,
+  bool identical
+) {
+  const DiffNode *old_node = &self->old_side.nodes.contents[old_index];
+  const DiffNode *new_node = &self->new_side.nodes.contents[new_index];
+  if (old_node->symbol != new_node->symbol) return false;
+  if (identical) return old_node->hash == new_node->hash;
+  return !ts_tree_diff__is_leaf(&self->old_side, old_index) &&
+         !ts_tree_diff__is_leaf(&self->new_side, new_index);
+}
+
+static void ts_tree_diff__align_pair(
+  TreeDiff *self,
+  uint32_t old_index,
+  uint32_t new_index,
+  bool identical
+) {
+  if (!identical) {
+    ts_tree_diff__match(self, old_index, new_index);
+  } else if (ts_tree_diff__are_identical(self, old_index, new_index)) {
+    ts_tree_diff__match_subtrees(self, old_index, new_index);
+  }
+}
+
+// Match up the unmatched children of two matched nodes so that as many of
+// them as possible are matched without changing their order.
+static void ts_tree_diff__align_children(TreeDiff *self, bool identical) {
+  const uint32_t *old_children = self->old_children.contents;
+  const uint32_t *new_children = self->new_children.contents;
+  uint32_t old_count = self->old_children.size;
+  uint32_t new_count = self->new_children.size;
+  if (old_count == 0 || new_count == 0) return;
+
+  if ((uint64_t)(old_count + 1) * (new_count + 1) > DIFF_MAX_ALIGNMENT_CELLS) {
+    uint32_t i = 0;
+    for (uint32_t j = 0; j < new_count && i < old_count; j++) {
+      for (uint32_t k = i; k < old_count && k < i + DIFF_MAX_CANDIDATES; k++) {
+        if (ts_tree_diff__can_align(self, old_children[k], new_children[j], identical)) {
+          ts_tree_diff__align_pair(self, old_children[k], new_children[j], identical);
+          i = k + 1;
+          break;
+        }
+      }
+    }
+    return;
+  }
+
+  // Compute the lengths of the longest common subsequences of every pair of
+  // suffixes of the two lists, and then walk forward through the table.
+  uint32_t width = new_count + 1;
+  array_reserve(&self->table, (old_count + 1) * width);
+  uint16_t *table = self->table.contents;
+  for (uint32_t i = old_count + 1; i-- > 0;) {
+    for (uint32_t j = new_count + 1; j-- > 0;) {
+      uint16_t *cell = &table[i * width + j];
+      if (i == old_count || j == new_count) {
+        *cell = 0;
+      } else if (ts_tree_diff__can_align(self, old_children[i], new_children[j], identical)) {
+        *cell = table[(i + 1) * width + j + 1] + 1;
+      } else {
+        uint16_t down = table[(i + 1) * width + j];
+        uint16_t right = table[i * width + j + 1];
+        *cell = down > right ? down : right;
+      }
+    }
+  }
+
+  uint32_t i = 0, j = 0;
+  while (i < old_count && j < new_count) {
+    if (
+      ts_tree_diff__can_align(self, old_children[i], new_children[j], identical) &&
+      table[i * width + j] == table[(i + 1) * width + j + 1] + 1
+    ) {
+      ts_tree_diff__align_pair(self, old_children[i], new_children[j], identical);
+      i++;
+      j++;
+    } else if (table[(i + 1) * width + j] >= table[i * width + j + 1]) {
+      i++;
+    } else {
+      j++;
+    }
+  }
+}
+
+static void ts_tree_diff__match_remaining(TreeDiff *self) {
+  for (uint32_t j = 0; j < self->new_side.nodes.size; j++) {
+    uint32_t i = self->new_side.nodes.contents[j].match;
+    if (i == DIFF_NONE || ts_tree_diff__is_leaf(&self->new_side, j)) continue;
+    for (unsigned pass = 0; pass < 2; pass++) {
+      ts_tree_diff__collect_unmatched_children(&self->old_side, i, &self->old_children);
+      ts_tree_diff__collect_unmatched_children(&self->new_side, j, &self->new_children);
+      ts_tree_diff__align_children(self, pass == 0);
+    }
+  }
+}
+
+// Mark the matched nodes that have moved: either their parents don't match,
+// or they are not part of the longest sequence of siblings whose order was
+// preserved. Anonymous tokens like punctuation are never considered to be
+// reordered, because their order only matters relative to the other nodes.
+static void ts_tree_diff__find_moves(TreeDiff *self) {
+  DiffNode *old_nodes = self->old_side.nodes.contents;
+  DiffNode *new_nodes = self->new_side.nodes.contents;
+
+  for (uint32_t j = 1; j < self->new_side.nodes.size; j++) {
+    DiffNode *node = &new_nodes[j];
+    if (node->match != DIFF_NONE && old_nodes[node->match].parent != new_nodes[node->parent].match) {
+      node->is_moved = true;
+    }
+  }
+
+  // For each matched parent, find the longest increasing subsequence of its
+  // children's counterparts. The `new_children` array holds the children, and
+  // `old_children` holds, for each length, the index of the child that ends
+  // the best subsequence of that length so far. `votes` holds each child's
+  // predecessor in its subsequence.
+  for (uint32_t j = 0; j < self->new_side.nodes.size; j++) {
+    const DiffNode *node = &new_nodes[j];
+    if (node->match == DIFF_NONE || node->end == j + 1) continue;
+
+    array_clear(&self->new_children);
+    for (uint32_t child = j + 1; child < node->end; child = new_nodes[child].end) {
+      if (
+        new_nodes[child].match != DIFF_NONE &&
+        !new_nodes[child].is_moved &&
+        (new_nodes[child].end > child + 1 || ts_node_is_named(new_nodes[child].node))
+      ) {
+        array_push(&self->new_children, child);
+      }
+    }
+    uint32_t count = self->new_children.size;
+    if (count < 2) continue;
+
+    array_clear(&self->old_children);
+    array_reserve(&self->votes, count);
+    const uint32_t *children = self->new_children.contents;
+    uint32_t *tails = self->old_children.contents;
+    uint32_t *predecessors = self->votes.contents;
+    uint32_t length = 0;
+    for (uint32_t k = 0; k < count; k++) {
+      uint32_t match = new_nodes[children[k]].match;
+      uint32_t start = 0, end = length;
+      while (start < end) {
+        uint32_t middle = start + (end - start) / 2;
+        if (new_nodes[children[tails[middle]]].match < match) start = middle + 1;
+        else end = middle;
+      }
+      predecessors[k] = start > 0 ? tails[start - 1] : DIFF_NONE;
+      if (start == length) {
+        array_push(&self->old_children, k);
+        tails = self->old_children.contents;
+        length++;
+      } else {
+        tails[start] = k;
+      }
+    }
+
+    for (uint32_t k = 0; k < count; k++) new_nodes[children[k]].is_moved = true;
+    for (uint32_t k = tails[length - 1]; k != DIFF_NONE; k = predecessors[k]) {
+      new_nodes[children[k]].is_moved = false;
+    }
+  }
+}
+
+TSDiffChange *ts_tree_diff(
+  const TSTree *old_tree,
+  const char *old_source,
+  uint32_t old_length,
+  const TSTree *new_tree,
+  const char *new_source,
+  uint32_t new_length,
+  uint32_t *length
+) {
+  *length = 0;
+  if (old_tree->language != new_tree->language) return NULL;
+
+  TreeDiff self = {
+    .old_side = {.nodes = array_new()},
+    .new_side = {.nodes = array_new()},
+    .old_hashes = array_new(),
+    .old_children = array_new(),
+    .new_children = array_new(),
+    .table = array_new(),
+    .votes = array_new(),
+    .old_stack = array_new(),
+    .new_stack = array_new(),
+  };
+  DiffFlattenStack stack = array_new();
+  ts_tree_diff__flatten(&self.old_side, old_tree, old_source, old_length, &stack);
+  ts_tree_diff__flatten(&self.new_side, new_tree, new_source, new_length, &stack);
+  array_delete(&stack);
+  ts_tree_diff__match_identical(&self);
+  ts_tree_diff__match_containers(&self);
+  ts_tree_diff__match_remaining(&self);
+  ts_tree_diff__find_moves(&self);
+
+  Array(TSDiffChange) changes = array_new();
+  const DiffNode *old_nodes = self.old_side.nodes.contents;
+  const DiffNode *new_nodes = self.new_side.nodes.contents;
+  TSNode null_node = {{0, 0, 0, 0}, NULL, NULL};
+
+  for (uint32_t i = 1; i < self.old_side.nodes.size; i++) {
+    const DiffNode *node = &old_nodes[i];
+    if (node->match == DIFF_NONE && old_nodes[node->parent].match != DIFF_NONE) {
+      array_push(&changes, ((TSDiffChange) {TSDiffChangeTypeDelete, node->node, null_node}));
+    }
+  }
+
+  for (uint32_t j = 1; j < self.new_side.nodes.size; j++) {
+    const DiffNode *node = &new_nodes[j];
+    if (node->match == DIFF_NONE) {
+      if (new_nodes[node->parent].match != DIFF_NONE) {
+        array_push(&changes, ((TSDiffChange) {TSDiffChangeTypeInsert, null_node, node->node}));
+      }
+    } else if (node->is_moved) {
+      array_push(&changes, ((TSDiffChange) {
+        TSDiffChangeTypeMove,
+        old_nodes[node->match].node,
+        node->node,
+      }));
+    }
+  }
+
+  array_delete(&self.old_side.nodes);
+  array_delete(&self.new_side.nodes);
+  array_delete(&self.old_hashes);
+  array_delete(&self.old_children);
+  array_delete(&self.new_children);
+  array_delete(&self.table);
+  array_delete(&self.votes);
+  array_delete(&self.old_stack);
+  array_delete(&self.new_stack);
+
+  *length = changes.size;
+  return changes.contents;
+}
+
+#undef DIFF_NONE
+#undef DIFF_HASH_BASE
+#undef DIFF_MAX_CANDIDATES
+#undef DIFF_MIN_AMBIGUOUS_SIZE
+#undef DIFF_MAX_ALIGNMENT_CELLS
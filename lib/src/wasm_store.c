@@ -87,6 +87,7 @@ typedef struct {
 // time.
 struct TSWasmStore {
   wasm_engine_t *engine;
+  TSWasmStorePool *pool;
   wasmtime_store_t *store;
   wasmtime_table_t function_table;
   wasmtime_memory_t memory;
@@ -104,6 +105,19 @@ struct TSWasmStore {
   uint32_t serialization_buffer_address;
 };
 
+// TSWasmStorePool - A set of idle wasm stores that share one engine and one
+// compiled stdlib module. Idle stores are kept in a fixed number of slots,
+// which are claimed and filled with atomic compare-and-swap operations so that
+// stores can be acquired and released from any thread. The pool is reference
+// counted by its owner and by each of the stores that were created from it.
+struct TSWasmStorePool {
+  volatile uint32_t ref_count;
+  wasm_engine_t *engine;
+  wasmtime_module_t *stdlib_module;
+  TSWasmStore *volatile *idle_stores;
+  uint32_t max_store_count;
+};
+
 typedef Array(char) StringData;
 
 // LanguageInWasmMemory - The memory layout of a `TSLanguage` when compiled to
@@ -145,6 +159,8 @@ typedef struct {
     int32_t deserialize;
   } external_scanner;
   int32_t primary_state_ids;
+  int32_t small_parse_table_hash_map;
+  int32_t small_parse_table_hashes;
 } LanguageInWasmMemory;
 
 // LexerInWasmMemory - The memory layout of a `TSLexer` when compiled to wasm32.
@@ -157,6 +173,7 @@ typedef struct {
   int32_t get_column;
   int32_t is_at_included_range_start;
   int32_t eof;
+  int32_t advance_while;
 } LexerInWasmMemory;
 
 static volatile uint32_t NEXT_LANGUAGE_ID;
@@ -345,6 +362,39 @@ static wasm_trap_t *callback__lexer_eof(
   return NULL;
 }
 
+static wasm_trap_t *callback__lexer_advance_while(
+  void *env,
+  wasmtime_caller_t* caller,
+  wasmtime_val_raw_t *args_and_results,
+  size_t args_and_results_len
+) {
+  wasmtime_context_t *context = wasmtime_caller_context(caller);
+  assert(args_and_results_len == 4);
+
+  TSWasmStore *store = env;
+  TSLexer *lexer = store->current_lexer;
+  uint32_t ranges_address = args_and_results[1].i32;
+  uint32_t range_count = args_and_results[2].i32;
+  bool skip = args_and_results[3].i32;
+
+  uint8_t *memory = wasmtime_memory_data(context, &store->memory);
+  size_t memory_size = wasmtime_memory_data_size(context, &store->memory);
+  uint32_t result = 0;
+  if (
+    range_count <= memory_size / sizeof(TSCharacterRange) &&
+    ranges_address <= memory_size - range_count * sizeof(TSCharacterRange)
+  ) {
+    TSCharacterRange *ranges = ts_malloc(range_count * sizeof(TSCharacterRange) + 1);
+    memcpy(ranges, &memory[ranges_address], range_count * sizeof(TSCharacterRange));
+    result = lexer->advance_while(lexer, ranges, range_count, skip);
+    ts_free(ranges);
+  }
+
+  memcpy(&memory[store->lexer_address], &lexer->lookahead, sizeof(lexer->lookahead));
+  args_and_results[0].i32 = result;
+  return NULL;
+}
+
 typedef struct {
   uint32_t *storage_location;
   wasmtime_func_unchecked_callback_t callback;
@@ -425,6 +475,20 @@ static inline wasm_functype_t* wasm_functype_new_4_0(
   return wasm_functype_new(&params, &results);
 }
 
+static inline wasm_functype_t* wasm_functype_new_4_1(
+  wasm_valtype_t* p1,
+  wasm_valtype_t* p2,
+  wasm_valtype_t* p3,
+  wasm_valtype_t* p4,
+  wasm_valtype_t* r
+) {
+  wasm_valtype_t* ps[4] = {p1, p2, p3, p4};
+  wasm_valtype_vec_t params, results;
+  wasm_valtype_vec_new(&params, 4, ps);
+  wasm_valtype_vec_new(&results, 1, &r);
+  return wasm_functype_new(&params, &results);
+}
+
 #define format(output, ...) \
   do { \
     size_t message_length = snprintf((char *)NULL, 0, __VA_ARGS__); \
@@ -537,7 +601,36 @@ static bool ts_wasm_store__call_module_initializer(
   }
 }
 
-TSWasmStore *ts_wasm_store_new(TSWasmEngine *engine, TSWasmError *wasm_error) {
+static bool ts_wasm_store__compile_stdlib(
+  TSWasmEngine *engine,
+  wasmtime_module_t **stdlib_module,
+  TSWasmError *wasm_error
+) {
+  wasmtime_error_t *error = wasmtime_module_new(engine, STDLIB_WASM, STDLIB_WASM_LEN, stdlib_module);
+  if (error) {
+    wasm_message_t message = WASM_EMPTY_VEC;
+    wasmtime_error_message(error, &message);
+    wasm_error->kind = TSWasmErrorKindCompile;
+    format(
+      &wasm_error->message,
+      "failed to compile wasm stdlib: %.*s",
+      (int)message.size, message.data
+    );
+    wasm_byte_vec_delete(&message);
+    wasmtime_error_delete(error);
+    *stdlib_module = NULL;
+    return false;
+  }
+  return true;
+}
+
+// Create a wasm store. If the store belongs to a pool, then it uses the pool's
+// engine and compiled stdlib module, and doesn't take ownership of either.
+static TSWasmStore *ts_wasm_store__new(
+  TSWasmEngine *engine,
+  TSWasmStorePool *pool,
+  TSWasmError *wasm_error
+) {
   TSWasmStore *self = ts_calloc(1, sizeof(TSWasmStore));
   wasmtime_store_t *store = wasmtime_store_new(engine, self, NULL);
   wasmtime_context_t *context = wasmtime_store_context(store);
@@ -581,6 +674,17 @@ TSWasmStore *ts_wasm_store_new(TSWasmEngine *engine, TSWasmError *wasm_error) {
       callback__lexer_eof,
       wasm_functype_new_1_1(wasm_valtype_new_i32(), wasm_valtype_new_i32())
     },
+    {
+      (uint32_t *)&lexer.advance_while,
+      callback__lexer_advance_while,
+      wasm_functype_new_4_1(
+        wasm_valtype_new_i32(),
+        wasm_valtype_new_i32(),
+        wasm_valtype_new_i32(),
+        wasm_valtype_new_i32(),
+        wasm_valtype_new_i32()
+      )
+    },
   };
 
   // Define builtin functions that can be imported by scanners.
@@ -646,21 +750,15 @@ TSWasmStore *ts_wasm_store_new(TSWasmEngine *engine, TSWasmError *wasm_error) {
     wasm_functype_delete(definition->type);
   }
 
-  // Compile the stdlib module.
-  error = wasmtime_module_new(engine, STDLIB_WASM, STDLIB_WASM_LEN, &stdlib_module);
-  if (error) {
-    wasmtime_error_message(error, &message);
-    wasm_error->kind = TSWasmErrorKindCompile;
-    format(
-      &wasm_error->message,
-      "failed to compile wasm stdlib: %.*s",
-      (int)message.size, message.data
-    );
+  // Compile the stdlib module, unless the pool has already compiled it.
+  wasm_importtype_vec_t import_types = WASM_EMPTY_VEC;
+  if (pool) {
+    stdlib_module = pool->stdlib_module;
+  } else if (!ts_wasm_store__compile_stdlib(engine, &stdlib_module, wasm_error)) {
     goto error;
   }
 
   // Retrieve the stdlib module's imports.
-  wasm_importtype_vec_t import_types = WASM_EMPTY_VEC;
   wasmtime_module_imports(stdlib_module, &import_types);
 
   // Find the initial number of memory pages needed by the stdlib.
@@ -733,6 +831,7 @@ TSWasmStore *ts_wasm_store_new(TSWasmEngine *engine, TSWasmError *wasm_error) {
 
   *self = (TSWasmStore) {
     .engine = engine,
+    .pool = pool,
     .store = store,
     .memory = memory,
     .function_table = function_table,
@@ -860,7 +959,7 @@ TSWasmStore *ts_wasm_store_new(TSWasmEngine *engine, TSWasmError *wasm_error) {
   }
 
   wasm_exporttype_vec_delete(&export_types);
-  wasmtime_module_delete(stdlib_module);
+  if (!pool) wasmtime_module_delete(stdlib_module);
 
   // Add all of the lexer callback functions to the function table. Store their function table
   // indices on the in-memory lexer.
@@ -902,7 +1001,7 @@ TSWasmStore *ts_wasm_store_new(TSWasmEngine *engine, TSWasmError *wasm_error) {
 
 error:
   ts_free(self);
-  if (stdlib_module) wasmtime_module_delete(stdlib_module);
+  if (stdlib_module && !pool) wasmtime_module_delete(stdlib_module);
   if (store) wasmtime_store_delete(store);
   if (import_types.size) wasm_importtype_vec_delete(&import_types);
   if (memory_type) wasm_memorytype_delete(memory_type);
@@ -915,18 +1014,35 @@ error:
   return NULL;
 }
 
+TSWasmStore *ts_wasm_store_new(TSWasmEngine *engine, TSWasmError *wasm_error) {
+  return ts_wasm_store__new(engine, NULL, wasm_error);
+}
+
+static void ts_wasm_store_pool__release(TSWasmStorePool *self) {
+  if (atomic_dec(&self->ref_count) > 0) return;
+  ts_free((void *)self->idle_stores);
+  wasmtime_module_delete(self->stdlib_module);
+  wasm_engine_delete(self->engine);
+  ts_free(self);
+}
+
+// A wasm store's memory always comes from the global allocator, even when
+// the store is owned by a parser that has its own allocator.
 void ts_wasm_store_delete(TSWasmStore *self) {
   if (!self) return;
+  const TSAllocator *previous_allocator = ts_allocator_push(NULL);
   ts_free(self->stdlib_fn_indices);
   wasm_globaltype_delete(self->const_i32_type);
   wasmtime_store_delete(self->store);
-  wasm_engine_delete(self->engine);
+  if (!self->pool) wasm_engine_delete(self->engine);
   for (unsigned i = 0; i < self->language_instances.size; i++) {
     LanguageWasmInstance *instance = &self->language_instances.contents[i];
     language_id_delete(instance->language_id);
   }
   array_delete(&self->language_instances);
+  if (self->pool) ts_wasm_store_pool__release(self->pool);
   ts_free(self);
+  ts_allocator_pop(previous_allocator);
 }
 
 size_t ts_wasm_store_language_count(const TSWasmStore *self) {
@@ -940,6 +1056,60 @@ size_t ts_wasm_store_language_count(const TSWasmStore *self) {
   return result;
 }
 
+TSWasmStorePool *ts_wasm_store_pool_new(
+  TSWasmEngine *engine,
+  uint32_t max_store_count,
+  TSWasmError *wasm_error
+) {
+  wasmtime_module_t *stdlib_module;
+  if (!ts_wasm_store__compile_stdlib(engine, &stdlib_module, wasm_error)) return NULL;
+
+  TSWasmStorePool *self = ts_malloc(sizeof(TSWasmStorePool));
+  self->ref_count = 1;
+  self->engine = engine;
+  self->stdlib_module = stdlib_module;
+  self->idle_stores = ts_calloc(max_store_count, sizeof(TSWasmStore *));
+  self->max_store_count = max_store_count;
+  return self;
+}
+
+void ts_wasm_store_pool_delete(TSWasmStorePool *self) {
+  if (!self) return;
+  for (unsigned i = 0; i < self->max_store_count; i++) {
+    ts_wasm_store_delete(self->idle_stores[i]);
+    self->idle_stores[i] = NULL;
+  }
+  ts_wasm_store_pool__release(self);
+}
+
+TSWasmStore *ts_wasm_store_pool_acquire(TSWasmStorePool *self, TSWasmError *wasm_error) {
+  for (unsigned i = 0; i < self->max_store_count; i++) {
+    TSWasmStore *store = atomic_load_ptr((void *const volatile *)&self->idle_stores[i]);
+    if (store && atomic_compare_exchange_ptr((void *volatile *)&self->idle_stores[i], store, NULL)) {
+      return store;
+    }
+  }
+  TSWasmStore *store = ts_wasm_store__new(self->engine, self, wasm_error);
+  if (store) atomic_inc(&self->ref_count);
+  return store;
+}
+
+void ts_wasm_store_pool_release(TSWasmStorePool *self, TSWasmStore *store) {
+  if (!store) return;
+  if (store->pool != self) {
+    ts_wasm_store_delete(store);
+    return;
+  }
+  ts_wasm_store_reset(store);
+  for (unsigned i = 0; i < self->max_store_count; i++) {
+    if (
+      !atomic_load_ptr((void *const volatile *)&self->idle_stores[i]) &&
+      atomic_compare_exchange_ptr((void *volatile *)&self->idle_stores[i], NULL, store)
+    ) return;
+  }
+  ts_wasm_store_delete(store);
+}
+
 static bool ts_wasm_store__instantiate(
   TSWasmStore *self,
   wasmtime_module_t *module,
@@ -1220,6 +1390,8 @@ const TSLanguage *ts_wasm_store_load_language(
     wasm_language.external_token_count > 0 ? wasm_language.external_scanner.scan : 0,
     wasm_language.external_token_count > 0 ? wasm_language.external_scanner.serialize : 0,
     wasm_language.external_token_count > 0 ? wasm_language.external_scanner.deserialize : 0,
+    wasm_language.version >= LANGUAGE_VERSION_WITH_SMALL_STATE_HASHES ? wasm_language.small_parse_table_hash_map : 0,
+    wasm_language.version >= LANGUAGE_VERSION_WITH_SMALL_STATE_HASHES ? wasm_language.small_parse_table_hashes : 0,
     language_address,
     self->current_memory_offset,
   };
@@ -1332,6 +1504,24 @@ const TSLanguage *ts_wasm_store_load_language(
     );
   }
 
+  if (
+    language->version >= LANGUAGE_VERSION_WITH_SMALL_STATE_HASHES &&
+    language->state_count > language->large_state_count &&
+    wasm_language.small_parse_table_hashes
+  ) {
+    uint32_t small_state_count = wasm_language.state_count - wasm_language.large_state_count;
+    language->small_parse_table_hash_map = copy(
+      &memory[wasm_language.small_parse_table_hash_map],
+      small_state_count * sizeof(uint32_t)
+    );
+    language->small_parse_table_hashes = copy_unsized_static_array(
+      memory,
+      wasm_language.small_parse_table_hashes,
+      addresses,
+      address_count
+    );
+  }
+
   if (language->external_token_count > 0) {
     language->external_scanner.symbol_map = copy(
       &memory[wasm_language.external_scanner.symbol_map],
@@ -1474,7 +1664,10 @@ void ts_wasm_store_reset_heap(TSWasmStore *self) {
 
 bool ts_wasm_store_start(TSWasmStore *self, TSLexer *lexer, const TSLanguage *language) {
   uint32_t instance_index;
-  if (!ts_wasm_store_add_language(self, language, &instance_index)) return false;
+  const TSAllocator *previous_allocator = ts_allocator_push(NULL);
+  bool did_add_language = ts_wasm_store_add_language(self, language, &instance_index);
+  ts_allocator_pop(previous_allocator);
+  if (!did_add_language) return false;
   self->current_lexer = lexer;
   self->current_instance = &self->language_instances.contents[instance_index];
   self->has_error = false;
@@ -1631,6 +1824,7 @@ uint32_t ts_wasm_store_call_scanner_serialize(
   if (self->has_error) return 0;
 
   uint32_t length = args[0].i32;
+  if (length == TREE_SITTER_SERIALIZATION_UNCHANGED) return length;
 
   if (length > 0) {
     memcpy(
@@ -1713,6 +1907,8 @@ void ts_wasm_language_release(const TSLanguage *self) {
     ts_free((void *)self->public_symbol_map);
     ts_free((void *)self->small_parse_table);
     ts_free((void *)self->small_parse_table_map);
+    ts_free((void *)self->small_parse_table_hash_map);
+    ts_free((void *)self->small_parse_table_hashes);
     ts_free((void *)self->symbol_metadata);
     ts_free((void *)self->symbol_names);
     ts_free((void *)self);
@@ -2,7 +2,7 @@
 
 pub mod c_lib;
 
-use memchr::memchr;
+use memchr::{memchr, memrchr};
 use regex::Regex;
 use std::collections::HashMap;
 use std::ffi::{CStr, CString};
@@ -12,7 +12,8 @@ use std::sync::atomic::{AtomicUsize, Ordering};
 use std::{char, mem, str};
 use thiserror::Error;
 use tree_sitter::{
-    Language, LossyUtf8, Parser, Point, Query, QueryCursor, QueryError, QueryPredicateArg, Tree,
+    InputEdit, Language, LossyUtf8, Parser, Point, Query, QueryCursor, QueryError,
+    QueryPredicateArg, Tree,
 };
 
 const MAX_LINE_LEN: usize = 180;
@@ -42,6 +43,11 @@ pub struct NamedCapture {
     pub is_definition: bool,
 }
 
+// The raw pointers in `c_syntax_type_names` refer to the contents of
+// `syntax_type_names`, which are never modified after the configuration is built.
+unsafe impl Send for TagsConfiguration {}
+unsafe impl Sync for TagsConfiguration {}
+
 pub struct TagsContext {
     pub parser: Parser,
     cursor: QueryCursor,
@@ -280,31 +286,138 @@ impl TagsContext {
         self.parser.reset();
         unsafe { self.parser.set_cancellation_flag(cancellation_flag) };
         let tree = self.parser.parse(source, None).ok_or(Error::Cancelled)?;
+        let has_error = tree.root_node().has_error();
+        let iter = self.tags_iter(config, tree, source, 0..usize::MAX, cancellation_flag);
+        Ok((iter, has_error))
+    }
+
+    /// Compute the tags for a new version of a document, reusing the tags that
+    /// were computed for its previous version.
+    ///
+    /// `old_tree` and `old_tags` must be the tree and the tags that were computed
+    /// for the previous version, and `edits` must describe the changes that turned
+    /// it into `source`, in the order that they were made. The edits are applied
+    /// to a copy of `old_tree`, so `old_tree` itself must not have been edited.
+    ///
+    /// The document is reparsed incrementally, and tags are only recomputed for
+    /// the top-level nodes containing the edits and the syntactic changes that
+    /// they caused, along with the comments preceding and following those nodes.
+    /// All other tags are kept, with their positions shifted to account for the
+    /// edits. This produces the same tags as [`generate_tags`](Self::generate_tags)
+    /// as long as each cross-node dependency in the tagging and locals queries,
+    /// such as a doc comment or a local scope, lies within a top-level node and
+    /// its adjacent comments. This is the case for typical tagging queries.
+    ///
+    /// Returns the new tree, which can be passed to the next call, the new tags,
+    /// and whether the new tree contains syntax errors.
+    pub fn generate_tags_incrementally(
+        &mut self,
+        config: &TagsConfiguration,
+        source: &[u8],
+        old_tree: &Tree,
+        old_tags: &[Tag],
+        edits: &[InputEdit],
+        cancellation_flag: Option<&AtomicUsize>,
+    ) -> Result<(Tree, Vec<Tag>, bool), Error> {
+        self.parser
+            .set_language(&config.language)
+            .map_err(|_| Error::InvalidLanguage)?;
+        self.parser.reset();
+        unsafe { self.parser.set_cancellation_flag(cancellation_flag) };
 
+        let mut edited_tree = old_tree.clone();
+        for edit in edits {
+            edited_tree.edit(edit);
+        }
+        let tree = self
+            .parser
+            .parse(source, Some(&edited_tree))
+            .ok_or(Error::Cancelled)?;
+
+        // Find the byte ranges of the new document whose tags may have changed:
+        // the text inserted by each edit, and the ranges whose syntactic structure
+        // changed.
+        let mut changed_ranges = edited_tree
+            .changed_ranges(&tree)
+            .map(|range| range.start_byte..range.end_byte)
+            .collect::<Vec<_>>();
+        for (i, edit) in edits.iter().enumerate() {
+            let mut range = edit.start_byte..edit.new_end_byte;
+            for later_edit in &edits[i + 1..] {
+                range = shift_byte(range.start, later_edit)..shift_byte(range.end, later_edit);
+            }
+            changed_ranges.push(range);
+        }
+        let affected_ranges = affected_ranges(&tree, source, changed_ranges);
+
+        // Keep the old tags that lie outside of the affected ranges.
+        let mut tags = old_tags
+            .iter()
+            .filter_map(|tag| {
+                let tag = edits
+                    .iter()
+                    .fold(tag.clone(), |tag, edit| tag.shifted(edit));
+                (!affected_ranges
+                    .iter()
+                    .any(|range| ranges_touch(&tag.name_range, range)))
+                .then_some(tag)
+            })
+            .collect::<Vec<_>>();
+
+        // Recompute the tags within the affected ranges.
+        for range in &affected_ranges {
+            for tag in self.tags_iter(
+                config,
+                tree.clone(),
+                source,
+                range.clone(),
+                cancellation_flag,
+            ) {
+                let tag = tag?;
+                if ranges_touch(&tag.name_range, range) {
+                    tags.push(tag);
+                }
+            }
+        }
+        self.cursor.set_byte_range(0..usize::MAX);
+
+        tags.sort_by_key(|tag| (tag.name_range.end, tag.name_range.start));
+        tags.dedup_by(|a, b| a.name_range == b.name_range);
+        let has_error = tree.root_node().has_error();
+        Ok((tree, tags, has_error))
+    }
+
+    fn tags_iter<'a>(
+        &'a mut self,
+        config: &'a TagsConfiguration,
+        tree: Tree,
+        source: &'a [u8],
+        byte_range: Range<usize>,
+        cancellation_flag: Option<&'a AtomicUsize>,
+    ) -> TagsIter<'a, impl Iterator<Item = tree_sitter::QueryMatch<'a, 'a>>> {
         // The `matches` iterator borrows the `Tree`, which prevents it from being moved.
         // But the tree is really just a pointer, so it's actually ok to move it.
         let tree_ref = unsafe { mem::transmute::<_, &'static Tree>(&tree) };
-        let matches = self
-            .cursor
-            .matches(&config.query, tree_ref.root_node(), source);
-        Ok((
-            TagsIter {
-                _tree: tree,
-                matches,
-                source,
-                config,
-                cancellation_flag,
-                prev_line_info: None,
-                tag_queue: Vec::new(),
-                iter_count: 0,
-                scopes: vec![LocalScope {
-                    range: 0..source.len(),
-                    inherits: false,
-                    local_defs: Vec::new(),
-                }],
-            },
-            tree_ref.root_node().has_error(),
-        ))
+        let matches = self.cursor.set_byte_range(byte_range).matches(
+            &config.query,
+            tree_ref.root_node(),
+            source,
+        );
+        TagsIter {
+            _tree: tree,
+            matches,
+            source,
+            config,
+            cancellation_flag,
+            prev_line_info: None,
+            tag_queue: Vec::new(),
+            iter_count: 0,
+            scopes: vec![LocalScope {
+                range: 0..source.len(),
+                inherits: false,
+                local_defs: Vec::new(),
+            }],
+        }
     }
 }
 
@@ -580,6 +693,99 @@ impl Tag {
     const fn is_ignored(&self) -> bool {
         self.range.start == usize::MAX
     }
+
+    /// Shift the positions of a tag that was computed before an edit, so that
+    /// they refer to the same text after the edit.
+    #[must_use]
+    fn shifted(mut self, edit: &InputEdit) -> Self {
+        self.range = shift_byte(self.range.start, edit)..shift_byte(self.range.end, edit);
+        self.name_range =
+            shift_byte(self.name_range.start, edit)..shift_byte(self.name_range.end, edit);
+        self.line_range =
+            shift_byte(self.line_range.start, edit)..shift_byte(self.line_range.end, edit);
+        self.span = shift_point(self.span.start, edit)..shift_point(self.span.end, edit);
+        self
+    }
+}
+
+const fn shift_byte(byte: usize, edit: &InputEdit) -> usize {
+    if byte >= edit.old_end_byte {
+        byte - edit.old_end_byte + edit.new_end_byte
+    } else if byte > edit.new_end_byte {
+        edit.new_end_byte
+    } else {
+        byte
+    }
+}
+
+fn shift_point(point: Point, edit: &InputEdit) -> Point {
+    if point >= edit.old_end_position {
+        let row = point.row - edit.old_end_position.row + edit.new_end_position.row;
+        let column = if point.row == edit.old_end_position.row {
+            point.column - edit.old_end_position.column + edit.new_end_position.column
+        } else {
+            point.column
+        };
+        Point::new(row, column)
+    } else {
+        point.min(edit.new_end_position)
+    }
+}
+
+const fn ranges_touch(a: &Range<usize>, b: &Range<usize>) -> bool {
+    a.start <= b.end && a.end >= b.start
+}
+
+/// Expand the given byte ranges of a document so that they cover every tag whose
+/// contents may have changed.
+///
+/// Each range is widened to whole lines, since a tag's line and columns depend on
+/// the rest of its line, and then to whole top-level nodes, along with the
+/// comments and other extras that precede them and the node that follows them, so
+/// that tags whose docs are attached to a neighboring node are recomputed too.
+fn affected_ranges(tree: &Tree, source: &[u8], mut ranges: Vec<Range<usize>>) -> Vec<Range<usize>> {
+    let root = tree.root_node();
+    let mut cursor = root.walk();
+    let top_level_nodes = root
+        .children(&mut cursor)
+        .map(|node| (node.byte_range(), node.is_extra()))
+        .collect::<Vec<_>>();
+
+    for range in &mut ranges {
+        *range = line_bounds(source, range);
+        let mut start = top_level_nodes.partition_point(|(node, _)| node.end < range.start);
+        let mut end = top_level_nodes.partition_point(|(node, _)| node.start <= range.end);
+        while start > 0 && top_level_nodes[start - 1].1 {
+            start -= 1;
+        }
+        while end < top_level_nodes.len() && top_level_nodes[end].1 {
+            end += 1;
+        }
+        end = (end + 1).min(top_level_nodes.len());
+        if start < end {
+            range.start = range.start.min(top_level_nodes[start].0.start);
+            range.end = range.end.max(top_level_nodes[end - 1].0.end);
+        }
+        *range = line_bounds(source, range);
+    }
+
+    ranges.sort_unstable_by_key(|range| range.start);
+    let mut result: Vec<Range<usize>> = Vec::with_capacity(ranges.len());
+    for range in ranges {
+        match result.last_mut() {
+            Some(last) if ranges_touch(last, &range) => last.end = last.end.max(range.end),
+            _ => result.push(range),
+        }
+    }
+    result
+}
+
+fn line_bounds(text: &[u8], range: &Range<usize>) -> Range<usize> {
+    let start = range.start.min(text.len());
+    let end = range.end.clamp(start, text.len());
+    let line_start = memrchr(b'\n', &text[..start]).map_or(0, |i| i + 1);
+    let line_end = memchr(b'\n', &text[end..]).map_or(text.len(), |i| end + i);
+    line_start..line_end
 }
 
 fn line_range(
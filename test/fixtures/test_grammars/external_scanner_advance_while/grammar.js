@@ -0,0 +1,14 @@
+module.exports = grammar({
+    name: "external_scanner_advance_while",
+
+    externals: $ => [
+        $.word
+    ],
+
+    extras: $ => [/\s/],
+
+    rules: {
+        document: $ => repeat(choice($.word, $.number)),
+        number: $ => /\d+/
+    }
+})
@@ -0,0 +1,54 @@
+#include "tree_sitter/parser.h"
+
+enum {
+  WORD,
+};
+
+static const TSCharacterRange WHITESPACE[] = {
+  {'\t', '\r'},
+  {' ', ' '},
+};
+
+static const TSCharacterRange WORD_CHARACTERS[] = {
+  {'A', 'Z'},
+  {'_', '_'},
+  {'a', 'z'},
+  {0xC0, 0x24F},
+  {0x370, 0x3FF},
+};
+
+void *tree_sitter_external_scanner_advance_while_external_scanner_create() {
+  return NULL;
+}
+
+void tree_sitter_external_scanner_advance_while_external_scanner_destroy(
+  void *payload) {}
+
+void tree_sitter_external_scanner_advance_while_external_scanner_reset(
+  void *payload) {}
+
+unsigned tree_sitter_external_scanner_advance_while_external_scanner_serialize(
+  void *payload,
+  char *buffer
+) { return 0; }
+
+void tree_sitter_external_scanner_advance_while_external_scanner_deserialize(
+  void *payload,
+  const char *buffer,
+  unsigned length
+) {}
+
+bool tree_sitter_external_scanner_advance_while_external_scanner_scan(
+  void *payload,
+  TSLexer *lexer,
+  const bool *valid_symbols
+) {
+  if (!valid_symbols[WORD]) return false;
+
+  lexer->advance_while(lexer, WHITESPACE, 2, true);
+  uint32_t length = lexer->advance_while(lexer, WORD_CHARACTERS, 5, false);
+  if (length == 0) return false;
+
+  lexer->result_symbol = WORD;
+  return true;
+}
@@ -0,0 +1,17 @@
+module.exports = grammar({
+    name: "external_scanner_unchanged_state",
+
+    externals: $ => [
+        $.start_tag,
+        $.end_tag,
+        $.text
+    ],
+
+    extras: $ => [/\s/],
+
+    rules: {
+        document: $ => repeat($._node),
+        _node: $ => choice($.element, $.text),
+        element: $ => seq($.start_tag, repeat($._node), $.end_tag)
+    }
+})
@@ -0,0 +1,121 @@
+#include "tree_sitter/parser.h"
+#include <string.h>
+
+enum {
+  START_TAG,
+  END_TAG,
+  TEXT,
+};
+
+// The scanner's state is the stack of open tag names, each followed by a
+// `/`. The state only changes at tags, so the scanner keeps track of whether
+// it has changed, and tells the parser when it hasn't.
+typedef struct {
+  char names[TREE_SITTER_SERIALIZATION_BUFFER_SIZE];
+  unsigned length;
+  bool changed;
+} Scanner;
+
+static bool is_space(int32_t c) {
+  return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+static bool is_name_character(int32_t c) {
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+}
+
+void *tree_sitter_external_scanner_unchanged_state_external_scanner_create() {
+  Scanner *scanner = malloc(sizeof(Scanner));
+  scanner->length = 0;
+  scanner->changed = false;
+  return scanner;
+}
+
+void tree_sitter_external_scanner_unchanged_state_external_scanner_destroy(void *payload) {
+  free(payload);
+}
+
+unsigned tree_sitter_external_scanner_unchanged_state_external_scanner_serialize(
+  void *payload,
+  char *buffer
+) {
+  Scanner *scanner = payload;
+  if (!scanner->changed) return TREE_SITTER_SERIALIZATION_UNCHANGED;
+  memcpy(buffer, scanner->names, scanner->length);
+  scanner->changed = false;
+  return scanner->length;
+}
+
+void tree_sitter_external_scanner_unchanged_state_external_scanner_deserialize(
+  void *payload,
+  const char *buffer,
+  unsigned length
+) {
+  Scanner *scanner = payload;
+  if (length > 0) memcpy(scanner->names, buffer, length);
+  scanner->length = length;
+  scanner->changed = false;
+}
+
+static bool scan_end_tag(Scanner *scanner, TSLexer *lexer) {
+  if (scanner->length == 0) return false;
+  unsigned start = scanner->length - 1;
+  while (start > 0 && scanner->names[start - 1] != '/') start--;
+
+  for (unsigned i = start; i < scanner->length - 1; i++) {
+    if (lexer->lookahead != scanner->names[i]) return false;
+    lexer->advance(lexer, false);
+  }
+  if (lexer->lookahead != '>') return false;
+  lexer->advance(lexer, false);
+
+  scanner->length = start;
+  scanner->changed = true;
+  lexer->result_symbol = END_TAG;
+  return true;
+}
+
+static bool scan_start_tag(Scanner *scanner, TSLexer *lexer) {
+  unsigned length = scanner->length;
+  while (is_name_character(lexer->lookahead)) {
+    if (length + 1 >= TREE_SITTER_SERIALIZATION_BUFFER_SIZE) return false;
+    scanner->names[length++] = (char)lexer->lookahead;
+    lexer->advance(lexer, false);
+  }
+  if (length == scanner->length || lexer->lookahead != '>') return false;
+  lexer->advance(lexer, false);
+
+  scanner->names[length++] = '/';
+  scanner->length = length;
+  scanner->changed = true;
+  lexer->result_symbol = START_TAG;
+  return true;
+}
+
+bool tree_sitter_external_scanner_unchanged_state_external_scanner_scan(
+  void *payload,
+  TSLexer *lexer,
+  const bool *valid_symbols
+) {
+  Scanner *scanner = payload;
+  while (is_space(lexer->lookahead)) lexer->advance(lexer, true);
+
+  if (lexer->lookahead == '<') {
+    lexer->advance(lexer, false);
+    if (lexer->lookahead == '/') {
+      lexer->advance(lexer, false);
+      return valid_symbols[END_TAG] && scan_end_tag(scanner, lexer);
+    }
+    return valid_symbols[START_TAG] && scan_start_tag(scanner, lexer);
+  }
+
+  if (!valid_symbols[TEXT]) return false;
+  bool has_content = false;
+  while (lexer->lookahead != 0 && lexer->lookahead != '<' && !is_space(lexer->lookahead)) {
+    lexer->advance(lexer, false);
+    has_content = true;
+  }
+  if (!has_content) return false;
+  lexer->result_symbol = TEXT;
+  return true;
+}
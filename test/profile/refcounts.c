@@ -0,0 +1,91 @@
+// Measure the operations whose cost is dominated by reference counting:
+// incremental reparses, which retain and release the reused subtrees, and
+// deleting whole trees. Build this once with the default library and once
+// with `TREE_SITTER_SINGLE_THREADED` defined to compare the two. See
+// `script/benchmark-refcounts`.
+
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <tree_sitter/api.h>
+
+const TSLanguage *tree_sitter_json(void);
+
+#define ELEMENT_COUNT 20000
+#define EDIT_COUNT 2000
+#define DELETE_COUNT 50
+
+static double now(void) {
+  struct timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return time.tv_sec + time.tv_nsec * 1e-9;
+}
+
+int main(void) {
+  // A JSON array on a single line, so that every column is a byte offset.
+  size_t capacity = ELEMENT_COUNT * 64;
+  char *source = malloc(capacity);
+  uint32_t length = sprintf(source, "[");
+  for (unsigned i = 0; i < ELEMENT_COUNT; i++) {
+    length += sprintf(
+      source + length,
+      "%s{\"a\": [%u, true, null, \"x\"]}",
+      i > 0 ? ", " : "",
+      i
+    );
+  }
+  length += sprintf(source + length, "]");
+
+  TSParser *parser = ts_parser_new();
+  ts_parser_set_language(parser, tree_sitter_json());
+  TSTree *tree = ts_parser_parse_string(parser, NULL, source, length);
+
+  // Change one digit at a time, keeping the fastest reparse.
+  double best_reparse = 0;
+  for (unsigned i = 0; i < EDIT_COUNT; i++) {
+    uint32_t position = 1 + (uint32_t)((i * 7919UL) % (length - 10));
+    while (source[position] < '0' || source[position] > '9') position++;
+    source[position] = source[position] == '9' ? '1' : source[position] + 1;
+
+    TSInputEdit edit = {
+      .start_byte = position,
+      .old_end_byte = position + 1,
+      .new_end_byte = position + 1,
+      .start_point = {0, position},
+      .old_end_point = {0, position + 1},
+      .new_end_point = {0, position + 1},
+    };
+    ts_tree_edit(tree, &edit);
+
+    double start = now();
+    TSTree *new_tree = ts_parser_parse_string(parser, tree, source, length);
+    double duration = now() - start;
+    if (i == 0 || duration < best_reparse) best_reparse = duration;
+
+    ts_tree_delete(tree);
+    tree = new_tree;
+  }
+  ts_tree_delete(tree);
+
+  // Delete freshly parsed trees, keeping the fastest deletion.
+  double best_delete = 0;
+  for (unsigned i = 0; i < DELETE_COUNT; i++) {
+    tree = ts_parser_parse_string(parser, NULL, source, length);
+    double start = now();
+    ts_tree_delete(tree);
+    double duration = now() - start;
+    if (i == 0 || duration < best_delete) best_delete = duration;
+  }
+
+  printf(
+    "  incremental reparse: %.4f ms, tree delete: %.2f ms\n",
+    best_reparse * 1e3,
+    best_delete * 1e3
+  );
+
+  ts_parser_delete(parser);
+  free(source);
+  return 0;
+}